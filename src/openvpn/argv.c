@@ -184,6 +184,12 @@ argv_clone(const struct argv *source, const size_t headroom)
     struct argv r;
     argv_init(&r);
 
+    if (source)
+    {
+        /* reserve the final size upfront so the copy loop below never
+         * has to re-extend the argument list */
+        argv_extend(&r, adjust_power_of_2(headroom + source->argc + 1));
+    }
     for (size_t i = 0; i < headroom; ++i)
     {
         argv_append(&r, NULL);
@@ -502,3 +508,66 @@ argv_parse_cmd(struct argv *argres, const char *cmdstr)
         argv_append(argres, string_alloc(cmdstr, &argres->gc));
     }
 }
+
+/**
+ *  Initialises a struct argv_template by tokenizing the given command
+ *  string once.  The template can then be expanded cheaply for every
+ *  script invocation via argv_template_expand().
+ *
+ *  @param *t       Valid pointer to the struct argv_template to initialise
+ *  @param *cmdstr  Command string to pre-parse.  May be NULL if the
+ *                  corresponding script option is not set.  The string
+ *                  must outlive the template.
+ */
+void
+argv_template_init(struct argv_template *t, const char *cmdstr)
+{
+    t->cmdstr = cmdstr;
+    t->parsed = argv_new();
+    if (cmdstr)
+    {
+        argv_parse_cmd(&t->parsed, cmdstr);
+    }
+}
+
+/**
+ *  Frees all memory held by a struct argv_template.
+ *
+ *  @param *t  Valid pointer to the struct argv_template to release
+ */
+void
+argv_template_free(struct argv_template *t)
+{
+    argv_free(&t->parsed);
+    t->cmdstr = NULL;
+}
+
+/**
+ *  Creates a new struct argv seeded with the pre-parsed command prefix
+ *  of a template.  Event-specific arguments can then be appended with
+ *  argv_printf_cat().
+ *
+ *  The cmdstr argument must be the command string the caller would
+ *  otherwise have passed to argv_parse_cmd().  If it is not the exact
+ *  string the template was built from (e.g. a per-client override from
+ *  a --client-config-dir file), the template is bypassed and the string
+ *  is parsed from scratch.
+ *
+ *  @param *t       Valid pointer to an initialised struct argv_template
+ *  @param *cmdstr  Command string to expand; must not be NULL
+ *
+ *  @returns Returns a new struct argv holding the tokenized command;
+ *           release it with argv_free().
+ */
+struct argv
+argv_template_expand(const struct argv_template *t, const char *cmdstr)
+{
+    if (t->cmdstr && t->cmdstr == cmdstr)
+    {
+        return argv_clone(&t->parsed, 0);
+    }
+
+    struct argv r = argv_new();
+    argv_parse_cmd(&r, cmdstr);
+    return r;
+}
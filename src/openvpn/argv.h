@@ -39,6 +39,21 @@ struct argv {
     char **argv;
 };
 
+/**
+ * Pre-parsed script command template.  The constant command prefix is
+ * tokenized once (typically at startup) so that building the argv for
+ * each script invocation only copies the parsed arguments and appends
+ * the event-specific ones, instead of re-running parse_line() on the
+ * command string every time.
+ */
+struct argv_template {
+    struct argv parsed;         /**< Tokenized command prefix */
+    const char *cmdstr;         /**< Command string the template was
+                                 *   parsed from; compared by pointer in
+                                 *   argv_template_expand() to detect
+                                 *   per-client overrides */
+};
+
 struct argv argv_new(void);
 
 void argv_free(struct argv *a);
@@ -53,6 +68,12 @@ void argv_msg_prefix(const int msglev, const struct argv *a, const char *prefix)
 
 void argv_parse_cmd(struct argv *a, const char *s);
 
+void argv_template_init(struct argv_template *t, const char *cmdstr);
+
+void argv_template_free(struct argv_template *t);
+
+struct argv argv_template_expand(const struct argv_template *t, const char *cmdstr);
+
 bool argv_printf(struct argv *a, const char *format, ...)
 #ifdef __GNUC__
 #if __USE_MINGW_ANSI_STDIO
@@ -32,6 +32,7 @@
 #include "common.h"
 #include "buffer.h"
 #include "error.h"
+#include "memprof.h"
 #include "mtu.h"
 #include "misc.h"
 
@@ -58,7 +59,7 @@ buf_size_error(const size_t size)
 }
 
 struct buffer
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
 alloc_buf_debug(size_t size, const char *file, int line)
 #else
 alloc_buf(size_t size)
@@ -79,12 +80,15 @@ alloc_buf(size_t size)
     buf.data = calloc(1, size);
 #endif
     check_malloc_return(buf.data);
+#ifdef ENABLE_MEM_PROFILE
+    buf.memprof_site = memprof_record_alloc(file, line, size);
+#endif
 
     return buf;
 }
 
 struct buffer
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
 alloc_buf_gc_debug(size_t size, struct gc_arena *gc, const char *file, int line)
 #else
 alloc_buf_gc(size_t size, struct gc_arena *gc)
@@ -98,10 +102,14 @@ alloc_buf_gc(size_t size, struct gc_arena *gc)
     buf.capacity = (int)size;
     buf.offset = 0;
     buf.len = 0;
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
     buf.data = (uint8_t *) gc_malloc_debug(size, false, gc, file, line);
 #else
     buf.data = (uint8_t *) gc_malloc(size, false, gc);
+#endif
+#ifdef ENABLE_MEM_PROFILE
+    /* accounted against the gc_entry, not the buffer */
+    buf.memprof_site = NULL;
 #endif
     if (size)
     {
@@ -111,7 +119,7 @@ alloc_buf_gc(size_t size, struct gc_arena *gc)
 }
 
 struct buffer
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
 clone_buf_debug(const struct buffer *buf, const char *file, int line)
 #else
 clone_buf(const struct buffer *buf)
@@ -127,6 +135,9 @@ clone_buf(const struct buffer *buf)
     ret.data = (uint8_t *) malloc(buf->capacity);
 #endif
     check_malloc_return(ret.data);
+#ifdef ENABLE_MEM_PROFILE
+    ret.memprof_site = memprof_record_alloc(file, line, buf->capacity);
+#endif
     memcpy(BPTR(&ret), BPTR(buf), BLEN(buf));
     return ret;
 }
@@ -184,6 +195,12 @@ buf_assign(struct buffer *dest, const struct buffer *src)
 void
 free_buf(struct buffer *buf)
 {
+#ifdef ENABLE_MEM_PROFILE
+    if (buf->data)
+    {
+        memprof_record_free(buf->memprof_site, buf->capacity);
+    }
+#endif
     free(buf->data);
     CLEAR(*buf);
 }
@@ -204,6 +221,9 @@ free_buf_gc(struct buffer *buf, struct gc_arena *gc)
 
                 /* remove element from linked list and free it */
                 *e = (*e)->next;
+#ifdef ENABLE_MEM_PROFILE
+                memprof_record_free(to_delete->memprof_site, to_delete->memprof_size);
+#endif
                 free(to_delete);
 
                 break;
@@ -396,10 +416,73 @@ cleanup:
 
 /*
  * Garbage collection
+ *
+ * Small allocations are carved out of fixed-size blocks with a bump
+ * pointer so that arena teardown frees a handful of blocks instead of
+ * walking one malloc()ed entry per allocation.  Released blocks are
+ * kept on a freelist for reuse by the next arena.  An arena must stay
+ * on the thread that created it; with worker threads compiled in, the
+ * freelist is thread-local so each thread's arenas (error formatting,
+ * crypto diagnostics) recycle blocks without locking.  Debug builds
+ * (DMALLOC/ENABLE_MEM_PROFILE) bypass the blocks to retain
+ * per-allocation accounting.
  */
 
+#define GC_BLOCK_SIZE 4096
+#define GC_BLOCK_ALIGN 16       /* conservative malloc()-style alignment */
+#define GC_BLOCK_HDR ((sizeof(struct gc_block) + GC_BLOCK_ALIGN - 1) & ~((size_t)GC_BLOCK_ALIGN - 1))
+#define GC_BLOCK_CAPACITY (GC_BLOCK_SIZE - GC_BLOCK_HDR)
+#define GC_BLOCK_LIMIT (GC_BLOCK_SIZE / 8)     /* larger requests get their own gc_entry */
+#define GC_BLOCK_FREELIST_MAX 64
+
+#if !defined(DMALLOC) && !defined(ENABLE_MEM_PROFILE)
+
+#ifdef ENABLE_WORKER_THREADS
+static __thread struct gc_block *gc_block_freelist;
+static __thread int gc_block_freelist_len;
+#else
+static struct gc_block *gc_block_freelist;
+static int gc_block_freelist_len;
+#endif
+
+static struct gc_block *
+gc_block_get(void)
+{
+    struct gc_block *b = gc_block_freelist;
+    if (b)
+    {
+        gc_block_freelist = b->next;
+        --gc_block_freelist_len;
+    }
+    else
+    {
+        b = (struct gc_block *) malloc(GC_BLOCK_SIZE);
+        check_malloc_return(b);
+    }
+    b->next = NULL;
+    b->used = 0;
+    return b;
+}
+
+static void
+gc_block_put(struct gc_block *b)
+{
+    if (gc_block_freelist_len < GC_BLOCK_FREELIST_MAX)
+    {
+        b->next = gc_block_freelist;
+        gc_block_freelist = b;
+        ++gc_block_freelist_len;
+    }
+    else
+    {
+        free(b);
+    }
+}
+
+#endif /* !DMALLOC && !ENABLE_MEM_PROFILE */
+
 void *
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
 gc_malloc_debug(size_t size, bool clear, struct gc_arena *a, const char *file, int line)
 #else
 gc_malloc(size_t size, bool clear, struct gc_arena *a)
@@ -408,16 +491,38 @@ gc_malloc(size_t size, bool clear, struct gc_arena *a)
     void *ret;
     if (a)
     {
-        struct gc_entry *e;
+#if !defined(DMALLOC) && !defined(ENABLE_MEM_PROFILE)
+        if (size <= GC_BLOCK_LIMIT)
+        {
+            const size_t rounded = (size + GC_BLOCK_ALIGN - 1) & ~((size_t)GC_BLOCK_ALIGN - 1);
+            struct gc_block *b = a->blocks;
+            if (!b || GC_BLOCK_CAPACITY - b->used < rounded)
+            {
+                b = gc_block_get();
+                b->next = a->blocks;
+                a->blocks = b;
+            }
+            ret = (char *) b + GC_BLOCK_HDR + b->used;
+            b->used += rounded;
+        }
+        else
+#endif
+        {
+            struct gc_entry *e;
 #ifdef DMALLOC
-        e = (struct gc_entry *) openvpn_dmalloc(file, line, size + sizeof(struct gc_entry));
+            e = (struct gc_entry *) openvpn_dmalloc(file, line, size + sizeof(struct gc_entry));
 #else
-        e = (struct gc_entry *) malloc(size + sizeof(struct gc_entry));
+            e = (struct gc_entry *) malloc(size + sizeof(struct gc_entry));
 #endif
-        check_malloc_return(e);
-        ret = (char *) e + sizeof(struct gc_entry);
-        e->next = a->list;
-        a->list = e;
+            check_malloc_return(e);
+#ifdef ENABLE_MEM_PROFILE
+            e->memprof_size = size + sizeof(struct gc_entry);
+            e->memprof_site = memprof_record_alloc(file, line, e->memprof_size);
+#endif
+            ret = (char *) e + sizeof(struct gc_entry);
+            e->next = a->list;
+            a->list = e;
+        }
     }
     else
     {
@@ -445,9 +550,24 @@ x_gc_free(struct gc_arena *a)
     while (e != NULL)
     {
         struct gc_entry *next = e->next;
+#ifdef ENABLE_MEM_PROFILE
+        memprof_record_free(e->memprof_site, e->memprof_size);
+#endif
         free(e);
         e = next;
     }
+
+#if !defined(DMALLOC) && !defined(ENABLE_MEM_PROFILE)
+    struct gc_block *b = a->blocks;
+    a->blocks = NULL;
+
+    while (b != NULL)
+    {
+        struct gc_block *next = b->next;
+        gc_block_put(b);
+        b = next;
+    }
+#endif
 }
 
 /*
@@ -508,6 +628,17 @@ gc_transfer(struct gc_arena *dest, struct gc_arena *src)
             dest->list = src->list;
             src->list = NULL;
         }
+        struct gc_block *b = src->blocks;
+        if (b)
+        {
+            while (b->next != NULL)
+            {
+                b = b->next;
+            }
+            b->next = dest->blocks;
+            dest->blocks = src->blocks;
+            src->blocks = NULL;
+        }
     }
 }
 
@@ -679,7 +810,7 @@ rm_trailing_chars(char *str, const char *what_to_delete)
  * Allocate a string
  */
 char *
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
 string_alloc_debug(const char *str, struct gc_arena *gc, const char *file, int line)
 #else
 string_alloc(const char *str, struct gc_arena *gc)
@@ -692,7 +823,7 @@ string_alloc(const char *str, struct gc_arena *gc)
 
         if (gc)
         {
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
             ret = (char *) gc_malloc_debug(n, false, gc, file, line);
 #else
             ret = (char *) gc_malloc(n, false, gc);
@@ -783,7 +914,7 @@ print_argv(const char **p, struct gc_arena *gc, const unsigned int flags)
  * Allocate a string inside a buffer
  */
 struct buffer
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
 string_alloc_buf_debug(const char *str, struct gc_arena *gc, const char *file, int line)
 #else
 string_alloc_buf(const char *str, struct gc_arena *gc)
@@ -793,7 +924,7 @@ string_alloc_buf(const char *str, struct gc_arena *gc)
 
     ASSERT(str);
 
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
     buf_set_read(&buf, (uint8_t *) string_alloc_debug(str, gc, file, line), strlen(str) + 1);
 #else
     buf_set_read(&buf, (uint8_t *) string_alloc(str, gc), strlen(str) + 1);
@@ -1358,18 +1489,63 @@ buffer_list_pop(struct buffer_list *ol)
     }
 }
 
+#ifndef _WIN32
+int
+buffer_list_peek_iov(struct buffer_list *ol, struct iovec *iov, int max_iov,
+                     int max_len)
+{
+    int n = 0;
+    int total = 0;
+
+    if (ol)
+    {
+        for (struct buffer_entry *e = ol->head; e && n < max_iov; e = e->next)
+        {
+            int len = BLEN(&e->buf);
+            if (len <= 0)
+            {
+                continue;
+            }
+            if (len > max_len - total)
+            {
+                len = max_len - total;
+                if (len <= 0)
+                {
+                    break;
+                }
+            }
+            iov[n].iov_base = BPTR(&e->buf);
+            iov[n].iov_len = len;
+            total += len;
+            ++n;
+        }
+    }
+    return n;
+}
+#endif /* ifndef _WIN32 */
+
 void
 buffer_list_advance(struct buffer_list *ol, int n)
 {
-    if (ol->head)
+    while (ol->head)
     {
         struct buffer *buf = &ol->head->buf;
-        ASSERT(buf_advance(buf, n));
-        if (!BLEN(buf))
+        const int step = min_int(n, BLEN(buf));
+
+        ASSERT(buf_advance(buf, step));
+        n -= step;
+
+        if (BLEN(buf))
         {
-            buffer_list_pop(ol);
+            break;
+        }
+        buffer_list_pop(ol);
+        if (n == 0)
+        {
+            break;
         }
     }
+    ASSERT(n == 0);
 }
 
 struct buffer_list *
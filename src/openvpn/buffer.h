@@ -42,6 +42,9 @@
 #define BUF_INIT_TRACKING
 #endif
 
+/* --enable-mem-profile per-callsite accounting, see memprof.h */
+struct memprof_site;
+
 /**************************************************************************/
 /**
  * Wrapper structure for dynamically allocated memory.
@@ -71,6 +74,12 @@ struct buffer
     const char *debug_file;
     int debug_line;
 #endif
+#ifdef ENABLE_MEM_PROFILE
+    struct memprof_site *memprof_site;
+                                /**< Allocation callsite, for per-callsite
+                                 *   live byte accounting.  NULL for
+                                 *   gc-owned or non-owning buffers. */
+#endif
 };
 
 
@@ -88,6 +97,12 @@ struct gc_entry
 {
     struct gc_entry *next;      /**< Pointer to the next item in the
                                  *   linked list. */
+#ifdef ENABLE_MEM_PROFILE
+    struct memprof_site *memprof_site;
+                                /**< Allocation callsite, for per-callsite
+                                 *   live byte accounting. */
+    size_t memprof_size;        /**< Size of this entry including header. */
+#endif
 };
 
 /**
@@ -102,6 +117,22 @@ struct gc_entry_special
     void *addr;
 };
 
+/**
+ * Garbage collection block holding many small allocations.
+ *
+ * Small \c gc_malloc() requests are carved out of fixed-size blocks with
+ * a bump pointer, so that \c gc_free() releases them wholesale instead
+ * of walking a long per-allocation chain.  Released blocks are kept on a
+ * freelist for reuse by the next arena.
+ */
+struct gc_block
+{
+    struct gc_block *next;      /**< Pointer to the next block in the
+                                 *   arena (or in the freelist). */
+    size_t used;                /**< Number of data bytes handed out
+                                 *   from this block so far. */
+};
+
 
 /**
  * Garbage collection arena used to keep track of dynamically allocated
@@ -118,6 +149,10 @@ struct gc_arena
     struct gc_entry *list;      /**< First element of the linked list of
                                  *   \c gc_entry structures. */
     struct gc_entry_special *list_special;
+    struct gc_block *blocks;    /**< First element of the linked list of
+                                 *   \c gc_block structures holding the
+                                 *   small allocations; the first block
+                                 *   is the one bump-allocated from. */
 };
 
 
@@ -146,9 +181,9 @@ char *print_argv(const char **p, struct gc_arena *gc, const unsigned int flags);
 
 void buf_size_error(const size_t size);
 
-/* for dmalloc debugging */
+/* for dmalloc debugging and --enable-mem-profile accounting */
 
-#ifdef DMALLOC
+#if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE)
 
 #define alloc_buf(size)               alloc_buf_debug(size, __FILE__, __LINE__)
 #define alloc_buf_gc(size, gc)        alloc_buf_gc_debug(size, gc, __FILE__, __LINE__);
@@ -169,7 +204,7 @@ char *string_alloc_debug(const char *str, struct gc_arena *gc, const char *file,
 
 struct buffer string_alloc_buf_debug(const char *str, struct gc_arena *gc, const char *file, int line);
 
-#else  /* ifdef DMALLOC */
+#else  /* if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE) */
 
 struct buffer alloc_buf(size_t size);
 
@@ -183,7 +218,7 @@ char *string_alloc(const char *str, struct gc_arena *gc);
 
 struct buffer string_alloc_buf(const char *str, struct gc_arena *gc);
 
-#endif /* ifdef DMALLOC */
+#endif /* if defined(DMALLOC) || defined(ENABLE_MEM_PROFILE) */
 
 void gc_addspecial(void *addr, void (*free_function)(void *), struct gc_arena *a);
 
@@ -223,6 +258,20 @@ buf_valid(const struct buffer *buf)
     return likely(buf->data != NULL) && likely(buf->len >= 0);
 }
 
+/*
+ * Two-tier validity checking.  Packet buffers are verified once at the
+ * I/O boundary (read_incoming_link()/read_incoming_tun()); the interior
+ * write/advance operations then keep only their arithmetic bounds
+ * checks and assume the buffer itself is valid -- a cleared buffer
+ * still fails those bounds checks because its capacity is zero.  Debug
+ * builds with init tracking keep the full per-call validity check.
+ */
+#ifdef BUF_INIT_TRACKING
+#define buf_assume_valid(buf) buf_valid(buf)
+#else
+#define buf_assume_valid(buf) true
+#endif
+
 static inline uint8_t *
 buf_bptr(const struct buffer *buf)
 {
@@ -540,14 +589,14 @@ struct buffer buf_sub(struct buffer *buf, int size, bool prepend);
 static inline bool
 buf_safe(const struct buffer *buf, int len)
 {
-    return buf_valid(buf) && buf_size_valid(len)
+    return buf_assume_valid(buf) && buf_size_valid(len)
            && buf->offset + buf->len + len <= buf->capacity;
 }
 
 static inline bool
 buf_safe_bidir(const struct buffer *buf, int len)
 {
-    if (buf_valid(buf) && buf_size_valid_signed(len))
+    if (buf_assume_valid(buf) && buf_size_valid_signed(len))
     {
         const int newlen = buf->len + len;
         return newlen >= 0 && buf->offset + newlen <= buf->capacity;
@@ -626,7 +675,7 @@ buf_inc_len(struct buffer *buf, int inc)
 static inline uint8_t *
 buf_prepend(struct buffer *buf, int size)
 {
-    if (!buf_valid(buf) || size < 0 || size > buf->offset)
+    if (!buf_assume_valid(buf) || size < 0 || size > buf->offset)
     {
         return NULL;
     }
@@ -638,7 +687,7 @@ buf_prepend(struct buffer *buf, int size)
 static inline bool
 buf_advance(struct buffer *buf, int size)
 {
-    if (!buf_valid(buf) || size < 0 || buf->len < size)
+    if (!buf_assume_valid(buf) || size < 0 || buf->len < size)
     {
         return false;
     }
@@ -995,7 +1044,7 @@ void x_gc_freespecial(struct gc_arena *a);
 static inline bool
 gc_defined(struct gc_arena *a)
 {
-    return a->list != NULL;
+    return a->list != NULL || a->blocks != NULL;
 }
 
 static inline void
@@ -1003,6 +1052,7 @@ gc_init(struct gc_arena *a)
 {
     a->list = NULL;
     a->list_special = NULL;
+    a->blocks = NULL;
 }
 
 static inline void
@@ -1022,7 +1072,7 @@ gc_new(void)
 static inline void
 gc_free(struct gc_arena *a)
 {
-    if (a->list)
+    if (a->list || a->blocks)
     {
         x_gc_free(a);
     }
@@ -1175,6 +1225,28 @@ struct buffer_entry *buffer_list_push_data(struct buffer_list *ol, const void *d
  */
 struct buffer *buffer_list_peek(struct buffer_list *ol);
 
+#ifndef _WIN32
+struct iovec;
+
+/**
+ * Export the leading buffers of the list as I/O vectors for
+ * scatter-gather output, without flattening the list.
+ *
+ * The last exported vector may cover only part of its buffer when
+ * \c max_len would otherwise be exceeded.  Use buffer_list_advance()
+ * with the number of bytes actually written to consume the list.
+ *
+ * @param ol        the list to export
+ * @param iov       array of \c max_iov I/O vectors to fill in
+ * @param max_iov   the maximum number of vectors to fill in
+ * @param max_len   the maximum total number of bytes to export
+ *
+ * @return the number of vectors filled in
+ */
+int buffer_list_peek_iov(struct buffer_list *ol, struct iovec *iov,
+                         int max_iov, int max_len);
+#endif
+
 void buffer_list_advance(struct buffer_list *ol, int n);
 
 void buffer_list_pop(struct buffer_list *ol);
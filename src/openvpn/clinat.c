@@ -45,7 +45,16 @@ add_entry(struct client_nat_option_list *dest,
     }
     else
     {
-        dest->entries[dest->n++] = *e;
+        struct client_nat_entry *n = &dest->entries[dest->n++];
+
+        *n = *e;
+
+        /* precompute the checksum adjustment of the prefix rewrite; the
+         * host part of a translated address is unchanged, so the
+         * per-packet delta only depends on the two network prefixes */
+        n->cksum_delta = 0;
+        ADD_CHECKSUM_32(n->cksum_delta, n->network);
+        SUB_CHECKSUM_32(n->cksum_delta, n->foreign_network);
         return true;
     }
 }
@@ -235,20 +244,23 @@ client_nat_transform(const struct client_nat_option_list *list,
 
         if (((addr & e->netmask) == *from) && !(amask & alog))
         {
-            /* pre-adjust IP checksum */
-            ADD_CHECKSUM_32(accumulate, addr);
+            /* checksum adjustment, precomputed at config time */
+            accumulate += direction ? -e->cksum_delta : e->cksum_delta;
 
             /* do NAT transform */
             addr = (addr & ~e->netmask) | *to;
 
-            /* post-adjust IP checksum */
-            SUB_CHECKSUM_32(accumulate, addr);
-
             /* write the modified address to packet */
             *addr_ptr = addr;
 
             /* mark as modified */
             alog |= amask;
+
+            /* both addresses translated -- no further rule can match */
+            if (alog == 3)
+            {
+                break;
+            }
         }
     }
     if (alog)
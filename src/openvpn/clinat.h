@@ -38,6 +38,9 @@ struct client_nat_entry {
     in_addr_t network;
     in_addr_t netmask;
     in_addr_t foreign_network;
+    int cksum_delta;        /**< precomputed checksum adjustment for the
+                             *   network -> foreign_network rewrite;
+                             *   negated for the reverse direction */
 };
 
 struct client_nat_option_list {
@@ -69,10 +69,12 @@ do_lz4_compress(struct buffer *buf,
                 const struct frame *frame)
 {
     /*
-     * In order to attempt compression, length must be at least COMPRESS_THRESHOLD.
-     * and asymmetric compression must be disabled
+     * In order to attempt compression, length must be at least COMPRESS_THRESHOLD,
+     * asymmetric compression must be disabled and the packet's flow must
+     * not be known to carry incompressible data
      */
-    if (buf->len >= COMPRESS_THRESHOLD && (compctx->flags & COMP_F_ALLOW_COMPRESS))
+    if (buf->len >= COMPRESS_THRESHOLD && (compctx->flags & COMP_F_ALLOW_COMPRESS)
+        && comp_adaptive_should_compress(compctx, buf))
     {
         const size_t ps = PAYLOAD_SIZE(frame);
         int zlen_max = ps + COMP_EXTRA_BUFFER(ps);
@@ -299,6 +301,277 @@ lz4v2_decompress(struct buffer *buf, struct buffer work,
     }
 }
 
+/*
+ * Streaming LZ4 ("compress lz4-stream").
+ *
+ * Plain lz4 compresses every packet independently, so small packets --
+ * the bulk of interactive workloads -- pay full dictionary warm-up cost
+ * per packet and compress poorly.  The streaming variant keeps a ring
+ * of recent cleartext on both sides and lets
+ * LZ4_compress_fast_continue() reference packets already sent, which
+ * improves both ratio and speed on runs of small, similar packets.
+ *
+ * Dictionary coherency: the decompressor's ring must exactly mirror the
+ * compressor's, so only packets that were actually sent compressed may
+ * enter the dictionary.  Whenever a packet goes out uncompressed (below
+ * COMPRESS_THRESHOLD, oversized, no savings, or uplink compression
+ * disabled) the sender resets its stream, and the NO_COMPRESS_BYTE_SWAP
+ * prefix tells the receiver to do the same, so both sides resynchronize
+ * on every uncompressed packet.  Compressed packets carry a one-byte
+ * sequence number; a gap (lost or reordered packet on an unreliable
+ * transport) makes the receiver drop compressed packets until the next
+ * uncompressed one re-synchronizes the pair, instead of decompressing
+ * against a stale dictionary.
+ */
+
+/* second prefix byte carries the stream sequence number */
+#define LZ4_STREAM_PREFIX_LEN 2
+
+/*
+ * Largest packet accepted into the stream; bigger packets are sent
+ * uncompressed.  The ring must hold the 64 KB dictionary window plus
+ * one maximum-size packet, and the wrap decision below depends only on
+ * these constants so that both sides wrap at the same offsets.
+ */
+#define LZ4_STREAM_MAX_INPUT 16384
+#define LZ4_STREAM_RING_SIZE (65536 + LZ4_STREAM_MAX_INPUT)
+
+struct lz4_stream_state
+{
+    /* transmit direction */
+    LZ4_stream_t enc;
+    int enc_off;
+    uint8_t tx_seq;
+    char enc_ring[LZ4_STREAM_RING_SIZE];
+
+    /* receive direction */
+    LZ4_streamDecode_t dec;
+    int dec_off;
+    uint8_t rx_seq;
+    bool rx_sync;
+    char dec_ring[LZ4_STREAM_RING_SIZE];
+};
+
+static void
+lz4stream_reset_encoder(struct lz4_stream_state *state)
+{
+    LZ4_resetStream(&state->enc);
+    state->enc_off = 0;
+    state->tx_seq = 0;
+}
+
+static void
+lz4stream_reset_decoder(struct lz4_stream_state *state)
+{
+    LZ4_setStreamDecode(&state->dec, NULL, 0);
+    state->dec_off = 0;
+    state->rx_seq = 0;
+    state->rx_sync = true;
+}
+
+static void
+lz4stream_compress_init(struct compress_context *compctx)
+{
+    msg(D_INIT_MEDIUM, "LZ4 streaming compression initializing");
+    ASSERT(compctx->flags & COMP_F_SWAP);
+    ALLOC_OBJ_CLEAR(compctx->wu.lz4.stream, struct lz4_stream_state);
+    lz4stream_reset_encoder(compctx->wu.lz4.stream);
+    lz4stream_reset_decoder(compctx->wu.lz4.stream);
+}
+
+static void
+lz4stream_compress_uninit(struct compress_context *compctx)
+{
+    free(compctx->wu.lz4.stream);
+    compctx->wu.lz4.stream = NULL;
+}
+
+static void
+lz4stream_compress(struct buffer *buf, struct buffer work,
+                   struct compress_context *compctx,
+                   const struct frame *frame)
+{
+    struct lz4_stream_state *state = compctx->wu.lz4.stream;
+
+    if (buf->len <= 0)
+    {
+        return;
+    }
+
+    if (buf->len >= COMPRESS_THRESHOLD
+        && buf->len <= LZ4_STREAM_MAX_INPUT
+        && (compctx->flags & COMP_F_ALLOW_COMPRESS)
+        && comp_adaptive_should_compress(compctx, buf))
+    {
+        const size_t ps = PAYLOAD_SIZE(frame);
+        int zlen_max = ps + COMP_EXTRA_BUFFER(ps);
+        int zlen;
+        char *src;
+
+        ASSERT(buf_init(&work, FRAME_HEADROOM(frame)));
+        ASSERT(buf_safe(&work, zlen_max));
+
+        if (buf->len > ps)
+        {
+            dmsg(D_COMP_ERRORS, "LZ4 stream compression buffer overflow");
+            buf->len = 0;
+            return;
+        }
+
+        /*
+         * Compress out of the ring so the dictionary window stays at a
+         * stable address across packets.
+         */
+        if (state->enc_off + LZ4_STREAM_MAX_INPUT > LZ4_STREAM_RING_SIZE)
+        {
+            state->enc_off = 0;
+        }
+        src = state->enc_ring + state->enc_off;
+        memcpy(src, BPTR(buf), BLEN(buf));
+
+        zlen = LZ4_compress_fast_continue(&state->enc, src, (char *)BPTR(&work),
+                                          BLEN(buf), zlen_max, 1);
+
+        /* did compression save us anything?  Include the 2 byte header
+         * in the calculation */
+        if (zlen > 0 && zlen + LZ4_STREAM_PREFIX_LEN < buf->len)
+        {
+            ASSERT(buf_safe(&work, zlen));
+            work.len = zlen;
+            state->enc_off += BLEN(buf);
+
+            ASSERT(buf_prepend(&work, LZ4_STREAM_PREFIX_LEN));
+            uint8_t *head = BPTR(&work);
+            head[0] = LZ4_STREAM_COMPRESS_BYTE;
+            head[1] = state->tx_seq++;
+
+            dmsg(D_COMP, "LZ4 stream compress %d -> %d", buf->len, work.len);
+            compctx->pre_compress += buf->len;
+            compctx->post_compress += work.len;
+            *buf = work;
+            return;
+        }
+
+        if (zlen <= 0)
+        {
+            dmsg(D_COMP_ERRORS, "LZ4 stream compression error");
+        }
+
+        /*
+         * The input already entered the encoder history but will never
+         * reach the peer's dictionary, so the stream must restart; the
+         * uncompressed framing below tells the peer to do the same.
+         */
+    }
+
+    /*
+     * Send uncompressed with the usual swap framing.  This doubles as
+     * the stream resynchronization point: both sides drop their
+     * dictionaries, so after a transmission gap the pair recovers at
+     * the next uncompressed packet.
+     */
+    lz4stream_reset_encoder(state);
+    {
+        uint8_t *head = BPTR(buf);
+        uint8_t *tail = BEND(buf);
+        ASSERT(buf_safe(buf, 1));
+        ++buf->len;
+
+        /* move head byte of payload to tail */
+        *tail = *head;
+        *head = NO_COMPRESS_BYTE_SWAP;
+    }
+}
+
+static void
+lz4stream_decompress(struct buffer *buf, struct buffer work,
+                     struct compress_context *compctx,
+                     const struct frame *frame)
+{
+    struct lz4_stream_state *state = compctx->wu.lz4.stream;
+    uint8_t c;          /* flag indicating whether or not our peer compressed */
+
+    if (buf->len <= 0)
+    {
+        return;
+    }
+
+    ASSERT(buf_init(&work, FRAME_HEADROOM(frame)));
+
+    c = *BPTR(buf);
+
+    if (c == LZ4_STREAM_COMPRESS_BYTE) /* packet was compressed */
+    {
+        int ulen;
+        char *dst;
+        uint8_t seq;
+
+        if (buf->len <= LZ4_STREAM_PREFIX_LEN)
+        {
+            buf->len = 0;
+            return;
+        }
+        seq = BPTR(buf)[1];
+        buf_advance(buf, LZ4_STREAM_PREFIX_LEN);
+
+        /*
+         * A lost or reordered compressed packet leaves our dictionary
+         * behind the peer's; decompressing against it would produce
+         * garbage, so drop until the next uncompressed packet resets
+         * both sides.
+         */
+        if (!state->rx_sync || seq != state->rx_seq)
+        {
+            dmsg(D_COMP_ERRORS, "LZ4 stream out of sync (seq %d, expected %d)",
+                 (int)seq, (int)state->rx_seq);
+            state->rx_sync = false;
+            buf->len = 0;
+            return;
+        }
+
+        /* must mirror the compress-side wrap decision exactly */
+        if (state->dec_off + LZ4_STREAM_MAX_INPUT > LZ4_STREAM_RING_SIZE)
+        {
+            state->dec_off = 0;
+        }
+        dst = state->dec_ring + state->dec_off;
+
+        ulen = LZ4_decompress_safe_continue(&state->dec, (const char *)BPTR(buf),
+                                            dst, BLEN(buf), LZ4_STREAM_MAX_INPUT);
+        if (ulen <= 0 || !buf_safe(&work, ulen))
+        {
+            dmsg(D_COMP_ERRORS, "LZ4 stream decompression error: %d", ulen);
+            state->rx_sync = false;
+            buf->len = 0;
+            return;
+        }
+
+        memcpy(BPTR(&work), dst, ulen);
+        work.len = ulen;
+        state->dec_off += ulen;
+        ++state->rx_seq;
+
+        dmsg(D_COMP, "LZ4 stream decompress %d -> %d", buf->len, work.len);
+        compctx->pre_decompress += buf->len;
+        compctx->post_decompress += work.len;
+
+        *buf = work;
+    }
+    else if (c == NO_COMPRESS_BYTE_SWAP) /* packet was not compressed */
+    {
+        /* do unframing/swap and resynchronize the stream */
+        uint8_t *head = BPTR(buf);
+        --buf->len;
+        *head = *BEND(buf);
+        lz4stream_reset_decoder(state);
+    }
+    else
+    {
+        dmsg(D_COMP_ERRORS, "Bad LZ4 stream decompression header byte: %d", c);
+        buf->len = 0;
+    }
+}
+
 const struct compress_alg lz4_alg = {
     "lz4",
     lz4_compress_init,
@@ -315,6 +588,14 @@ const struct compress_alg lz4v2_alg = {
     lz4v2_decompress
 };
 
+const struct compress_alg lz4stream_alg = {
+    "lz4-stream",
+    lz4stream_compress_init,
+    lz4stream_compress_uninit,
+    lz4stream_compress,
+    lz4stream_decompress
+};
+
 #else  /* if defined(ENABLE_LZ4) */
 static void
 dummy(void)
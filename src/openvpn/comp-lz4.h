@@ -31,10 +31,18 @@
 
 extern const struct compress_alg lz4_alg;
 extern const struct compress_alg lz4v2_alg;
+extern const struct compress_alg lz4stream_alg;
+
+/*
+ * Per-direction streaming state for "compress lz4-stream".  Defined in
+ * comp-lz4.c so that comp.h users need not pull in <lz4.h>; allocated
+ * on demand by the lz4-stream compress_init method.
+ */
+struct lz4_stream_state;
 
 struct lz4_workspace
 {
-    int dummy;
+    struct lz4_stream_state *stream;
 };
 
 #endif /* ENABLE_LZ4 */
@@ -33,7 +33,9 @@
 
 #include "comp.h"
 #include "error.h"
+#include "integer.h"
 #include "otime.h"
+#include "proto.h"
 
 #include "memdbg.h"
 
@@ -75,6 +77,12 @@ comp_init(const struct compress_options *opt)
             compctx->flags = opt->flags;
             compctx->alg = lz4v2_alg;
             break;
+
+        case COMP_ALG_LZ4_STREAM:
+            ALLOC_OBJ_CLEAR(compctx, struct compress_context);
+            compctx->flags = opt->flags;
+            compctx->alg = lz4stream_alg;
+            break;
 #endif
     }
     if (compctx)
@@ -98,7 +106,7 @@ compv2_escape_data_ifneeded(struct buffer *buf)
     }
 
     /* Header is 0x50 */
-    ASSERT(buf_prepend(buf, 2));
+    ASSERT(buf_prepend(buf, COMP_V2_PREFIX_LEN));
 
     head = BPTR(buf);
     head[0] = COMP_ALGV2_INDICATOR_BYTE;
@@ -106,6 +114,152 @@ compv2_escape_data_ifneeded(struct buffer *buf)
 }
 
 
+static uint32_t
+comp_adapt_hash(const uint8_t *p, int len, uint32_t h)
+{
+    while (len-- > 0)
+    {
+        h = (h ^ *p++) * 16777619u;
+    }
+    return h;
+}
+
+/*
+ * Hash the (addresses, protocol, ports) tuple of a cleartext packet.
+ * The packet is either a raw IP packet (TUN) or an ethernet frame
+ * (TAP); which one is not known here, so guess from the IP version
+ * nibble.  Returns 0 for packets no flow can be derived from; those
+ * are sampled individually.
+ */
+static uint32_t
+comp_adapt_flow_key(const struct buffer *buf)
+{
+    const uint8_t *data = BPTR(buf);
+    int len = BLEN(buf);
+    int off = 0;
+    uint8_t ver;
+
+    if (len < (int) sizeof(struct openvpn_iphdr))
+    {
+        return 0;
+    }
+    ver = OPENVPN_IPH_GET_VER(data[0]);
+    if (ver != 4 && ver != 6
+        && len >= (int)(sizeof(struct openvpn_ethhdr) + sizeof(struct openvpn_iphdr)))
+    {
+        /* looks like a TAP ethernet frame */
+        off = sizeof(struct openvpn_ethhdr);
+        ver = OPENVPN_IPH_GET_VER(data[off]);
+    }
+
+    if (ver == 4 && len >= off + (int) sizeof(struct openvpn_iphdr))
+    {
+        const struct openvpn_iphdr *ip = (const struct openvpn_iphdr *)(data + off);
+        const int hlen = OPENVPN_IPH_GET_LEN(ip->version_len);
+        uint32_t h = comp_adapt_hash((const uint8_t *)&ip->saddr, 8, 2166136261u);
+        h = comp_adapt_hash(&ip->protocol, 1, h);
+        if ((ip->protocol == OPENVPN_IPPROTO_TCP || ip->protocol == OPENVPN_IPPROTO_UDP)
+            && len >= off + hlen + 4)
+        {
+            /* source and destination port */
+            h = comp_adapt_hash(data + off + hlen, 4, h);
+        }
+        return h ? h : 1;
+    }
+    else if (ver == 6 && len >= off + (int) sizeof(struct openvpn_ipv6hdr))
+    {
+        const struct openvpn_ipv6hdr *ip6 = (const struct openvpn_ipv6hdr *)(data + off);
+        uint32_t h = comp_adapt_hash((const uint8_t *)&ip6->saddr, 32, 2166136261u);
+        h = comp_adapt_hash(&ip6->nexthdr, 1, h);
+        if ((ip6->nexthdr == OPENVPN_IPPROTO_TCP || ip6->nexthdr == OPENVPN_IPPROTO_UDP)
+            && len >= off + (int) sizeof(struct openvpn_ipv6hdr) + 4)
+        {
+            h = comp_adapt_hash(data + off + sizeof(struct openvpn_ipv6hdr), 4, h);
+        }
+        return h ? h : 1;
+    }
+    return 0;
+}
+
+/*
+ * Estimate whether a packet is worth compressing by counting distinct
+ * byte values in a sample taken from the packet tail, past the
+ * low-entropy L3/L4 headers.  Uniformly random 64-byte samples average
+ * about 56 distinct values while compressible payloads rarely exceed
+ * 40, so the cut at n - n/6 (54 for a full sample) separates the two
+ * populations cleanly.  The seen-table uses a generation counter so it
+ * is not cleared between samples.
+ */
+static bool
+comp_adapt_sample_high_entropy(struct compress_context *compctx,
+                               const struct buffer *buf)
+{
+    const int n = min_int(BLEN(buf), COMP_ADAPT_SAMPLE_LEN);
+    const uint8_t *p = BEND(buf) - n;
+    int distinct = 0;
+
+    if (++compctx->adapt_gen == 0)
+    {
+        CLEAR(compctx->adapt_seen);
+        compctx->adapt_gen = 1;
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        if (compctx->adapt_seen[p[i]] != compctx->adapt_gen)
+        {
+            compctx->adapt_seen[p[i]] = compctx->adapt_gen;
+            ++distinct;
+        }
+    }
+    return distinct >= n - n/6;
+}
+
+bool
+comp_adaptive_should_compress(struct compress_context *compctx,
+                              const struct buffer *buf)
+{
+    const uint32_t key = comp_adapt_flow_key(buf);
+    struct comp_adapt_flow *flow = NULL;
+    bool skip;
+
+    if (key)
+    {
+        flow = &compctx->adapt_flows[key & (COMP_ADAPT_N_FLOWS - 1)];
+        if (flow->key == key)
+        {
+            ++flow->n_seen;
+            if (flow->n_seen % COMP_ADAPT_RECHECK != 0)
+            {
+                /* cached verdict; re-sampled periodically below so a
+                 * flow that changes nature is picked up again */
+                if (flow->skip)
+                {
+                    compctx->adapt_skip_bytes += buf->len;
+                    return false;
+                }
+                return true;
+            }
+        }
+        else
+        {
+            /* direct-mapped: a new flow simply takes over the slot */
+            flow->key = key;
+            flow->n_seen = 1;
+        }
+    }
+
+    skip = comp_adapt_sample_high_entropy(compctx, buf);
+    if (flow)
+    {
+        flow->skip = skip;
+    }
+    if (skip)
+    {
+        compctx->adapt_skip_bytes += buf->len;
+    }
+    return !skip;
+}
+
 void
 comp_uninit(struct compress_context *compctx)
 {
@@ -119,8 +273,14 @@ comp_uninit(struct compress_context *compctx)
 void
 comp_add_to_extra_frame(struct frame *frame)
 {
-    /* Leave room for our one-byte compressed/didn't-compress prefix byte. */
-    frame_add_to_extra_frame(frame, COMP_PREFIX_LEN);
+    /*
+     * Leave room for the compression prefix in pre-reserved headroom.
+     * The two-byte v2 escape header is the worst case; reserving it
+     * here guarantees that the buf_prepend() calls in the v2 framing
+     * always succeed as pure pointer arithmetic, so the common
+     * no-compression stub-v2 path never copies or moves payload.
+     */
+    frame_add_to_extra_frame(frame, COMP_V2_PREFIX_LEN);
 }
 
 void
@@ -140,6 +300,7 @@ comp_print_stats(const struct compress_context *compctx, struct status_output *s
         status_printf(so, "post-compress bytes," counter_format, compctx->post_compress);
         status_printf(so, "pre-decompress bytes," counter_format, compctx->pre_decompress);
         status_printf(so, "post-decompress bytes," counter_format, compctx->post_decompress);
+        status_printf(so, "adaptive-skip bytes," counter_format, compctx->adapt_skip_bytes);
     }
 }
 
@@ -157,6 +318,7 @@ comp_generate_peer_info_string(const struct compress_options *opt, struct buffer
 #if defined(ENABLE_LZ4)
             buf_printf(out, "IV_LZ4=1\n");
             buf_printf(out, "IV_LZ4v2=1\n");
+            buf_printf(out, "IV_LZ4_STREAM=1\n");
 #endif
 #if defined(ENABLE_LZO)
             buf_printf(out, "IV_LZO=1\n");
@@ -41,6 +41,7 @@
 #define COMP_ALG_LZO    2 /* LZO algorithm */
 #define COMP_ALG_SNAPPY 3 /* Snappy algorithm (no longer supported) */
 #define COMP_ALG_LZ4    4 /* LZ4 algorithm */
+#define COMP_ALG_LZ4_STREAM 5 /* LZ4 with persistent inter-packet dictionary */
 
 
 /* algorithm v2 */
@@ -65,6 +66,13 @@
  */
 #define COMP_PREFIX_LEN 1
 
+/*
+ * Length of the prepended v2 header: one indicator byte plus one
+ * algorithm byte.  Also the worst case for escaping cleartext that
+ * happens to start with the indicator byte.
+ */
+#define COMP_V2_PREFIX_LEN 2
+
 /*
  * Prefix bytes
  */
@@ -73,6 +81,7 @@
 /* Initial command byte to tell our peer if we compressed */
 #define LZO_COMPRESS_BYTE 0x66
 #define LZ4_COMPRESS_BYTE 0x69
+#define LZ4_STREAM_COMPRESS_BYTE 0x6A
 #define NO_COMPRESS_BYTE      0xFA
 #define NO_COMPRESS_BYTE_SWAP 0xFB /* to maintain payload alignment, replace this byte with last byte of packet */
 
@@ -97,6 +106,28 @@
  */
 #define COMPRESS_THRESHOLD 100
 
+/*
+ * Adaptive per-flow compression bypass.
+ *
+ * Attempting to compress traffic that is already compressed or
+ * encrypted (TLS, video streams, ...) costs a full compressor pass per
+ * packet and never saves anything.  Each packet's entropy is estimated
+ * by counting distinct byte values in a small payload sample, and the
+ * verdict is remembered per flow in a direct-mapped cache so that
+ * subsequent packets of an incompressible flow bypass the compressor
+ * without even being sampled.
+ */
+#define COMP_ADAPT_N_FLOWS 256  /* flow cache slots, must be a power of 2 */
+#define COMP_ADAPT_SAMPLE_LEN 64  /* payload bytes sampled for the entropy estimate */
+#define COMP_ADAPT_RECHECK 64   /* re-sample a cached flow every n packets */
+
+struct comp_adapt_flow
+{
+    uint32_t key;               /* flow tuple hash, 0 if slot is empty */
+    uint16_t n_seen;
+    bool skip;
+};
+
 /* Forward declaration of compression context */
 struct compress_context;
 
@@ -160,11 +191,17 @@ struct compress_context
     struct compress_alg alg;
     union compress_workspace_union wu;
 
+    /* adaptive per-flow bypass state */
+    struct comp_adapt_flow adapt_flows[COMP_ADAPT_N_FLOWS];
+    uint8_t adapt_seen[256];
+    uint8_t adapt_gen;
+
     /* statistics */
     counter_type pre_decompress;
     counter_type post_decompress;
     counter_type pre_compress;
     counter_type post_compress;
+    counter_type adapt_skip_bytes;
 };
 
 extern const struct compress_alg comp_stub_alg;
@@ -184,6 +221,9 @@ void comp_generate_peer_info_string(const struct compress_options *opt, struct b
 
 void compv2_escape_data_ifneeded(struct buffer *buf);
 
+bool comp_adaptive_should_compress(struct compress_context *compctx,
+                                   const struct buffer *buf);
+
 static inline bool
 comp_enabled(const struct compress_options *info)
 {
@@ -168,6 +168,12 @@ struct key_ctx
     uint8_t implicit_iv[OPENVPN_MAX_IV_LENGTH];
     /**< The implicit part of the IV */
     size_t implicit_iv_len;     /**< The length of implicit_iv */
+
+    /* cached cipher properties, so the packet hot path does not have to
+     * query the crypto library for invariants on every packet */
+    bool aead;                  /**< Cipher is in an AEAD mode */
+    int iv_len;                 /**< Cipher IV length */
+    int tag_size;               /**< AEAD authentication tag size */
 };
 
 #define KEY_DIRECTION_BIDIRECTIONAL 0 /* same keys for both directions */
@@ -258,6 +264,17 @@ struct crypto_options
     /**< Bit-flag indicating that data channel key derivation
      * is done using TLS keying material export [RFC5705]
      */
+#define CO_PACKET_ID_64         (1<<4)
+    /**< Bit-flag indicating that the 64-bit packet ID format
+     * is used on the wire (negotiated, AEAD ciphers only), so
+     * the counter never forces a mid-transfer renegotiation.
+     */
+#define CO_USE_HKDF_KEY_EXPANSION  (1<<5)
+    /**< Bit-flag indicating that data channel key expansion
+     * uses HKDF-SHA256 [RFC5869] instead of the TLS 1.0 PRF
+     * (negotiated; a single keyed HMAC pass per output block
+     * instead of the PRF's double MD5+SHA1 construction).
+     */
     unsigned int flags;         /**< Bit-flags determining behavior of
                                  *   security operation functions. */
 };
@@ -326,6 +343,26 @@ void init_key_ctx_bi(struct key_ctx_bi *ctx, const struct key2 *key2,
 
 void free_key_ctx_bi(struct key_ctx_bi *ctx);
 
+/**
+ * Take an HMAC context from the freelist, or allocate a fresh one.
+ * The context is uninitialized; pass it to \c hmac_ctx_init() as
+ * usual.  Main thread only.
+ */
+hmac_ctx_t *hmac_ctx_get(void);
+
+/**
+ * Return an HMAC context to the freelist (or free it when the list is
+ * full).  The caller must have called \c hmac_ctx_cleanup() first,
+ * exactly as before \c hmac_ctx_free().
+ */
+void hmac_ctx_put(hmac_ctx_t *ctx);
+
+/** Digest context counterpart of \c hmac_ctx_get(). */
+md_ctx_t *md_ctx_get(void);
+
+/** Digest context counterpart of \c hmac_ctx_put(). */
+void md_ctx_put(md_ctx_t *ctx);
+
 
 /**************************************************************************/
 /** @name Functions for performing security operations on data channel packets
@@ -503,6 +540,10 @@ void print_cipher(const cipher_kt_t *cipher);
 
 void test_crypto(struct crypto_options *co, struct frame *f);
 
+/** Timed variant of the crypto self-test (--test-crypto-perf). */
+void test_crypto_perf(struct crypto_options *co, struct frame *f,
+                      int iterations);
+
 
 /* key direction functions */
 
@@ -100,6 +100,13 @@ const char *translate_cipher_name_from_openvpn(const char *cipher_name);
  */
 const char *translate_cipher_name_from_openvpn(const char *cipher_name);
 
+/**
+ * Returns whether the CPU we are running on has hardware AES support
+ * (e.g. AES-NI).  Used to pick a sensible ordering for the default
+ * data channel cipher list.
+ */
+bool cipher_aes_hw_accelerated(void);
+
 void show_available_ciphers(void);
 
 void show_available_digests(void);
@@ -363,6 +370,22 @@ void cipher_ctx_free(cipher_ctx_t *ctx);
 void cipher_ctx_init(cipher_ctx_t *ctx, const uint8_t *key, int key_len,
                      const cipher_kt_t *kt, int enc);
 
+/**
+ * Load a new key into an already-initialised cipher context, keeping the
+ * context's allocated state (e.g. the AES key schedule memory) in place.
+ * The context must previously have been initialised for the same cipher
+ * and direction.
+ *
+ * @param ctx           Cipher context. May not be NULL
+ * @param key           Buffer containing the key to use
+ * @param key_len       Length of the key, in bytes
+ * @param kt            Static cipher parameters to use
+ * @param enc           Whether to encrypt or decrypt (either
+ *                      \c MBEDTLS_OP_ENCRYPT or \c MBEDTLS_OP_DECRYPT).
+ */
+void cipher_ctx_rekey(cipher_ctx_t *ctx, const uint8_t *key, int key_len,
+                      const cipher_kt_t *kt, int enc);
+
 /**
  * Returns the size of the IV used by the cipher, in bytes, or 0 if no IV is
  * used.
@@ -483,6 +506,23 @@ int cipher_ctx_final(cipher_ctx_t *ctx, uint8_t *dst, int *dst_len);
 int cipher_ctx_final_check_tag(cipher_ctx_t *ctx, uint8_t *dst, int *dst_len,
                                uint8_t *tag, size_t tag_len);
 
+/**
+ * Like \c cipher_ctx_final, but additionally write the computed
+ * authentication tag to its final position.  Combining both steps lets
+ * AEAD encryption produce the finished wire layout scatter-gather style,
+ * without a separate tag copy afterwards.
+ *
+ * @param ctx           Cipher's context. May not be NULL.
+ * @param dst           Destination buffer.
+ * @param dst_len       Length of the destination buffer, in bytes.
+ * @param tag           Position to write the authentication tag to.
+ * @param tag_len       The length of the tag, in bytes.
+ *
+ * @return              \c 0 on failure, \c 1 on success.
+ */
+int cipher_ctx_final_write_tag(cipher_ctx_t *ctx, uint8_t *dst, int *dst_len,
+                               uint8_t *tag, int tag_len);
+
 
 /*
  *
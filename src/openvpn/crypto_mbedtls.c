@@ -622,6 +622,23 @@ cipher_ctx_init(mbedtls_cipher_context_t *ctx, const uint8_t *key, int key_len,
     ASSERT(ctx->key_bitlen <= key_len*8);
 }
 
+void
+cipher_ctx_rekey(mbedtls_cipher_context_t *ctx, const uint8_t *key, int key_len,
+                 const mbedtls_cipher_info_t *kt, const mbedtls_operation_t operation)
+{
+    ASSERT(NULL != kt && NULL != ctx);
+    ASSERT(cipher_ctx_get_cipher_kt(ctx) == kt);
+
+    /* the context keeps its cipher setup; only the key is replaced */
+    if (!mbed_ok(mbedtls_cipher_setkey(ctx, key, key_len*8, operation)))
+    {
+        msg(M_FATAL, "mbed TLS cipher set key");
+    }
+
+    /* make sure we used a big enough key */
+    ASSERT(ctx->key_bitlen <= key_len*8);
+}
+
 int
 cipher_ctx_iv_length(const mbedtls_cipher_context_t *ctx)
 {
@@ -765,6 +782,18 @@ cipher_ctx_final_check_tag(mbedtls_cipher_context_t *ctx, uint8_t *dst,
     return 1;
 }
 
+int
+cipher_ctx_final_write_tag(mbedtls_cipher_context_t *ctx, uint8_t *dst,
+                           int *dst_len, uint8_t *tag, int tag_len)
+{
+    if (!cipher_ctx_final(ctx, dst, dst_len))
+    {
+        return 0;
+    }
+
+    return cipher_ctx_get_tag(ctx, tag, tag_len);
+}
+
 void
 cipher_des_encrypt_ecb(const unsigned char key[DES_KEY_LENGTH],
                        unsigned char *src,
@@ -965,23 +994,4 @@ hmac_ctx_final(mbedtls_md_context_t *ctx, uint8_t *dst)
     ASSERT(0 == mbedtls_md_hmac_finish(ctx, dst));
 }
 
-int
-memcmp_constant_time(const void *a, const void *b, size_t size)
-{
-    /* mbed TLS has a no const time memcmp function that it exposes
-     * via its APIs like OpenSSL does with CRYPTO_memcmp
-     * Adapt the function that mbedtls itself uses in
-     * mbedtls_safer_memcmp as it considers that to be safe */
-    volatile const unsigned char *A = (volatile const unsigned char *) a;
-    volatile const unsigned char *B = (volatile const unsigned char *) b;
-    volatile unsigned char diff = 0;
-
-    for (size_t i = 0; i < size; i++)
-    {
-        unsigned char x = A[i], y = B[i];
-        diff |= x ^ y;
-    }
-
-    return diff;
-}
 #endif /* ENABLE_CRYPTO_MBEDTLS */
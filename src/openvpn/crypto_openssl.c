@@ -787,6 +787,31 @@ cipher_ctx_init(EVP_CIPHER_CTX *ctx, const uint8_t *key, int key_len,
     ASSERT(EVP_CIPHER_CTX_key_length(ctx) <= key_len);
 }
 
+void
+cipher_ctx_rekey(EVP_CIPHER_CTX *ctx, const uint8_t *key, int key_len,
+                 const EVP_CIPHER *kt, int enc)
+{
+    ASSERT(NULL != kt && NULL != ctx);
+    ASSERT(cipher_ctx_get_cipher_kt(ctx) == kt);
+
+#ifdef HAVE_EVP_CIPHER_CTX_SET_KEY_LENGTH
+    if (!EVP_CIPHER_CTX_set_key_length(ctx, key_len))
+    {
+        crypto_msg(M_FATAL, "EVP set key size");
+    }
+#endif
+    /* no EVP_CIPHER_CTX_reset() here: with an unchanged cipher,
+     * EVP_CipherInit_ex() reuses the allocated cipher data and only
+     * recomputes the key schedule */
+    if (!EVP_CipherInit_ex(ctx, NULL, NULL, key, NULL, enc))
+    {
+        crypto_msg(M_FATAL, "EVP cipher rekey");
+    }
+
+    /* make sure we used a big enough key */
+    ASSERT(EVP_CIPHER_CTX_key_length(ctx) <= key_len);
+}
+
 int
 cipher_ctx_iv_length(const EVP_CIPHER_CTX *ctx)
 {
@@ -865,6 +890,18 @@ cipher_ctx_final_check_tag(EVP_CIPHER_CTX *ctx, uint8_t *dst, int *dst_len,
     return cipher_ctx_final(ctx, dst, dst_len);
 }
 
+int
+cipher_ctx_final_write_tag(EVP_CIPHER_CTX *ctx, uint8_t *dst, int *dst_len,
+                           uint8_t *tag, int tag_len)
+{
+    if (!cipher_ctx_final(ctx, dst, dst_len))
+    {
+        return 0;
+    }
+
+    return EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, tag_len, tag);
+}
+
 void
 cipher_des_encrypt_ecb(const unsigned char key[DES_KEY_LENGTH],
                        unsigned char *src,
@@ -1049,12 +1086,6 @@ hmac_ctx_final(HMAC_CTX *ctx, uint8_t *dst)
     HMAC_Final(ctx, dst, &in_hmac_len);
 }
 
-int
-memcmp_constant_time(const void *a, const void *b, size_t size)
-{
-    return CRYPTO_memcmp(a, b, size);
-}
-
 #if HAVE_OPENSSL_ENGINE
 static int
 ui_reader(UI *ui, UI_STRING *uis)
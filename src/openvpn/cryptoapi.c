@@ -305,6 +305,123 @@ err_put_ms_error(DWORD ms_err, int func, const char *file, int line)
     }
 }
 
+#ifdef SSL_MODE_ASYNC
+
+#include <openssl/async.h>
+#include <process.h>
+
+/*
+ * Asynchronous signing support.
+ *
+ * With --tls-async the SSL object runs in SSL_MODE_ASYNC and the key
+ * method callbacks below execute inside an ASYNC_JOB.  TPM-backed keys
+ * take 100-300 ms per NCryptSignHash() call, which would otherwise
+ * stall the event thread for the whole renegotiation.  The call is
+ * pushed to a short-lived worker thread, the job is paused with its
+ * wait handle set to a completion event, and the handshake pump
+ * resumes the job from the event loop once the signature is ready.
+ */
+struct cng_sign_job {
+    NCRYPT_KEY_HANDLE hkey;
+    void *padinfo;
+    BYTE *from;
+    DWORD flen;
+    BYTE *to;
+    DWORD tlen;
+    DWORD padding;
+    DWORD len;
+    SECURITY_STATUS status;
+    HANDLE done_event;
+};
+
+static unsigned __stdcall
+cng_sign_thread(void *arg)
+{
+    struct cng_sign_job *job = arg;
+    job->status = NCryptSignHash(job->hkey, job->padinfo, job->from, job->flen,
+                                 job->to, job->tlen, &job->len, job->padding);
+    SetEvent(job->done_event);
+    return 0;
+}
+
+static void
+cng_sign_wait_fd_cleanup(ASYNC_WAIT_CTX *ctx, const void *key,
+                         OSSL_ASYNC_FD fd, void *custom)
+{
+    /* the event handle is owned and closed by cng_sign_hash() */
+}
+
+#endif /* SSL_MODE_ASYNC */
+
+/*
+ * NCryptSignHash() wrapper: when running inside an ASYNC_JOB the
+ * operation is handed to a worker thread and the job is paused until
+ * the signature completes; otherwise (or if the offload cannot be set
+ * up) the hash is signed synchronously.
+ */
+static SECURITY_STATUS
+cng_sign_hash(NCRYPT_KEY_HANDLE hkey, void *padinfo, const unsigned char *from,
+              int flen, unsigned char *to, int tlen, DWORD *len, DWORD padding)
+{
+#ifdef SSL_MODE_ASYNC
+    ASYNC_JOB *async_job = ASYNC_get_current_job();
+
+    if (async_job && to)
+    {
+        static const char wait_fd_key; /* address serves as unique key */
+        struct cng_sign_job job = {
+            .hkey = hkey,
+            .padinfo = padinfo,
+            .from = (BYTE *)from,
+            .flen = (DWORD)flen,
+            .to = to,
+            .tlen = (DWORD)tlen,
+            .padding = padding,
+        };
+        ASYNC_WAIT_CTX *waitctx = ASYNC_get_wait_ctx(async_job);
+        HANDLE thread = NULL;
+
+        job.done_event = CreateEvent(NULL, TRUE, FALSE, NULL);
+        if (job.done_event)
+        {
+            thread = (HANDLE)_beginthreadex(NULL, 0, cng_sign_thread,
+                                            &job, 0, NULL);
+        }
+
+        if (thread && waitctx
+            && ASYNC_WAIT_CTX_set_wait_fd(waitctx, &wait_fd_key,
+                                          (OSSL_ASYNC_FD)job.done_event,
+                                          NULL, cng_sign_wait_fd_cleanup))
+        {
+            do
+            {
+                ASYNC_pause_job();
+            } while (WaitForSingleObject(job.done_event, 0) != WAIT_OBJECT_0);
+            ASYNC_WAIT_CTX_clear_fd(waitctx, &wait_fd_key);
+        }
+
+        if (thread)
+        {
+            /* already signaled unless the wait-fd setup failed */
+            WaitForSingleObject(thread, INFINITE);
+            CloseHandle(thread);
+            CloseHandle(job.done_event);
+            *len = job.len;
+            return job.status;
+        }
+
+        if (job.done_event)
+        {
+            CloseHandle(job.done_event);
+        }
+        /* offload setup failed -- fall through to the synchronous path */
+    }
+#endif /* SSL_MODE_ASYNC */
+
+    return NCryptSignHash(hkey, padinfo, (BYTE *)from, flen, to, tlen,
+                          len, padding);
+}
+
 /* encrypt */
 static int
 rsa_pub_enc(int flen, const unsigned char *from, unsigned char *to, RSA *rsa, int padding)
@@ -352,14 +469,14 @@ priv_enc_CNG(const CAPI_DATA *cd, const wchar_t *hash_algo, const unsigned char
     if (padding == BCRYPT_PAD_PKCS1)
     {
         BCRYPT_PKCS1_PADDING_INFO padinfo = {hash_algo};
-        status = NCryptSignHash(hkey, &padinfo, (BYTE *)from, flen,
-                                to, tlen, &len, padding);
+        status = cng_sign_hash(hkey, &padinfo, from, flen,
+                               to, tlen, &len, padding);
     }
     else if (padding == BCRYPT_PAD_PSS)
     {
         BCRYPT_PSS_PADDING_INFO padinfo = {hash_algo, saltlen};
-        status = NCryptSignHash(hkey, &padinfo, (BYTE *)from, flen,
-                                to, tlen, &len, padding);
+        status = cng_sign_hash(hkey, &padinfo, from, flen,
+                               to, tlen, &len, padding);
     }
     else
     {
@@ -609,7 +726,7 @@ ecdsa_sign_sig(const unsigned char *dgst, int dgstlen,
 
     msg(D_LOW, "Cryptoapi: signing hash using EC key: data size = %d", dgstlen);
 
-    DWORD status = NCryptSignHash(hkey, NULL, (BYTE *)dgst, dgstlen, (BYTE *)buf, len, &len, 0);
+    DWORD status = cng_sign_hash(hkey, NULL, dgst, dgstlen, buf, len, &len, 0);
     if (status != ERROR_SUCCESS)
     {
         SetLastError(status);
@@ -0,0 +1,490 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#ifdef TARGET_LINUX
+
+#include "syshead.h"
+
+#include "errlevel.h"
+#include "buffer.h"
+#include "crypto.h"
+#include "dco_linux.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+
+/*
+ * Generic netlink ABI of the offload module, mirrored locally like the
+ * rtnetlink definitions in networking_sitnl.c.  An older toolchain only
+ * needs <linux/genetlink.h>; the module's own uapi header is not
+ * required to build.
+ */
+#define OVPN_DCO_FAMILY_NAME "ovpn-dco"
+
+enum ovpn_dco_cmd {
+    OVPN_CMD_UNSPEC = 0,
+    OVPN_CMD_ATTACH_SOCKET,
+    OVPN_CMD_NEW_PEER,
+    OVPN_CMD_DEL_PEER,
+    OVPN_CMD_NEW_KEY,
+    OVPN_CMD_SWAP_KEYS,
+    OVPN_CMD_DEL_KEY,
+};
+
+enum ovpn_dco_attr {
+    OVPN_ATTR_UNSPEC = 0,
+    OVPN_ATTR_SOCKET_FD,        /* u32: transport socket to take over */
+    OVPN_ATTR_PEER_ID,          /* u32 */
+    OVPN_ATTR_REMOTE_ADDR,      /* struct sockaddr_in/_in6 */
+    OVPN_ATTR_KEY_ID,           /* u8: OpenVPN wire key-id (0..7) */
+    OVPN_ATTR_CIPHER_ALG,       /* NUL-terminated cipher name */
+    OVPN_ATTR_ENCRYPT_KEY,      /* cipher key, outgoing direction */
+    OVPN_ATTR_ENCRYPT_NONCE_TAIL, /* implicit-IV tail, outgoing */
+    OVPN_ATTR_DECRYPT_KEY,      /* cipher key, incoming direction */
+    OVPN_ATTR_DECRYPT_NONCE_TAIL, /* implicit-IV tail, incoming */
+};
+
+/* bytes of HMAC material used as the AEAD implicit-IV tail, matching
+ * key_ctx_update_implicit_iv() */
+#define OVPN_NONCE_TAIL_LEN 8
+
+struct dco_req {
+    struct nlmsghdr n;
+    struct genlmsghdr g;
+    char buf[512];
+};
+
+#define DCO_ADDATTR(_msg, _max_size, _attr, _data, _size)        \
+    {                                                            \
+        if (dco_addattr(_msg, _max_size, _attr, _data, _size) < 0) \
+        {                                                        \
+            goto err;                                            \
+        }                                                        \
+    }
+
+#define DCO_NLMSG_TAIL(nmsg) \
+    ((struct nlattr *)(((uint8_t *)(nmsg)) + NLMSG_ALIGN((nmsg)->nlmsg_len)))
+
+/**
+ * Helper function used to easily add attributes to a genl message
+ */
+static int
+dco_addattr(struct nlmsghdr *n, int maxlen, int type, const void *data,
+            int alen)
+{
+    int len = NLA_HDRLEN + alen;
+    struct nlattr *nla;
+
+    if ((int)(NLMSG_ALIGN(n->nlmsg_len) + NLMSG_ALIGN(len)) > maxlen)
+    {
+        msg(M_WARN, "%s: genl: message exceeded bound of %d", __func__,
+            maxlen);
+        return -EMSGSIZE;
+    }
+
+    nla = DCO_NLMSG_TAIL(n);
+    nla->nla_type = type;
+    nla->nla_len = len;
+
+    if (alen)
+    {
+        memcpy((uint8_t *)nla + NLA_HDRLEN, data, alen);
+    }
+
+    n->nlmsg_len = NLMSG_ALIGN(n->nlmsg_len) + NLMSG_ALIGN(len);
+
+    return 0;
+}
+
+static void
+dco_req_init(struct dco_req *req, uint16_t family, uint8_t cmd)
+{
+    CLEAR(*req);
+    req->n.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    req->n.nlmsg_type = family;
+    req->n.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+    req->g.cmd = cmd;
+    req->g.version = 1;
+}
+
+/**
+ * Send a genl request on the offload control socket and wait for the
+ * kernel ACK.  Returns 0 on success or the negative kernel errno.
+ */
+static int
+dco_send(struct dco_context *dco, struct dco_req *req)
+{
+    char buf[1024];
+    ssize_t len;
+
+    req->n.nlmsg_seq = ++dco->seq;
+
+    len = send(dco->sd, &req->n, req->n.nlmsg_len, 0);
+    if (len != (ssize_t)req->n.nlmsg_len)
+    {
+        msg(M_WARN | M_ERRNO, "%s: genl: error on send()", __func__);
+        return -errno;
+    }
+
+    while (1)
+    {
+        struct nlmsghdr *h;
+
+        len = recv(dco->sd, buf, sizeof(buf), 0);
+        if (len < 0)
+        {
+            if (errno == EINTR || errno == EAGAIN)
+            {
+                continue;
+            }
+            msg(M_WARN | M_ERRNO, "%s: genl: error on recv()", __func__);
+            return -errno;
+        }
+
+        for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, (size_t)len);
+             h = NLMSG_NEXT(h, len))
+        {
+            if (h->nlmsg_seq != req->n.nlmsg_seq)
+            {
+                continue;
+            }
+
+            if (h->nlmsg_type == NLMSG_ERROR)
+            {
+                const struct nlmsgerr *err = NLMSG_DATA(h);
+
+                if (h->nlmsg_len < NLMSG_LENGTH(sizeof(*err)))
+                {
+                    msg(M_WARN, "%s: genl: truncated error message",
+                        __func__);
+                    return -EINVAL;
+                }
+                return err->error;
+            }
+        }
+    }
+}
+
+/**
+ * Resolve the genl family id of the offload module via the netlink
+ * controller.  Returns 0 when the module is not loaded.
+ */
+static uint16_t
+dco_resolve_family(struct dco_context *dco)
+{
+    struct dco_req req;
+    char buf[1024];
+    ssize_t len;
+    struct nlmsghdr *h;
+
+    dco_req_init(&req, GENL_ID_CTRL, CTRL_CMD_GETFAMILY);
+    req.n.nlmsg_flags = NLM_F_REQUEST;
+    req.n.nlmsg_seq = ++dco->seq;
+
+    if (dco_addattr(&req.n, sizeof(req), CTRL_ATTR_FAMILY_NAME,
+                    OVPN_DCO_FAMILY_NAME, strlen(OVPN_DCO_FAMILY_NAME) + 1) < 0)
+    {
+        return 0;
+    }
+
+    len = send(dco->sd, &req.n, req.n.nlmsg_len, 0);
+    if (len != (ssize_t)req.n.nlmsg_len)
+    {
+        msg(M_WARN | M_ERRNO, "%s: genl: error on send()", __func__);
+        return 0;
+    }
+
+    len = recv(dco->sd, buf, sizeof(buf), 0);
+    if (len < 0)
+    {
+        msg(M_WARN | M_ERRNO, "%s: genl: error on recv()", __func__);
+        return 0;
+    }
+
+    for (h = (struct nlmsghdr *)buf; NLMSG_OK(h, (size_t)len);
+         h = NLMSG_NEXT(h, len))
+    {
+        struct nlattr *nla;
+        int rem;
+
+        if (h->nlmsg_type == NLMSG_ERROR)
+        {
+            /* family not registered: the module is simply not loaded */
+            return 0;
+        }
+
+        nla = (struct nlattr *)((uint8_t *)NLMSG_DATA(h) + GENL_HDRLEN);
+        rem = h->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN);
+
+        while (rem >= NLA_HDRLEN && nla->nla_len >= NLA_HDRLEN
+               && nla->nla_len <= rem)
+        {
+            if ((nla->nla_type & NLA_TYPE_MASK) == CTRL_ATTR_FAMILY_ID)
+            {
+                uint16_t family;
+                memcpy(&family, (uint8_t *)nla + NLA_HDRLEN, sizeof(family));
+                return family;
+            }
+            rem -= NLMSG_ALIGN(nla->nla_len);
+            nla = (struct nlattr *)((uint8_t *)nla
+                                    + NLMSG_ALIGN(nla->nla_len));
+        }
+    }
+
+    return 0;
+}
+
+bool
+dco_init(struct dco_context *dco)
+{
+    struct sockaddr_nl local;
+
+    CLEAR(*dco);
+    dco->sd = -1;
+
+    int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_GENERIC);
+    if (fd < 0)
+    {
+        msg(M_WARN | M_ERRNO, "DCO: cannot open generic netlink socket");
+        return false;
+    }
+
+    CLEAR(local);
+    local.nl_family = AF_NETLINK;
+    if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0)
+    {
+        msg(M_WARN | M_ERRNO, "DCO: cannot bind generic netlink socket");
+        close(fd);
+        return false;
+    }
+
+    dco->sd = fd;
+    dco->family = dco_resolve_family(dco);
+    if (!dco->family)
+    {
+        msg(M_INFO,
+            "DCO: kernel module not available, using userspace data path");
+        dco_uninit(dco);
+        return false;
+    }
+
+    dco->enabled = true;
+    msg(M_INFO, "DCO: kernel data channel offload enabled (genl family %u)",
+        (unsigned int)dco->family);
+    return true;
+}
+
+void
+dco_uninit(struct dco_context *dco)
+{
+    if (dco->sd >= 0)
+    {
+        close(dco->sd);
+        dco->sd = -1;
+    }
+    dco->enabled = false;
+}
+
+bool
+dco_attach_socket(struct dco_context *dco, socket_descriptor_t sd)
+{
+    struct dco_req req;
+    uint32_t fd = (uint32_t)sd;
+    int ret;
+
+    if (!dco_enabled(dco))
+    {
+        return false;
+    }
+
+    dco_req_init(&req, dco->family, OVPN_CMD_ATTACH_SOCKET);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_SOCKET_FD, &fd, sizeof(fd));
+
+    ret = dco_send(dco, &req);
+    if (ret < 0)
+    {
+        msg(M_WARN, "DCO: cannot attach transport socket: %s",
+            strerror(-ret));
+        return false;
+    }
+    return true;
+
+err:
+    return false;
+}
+
+bool
+dco_new_peer(struct dco_context *dco, uint32_t peer_id,
+             const struct sockaddr *remote, socklen_t remote_len)
+{
+    struct dco_req req;
+    int ret;
+
+    if (!dco_enabled(dco))
+    {
+        return false;
+    }
+
+    dco_req_init(&req, dco->family, OVPN_CMD_NEW_PEER);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_PEER_ID, &peer_id,
+                sizeof(peer_id));
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_REMOTE_ADDR, remote,
+                remote_len);
+
+    ret = dco_send(dco, &req);
+    if (ret < 0)
+    {
+        msg(M_WARN, "DCO: cannot add peer %u: %s", (unsigned int)peer_id,
+            strerror(-ret));
+        return false;
+    }
+
+    dmsg(D_CRYPTO_DEBUG, "DCO: added peer %u", (unsigned int)peer_id);
+    return true;
+
+err:
+    return false;
+}
+
+bool
+dco_del_peer(struct dco_context *dco, uint32_t peer_id)
+{
+    struct dco_req req;
+    int ret;
+
+    if (!dco_enabled(dco))
+    {
+        return false;
+    }
+
+    dco_req_init(&req, dco->family, OVPN_CMD_DEL_PEER);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_PEER_ID, &peer_id,
+                sizeof(peer_id));
+
+    ret = dco_send(dco, &req);
+    if (ret < 0 && ret != -ENOENT)
+    {
+        msg(M_WARN, "DCO: cannot remove peer %u: %s", (unsigned int)peer_id,
+            strerror(-ret));
+        return false;
+    }
+    return true;
+
+err:
+    return false;
+}
+
+bool
+dco_install_key(struct dco_context *dco, uint32_t peer_id, int key_id,
+                const struct key_type *kt, const struct key2 *key2,
+                bool server)
+{
+    struct dco_req req;
+    /* same direction mapping as init_key_contexts() */
+    const struct key *enc = &key2->keys[(int)server];
+    const struct key *dec = &key2->keys[1 - (int)server];
+    const char *cipher = cipher_kt_name(kt->cipher);
+    uint8_t kid = (uint8_t)key_id;
+    int ret;
+
+    if (!dco_enabled(dco))
+    {
+        return false;
+    }
+
+    dco_req_init(&req, dco->family, OVPN_CMD_NEW_KEY);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_PEER_ID, &peer_id,
+                sizeof(peer_id));
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_KEY_ID, &kid, sizeof(kid));
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_CIPHER_ALG, cipher,
+                strlen(cipher) + 1);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_ENCRYPT_KEY, enc->cipher,
+                kt->cipher_length);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_ENCRYPT_NONCE_TAIL, enc->hmac,
+                OVPN_NONCE_TAIL_LEN);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_DECRYPT_KEY, dec->cipher,
+                kt->cipher_length);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_DECRYPT_NONCE_TAIL, dec->hmac,
+                OVPN_NONCE_TAIL_LEN);
+
+    ret = dco_send(dco, &req);
+
+    /* the request carried raw key material */
+    secure_memzero(&req, sizeof(req));
+
+    if (ret < 0)
+    {
+        msg(M_WARN, "DCO: cannot install key %d for peer %u: %s", key_id,
+            (unsigned int)peer_id, strerror(-ret));
+        return false;
+    }
+
+    dmsg(D_CRYPTO_DEBUG, "DCO: installed key %d for peer %u", key_id,
+         (unsigned int)peer_id);
+    return true;
+
+err:
+    secure_memzero(&req, sizeof(req));
+    return false;
+}
+
+bool
+dco_swap_keys(struct dco_context *dco, uint32_t peer_id)
+{
+    struct dco_req req;
+    int ret;
+
+    if (!dco_enabled(dco))
+    {
+        return false;
+    }
+
+    dco_req_init(&req, dco->family, OVPN_CMD_SWAP_KEYS);
+    DCO_ADDATTR(&req.n, sizeof(req), OVPN_ATTR_PEER_ID, &peer_id,
+                sizeof(peer_id));
+
+    ret = dco_send(dco, &req);
+    if (ret < 0)
+    {
+        msg(M_WARN, "DCO: cannot swap keys for peer %u: %s",
+            (unsigned int)peer_id, strerror(-ret));
+        return false;
+    }
+    return true;
+
+err:
+    return false;
+}
+
+#endif /* TARGET_LINUX */
@@ -0,0 +1,93 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Kernel data-channel offload (DCO).
+ *
+ * Once a session's data channel keys are negotiated, the established
+ * flow -- AEAD encrypt/decrypt plus UDP send/receive -- no longer needs
+ * userspace at all.  This module programs the negotiated keys and peer
+ * addressing into an "ovpn-dco" style kernel module over generic
+ * netlink, after which the kernel consumes data packets directly and
+ * userspace only sees the control channel.
+ *
+ * The generic netlink ABI is mirrored locally the same way
+ * networking_sitnl.c mirrors rtnetlink.  When the module is not loaded
+ * the family lookup fails and the context disables itself; the
+ * userspace data path is unaffected.
+ */
+
+#ifndef DCO_LINUX_H
+#define DCO_LINUX_H
+
+#if defined(TARGET_LINUX)
+
+#include "basic.h"
+#include "syshead.h"
+
+struct key2;
+struct key_type;
+
+struct dco_context
+{
+    int sd;                 /* generic netlink socket, -1 when unavailable */
+    uint16_t family;        /* resolved genl family id of the module */
+    uint32_t seq;           /* netlink sequence counter */
+    bool enabled;           /* module present and context usable */
+};
+
+/*
+ * Probe for the kernel module and open the control socket.
+ * Returns false (leaving dco->enabled clear) if the module is not
+ * loaded; all other entry points become no-ops in that case.
+ */
+bool dco_init(struct dco_context *dco);
+
+void dco_uninit(struct dco_context *dco);
+
+/* hand the transport socket to the kernel module */
+bool dco_attach_socket(struct dco_context *dco, socket_descriptor_t sd);
+
+/* program a peer's transport address */
+bool dco_new_peer(struct dco_context *dco, uint32_t peer_id,
+                  const struct sockaddr *remote, socklen_t remote_len);
+
+bool dco_del_peer(struct dco_context *dco, uint32_t peer_id);
+
+/* install freshly negotiated data channel key material */
+bool dco_install_key(struct dco_context *dco, uint32_t peer_id, int key_id,
+                     const struct key_type *kt, const struct key2 *key2,
+                     bool server);
+
+/* promote the most recently installed key to the active slot */
+bool dco_swap_keys(struct dco_context *dco, uint32_t peer_id);
+
+static inline bool
+dco_enabled(const struct dco_context *dco)
+{
+    return dco && dco->enabled;
+}
+
+#endif /* TARGET_LINUX */
+
+#endif /* ifndef DCO_LINUX_H */
@@ -92,15 +92,82 @@ env_string_equal(const char *s1, const char *s2)
     return false;
 }
 
+static void
+add_env_item(char *str, const bool do_alloc, struct env_item **list, struct gc_arena *gc)
+{
+    struct env_item *item;
+
+    ASSERT(str);
+    ASSERT(list);
+
+    ALLOC_OBJ_GC(item, struct env_item, gc);
+    item->string = do_alloc ? string_alloc(str, gc) : str;
+    item->envp_idx = -1;
+    item->next = *list;
+    *list = item;
+}
+
+/* struct env_set functions */
+
+/*
+ * Rebuild the cached envp image of the set.  Normally only needed
+ * when the cache outgrows its allocation; single adds, replacements
+ * and deletes patch the existing arrays in place.
+ */
+static void
+env_set_envp_rebuild(struct env_set *es)
+{
+    struct env_item *e;
+    int n = 0;
+
+    for (e = es->list; e != NULL; e = e->next)
+    {
+        ++n;
+    }
+
+    if (n + 1 > es->envp_cap)
+    {
+        int cap = es->envp_cap * 2;
+        if (cap < n + 1)
+        {
+            cap = n + 1;
+        }
+        if (cap < 16)
+        {
+            cap = 16;
+        }
+        if (!es->gc)
+        {
+            free(es->envp);
+            free(es->envp_items);
+        }
+        es->envp = (char **)gc_malloc(cap * sizeof(char *), true, es->gc);
+        es->envp_items = (struct env_item **)
+            gc_malloc(cap * sizeof(struct env_item *), true, es->gc);
+        es->envp_cap = cap;
+    }
+
+    n = 0;
+    for (e = es->list; e != NULL; e = e->next)
+    {
+        es->envp[n] = e->string;
+        es->envp_items[n] = e;
+        e->envp_idx = n;
+        ++n;
+    }
+    es->envp[n] = NULL;
+    es->envp_n = n;
+    es->envp_dirty = false;
+}
+
 static bool
-remove_env_item(const char *str, const bool do_free, struct env_item **list)
+env_set_del_nolock(struct env_set *es, const char *str)
 {
     struct env_item *current, *prev;
 
     ASSERT(str);
-    ASSERT(list);
 
-    for (current = *list, prev = NULL; current != NULL; current = current->next)
+    for (current = es->list, prev = NULL; current != NULL; current = current->next)
     {
         if (env_string_equal(current->string, str))
         {
@@ -110,9 +177,20 @@ remove_env_item(const char *str, const bool do_free, struct env_item **list)
             }
             else
             {
-                *list = current->next;
+                es->list = current->next;
             }
-            if (do_free)
+            if (!es->envp_dirty && es->envp)
+            {
+                /* fill the hole with the last cached entry */
+                const int idx = current->envp_idx;
+                const int last = es->envp_n - 1;
+                es->envp[idx] = es->envp[last];
+                es->envp_items[idx] = es->envp_items[last];
+                es->envp_items[idx]->envp_idx = idx;
+                es->envp[last] = NULL;
+                es->envp_n = last;
+            }
+            if (es->gc == NULL)
             {
                 secure_memzero(current->string, strlen(current->string));
                 free(current->string);
@@ -126,32 +204,46 @@ remove_env_item(const char *str, const bool do_free, struct env_item **list)
 }
 
 static void
-add_env_item(char *str, const bool do_alloc, struct env_item **list, struct gc_arena *gc)
+env_set_add_nolock(struct env_set *es, const char *str)
 {
-    struct env_item *item;
-
-    ASSERT(str);
-    ASSERT(list);
+    struct env_item *item = es->list;
 
-    ALLOC_OBJ_GC(item, struct env_item, gc);
-    item->string = do_alloc ? string_alloc(str, gc) : str;
-    item->next = *list;
-    *list = item;
-}
-
-/* struct env_set functions */
-
-static bool
-env_set_del_nolock(struct env_set *es, const char *str)
-{
-    return remove_env_item(str, es->gc == NULL, &es->list);
-}
+    while (item && !env_string_equal(item->string, str))
+    {
+        item = item->next;
+    }
 
-static void
-env_set_add_nolock(struct env_set *es, const char *str)
-{
-    remove_env_item(str, es->gc == NULL, &es->list);
-    add_env_item((char *)str, true, &es->list, es->gc);
+    if (item)
+    {
+        /* replace the value in place and patch the cached envp slot */
+        if (es->gc == NULL)
+        {
+            secure_memzero(item->string, strlen(item->string));
+            free(item->string);
+        }
+        item->string = string_alloc(str, es->gc);
+        if (!es->envp_dirty && es->envp)
+        {
+            es->envp[item->envp_idx] = item->string;
+        }
+    }
+    else
+    {
+        add_env_item((char *)str, true, &es->list, es->gc);
+        if (!es->envp_dirty && es->envp && es->envp_n + 2 <= es->envp_cap)
+        {
+            const int idx = es->envp_n;
+            es->envp[idx] = es->list->string;
+            es->envp_items[idx] = es->list;
+            es->list->envp_idx = idx;
+            es->envp_n = idx + 1;
+            es->envp[es->envp_n] = NULL;
+        }
+        else
+        {
+            es->envp_dirty = true;
+        }
+    }
 }
 
 struct env_set *
@@ -161,6 +253,7 @@ env_set_create(struct gc_arena *gc)
     ALLOC_OBJ_CLEAR_GC(es, struct env_set, gc);
     es->list = NULL;
     es->gc = gc;
+    es->envp_dirty = true;
     return es;
 }
 
@@ -177,6 +270,8 @@ env_set_destroy(struct env_set *es)
             free(e);
             e = next;
         }
+        free(es->envp);
+        free(es->envp_items);
         free(es);
     }
 }
@@ -419,6 +514,30 @@ env_allowed(const char *str)
 
 /* Make arrays of strings */
 
+/*
+ * True if every item of the set may be passed to an external script,
+ * i.e. the allowed subset is the whole set and the cached envp image
+ * can be used as is.
+ */
+static bool
+env_array_all_allowed(const struct env_set *es)
+{
+    const struct env_item *e;
+
+    if (script_security() >= SSEC_PW_ENV)
+    {
+        return true;
+    }
+    for (e = es->list; e != NULL; e = e->next)
+    {
+        if (!env_allowed(e->string))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 const char **
 make_env_array(const struct env_set *es,
                const bool check_allowed,
@@ -428,6 +547,22 @@ make_env_array(const struct env_set *es,
     struct env_item *e = NULL;
     int i = 0, n = 0;
 
+    if (es)
+    {
+        /* the cache is mutable state behind the const interface */
+        struct env_set *mes = (struct env_set *)es;
+        if (mes->envp_dirty)
+        {
+            env_set_envp_rebuild(mes);
+        }
+        if (!check_allowed || env_array_all_allowed(es))
+        {
+            return (const char **)es->envp;
+        }
+    }
+
+    /* fall back to building a filtered copy in gc */
+
     /* figure length of es */
     if (es)
     {
@@ -36,12 +36,24 @@
 
 struct env_item {
     char *string;
+    int envp_idx;  /* position in the cached envp array, if valid */
     struct env_item *next;
 };
 
 struct env_set {
     struct gc_arena *gc;
     struct env_item *list;
+
+    /*
+     * Cached NULL-terminated envp image of the list, handed out by
+     * make_env_array() and patched in place on add/replace/delete so
+     * that script and plugin calls need not rebuild it each time.
+     */
+    char **envp;
+    struct env_item **envp_items;
+    int envp_n;
+    int envp_cap;
+    bool envp_dirty;
 };
 
 /* set/delete environmental variable */
@@ -97,10 +97,285 @@ static bool forked;         /* GLOBAL */
 static FILE *default_out; /* GLOBAL */
 static FILE *default_err; /* GLOBAL */
 
+/*
+ * Per-callsite token bucket, see msg_rl() in error.h.  Uses the
+ * coarse 'now' clock -- one-second granularity is all the refill
+ * logic needs, and the packet paths this protects must not pay for
+ * a time syscall per message.
+ */
+bool
+msg_rl_test(struct msg_rl_state *rl, const unsigned int flags)
+{
+    if (now > rl->last_refill)
+    {
+        const time_t elapsed = now - rl->last_refill;
+        if (elapsed >= MSG_RL_BURST
+            || rl->tokens + (int) elapsed >= MSG_RL_BURST)
+        {
+            rl->tokens = MSG_RL_BURST;
+        }
+        else
+        {
+            rl->tokens += (int) elapsed; /* one token per second */
+        }
+        rl->last_refill = now;
+    }
+
+    if (rl->tokens <= 0)
+    {
+        ++rl->suppressed;
+        return false;
+    }
+
+    --rl->tokens;
+    if (rl->suppressed)
+    {
+        x_msg(flags & M_DEBUG_LEVEL,
+              "NOTE: %d prior messages from this site suppressed by rate limiting",
+              rl->suppressed);
+        rl->suppressed = 0;
+    }
+    return true;
+}
+
+#ifdef ENABLE_WORKER_THREADS
+
+/*
+ * Deferred log writer.
+ *
+ * Both syslog(3) and file logging perform their I/O synchronously on
+ * the calling thread; at verb 3 a connect storm writes megabytes of
+ * text from the event loop.  When the worker thread infrastructure
+ * is compiled in, messages are instead pushed onto a fixed ring
+ * drained by a dedicated writer thread, which renders the timestamp
+ * and performs the fprintf()/fflush() or syslog() call.
+ *
+ * Argument formatting still happens on the calling thread: format
+ * arguments routinely point into gc arenas that are released as soon
+ * as msg() returns, so raw argument capture (printk_deferred style)
+ * would leave dangling pointers.  Everything after the text exists --
+ * timestamp rendering and the actual I/O -- is deferred.
+ *
+ * When the ring is full the message is dropped and counted; the
+ * writer reports the count on the same target once it catches up.
+ * Fatal messages are never deferred: the caller drains the ring
+ * first so deferred output precedes the final message.
+ */
+
+#define LOG_RING_SIZE    512 /* entries, power of two */
+#define LOG_RING_MSG_MAX 512 /* bytes of formatted text per entry */
+
+struct log_ring_entry
+{
+    FILE *fp;           /* file target, or NULL for syslog */
+    int level;          /* syslog level, when fp == NULL */
+    unsigned int flags;
+    bool show_usec;
+    struct timeval tv;  /* capture time, rendered by the writer */
+    char text[LOG_RING_MSG_MAX];
+};
+
+static struct log_ring_entry log_ring[LOG_RING_SIZE]; /* GLOBAL */
+static unsigned int log_ring_head;    /* GLOBAL -- next slot to fill */
+static unsigned int log_ring_tail;    /* GLOBAL -- next slot to drain */
+static unsigned int log_ring_dropped; /* GLOBAL */
+static bool log_writer_run;           /* GLOBAL */
+static bool log_writer_active;        /* GLOBAL */
+static pthread_t log_writer_thread;   /* GLOBAL */
+static pthread_mutex_t log_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t log_ring_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t log_ring_drained = PTHREAD_COND_INITIALIZER;
+
+static void
+log_ring_entry_write(const struct log_ring_entry *e)
+{
+    if (!e->fp)
+    {
+#if SYSLOG_CAPABILITY
+        syslog(e->level, "%s", e->text);
+#endif
+        return;
+    }
+
+    if (machine_readable_output)
+    {
+        fprintf(e->fp, "%" PRIi64 ".%06ld %x %s\n",
+                (int64_t) e->tv.tv_sec,
+                (long) e->tv.tv_usec,
+                e->flags,
+                e->text);
+    }
+    else if ((e->flags & M_NOPREFIX) || suppress_timestamps)
+    {
+        fprintf(e->fp, "%s%s", e->text, (e->flags & M_NOLF) ? "" : "\n");
+    }
+    else
+    {
+        /* render the timestamp here rather than via time_string() --
+         * gc arenas are not safe off the main thread */
+        struct tm tm_buf;
+        const time_t t = e->tv.tv_sec;
+        char ts[64] = "";
+
+        if (localtime_r(&t, &tm_buf))
+        {
+            strftime(ts, sizeof(ts), "%Y-%m-%d %H:%M:%S", &tm_buf);
+        }
+        if (e->show_usec && e->tv.tv_usec)
+        {
+            fprintf(e->fp, "%s us=%ld %s%s", ts, (long) e->tv.tv_usec,
+                    e->text, (e->flags & M_NOLF) ? "" : "\n");
+        }
+        else
+        {
+            fprintf(e->fp, "%s %s%s", ts,
+                    e->text, (e->flags & M_NOLF) ? "" : "\n");
+        }
+    }
+    fflush(e->fp);
+}
+
+static void *
+log_writer_main(void *arg)
+{
+    pthread_mutex_lock(&log_ring_mutex);
+    while (true)
+    {
+        while (log_ring_tail == log_ring_head && log_writer_run)
+        {
+            pthread_cond_wait(&log_ring_wakeup, &log_ring_mutex);
+        }
+        if (log_ring_tail == log_ring_head)
+        {
+            break; /* drained and told to stop */
+        }
+
+        const struct log_ring_entry e =
+            log_ring[log_ring_tail & (LOG_RING_SIZE - 1)];
+        ++log_ring_tail;
+
+        unsigned int dropped = 0;
+        if (log_ring_tail == log_ring_head && log_ring_dropped)
+        {
+            dropped = log_ring_dropped;
+            log_ring_dropped = 0;
+        }
+
+        /* the I/O itself runs without the lock held */
+        pthread_mutex_unlock(&log_ring_mutex);
+        log_ring_entry_write(&e);
+        if (dropped)
+        {
+            struct log_ring_entry note = e;
+            note.flags &= ~M_NOLF;
+            gettimeofday(&note.tv, NULL);
+            openvpn_snprintf(note.text, sizeof(note.text),
+                             "%u log messages dropped (log ring overflow)",
+                             dropped);
+            log_ring_entry_write(&note);
+        }
+        pthread_mutex_lock(&log_ring_mutex);
+
+        if (log_ring_tail == log_ring_head)
+        {
+            pthread_cond_broadcast(&log_ring_drained);
+        }
+    }
+    pthread_cond_broadcast(&log_ring_drained);
+    pthread_mutex_unlock(&log_ring_mutex);
+    return NULL;
+}
+
+void
+error_log_writer_start(void)
+{
+    if (!log_writer_active && !forked)
+    {
+        log_writer_run = true;
+        if (!pthread_create(&log_writer_thread, NULL, log_writer_main, NULL))
+        {
+            log_writer_active = true;
+        }
+    }
+}
+
+void
+error_log_writer_stop(void)
+{
+    if (log_writer_active)
+    {
+        pthread_mutex_lock(&log_ring_mutex);
+        log_writer_run = false;
+        pthread_cond_signal(&log_ring_wakeup);
+        pthread_mutex_unlock(&log_ring_mutex);
+        pthread_join(log_writer_thread, NULL);
+        log_writer_active = false;
+    }
+}
+
+/*
+ * Wait until the writer has drained the ring.  Used before fatal
+ * messages so deferred output precedes them in the log.
+ */
+static void
+log_deferred_flush(void)
+{
+    if (!log_writer_active || forked)
+    {
+        return;
+    }
+    pthread_mutex_lock(&log_ring_mutex);
+    while (log_ring_tail != log_ring_head)
+    {
+        pthread_cond_wait(&log_ring_drained, &log_ring_mutex);
+    }
+    pthread_mutex_unlock(&log_ring_mutex);
+}
+
+/* returns false if the message must be written synchronously */
+static bool
+log_deferred(FILE *fp, const int level, const unsigned int flags,
+             const bool show_usec, const char *prefix,
+             const char *prefix_sep, const char *m1)
+{
+    if (!log_writer_active || forked || (flags & M_FATAL))
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&log_ring_mutex);
+    if (log_ring_head - log_ring_tail >= LOG_RING_SIZE)
+    {
+        /* full: drop, the writer reports the count when it catches up */
+        ++log_ring_dropped;
+        pthread_mutex_unlock(&log_ring_mutex);
+        return true;
+    }
+
+    struct log_ring_entry *e = &log_ring[log_ring_head & (LOG_RING_SIZE - 1)];
+    e->fp = fp;
+    e->level = level;
+    e->flags = flags;
+    e->show_usec = show_usec;
+    gettimeofday(&e->tv, NULL);
+    openvpn_snprintf(e->text, sizeof(e->text), "%s%s%s",
+                     prefix, prefix_sep, m1);
+    ++log_ring_head;
+    pthread_cond_signal(&log_ring_wakeup);
+    pthread_mutex_unlock(&log_ring_mutex);
+    return true;
+}
+
+#endif /* ENABLE_WORKER_THREADS */
+
 void
 msg_forked(void)
 {
     forked = true;
+#ifdef ENABLE_WORKER_THREADS
+    /* the writer thread does not survive fork() */
+    log_writer_active = false;
+#endif
 }
 
 bool
@@ -324,13 +599,26 @@ x_msg_va(const unsigned int flags, const char *format, va_list arglist)
 
     if (!(flags & M_MSG_VIRT_OUT))
     {
+#ifdef ENABLE_WORKER_THREADS
+        if (flags & M_FATAL)
+        {
+            /* deferred output must precede the fatal message */
+            log_deferred_flush();
+        }
+#endif
         if (use_syslog && !std_redir && !forked)
         {
 #if SYSLOG_CAPABILITY
-            syslog(level, "%s%s%s",
-                   prefix,
-                   prefix_sep,
-                   m1);
+#ifdef ENABLE_WORKER_THREADS
+            if (!log_deferred(NULL, level, flags, false,
+                              prefix, prefix_sep, m1))
+#endif
+            {
+                syslog(level, "%s%s%s",
+                       prefix,
+                       prefix_sep,
+                       m1);
+            }
 #endif
         }
         else
@@ -338,6 +626,14 @@ x_msg_va(const unsigned int flags, const char *format, va_list arglist)
             FILE *fp = msg_fp(flags);
             const bool show_usec = check_debug_level(DEBUG_LEVEL_USEC_TIME);
 
+#ifdef ENABLE_WORKER_THREADS
+            if (log_deferred(fp, 0, flags, show_usec,
+                             prefix, prefix_sep, m1))
+            {
+                ++x_msg_line_num;
+            }
+            else
+#endif
             if (machine_readable_output)
             {
                 struct timeval tv;
@@ -352,6 +648,8 @@ x_msg_va(const unsigned int flags, const char *format, va_list arglist)
                         m1,
                         "\n");
 
+                fflush(fp);
+                ++x_msg_line_num;
             }
             else if ((flags & M_NOPREFIX) || suppress_timestamps)
             {
@@ -360,6 +658,8 @@ x_msg_va(const unsigned int flags, const char *format, va_list arglist)
                         prefix_sep,
                         m1,
                         (flags&M_NOLF) ? "" : "\n");
+                fflush(fp);
+                ++x_msg_line_num;
             }
             else
             {
@@ -369,9 +669,9 @@ x_msg_va(const unsigned int flags, const char *format, va_list arglist)
                         prefix_sep,
                         m1,
                         (flags&M_NOLF) ? "" : "\n");
+                fflush(fp);
+                ++x_msg_line_num;
             }
-            fflush(fp);
-            ++x_msg_line_num;
         }
     }
 
@@ -467,6 +767,9 @@ open_syslog(const char *pgmname, bool stdio_to_null)
             pgmname_syslog = string_alloc(pgmname ? pgmname : PACKAGE, NULL);
             openlog(pgmname_syslog, LOG_PID, LOG_OPENVPN);
             use_syslog = true;
+#ifdef ENABLE_WORKER_THREADS
+            error_log_writer_start();
+#endif
 
             /* Better idea: somehow pipe stdout/stderr output to msg() */
             if (stdio_to_null)
@@ -486,6 +789,9 @@ close_syslog(void)
 #if SYSLOG_CAPABILITY
     if (use_syslog)
     {
+#ifdef ENABLE_WORKER_THREADS
+        error_log_writer_stop(); /* drains the ring before closelog() */
+#endif
         closelog();
         use_syslog = false;
         free(pgmname_syslog);
@@ -676,12 +982,15 @@ x_check_status(int status,
         if (sock)
         {
             int mtu;
-            extended_msg = format_extended_socket_error(sock->sd, &mtu, &gc);
+            int n_unreachable;
+            extended_msg = format_extended_socket_error(sock->sd, &mtu,
+                                                        &n_unreachable, &gc);
             if (mtu > 0 && sock->mtu != mtu)
             {
                 sock->mtu = mtu;
                 sock->info.mtu_changed = true;
             }
+            sock->errq_unreachable += n_unreachable;
         }
 #elif defined(_WIN32)
         /* get possible driver error from TAP-Windows driver */
@@ -735,6 +1044,9 @@ openvpn_exit(const int status)
 {
     if (!forked)
     {
+#ifdef ENABLE_WORKER_THREADS
+        error_log_writer_stop(); /* drain deferred log output */
+#endif
         tun_abort();
 
 #ifdef _WIN32
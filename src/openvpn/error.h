@@ -138,6 +138,17 @@ extern int x_msg_line_num;
 /*
  * If compiler supports variable arguments in macros, define
  * msg() as a macro for optimization win.
+ *
+ * The macro form also establishes a lazy-capture contract that
+ * data-path call sites rely on: argument expressions sit inside the
+ * msg_test() branch and are never evaluated when the verbosity gate
+ * fails, so formatting helpers (print_link_socket_actual(),
+ * mroute_addr_print() and friends, including their gc_arena
+ * allocations) must be written inline in the argument list, not
+ * precomputed into locals before the call.  Where one formatted value
+ * feeds several messages, wrap the whole block in
+ * check_debug_level() -- see multi_get_instance_by_virtual_addr()
+ * for the idiom.
  */
 
 /** Check muting filter */
@@ -174,6 +185,47 @@ bool dont_mute(unsigned int flags);
 #define dmsg x_msg
 #endif /* if defined(HAVE_CPP_VARARG_MACRO_ISO) && !defined(__LCLINT__) */
 
+/*
+ * Per-callsite token bucket rate limiting for messages which can be
+ * triggered at packet rate by a misbehaving peer.  Each msg_rl()
+ * expansion carries its own static bucket: MSG_RL_BURST messages may
+ * be emitted back to back, after which one token is replenished per
+ * second.  When suppressed messages exist, the next emitted message
+ * is preceded by a summary line carrying the suppressed count.
+ */
+#define MSG_RL_BURST 10 /* bucket capacity, in messages */
+
+struct msg_rl_state
+{
+    time_t last_refill;
+    int tokens;
+    int suppressed;
+};
+
+bool msg_rl_test(struct msg_rl_state *rl, unsigned int flags);
+
+#ifdef HAVE_VARARG_MACROS
+#if defined(HAVE_CPP_VARARG_MACRO_ISO) && !defined(__LCLINT__)
+#define msg_rl(flags, ...) \
+    do { \
+        static struct msg_rl_state msg_rl_site = { 0, MSG_RL_BURST, 0 }; \
+        if (msg_test(flags) && msg_rl_test(&msg_rl_site, (flags))) \
+        {x_msg((flags), __VA_ARGS__);} \
+        EXIT_FATAL(flags); \
+    } while (false)
+#else
+#define msg_rl(flags, args ...) \
+    do { \
+        static struct msg_rl_state msg_rl_site = { 0, MSG_RL_BURST, 0 }; \
+        if (msg_test(flags) && msg_rl_test(&msg_rl_site, (flags))) \
+        {x_msg((flags), args);} \
+        EXIT_FATAL(flags); \
+    } while (false)
+#endif
+#else  /* ifdef HAVE_VARARG_MACROS */
+#define msg_rl x_msg
+#endif
+
 void x_msg(const unsigned int flags, const char *format, ...)
 #ifdef __GNUC__
 #if __USE_MINGW_ANSI_STDIO
@@ -257,6 +309,17 @@ msg_test(unsigned int flags)
 /* Call if we forked */
 void msg_forked(void);
 
+#ifdef ENABLE_WORKER_THREADS
+/*
+ * Deferred log writer thread (see error.c).  Start after
+ * daemonization has settled; safe to call when already running.
+ */
+void error_log_writer_start(void);
+
+void error_log_writer_stop(void);
+
+#endif
+
 /* syslog output */
 
 void open_syslog(const char *pgmname, bool stdio_to_null);
@@ -664,6 +664,10 @@ ep_init(int *maxevents, unsigned int flags)
     eps->func.ctl = ep_ctl;
     eps->func.wait = ep_wait;
 
+    /* epoll registrations are level-triggered and survive epoll_wait,
+     * so callers may skip ep_ctl when their rwflags are unchanged */
+    eps->func.persistent = true;
+
     /* fast method ("sort of") corresponds to epoll one-shot */
     if (flags & EVENT_METHOD_FAST)
     {
@@ -682,6 +686,461 @@ ep_init(int *maxevents, unsigned int flags)
 }
 #endif /* EPOLL */
 
+#if IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+
+/*
+ * io_uring based event backend (--enable-iouring).
+ *
+ * The event_set abstraction deals in readiness notification, so this
+ * backend drives one-shot IORING_OP_POLL_ADD requests through the
+ * ring.  Unlike the poll/select backends, registrations that did not
+ * fire are left armed in the kernel across waits, so the steady-state
+ * cost per loop iteration is a single io_uring_enter() that submits
+ * only the re-arms for events which actually fired, instead of
+ * copying the full fd set into the kernel every time.
+ */
+
+/* tag bits encoded into sqe user_data alongside slot and generation */
+#define IU_TAG_POLL     0
+#define IU_TAG_TIMEOUT  1
+#define IU_TAG_REMOVE   2
+#define IU_TAG_MASK     3
+
+#define IU_RING_ENTRIES 64
+
+struct iu_fd
+{
+    event_t fd;                  /* -1 if slot is free */
+    void *arg;
+    unsigned int rwflags;        /* desired events */
+    unsigned int armed_rwflags;  /* events of the in-flight poll request */
+    uint16_t gen;                /* invalidates stale completions */
+};
+
+struct iu_set
+{
+    struct event_set_functions func;
+    bool fast;
+    int ring_fd;
+
+    /* submission queue */
+    uint8_t *sq_ring;
+    size_t sq_ring_sz;
+    unsigned int *sq_head;
+    unsigned int *sq_tail;
+    unsigned int *sq_mask;
+    unsigned int *sq_array;
+    struct io_uring_sqe *sqes;
+    size_t sqes_sz;
+    unsigned int sq_local_tail;
+    unsigned int to_submit;
+
+    /* completion queue */
+    uint8_t *cq_ring;
+    size_t cq_ring_sz;
+    bool single_mmap;
+    unsigned int *cq_head;
+    unsigned int *cq_tail;
+    unsigned int *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    struct iu_fd *fds;
+    int capacity;
+
+    uint16_t timeout_gen;
+    struct __kernel_timespec ts; /* must stay valid while a timeout is queued */
+};
+
+static inline uint64_t
+iu_user_data(int tag, int slot, uint16_t gen)
+{
+    return (uint64_t)tag | ((uint64_t)slot << 2) | ((uint64_t)gen << 32);
+}
+
+static int
+iu_find_slot(struct iu_set *ius, event_t fd, bool alloc)
+{
+    int free_slot = -1;
+    for (int i = 0; i < ius->capacity; ++i)
+    {
+        if (ius->fds[i].fd == fd)
+        {
+            return i;
+        }
+        if (free_slot < 0 && ius->fds[i].fd == -1)
+        {
+            free_slot = i;
+        }
+    }
+    if (alloc && free_slot >= 0)
+    {
+        struct iu_fd *e = &ius->fds[free_slot];
+        e->fd = fd;
+        e->arg = NULL;
+        e->rwflags = 0;
+        e->armed_rwflags = 0;
+        ++e->gen;
+        return free_slot;
+    }
+    return alloc ? -1 : free_slot;
+}
+
+static struct io_uring_sqe *
+iu_get_sqe(struct iu_set *ius)
+{
+    const unsigned int mask = *ius->sq_mask;
+    const unsigned int head = __atomic_load_n(ius->sq_head, __ATOMIC_ACQUIRE);
+
+    if (ius->sq_local_tail - head >= mask + 1)
+    {
+        return NULL; /* ring full */
+    }
+
+    const unsigned int idx = ius->sq_local_tail & mask;
+    struct io_uring_sqe *sqe = &ius->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    ius->sq_array[idx] = idx;
+    ++ius->sq_local_tail;
+    ++ius->to_submit;
+    return sqe;
+}
+
+static void
+iu_queue_poll_add(struct iu_set *ius, int slot)
+{
+    struct iu_fd *e = &ius->fds[slot];
+    struct io_uring_sqe *sqe = iu_get_sqe(ius);
+
+    if (!sqe)
+    {
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = e->fd;
+    sqe->poll_events = 0;
+    if (e->rwflags & EVENT_READ)
+    {
+        sqe->poll_events |= POLLIN;
+    }
+    if (e->rwflags & EVENT_WRITE)
+    {
+        sqe->poll_events |= POLLOUT;
+    }
+    sqe->user_data = iu_user_data(IU_TAG_POLL, slot, e->gen);
+    e->armed_rwflags = e->rwflags;
+}
+
+static void
+iu_queue_poll_remove(struct iu_set *ius, int slot)
+{
+    struct iu_fd *e = &ius->fds[slot];
+    struct io_uring_sqe *sqe = iu_get_sqe(ius);
+
+    if (!sqe)
+    {
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->addr = iu_user_data(IU_TAG_POLL, slot, e->gen);
+    sqe->user_data = iu_user_data(IU_TAG_REMOVE, slot, e->gen);
+    e->armed_rwflags = 0;
+    ++e->gen; /* in-flight completions for the old poll become stale */
+}
+
+static int
+iu_enter(struct iu_set *ius, unsigned int min_complete)
+{
+    __atomic_store_n(ius->sq_tail, ius->sq_local_tail, __ATOMIC_RELEASE);
+    const unsigned int to_submit = ius->to_submit;
+    ius->to_submit = 0;
+    return syscall(__NR_io_uring_enter, ius->ring_fd, to_submit,
+                   min_complete, IORING_ENTER_GETEVENTS, NULL, 0);
+}
+
+static void
+iu_free(struct event_set *es)
+{
+    struct iu_set *ius = (struct iu_set *) es;
+
+    if (ius->sqes)
+    {
+        munmap(ius->sqes, ius->sqes_sz);
+    }
+    if (ius->cq_ring && !ius->single_mmap)
+    {
+        munmap(ius->cq_ring, ius->cq_ring_sz);
+    }
+    if (ius->sq_ring)
+    {
+        munmap(ius->sq_ring, ius->sq_ring_sz);
+    }
+    close(ius->ring_fd);
+    free(ius->fds);
+    free(ius);
+}
+
+static void
+iu_reset(struct event_set *es)
+{
+    struct iu_set *ius = (struct iu_set *) es;
+
+    ASSERT(ius->fast);
+
+    /* registrations are diffed lazily in iu_wait(); just forget the
+     * desired state so event_ctl() can rebuild it */
+    for (int i = 0; i < ius->capacity; ++i)
+    {
+        ius->fds[i].rwflags = 0;
+    }
+}
+
+static void
+iu_del(struct event_set *es, event_t event)
+{
+    struct iu_set *ius = (struct iu_set *) es;
+    const int slot = iu_find_slot(ius, event, false);
+
+    dmsg(D_EVENT_WAIT, "IU_DEL ev=%d", (int)event);
+
+    if (slot >= 0)
+    {
+        if (ius->fds[slot].armed_rwflags)
+        {
+            iu_queue_poll_remove(ius, slot);
+        }
+        ius->fds[slot].fd = -1;
+        ius->fds[slot].rwflags = 0;
+    }
+}
+
+static void
+iu_ctl(struct event_set *es, event_t event, unsigned int rwflags, void *arg)
+{
+    struct iu_set *ius = (struct iu_set *) es;
+    const int slot = iu_find_slot(ius, event, true);
+
+    dmsg(D_EVENT_WAIT, "IU_CTL fd=%d rwflags=0x%04x arg=" ptr_format,
+         (int)event, rwflags, (ptr_type)arg);
+
+    if (slot < 0)
+    {
+        msg(M_FATAL, "EVENT: iu_ctl out of file descriptor slots");
+    }
+    ius->fds[slot].rwflags = rwflags;
+    ius->fds[slot].arg = arg;
+}
+
+static int
+iu_wait(struct event_set *es, const struct timeval *tv, struct event_set_return *out, int outlen)
+{
+    struct iu_set *ius = (struct iu_set *) es;
+
+    /* (re)arm polls whose desired state differs from what is in flight */
+    for (int i = 0; i < ius->capacity; ++i)
+    {
+        struct iu_fd *e = &ius->fds[i];
+        if (e->fd == -1 || e->rwflags == e->armed_rwflags)
+        {
+            continue;
+        }
+        if (e->armed_rwflags)
+        {
+            iu_queue_poll_remove(ius, i);
+        }
+        if (e->rwflags)
+        {
+            iu_queue_poll_add(ius, i);
+        }
+    }
+
+    /* one-shot timeout for this wait */
+    ++ius->timeout_gen;
+    ius->ts.tv_sec = tv->tv_sec;
+    ius->ts.tv_nsec = tv->tv_usec * 1000;
+    {
+        struct io_uring_sqe *sqe = iu_get_sqe(ius);
+        if (sqe)
+        {
+            sqe->opcode = IORING_OP_TIMEOUT;
+            sqe->fd = -1;
+            sqe->addr = (unsigned long) &ius->ts;
+            sqe->len = 1;
+            sqe->user_data = iu_user_data(IU_TAG_TIMEOUT, 0, ius->timeout_gen);
+        }
+    }
+
+    if (iu_enter(ius, 1) < 0)
+    {
+        if (errno == EINTR)
+        {
+            return 0;
+        }
+        return -1;
+    }
+
+    /* drain the completion queue */
+    int n = 0;
+    bool timed_out = false;
+    unsigned int head = *ius->cq_head;
+    const unsigned int tail = __atomic_load_n(ius->cq_tail, __ATOMIC_ACQUIRE);
+    const unsigned int mask = *ius->cq_mask;
+
+    while (head != tail)
+    {
+        const struct io_uring_cqe *cqe = &ius->cqes[head & mask];
+        const int tag = cqe->user_data & IU_TAG_MASK;
+        const int slot = (cqe->user_data >> 2) & 0x3FFFFFFF;
+        const uint16_t gen = cqe->user_data >> 32;
+
+        if (tag == IU_TAG_TIMEOUT)
+        {
+            if (gen == ius->timeout_gen)
+            {
+                timed_out = true;
+            }
+        }
+        else if (tag == IU_TAG_POLL && slot < ius->capacity)
+        {
+            struct iu_fd *e = &ius->fds[slot];
+            if (e->fd != -1 && gen == e->gen)
+            {
+                e->armed_rwflags = 0; /* one-shot fired, rearm next wait */
+                if (cqe->res > 0 && n < outlen)
+                {
+                    struct event_set_return *esr = &out[n];
+                    esr->rwflags = 0;
+                    if (cqe->res & (POLLIN|POLLPRI|POLLERR|POLLHUP))
+                    {
+                        esr->rwflags |= EVENT_READ;
+                    }
+                    if (cqe->res & POLLOUT)
+                    {
+                        esr->rwflags |= EVENT_WRITE;
+                    }
+                    esr->arg = e->arg;
+                    dmsg(D_EVENT_WAIT, "IU_WAIT[%d] fd=%d rwflags=0x%04x res=0x%x",
+                         n, (int)e->fd, esr->rwflags, (unsigned int)cqe->res);
+                    ++n;
+                }
+            }
+        }
+        /* IU_TAG_REMOVE completions carry no information we need */
+        ++head;
+    }
+    __atomic_store_n(ius->cq_head, head, __ATOMIC_RELEASE);
+
+    if (n == 0 && timed_out)
+    {
+        return 0;
+    }
+    return n;
+}
+
+static struct event_set *
+iu_init(int *maxevents, unsigned int flags)
+{
+    struct io_uring_params p;
+    struct iu_set *ius;
+    int fd;
+
+    dmsg(D_EVENT_WAIT, "IU_INIT maxevents=%d flags=0x%08x", *maxevents, flags);
+
+    CLEAR(p);
+    fd = syscall(__NR_io_uring_setup, IU_RING_ENTRIES, &p);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+
+    ALLOC_OBJ_CLEAR(ius, struct iu_set);
+    ius->ring_fd = fd;
+    set_cloexec(fd);
+
+    /* set dispatch functions */
+    ius->func.free = iu_free;
+    ius->func.reset = iu_reset;
+    ius->func.del = iu_del;
+    ius->func.ctl = iu_ctl;
+    ius->func.wait = iu_wait;
+
+    if (flags & EVENT_METHOD_FAST)
+    {
+        ius->fast = true;
+    }
+
+    /* map submission and completion rings */
+    ius->single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP);
+    ius->sq_ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+    ius->cq_ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (ius->single_mmap && ius->cq_ring_sz > ius->sq_ring_sz)
+    {
+        ius->sq_ring_sz = ius->cq_ring_sz;
+    }
+
+    ius->sq_ring = mmap(NULL, ius->sq_ring_sz, PROT_READ|PROT_WRITE,
+                        MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (ius->sq_ring == MAP_FAILED)
+    {
+        goto err;
+    }
+    if (ius->single_mmap)
+    {
+        ius->cq_ring = ius->sq_ring;
+    }
+    else
+    {
+        ius->cq_ring = mmap(NULL, ius->cq_ring_sz, PROT_READ|PROT_WRITE,
+                            MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (ius->cq_ring == MAP_FAILED)
+        {
+            ius->cq_ring = NULL;
+            goto err;
+        }
+    }
+    ius->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    ius->sqes = mmap(NULL, ius->sqes_sz, PROT_READ|PROT_WRITE,
+                     MAP_SHARED|MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (ius->sqes == MAP_FAILED)
+    {
+        ius->sqes = NULL;
+        goto err;
+    }
+
+    ius->sq_head = (unsigned int *)(ius->sq_ring + p.sq_off.head);
+    ius->sq_tail = (unsigned int *)(ius->sq_ring + p.sq_off.tail);
+    ius->sq_mask = (unsigned int *)(ius->sq_ring + p.sq_off.ring_mask);
+    ius->sq_array = (unsigned int *)(ius->sq_ring + p.sq_off.array);
+    ius->cq_head = (unsigned int *)(ius->cq_ring + p.cq_off.head);
+    ius->cq_tail = (unsigned int *)(ius->cq_ring + p.cq_off.tail);
+    ius->cq_mask = (unsigned int *)(ius->cq_ring + p.cq_off.ring_mask);
+    ius->cqes = (struct io_uring_cqe *)(ius->cq_ring + p.cq_off.cqes);
+    ius->sq_local_tail = *ius->sq_tail;
+
+    /* allocate fd slots */
+    ASSERT(*maxevents > 0);
+    ius->capacity = *maxevents * 2;
+    ALLOC_ARRAY_CLEAR(ius->fds, struct iu_fd, ius->capacity);
+    for (int i = 0; i < ius->capacity; ++i)
+    {
+        ius->fds[i].fd = -1;
+    }
+
+    msg(D_EVENT_WAIT, "io_uring event backend initialized (ring size %u)",
+        (unsigned int)p.sq_entries);
+
+    return (struct event_set *) ius;
+
+err:
+    iu_free((struct event_set *) ius);
+    return NULL;
+}
+
+#endif /* IO_URING */
+
 #if POLL
 
 struct po_set
@@ -873,6 +1332,13 @@ po_init(int *maxevents, unsigned int flags)
     {
         pos->fast = true;
     }
+    else
+    {
+        /* scalable mode keeps registrations across wait calls: ctl
+         * updates entries in place and del removes them, so callers
+         * may skip re-registration as with epoll */
+        pos->func.persistent = true;
+    }
 
     pos->n_events = 0;
 
@@ -1099,6 +1565,13 @@ se_init(int *maxevents, unsigned int flags)
         ses->fast = true;
         ses->func.wait = se_wait_fast;
     }
+    else
+    {
+        /* scalable mode maintains the fd sets incrementally in ctl/del
+         * and only copies them for select(), so registrations persist
+         * across wait calls as with epoll */
+        ses->func.persistent = true;
+    }
 
     /* Select needs to be passed this value + 1 */
     ses->maxfd = -1;
@@ -1119,6 +1592,25 @@ static struct event_set *
 event_set_init_simple(int *maxevents, unsigned int flags)
 {
     struct event_set *ret = NULL;
+#if IO_URING
+    ret = iu_init(maxevents, flags);
+    if (ret)
+    {
+        return ret;
+    }
+    msg(M_WARN, "Note: io_uring API is unavailable, falling back to poll/select API");
+#endif
+#if EPOLL
+    /* Prefer epoll even for the small fd counts of the fast path:
+     * its registrations persist across waits, so the steady-state
+     * event loop can skip re-arming syscalls entirely, while poll
+     * and select must be handed the full fd set on every iteration. */
+    ret = ep_init(maxevents, flags);
+    if (ret)
+    {
+        return ret;
+    }
+#endif
 #ifdef _WIN32
     ret = we_init(maxevents, flags);
 #elif POLL && SELECT
@@ -1162,6 +1654,13 @@ static struct event_set *
 event_set_init_scalable(int *maxevents, unsigned int flags)
 {
     struct event_set *ret = NULL;
+#if IO_URING
+    ret = iu_init(maxevents, flags);
+    if (ret)
+    {
+        return ret;
+    }
+#endif
 #if EPOLL
     ret = ep_init(maxevents, flags);
     if (!ret)
@@ -72,6 +72,14 @@ struct event_set_functions
      * length of event_set_return if at least 1 event is returned
      */
     int (*wait)(struct event_set *es, const struct timeval *tv, struct event_set_return *out, int outlen);
+
+    /*
+     * True if registrations made with ctl persist across wait calls
+     * (e.g. epoll), meaning callers may skip the ctl call entirely
+     * when the desired rwflags for an event are unchanged.  False for
+     * backends that rebuild their fd set on every iteration.
+     */
+    bool persistent;
 };
 
 struct event_set_return
@@ -121,6 +129,33 @@ event_ctl(struct event_set *es, event_t event, unsigned int rwflags, void *arg)
     (*es->func.ctl)(es, event, rwflags, arg);
 }
 
+static inline bool
+event_persistent(const struct event_set *es)
+{
+    return es->func.persistent;
+}
+
+/*
+ * Arm an event for read, eliding the ctl call on persistent backends
+ * when the given descriptor is already armed.  *armed tracks the
+ * descriptor registered so far (UNDEFINED_EVENT when none); it is
+ * ignored on backends that rebuild their fd set every iteration, which
+ * must re-register unconditionally.
+ */
+static inline void
+event_ctl_read_persist(struct event_set *es, event_t event, void *arg, event_t *armed)
+{
+    if (event_persistent(es))
+    {
+        if (*armed == event)
+        {
+            return;
+        }
+        *armed = event;
+    }
+    event_ctl(es, event, EVENT_READ, arg);
+}
+
 static inline int
 event_wait(struct event_set *es, const struct timeval *tv, struct event_set_return *out, int outlen)
 {
@@ -33,6 +33,8 @@
 #include "init.h"
 #include "push.h"
 #include "gremlin.h"
+#include "trafgen.h"
+#include "trace.h"
 #include "mss.h"
 #include "event.h"
 #include "occ.h"
@@ -347,6 +349,7 @@ send_control_channel_string(struct context *c, const char *str, int msglevel)
          */
 
         interval_action(&c->c2.tmp_int);
+        context_wakeup_pre_select(c);
         context_immediate_reschedule(c); /* ZERO-TIMEOUT */
         return ret;
     }
@@ -404,10 +407,21 @@ check_add_routes(struct context *c)
 
 /*
  * Should we exit due to inactivity timeout?
+ *
+ * The packet path only bumps c->c2.inactivity_bytes
+ * (register_activity); whether that constitutes activity is decided
+ * here, once per expiry, instead of on every packet.
  */
 void
 check_inactivity_timeout(struct context *c)
 {
+    if (c->c2.inactivity_bytes > (counter_type) c->options.inactivity_minimum_bytes)
+    {
+        /* enough traffic in the last interval -- rearm and keep counting */
+        c->c2.inactivity_bytes = 0;
+        event_timeout_reset(&c->c2.inactivity_interval);
+        return;
+    }
     msg(M_INFO, "Inactivity timeout (--inactive), exiting");
     register_signal(c, SIGTERM, "inactive");
 }
@@ -502,6 +516,56 @@ check_fragment(struct context *c)
 }
 #endif /* ifdef ENABLE_FRAGMENT */
 
+/*
+ * Closed-loop frame size tuning (--mtu-tuner).
+ *
+ * Two signals feed the loop: path-MTU hints the OS delivers on EMSGSIZE
+ * socket errors, and the rate at which --fragment splits outgoing
+ * datagrams.  Either one tightens the dynamic frame size, which in turn
+ * lowers the TCP MSS clamp applied by --mssfix.  Since the MSS option
+ * is rewritten in both directions, the correction reaches the peer's
+ * TCP stack without any protocol extension.  Adjustments only ever
+ * shrink the frame; --mtu-probe can re-measure the path upward.
+ */
+static void
+check_mtu_tuner(struct context *c)
+{
+    const int before = EXPANDED_SIZE_DYNAMIC(&c->c2.frame);
+
+    /* OS path-MTU hint: tighten the data channel frame, not just the
+     * fragmentation threshold handled by check_fragment() */
+    if (c->c2.link_socket->mtu > 0)
+    {
+        frame_adjust_path_mtu(&c->c2.frame, c->c2.link_socket->mtu,
+                              c->options.ce.proto);
+    }
+
+#ifdef ENABLE_FRAGMENT
+    if (c->c2.fragment)
+    {
+        const int n = c->c2.fragment->n_packets_fragmented;
+        c->c2.fragment->n_packets_fragmented = 0;
+
+        /* Sustained fragmentation: pull the MSS clamp down to the
+         * fragmentation threshold so TCP flows fit in a single part and
+         * only non-TCP traffic keeps paying the splitting cost. */
+        if (n >= MTU_TUNER_FRAG_TRIGGER)
+        {
+            frame_set_mtu_dynamic(&c->c2.frame,
+                                  EXPANDED_SIZE_DYNAMIC(&c->c2.frame_fragment),
+                                  SET_MTU_UPPER_BOUND);
+        }
+    }
+#endif
+
+    const int after = EXPANDED_SIZE_DYNAMIC(&c->c2.frame);
+    if (after < before)
+    {
+        msg(M_INFO, "NOTE: MTU tuner lowered dynamic link MTU %d -> %d "
+            "(TCP MSS clamp follows)", before, after);
+    }
+}
+
 /*
  * Buffer reallocation, for use with null encryption.
  */
@@ -540,6 +604,13 @@ encrypt_sign(struct context *c, bool comp_frag)
         c->c2.buf.len = 0;
     }
 
+    /* data plane hook: cleartext tunnel packet before encryption */
+    if (plugin_data_defined(c->plugins) && c->c2.buf.len > 0)
+    {
+        plugin_data_call(c->plugins, OPENVPN_PLUGIN_DATA_PRE_ENCRYPT,
+                         BPTR(&c->c2.buf), BLEN(&c->c2.buf));
+    }
+
     if (comp_frag)
     {
 #ifdef USE_COMP
@@ -553,6 +624,7 @@ encrypt_sign(struct context *c, bool comp_frag)
         if (c->c2.fragment)
         {
             fragment_outgoing(c->c2.fragment, &c->c2.buf, &c->c2.frame_fragment);
+            context_wakeup_pre_select(c);
         }
 #endif
     }
@@ -696,6 +768,16 @@ process_coarse_timers(struct context *c)
     /* Should we send an MTU load test? */
     check_send_occ_load_test(c);
 
+    /* Should we advance the path MTU probe? */
+    check_send_occ_mtu_probe(c);
+
+    /* Should we re-evaluate the frame size from MTU feedback? */
+    if (c->options.mtu_tuner
+        && event_timeout_trigger(&c->c2.mtu_tuner_interval, &c->c2.timeval, ETT_DEFAULT))
+    {
+        check_mtu_tuner(c);
+    }
+
     /* Should we send an OCC_EXIT message to remote? */
     if (c->c2.explicit_exit_notification_time_wait)
     {
@@ -775,7 +857,8 @@ socks_preprocess_outgoing_link(struct context *c,
 {
     if (c->c2.link_socket->socks_proxy && c->c2.link_socket->info.proto == PROTO_UDP)
     {
-        *size_delta += socks_process_outgoing_udp(&c->c2.to_link, c->c2.to_link_addr);
+        *size_delta += socks_process_outgoing_udp(c->c2.link_socket->socks_proxy,
+                                                  &c->c2.to_link, c->c2.to_link_addr);
         *to_addr = &c->c2.link_socket->socks_relay;
     }
 }
@@ -814,12 +897,25 @@ read_incoming_link(struct context *c)
     perf_push(PERF_READ_IN_LINK);
 
     c->c2.buf = c->c2.buffers->read_link_buf;
-    ASSERT(buf_init(&c->c2.buf, FRAME_HEADROOM_ADJ(&c->c2.frame, FRAME_HEADROOM_MARKER_READ_LINK)));
+    ASSERT(buf_init(&c->c2.buf, c->c2.frame.layout.headroom_read_link));
 
     status = link_socket_read(c->c2.link_socket,
                               &c->c2.buf,
                               &c->c2.from);
 
+    /* --event-drain: an empty read means the socket has run dry */
+    c->c2.link_read_empty = (status <= 0);
+
+    /* boundary verification: interior buffer ops assume a valid buffer */
+    ASSERT(buf_defined(&c->c2.buf));
+
+#ifdef ENABLE_DEBUG
+    if (c->options.gremlin_capture && status > 0)
+    {
+        gremlin_trace_capture(c->options.gremlin_capture, &c->c2.buf, &c->c2.from);
+    }
+#endif
+
     if (socket_connection_reset(c->c2.link_socket, status))
     {
 #if PORT_SHARE
@@ -863,6 +959,8 @@ read_incoming_link(struct context *c)
     /* Remove socks header if applicable */
     socks_postprocess_incoming_link(c);
 
+    OPENVPN_PROBE1(link_read, BLEN(&c->c2.buf));
+
     perf_pop();
 }
 
@@ -872,6 +970,8 @@ process_incoming_link_part1(struct context *c, struct link_socket_info *lsi, boo
     struct gc_arena gc = gc_new();
     bool decrypt_status = false;
 
+    OPENVPN_PROBE1(link_process_start, c->c2.buf.len);
+
     if (c->c2.buf.len > 0)
     {
         c->c2.link_read_bytes += c->c2.buf.len;
@@ -963,6 +1063,7 @@ process_incoming_link_part1(struct context *c, struct link_socket_info *lsi, boo
                 }
 
                 interval_action(&c->c2.tmp_int);
+                context_wakeup_pre_select(c);
 
                 /* reset packet received timer if TLS packet */
                 if (c->options.ping_rec_timeout)
@@ -1010,6 +1111,13 @@ process_incoming_link_part2(struct context *c, struct link_socket_info *lsi, con
 {
     if (c->c2.buf.len > 0)
     {
+        /* data plane hook: tunnel packet after decryption */
+        if (plugin_data_defined(c->plugins))
+        {
+            plugin_data_call(c->plugins, OPENVPN_PLUGIN_DATA_POST_DECRYPT,
+                             BPTR(&c->c2.buf), BLEN(&c->c2.buf));
+        }
+
 #ifdef ENABLE_FRAGMENT
         if (c->c2.fragment)
         {
@@ -1086,6 +1194,8 @@ process_incoming_link_part2(struct context *c, struct link_socket_info *lsi, con
     {
         buf_reset(&c->c2.to_tun);
     }
+
+    OPENVPN_PROBE1(link_process_done, c->c2.to_tun.len);
 }
 
 static void
@@ -1102,6 +1212,342 @@ process_incoming_link(struct context *c)
     perf_pop();
 }
 
+#if defined(TARGET_LINUX)
+
+/*
+ * --tun-offload: userspace handling of virtio-net-hdr framed packets.
+ *
+ * The kernel hands us coalesced (GSO) TCP super-packets of up to 64 KB
+ * together with a header describing the MSS.  The tunnel MTU still
+ * bounds what we can send to the peer, so the payload is cut back into
+ * MTU-sized segments here -- the win is that one read() and one header
+ * parse replace dozens, and segmentation happens on our schedule
+ * instead of the kernel's.
+ */
+
+static uint16_t
+ip_header_checksum(const uint8_t *hdr, const int len)
+{
+    uint32_t sum = 0;
+
+    for (int i = 0; i < len; i += 2)
+    {
+        sum += (uint16_t)(((hdr[i] << 8) & 0xFF00) + (hdr[i + 1] & 0xFF));
+    }
+    while (sum >> 16)
+    {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t) ~sum;
+}
+
+/*
+ * Finish the L4 checksum of a packet handed up with
+ * TUN_VNET_HDR_F_NEEDS_CSUM.  The sending stack left it incomplete in
+ * the expectation that hardware would finish it; recompute it from
+ * scratch before the packet crosses the tunnel.  Returns false if the
+ * packet is not something we know how to fix up.
+ */
+static bool
+tun_vnet_csum_fix(struct buffer *buf)
+{
+    uint8_t *pkt = BPTR(buf);
+    const int len = BLEN(buf);
+
+    if (len >= (int) sizeof(struct openvpn_iphdr)
+        && OPENVPN_IPH_GET_VER(*pkt) == 4)
+    {
+        struct openvpn_iphdr *ip = (struct openvpn_iphdr *) pkt;
+        const int iphlen = OPENVPN_IPH_GET_LEN(ip->version_len);
+        const int l4len = len - iphlen;
+
+        if (iphlen < (int) sizeof(*ip) || l4len <= 0)
+        {
+            return false;
+        }
+        if (ip->protocol == OPENVPN_IPPROTO_TCP
+            && l4len >= (int) sizeof(struct openvpn_tcphdr))
+        {
+            struct openvpn_tcphdr *th = (struct openvpn_tcphdr *) (pkt + iphlen);
+
+            th->check = 0;
+            th->check = htons(ip_checksum(AF_INET, pkt + iphlen, l4len,
+                                          (uint8_t *) &ip->saddr,
+                                          (uint8_t *) &ip->daddr,
+                                          OPENVPN_IPPROTO_TCP));
+            return true;
+        }
+        else if (ip->protocol == OPENVPN_IPPROTO_UDP
+                 && l4len >= (int) sizeof(struct openvpn_udphdr))
+        {
+            struct openvpn_udphdr *uh = (struct openvpn_udphdr *) (pkt + iphlen);
+            uint16_t check;
+
+            uh->check = 0;
+            check = ip_checksum(AF_INET, pkt + iphlen, l4len,
+                                (uint8_t *) &ip->saddr,
+                                (uint8_t *) &ip->daddr,
+                                OPENVPN_IPPROTO_UDP);
+            /* RFC 768: a computed zero is transmitted as all ones */
+            uh->check = check ? htons(check) : 0xFFFF;
+            return true;
+        }
+    }
+    else if (len >= (int) sizeof(struct openvpn_ipv6hdr)
+             && OPENVPN_IPH_GET_VER(*pkt) == 6)
+    {
+        struct openvpn_ipv6hdr *ip6 = (struct openvpn_ipv6hdr *) pkt;
+        const int l4len = len - (int) sizeof(*ip6);
+        uint8_t *l4 = pkt + sizeof(*ip6);
+
+        if (ip6->nexthdr == OPENVPN_IPPROTO_TCP
+            && l4len >= (int) sizeof(struct openvpn_tcphdr))
+        {
+            struct openvpn_tcphdr *th = (struct openvpn_tcphdr *) l4;
+
+            th->check = 0;
+            th->check = htons(ip_checksum(AF_INET6, l4, l4len,
+                                          (uint8_t *) &ip6->saddr,
+                                          (uint8_t *) &ip6->daddr,
+                                          OPENVPN_IPPROTO_TCP));
+            return true;
+        }
+        else if (ip6->nexthdr == OPENVPN_IPPROTO_UDP
+                 && l4len >= (int) sizeof(struct openvpn_udphdr))
+        {
+            struct openvpn_udphdr *uh = (struct openvpn_udphdr *) l4;
+
+            uh->check = 0;
+            uh->check = htons(ip_checksum(AF_INET6, l4, l4len,
+                                          (uint8_t *) &ip6->saddr,
+                                          (uint8_t *) &ip6->daddr,
+                                          OPENVPN_IPPROTO_UDP));
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Validate a GSO super-packet in c->c2.gso_buf against its vnet header
+ * and prime the resegmentation cursor.  Returns false (with the cursor
+ * cleared) when the packet does not match what the header claims.
+ */
+static bool
+tun_gso_parse(struct context *c)
+{
+    const struct tun_vnet_hdr *vh = &c->c1.tuntap->rx_vnet_hdr;
+    const uint8_t *pkt = BPTR(&c->c2.gso_buf);
+    const int len = BLEN(&c->c2.gso_buf);
+    const uint8_t gso_type = vh->gso_type & ~TUN_VNET_GSO_ECN;
+    int iphlen;
+
+    c->c2.gso_remaining = 0;
+
+    if (gso_type == TUN_VNET_GSO_TCPV4)
+    {
+        const struct openvpn_iphdr *ip = (const struct openvpn_iphdr *) pkt;
+
+        if (len < (int) sizeof(*ip)
+            || OPENVPN_IPH_GET_VER(ip->version_len) != 4
+            || ip->protocol != OPENVPN_IPPROTO_TCP)
+        {
+            return false;
+        }
+        iphlen = OPENVPN_IPH_GET_LEN(ip->version_len);
+        if (iphlen < (int) sizeof(*ip))
+        {
+            return false;
+        }
+    }
+    else if (gso_type == TUN_VNET_GSO_TCPV6)
+    {
+        const struct openvpn_ipv6hdr *ip6 = (const struct openvpn_ipv6hdr *) pkt;
+
+        /* the stack never builds GSO packets with extension headers */
+        if (len < (int) sizeof(*ip6)
+            || OPENVPN_IPH_GET_VER(ip6->version_prio) != 6
+            || ip6->nexthdr != OPENVPN_IPPROTO_TCP)
+        {
+            return false;
+        }
+        iphlen = (int) sizeof(*ip6);
+    }
+    else
+    {
+        return false;
+    }
+
+    if (len < iphlen + (int) sizeof(struct openvpn_tcphdr))
+    {
+        return false;
+    }
+    const struct openvpn_tcphdr *th =
+        (const struct openvpn_tcphdr *) (pkt + iphlen);
+    const int thlen = OPENVPN_TCPH_GET_DOFF(th->doff_res);
+
+    if (thlen < (int) sizeof(*th) || len < iphlen + thlen)
+    {
+        return false;
+    }
+
+    c->c2.gso_hdr_len = iphlen + thlen;
+    c->c2.gso_mss = vh->gso_size;
+    c->c2.gso_off = 0;
+
+    /* every emitted segment must fit the negotiated frame */
+    if (c->c2.gso_mss <= 0 || len <= c->c2.gso_hdr_len
+        || c->c2.gso_hdr_len + c->c2.gso_mss > c->c2.frame.layout.payload_size)
+    {
+        return false;
+    }
+    c->c2.gso_remaining = len - c->c2.gso_hdr_len;
+    return true;
+}
+
+/*
+ * Cut the next MTU-sized segment from the pending super-packet into
+ * c->c2.buf, replicating the headers and fixing IPv4 total length,
+ * id and checksum (IPv6 payload length), TCP sequence number, flags
+ * and checksum.
+ */
+void
+tun_gso_emit(struct context *c)
+{
+    const uint8_t *pkt = BPTR(&c->c2.gso_buf);
+    const int hdr_len = c->c2.gso_hdr_len;
+    const int chunk = min_int(c->c2.gso_mss, c->c2.gso_remaining);
+    const bool last = (chunk == c->c2.gso_remaining);
+    uint8_t *seg;
+    struct openvpn_tcphdr *th;
+    int iphlen;
+
+    ASSERT(c->c2.gso_remaining > 0);
+
+    c->c2.buf = c->c2.buffers->read_tun_buf;
+    ASSERT(buf_init(&c->c2.buf, c->c2.frame.layout.headroom));
+    ASSERT(buf_safe(&c->c2.buf, hdr_len + chunk));
+    seg = BPTR(&c->c2.buf);
+    memcpy(seg, pkt, hdr_len);
+    memcpy(seg + hdr_len, pkt + hdr_len + c->c2.gso_off, chunk);
+    c->c2.buf.len = hdr_len + chunk;
+
+    if (OPENVPN_IPH_GET_VER(*seg) == 4)
+    {
+        struct openvpn_iphdr *ip = (struct openvpn_iphdr *) seg;
+
+        iphlen = OPENVPN_IPH_GET_LEN(ip->version_len);
+        ip->tot_len = htons((uint16_t)(hdr_len + chunk));
+        ip->id = htons((uint16_t)(ntohs(ip->id)
+                                  + c->c2.gso_off / c->c2.gso_mss));
+        ip->check = 0;
+        ip->check = htons(ip_header_checksum(seg, iphlen));
+    }
+    else
+    {
+        struct openvpn_ipv6hdr *ip6 = (struct openvpn_ipv6hdr *) seg;
+
+        iphlen = (int) sizeof(*ip6);
+        ip6->payload_len = htons((uint16_t)(hdr_len - iphlen + chunk));
+    }
+
+    th = (struct openvpn_tcphdr *) (seg + iphlen);
+    th->seq = htonl(ntohl(th->seq) + (uint32_t) c->c2.gso_off);
+    if (!last)
+    {
+        /* FIN and PSH describe the end of the original super-packet */
+        th->flags &= ~(OPENVPN_TCPH_FIN_MASK|OPENVPN_TCPH_PSH_MASK);
+    }
+    th->check = 0;
+    if (OPENVPN_IPH_GET_VER(*seg) == 4)
+    {
+        const struct openvpn_iphdr *ip = (const struct openvpn_iphdr *) seg;
+
+        th->check = htons(ip_checksum(AF_INET, (uint8_t *) th,
+                                      hdr_len - iphlen + chunk,
+                                      (const uint8_t *) &ip->saddr,
+                                      (const uint8_t *) &ip->daddr,
+                                      OPENVPN_IPPROTO_TCP));
+    }
+    else
+    {
+        const struct openvpn_ipv6hdr *ip6 = (const struct openvpn_ipv6hdr *) seg;
+
+        th->check = htons(ip_checksum(AF_INET6, (uint8_t *) th,
+                                      hdr_len - iphlen + chunk,
+                                      (const uint8_t *) &ip6->saddr,
+                                      (const uint8_t *) &ip6->daddr,
+                                      OPENVPN_IPPROTO_TCP));
+    }
+
+    c->c2.gso_off += chunk;
+    c->c2.gso_remaining -= chunk;
+}
+
+/*
+ * read_incoming_tun() for a device opened with IFF_VNET_HDR.  While a
+ * super-packet is still being resegmented, TUN_READ emits the next
+ * segment instead of reading -- the fresh read would clobber gso_buf.
+ * Plain packets are copied into c->c2.buf after any offloaded checksum
+ * is finished; GSO super-packets prime the cursor and emit their first
+ * segment.
+ */
+static void
+read_incoming_tun_vnet(struct context *c)
+{
+    struct buffer *gso = &c->c2.gso_buf;
+    const struct tun_vnet_hdr *vh = &c->c1.tuntap->rx_vnet_hdr;
+    int len;
+
+    if (tun_gso_pending(c))
+    {
+        tun_gso_emit(c);
+        return;
+    }
+
+    ASSERT(buf_defined(gso));
+    ASSERT(buf_init(gso, 0));
+    len = read_tun(c->c1.tuntap, BPTR(gso), buf_forward_capacity(gso));
+    if (len <= 0)
+    {
+        /* propagate error codes to the tuntap_stop/check_status logic */
+        c->c2.buf.len = len;
+        return;
+    }
+    ASSERT(buf_inc_len(gso, len));
+
+    if ((vh->gso_type & ~TUN_VNET_GSO_ECN) == TUN_VNET_GSO_NONE)
+    {
+        if ((vh->flags & TUN_VNET_HDR_F_NEEDS_CSUM)
+            && !tun_vnet_csum_fix(gso))
+        {
+            msg_rl(D_LINK_ERRORS,
+                   "GSO: dropping packet with unfinishable checksum");
+            c->c2.buf.len = 0;
+            return;
+        }
+        if (!buf_copy(&c->c2.buf, gso))
+        {
+            msg_rl(D_LINK_ERRORS,
+                   "GSO: packet too large for frame (%d)", len);
+            c->c2.buf.len = 0;
+        }
+        return;
+    }
+
+    if (!tun_gso_parse(c))
+    {
+        msg_rl(D_LINK_ERRORS,
+               "GSO: dropping malformed super-packet (type=%d len=%d)",
+               (int) vh->gso_type, len);
+        c->c2.buf.len = 0;
+        return;
+    }
+    tun_gso_emit(c);
+}
+
+#endif /* defined(TARGET_LINUX) */
+
 /*
  * Output: c->c2.buf
  */
@@ -1136,11 +1582,23 @@ read_incoming_tun(struct context *c)
         read_tun_buffered(c->c1.tuntap, &c->c2.buf);
     }
 #else  /* ifdef _WIN32 */
-    ASSERT(buf_init(&c->c2.buf, FRAME_HEADROOM(&c->c2.frame)));
-    ASSERT(buf_safe(&c->c2.buf, MAX_RW_SIZE_TUN(&c->c2.frame)));
-    c->c2.buf.len = read_tun(c->c1.tuntap, BPTR(&c->c2.buf), MAX_RW_SIZE_TUN(&c->c2.frame));
+    ASSERT(buf_init(&c->c2.buf, c->c2.frame.layout.headroom));
+    ASSERT(buf_safe(&c->c2.buf, c->c2.frame.layout.payload_size));
+#if defined(TARGET_LINUX)
+    if (c->c1.tuntap->vnet_hdr)
+    {
+        read_incoming_tun_vnet(c);
+    }
+    else
+#endif
+    {
+        c->c2.buf.len = read_tun(c->c1.tuntap, BPTR(&c->c2.buf), c->c2.frame.layout.payload_size);
+    }
 #endif /* ifdef _WIN32 */
 
+    /* boundary verification: interior buffer ops assume a valid buffer */
+    ASSERT(buf_defined(&c->c2.buf));
+
 #ifdef PACKET_TRUNCATION_CHECK
     ipv4_packet_size_verify(BPTR(&c->c2.buf),
                             BLEN(&c->c2.buf),
@@ -1258,6 +1716,121 @@ drop_if_recursive_routing(struct context *c, struct buffer *buf)
     }
 }
 
+/*
+ * --prio-queue: 3-band strict-priority staging queue ahead of
+ * encrypt_sign().  Classification is by inner DSCP and packet size:
+ * interactive DSCP or small packets go to band 0, large best-effort
+ * packets to band 2, everything else to band 1.
+ */
+
+#define PRIO_QUEUE_SMALL_PKT 128   /* <= this size is band 0 */
+#define PRIO_QUEUE_BULK_PKT 1024   /* >= this size with default DSCP is band 2 */
+
+struct prio_queue *
+prio_queue_init(int capacity, const struct frame *frame)
+{
+    struct prio_queue *pq;
+    int i, j;
+
+    ALLOC_OBJ_CLEAR(pq, struct prio_queue);
+    pq->capacity = capacity;
+    for (i = 0; i < PRIO_QUEUE_BANDS; ++i)
+    {
+        ALLOC_ARRAY(pq->band[i].pkts, struct buffer, capacity);
+        for (j = 0; j < capacity; ++j)
+        {
+            pq->band[i].pkts[j] = alloc_buf(BUF_SIZE(frame));
+        }
+    }
+    return pq;
+}
+
+void
+prio_queue_free(struct prio_queue *pq)
+{
+    if (pq)
+    {
+        int i, j;
+        for (i = 0; i < PRIO_QUEUE_BANDS; ++i)
+        {
+            for (j = 0; j < pq->capacity; ++j)
+            {
+                free_buf(&pq->band[i].pkts[j]);
+            }
+            free(pq->band[i].pkts);
+        }
+        free(pq);
+    }
+}
+
+static int
+prio_queue_classify(const struct buffer *buf, int tunnel_type)
+{
+    const uint8_t dscp = ip_packet_dscp(buf, tunnel_type);
+    if (OPENVPN_DSCP_INTERACTIVE(dscp) || BLEN(buf) <= PRIO_QUEUE_SMALL_PKT)
+    {
+        return 0;
+    }
+    else if (BLEN(buf) >= PRIO_QUEUE_BULK_PKT && (dscp >> 3) == 0)
+    {
+        return PRIO_QUEUE_BANDS - 1;
+    }
+    return 1;
+}
+
+void
+prio_queue_put(struct prio_queue *pq, const struct buffer *buf, int tunnel_type)
+{
+    struct prio_queue_band *b = &pq->band[prio_queue_classify(buf, tunnel_type)];
+
+    if (b->len < pq->capacity)
+    {
+        struct buffer *slot = &b->pkts[(b->head + b->len) % pq->capacity];
+        ASSERT(buf_init(slot, buf->offset));
+        ASSERT(buf_copy(slot, buf));
+        ++b->len;
+    }
+    else
+    {
+        ++pq->n_dropped;
+        msg_rl(D_LOW, "PRIO: packet dropped on full priority band");
+    }
+}
+
+bool
+prio_queue_get(struct prio_queue *pq, struct buffer *buf)
+{
+    int i;
+    for (i = 0; i < PRIO_QUEUE_BANDS; ++i)
+    {
+        struct prio_queue_band *b = &pq->band[i];
+        if (b->len > 0)
+        {
+            const struct buffer *slot = &b->pkts[b->head];
+            ASSERT(buf_init(buf, slot->offset));
+            ASSERT(buf_copy(buf, slot));
+            b->head = (b->head + 1) % pq->capacity;
+            --b->len;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Called when the link slot has been freed: encrypt the most urgent
+ * staged packet so it is ready for the next writable event.
+ */
+void
+prio_queue_encrypt_next(struct context *c)
+{
+    c->c2.buf = c->c2.buffers->read_tun_buf;
+    if (prio_queue_get(c->c2.pq, &c->c2.buf))
+    {
+        encrypt_sign(c, true);
+    }
+}
+
 /*
  * Input:  c->c2.buf
  * Output: c->c2.to_link
@@ -1296,7 +1869,7 @@ process_incoming_tun(struct context *c)
          * us to examine the IP header (IPv4 or IPv6).
          */
         unsigned int flags = PIPV4_PASSTOS | PIP_MSSFIX | PIPV4_CLIENT_NAT
-                             | PIPV6_IMCP_NOHOST_CLIENT;
+                             | PIPV6_IMCP_NOHOST_CLIENT | PIP_RECORD_DSCP;
         process_ip_header(c, flags, &c->c2.buf);
 
 #ifdef PACKET_TRUNCATION_CHECK
@@ -1309,11 +1882,34 @@ process_incoming_tun(struct context *c)
 #endif
 
     }
+
+    /*
+     * With --prio-queue, stage the packet and encrypt the most urgent
+     * staged packet instead, so small interactive packets overtake
+     * already-staged bulk traffic while the link is busy.
+     */
+    if (c->c2.pq)
+    {
+        if (c->c2.buf.len > 0)
+        {
+            prio_queue_put(c->c2.pq, &c->c2.buf, TUNNEL_TYPE(c->c1.tuntap));
+        }
+        c->c2.buf.len = 0;
+        if (c->c2.to_link.len == 0)
+        {
+            c->c2.buf = c->c2.buffers->read_tun_buf;
+            if (!prio_queue_get(c->c2.pq, &c->c2.buf))
+            {
+                c->c2.buf.len = 0;
+            }
+        }
+    }
+
     if (c->c2.buf.len > 0)
     {
         encrypt_sign(c, true);
     }
-    else
+    else if (c->c2.to_link.len == 0)
     {
         buf_reset(&c->c2.to_link);
     }
@@ -1474,7 +2070,7 @@ process_ip_header(struct context *c, unsigned int flags, struct buffer *buf)
     {
         flags &= ~PIPV4_CLIENT_NAT;
     }
-    if (!c->options.route_gateway_via_dhcp)
+    if (!c->options.route_gateway_via_dhcp || c->c1.dhcp_router_extracted)
     {
         flags &= ~PIPV4_EXTRACT_DHCP_ROUTER;
     }
@@ -1482,6 +2078,10 @@ process_ip_header(struct context *c, unsigned int flags, struct buffer *buf)
     {
         flags &= ~(PIPV6_IMCP_NOHOST_CLIENT | PIPV6_IMCP_NOHOST_SERVER);
     }
+    if (flags & PIP_RECORD_DSCP)
+    {
+        c->c2.link_dscp = 0;
+    }
 
     if (buf->len > 0)
     {
@@ -1495,11 +2095,20 @@ process_ip_header(struct context *c, unsigned int flags, struct buffer *buf)
                      | PIPV4_PASSTOS
 #endif
                      | PIPV4_CLIENT_NAT
+                     | PIP_RECORD_DSCP
                      ))
         {
             struct buffer ipbuf = *buf;
             if (is_ipv4(TUNNEL_TYPE(c->c1.tuntap), &ipbuf))
             {
+                /* record inner DSCP for output congestion handling */
+                if (flags & PIP_RECORD_DSCP)
+                {
+                    const struct openvpn_iphdr *pip
+                        = (const struct openvpn_iphdr *) BPTR(&ipbuf);
+                    c->c2.link_dscp = OPENVPN_IP_DSCP(pip->tos);
+                }
+
 #if PASSTOS_CAPABILITY
                 /* extract TOS from IP header */
                 if (flags & PIPV4_PASSTOS)
@@ -1527,11 +2136,24 @@ process_ip_header(struct context *c, unsigned int flags, struct buffer *buf)
                     if (dhcp_router)
                     {
                         route_list_add_vpn_gateway(c->c1.route_list, c->c2.es, dhcp_router);
+
+                        /* exchange complete -- stop scanning tun-bound
+                         * frames for DHCP ACKs */
+                        c->c1.dhcp_router_extracted = true;
                     }
                 }
             }
             else if (is_ipv6(TUNNEL_TYPE(c->c1.tuntap), &ipbuf))
             {
+                if (flags & PIP_RECORD_DSCP)
+                {
+                    const struct openvpn_ipv6hdr *pip6
+                        = (const struct openvpn_ipv6hdr *) BPTR(&ipbuf);
+                    c->c2.link_dscp
+                        = OPENVPN_IP_DSCP(((pip6->version_prio & 0x0F) << 4)
+                                          | (pip6->flow_lbl[0] >> 4));
+                }
+
                 /* possibly alter the TCP MSS */
                 if (flags & PIP_MSSFIX)
                 {
@@ -1554,13 +2176,17 @@ process_ip_header(struct context *c, unsigned int flags, struct buffer *buf)
 
 /*
  * Input: c->c2.to_link
+ *
+ * Returns the number of bytes written to the socket, or <= 0 if the
+ * write did not go through.
  */
 
-void
-process_outgoing_link(struct context *c)
+static int
+process_outgoing_link_once(struct context *c)
 {
     struct gc_arena gc = gc_new();
     int error_code = 0;
+    int ret = 0;
 
     perf_push(PERF_PROC_OUT_LINK);
 
@@ -1573,6 +2199,25 @@ process_outgoing_link(struct context *c)
         int size = 0;
         ASSERT(link_socket_actual_defined(c->c2.to_link_addr));
 
+#ifdef ENABLE_FEATURE_SHAPER
+        /*
+         * Server instances are policed rather than paced: without a
+         * per-instance event-loop wakeup, a packet that finds an
+         * empty bucket in the hierarchy is dropped.
+         */
+        if ((c->mode == CM_CHILD_UDP || c->mode == CM_CHILD_TCP)
+            && (c->options.shaper || c->c2.shaper.parent)
+            && !shaper_reserve(&c->c2.shaper,
+                               BLEN(&c->c2.to_link)
+                               + datagram_overhead(c->options.ce.proto)))
+        {
+#ifdef SHAPER_DEBUG
+            dmsg(D_SHAPER_DEBUG, "SHAPER dropped packet of %d bytes",
+                 BLEN(&c->c2.to_link));
+#endif
+        }
+        else
+#endif /* ENABLE_FEATURE_SHAPER */
 #ifdef ENABLE_DEBUG
         /* In gremlin-test mode, we may choose to drop this packet */
         if (!c->options.gremlin || ask_gremlin(c->options.gremlin))
@@ -1583,7 +2228,7 @@ process_outgoing_link(struct context *c)
              * we wrote.
              */
 #ifdef ENABLE_FEATURE_SHAPER
-            if (c->options.shaper)
+            if (c->options.shaper && c->mode == CM_P2P)
             {
                 shaper_wrote_bytes(&c->c2.shaper, BLEN(&c->c2.to_link)
                                    + datagram_overhead(c->options.ce.proto));
@@ -1662,8 +2307,8 @@ process_outgoing_link(struct context *c)
             /* Did we write a different size packet than we intended? */
             if (size != BLEN(&c->c2.to_link))
             {
-                msg(D_LINK_ERRORS,
-                    "TCP/UDP packet was truncated/expanded on write to %s (tried=%d,actual=%d)",
+                msg_rl(D_LINK_ERRORS,
+                       "TCP/UDP packet was truncated/expanded on write to %s (tried=%d,actual=%d)",
                     print_link_socket_actual(c->c2.to_link_addr, &gc),
                     BLEN(&c->c2.to_link),
                     size);
@@ -1683,12 +2328,13 @@ process_outgoing_link(struct context *c)
             msg(M_INFO, "Network unreachable, restarting");
             register_signal(c, SIGUSR1, "network-unreachable");
         }
+        ret = size;
     }
     else
     {
         if (c->c2.to_link.len > 0)
         {
-            msg(D_LINK_ERRORS, "TCP/UDP packet too large on write to %s (tried=%d,max=%d)",
+            msg_rl(D_LINK_ERRORS, "TCP/UDP packet too large on write to %s (tried=%d,max=%d)",
                 print_link_socket_actual(c->c2.to_link_addr, &gc),
                 c->c2.to_link.len,
                 EXPANDED_SIZE(&c->c2.frame));
@@ -1699,6 +2345,45 @@ process_outgoing_link(struct context *c)
 
     perf_pop();
     gc_free(&gc);
+    return ret;
+}
+
+void
+process_outgoing_link(struct context *c)
+{
+    int size = process_outgoing_link_once(c);
+
+#ifdef ENABLE_FRAGMENT
+    /*
+     * Burst transmission: if more fragments of the current packet are
+     * queued, encrypt and send them back-to-back instead of taking one
+     * event-loop round trip per fragment.  Stop as soon as a write does
+     * not go through cleanly; the remaining fragments then drain one
+     * per pass through the regular POLLOUT-gated path.  With the
+     * traffic shaper active, pacing stays with the event loop.
+     */
+#ifdef ENABLE_FEATURE_SHAPER
+    if (c->options.shaper)
+    {
+        return;
+    }
+#endif
+    while (size > 0 && c->c2.fragment && fragment_outgoing_defined(c->c2.fragment)
+           && !c->c2.to_link.len && !IS_SIG(c))
+    {
+        if (!fragment_ready_to_send(c->c2.fragment, &c->c2.buf,
+                                    &c->c2.frame_fragment))
+        {
+            break;
+        }
+        encrypt_sign(c, false);
+        if (!c->c2.to_link.len)
+        {
+            break;
+        }
+        size = process_outgoing_link_once(c);
+    }
+#endif /* ifdef ENABLE_FRAGMENT */
 }
 
 /*
@@ -1721,6 +2406,8 @@ process_outgoing_tun(struct context *c)
 
     perf_push(PERF_PROC_OUT_TUN);
 
+    OPENVPN_PROBE1(tun_write, BLEN(&c->c2.to_tun));
+
     /*
      * The --mssfix option requires
      * us to examine the IP header (IPv4 or IPv6).
@@ -1729,7 +2416,7 @@ process_outgoing_tun(struct context *c)
                       PIP_MSSFIX | PIPV4_EXTRACT_DHCP_ROUTER | PIPV4_CLIENT_NAT | PIP_OUTGOING,
                       &c->c2.to_tun);
 
-    if (c->c2.to_tun.len <= MAX_RW_SIZE_TUN(&c->c2.frame))
+    if (c->c2.to_tun.len <= c->c2.frame.layout.payload_size)
     {
         /*
          * Write to TUN/TAP device.
@@ -1770,8 +2457,8 @@ process_outgoing_tun(struct context *c)
             /* Did we write a different size packet than we intended? */
             if (size != BLEN(&c->c2.to_tun))
             {
-                msg(D_LINK_ERRORS,
-                    "TUN/TAP packet was destructively fragmented on write to %s (tried=%d,actual=%d)",
+                msg_rl(D_LINK_ERRORS,
+                       "TUN/TAP packet was destructively fragmented on write to %s (tried=%d,actual=%d)",
                     c->c1.tuntap->actual_name,
                     BLEN(&c->c2.to_tun),
                     size);
@@ -1787,7 +2474,7 @@ process_outgoing_tun(struct context *c)
          * This should never happen, probably indicates some kind
          * of MTU mismatch.
          */
-        msg(D_LINK_ERRORS, "tun packet too large on write (tried=%d,max=%d)",
+        msg_rl(D_LINK_ERRORS, "tun packet too large on write (tried=%d,max=%d)",
             c->c2.to_tun.len,
             MAX_RW_SIZE_TUN(&c->c2.frame));
     }
@@ -1798,11 +2485,99 @@ process_outgoing_tun(struct context *c)
     gc_free(&gc);
 }
 
+/*
+ * --realtime: check the housekeeping budget after a pre_select() stage.
+ * When the budget is spent, remember which stage to resume at and turn
+ * the upcoming event wait into a poll, so pending data packets are
+ * serviced before the remaining control work runs on the next
+ * iteration.  Returns true if the caller must stop the current pass.
+ */
+static inline bool
+housekeeping_defer(struct context *c, const int stage)
+{
+    if (!c->options.realtime_budget)
+    {
+        return false;
+    }
+
+    struct timeval tv;
+    openvpn_gettimeofday(&tv, NULL);
+    if (tv_subtract(&tv, &c->c2.hk_entry, 10) < c->options.realtime_budget)
+    {
+        return false;
+    }
+
+    c->c2.hk_stage = stage;
+    ++c->c2.hk_slices;
+    c->c2.pre_select_deadline = 0;
+    c->c2.timeval.tv_sec = 0;
+    c->c2.timeval.tv_usec = 0;
+    return true;
+}
+
+/*
+ * --realtime: instrument the completed housekeeping pass.  A stage that
+ * cannot be sliced internally (a single TLS computation, say) can still
+ * overrun the budget; track the worst case and complain -- rate
+ * limited -- so SLA violations are visible rather than silent.
+ */
+static inline void
+housekeeping_finish(struct context *c)
+{
+    if (!c->options.realtime_budget)
+    {
+        return;
+    }
+
+    struct timeval tv;
+    openvpn_gettimeofday(&tv, NULL);
+    const int elapsed = tv_subtract(&tv, &c->c2.hk_entry, 10);
+    if (elapsed > c->c2.hk_max_us)
+    {
+        c->c2.hk_max_us = elapsed;
+        dmsg(D_INTERVAL, "REALTIME: worst housekeeping slice so far %d usec", elapsed);
+    }
+    if (elapsed > c->options.realtime_budget)
+    {
+        msg_rl(D_LOW, "REALTIME: housekeeping slice overran budget (%d > %d usec)",
+               elapsed, c->options.realtime_budget);
+    }
+}
+
 void
 pre_select(struct context *c)
 {
     /* make sure current time (now) is updated on function entry */
 
+    /*
+     * Fast path: the previous full pass recorded the earliest deadline
+     * of all the checks below in pre_select_deadline, and every event
+     * which creates work for one of them in between zeroes it (see
+     * context_wakeup_pre_select).  Until the deadline expires, none of
+     * the checks can have anything to do, so skip straight to the
+     * residual timeout.  TLS error counters are raised from packet
+     * processing without a wakeup call, so they are still polled here.
+     */
+    if (now < c->c2.pre_select_deadline
+#ifdef ENABLE_DEBUG
+        && !c->options.bench_traffic_n
+#endif
+#if defined(_WIN32)
+        && !check_debug_level(D_TAP_WIN_DEBUG)
+#endif
+        )
+    {
+        check_tls_errors(c);
+        if (c->sig->signal_received)
+        {
+            return;
+        }
+        c->c2.timeval.tv_sec = c->c2.pre_select_deadline - now;
+        c->c2.timeval.tv_usec = 0;
+        check_timeout_random_component(c);
+        return;
+    }
+
     /*
      * Start with an effectively infinite timeout, then let it
      * reduce to a timeout that reflects the component which
@@ -1811,6 +2586,11 @@ pre_select(struct context *c)
     c->c2.timeval.tv_sec = BIG_TIMEOUT;
     c->c2.timeval.tv_usec = 0;
 
+    if (c->options.realtime_budget)
+    {
+        openvpn_gettimeofday(&c->c2.hk_entry, NULL);
+    }
+
 #if defined(_WIN32)
     if (check_debug_level(D_TAP_WIN_DEBUG))
     {
@@ -1822,15 +2602,21 @@ pre_select(struct context *c)
     }
 #endif
 
-    /* check coarse timers? */
+    /* check coarse timers?  Cheap when resuming a sliced pass, since
+     * the pass that ran them pushed the wakeup into the future. */
     check_coarse_timers(c);
     if (c->sig->signal_received)
     {
         return;
     }
 
+    if (c->c2.hk_stage == 0 && housekeeping_defer(c, 1))
+    {
+        return;
+    }
+
     /* If tls is enabled, do tls control channel packet processing. */
-    if (c->c2.tls_multi)
+    if (c->c2.hk_stage <= 1 && c->c2.tls_multi)
     {
         check_tls(c);
     }
@@ -1842,6 +2628,11 @@ pre_select(struct context *c)
         return;
     }
 
+    if (c->c2.hk_stage <= 1 && housekeeping_defer(c, 2))
+    {
+        return;
+    }
+
 #if P2MP
     /* check for incoming control messages on the control channel like
      * push request/reply, or authentication failure and 2FA messages */
@@ -1862,6 +2653,28 @@ pre_select(struct context *c)
     }
 #endif
 
+#ifdef ENABLE_DEBUG
+    /* Inject synthetic benchmark traffic into the tun input path */
+    if (c->options.bench_traffic_n)
+    {
+        trafgen_pre_select(c);
+    }
+#endif
+
+    c->c2.hk_stage = 0;
+    housekeeping_finish(c);
+
+    /* Arm the fast path with the earliest wakeup computed above;
+     * a zero timeout means there is immediate work left to do. */
+    if (!c->sig->signal_received && c->c2.timeval.tv_sec > 0)
+    {
+        c->c2.pre_select_deadline = now + c->c2.timeval.tv_sec;
+    }
+    else
+    {
+        c->c2.pre_select_deadline = 0;
+    }
+
     /* Update random component of timeout */
     check_timeout_random_component(c);
 }
@@ -1889,6 +2702,13 @@ io_wait_dowork(struct context *c, const unsigned int flags)
 #ifdef ENABLE_ASYNC_PUSH
     static int file_shift = 8;     /* listening inotify events */
 #endif
+#ifdef ENABLE_WORKER_THREADS
+    static int worker_shift = 10;  /* worker pool completion events */
+#endif
+#ifndef _WIN32
+    static int tls_async_shift = 12; /* crypto library async wait fd */
+    static int migrate_shift = 14;   /* --float-migration sibling queries */
+#endif
 
     /*
      * Decide what kind of events we want to wait for.
@@ -1997,14 +2817,39 @@ io_wait_dowork(struct context *c, const unsigned int flags)
 
     /*
      * Configure event wait based on socket, tuntap flags.
+     *
+     * On a persistent backend (epoll, scalable poll/select) the
+     * registrations survive event_wait(), so we track what is armed
+     * for every event source below and skip the event_ctl() syscalls
+     * entirely while it is unchanged -- zero re-registration calls in
+     * steady-state forwarding.
+     * The link socket is only tracked for datagram transports since
+     * socket_set() may locally clear EVENT_READ on a TCP socket with
+     * buffered stream data.
      */
-    socket_set(c->c2.link_socket, c->c2.event_set, socket, (void *)&socket_shift, NULL);
-    tun_set(c->c1.tuntap, c->c2.event_set, tuntap, (void *)&tun_shift, NULL);
+    unsigned int *link_persist = NULL;
+    unsigned int *tun_persist = NULL;
+    unsigned int *management_persist = NULL;
+    const bool persistent = event_persistent(c->c2.event_set);
+    if (persistent)
+    {
+        if (c->c2.link_socket && proto_is_dgram(c->c2.link_socket->info.proto))
+        {
+            link_persist = &c->c2.link_set_rwflags;
+        }
+        tun_persist = &c->c2.tun_set_rwflags;
+#ifdef ENABLE_MANAGEMENT
+        management_persist = &c->c2.management_set_state;
+#endif
+    }
+    socket_set(c->c2.link_socket, c->c2.event_set, socket, (void *)&socket_shift, link_persist);
+    tun_set(c->c1.tuntap, c->c2.event_set, tuntap, (void *)&tun_shift, tun_persist);
 
 #ifdef ENABLE_MANAGEMENT
     if (management)
     {
-        management_socket_set(management, c->c2.event_set, (void *)&management_shift, NULL);
+        management_socket_set(management, c->c2.event_set, (void *)&management_shift,
+                              management_persist);
     }
 #endif
 
@@ -2012,7 +2857,38 @@ io_wait_dowork(struct context *c, const unsigned int flags)
     /* arm inotify watcher */
     if (c->options.mode == MODE_SERVER)
     {
-        event_ctl(c->c2.event_set, c->c2.inotify_fd, EVENT_READ, (void *)&file_shift);
+        event_ctl_read_persist(c->c2.event_set, c->c2.inotify_fd,
+                               (void *)&file_shift, &c->c2.inotify_set_fd);
+    }
+#endif
+
+#ifdef ENABLE_WORKER_THREADS
+    /* arm worker pool completion pipe */
+    if (c->options.mode == MODE_SERVER && c->c2.worker_completion_fd > 0)
+    {
+        event_ctl_read_persist(c->c2.event_set, c->c2.worker_completion_fd,
+                               (void *)&worker_shift, &c->c2.worker_set_fd);
+    }
+#endif
+
+#ifndef _WIN32
+    /* arm the crypto library's async wait fd, so that completion of an
+     * offloaded TLS operation wakes us instead of the 1-second re-poll */
+    if (c->options.tls_async && c->c2.tls_multi)
+    {
+        const int tls_async_fd = tls_multi_async_fd(c->c2.tls_multi);
+        if (tls_async_fd >= 0)
+        {
+            event_ctl_read_persist(c->c2.event_set, tls_async_fd,
+                                   (void *)&tls_async_shift, &c->c2.tls_async_set_fd);
+        }
+    }
+
+    /* arm the --float-migration sibling query listener */
+    if (c->options.mode == MODE_SERVER && c->c2.migrate_fd > 0)
+    {
+        event_ctl_read_persist(c->c2.event_set, c->c2.migrate_fd,
+                               (void *)&migrate_shift, &c->c2.migrate_set_fd);
     }
 #endif
 
@@ -2028,9 +2904,34 @@ io_wait_dowork(struct context *c, const unsigned int flags)
 
     c->c2.event_set_status = ES_ERROR;
 
+#ifdef ENABLE_UDP_MMSG
+    /* push out any batched datagrams before waiting */
+    link_socket_mmsg_flush(c->c2.link_socket);
+#endif
+
     if (!c->sig->signal_received)
     {
-        if (!(flags & IOW_CHECK_RESIDUAL) || !socket_read_residual(c->c2.link_socket))
+        if ((flags & IOW_CHECK_RESIDUAL) && socket_read_residual(c->c2.link_socket))
+        {
+            c->c2.event_set_status = SOCKET_READ;
+        }
+        else if (c->options.event_drain > 0
+                 && c->c2.event_drain_budget > 0
+                 && !c->c2.link_read_empty
+                 && (flags & IOW_READ_LINK)
+                 && !(flags & (IOW_TO_TUN|IOW_TO_LINK|IOW_MBUF)))
+        {
+            /*
+             * --event-drain: the last link read returned a packet, so more
+             * are likely queued behind it.  Claim readability and let the
+             * non-blocking read discover EAGAIN, instead of paying an
+             * event_wait() kernel round trip per datagram.  The budget
+             * bounds how long timers and other fds can be deferred.
+             */
+            c->c2.event_set_status = SOCKET_READ;
+            --c->c2.event_drain_budget;
+        }
+        else
         {
             int status;
 
@@ -2044,7 +2945,9 @@ io_wait_dowork(struct context *c, const unsigned int flags)
             /*
              * Wait for something to happen.
              */
+            perf_loop_exit();
             status = event_wait(c->c2.event_set, &c->c2.timeval, esr, SIZE(esr));
+            perf_loop_enter();
 
             check_status(status, "event_wait", NULL, NULL);
 
@@ -2062,15 +2965,15 @@ io_wait_dowork(struct context *c, const unsigned int flags)
             {
                 c->c2.event_set_status = ES_TIMEOUT;
             }
-        }
-        else
-        {
-            c->c2.event_set_status = SOCKET_READ;
+
+            c->c2.event_drain_budget = c->options.event_drain;
         }
     }
 
-    /* 'now' should always be a reasonably up-to-date timestamp */
-    update_time();
+    /* 'now' should always be a reasonably up-to-date timestamp; this is
+     * also the per-pass refresh point for the coarse time cache used by
+     * per-packet consumers such as the shaper */
+    time_cache_refresh();
 
     /* set signal_received if a signal was received */
     if (c->c2.event_set_status & ES_ERROR)
@@ -2081,6 +2984,29 @@ io_wait_dowork(struct context *c, const unsigned int flags)
     dmsg(D_EVENT_WAIT, "I/O WAIT status=0x%04x", c->c2.event_set_status);
 }
 
+#if defined(TARGET_LINUX)
+/*
+ * --tun-offload, point-to-point: feed queued GSO segments into the
+ * encrypt path while the link output slot is free.  With --prio-queue
+ * the segment lands in the staging queue, so promote it immediately;
+ * either way the loop stops as soon as to_link is occupied, which
+ * paces emission at one segment per link write.
+ */
+static void
+tun_gso_drain(struct context *c)
+{
+    while (!IS_SIG(c) && c->c2.to_link.len == 0 && tun_gso_pending(c))
+    {
+        tun_gso_emit(c);
+        process_incoming_tun(c);
+        if (c->c2.pq && c->c2.to_link.len == 0)
+        {
+            prio_queue_encrypt_next(c);
+        }
+    }
+}
+#endif /* defined(TARGET_LINUX) */
+
 void
 process_io(struct context *c)
 {
@@ -2094,10 +3020,28 @@ process_io(struct context *c)
     }
 #endif
 
+#ifndef _WIN32
+    /* crypto library async operation completed -- run check_tls() on the
+     * next pre_select pass instead of waiting out the re-poll interval */
+    if (status & TLS_ASYNC_READY)
+    {
+        interval_action(&c->c2.tmp_int);
+        context_wakeup_pre_select(c);
+    }
+#endif
+
     /* TCP/UDP port ready to accept write */
     if (status & SOCKET_WRITE)
     {
         process_outgoing_link(c);
+        /* link slot freed -- promote the most urgent staged packet */
+        if (c->c2.pq && c->c2.to_link.len == 0)
+        {
+            prio_queue_encrypt_next(c);
+        }
+#if defined(TARGET_LINUX)
+        tun_gso_drain(c);
+#endif
     }
     /* TUN device ready to accept write */
     else if (status & TUN_WRITE)
@@ -2121,5 +3065,8 @@ process_io(struct context *c)
         {
             process_incoming_tun(c);
         }
+#if defined(TARGET_LINUX)
+        tun_gso_drain(c);
+#endif
     }
 }
@@ -64,6 +64,65 @@
 
 #define IOW_READ            (IOW_READ_TUN|IOW_READ_LINK)
 
+/*
+ * 3-band strict-priority staging queue between tun read and
+ * encrypt_sign(), enabled with --prio-queue.  Band 0 (interactive)
+ * overtakes band 1 (normal) overtakes band 2 (bulk); each band is a
+ * ring of preallocated packet buffers with per-band tail drop.
+ */
+#define PRIO_QUEUE_BANDS 3
+
+struct prio_queue_band
+{
+    struct buffer *pkts;        /* ring of capacity packet buffers */
+    int head;
+    int len;
+};
+
+struct prio_queue
+{
+    int capacity;               /* packet slots per band */
+    struct prio_queue_band band[PRIO_QUEUE_BANDS];
+    counter_type n_dropped;     /* arrivals dropped on a full band */
+};
+
+struct prio_queue *prio_queue_init(int capacity, const struct frame *frame);
+
+void prio_queue_free(struct prio_queue *pq);
+
+void prio_queue_put(struct prio_queue *pq, const struct buffer *buf, int tunnel_type);
+
+bool prio_queue_get(struct prio_queue *pq, struct buffer *buf);
+
+void prio_queue_encrypt_next(struct context *c);
+
+#if defined(TARGET_LINUX)
+/* --tun-offload: are segments of a GSO super-packet still queued? */
+static inline bool
+tun_gso_pending(const struct context *c)
+{
+    return c->c2.gso_remaining > 0;
+}
+
+void tun_gso_emit(struct context *c);
+
+#endif
+
+/* can at least one band accept another packet? */
+static inline bool
+prio_queue_room(const struct prio_queue *pq)
+{
+    int i;
+    for (i = 0; i < PRIO_QUEUE_BANDS; ++i)
+    {
+        if (pq->band[i].len < pq->capacity)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 extern counter_type link_read_bytes_global;
 
 extern counter_type link_write_bytes_global;
@@ -324,6 +383,7 @@ send_control_channel_string_dowork(struct tls_multi *multi,
 #define PIPV4_CLIENT_NAT                (1<<4)
 #define PIPV6_IMCP_NOHOST_CLIENT        (1<<5)
 #define PIPV6_IMCP_NOHOST_SERVER        (1<<6)
+#define PIP_RECORD_DSCP                 (1<<7)         /* v4 and v6 */
 
 void process_ip_header(struct context *c, unsigned int flags, struct buffer *buf);
 
@@ -345,18 +405,29 @@ get_link_socket_info(struct context *c)
     }
 }
 
+/*
+ * Credit tunnel activity towards --inactive.  This runs once per
+ * packet, so it is a bare counter bump; the inactivity timeout samples
+ * and resets the counter when it expires (check_inactivity_timeout),
+ * keeping all timer manipulation off the packet path.
+ */
 static inline void
 register_activity(struct context *c, const int size)
 {
-    if (c->options.inactivity_timeout)
-    {
-        c->c2.inactivity_bytes += size;
-        if (c->c2.inactivity_bytes >= c->options.inactivity_minimum_bytes)
-        {
-            c->c2.inactivity_bytes = 0;
-            event_timeout_reset(&c->c2.inactivity_interval);
-        }
-    }
+    c->c2.inactivity_bytes += size;
+}
+
+/*
+ * Invalidate the deadline cached by the last full pre_select() pass,
+ * so that the next event loop iteration runs all per-subsystem timer
+ * checks.  Must be called whenever an event outside of pre_select()
+ * creates work for one of the checks it gates, e.g. control channel
+ * activity or a queued outgoing fragment.
+ */
+static inline void
+context_wakeup_pre_select(struct context *c)
+{
+    c->c2.pre_select_deadline = 0;
 }
 
 /*
@@ -375,6 +446,12 @@ p2p_iow_flags(const struct context *c)
     {
         flags |= IOW_TO_TUN;
     }
+    /* with --prio-queue, keep reading from tun while the link is busy
+     * so urgent packets can overtake what is already staged */
+    if (c->c2.pq && c->c2.to_link.len > 0 && prio_queue_room(c->c2.pq))
+    {
+        flags |= IOW_READ_TUN_FORCE;
+    }
 #ifdef _WIN32
     if (tuntap_ring_empty(c->c1.tuntap))
     {
@@ -436,8 +513,24 @@ io_wait(struct context *c, const unsigned int flags)
         else
 #endif /* ifdef _WIN32 */
         {
-            /* slow path */
-            io_wait_dowork(c, flags);
+#ifdef _WIN32
+            /*
+             * Wintun with a --wintun-spin budget: when the loop is idle
+             * (nothing queued for tun or link), burn the spin budget on
+             * the send ring before paying for a kernel event wait.
+             */
+            if (tuntap_is_wintun(c->c1.tuntap)
+                && !(flags & (IOW_TO_TUN|IOW_TO_LINK|IOW_MBUF))
+                && wintun_ring_spin(c->c1.tuntap))
+            {
+                c->c2.event_set_status = TUN_READ;
+            }
+            else
+#endif
+            {
+                /* slow path */
+                io_wait_dowork(c, flags);
+            }
         }
     }
 }
@@ -41,50 +41,129 @@
 
 static void
 fragment_list_buf_init(struct fragment_list *list, const struct frame *frame)
+{
+    /* buffers are allocated lazily by fragment_list_get_buf() as
+     * concurrent reassemblies actually materialize */
+}
+
+static void
+fragment_list_buf_free(struct fragment_list *list)
 {
     int i;
-    for (i = 0; i < N_FRAG_BUF; ++i)
+    for (i = 0; i < N_SEQ_ID; ++i)
+    {
+        free_buf(&list->slots[i].buf);
+    }
+    for (i = 0; i < list->n_free; ++i)
     {
-        list->fragments[i].buf = alloc_buf(BUF_SIZE(frame));
+        free_buf(&list->free_bufs[i]);
     }
 }
 
 static void
-fragment_list_buf_free(struct fragment_list *list)
+fragment_lru_unlink(struct fragment_list *list, struct fragment *frag)
 {
-    int i;
-    for (i = 0; i < N_FRAG_BUF; ++i)
+    if (frag->lru_prev)
+    {
+        frag->lru_prev->lru_next = frag->lru_next;
+    }
+    else
+    {
+        list->lru_head = frag->lru_next;
+    }
+    if (frag->lru_next)
     {
-        free_buf(&list->fragments[i].buf);
+        frag->lru_next->lru_prev = frag->lru_prev;
     }
+    else
+    {
+        list->lru_tail = frag->lru_prev;
+    }
+    frag->lru_prev = frag->lru_next = NULL;
+}
+
+static void
+fragment_lru_append(struct fragment_list *list, struct fragment *frag)
+{
+    frag->lru_prev = list->lru_tail;
+    frag->lru_next = NULL;
+    if (list->lru_tail)
+    {
+        list->lru_tail->lru_next = frag;
+    }
+    else
+    {
+        list->lru_head = frag;
+    }
+    list->lru_tail = frag;
+}
+
+/* record activity on a reassembly so it expires last */
+static void
+fragment_list_touch(struct fragment_list *list, struct fragment *frag)
+{
+    frag->timestamp = now;
+    fragment_lru_unlink(list, frag);
+    fragment_lru_append(list, frag);
+}
+
+/* stop reassembling a packet and return its buffer to the pool */
+static void
+fragment_list_drop(struct fragment_list *list, struct fragment *frag)
+{
+    fragment_lru_unlink(list, frag);
+    ASSERT(list->n_free < N_FRAG_BUF);
+    list->free_bufs[list->n_free++] = frag->buf;
+    CLEAR(frag->buf);
+    frag->defined = false;
 }
 
 /*
- * Given a sequence ID number, get a fragment buffer.  Use a sliding window,
- * similar to packet_id code.
+ * Given a sequence ID number, get a fragment buffer.  The table is
+ * indexed directly by sequence ID, so concurrent reassemblies are
+ * found in constant time no matter how far apart their IDs are.  A
+ * slot without a buffer borrows one from the pool, growing the pool up
+ * to N_FRAG_BUF buffers and beyond that sacrificing the longest-idle
+ * reassembly, which on a lossy link is the one least likely to ever
+ * complete.
  */
 static struct fragment *
-fragment_list_get_buf(struct fragment_list *list, int seq_id)
+fragment_list_get_buf(struct fragment_list *list, int seq_id,
+                      const struct frame *frame)
 {
-    int diff;
-    if (abs(diff = modulo_subtract(seq_id, list->seq_id, N_SEQ_ID)) >= N_FRAG_BUF)
+    struct fragment *frag = &list->slots[seq_id & (N_SEQ_ID - 1)];
+
+    /*
+     * Sequence IDs wrap; a partial reassembly older than the TTL
+     * cannot belong to the same original packet, so don't merge into
+     * it.
+     */
+    if (frag->defined && frag->timestamp + FRAG_TTL_SEC <= now)
     {
-        int i;
-        for (i = 0; i < N_FRAG_BUF; ++i)
-        {
-            list->fragments[i].defined = false;
-        }
-        list->index = 0;
-        list->seq_id = seq_id;
-        diff = 0;
+        fragment_list_drop(list, frag);
     }
-    while (diff > 0)
+
+    if (!frag->defined && !frag->buf.capacity)
     {
-        list->fragments[list->index = modulo_add(list->index, 1, N_FRAG_BUF)].defined = false;
-        list->seq_id = modulo_add(list->seq_id, 1, N_SEQ_ID);
-        --diff;
+        if (list->n_free > 0)
+        {
+            frag->buf = list->free_bufs[--list->n_free];
+        }
+        else if (list->n_alloc < N_FRAG_BUF)
+        {
+            frag->buf = alloc_buf(BUF_SIZE(frame));
+            ++list->n_alloc;
+        }
+        else
+        {
+            struct fragment *victim = list->lru_head;
+            ASSERT(victim);
+            msg(D_FRAG_ERRORS, "FRAG: buffer pool exhausted, dropping oldest reassembly");
+            fragment_list_drop(list, victim);
+            frag->buf = list->free_bufs[--list->n_free];
+        }
     }
-    return &list->fragments[modulo_add(list->index, diff, N_FRAG_BUF)];
+    return frag;
 }
 
 struct fragment_master *
@@ -189,9 +268,6 @@ fragment_incoming(struct fragment_master *f, struct buffer *buf,
                               ? (int)(((flags >> FRAG_SIZE_SHIFT) & FRAG_SIZE_MASK) << FRAG_SIZE_ROUND_SHIFT)
                               : buf->len);
 
-            /* get the appropriate fragment buffer based on received seq_id */
-            struct fragment *frag = fragment_list_get_buf(&f->incoming, seq_id);
-
             dmsg(D_FRAG_DEBUG,
                  "FRAG_IN len=%d type=%d seq_id=%d frag_id=%d size=%d flags="
                  fragment_header_format,
@@ -208,13 +284,20 @@ fragment_incoming(struct fragment_master *f, struct buffer *buf,
                 FRAG_ERR("bad fragment size");
             }
 
+            /* get the appropriate fragment buffer based on received seq_id */
+            struct fragment *frag = fragment_list_get_buf(&f->incoming, seq_id, frame);
+
             /* is this the first fragment for our sequence number? */
             if (!frag->defined || frag->max_frag_size != size)
             {
-                frag->defined = true;
+                if (!frag->defined)
+                {
+                    fragment_lru_append(&f->incoming, frag);
+                    frag->defined = true;
+                }
                 frag->max_frag_size = size;
                 frag->map = 0;
-                ASSERT(buf_init(&frag->buf, FRAME_HEADROOM_ADJ(frame, FRAME_HEADROOM_MARKER_FRAGMENT)));
+                ASSERT(buf_init(&frag->buf, frame->layout.headroom_fragment));
             }
 
             /* copy the data to fragment buffer */
@@ -227,13 +310,19 @@ fragment_incoming(struct fragment_master *f, struct buffer *buf,
             frag->map |= (((frag_type == FRAG_YES_LAST) ? FRAG_MAP_MASK : 1) << n);
 
             /* update timestamp on partially built datagram */
-            frag->timestamp = now;
+            fragment_list_touch(&f->incoming, frag);
 
             /* received full datagram? */
             if ((frag->map & FRAG_MAP_MASK) == FRAG_MAP_MASK)
             {
-                frag->defined = false;
+                /*
+                 * Hand the reassembled packet to the caller and return
+                 * the buffer to the pool; it cannot be re-used before
+                 * the caller is done with it, since that would require
+                 * another call into this function.
+                 */
                 *buf = frag->buf;
+                fragment_list_drop(&f->incoming, frag);
             }
             else
             {
@@ -345,10 +434,11 @@ fragment_outgoing(struct fragment_master *f, struct buffer *buf,
             {
                 FRAG_ERR("too many fragments would be required to send datagram");
             }
-            ASSERT(buf_init(&f->outgoing, FRAME_HEADROOM(frame)));
+            ASSERT(buf_init(&f->outgoing, frame->layout.headroom));
             ASSERT(buf_copy(&f->outgoing, buf));
             f->outgoing_seq_id = modulo_add(f->outgoing_seq_id, 1, N_SEQ_ID);
             f->outgoing_frag_id = 0;
+            ++f->n_packets_fragmented;
             buf->len = 0;
             ASSERT(fragment_ready_to_send(f, buf, frame));
         }
@@ -394,7 +484,7 @@ fragment_ready_to_send(struct fragment_master *f, struct buffer *buf,
 
         /* initialize return buffer */
         *buf = f->outgoing_return;
-        ASSERT(buf_init(buf, FRAME_HEADROOM(frame)));
+        ASSERT(buf_init(buf, frame->layout.headroom));
         ASSERT(buf_copy_n(buf, &f->outgoing, size));
 
         /* fragment flags differ based on whether or not we are sending the last fragment */
@@ -417,15 +507,16 @@ fragment_ready_to_send(struct fragment_master *f, struct buffer *buf,
 static void
 fragment_ttl_reap(struct fragment_master *f)
 {
-    int i;
-    for (i = 0; i < N_FRAG_BUF; ++i)
+    /*
+     * The active list is ordered by last update, so only the entries
+     * that actually expired are visited.
+     */
+    struct fragment *frag;
+    while ((frag = f->incoming.lru_head) && frag->timestamp + FRAG_TTL_SEC <= now)
     {
-        struct fragment *frag = &f->incoming.fragments[i];
-        if (frag->defined && frag->timestamp + FRAG_TTL_SEC <= now)
-        {
-            msg(D_FRAG_ERRORS, "FRAG TTL expired i=%d", i);
-            frag->defined = false;
-        }
+        msg(D_FRAG_ERRORS, "FRAG TTL expired i=%d",
+            (int)(frag - f->incoming.slots));
+        fragment_list_drop(&f->incoming, frag);
     }
 }
 
@@ -46,10 +46,12 @@
 #include "error.h"
 
 
-#define N_FRAG_BUF                   25
-/**< Number of packet buffers for
+#define N_FRAG_BUF                   64
+/**< Number of pooled packet buffers for
  *   reassembling incoming fragmented
- *   packets. */
+ *   packets.  Buffers are allocated
+ *   lazily as concurrent reassemblies
+ *   actually materialize. */
 
 #define FRAG_TTL_SEC                 10
 /**< Time-to-live in seconds for a %fragment. */
@@ -58,6 +60,11 @@
 /**< Interval in seconds between calls to
  *   wakeup code. */
 
+#define N_SEQ_ID            256
+/**< One more than the maximum fragment
+ *   sequence ID, above which the IDs wrap
+ *   to zero.  Should be a power of 2. */
+
 /**************************************************************************/
 /**
  * Structure for reassembling one incoming fragmented packet.
@@ -84,34 +91,47 @@ struct fragment {
     time_t timestamp;           /**< Timestamp for time-to-live purposes. */
 
     struct buffer buf;          /**< Buffer in which received datagrams
-                                 *   are reassembled. */
+                                 *   are reassembled, borrowed from the
+                                 *   \c fragment_list buffer pool while
+                                 *   reassembly is in progress. */
+
+    struct fragment *lru_prev;  /**< Less recently updated neighbour on
+                                 *   the active reassembly list. */
+    struct fragment *lru_next;  /**< More recently updated neighbour on
+                                 *   the active reassembly list. */
 };
 
 
 /**
- * List of fragment structures for reassembling multiple incoming packets
+ * Table of fragment structures for reassembling multiple incoming packets
  * concurrently.
- */
-struct fragment_list {
-    int seq_id;                 /**< Highest fragmentation sequence ID of
-                                 *   the packets currently being
-                                 *   reassembled. */
-    int index;                  /**< Index of the packet being reassembled
-                                 *   with the highest fragmentation
-                                 *   sequence ID into the \c
-                                 *   fragment_list.fragments array. */
-
-/** Array of reassembly structures, each can contain one whole packet.
  *
- *  The fragmentation sequence IDs of the packets being reassembled in
- *  this array are linearly increasing. \c
- *  fragment_list.fragments[fragment_list.index] has an ID of \c
- *  fragment_list.seq_id.  This means that one of these \c fragment_list
- *  structures can at any one time contain at most packets with the
- *  fragmentation sequence IDs in the range \c fragment_list.seq_id \c -
- *  \c N_FRAG_BUF \c + \c 1 to \c fragment_list.seq_id, inclusive.
+ * Reassembly state is indexed directly by the 8-bit fragmentation
+ * sequence ID, so any mix of up to \c N_FRAG_BUF packets can be in
+ * reassembly at the same time no matter how far apart their sequence
+ * IDs are.  The packet buffers themselves come from a lazily allocated
+ * pool; when the pool is exhausted the longest-idle reassembly is
+ * dropped, since on a lossy link it is the one least likely to ever
+ * complete.  Active reassemblies are kept on a list ordered by last
+ * update, so time-to-live reaping only touches entries that actually
+ * expired.
  */
-    struct fragment fragments[N_FRAG_BUF];
+struct fragment_list {
+    struct fragment slots[N_SEQ_ID];
+    /**< Reassembly state, indexed by
+     *   fragmentation sequence ID. */
+
+    struct fragment *lru_head;  /**< Least recently updated active
+                                 *   reassembly. */
+    struct fragment *lru_tail;  /**< Most recently updated active
+                                 *   reassembly. */
+
+    struct buffer free_bufs[N_FRAG_BUF];
+    /**< Pool of currently unused packet
+     *   buffers. */
+    int n_free;                 /**< Number of buffers in \c free_bufs. */
+    int n_alloc;                /**< Total pool buffers allocated so far,
+                                 *   at most \c N_FRAG_BUF. */
 };
 
 
@@ -139,10 +159,10 @@ struct fragment_master {
                                   *   fragmentation housekeeping. */
     bool received_os_mtu_hint;  /**< Whether the operating system has
                                  *   explicitly recommended an MTU value. */
-#define N_SEQ_ID            256
-    /**< One more than the maximum fragment
-     *   sequence ID, above which the IDs wrap
-     *   to zero.  Should be a power of 2. */
+    int n_packets_fragmented;   /**< Number of outgoing datagrams split
+                                 *   into multiple parts since the MTU
+                                 *   tuner last sampled this counter
+                                 *   (--mtu-tuner). */
     int outgoing_seq_id;        /**< Fragment sequence ID of the current
                                  *   fragmented packet waiting to be sent.
                                  *
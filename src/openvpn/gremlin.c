@@ -41,6 +41,7 @@
 #include "crypto.h"
 #include "misc.h"
 #include "otime.h"
+#include "socket.h"
 #include "gremlin.h"
 
 #include "memdbg.h"
@@ -234,6 +235,180 @@ corrupt_gremlin(struct buffer *buf, int flags)
     }
 }
 
+/*
+ * Link read record/replay.
+ *
+ * Trace file format: an 8-byte magic, then a sequence of records, each
+ *
+ *   struct gremlin_trace_hdr  (fixed size, host byte order)
+ *   <addrlen bytes of raw sockaddr>
+ *   <paylen bytes of packet payload>
+ *
+ * The capture file acts as a ring: when it exceeds
+ * GREMLIN_TRACE_MAX_BYTES the file is truncated at the current write
+ * position and writing rewinds to just after the magic, so the trace
+ * always holds the most recent contiguous run of records and replay
+ * can simply read until EOF.
+ */
+
+#define GREMLIN_TRACE_MAGIC     "OVPNTRC1"
+#define GREMLIN_TRACE_MAX_BYTES (256 * 1024 * 1024)
+
+struct gremlin_trace_hdr
+{
+    uint64_t sec;               /* timestamp of the read */
+    uint32_t usec;
+    uint32_t addrlen;           /* length of the raw source sockaddr */
+    uint32_t paylen;            /* length of the packet payload */
+};
+
+static FILE *trace_write_fp;
+static FILE *trace_read_fp;
+static bool trace_write_failed;
+static uint64_t trace_records;
+
+void
+gremlin_trace_capture(const char *file, const struct buffer *buf,
+                      const struct link_socket_actual *from)
+{
+    struct gremlin_trace_hdr hdr;
+    struct timeval tv;
+
+    if (trace_write_failed || BLEN(buf) <= 0)
+    {
+        return;
+    }
+    if (!trace_write_fp)
+    {
+        trace_write_fp = fopen(file, "wb");
+        if (!trace_write_fp
+            || fwrite(GREMLIN_TRACE_MAGIC, sizeof(GREMLIN_TRACE_MAGIC) - 1,
+                      1, trace_write_fp) != 1)
+        {
+            msg(M_WARN | M_ERRNO,
+                "GREMLIN: cannot write capture file %s, capture disabled", file);
+            trace_write_failed = true;
+            return;
+        }
+    }
+
+    CLEAR(hdr);
+    openvpn_gettimeofday(&tv, NULL);
+    hdr.sec = tv.tv_sec;
+    hdr.usec = tv.tv_usec;
+    hdr.addrlen = af_addr_size(from->dest.addr.sa.sa_family);
+    hdr.paylen = BLEN(buf);
+
+    if (fwrite(&hdr, sizeof(hdr), 1, trace_write_fp) != 1
+        || (hdr.addrlen
+            && fwrite(&from->dest.addr.sa, hdr.addrlen, 1, trace_write_fp) != 1)
+        || fwrite(BPTR(buf), hdr.paylen, 1, trace_write_fp) != 1)
+    {
+        msg(M_WARN | M_ERRNO, "GREMLIN: capture write error, capture disabled");
+        trace_write_failed = true;
+        return;
+    }
+    ++trace_records;
+
+    if (ftell(trace_write_fp) >= GREMLIN_TRACE_MAX_BYTES)
+    {
+        /* wrap the ring: overwrite from just after the magic; the stale
+         * tail beyond the write position is cut off on close */
+        fseek(trace_write_fp, sizeof(GREMLIN_TRACE_MAGIC) - 1, SEEK_SET);
+    }
+}
+
+void
+gremlin_trace_capture_close(void)
+{
+    if (trace_write_fp)
+    {
+        /* discard records after the write position from a previous lap */
+        fflush(trace_write_fp);
+#if defined(HAVE_FTRUNCATE)
+        if (ftruncate(fileno(trace_write_fp), (off_t)ftell(trace_write_fp)) != 0)
+        {
+            msg(M_WARN | M_ERRNO, "GREMLIN: cannot truncate capture file");
+        }
+#elif defined(HAVE_CHSIZE)
+        chsize(fileno(trace_write_fp), (long)ftell(trace_write_fp));
+#endif
+        fclose(trace_write_fp);
+        trace_write_fp = NULL;
+        msg(M_INFO, "GREMLIN: capture closed after %" PRIu64 " records",
+            trace_records);
+    }
+}
+
+bool
+gremlin_trace_replay_open(const char *file)
+{
+    char magic[sizeof(GREMLIN_TRACE_MAGIC) - 1];
+
+    trace_read_fp = fopen(file, "rb");
+    if (!trace_read_fp)
+    {
+        msg(M_WARN | M_ERRNO, "GREMLIN: cannot open replay file %s", file);
+        return false;
+    }
+    if (fread(magic, sizeof(magic), 1, trace_read_fp) != 1
+        || memcmp(magic, GREMLIN_TRACE_MAGIC, sizeof(magic)) != 0)
+    {
+        msg(M_WARN, "GREMLIN: %s is not a capture file", file);
+        fclose(trace_read_fp);
+        trace_read_fp = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool
+gremlin_trace_replay_next(struct buffer *buf,
+                          struct link_socket_actual *from,
+                          struct timeval *ts)
+{
+    struct gremlin_trace_hdr hdr;
+    uint8_t *p;
+
+    if (!trace_read_fp || fread(&hdr, sizeof(hdr), 1, trace_read_fp) != 1)
+    {
+        return false;
+    }
+    if (hdr.addrlen > sizeof(from->dest.addr)
+        || (int)hdr.paylen > buf_forward_capacity(buf))
+    {
+        msg(M_WARN, "GREMLIN: malformed replay record, stopping");
+        return false;
+    }
+
+    CLEAR(*from);
+    if (hdr.addrlen
+        && fread(&from->dest.addr.sa, hdr.addrlen, 1, trace_read_fp) != 1)
+    {
+        return false;
+    }
+
+    p = buf_write_alloc(buf, hdr.paylen);
+    if (!p || fread(p, hdr.paylen, 1, trace_read_fp) != 1)
+    {
+        return false;
+    }
+
+    ts->tv_sec = hdr.sec;
+    ts->tv_usec = hdr.usec;
+    return true;
+}
+
+void
+gremlin_trace_replay_close(void)
+{
+    if (trace_read_fp)
+    {
+        fclose(trace_read_fp);
+        trace_read_fp = NULL;
+    }
+}
+
 #else  /* ifdef ENABLE_DEBUG */
 static void
 dummy(void)
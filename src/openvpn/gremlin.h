@@ -69,5 +69,28 @@ void corrupt_gremlin(struct buffer *buf, int flags);
 
 struct packet_flood_parms get_packet_flood_parms(int level);
 
+/*
+ * Record/replay of link reads (--gremlin-capture / --gremlin-replay).
+ * Capture appends every successful link_socket_read() result with its
+ * timestamp and source address to a bounded binary trace file; replay
+ * feeds such a file back through the server's incoming-link path with
+ * a virtualized clock.  See gremlin.c for the file format.
+ */
+
+struct link_socket_actual;
+
+void gremlin_trace_capture(const char *file, const struct buffer *buf,
+                           const struct link_socket_actual *from);
+
+void gremlin_trace_capture_close(void);
+
+bool gremlin_trace_replay_open(const char *file);
+
+bool gremlin_trace_replay_next(struct buffer *buf,
+                               struct link_socket_actual *from,
+                               struct timeval *ts);
+
+void gremlin_trace_replay_close(void);
+
 #endif /* ifdef ENABLE_DEBUG */
 #endif /* ifndef GREMLIN_H */
@@ -688,6 +688,8 @@ restore_ncp_options(struct context *c)
     c->options.authname = c->c1.authname;
     c->options.keysize = c->c1.keysize;
     c->options.data_channel_use_ekm = false;
+    c->options.data_channel_use_hkdf = false;
+    c->options.data_channel_pkt_id_64 = false;
 }
 
 void
@@ -711,6 +713,11 @@ context_init_1(struct context *c)
             pkcs11_addProvider(c->options.pkcs11_providers[i], c->options.pkcs11_protected_authentication[i],
                                c->options.pkcs11_private_mode[i], c->options.pkcs11_cert_private[i]);
         }
+        if (c->options.pkcs11_providers[0])
+        {
+            /* prime the token/certificate caches before the first handshake */
+            pkcs11_warmup();
+        }
     }
 #endif
 
@@ -742,6 +749,10 @@ context_init_1(struct context *c)
 void
 context_gc_free(struct context *c)
 {
+    if (c->c1.route_list)
+    {
+        free_route_list_storage(c->c1.route_list);
+    }
     gc_free(&c->c2.gc);
     gc_free(&c->options.gc);
     gc_free(&c->gc);
@@ -804,6 +815,9 @@ init_static(void)
     error_reset();              /* initialize error.c */
     reset_check_status();       /* initialize status check code in socket.c */
 
+    /* pick up a link socket passed via systemd socket activation */
+    save_inherited_link_socket_from_env();
+
 #ifdef _WIN32
     init_win32();
 #endif
@@ -1390,6 +1404,7 @@ void
 reset_coarse_timers(struct context *c)
 {
     c->c2.coarse_timer_wakeup = 0;
+    context_wakeup_pre_select(c);
 }
 
 /*
@@ -1426,7 +1441,20 @@ do_init_timers(struct context *c, bool deferred)
 
     if (c->options.ping_send_timeout)
     {
-        event_timeout_init(&c->c2.ping_send_interval, c->options.ping_send_timeout, 0);
+        time_t last = 0;
+
+        /*
+         * De-synchronize server keepalives: clients of a reconnect
+         * burst would otherwise ping in lockstep forever, turning a
+         * flat per-second wakeup load into periodic spikes.  Spread
+         * the first ping uniformly across the interval; the cadence
+         * keeps the offset from then on.
+         */
+        if (c->mode == CM_CHILD_UDP || c->mode == CM_CHILD_TCP)
+        {
+            last = now - (time_t)(get_random() % c->options.ping_send_timeout);
+        }
+        event_timeout_init(&c->c2.ping_send_interval, c->options.ping_send_timeout, last);
     }
 
     if (c->options.ping_rec_timeout)
@@ -1453,6 +1481,16 @@ do_init_timers(struct context *c, bool deferred)
             event_timeout_init(&c->c2.occ_mtu_load_test_interval, OCC_MTU_LOAD_INTERVAL_SECONDS, now);
         }
 
+        if (c->options.mtu_probe)
+        {
+            event_timeout_init(&c->c2.occ_mtu_probe_interval, OCC_MTU_PROBE_INTERVAL_SECONDS, now);
+        }
+
+        if (c->options.mtu_tuner)
+        {
+            event_timeout_init(&c->c2.mtu_tuner_interval, MTU_TUNER_INTERVAL_SECONDS, now);
+        }
+
         /* initialize packet_id persistence timer */
         if (c->options.packet_id_file)
         {
@@ -1476,6 +1514,22 @@ do_init_traffic_shaper(struct context *c)
     if (c->options.shaper)
     {
         shaper_init(&c->c2.shaper, c->options.shaper);
+        if (c->options.shaper_burst)
+        {
+            shaper_set_burst(&c->c2.shaper, c->options.shaper_burst);
+        }
+
+        /*
+         * Offload to the kernel fq qdisc if requested and the socket
+         * already exists (pulled-options path); on startup the socket
+         * comes up later and do_init_socket_2 applies the rate.
+         */
+        if (c->options.shaper_pacing && c->c2.link_socket
+            && socket_defined(c->c2.link_socket->sd))
+        {
+            c->c2.shaper.kernel_paced =
+                socket_set_pacing_rate(c->c2.link_socket->sd, c->options.shaper);
+        }
         shaper_msg(&c->c2.shaper);
     }
 #endif
@@ -1828,6 +1882,9 @@ do_open_tun(struct context *c)
     /* initialize (but do not open) tun/tap object */
     do_init_tun(c);
 
+    /* re-arm the DHCP router extraction latch for the fresh interface */
+    c->c1.dhcp_router_extracted = false;
+
 #ifdef _WIN32
     /* store (hide) interactive service handle in tuntap_options */
     c->c1.tuntap->options.msg_channel = c->options.msg_channel;
@@ -2055,8 +2112,20 @@ do_close_tun(struct context *c, bool force)
                             "route-pre-down",
                             c->c2.es);
 
+                unsigned int rflags = ROUTE_OPTION_FLAGS(&c->options);
+#if defined(TARGET_LINUX)
+                /* the device is destroyed below (or, with --down-pre,
+                 * right after the down script) and the kernel flushes
+                 * its routes with it -- unless the interface is
+                 * persistent (--mktun), in which case close_tun()
+                 * leaves it up and its routes must be deleted */
+                if (!c->c1.tuntap->persistent_if)
+                {
+                    rflags |= ROUTE_IFACE_DOWN;
+                }
+#endif
                 delete_routes(c->c1.route_list, c->c1.route_ipv6_list,
-                              c->c1.tuntap, ROUTE_OPTION_FLAGS(&c->options),
+                              c->c1.tuntap, rflags,
                               c->c2.es, &c->net_ctx);
             }
 
@@ -2089,7 +2158,8 @@ do_close_tun(struct context *c, bool force)
 #if defined(_WIN32)
             if (c->options.block_outside_dns)
             {
-                if (!win_wfp_uninit(adapter_index, c->options.msg_channel))
+                if (!win_wfp_uninit(adapter_index, c->options.msg_channel,
+                                    c->sig->signal_received == SIGUSR1))
                 {
                     msg(M_FATAL, "Uninitialising WFP failed!");
                 }
@@ -2129,7 +2199,8 @@ do_close_tun(struct context *c, bool force)
 #if defined(_WIN32)
             if (c->options.block_outside_dns)
             {
-                if (!win_wfp_uninit(adapter_index, c->options.msg_channel))
+                if (!win_wfp_uninit(adapter_index, c->options.msg_channel,
+                                    c->sig->signal_received == SIGUSR1))
                 {
                     msg(M_FATAL, "Uninitialising WFP failed!");
                 }
@@ -2543,7 +2614,7 @@ frame_finalize_options(struct context *c, const struct options *o)
                              |FRAME_HEADROOM_MARKER_READ_STREAM);
     }
 
-    frame_add_to_extra_buffer(&c->c2.frame, PAYLOAD_ALIGN);
+    frame_add_to_extra_buffer(&c->c2.frame, CRYPTO_PAYLOAD_ALIGN);
     frame_finalize(&c->c2.frame,
                    o->ce.link_mtu_defined,
                    o->ce.link_mtu,
@@ -2615,6 +2686,11 @@ do_init_crypto_static(struct context *c, const unsigned int flags)
                        options->replay_window,
                        options->replay_time,
                        "STATIC", 0);
+        if (options->replay_adaptive)
+        {
+            packet_id_rec_set_adaptive(&c->c2.crypto_options.packet_id.rec,
+                                       MAX_SEQ_BACKTRACK);
+        }
         c->c2.crypto_options.pid_persist = &c->c1.pid_persist;
         c->c2.crypto_options.flags |= CO_PACKET_ID_LONG_FORM;
         packet_id_persist_load_obj(&c->c1.pid_persist,
@@ -2869,6 +2945,7 @@ do_init_crypto_tls(struct context *c, const unsigned int flags)
     to.replay = options->replay;
     to.replay_window = options->replay_window;
     to.replay_time = options->replay_time;
+    to.replay_adaptive = options->replay_adaptive;
     to.tcp_mode = link_socket_proto_connection_oriented(options->ce.proto);
     to.config_ciphername = c->c1.ciphername;
     to.config_ncp_ciphers = options->ncp_ciphers;
@@ -2893,8 +2970,24 @@ do_init_crypto_tls(struct context *c, const unsigned int flags)
                                                           - options->renegotiate_seconds_min, 1));
     }
     to.single_session = options->single_session;
+    to.tls_async = options->tls_async;
     to.mode = options->mode;
     to.pull = options->pull;
+
+#ifdef TARGET_LINUX
+    if (options->dco && options->mode == MODE_POINT_TO_POINT)
+    {
+        to.dco = &c->c2.dco;
+        to.dco_peer_id = 0;
+    }
+#endif
+#ifndef _WIN32
+    /* retain data channel keys so sessions can follow a float to a
+     * sibling --socket-flags REUSEPORT process or survive a
+     * --persist-state restart */
+    to.migrate = options->migrate_path != NULL
+                 || options->persist_state_file != NULL;
+#endif
     if (options->push_peer_info)        /* all there is */
     {
         to.push_peer_info_detail = 2;
@@ -2908,6 +3001,9 @@ do_init_crypto_tls(struct context *c, const unsigned int flags)
         to.push_peer_info_detail = 0;
     }
 
+    /* echo the push set digest from the previous pull, if any */
+    to.push_digest = options->push_digest;
+
     /* should we not xmit any packets until we get an initial
      * response from client? */
     if (to.server && options->ce.proto == PROTO_TCP_SERVER)
@@ -2918,6 +3014,7 @@ do_init_crypto_tls(struct context *c, const unsigned int flags)
     to.disable_occ = !options->occ;
 
     to.verify_command = options->tls_verify;
+    to.verify_cache_lifetime = options->tls_verify_cache;
     to.verify_export_cert = options->tls_export_cert;
     to.verify_x509_type = (options->verify_x509_type & 0xff);
     to.verify_x509_name = options->verify_x509_name;
@@ -3159,6 +3256,16 @@ do_init_frame(struct context *c)
         tun_adjust_frame_parameters(&c->c2.frame, c->options.ce.tun_mtu_extra);
     }
 
+    /*
+     * Reserve headroom for the 802.1Q tag, so that tagging a frame on
+     * its way to a VLAN trunk is a guaranteed prepend in pre-allocated
+     * space instead of a possible drop.
+     */
+    if (c->options.vlan_tagging)
+    {
+        frame_add_to_extra_frame(&c->c2.frame, SIZE_ETH_TO_8021Q_HDR);
+    }
+
     /*
      * Adjust frame size based on link socket parameters.
      * (Since TCP is a stream protocol, we need to insert
@@ -3336,26 +3443,66 @@ do_init_frame_tls(struct context *c)
     do_init_finalize_tls_frame(c);
 }
 
-struct context_buffers *
-init_context_buffers(const struct frame *frame)
+/* number of frame-sized buffers carved out of the context arena */
+#ifdef USE_COMP
+#define CONTEXT_BUFFERS_COUNT 7
+#else
+#define CONTEXT_BUFFERS_COUNT 5
+#endif
+
+static struct buffer
+context_buffers_slice(struct context_buffers *b, int *n)
 {
-    struct context_buffers *b;
+    struct buffer buf = { 0 };
 
-    ALLOC_OBJ_CLEAR(b, struct context_buffers);
+    buf.capacity = b->buf_size;
+    buf.data = b->arena + (size_t) (*n)++ *b->buf_size;
+    return buf;
+}
 
-    b->read_link_buf = alloc_buf(BUF_SIZE(frame));
-    b->read_tun_buf = alloc_buf(BUF_SIZE(frame));
+/*
+ * (Re)point the individual buffers at their arena slices, clearing any
+ * stale offset/length state from a previous use of the arena.  Also
+ * used by the server-side buffer leasing pool when an arena moves
+ * between instances.
+ */
+void
+context_buffers_setup(struct context_buffers *b)
+{
+    int n = 0;
+
+    b->read_link_buf = context_buffers_slice(b, &n);
+    b->read_tun_buf = context_buffers_slice(b, &n);
 
-    b->aux_buf = alloc_buf(BUF_SIZE(frame));
+    b->aux_buf = context_buffers_slice(b, &n);
 
-    b->encrypt_buf = alloc_buf(BUF_SIZE(frame));
-    b->decrypt_buf = alloc_buf(BUF_SIZE(frame));
+    b->encrypt_buf = context_buffers_slice(b, &n);
+    b->decrypt_buf = context_buffers_slice(b, &n);
 
 #ifdef USE_COMP
-    b->compress_buf = alloc_buf(BUF_SIZE(frame));
-    b->decompress_buf = alloc_buf(BUF_SIZE(frame));
+    b->compress_buf = context_buffers_slice(b, &n);
+    b->decompress_buf = context_buffers_slice(b, &n);
 #endif
 
+    ASSERT(n == CONTEXT_BUFFERS_COUNT);
+}
+
+struct context_buffers *
+init_context_buffers(const struct frame *frame)
+{
+    struct context_buffers *b;
+
+    ALLOC_OBJ_CLEAR(b, struct context_buffers);
+
+    /* one contiguous allocation backs all of the frame buffers, which
+     * keeps their relative cache placement fixed and gives the
+     * allocator a single large block instead of many small ones */
+    b->buf_size = BUF_SIZE(frame);
+    b->arena = (uint8_t *) calloc(CONTEXT_BUFFERS_COUNT, b->buf_size);
+    check_malloc_return(b->arena);
+
+    context_buffers_setup(b);
+
     return b;
 }
 
@@ -3364,18 +3511,7 @@ free_context_buffers(struct context_buffers *b)
 {
     if (b)
     {
-        free_buf(&b->read_link_buf);
-        free_buf(&b->read_tun_buf);
-        free_buf(&b->aux_buf);
-
-#ifdef USE_COMP
-        free_buf(&b->compress_buf);
-        free_buf(&b->decompress_buf);
-#endif
-
-        free_buf(&b->encrypt_buf);
-        free_buf(&b->decrypt_buf);
-
+        free(b->arena);
         free(b);
     }
 }
@@ -3387,8 +3523,38 @@ free_context_buffers(struct context_buffers *b)
 static void
 do_init_buffers(struct context *c)
 {
-    c->c2.buffers = init_context_buffers(&c->c2.frame);
+    /* reuse the arena preserved across a soft restart when it is still
+     * big enough for the new frame */
+    if (c->persist.buffers
+        && c->persist.buffers->buf_size >= BUF_SIZE(&c->c2.frame))
+    {
+        c->c2.buffers = c->persist.buffers;
+        context_buffers_setup(c->c2.buffers);
+    }
+    else
+    {
+        free_context_buffers(c->persist.buffers);
+        c->c2.buffers = init_context_buffers(&c->c2.frame);
+    }
+    c->persist.buffers = NULL;
     c->c2.buffers_owned = true;
+
+    /* --prio-queue staging buffers; the queue reorders the single
+     * point-to-point encrypt pipeline, so it is not used in server mode
+     * where per-client queueing applies instead */
+    if (c->options.prio_queue > 0 && c->options.mode == MODE_POINT_TO_POINT)
+    {
+        c->c2.pq = prio_queue_init(c->options.prio_queue, &c->c2.frame);
+    }
+
+#ifdef TARGET_LINUX
+    /* --tun-offload landing buffer; a GSO super-packet can carry up to
+     * 64 KB of TCP payload regardless of the negotiated frame size */
+    if (c->options.tuntap_options.offload)
+    {
+        c->c2.gso_buf = alloc_buf(65536);
+    }
+#endif
 }
 
 #ifdef ENABLE_FRAGMENT
@@ -3472,6 +3638,65 @@ do_init_socket_2(struct context *c)
 {
     link_socket_init_phase2(c->c2.link_socket, &c->c2.frame,
                             c->sig);
+
+#ifdef ENABLE_UDP_MMSG
+    if (c->options.udp_mmsg > 0)
+    {
+        link_socket_enable_mmsg(c->c2.link_socket, &c->c2.frame,
+                                c->options.udp_mmsg);
+    }
+#endif
+
+#ifdef ENABLE_FEATURE_SHAPER
+    /*
+     * Only point-to-point mode paces its own socket here; on a server
+     * the listen socket is shared across clients, so a socket-wide
+     * rate would wrongly cap everyone at the per-client limit.
+     */
+    if (c->options.shaper && c->options.shaper_pacing
+        && c->options.mode == MODE_POINT_TO_POINT
+        && socket_defined(c->c2.link_socket->sd))
+    {
+        c->c2.shaper.kernel_paced =
+            socket_set_pacing_rate(c->c2.link_socket->sd, c->options.shaper);
+        if (!c->c2.shaper.kernel_paced)
+        {
+            msg(M_WARN, "NOTE: kernel pacing (SO_MAX_PACING_RATE) unavailable, using userspace shaper");
+        }
+    }
+#endif
+
+#ifdef TARGET_LINUX
+    if (c->options.udp_prefilter
+        && proto_is_udp(c->options.ce.proto)
+        && socket_defined(c->c2.link_socket->sd))
+    {
+        socket_set_udp_prefilter(c->c2.link_socket->sd);
+    }
+
+    /*
+     * Hand the transport socket and peer address to the kernel offload
+     * module.  From then on the kernel consumes data channel packets
+     * directly and only control channel traffic reaches userspace;
+     * the keys follow when the TLS handshake produces them.
+     */
+    if (c->options.dco
+        && c->options.mode == MODE_POINT_TO_POINT
+        && socket_defined(c->c2.link_socket->sd)
+        && dco_init(&c->c2.dco))
+    {
+        const struct link_socket_addr *lsa = c->c2.link_socket->info.lsa;
+
+        if (!dco_attach_socket(&c->c2.dco, c->c2.link_socket->sd)
+            || !link_socket_actual_defined(&lsa->actual)
+            || !dco_new_peer(&c->c2.dco, 0, &lsa->actual.dest.addr.sa,
+                             af_addr_size(lsa->actual.dest.addr.sa.sa_family)))
+        {
+            msg(M_WARN, "DCO: offload setup failed, using userspace data path");
+            dco_uninit(&c->c2.dco);
+        }
+    }
+#endif
 }
 
 /*
@@ -3576,9 +3801,24 @@ do_close_check_if_restart_permitted(struct context *c)
 static void
 do_close_free_buf(struct context *c)
 {
+    prio_queue_free(c->c2.pq);
+    c->c2.pq = NULL;
+#ifdef TARGET_LINUX
+    free_buf(&c->c2.gso_buf);
+    c->c2.gso_remaining = 0;
+#endif
     if (c->c2.buffers_owned)
     {
-        free_context_buffers(c->c2.buffers);
+        /* park the arena for reuse after a soft restart, so reconnect
+         * storms do not thrash the heap with free/alloc cycles */
+        if (c->sig->signal_received == SIGUSR1 && !c->persist.buffers)
+        {
+            c->persist.buffers = c->c2.buffers;
+        }
+        else
+        {
+            free_context_buffers(c->c2.buffers);
+        }
         c->c2.buffers = NULL;
         c->c2.buffers_owned = false;
     }
@@ -3605,7 +3845,7 @@ do_close_tls(struct context *c)
     if (c->c2.pulled_options_state)
     {
         md_ctx_cleanup(c->c2.pulled_options_state);
-        md_ctx_free(c->c2.pulled_options_state);
+        md_ctx_put(c->c2.pulled_options_state);
     }
 }
 
@@ -3636,6 +3876,15 @@ do_close_free_key_schedule(struct context *c, bool free_ssl_ctx)
 static void
 do_close_link_socket(struct context *c)
 {
+#ifdef TARGET_LINUX
+    /* detach the kernel offload before the socket goes away */
+    if (dco_enabled(&c->c2.dco))
+    {
+        dco_del_peer(&c->c2.dco, 0);
+        dco_uninit(&c->c2.dco);
+    }
+#endif
+
     if (c->c2.link_socket && c->c2.link_socket_owned)
     {
         link_socket_close(c->c2.link_socket);
@@ -3725,6 +3974,23 @@ do_event_set_init(struct context *c,
 
     c->c2.event_set = event_set_init(&c->c2.event_set_max, flags);
     c->c2.event_set_owned = true;
+
+    /* nothing is armed in the new event set yet */
+    c->c2.link_set_rwflags = EVENT_UNDEF;
+    c->c2.tun_set_rwflags = EVENT_UNDEF;
+#ifdef ENABLE_MANAGEMENT
+    c->c2.management_set_state = 0;
+#endif
+#ifdef ENABLE_ASYNC_PUSH
+    c->c2.inotify_set_fd = UNDEFINED_EVENT;
+#endif
+#ifdef ENABLE_WORKER_THREADS
+    c->c2.worker_set_fd = UNDEFINED_EVENT;
+#endif
+#ifndef _WIN32
+    c->c2.tls_async_set_fd = UNDEFINED_EVENT;
+    c->c2.migrate_set_fd = UNDEFINED_EVENT;
+#endif
 }
 
 static void
@@ -4208,6 +4474,19 @@ init_instance(struct context *c, const struct env_set *env, const unsigned int f
         platform_mlockall(true);
     }
 
+#ifdef TARGET_LINUX
+    /*
+     * Set the preferred NUMA node before the data path structures are
+     * allocated (multi_init() hashes, schedule nodes, instance memory),
+     * so first-touch page placement keeps them local to the node doing
+     * the forwarding work.
+     */
+    if (c->first_time && options->numa_node >= 0)
+    {
+        platform_set_numa_node(options->numa_node);
+    }
+#endif
+
 #if P2MP
     /* get passwords if undefined */
     if (auth_retry_get() == AR_INTERACT)
@@ -4750,6 +5029,12 @@ test_crypto_thread(void *arg)
 
     test_crypto(&c->c2.crypto_options, &c->c2.frame);
 
+    if (options->test_crypto_perf)
+    {
+        test_crypto_perf(&c->c2.crypto_options, &c->c2.frame,
+                         options->test_crypto_perf);
+    }
+
     key_schedule_free(&c->c1.ks, true);
     packet_id_free(&c->c2.crypto_options.packet_id);
 
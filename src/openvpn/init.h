@@ -112,6 +112,8 @@ void close_context(struct context *c, int sig, unsigned int flags);
 
 struct context_buffers *init_context_buffers(const struct frame *frame);
 
+void context_buffers_setup(struct context_buffers *b);
+
 void free_context_buffers(struct context_buffers *b);
 
 #define ISC_ERRORS (1<<0)
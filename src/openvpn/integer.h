@@ -66,6 +66,19 @@ min_int(int x, int y)
     }
 }
 
+static inline int64_t
+min_int64(int64_t x, int64_t y)
+{
+    if (x < y)
+    {
+        return x;
+    }
+    else
+    {
+        return y;
+    }
+}
+
 static inline int
 constrain_int(int x, int min, int max)
 {
@@ -0,0 +1,131 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#include "syshead.h"
+
+#include <stddef.h>
+
+#include "intern.h"
+#include "error.h"
+#include "buffer.h"
+
+#include "memdbg.h"
+
+/* must be a power of two */
+#define INTERN_HASH_SIZE 256
+
+struct intern_entry
+{
+    struct intern_entry *next;
+    uint32_t refcount;
+    uint32_t hash;
+    char str[];
+};
+
+static struct intern_entry *intern_hash[INTERN_HASH_SIZE];
+
+static uint32_t
+intern_hash_str(const char *str)
+{
+    /* djb2 */
+    uint32_t h = 5381;
+    while (*str)
+    {
+        h = ((h << 5) + h) ^ (uint8_t)*str++;
+    }
+    return h;
+}
+
+static inline struct intern_entry *
+intern_entry_of(char *str)
+{
+    return (struct intern_entry *)(str - offsetof(struct intern_entry, str));
+}
+
+char *
+string_intern(const char *str)
+{
+    if (!str)
+    {
+        return NULL;
+    }
+
+    const uint32_t hash = intern_hash_str(str);
+    struct intern_entry **bucket = &intern_hash[hash & (INTERN_HASH_SIZE - 1)];
+
+    for (struct intern_entry *e = *bucket; e; e = e->next)
+    {
+        if (e->hash == hash && !strcmp(e->str, str))
+        {
+            ++e->refcount;
+            return e->str;
+        }
+    }
+
+    const size_t len = strlen(str);
+    struct intern_entry *e = (struct intern_entry *)
+        malloc(sizeof(struct intern_entry) + len + 1);
+    check_malloc_return(e);
+    e->refcount = 1;
+    e->hash = hash;
+    memcpy(e->str, str, len + 1);
+    e->next = *bucket;
+    *bucket = e;
+
+    return e->str;
+}
+
+void
+string_intern_release(char *str)
+{
+    if (!str)
+    {
+        return;
+    }
+
+    struct intern_entry *e = intern_entry_of(str);
+    ASSERT(e->refcount > 0);
+    if (--e->refcount > 0)
+    {
+        return;
+    }
+
+    struct intern_entry **pp = &intern_hash[e->hash & (INTERN_HASH_SIZE - 1)];
+    while (*pp)
+    {
+        if (*pp == e)
+        {
+            *pp = e->next;
+            free(e);
+            return;
+        }
+        pp = &(*pp)->next;
+    }
+    ASSERT(0);  /* released string was not in the pool */
+}
@@ -0,0 +1,55 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INTERN_H
+#define INTERN_H
+
+#include "basic.h"
+
+/*
+ * Refcounted string intern pool.
+ *
+ * On a busy server the same strings are duplicated across thousands of
+ * client instances: common names of multi-device users, pool entries
+ * mirroring session common names, and similar.  The pool keeps one
+ * heap copy per distinct string and hands out refcounted pointers, so
+ * identical strings share storage and can be compared by pointer.
+ *
+ * Interned strings must be treated as immutable, and every pointer
+ * obtained from string_intern() must be returned exactly once through
+ * string_intern_release().  The pool is not locked; like the rest of
+ * the per-process state it may only be used from the main thread.
+ */
+
+/**
+ * Return a refcounted pooled copy of \c str, or NULL if \c str is NULL.
+ */
+char *string_intern(const char *str);
+
+/**
+ * Drop one reference to an interned string, freeing the pooled copy
+ * when the last reference is gone.  NULL is ignored.
+ */
+void string_intern_release(char *str);
+
+#endif /* ifndef INTERN_H */
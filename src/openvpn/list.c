@@ -43,120 +43,271 @@ hash_init(const int n_buckets,
           bool (*compare_function)(const void *key1, const void *key2))
 {
     struct hash *h;
-    int i;
 
     ASSERT(n_buckets > 0);
     ALLOC_OBJ_CLEAR(h, struct hash);
     h->n_buckets = (int) adjust_power_of_2(n_buckets);
+    h->min_buckets = h->n_buckets;
     h->mask = h->n_buckets - 1;
     h->hash_function = hash_function;
     h->compare_function = compare_function;
     h->iv = iv;
-    ALLOC_ARRAY(h->buckets, struct hash_bucket, h->n_buckets);
-    for (i = 0; i < h->n_buckets; ++i)
-    {
-        struct hash_bucket *b = &h->buckets[i];
-        b->list = NULL;
-    }
+    ALLOC_ARRAY_CLEAR(h->slots, struct hash_element, h->n_buckets);
     return h;
 }
 
 void
 hash_free(struct hash *hash)
 {
-    int i;
-    for (i = 0; i < hash->n_buckets; ++i)
+    free(hash->old_slots);
+    free(hash->slots);
+    free(hash);
+}
+
+/* old slots migrated per table operation during an incremental grow */
+#define HASH_MIGRATE_STEP 8
+
+/* place one element into the current slot array by linear probe */
+static void
+hash_place(struct hash *hash, const struct hash_element *e)
+{
+    uint32_t j = e->hash_value & hash->mask;
+
+    while (hash->slots[j].state == HT_SLOT_FULL)
+    {
+        j = (j + 1) & hash->mask;
+    }
+    if (hash->slots[j].state == HT_SLOT_DELETED)
+    {
+        --hash->n_tombstones;
+    }
+    hash->slots[j] = *e;
+}
+
+/*
+ * Advance an in-progress incremental resize by up to n_slots old
+ * slots; frees the old array when the last slot has been migrated.
+ * Old-array tombstones are dropped on the way, so migration is also
+ * where deleted slots get reclaimed.
+ */
+static void
+hash_migrate(struct hash *hash, int n_slots)
+{
+    if (!hash->old_slots)
     {
-        struct hash_bucket *b = &hash->buckets[i];
-        struct hash_element *he = b->list;
+        return;
+    }
+    while (n_slots-- > 0)
+    {
+        if (hash->migrate_index >= hash->old_n_buckets)
+        {
+            free(hash->old_slots);
+            hash->old_slots = NULL;
+            return;
+        }
+        struct hash_element *old = &hash->old_slots[hash->migrate_index++];
 
-        while (he)
+        if (old->state == HT_SLOT_FULL)
         {
-            struct hash_element *next = he->next;
-            free(he);
-            he = next;
+            hash_place(hash, old);
+            /* the element must not remain findable in both arrays: a
+             * remove tombstones only the new copy, and a later lookup
+             * would resurrect this stale one.  DELETED, not EMPTY, so
+             * old-array probe chains of displaced elements that are
+             * still awaiting migration stay intact. */
+            old->state = HT_SLOT_DELETED;
         }
     }
-    free(hash->buckets);
-    free(hash);
 }
 
-struct hash_element *
-hash_lookup_fast(struct hash *hash,
-                 struct hash_bucket *bucket,
-                 const void *key,
-                 uint32_t hv)
+/* run any in-progress incremental resize to completion */
+static inline void
+hash_migrate_finish(struct hash *hash)
 {
-    struct hash_element *he;
-    struct hash_element *prev = NULL;
+    if (hash->old_slots)
+    {
+        hash_migrate(hash, hash->old_n_buckets);
+    }
+}
+
+/*
+ * Begin an incremental resize: the current array becomes the old one,
+ * and subsequent table operations migrate it into the fresh array a
+ * few slots at a time via hash_migrate().
+ */
+static void
+hash_resize_begin(struct hash *hash)
+{
+    int new_n = (int) adjust_power_of_2((hash->n_elements + 1) * 2);
+
+    if (new_n < hash->min_buckets)
+    {
+        new_n = hash->min_buckets;
+    }
+
+    hash->old_slots = hash->slots;
+    hash->old_n_buckets = hash->n_buckets;
+    hash->old_mask = hash->mask;
+    hash->migrate_index = 0;
+
+    ALLOC_ARRAY_CLEAR(hash->slots, struct hash_element, new_n);
+    hash->n_buckets = new_n;
+    hash->mask = new_n - 1;
+    hash->n_tombstones = 0;     /* counts slots in the new array only */
+    hash->resize_pending = false;
+}
+
+/*
+ * Move every live element into a fresh slot array in one sweep.  Used
+ * where the table must be in a single-array state afterwards: resizes
+ * deferred past live iterators and the overflow fallback in
+ * hash_add_fast().
+ */
+static void
+hash_resize(struct hash *hash)
+{
+    hash_migrate_finish(hash);
+    hash_resize_begin(hash);
+    hash_migrate_finish(hash);
+}
 
-    he = bucket->list;
+static struct hash_element *
+hash_probe(struct hash *hash, struct hash_element *slots, int mask,
+           const void *key, uint32_t hv)
+{
+    uint32_t i = hv & mask;
+    int probes;
 
-    while (he)
+    for (probes = 0; probes <= mask; ++probes)
     {
-        if (hv == he->hash_value && (*hash->compare_function)(key, he->key))
+        struct hash_element *he = &slots[i];
+
+        if (he->state == HT_SLOT_EMPTY)
+        {
+            return NULL;
+        }
+        if (he->state == HT_SLOT_FULL
+            && he->hash_value == hv
+            && (*hash->compare_function)(key, he->key))
         {
-            /* move to head of list */
-            if (prev)
-            {
-                prev->next = he->next;
-                he->next = bucket->list;
-                bucket->list = he;
-            }
             return he;
         }
-        prev = he;
-        he = he->next;
+        i = (i + 1) & mask;
     }
-
     return NULL;
 }
 
+struct hash_element *
+hash_lookup_fast(struct hash *hash,
+                 struct hash_bucket *bucket,
+                 const void *key,
+                 uint32_t hv)
+{
+    hash_migrate(hash, HASH_MIGRATE_STEP);
+
+    struct hash_element *he = hash_probe(hash, hash->slots, hash->mask,
+                                         key, hv);
+    if (!he && hash->old_slots)
+    {
+        he = hash_probe(hash, hash->old_slots, hash->old_mask, key, hv);
+    }
+    return he;
+}
+
 bool
 hash_remove_fast(struct hash *hash,
                  struct hash_bucket *bucket,
                  const void *key,
                  uint32_t hv)
 {
-    struct hash_element *he;
-    struct hash_element *prev = NULL;
-
-    he = bucket->list;
+    struct hash_element *he = hash_lookup_fast(hash, bucket, key, hv);
 
-    while (he)
+    if (he)
     {
-        if (hv == he->hash_value && (*hash->compare_function)(key, he->key))
+        /* tombstone the slot; the probe chain through it stays intact
+         * and live element pointers/iterators remain valid */
+        he->state = HT_SLOT_DELETED;
+        he->key = NULL;
+        he->value = NULL;
+        --hash->n_elements;
+        /* old-array tombstones are dropped by migration and must not
+         * count against the new array's load factor */
+        if (he >= hash->slots && he < hash->slots + hash->n_buckets)
         {
-            if (prev)
-            {
-                prev->next = he->next;
-            }
-            else
-            {
-                bucket->list = he->next;
-            }
-            free(he);
-            --hash->n_elements;
-            return true;
+            ++hash->n_tombstones;
         }
-        prev = he;
-        he = he->next;
+        return true;
     }
     return false;
 }
 
+/* NOTE: assumes that key is not a duplicate */
+void
+hash_add_fast(struct hash *hash,
+              struct hash_bucket *bucket,
+              const void *key,
+              uint32_t hv,
+              void *value)
+{
+    struct hash_element *he;
+    uint32_t i;
+    int probes = 0;
+
+    /* start an incremental resize (or tombstone purge) past 3/4 load;
+     * with live iterators this is deferred to hash_iterator_free()
+     * since moving slots would invalidate the iteration */
+    if (!hash->old_slots
+        && (hash->n_elements + hash->n_tombstones + 1) * 4 > hash->n_buckets * 3)
+    {
+        if (hash->iter_depth == 0)
+        {
+            hash_resize_begin(hash);
+        }
+        else
+        {
+            hash->resize_pending = true;
+        }
+    }
+    hash_migrate(hash, HASH_MIGRATE_STEP);
+
+    i = hv & hash->mask;
+    while (hash->slots[i].state == HT_SLOT_FULL)
+    {
+        /* a full sweep without a free slot can only happen when a
+         * deferred resize was skipped or adds outran an incremental
+         * migration; force a full resize and start over */
+        if (++probes > hash->mask)
+        {
+            hash_resize(hash);
+            i = hv & hash->mask;
+            probes = 0;
+            continue;
+        }
+        i = (i + 1) & hash->mask;
+    }
+
+    he = &hash->slots[i];
+    if (he->state == HT_SLOT_DELETED)
+    {
+        --hash->n_tombstones;
+    }
+    he->state = HT_SLOT_FULL;
+    he->value = value;
+    he->key = key;
+    he->hash_value = hv;
+    ++hash->n_elements;
+}
+
 bool
 hash_add(struct hash *hash, const void *key, void *value, bool replace)
 {
     uint32_t hv;
-    struct hash_bucket *bucket;
     struct hash_element *he;
     bool ret = false;
 
     hv = hash_value(hash, key);
-    bucket = &hash->buckets[hv & hash->mask];
 
-    if ((he = hash_lookup_fast(hash, bucket, key, hv))) /* already exists? */
+    if ((he = hash_lookup_fast(hash, NULL, key, hv))) /* already exists? */
     {
         if (replace)
         {
@@ -166,7 +317,7 @@ hash_add(struct hash *hash, const void *key, void *value, bool replace)
     }
     else
     {
-        hash_add_fast(hash, bucket, key, hv, value);
+        hash_add_fast(hash, NULL, key, hv, value);
         ret = true;
     }
 
@@ -190,37 +341,6 @@ hash_remove_by_value(struct hash *hash, void *value)
     hash_iterator_free(&hi);
 }
 
-static void
-hash_remove_marked(struct hash *hash, struct hash_bucket *bucket)
-{
-    struct hash_element *prev = NULL;
-    struct hash_element *he = bucket->list;
-
-    while (he)
-    {
-        if (!he->key) /* marked? */
-        {
-            struct hash_element *newhe;
-            if (prev)
-            {
-                newhe = prev->next = he->next;
-            }
-            else
-            {
-                newhe = bucket->list = he->next;
-            }
-            free(he);
-            --hash->n_elements;
-            he = newhe;
-        }
-        else
-        {
-            prev = he;
-            he = he->next;
-        }
-    }
-}
-
 void
 hash_iterator_init_range(struct hash *hash,
                          struct hash_iterator *hi,
@@ -235,13 +355,19 @@ hash_iterator_init_range(struct hash *hash,
     ASSERT(start_bucket >= 0 && start_bucket <= end_bucket);
 
     hi->hash = hash;
-    hi->elem = NULL;
-    hi->bucket = NULL;
     hi->last = NULL;
-    hi->bucket_marked = false;
     hi->bucket_index_start = start_bucket;
     hi->bucket_index_end = end_bucket;
-    hi->bucket_index = hi->bucket_index_start - 1;
+    hi->bucket_index = hi->bucket_index_start;
+
+    /* slots must not move underneath a live iterator; iteration is a
+     * control-plane operation, so finishing a pending migration here
+     * keeps the packet-path operations incremental */
+    if (hash->iter_depth == 0)
+    {
+        hash_migrate_finish(hash);
+    }
+    ++hash->iter_depth;
 }
 
 void
@@ -251,80 +377,41 @@ hash_iterator_init(struct hash *hash,
     hash_iterator_init_range(hash, hi, 0, hash->n_buckets);
 }
 
-static inline void
-hash_iterator_lock(struct hash_iterator *hi, struct hash_bucket *b)
-{
-    hi->bucket = b;
-    hi->last = NULL;
-    hi->bucket_marked = false;
-}
-
-static inline void
-hash_iterator_unlock(struct hash_iterator *hi)
-{
-    if (hi->bucket)
-    {
-        if (hi->bucket_marked)
-        {
-            hash_remove_marked(hi->hash, hi->bucket);
-            hi->bucket_marked = false;
-        }
-        hi->bucket = NULL;
-        hi->last = NULL;
-    }
-}
-
-static inline void
-hash_iterator_advance(struct hash_iterator *hi)
-{
-    hi->last = hi->elem;
-    hi->elem = hi->elem->next;
-}
-
 void
 hash_iterator_free(struct hash_iterator *hi)
 {
-    hash_iterator_unlock(hi);
+    ASSERT(hi->hash->iter_depth > 0);
+    if (--hi->hash->iter_depth == 0 && hi->hash->resize_pending)
+    {
+        hash_resize(hi->hash);
+    }
 }
 
 struct hash_element *
 hash_iterator_next(struct hash_iterator *hi)
 {
-    struct hash_element *ret = NULL;
-    if (hi->elem)
+    while (hi->bucket_index < hi->bucket_index_end)
     {
-        ret = hi->elem;
-        hash_iterator_advance(hi);
-    }
-    else
-    {
-        while (++hi->bucket_index < hi->bucket_index_end)
+        struct hash_element *he = &hi->hash->slots[hi->bucket_index++];
+
+        if (he->state == HT_SLOT_FULL)
         {
-            struct hash_bucket *b;
-            hash_iterator_unlock(hi);
-            b = &hi->hash->buckets[hi->bucket_index];
-            if (b->list)
-            {
-                hash_iterator_lock(hi, b);
-                hi->elem = b->list;
-                if (hi->elem)
-                {
-                    ret = hi->elem;
-                    hash_iterator_advance(hi);
-                    break;
-                }
-            }
+            hi->last = he;
+            return he;
         }
     }
-    return ret;
+    return NULL;
 }
 
 void
 hash_iterator_delete_element(struct hash_iterator *hi)
 {
     ASSERT(hi->last);
+    hi->last->state = HT_SLOT_DELETED;
     hi->last->key = NULL;
-    hi->bucket_marked = true;
+    hi->last->value = NULL;
+    --hi->hash->n_elements;
+    ++hi->hash->n_tombstones;
 }
 
 
@@ -381,11 +468,53 @@ rmhash(struct hash *hash, const char *word)
     hash_remove(hash, word);
 }
 
+/*
+ * Micro-benchmark of hash_func() on the short key sizes the address
+ * tables see in practice: IPv4 (4), MAC (6), IPv6 (16) and
+ * IPv6 + port (20 bytes).
+ */
+static void
+hash_bench(void)
+{
+    static const int sizes[] = { 4, 6, 16, 20 };
+    const int iterations = 10000000;
+    uint8_t key[20];
+    int s;
+
+    for (s = 0; s < (int) SIZE(key); ++s)
+    {
+        key[s] = (uint8_t) random();
+    }
+
+    for (s = 0; s < (int) SIZE(sizes); ++s)
+    {
+        const int len = sizes[s];
+        struct timeval start, end;
+        uint32_t acc = 0;
+        double sec;
+        int i;
+
+        gettimeofday(&start, NULL);
+        for (i = 0; i < iterations; ++i)
+        {
+            /* chain the result into the seed so the loop can't be hoisted */
+            acc = hash_func(key, len, acc);
+        }
+        gettimeofday(&end, NULL);
+
+        sec = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) * 1e-6;
+        printf("hash_func len=%2d: %7.1f M keys/s (acc=0x%08x)\n",
+               len, iterations / sec / 1e6, acc);
+    }
+}
+
 void
 list_test(void)
 {
     openvpn_thread_init();
 
+    hash_bench();
+
     {
         struct gc_arena gc = gc_new();
         struct hash *hash = hash_init(10000, get_random(), word_hash_function, word_compare_function);
@@ -506,152 +635,112 @@ list_test(void)
 }
 
 #endif /* ifdef LIST_TEST */
-
 /*
  * --------------------------------------------------------------------
- * hash() -- hash a variable-length key into a 32-bit value
- * k     : the key (the unaligned variable-length array of bytes)
- * len   : the length of the key, counting by bytes
- * level : can be any 4-byte value
- * Returns a 32-bit value.  Every bit of the key affects every bit of
- * the return value.  Every 1-bit and 2-bit delta achieves avalanche.
- * About 36+6len instructions.
- *
- * The best hash table sizes are powers of 2.  There is no need to do
- * mod a prime (mod is sooo slow!).  If you need less than 32 bits,
- * use a bitmask.  For example, if you need only 10 bits, do
- * h = (h & hashmask(10));
- * In which case, the hash table should have hashsize(10) elements.
- *
- * If you are hashing n strings (uint8_t **)k, do it like this:
- * for (i=0, h=0; i<n; ++i) h = hash( k[i], len[i], h);
+ * hash_func() -- hash a variable-length key into a 32-bit value
+ * k       : the key (the unaligned variable-length array of bytes)
+ * length  : the length of the key, counting by bytes
+ * initval : per-table seed, usually from get_random()
  *
- * By Bob Jenkins, 1996.  bob_jenkins@burtleburtle.net.  You may use this
- * code any way you wish, private, educational, or commercial.  It's free.
- *
- * See http://burlteburtle.net/bob/hash/evahash.html
- * Use for hash table lookup, or anything where one collision in 2^32 is
- * acceptable.  Do NOT use for cryptographic purposes.
+ * Multiply-mix hash in the style of wyhash.  The workhorse is a
+ * 64x64->128 bit multiply whose halves are folded together; one such
+ * multiply mixes 16 key bytes, so the short keys this table sees --
+ * IPv4 (4), MAC (6), IPv6 (16), addr+port (up to 20) -- are covered
+ * by the single-load-pair fast path with two multiplies total.  This
+ * replaces the Bob Jenkins lookup2 function used here since 1.x,
+ * which needed a 36-instruction mix round per 12 bytes.
  *
- * --------------------------------------------------------------------
- *
- * mix -- mix 3 32-bit values reversibly.
- * For every delta with one or two bit set, and the deltas of all three
- * high bits or all three low bits, whether the original value of a,b,c
- * is almost all zero or is uniformly distributed,
- * If mix() is run forward or backward, at least 32 bits in a,b,c
- * have at least 1/4 probability of changing.
- * If mix() is run forward, every bit of c will change between 1/3 and
- * 2/3 of the time.  (Well, 22/100 and 78/100 for some 2-bit deltas.)
- * mix() was built out of 36 single-cycle latency instructions in a
- * structure that could supported 2x parallelism, like so:
- *    a -= b;
- *    a -= c; x = (c>>13);
- *    b -= c; a ^= x;
- *    b -= a; x = (a<<8);
- *    c -= a; b ^= x;
- *    c -= b; x = (b>>13);
- *    ...
- * Unfortunately, superscalar Pentiums and Sparcs can't take advantage
- * of that parallelism.  They've also turned some of those single-cycle
- * latency instructions into multi-cycle latency instructions.  Still,
- * this is the fastest good hash I could find.  There were about 2^^68
- * to choose from.  I only looked at a billion or so.
- *
- * James Yonan Notes:
- *
- * This function is faster than it looks, and appears to be
- * appropriate for our usage in OpenVPN which is primarily
- * for hash-table based address lookup (IPv4, IPv6, and Ethernet MAC).
- * NOTE: This function is never used for cryptographic purposes, only
- * to produce evenly-distributed indexes into hash tables.
- *
- * Benchmark results: 11.39 machine cycles per byte on a P2 266Mhz,
- *                   and 12.1 machine cycles per byte on a
- *                   2.2 Ghz P4 when hashing a 6 byte string.
+ * The per-table initval perturbs every multiplicand, so tables seeded
+ * from get_random() do not present a predictable bucket mapping to
+ * remote peers.  As before, this function is never used for
+ * cryptographic purposes, only to produce evenly-distributed indexes
+ * into hash tables.
  * --------------------------------------------------------------------
  */
 
-#define mix(a,b,c)               \
-    {                                \
-        a -= b; a -= c; a ^= (c>>13);  \
-        b -= c; b -= a; b ^= (a<<8);   \
-        c -= a; c -= b; c ^= (b>>13);  \
-        a -= b; a -= c; a ^= (c>>12);  \
-        b -= c; b -= a; b ^= (a<<16);  \
-        c -= a; c -= b; c ^= (b>>5);   \
-        a -= b; a -= c; a ^= (c>>3);   \
-        b -= c; b -= a; b ^= (a<<10);  \
-        c -= a; c -= b; c ^= (b>>15);  \
-    }
+/* unaligned native-endian loads; compilers reduce these to single
+ * load instructions.  Hash values never leave the process, so there
+ * is no need to canonicalize byte order. */
+static inline uint64_t
+hash_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t
+hash_read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* fold a 64x64->128 bit product into 64 bits */
+static inline uint64_t
+hash_mix64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 r = (unsigned __int128) a * b;
+    return (uint64_t) r ^ (uint64_t) (r >> 64);
+#else
+    /* portable fallback: multiply-xorshift finalizer */
+    a ^= b;
+    a *= 0x9e3779b97f4a7c15ULL;
+    a ^= a >> 32;
+    a *= 0xd6e8feb86659fd93ULL;
+    return a ^ (a >> 32);
+#endif
+}
+
+#define HASH_SECRET0 0xa0761d6478bd642fULL
+#define HASH_SECRET1 0xe7037ed1a0b428dbULL
 
 uint32_t
 hash_func(const uint8_t *k, uint32_t length, uint32_t initval)
 {
-    uint32_t a, b, c, len;
+    const uint32_t len = length;
+    uint64_t seed = HASH_SECRET0 ^ initval;
+    uint64_t a, b;
 
-    /* Set up the internal state */
-    len = length;
-    a = b = 0x9e3779b9;      /* the golden ratio; an arbitrary value */
-    c = initval;             /* the previous hash value */
-
-    /*---------------------------------------- handle most of the key */
-    while (len >= 12)
+    if (len <= 16)
     {
-        a += (k[0] + ((uint32_t) k[1] << 8)
-              + ((uint32_t) k[2] << 16)
-              + ((uint32_t) k[3] << 24));
-        b += (k[4] + ((uint32_t) k[5] << 8)
-              + ((uint32_t) k[6] << 16)
-              + ((uint32_t) k[7] << 24));
-        c += (k[8] + ((uint32_t) k[9] << 8)
-              + ((uint32_t) k[10] << 16)
-              + ((uint32_t) k[11] << 24));
-        mix(a, b, c);
-        k += 12;
-        len -= 12;
+        if (len >= 4)
+        {
+            /* two overlapping 4-byte load pairs cover 4..16 bytes */
+            a = (hash_read32(k) << 32)
+                | hash_read32(k + ((len >> 3) << 2));
+            b = (hash_read32(k + len - 4) << 32)
+                | hash_read32(k + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+        {
+            a = ((uint64_t) k[0] << 16)
+                | ((uint64_t) k[len >> 1] << 8)
+                | k[len - 1];
+            b = 0;
+        }
+        else
+        {
+            a = b = 0;
+        }
     }
-
-    /*------------------------------------- handle the last 11 bytes */
-    c += length;
-    switch (len)            /* all the case statements fall through */
+    else
     {
-        case 11:
-            c += ((uint32_t) k[10] << 24);
-
-        case 10:
-            c += ((uint32_t) k[9] << 16);
-
-        case 9:
-            c += ((uint32_t) k[8] << 8);
-
-        /* the first byte of c is reserved for the length */
-        case 8:
-            b += ((uint32_t) k[7] << 24);
-
-        case 7:
-            b += ((uint32_t) k[6] << 16);
-
-        case 6:
-            b += ((uint32_t) k[5] << 8);
-
-        case 5:
-            b += k[4];
-
-        case 4:
-            a += ((uint32_t) k[3] << 24);
-
-        case 3:
-            a += ((uint32_t) k[2] << 16);
-
-        case 2:
-            a += ((uint32_t) k[1] << 8);
-
-        case 1:
-            a += k[0];
-            /* case 0: nothing left to add */
+        uint32_t i = len;
+        while (i > 16)
+        {
+            seed = hash_mix64(hash_read64(k) ^ HASH_SECRET1,
+                              hash_read64(k + 8) ^ seed);
+            k += 16;
+            i -= 16;
+        }
+        /* final 16 bytes, overlapping the last full block */
+        a = hash_read64(k + i - 16);
+        b = hash_read64(k + i - 8);
     }
-    mix(a, b, c);
-    /*-------------------------------------- report the result */
-    return c;
+
+    a = hash_mix64(a ^ HASH_SECRET1, b ^ seed);
+    return (uint32_t) hash_mix64(a ^ HASH_SECRET0 ^ len, HASH_SECRET1);
 }
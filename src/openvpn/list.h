@@ -42,14 +42,32 @@
 #define hashsize(n) ((uint32_t)1<<(n))
 #define hashmask(n) (hashsize(n)-1)
 
+/*
+ * The table uses open addressing with linear probing: elements live
+ * inline in one slot array, so a lookup walks adjacent cache lines
+ * instead of chasing per-element heap pointers.  Deletions leave
+ * tombstones, which keeps live struct hash_element pointers and
+ * iterators stable; tombstones are purged when the table resizes.
+ */
+
+#define HT_SLOT_EMPTY   0       /* never used (calloc default) */
+#define HT_SLOT_FULL    1
+#define HT_SLOT_DELETED 2       /* tombstone, skipped but probed through */
+
 struct hash_element
 {
     void *value;
     const void *key;
     unsigned int hash_value;
-    struct hash_element *next;
+    unsigned int state;         /* HT_SLOT_x */
 };
 
+/*
+ * Retained so that callers can keep precomputing a bucket alongside the
+ * hash value; with open addressing the probe sequence depends only on
+ * the hash value, so the bucket pointer is vestigial and never
+ * dereferenced.
+ */
 struct hash_bucket
 {
     struct hash_element *list;
@@ -57,13 +75,28 @@ struct hash_bucket
 
 struct hash
 {
-    int n_buckets;
+    int n_buckets;              /* slot count, always a power of 2 */
     int n_elements;
+    int n_tombstones;
+    int min_buckets;            /* never resize below the initial size */
+    int iter_depth;             /* live iterators, defers resizing */
+    bool resize_pending;
     int mask;
     uint32_t iv;
     uint32_t (*hash_function)(const void *key, uint32_t iv);
     bool (*compare_function)(const void *key1, const void *key2); /* return true if equal */
-    struct hash_bucket *buckets;
+    struct hash_element *slots;
+
+    /*
+     * Incremental resize.  While old_slots is non-NULL a grow is in
+     * progress: lookups probe both arrays, inserts go to the new array
+     * only, and every table operation migrates a few old slots, so no
+     * single operation pays for rehashing the whole table.
+     */
+    struct hash_element *old_slots;
+    int old_n_buckets;
+    int old_mask;
+    int migrate_index;          /* next old slot to migrate */
 };
 
 struct hash *hash_init(const int n_buckets,
@@ -75,6 +108,12 @@ void hash_free(struct hash *hash);
 
 bool hash_add(struct hash *hash, const void *key, void *value, bool replace);
 
+void hash_add_fast(struct hash *hash,
+                   struct hash_bucket *bucket,
+                   const void *key,
+                   uint32_t hv,
+                   void *value);
+
 struct hash_element *hash_lookup_fast(struct hash *hash,
                                       struct hash_bucket *bucket,
                                       const void *key,
@@ -90,11 +129,8 @@ void hash_remove_by_value(struct hash *hash, void *value);
 struct hash_iterator
 {
     struct hash *hash;
-    int bucket_index;
-    struct hash_bucket *bucket;
-    struct hash_element *elem;
-    struct hash_element *last;
-    bool bucket_marked;
+    int bucket_index;           /* next slot to visit */
+    struct hash_element *last;  /* most recently returned element */
     int bucket_index_start;
     int bucket_index_end;
 };
@@ -140,7 +176,7 @@ hash_n_buckets(const struct hash *hash)
 static inline struct hash_bucket *
 hash_bucket(struct hash *hash, uint32_t hv)
 {
-    return &hash->buckets[hv & hash->mask];
+    return NULL;
 }
 
 static inline void *
@@ -149,9 +185,8 @@ hash_lookup(struct hash *hash, const void *key)
     void *ret = NULL;
     struct hash_element *he;
     uint32_t hv = hash_value(hash, key);
-    struct hash_bucket *bucket = &hash->buckets[hv & hash->mask];
 
-    he = hash_lookup_fast(hash, bucket, key, hv);
+    he = hash_lookup_fast(hash, NULL, key, hv);
     if (he)
     {
         ret = he->value;
@@ -160,36 +195,13 @@ hash_lookup(struct hash *hash, const void *key)
     return ret;
 }
 
-/* NOTE: assumes that key is not a duplicate */
-static inline void
-hash_add_fast(struct hash *hash,
-              struct hash_bucket *bucket,
-              const void *key,
-              uint32_t hv,
-              void *value)
-{
-    struct hash_element *he;
-
-    ALLOC_OBJ(he, struct hash_element);
-    he->value = value;
-    he->key = key;
-    he->hash_value = hv;
-    he->next = bucket->list;
-    bucket->list = he;
-    ++hash->n_elements;
-}
-
 static inline bool
 hash_remove(struct hash *hash, const void *key)
 {
     uint32_t hv;
-    struct hash_bucket *bucket;
-    bool ret;
 
     hv = hash_value(hash, key);
-    bucket = &hash->buckets[hv & hash->mask];
-    ret = hash_remove_fast(hash, bucket, key, hv);
-    return ret;
+    return hash_remove_fast(hash, NULL, key, hv);
 }
 
 #endif /* LIST */
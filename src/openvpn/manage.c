@@ -39,6 +39,8 @@
 #include "otime.h"
 #include "integer.h"
 #include "misc.h"
+#include "perf.h"
+#include "memprof.h"
 #include "ssl.h"
 #include "common.h"
 #include "manage.h"
@@ -73,6 +75,7 @@ man_help(void)
     msg(M_CLIENT, "Management Interface for %s", title_string);
     msg(M_CLIENT, "Commands:");
     msg(M_CLIENT, "auth-retry t           : Auth failure retry mode (none,interact,nointeract).");
+    msg(M_CLIENT, "binary [n]             : Switch output to length-prefixed binary framing (version n).");
     msg(M_CLIENT, "bytecount n            : Show bytes in/out, update every n secs (0=off).");
     msg(M_CLIENT, "echo [on|off] [N|all]  : Like log, but only show messages in echo buffer.");
     msg(M_CLIENT, "cr-response response   : Send a challenge response answer via CR_RESPONSE to server");
@@ -87,7 +90,11 @@ man_help(void)
     msg(M_CLIENT, "log [on|off] [N|all]   : Turn on/off realtime log display");
     msg(M_CLIENT, "                         + show last N lines or 'all' for entire history.");
     msg(M_CLIENT, "mute [n]               : Set log mute level to n, or show level if n is absent.");
+#ifdef ENABLE_MEM_PROFILE
+    msg(M_CLIENT, "memprof                : Show per-callsite allocation counters.");
+#endif
     msg(M_CLIENT, "needok type action     : Enter confirmation for NEED-OK request of 'type',");
+    msg(M_CLIENT, "perf [reset]           : Show (or reset) per-section latency histograms.");
     msg(M_CLIENT, "                         where action = 'ok' or 'cancel'.");
     msg(M_CLIENT, "needstr type action    : Enter confirmation for NEED-STR request of 'type',");
     msg(M_CLIENT, "                         where action is reply string.");
@@ -120,6 +127,8 @@ man_help(void)
     msg(M_CLIENT, "signal s               : Send signal s to daemon,");
     msg(M_CLIENT, "                         s = SIGHUP|SIGTERM|SIGUSR1|SIGUSR2.");
     msg(M_CLIENT, "state [on|off] [N|all] : Like log, but show state history.");
+    msg(M_CLIENT, "verify-reload [cmd]    : Reload CRL and pf rule files without restarting clients,");
+    msg(M_CLIENT, "                         optionally replacing the tls-verify command with cmd.");
     msg(M_CLIENT, "status [n]             : Show current daemon status info using format #n.");
     msg(M_CLIENT, "test n                 : Produce n lines of output for testing/debugging.");
     msg(M_CLIENT, "username type u        : Enter username u for a queried OpenVPN username.");
@@ -246,12 +255,83 @@ man_output_list_push_finalize(struct management *man)
     }
 }
 
+static int man_write(struct management *man);
+
+/*
+ * Stream a large command reply in bounded windows.  Once the output
+ * queue crosses the high-water mark, write it down to the low-water
+ * mark before rendering more of the reply, so a reply of unbounded
+ * size -- "status" on a server with thousands of clients -- never
+ * materializes in memory all at once.  Writability is awaited with a
+ * short timeout and a bounded number of waits; a client that stops
+ * reading just falls back to the old queue-everything behavior.
+ */
+static void
+man_output_stream_drain(struct management *man)
+{
+    struct man_connection *mc = &man->connection;
+    int waits = MANAGEMENT_OUTPUT_STREAM_WAITS;
+
+    while (mc->out && mc->out->size > MANAGEMENT_OUTPUT_STREAM_LOW)
+    {
+        if (man_write(man) > 0)
+        {
+            continue;
+        }
+        if (--waits < 0)
+        {
+            break;
+        }
+        struct timeval tv = { 1, 0 };
+        struct event_set_return esr;
+        event_reset(mc->es);
+        man_update_io_state(man);
+        management_socket_set(man, mc->es, NULL, NULL);
+        if (event_wait(mc->es, &tv, &esr, 1) <= 0)
+        {
+            break;
+        }
+    }
+}
+
 static void
 man_output_list_push_str(struct management *man, const char *str)
 {
     if (management_connected(man) && str)
     {
         buffer_list_push(man->connection.out, str);
+        if (man->connection.out->size >= MANAGEMENT_OUTPUT_STREAM_HIGH)
+        {
+            man_output_stream_drain(man);
+        }
+    }
+}
+
+/*
+ * Make room for one more output entry if the queue has grown to
+ * MANAGEMENT_OUTPUT_LIST_MAX_ENTRIES, dropping the oldest entries.
+ * Called before queueing real-time notifications (log, echo, state,
+ * bytecount), which are regenerable and may be discarded when the
+ * client stops reading.  Command replies are never dropped.
+ */
+static void
+man_output_drop_excess(struct management *man)
+{
+    struct buffer_list *out = man->connection.out;
+    while (out && out->size >= MANAGEMENT_OUTPUT_LIST_MAX_ENTRIES)
+    {
+        buffer_list_pop(out);
+        ++man->connection.out_dropped;
+    }
+}
+
+static void
+man_output_list_push_volatile(struct management *man, const char *str)
+{
+    if (management_connected(man) && str)
+    {
+        man_output_drop_excess(man);
+        buffer_list_push(man->connection.out, str);
     }
 }
 
@@ -262,6 +342,44 @@ man_output_list_push(struct management *man, const char *str)
     man_output_list_push_finalize(man);
 }
 
+/*
+ * Byte-order helper for 64-bit binary protocol fields.
+ */
+static uint64_t
+man_hton64(const uint64_t x)
+{
+    const uint32_t hi = htonl((uint32_t)(x >> 32));
+    const uint32_t lo = htonl((uint32_t)(x & 0xffffffff));
+    uint64_t out;
+
+    memcpy(&out, &hi, sizeof(hi));
+    memcpy((uint8_t *)&out + sizeof(hi), &lo, sizeof(lo));
+    return out;
+}
+
+/*
+ * Emit one length-prefixed frame of the binary management protocol
+ * (see the 'binary' command and the MBF_x types in manage.h).
+ */
+static void
+man_output_binary_frame(struct management *man, const uint8_t type,
+                        const void *payload, const int len)
+{
+    if (management_connected(man))
+    {
+        uint8_t header[5];
+        const uint32_t netlen = htonl((uint32_t)len);
+
+        header[0] = type;
+        memcpy(&header[1], &netlen, sizeof(netlen));
+        buffer_list_push_data(man->connection.out, header, sizeof(header));
+        if (len > 0)
+        {
+            buffer_list_push_data(man->connection.out, payload, (size_t)len);
+        }
+    }
+}
+
 static void
 man_prompt(struct management *man)
 {
@@ -340,6 +458,7 @@ virtual_output_callback_func(void *arg, const unsigned int flags, const char *st
 
         if (!man_password_needed(man))
         {
+            bool realtime = false;
             if (flags == M_CLIENT)
             {
                 out = log_entry_print(&e, LOG_PRINT_CRLF, &gc);
@@ -350,10 +469,26 @@ virtual_output_callback_func(void *arg, const unsigned int flags, const char *st
                                       |   LOG_PRINT_MSG_FLAGS
                                       |   LOG_PRINT_LOG_PREFIX
                                       |   LOG_PRINT_CRLF, &gc);
+                realtime = true;
             }
             if (out)
             {
-                man_output_list_push_str(man, out);
+                if (man->connection.binary_output)
+                {
+                    if (realtime)
+                    {
+                        man_output_drop_excess(man);
+                    }
+                    man_output_binary_frame(man, MBF_TEXT, out, (int)strlen(out));
+                }
+                else if (realtime)
+                {
+                    man_output_list_push_volatile(man, out);
+                }
+                else
+                {
+                    man_output_list_push_str(man, out);
+                }
                 action_flags |= AF_DID_PUSH;
             }
             if (flags & M_FATAL)
@@ -361,7 +496,14 @@ virtual_output_callback_func(void *arg, const unsigned int flags, const char *st
                 out = log_entry_print(&e, LOG_FATAL_NOTIFY|LOG_PRINT_CRLF, &gc);
                 if (out)
                 {
-                    man_output_list_push_str(man, out);
+                    if (man->connection.binary_output)
+                    {
+                        man_output_binary_frame(man, MBF_TEXT, out, (int)strlen(out));
+                    }
+                    else
+                    {
+                        man_output_list_push_str(man, out);
+                    }
                     action_flags |= (AF_DID_PUSH|AF_DID_RESET);
                 }
             }
@@ -442,6 +584,27 @@ man_signal(struct management *man, const char *name)
     }
 }
 
+static void
+man_verify_reload(struct management *man, const char *tls_verify_cmd)
+{
+    if (man->persist.callback.verify_reload)
+    {
+        if ((*man->persist.callback.verify_reload)(man->persist.callback.arg,
+                                                   tls_verify_cmd))
+        {
+            msg(M_CLIENT, "SUCCESS: verification state reloaded");
+        }
+        else
+        {
+            msg(M_CLIENT, "ERROR: verification state reload failed");
+        }
+    }
+    else
+    {
+        msg(M_CLIENT, "ERROR: The 'verify-reload' command is not supported by the current daemon mode");
+    }
+}
+
 static void
 man_status(struct management *man, const int version, struct status_output *so)
 {
@@ -472,27 +635,114 @@ man_bytecount(struct management *man, const int update_seconds)
 void
 man_bytecount_output_client(struct management *man)
 {
-    char in[32];
-    char out[32];
-    /* do in a roundabout way to work around possible mingw or mingw-glibc bug */
-    openvpn_snprintf(in, sizeof(in), counter_format, man->persist.bytes_in);
-    openvpn_snprintf(out, sizeof(out), counter_format, man->persist.bytes_out);
-    msg(M_CLIENT, ">BYTECOUNT:%s,%s", in, out);
+    if (man->connection.binary_output)
+    {
+        struct man_binary_bytecount bc;
+        bc.bytes_in = man_hton64(man->persist.bytes_in);
+        bc.bytes_out = man_hton64(man->persist.bytes_out);
+        man_output_drop_excess(man);
+        man_output_binary_frame(man, MBF_BYTECOUNT, &bc, sizeof(bc));
+        man_output_list_push_finalize(man);
+    }
+    else
+    {
+        char in[32];
+        char out[32];
+        char line[96];
+        /* do in a roundabout way to work around possible mingw or mingw-glibc bug */
+        openvpn_snprintf(in, sizeof(in), counter_format, man->persist.bytes_in);
+        openvpn_snprintf(out, sizeof(out), counter_format, man->persist.bytes_out);
+        openvpn_snprintf(line, sizeof(line), ">BYTECOUNT:%s,%s\r\n", in, out);
+        man_output_list_push_volatile(man, line);
+        man_output_list_push_finalize(man);
+    }
     man->connection.bytecount_last_update = now;
 }
 
+/*
+ * Send the accumulated per-client counter batch as a single
+ * MBF_BYTECOUNT_CLI_BATCH frame (binary protocol version 2).  Called
+ * when the interval advances, when the batch fills, and from the event
+ * loop so that the last records of an interval are not held back until
+ * the next client reports.
+ */
+void
+man_bytecount_flush_server(struct management *man)
+{
+    struct man_connection *mc = &man->connection;
+    if (buf_defined(&mc->bytecount_batch) && BLEN(&mc->bytecount_batch) > 0)
+    {
+        man_output_drop_excess(man);
+        man_output_binary_frame(man, MBF_BYTECOUNT_CLI_BATCH,
+                                BPTR(&mc->bytecount_batch),
+                                BLEN(&mc->bytecount_batch));
+        man_output_list_push_finalize(man);
+        buf_reset_len(&mc->bytecount_batch);
+    }
+}
+
 void
 man_bytecount_output_server(struct management *man,
                             const counter_type *bytes_in_total,
                             const counter_type *bytes_out_total,
                             struct man_def_auth_context *mdac)
 {
-    char in[32];
-    char out[32];
-    /* do in a roundabout way to work around possible mingw or mingw-glibc bug */
-    openvpn_snprintf(in, sizeof(in), counter_format, *bytes_in_total);
-    openvpn_snprintf(out, sizeof(out), counter_format, *bytes_out_total);
-    msg(M_CLIENT, ">BYTECOUNT_CLI:%lu,%s,%s", mdac->cid, in, out);
+    if (man->connection.binary_output && man->connection.binary_version >= 2)
+    {
+        struct man_connection *mc = &man->connection;
+
+        /* only clients whose counters moved are reported at all */
+        if (*bytes_in_total != mdac->bytecount_last_in
+            || *bytes_out_total != mdac->bytecount_last_out)
+        {
+            struct man_binary_bytecount_cli bc;
+            bc.cid = htonl((uint32_t)mdac->cid);
+            bc.bytes_in = man_hton64(*bytes_in_total);
+            bc.bytes_out = man_hton64(*bytes_out_total);
+
+            if (!buf_defined(&mc->bytecount_batch))
+            {
+                mc->bytecount_batch =
+                    alloc_buf(MANAGEMENT_BYTECOUNT_BATCH_RECORDS * sizeof(bc));
+            }
+            /* records for a new interval start a new frame */
+            if (mc->bytecount_batch_time != now)
+            {
+                man_bytecount_flush_server(man);
+                mc->bytecount_batch_time = now;
+            }
+            if (!buf_write(&mc->bytecount_batch, &bc, sizeof(bc)))
+            {
+                man_bytecount_flush_server(man);
+                ASSERT(buf_write(&mc->bytecount_batch, &bc, sizeof(bc)));
+            }
+            mdac->bytecount_last_in = *bytes_in_total;
+            mdac->bytecount_last_out = *bytes_out_total;
+        }
+    }
+    else if (man->connection.binary_output)
+    {
+        struct man_binary_bytecount_cli bc;
+        bc.cid = htonl((uint32_t)mdac->cid);
+        bc.bytes_in = man_hton64(*bytes_in_total);
+        bc.bytes_out = man_hton64(*bytes_out_total);
+        man_output_drop_excess(man);
+        man_output_binary_frame(man, MBF_BYTECOUNT_CLI, &bc, sizeof(bc));
+        man_output_list_push_finalize(man);
+    }
+    else
+    {
+        char in[32];
+        char out[32];
+        char line[128];
+        /* do in a roundabout way to work around possible mingw or mingw-glibc bug */
+        openvpn_snprintf(in, sizeof(in), counter_format, *bytes_in_total);
+        openvpn_snprintf(out, sizeof(out), counter_format, *bytes_out_total);
+        openvpn_snprintf(line, sizeof(line), ">BYTECOUNT_CLI:%lu,%s,%s\r\n",
+                         mdac->cid, in, out);
+        man_output_list_push_volatile(man, line);
+        man_output_list_push_finalize(man);
+    }
     mdac->bytecount_last_update = now;
 }
 
@@ -1173,16 +1423,26 @@ man_load_stats(struct management *man)
 {
     extern counter_type link_read_bytes_global;
     extern counter_type link_write_bytes_global;
+    extern counter_type tls_crypt_v2_cache_hits;
+    extern counter_type tls_crypt_v2_cache_misses;
+    extern counter_type cert_verify_cache_hits;
+    extern counter_type cert_verify_cache_misses;
     int nclients = 0;
 
     if (man->persist.callback.n_clients)
     {
         nclients = (*man->persist.callback.n_clients)(man->persist.callback.arg);
     }
-    msg(M_CLIENT, "SUCCESS: nclients=%d,bytesin=" counter_format ",bytesout=" counter_format,
+    msg(M_CLIENT, "SUCCESS: nclients=%d,bytesin=" counter_format ",bytesout=" counter_format
+        ",wkc_cache_hits=" counter_format ",wkc_cache_misses=" counter_format
+        ",cert_cache_hits=" counter_format ",cert_cache_misses=" counter_format,
         nclients,
         link_read_bytes_global,
-        link_write_bytes_global);
+        link_write_bytes_global,
+        tls_crypt_v2_cache_hits,
+        tls_crypt_v2_cache_misses,
+        cert_verify_cache_hits,
+        cert_verify_cache_misses);
 }
 
 #define MN_AT_LEAST (1<<0)
@@ -1314,10 +1574,45 @@ man_dispatch_command(struct management *man, struct status_output *so, const cha
         msg(M_CLIENT, "Management Version: %d", MANAGEMENT_VERSION);
         msg(M_CLIENT, "END");
     }
+    else if (streq(p[0], "binary"))
+    {
+        const int ver = p[1] ? atoi(p[1]) : MANAGEMENT_BINARY_VERSION;
+        if (ver >= 1 && ver <= MANAGEMENT_BINARY_VERSION)
+        {
+            /* the reply still goes out as text; everything after
+             * it is framed */
+            msg(M_CLIENT, "SUCCESS: binary protocol version %d enabled", ver);
+            man->connection.binary_output = true;
+            man->connection.binary_version = ver;
+        }
+        else
+        {
+            msg(M_CLIENT, "ERROR: unsupported binary protocol version (max %d)",
+                MANAGEMENT_BINARY_VERSION);
+        }
+    }
     else if (streq(p[0], "pid"))
     {
         msg(M_CLIENT, "SUCCESS: pid=%d", platform_getpid());
     }
+    else if (streq(p[0], "perf"))
+    {
+        if (p[1] && streq(p[1], "reset"))
+        {
+            perf_hist_reset();
+            msg(M_CLIENT, "SUCCESS: perf histograms reset");
+        }
+        else
+        {
+            perf_hist_output_client();
+        }
+    }
+#ifdef ENABLE_MEM_PROFILE
+    else if (streq(p[0], "memprof"))
+    {
+        memprof_output_client();
+    }
+#endif
     else if (streq(p[0], "nclients"))
     {
         man_client_n_clients(man);
@@ -1370,6 +1665,10 @@ man_dispatch_command(struct management *man, struct status_output *so, const cha
             man_kill(man, p[1]);
         }
     }
+    else if (streq(p[0], "verify-reload"))
+    {
+        man_verify_reload(man, p[1]);
+    }
     else if (streq(p[0], "verb"))
     {
         if (p[1])
@@ -1713,7 +2012,13 @@ man_connection_settings_reset(struct management *man)
     man->connection.state_realtime = false;
     man->connection.log_realtime = false;
     man->connection.echo_realtime = false;
+    man->connection.binary_output = false;
+    man->connection.binary_version = 0;
     man->connection.bytecount_update_seconds = 0;
+    if (buf_defined(&man->connection.bytecount_batch))
+    {
+        buf_reset_len(&man->connection.bytecount_batch);
+    }
     man->connection.password_verified = false;
     man->connection.password_tries = 0;
     man->connection.halt = false;
@@ -1857,7 +2162,7 @@ man_listen(struct management *man)
         {
             man->connection.sd_top = create_socket_tcp(man->settings.local);
             socket_bind(man->connection.sd_top, man->settings.local,
-                        man->settings.local->ai_family, "MANAGEMENT", false);
+                        man->settings.local->ai_family, "MANAGEMENT", false, 0);
         }
 
         /*
@@ -1974,6 +2279,7 @@ man_reset_client_socket(struct management *man, const bool exiting)
         man->connection.state = MS_INITIAL;
         command_line_reset(man->connection.in);
         buffer_list_reset(man->connection.out);
+        man->connection.out_dropped = 0;
         in_extra_reset(&man->connection, IER_RESET);
         msg(D_MANAGEMENT, "MANAGEMENT: Client disconnected");
     }
@@ -2305,30 +2611,70 @@ man_read(struct management *man)
     return len;
 }
 
+#define MAN_WRITE_MAX_IOV 64
+
 static int
 man_write(struct management *man)
 {
     const int size_hint = 1024;
     int sent = 0;
-    const struct buffer *buf;
+    bool attempted = false;
 
-    buffer_list_aggregate(man->connection.out, size_hint);
-    buf = buffer_list_peek(man->connection.out);
-    if (buf && BLEN(buf))
-    {
-        const int len = min_int(size_hint, BLEN(buf));
+#ifndef _WIN32
+    /* write the queued output segments directly from the list via
+     * scatter-gather I/O; flattening them with buffer_list_aggregate()
+     * copied every byte of large status dumps into freshly allocated
+     * buffers before anything could be sent */
+    struct iovec iov[MAN_WRITE_MAX_IOV];
+    const int iovcnt = buffer_list_peek_iov(man->connection.out, iov,
+                                            MAN_WRITE_MAX_IOV, size_hint);
+    if (iovcnt > 0)
+    {
+        attempted = true;
 #ifdef TARGET_ANDROID
         if (man->connection.fdtosend > 0)
         {
-            sent = man_send_with_fd(man->connection.sd_cli, BPTR(buf), len, MSG_NOSIGNAL,man->connection.fdtosend);
+            /* passing an fd needs its own cmsg send; write just the
+             * first segment the traditional way */
+            sent = man_send_with_fd(man->connection.sd_cli, iov[0].iov_base,
+                                    iov[0].iov_len, MSG_NOSIGNAL,
+                                    man->connection.fdtosend);
             man->connection.fdtosend = -1;
         }
         else
 #endif
+        {
+            struct msghdr m = { 0 };
+            m.msg_iov = iov;
+            m.msg_iovlen = iovcnt;
+            sent = sendmsg(man->connection.sd_cli, &m, MSG_NOSIGNAL);
+        }
+    }
+#else  /* _WIN32 */
+    const struct buffer *buf;
+
+    buffer_list_aggregate(man->connection.out, size_hint);
+    buf = buffer_list_peek(man->connection.out);
+    if (buf && BLEN(buf))
+    {
+        const int len = min_int(size_hint, BLEN(buf));
+        attempted = true;
         sent = send(man->connection.sd_cli, BPTR(buf), len, MSG_NOSIGNAL);
+    }
+#endif /* ifndef _WIN32 */
+
+    if (attempted)
+    {
         if (sent >= 0)
         {
             buffer_list_advance(man->connection.out, sent);
+            if (man->connection.out_dropped
+                && !buffer_list_defined(man->connection.out))
+            {
+                const int n = man->connection.out_dropped;
+                man->connection.out_dropped = 0;
+                msg(D_MANAGEMENT, "MAN: %d real-time output entries dropped while client was not reading", n);
+            }
         }
         else if (sent < 0)
         {
@@ -2606,6 +2952,7 @@ man_connection_close(struct management *man)
 
     command_line_free(mc->in);
     buffer_list_free(mc->out);
+    free_buf(&mc->bytecount_batch);
 
     in_extra_reset(&man->connection, IER_RESET);
     buffer_list_free(mc->ext_key_input);
@@ -2764,7 +3111,8 @@ management_set_state(struct management *man,
 
         if (out)
         {
-            man_output_list_push(man, out);
+            man_output_list_push_volatile(man, out);
+            man_output_list_push_finalize(man);
         }
 
         gc_free(&gc);
@@ -3017,7 +3365,8 @@ management_echo(struct management *man, const char *string, const bool pull)
 
         if (out)
         {
-            man_output_list_push(man, out);
+            man_output_list_push_volatile(man, out);
+            man_output_list_push_finalize(man);
         }
 
         gc_free(&gc);
@@ -3102,6 +3451,11 @@ management_socket_set(struct management *man,
         event_t ev = net_event_win32_get_event(&man->connection.ne32);
         net_event_win32_reset_write(&man->connection.ne32);
 
+        if (man->connection.bytecount_batch_time != now)
+        {
+            man_bytecount_flush_server(man);
+        }
+
         switch (man->connection.state)
         {
             case MS_LISTEN:
@@ -3186,6 +3540,11 @@ management_socket_set(struct management *man,
                       void *arg,
                       unsigned int *persistent)
 {
+    if (man->connection.bytecount_batch_time != now)
+    {
+        man_bytecount_flush_server(man);
+    }
+
     switch (man->connection.state)
     {
         case MS_LISTEN:
@@ -33,10 +33,76 @@
 
 #define MANAGEMENT_VERSION                      3
 #define MANAGEMENT_N_PASSWORD_RETRIES           3
+
+/*
+ * Binary management protocol.  After a successful 'binary' command,
+ * all output to the management client is framed as
+ *
+ *   uint8_t type, uint32_t payload length (network order), payload
+ *
+ * so high-frequency consumers can dispatch on a fixed header instead
+ * of scanning a text stream.  Command input remains line-based.
+ *
+ * Version 2 replaces the per-client MBF_BYTECOUNT_CLI frames on
+ * servers with MBF_BYTECOUNT_CLI_BATCH: counters are accumulated and
+ * sent as one frame per interval, and clients whose counters did not
+ * change since their last report are omitted entirely.
+ */
+#define MANAGEMENT_BINARY_VERSION               2
+
+#define MBF_TEXT          0 /* payload: one line of regular text output */
+#define MBF_BYTECOUNT     1 /* payload: struct man_binary_bytecount */
+#define MBF_BYTECOUNT_CLI 2 /* payload: struct man_binary_bytecount_cli */
+#define MBF_BYTECOUNT_CLI_BATCH 3 /* payload: array of struct man_binary_bytecount_cli */
+
+#pragma pack(1)
+
+/* all multi-byte fields in network byte order */
+struct man_binary_bytecount
+{
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+};
+
+struct man_binary_bytecount_cli
+{
+    uint32_t cid;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+};
+
+#pragma pack()
 #define MANAGEMENT_LOG_HISTORY_INITIAL_SIZE   100
 #define MANAGEMENT_ECHO_BUFFER_SIZE           100
 #define MANAGEMENT_STATE_BUFFER_SIZE          100
 
+/*
+ * Maximum number of buffered output entries per management client.
+ * Once the queue is this long, real-time notifications (log, echo,
+ * state, bytecount) are dropped oldest-first rather than queued,
+ * so a stalled client cannot grow the queue without bound.
+ */
+#define MANAGEMENT_OUTPUT_LIST_MAX_ENTRIES   4096
+
+/*
+ * Capacity of the server-side bytecount batch, in per-client records.
+ * A full batch is flushed early as its own frame, so this bounds frame
+ * size, not the number of clients that can be reported per interval.
+ */
+#define MANAGEMENT_BYTECOUNT_BATCH_RECORDS   3000
+
+/*
+ * Command replies are never dropped; instead, large replies are
+ * streamed: when the output queue reaches the high-water mark it is
+ * written to the client socket down to the low-water mark before more
+ * of the reply is rendered, bounding the memory a reply of any size
+ * can occupy.  At typical status line lengths the high mark
+ * corresponds to a window in the tens of kilobytes.
+ */
+#define MANAGEMENT_OUTPUT_STREAM_HIGH        512
+#define MANAGEMENT_OUTPUT_STREAM_LOW         64
+#define MANAGEMENT_OUTPUT_STREAM_WAITS       10
+
 /*
  * Management-interface-based deferred authentication
  */
@@ -51,6 +117,8 @@ struct man_def_auth_context {
     unsigned int mda_key_id_counter;
 
     time_t bytecount_last_update;
+    counter_type bytecount_last_in;  /* counters as of the last report, */
+    counter_type bytecount_last_out; /* for the changed-client filter */
 };
 
 /*
@@ -175,6 +243,7 @@ struct management_callback
                                  const unsigned long cid,
                                  const char *url);
     char *(*get_peer_info) (void *arg, const unsigned long cid);
+    bool (*verify_reload) (void *arg, const char *tls_verify_cmd);
 #ifdef MANAGEMENT_PF
     bool (*client_pf)(void *arg,
                       const unsigned long cid,
@@ -274,6 +343,7 @@ struct man_connection {
 
     struct command_line *in;
     struct buffer_list *out;
+    int out_dropped; /* real-time output entries dropped due to backlog */
 
 #define IEC_UNDEF       0
 #define IEC_CLIENT_AUTH 1
@@ -299,8 +369,12 @@ struct man_connection {
     bool state_realtime;
     bool log_realtime;
     bool echo_realtime;
+    bool binary_output; /* length-prefixed binary output framing */
+    int binary_version; /* negotiated by the 'binary' command */
     int bytecount_update_seconds;
     time_t bytecount_last_update;
+    struct buffer bytecount_batch;  /* pending man_binary_bytecount_cli records */
+    time_t bytecount_batch_time;    /* interval the pending batch belongs to */
 
     const char *up_query_type;
     int up_query_mode;
@@ -574,6 +648,8 @@ void man_bytecount_output_server(struct management *man,
                                  const counter_type *bytes_out_total,
                                  struct man_def_auth_context *mdac);
 
+void man_bytecount_flush_server(struct management *man);
+
 static inline void
 management_bytes_server(struct management *man,
                         const counter_type *bytes_in_total,
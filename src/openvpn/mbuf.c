@@ -40,11 +40,12 @@
 #include "memdbg.h"
 
 struct mbuf_set *
-mbuf_init(unsigned int size)
+mbuf_init(unsigned int size, int buf_capacity)
 {
     struct mbuf_set *ret;
     ALLOC_OBJ_CLEAR(ret, struct mbuf_set);
     ret->capacity = adjust_power_of_2(size);
+    ret->buf_capacity = buf_capacity;
     ALLOC_ARRAY(ret->array, struct mbuf_item, ret->capacity);
     return ret;
 }
@@ -58,7 +59,14 @@ mbuf_free(struct mbuf_set *ms)
         for (i = 0; i < (int) ms->len; ++i)
         {
             struct mbuf_item *item = &ms->array[MBUF_INDEX(ms->head, i, ms->capacity)];
-            mbuf_free_buf(item->buffer);
+            mbuf_free_buf(ms, item->buffer);
+        }
+        while (ms->free_list)
+        {
+            struct mbuf_buffer *mb = ms->free_list;
+            ms->free_list = mb->next;
+            free_buf(&mb->buf);
+            free(mb);
         }
         free(ms->array);
         free(ms);
@@ -66,25 +74,59 @@ mbuf_free(struct mbuf_set *ms)
 }
 
 struct mbuf_buffer *
-mbuf_alloc_buf(const struct buffer *buf)
+mbuf_alloc_buf(struct mbuf_set *ms, const struct buffer *buf)
 {
     struct mbuf_buffer *ret;
-    ALLOC_OBJ(ret, struct mbuf_buffer);
-    ret->buf = clone_buf(buf);
+    if (ms->free_list && buf->offset + buf->len <= ms->buf_capacity)
+    {
+        /* O(1) pool hit -- reuse a previously freed fixed-size buffer */
+        ret = ms->free_list;
+        ms->free_list = ret->next;
+        --ms->n_free;
+        ret->buf.offset = buf->offset;
+        ret->buf.len = buf->len;
+        memcpy(BPTR(&ret->buf), BPTR(buf), BLEN(buf));
+    }
+    else if (buf->offset + buf->len <= ms->buf_capacity)
+    {
+        /* pool empty -- allocate a poolable buffer of the fixed size */
+        ALLOC_OBJ(ret, struct mbuf_buffer);
+        ret->buf = alloc_buf(ms->buf_capacity);
+        ret->buf.offset = buf->offset;
+        ret->buf.len = buf->len;
+        memcpy(BPTR(&ret->buf), BPTR(buf), BLEN(buf));
+    }
+    else
+    {
+        /* oversized packet -- clone it, mbuf_free_buf() will not pool it */
+        ALLOC_OBJ(ret, struct mbuf_buffer);
+        ret->buf = clone_buf(buf);
+    }
     ret->refcount = 1;
     ret->flags = 0;
+    ret->next = NULL;
     return ret;
 }
 
 void
-mbuf_free_buf(struct mbuf_buffer *mb)
+mbuf_free_buf(struct mbuf_set *ms, struct mbuf_buffer *mb)
 {
     if (mb)
     {
         if (--mb->refcount <= 0)
         {
-            free_buf(&mb->buf);
-            free(mb);
+            if (ms && mb->buf.capacity == ms->buf_capacity
+                && ms->n_free < ms->capacity)
+            {
+                mb->next = ms->free_list;
+                ms->free_list = mb;
+                ++ms->n_free;
+            }
+            else
+            {
+                free_buf(&mb->buf);
+                free(mb);
+            }
         }
     }
 }
@@ -97,7 +139,7 @@ mbuf_add_item(struct mbuf_set *ms, const struct mbuf_item *item)
     {
         struct mbuf_item rm;
         ASSERT(mbuf_extract_item(ms, &rm));
-        mbuf_free_buf(rm.buffer);
+        mbuf_free_buf(ms, rm.buffer);
         msg(D_MULTI_DROPPED, "MBUF: mbuf packet dropped");
     }
 
@@ -132,6 +174,38 @@ mbuf_extract_item(struct mbuf_set *ms, struct mbuf_item *item)
     return ret;
 }
 
+/*
+ * Under congestion, drop one queued bulk (MF_BULK) packet to make room
+ * for an interactive one.  The oldest bulk packet is evicted; the head
+ * of the queue is never touched since a partially written packet may be
+ * parked there.  Returns true if a packet was evicted.
+ */
+bool
+mbuf_evict_bulk(struct mbuf_set *ms)
+{
+    if (ms)
+    {
+        int i;
+        for (i = 1; i < (int) ms->len; ++i)
+        {
+            struct mbuf_item *item = &ms->array[MBUF_INDEX(ms->head, i, ms->capacity)];
+            if (item->instance && (item->buffer->flags & MF_BULK))
+            {
+                int j;
+                mbuf_free_buf(ms, item->buffer);
+                for (j = i; j + 1 < (int) ms->len; ++j)
+                {
+                    ms->array[MBUF_INDEX(ms->head, j, ms->capacity)]
+                        = ms->array[MBUF_INDEX(ms->head, j + 1, ms->capacity)];
+                }
+                --ms->len;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 struct multi_instance *
 mbuf_peek_dowork(struct mbuf_set *ms)
 {
@@ -163,7 +237,7 @@ mbuf_dereference_instance(struct mbuf_set *ms, struct multi_instance *mi)
             struct mbuf_item *item = &ms->array[MBUF_INDEX(ms->head, i, ms->capacity)];
             if (item->instance == mi)
             {
-                mbuf_free_buf(item->buffer);
+                mbuf_free_buf(ms, item->buffer);
                 item->buffer = NULL;
                 item->instance = NULL;
                 msg(D_MBUF, "MBUF: dereferenced queued packet");
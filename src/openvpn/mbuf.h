@@ -46,7 +46,12 @@ struct mbuf_buffer
     int refcount;
 
 #define MF_UNICAST (1<<0)
+#define MF_FRAMED  (1<<1)  /* TCP length prefix already prepended */
+#define MF_BULK    (1<<2)  /* inner packet is non-interactive; preferred
+                            * victim when the queue congests */
     unsigned int flags;
+
+    struct mbuf_buffer *next; /* free-list link, used while pooled */
 };
 
 struct mbuf_item
@@ -62,20 +67,38 @@ struct mbuf_set
     unsigned int capacity;
     unsigned int max_queued;
     struct mbuf_item *array;
+
+    /*
+     * Pool of fixed-size packet buffers, refilled by mbuf_free_buf(),
+     * so that steady-state broadcast/multicast traffic causes no
+     * heap allocation.
+     */
+    struct mbuf_buffer *free_list;
+    unsigned int n_free;
+    int buf_capacity;
 };
 
-struct mbuf_set *mbuf_init(unsigned int size);
+struct mbuf_set *mbuf_init(unsigned int size, int buf_capacity);
 
 void mbuf_free(struct mbuf_set *ms);
 
-struct mbuf_buffer *mbuf_alloc_buf(const struct buffer *buf);
+struct mbuf_buffer *mbuf_alloc_buf(struct mbuf_set *ms, const struct buffer *buf);
 
-void mbuf_free_buf(struct mbuf_buffer *mb);
+void mbuf_free_buf(struct mbuf_set *ms, struct mbuf_buffer *mb);
 
 void mbuf_add_item(struct mbuf_set *ms, const struct mbuf_item *item);
 
 bool mbuf_extract_item(struct mbuf_set *ms, struct mbuf_item *item);
 
+bool mbuf_evict_bulk(struct mbuf_set *ms);
+
+/* access the offset-th queued item without removing it */
+static inline struct mbuf_item *
+mbuf_peek_item(struct mbuf_set *ms, const unsigned int offset)
+{
+    return &ms->array[MBUF_INDEX(ms->head, offset, ms->capacity)];
+}
+
 void mbuf_dereference_instance(struct mbuf_set *ms, struct multi_instance *mi);
 
 static inline bool
@@ -0,0 +1,159 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#include "syshead.h"
+
+#ifdef ENABLE_MEM_PROFILE
+
+#include "error.h"
+#include "memprof.h"
+
+/*
+ * Callsite table.  Open-addressed, keyed by the __FILE__ literal
+ * pointer and line number; the number of distinct allocation callsites
+ * is fixed at compile time, so collisions settle during startup and
+ * every subsequent allocation finds its slot on the first probe.
+ * Slots are never freed.  If the table ever fills up, the remainder
+ * is lumped into a catch-all slot rather than losing bytes.
+ */
+#define MEMPROF_N_SITES 512
+
+static struct memprof_site memprof_sites[MEMPROF_N_SITES];
+static struct memprof_site memprof_overflow = { "(overflow)", 0 };
+
+static inline bool
+memprof_site_valid(const struct memprof_site *site)
+{
+    if (site == &memprof_overflow)
+    {
+        return true;
+    }
+    return site >= memprof_sites && site < memprof_sites + MEMPROF_N_SITES
+           && ((uintptr_t)site - (uintptr_t)memprof_sites) % sizeof(*site) == 0;
+}
+
+static struct memprof_site *
+memprof_site_find(const char *file, int line)
+{
+    uint32_t h = (uint32_t)((uintptr_t)file >> 4) * 2654435761u + (uint32_t)line;
+
+    for (int probe = 0; probe < MEMPROF_N_SITES; ++probe)
+    {
+        struct memprof_site *site = &memprof_sites[(h + probe) & (MEMPROF_N_SITES - 1)];
+        if (site->file == file && site->line == line)
+        {
+            return site;
+        }
+        if (!site->file)
+        {
+            site->file = file;
+            site->line = line;
+            return site;
+        }
+    }
+    return &memprof_overflow;
+}
+
+struct memprof_site *
+memprof_record_alloc(const char *file, int line, size_t size)
+{
+    struct memprof_site *site = memprof_site_find(file, line);
+
+    ++site->n_alloc;
+    site->alloc_bytes += size;
+    site->live_bytes += size;
+    if (site->live_bytes > site->peak_bytes)
+    {
+        site->peak_bytes = site->live_bytes;
+    }
+    return site;
+}
+
+void
+memprof_record_free(struct memprof_site *site, size_t size)
+{
+    /*
+     * Tolerate buffers that were never allocated through the tracked
+     * paths (e.g. buf_set_read() views); their site pointer is either
+     * NULL or garbage, never a table slot.
+     */
+    if (site && memprof_site_valid(site) && site->live_bytes >= size)
+    {
+        site->live_bytes -= size;
+    }
+}
+
+/*
+ * Dump the callsite table to the management interface in response to
+ * the 'memprof' command, sorted by live bytes so suspected leaks come
+ * first.
+ */
+void
+memprof_output_client(void)
+{
+    const struct memprof_site *order[MEMPROF_N_SITES + 1];
+    int n = 0;
+
+    for (int i = 0; i < MEMPROF_N_SITES; ++i)
+    {
+        if (memprof_sites[i].file)
+        {
+            order[n++] = &memprof_sites[i];
+        }
+    }
+    if (memprof_overflow.n_alloc)
+    {
+        order[n++] = &memprof_overflow;
+    }
+
+    /* insertion sort by live bytes, descending; n is small */
+    for (int i = 1; i < n; ++i)
+    {
+        const struct memprof_site *key = order[i];
+        int j = i - 1;
+        while (j >= 0 && order[j]->live_bytes < key->live_bytes)
+        {
+            order[j + 1] = order[j];
+            --j;
+        }
+        order[j + 1] = key;
+    }
+
+    msg(M_CLIENT, "MEMPROF,file:line,n_alloc,alloc_bytes,live_bytes,peak_bytes");
+    for (int i = 0; i < n; ++i)
+    {
+        const struct memprof_site *s = order[i];
+        msg(M_CLIENT, "MEMPROF,%s:%d,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64,
+            s->file, s->line, s->n_alloc, s->alloc_bytes, s->live_bytes,
+            s->peak_bytes);
+    }
+    msg(M_CLIENT, "END");
+}
+
+#endif /* ifdef ENABLE_MEM_PROFILE */
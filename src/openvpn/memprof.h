@@ -0,0 +1,60 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MEMPROF_H
+#define MEMPROF_H
+
+#ifdef ENABLE_MEM_PROFILE
+
+#include "basic.h"
+
+/*
+ * Lightweight per-callsite allocation accounting, enabled with
+ * --enable-mem-profile.  Rides on the same __FILE__/__LINE__ plumbing
+ * that dmalloc uses in buffer.h: every alloc_buf()/gc_malloc() callsite
+ * gets a slot with cumulative and live byte counters, and frees are
+ * attributed back through a site pointer stored in the allocation
+ * (struct buffer / gc_entry).  The per-allocation cost is one hash
+ * probe and a few counter updates, cheap enough to run at production
+ * packet rates, unlike dmalloc or valgrind.  Dump the table with the
+ * management interface 'memprof' command.
+ */
+
+struct memprof_site
+{
+    const char *file;           /* __FILE__ literal, compared by pointer */
+    int line;
+    uint64_t n_alloc;
+    uint64_t alloc_bytes;       /* cumulative */
+    uint64_t live_bytes;        /* currently allocated */
+    uint64_t peak_bytes;        /* high water mark of live_bytes */
+};
+
+struct memprof_site *memprof_record_alloc(const char *file, int line, size_t size);
+
+void memprof_record_free(struct memprof_site *site, size_t size);
+
+void memprof_output_client(void);
+
+#endif /* ifdef ENABLE_MEM_PROFILE */
+#endif /* ifndef MEMPROF_H */
@@ -0,0 +1,339 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2021 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#include "syshead.h"
+
+#if !defined(_WIN32)
+
+#include "migrate.h"
+#include "multi.h"
+#include "error.h"
+#include "buffer.h"
+#include "fdmisc.h"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include "memdbg.h"
+
+/* per-sibling send/receive timeout for synchronous queries */
+#define MIGRATE_TIMEOUT_MS 200
+
+/* at most this many sibling queries per second; excess packets from
+ * unknown peer-ids are simply dropped */
+#define MIGRATE_MAX_QUERIES_PER_SEC 10
+
+static bool
+migrate_sockaddr(struct sockaddr_un *sun, const char *path)
+{
+    CLEAR(*sun);
+    sun->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(sun->sun_path))
+    {
+        msg(M_WARN, "MIGRATE: socket path too long: %s", path);
+        return false;
+    }
+    strncpynt(sun->sun_path, path, sizeof(sun->sun_path));
+    return true;
+}
+
+static void
+migrate_set_timeout(int sd)
+{
+    struct timeval tv;
+    tv.tv_sec = 0;
+    tv.tv_usec = MIGRATE_TIMEOUT_MS * 1000;
+    setsockopt(sd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(sd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+void
+migrate_channel_init(struct migrate_channel *mc, const char *base_path)
+{
+    CLEAR(*mc);
+    mc->sd = -1;
+
+    if (!base_path)
+    {
+        return;
+    }
+
+    struct buffer path = alloc_buf(PATH_MAX);
+    buf_printf(&path, "%s.%d", base_path, (int)getpid());
+
+    struct sockaddr_un sun;
+    if (!migrate_sockaddr(&sun, BSTR(&path)))
+    {
+        free_buf(&path);
+        return;
+    }
+
+    int sd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (sd < 0)
+    {
+        msg(M_WARN | M_ERRNO, "MIGRATE: cannot create socket");
+        free_buf(&path);
+        return;
+    }
+
+    /* remove a stale socket left by a previous instance with our pid */
+    unlink(sun.sun_path);
+
+    if (bind(sd, (struct sockaddr *)&sun, sizeof(sun)) < 0
+        || chmod(sun.sun_path, S_IRUSR | S_IWUSR) < 0
+        || listen(sd, 8) < 0)
+    {
+        msg(M_WARN | M_ERRNO, "MIGRATE: cannot bind %s", sun.sun_path);
+        close(sd);
+        unlink(sun.sun_path);
+        free_buf(&path);
+        return;
+    }
+
+    set_cloexec(sd);
+    mc->sd = sd;
+    mc->path = string_alloc(BSTR(&path), NULL);
+    mc->base = string_alloc(base_path, NULL);
+    free_buf(&path);
+
+    msg(M_INFO, "MIGRATE: listening for sibling processes on %s", mc->path);
+}
+
+void
+migrate_channel_uninit(struct migrate_channel *mc)
+{
+    if (mc->sd >= 0)
+    {
+        close(mc->sd);
+        mc->sd = -1;
+    }
+    if (mc->path)
+    {
+        unlink(mc->path);
+        free(mc->path);
+        mc->path = NULL;
+    }
+    free(mc->base);
+    mc->base = NULL;
+}
+
+bool
+migrate_channel_query_allowed(struct migrate_channel *mc, time_t now)
+{
+    if (now != mc->query_window)
+    {
+        mc->query_window = now;
+        mc->queries_in_window = 0;
+    }
+    if (mc->queries_in_window >= MIGRATE_MAX_QUERIES_PER_SEC)
+    {
+        return false;
+    }
+    ++mc->queries_in_window;
+    return true;
+}
+
+/*
+ * Run one synchronous query/reply exchange against the sibling socket
+ * at the given path.  Returns true if the sibling owned the peer.
+ */
+static bool
+migrate_query_one(const char *path, const struct migrate_query *query,
+                  struct migrate_client_state *state)
+{
+    struct sockaddr_un sun;
+    bool ret = false;
+
+    if (!migrate_sockaddr(&sun, path))
+    {
+        return false;
+    }
+
+    int sd = socket(AF_UNIX, SOCK_SEQPACKET, 0);
+    if (sd < 0)
+    {
+        return false;
+    }
+    set_cloexec(sd);
+    migrate_set_timeout(sd);
+
+    if (connect(sd, (struct sockaddr *)&sun, sizeof(sun)) < 0)
+    {
+        /* a dead sibling leaves its socket behind; clean it up */
+        if (errno == ECONNREFUSED)
+        {
+            unlink(path);
+        }
+        goto done;
+    }
+
+    if (send(sd, query, sizeof(*query), 0) != sizeof(*query))
+    {
+        goto done;
+    }
+
+    ssize_t len = recv(sd, state, sizeof(*state), 0);
+    if (len == sizeof(*state)
+        && state->magic == MIGRATE_MAGIC
+        && state->version == MIGRATE_VERSION
+        && state->found)
+    {
+        ret = true;
+    }
+
+done:
+    close(sd);
+    return ret;
+}
+
+bool
+migrate_channel_query(struct migrate_channel *mc, uint32_t peer_id,
+                      uint32_t key_id, struct migrate_client_state *state,
+                      char *owner_path, size_t owner_path_len)
+{
+    struct gc_arena gc = gc_new();
+    bool ret = false;
+
+    struct migrate_query query;
+    CLEAR(query);
+    query.magic = MIGRATE_MAGIC;
+    query.version = MIGRATE_VERSION;
+    query.peer_id = peer_id;
+    query.key_id = key_id;
+
+    /* split the base path into directory and socket name prefix */
+    char *dir = string_alloc(mc->base, &gc);
+    char *slash = strrchr(dir, '/');
+    const char *prefix;
+    if (slash)
+    {
+        *slash = '\0';
+        prefix = slash + 1;
+    }
+    else
+    {
+        dir = ".";
+        prefix = mc->base;
+    }
+    const size_t prefix_len = strlen(prefix);
+
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        msg(M_WARN | M_ERRNO, "MIGRATE: cannot scan %s", dir);
+        gc_free(&gc);
+        return false;
+    }
+
+    struct dirent *e;
+    while (!ret && (e = readdir(d)))
+    {
+        if (strncmp(e->d_name, prefix, prefix_len) != 0
+            || e->d_name[prefix_len] != '.')
+        {
+            continue;
+        }
+        struct buffer path = alloc_buf_gc(PATH_MAX, &gc);
+        buf_printf(&path, "%s/%s", dir, e->d_name);
+        if (mc->path && !strcmp(BSTR(&path), mc->path))
+        {
+            continue; /* that's us */
+        }
+        ret = migrate_query_one(BSTR(&path), &query, state);
+        if (ret)
+        {
+            strncpynt(owner_path, BSTR(&path), owner_path_len);
+        }
+    }
+    closedir(d);
+
+    gc_free(&gc);
+    return ret;
+}
+
+bool
+migrate_channel_commit(struct migrate_channel *mc,
+                       const char *owner_path, uint32_t peer_id,
+                       uint32_t key_id)
+{
+    struct migrate_query query;
+    struct migrate_client_state state;
+
+    CLEAR(query);
+    query.magic = MIGRATE_MAGIC;
+    query.version = MIGRATE_VERSION;
+    query.peer_id = peer_id;
+    query.key_id = key_id;
+    query.commit = 1;
+
+    const bool ret = migrate_query_one(owner_path, &query, &state);
+    secure_memzero(&state, sizeof(state));
+    return ret;
+}
+
+void
+migrate_channel_process(struct multi_context *m)
+{
+    struct migrate_channel *mc = &m->migrate;
+    struct migrate_query query;
+    struct migrate_client_state state;
+
+    int sd = accept(mc->sd, NULL, NULL);
+    if (sd < 0)
+    {
+        return;
+    }
+    set_cloexec(sd);
+    migrate_set_timeout(sd);
+
+    CLEAR(state);
+    state.magic = MIGRATE_MAGIC;
+    state.version = MIGRATE_VERSION;
+
+    if (recv(sd, &query, sizeof(query), 0) == sizeof(query)
+        && query.magic == MIGRATE_MAGIC
+        && query.version == MIGRATE_VERSION)
+    {
+        multi_migrate_export(m, query.peer_id, query.key_id,
+                             query.commit != 0, &state);
+    }
+
+    if (send(sd, &state, sizeof(state), 0) != sizeof(state) && state.found)
+    {
+        msg(M_WARN | M_ERRNO,
+            "MIGRATE: failed to hand session over to sibling process");
+    }
+
+    secure_memzero(&state, sizeof(state));
+    close(sd);
+}
+
+#endif /* !defined(_WIN32) */
@@ -0,0 +1,176 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2021 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Cross-process client state migration for --float-migration.
+ *
+ * With --socket-flags REUSEPORT, several server processes share one UDP
+ * port and the kernel steers each flow to one of them.  When a client's
+ * source address changes (NAT rebinding), its flow may be steered to a
+ * different process than the one holding its session.  This module lets
+ * the receiving process fetch the client's data channel state -- key
+ * material and packet-id window -- from the owning sibling over a local
+ * SOCK_SEQPACKET socket, so data traffic continues without waiting for
+ * a reconnect.
+ *
+ * Each process listens on "<base>.<pid>"; a query scans the directory
+ * for sibling sockets with the same base name.  All messages are
+ * fixed-size structs exchanged on the same host, so no marshalling is
+ * done.  Control channel (TLS) state cannot leave the process that owns
+ * its SSL objects; it is re-established by the next renegotiation.
+ */
+
+#ifndef MIGRATE_H
+#define MIGRATE_H
+
+#if !defined(_WIN32)
+
+#include "basic.h"
+#include "crypto.h"
+#include "packet_id.h"
+
+/* limits for the fixed-size wire structs below */
+#define MIGRATE_CIPHER_LEN 64
+#define MIGRATE_CN_LEN 256
+
+#define MIGRATE_MAGIC   0x4f564d47  /* "OVMG" */
+#define MIGRATE_VERSION 3
+
+/**
+ * Request sent to a sibling process: who owns this peer-id?
+ *
+ * A migration is triggered by a raw data packet header, which anyone
+ * can spoof, so the hand-over runs in two phases: a query exports a
+ * copy of the state while the owner keeps serving the client; only
+ * after the requester has authenticated the triggering packet with the
+ * exported keys does it send the same request with @c commit set,
+ * which makes the owner close its instance.  A spoofed header thus
+ * costs a rate-limited query but can never displace a live session.
+ */
+struct migrate_query
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t peer_id;           /**< peer-id as seen in the data packet */
+    uint32_t key_id;            /**< key id from the packet opcode byte */
+    uint32_t commit;            /**< nonzero: requester authenticated the
+                                 *   trigger packet and takes ownership */
+};
+
+/**
+ * Reply carrying one client's migratable data channel state.
+ * Exchanged only between processes of the same server on the same
+ * host, so fields are in host representation.
+ */
+struct migrate_client_state
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t found;             /**< zero if the sibling does not own the peer */
+    uint32_t key_id;
+
+    char ciphername[MIGRATE_CIPHER_LEN]; /**< negotiated data channel cipher */
+    char authname[MIGRATE_CIPHER_LEN];
+    char common_name[MIGRATE_CN_LEN];
+
+    struct key2 key2;           /**< raw data channel key material */
+
+    uint32_t crypto_flags;      /**< negotiated CO_* flags (CO_PACKET_ID_64) */
+
+    uint64_t send_id;           /**< data channel packet-id state */
+    time_t send_time;
+    uint64_t rec_id;
+    time_t rec_time;
+};
+
+/** Per-process migration channel state, embedded in multi_context */
+struct migrate_channel
+{
+    int sd;                     /**< listening socket, -1 if disabled */
+    char *path;                 /**< bound socket path: "<base>.<pid>" */
+    char *base;                 /**< configured base path */
+
+    /* rate limit for sibling queries triggered by unknown peer-ids */
+    time_t query_window;
+    int queries_in_window;
+};
+
+void migrate_channel_init(struct migrate_channel *mc, const char *base_path);
+
+void migrate_channel_uninit(struct migrate_channel *mc);
+
+static inline bool
+migrate_channel_defined(const struct migrate_channel *mc)
+{
+    return mc->sd >= 0;
+}
+
+static inline int
+migrate_channel_fd(const struct migrate_channel *mc)
+{
+    return mc->sd;
+}
+
+/**
+ * Check and charge the query rate limit.  Queries are triggered by
+ * unauthenticated packets, so an attacker must not be able to make us
+ * block on sibling round trips at line rate.
+ */
+bool migrate_channel_query_allowed(struct migrate_channel *mc, time_t now);
+
+/**
+ * Ask every sibling process for the state of the given peer.
+ * Blocks for at most a short per-sibling timeout.  The owning sibling
+ * keeps serving the client until the commit phase.
+ *
+ * @return true if a sibling owned the peer and filled in *state; the
+ *         sibling's socket path is then copied to owner_path so the
+ *         commit can be addressed to the same process.
+ */
+bool migrate_channel_query(struct migrate_channel *mc, uint32_t peer_id,
+                           uint32_t key_id, struct migrate_client_state *state,
+                           char *owner_path, size_t owner_path_len);
+
+/**
+ * Second phase of the hand-over: tell the sibling at owner_path that
+ * the triggering packet authenticated against the exported keys, so it
+ * must close its instance of the peer.
+ *
+ * @return true if the sibling still owned the peer and released it.
+ */
+bool migrate_channel_commit(struct migrate_channel *mc,
+                            const char *owner_path, uint32_t peer_id,
+                            uint32_t key_id);
+
+struct multi_context;
+
+/**
+ * Service one pending request on the listening socket: accept, answer
+ * the query from our own instance table and close.  The local instance
+ * is only closed when the request carries the commit flag; a plain
+ * query exports a copy of the state and leaves the client in place.
+ */
+void migrate_channel_process(struct multi_context *m);
+
+#endif /* !defined(_WIN32) */
+#endif /* ifndef MIGRATE_H */
@@ -95,6 +95,42 @@ save_inetd_socket_descriptor(void)
 #endif
 }
 
+/*
+ * Link socket inherited across an exec, either explicitly via
+ * --inherit-link-fd or through systemd-style socket activation
+ * (LISTEN_FDS).  A restarting server adopts the already bound socket
+ * instead of rebinding, so the port is never lost to a racing process
+ * and in-flight datagrams queued on the socket survive the upgrade.
+ */
+
+int inherited_link_socket_descriptor = SOCKET_UNDEFINED; /* GLOBAL */
+
+void
+save_inherited_link_socket_descriptor(int fd)
+{
+    inherited_link_socket_descriptor = fd;
+}
+
+void
+save_inherited_link_socket_from_env(void)
+{
+#ifndef _WIN32
+    const char *pid = getenv("LISTEN_PID");
+    const char *fds = getenv("LISTEN_FDS");
+
+    if (pid && fds && atoi(pid) == (int)getpid() && atoi(fds) >= 1)
+    {
+        /* SD_LISTEN_FDS_START: passed fds begin right after stderr */
+        inherited_link_socket_descriptor = 3;
+
+        /* single use; don't leak the activation environment to scripts
+         * or to our own re-execs */
+        unsetenv("LISTEN_PID");
+        unsetenv("LISTEN_FDS");
+    }
+#endif
+}
+
 /*
  * Prepend a random string to hostname to prevent DNS caching.
  * For example, foo.bar.gov would be modified to <random-chars>.foo.bar.gov.
@@ -46,6 +46,11 @@ void set_std_files_to_null(bool stdin_only);
 extern int inetd_socket_descriptor;
 void save_inetd_socket_descriptor(void);
 
+/* link socket inherited across exec (--inherit-link-fd / LISTEN_FDS) */
+extern int inherited_link_socket_descriptor;
+void save_inherited_link_socket_descriptor(int fd);
+void save_inherited_link_socket_from_env(void);
+
 /* Make arrays of strings */
 
 const char **make_arg_array(const char *first, const char *parms, struct gc_arena *gc);
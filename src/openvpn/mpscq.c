@@ -0,0 +1,123 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#include "syshead.h"
+
+#ifdef ENABLE_WORKER_THREADS
+
+#include "buffer.h"
+#include "error.h"
+#include "integer.h"
+#include "misc.h"
+#include "mpscq.h"
+
+#include "memdbg.h"
+
+void
+mpscq_init(struct mpscq *q, unsigned int size)
+{
+    unsigned int capacity = adjust_power_of_2(size);
+    uintptr_t i;
+
+    CLEAR(*q);
+    ALLOC_ARRAY_CLEAR(q->cells, struct mpscq_cell, capacity);
+    q->mask = capacity - 1;
+    for (i = 0; i < capacity; ++i)
+    {
+        q->cells[i].seq = i;
+    }
+}
+
+void
+mpscq_uninit(struct mpscq *q)
+{
+    free(q->cells);
+    CLEAR(*q);
+}
+
+bool
+mpscq_push(struct mpscq *q, void *data)
+{
+    uintptr_t pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+
+    while (true)
+    {
+        struct mpscq_cell *cell = &q->cells[pos & q->mask];
+        const uintptr_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+        const intptr_t dif = (intptr_t) seq - (intptr_t) pos;
+
+        if (dif == 0)
+        {
+            /* cell is free, race other producers for it */
+            if (__atomic_compare_exchange_n(&q->tail, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+            {
+                cell->data = data;
+                __atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+            /* pos was reloaded by the failed CAS, retry */
+        }
+        else if (dif < 0)
+        {
+            return false; /* queue full */
+        }
+        else
+        {
+            /* another producer claimed this cell, move on */
+            pos = __atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+void *
+mpscq_pop(struct mpscq *q)
+{
+    struct mpscq_cell *cell = &q->cells[q->head & q->mask];
+    const uintptr_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+    void *data;
+
+    if ((intptr_t) seq - (intptr_t) (q->head + 1) < 0)
+    {
+        return NULL; /* queue empty */
+    }
+
+    data = cell->data;
+    /* mark the cell free for the producer one lap ahead */
+    __atomic_store_n(&cell->seq, q->head + q->mask + 1, __ATOMIC_RELEASE);
+    ++q->head;
+    return data;
+}
+
+#else  /* ifdef ENABLE_WORKER_THREADS */
+static void
+dummy(void)
+{
+}
+#endif /* ENABLE_WORKER_THREADS */
@@ -0,0 +1,83 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MPSCQ_H
+#define MPSCQ_H
+
+#ifdef ENABLE_WORKER_THREADS
+
+/*
+ * Bounded lock-free multi-producer/single-consumer queue.
+ *
+ * Any number of worker threads may push concurrently; exactly one
+ * thread (the event loop) may pop.  Implemented as a ring of cells
+ * carrying per-cell sequence numbers (Vyukov's bounded queue), so the
+ * fast path is one CAS per push and no atomics contention on pop.
+ *
+ * This is the designated output queue type for handing finished
+ * packets from worker threads back to the event thread, e.g. the
+ * worker completion queue today and the per-instance TCP output
+ * queue once TCP mode runs concurrently.
+ */
+
+struct mpscq_cell
+{
+    uintptr_t seq;
+    void *data;
+};
+
+struct mpscq
+{
+    struct mpscq_cell *cells;
+    uintptr_t mask;
+
+    /* written by producers via CAS */
+    uintptr_t tail;
+
+    /* consumer-private */
+    uintptr_t head;
+};
+
+/**
+ * Initialize a queue with capacity for @p size elements
+ * (rounded up to a power of 2).
+ */
+void mpscq_init(struct mpscq *q, unsigned int size);
+
+void mpscq_uninit(struct mpscq *q);
+
+/**
+ * Enqueue @p data.  Safe to call from any thread.
+ *
+ * @return false if the queue is full.
+ */
+bool mpscq_push(struct mpscq *q, void *data);
+
+/**
+ * Dequeue the oldest element, or return NULL if the queue is empty.
+ * Must only be called from the single consumer thread.
+ */
+void *mpscq_pop(struct mpscq *q);
+
+#endif /* ENABLE_WORKER_THREADS */
+#endif /* ifndef MPSCQ_H */
@@ -114,6 +114,7 @@ mroute_get_in_addr_t(struct mroute_addr *ma, const in_addr_t src, unsigned int m
 {
     if (ma)
     {
+        CLEAR(*ma);
         ma->type = MR_ADDR_IPV4 | mask;
         ma->netbits = 0;
         ma->len = 4;
@@ -126,6 +127,7 @@ mroute_get_in6_addr(struct mroute_addr *ma, const struct in6_addr src, unsigned
 {
     if (ma)
     {
+        CLEAR(*ma);
         ma->type = MR_ADDR_IPV6 | mask;
         ma->netbits = 0;
         ma->len = 16;
@@ -251,6 +253,7 @@ mroute_copy_ether_to_addr(struct mroute_addr *maddr,
                           const uint8_t *ether_addr,
                           uint16_t vid)
 {
+    CLEAR(*maddr);
     maddr->type = MR_ADDR_ETHER;
     maddr->netbits = 0;
     maddr->len = OPENVPN_ETH_ALEN;
@@ -337,6 +340,7 @@ mroute_extract_openvpn_sockaddr(struct mroute_addr *addr,
                                 const struct openvpn_sockaddr *osaddr,
                                 bool use_port)
 {
+    CLEAR(*addr);
     switch (osaddr->addr.sa.sa_family)
     {
         case AF_INET:
@@ -613,3 +617,121 @@ mroute_helper_free(struct mroute_helper *mh)
 {
     free(mh);
 }
+
+/*
+ * Longest-prefix-match trie over IPv4 networks.  Addresses and
+ * networks are passed in host byte order; each level of the trie
+ * consumes one address bit, most-significant first.
+ */
+
+struct mroute_lpm *
+mroute_lpm_init(void)
+{
+    struct mroute_lpm *lpm;
+    ALLOC_OBJ_CLEAR(lpm, struct mroute_lpm);
+    return lpm;
+}
+
+static void
+mroute_lpm_free_node(struct mroute_lpm_node *node)
+{
+    if (node)
+    {
+        mroute_lpm_free_node(node->child[0]);
+        mroute_lpm_free_node(node->child[1]);
+        free(node);
+    }
+}
+
+void
+mroute_lpm_free(struct mroute_lpm *lpm)
+{
+    if (lpm)
+    {
+        mroute_lpm_free_node(lpm->root.child[0]);
+        mroute_lpm_free_node(lpm->root.child[1]);
+        free(lpm);
+    }
+}
+
+void
+mroute_lpm_add(struct mroute_lpm *lpm, in_addr_t network, int netbits,
+               void *value)
+{
+    struct mroute_lpm_node *node = &lpm->root;
+    int depth;
+
+    ASSERT(netbits >= 0 && netbits <= 32);
+    for (depth = 0; depth < netbits; ++depth)
+    {
+        const int bit = (network >> (31 - depth)) & 1;
+        if (!node->child[bit])
+        {
+            ALLOC_OBJ_CLEAR(node->child[bit], struct mroute_lpm_node);
+        }
+        node = node->child[bit];
+    }
+    node->value = value;
+}
+
+void
+mroute_lpm_del(struct mroute_lpm *lpm, in_addr_t network, int netbits)
+{
+    struct mroute_lpm_node *path[33];
+    struct mroute_lpm_node *node = &lpm->root;
+    int depth;
+
+    ASSERT(netbits >= 0 && netbits <= 32);
+    for (depth = 0; depth < netbits; ++depth)
+    {
+        const int bit = (network >> (31 - depth)) & 1;
+        path[depth] = node;
+        node = node->child[bit];
+        if (!node)
+        {
+            return; /* prefix not present */
+        }
+    }
+    node->value = NULL;
+
+    /* prune nodes that carry neither a value nor children */
+    while (depth-- > 0)
+    {
+        const int bit = (network >> (31 - depth)) & 1;
+        node = path[depth]->child[bit];
+        if (node->value || node->child[0] || node->child[1])
+        {
+            break;
+        }
+        free(node);
+        path[depth]->child[bit] = NULL;
+    }
+}
+
+/*
+ * Collect the values of all prefixes containing 'addr', ordered
+ * shortest first, so the longest match is the last entry.  Returns
+ * the number of matches stored.
+ */
+int
+mroute_lpm_lookup(const struct mroute_lpm *lpm, in_addr_t addr,
+                  void **matches, int n_matches)
+{
+    const struct mroute_lpm_node *node = &lpm->root;
+    int depth;
+    int n = 0;
+
+    for (depth = 0; node && n < n_matches; ++depth)
+    {
+        if (node->value)
+        {
+            matches[n++] = node->value;
+        }
+        if (depth >= 32)
+        {
+            break;
+        }
+        node = node->child[(addr >> (31 - depth)) & 1];
+    }
+    return n;
+}
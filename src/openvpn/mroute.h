@@ -119,6 +119,8 @@ static_assert(offsetof(struct mroute_addr, v6.port) ==
 static_assert(offsetof(struct mroute_addr, v4mappedv6.addr) ==
               offsetof(struct mroute_addr, v4mappedv6) + 12,
               "Unexpected struct packing of v4mappedv6");
+static_assert(sizeof(struct mroute_addr) == MR_MAX_ADDR_LEN + 4,
+              "Unexpected size of mroute_addr");
 
 /*
  * Number of bits in an address.  Should be raised for IPv6.
@@ -136,6 +138,37 @@ struct mroute_helper {
     int net_len_refcount[MR_HELPER_NET_LEN]; /* refcount of each netlength */
 };
 
+/*
+ * Binary trie for longest-prefix matching of IPv4 networks.
+ *
+ * The mroute_helper above only tracks which CIDR netlengths are in
+ * use, so a miss in the host-route hash costs one hash lookup per
+ * distinct netlength.  The trie answers "which learned networks
+ * contain this address" in a single walk of at most 32 nodes,
+ * independent of the number of routes.  Values are opaque pointers
+ * owned by the caller.
+ */
+struct mroute_lpm_node {
+    struct mroute_lpm_node *child[2];
+    void *value;              /* non-NULL if a prefix terminates here */
+};
+
+struct mroute_lpm {
+    struct mroute_lpm_node root;
+};
+
+struct mroute_lpm *mroute_lpm_init(void);
+
+void mroute_lpm_free(struct mroute_lpm *lpm);
+
+void mroute_lpm_add(struct mroute_lpm *lpm, in_addr_t network, int netbits,
+                    void *value);
+
+void mroute_lpm_del(struct mroute_lpm *lpm, in_addr_t network, int netbits);
+
+int mroute_lpm_lookup(const struct mroute_lpm *lpm, in_addr_t addr,
+                      void **matches, int n_matches);
+
 struct openvpn_sockaddr;
 
 bool mroute_extract_openvpn_sockaddr(struct mroute_addr *addr,
@@ -211,37 +244,30 @@ mroute_extract_addr_from_packet(struct mroute_addr *src,
 static inline bool
 mroute_addr_equal(const struct mroute_addr *a1, const struct mroute_addr *a2)
 {
-    if (a1->type != a2->type)
-    {
-        return false;
-    }
-    if (a1->netbits != a2->netbits)
-    {
-        return false;
-    }
-    if (a1->len != a2->len)
-    {
-        return false;
-    }
-    return memcmp(a1->raw_addr, a2->raw_addr, a1->len) == 0;
+    /* all constructors zero the struct before filling it in, so the
+     * bytes beyond 'len' are always zero and the whole fixed-size POD
+     * can be compared without branching on the address family -- the
+     * compiler reduces this to a few wide vector compares */
+    return memcmp(a1, a2, sizeof(struct mroute_addr)) == 0;
 }
 
 static inline const uint8_t *
 mroute_addr_hash_ptr(const struct mroute_addr *a)
 {
-    /* NOTE: depends on ordering of struct mroute_addr */
-    return (uint8_t *) &a->type;
+    return (uint8_t *) a;
 }
 
 static inline uint32_t
 mroute_addr_hash_len(const struct mroute_addr *a)
 {
-    return (uint32_t) a->len + 2;
+    /* zero tail padding lets the whole POD hash as a fixed-length key */
+    return (uint32_t) sizeof(struct mroute_addr);
 }
 
 static inline void
 mroute_extract_in_addr_t(struct mroute_addr *dest, const in_addr_t src)
 {
+    CLEAR(*dest);
     dest->type = MR_ADDR_IPV4;
     dest->netbits = 0;
     dest->len = 4;
@@ -264,8 +290,7 @@ in_addr_t_from_mroute_addr(const struct mroute_addr *addr)
 static inline void
 mroute_addr_reset(struct mroute_addr *ma)
 {
-    ma->len = 0;
-    ma->type = MR_ADDR_NONE;
+    CLEAR(*ma);
 }
 
 #endif /* MROUTE_H */
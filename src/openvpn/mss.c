@@ -27,6 +27,8 @@
 #include "config-msvc.h"
 #endif
 
+#include <stddef.h>
+
 #include "syshead.h"
 #include "error.h"
 #include "mss.h"
@@ -38,6 +40,23 @@
  * encapsulation.
  */
 
+/*
+ * Incrementally update a one's complement checksum when a single
+ * 16-bit word changes from 'old_word' to 'new_word' (RFC 1624,
+ * equation 3).  One's complement addition is byte-order independent,
+ * so the network-order words can be summed directly.
+ */
+static inline void
+mss_checksum_adjust(uint16_t *check, uint16_t old_word, uint16_t new_word)
+{
+    uint32_t sum = (uint16_t) ~*check;
+    sum += (uint16_t) ~old_word;
+    sum += new_word;
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    *check = (uint16_t) ~sum;
+}
+
 /*
  * IPv4 packet: find TCP header, check flags for "SYN"
  *              if yes, hand to mss_fixup_dowork()
@@ -46,6 +65,7 @@ void
 mss_fixup_ipv4(struct buffer *buf, int maxmss)
 {
     const struct openvpn_iphdr *pip;
+    const uint8_t *p = BPTR(buf);
     int hlen;
 
     if (BLEN(buf) < (int) sizeof(struct openvpn_iphdr))
@@ -53,26 +73,33 @@ mss_fixup_ipv4(struct buffer *buf, int maxmss)
         return;
     }
 
+    hlen = OPENVPN_IPH_GET_LEN(p[0]);
+
+    /*
+     * Fast non-SYN bailout: --mssfix only ever touches TCP SYN
+     * packets, so peek at the protocol and TCP flag bytes before any
+     * further parsing.  The two tests are combined with '&' so the
+     * overwhelmingly common non-SYN case costs a couple of loads and a
+     * single well-predicted branch.
+     */
+    if (BLEN(buf) < hlen + (int) sizeof(struct openvpn_tcphdr)
+        || !((p[offsetof(struct openvpn_iphdr, protocol)] == OPENVPN_IPPROTO_TCP)
+             & ((p[hlen + offsetof(struct openvpn_tcphdr, flags)]
+                 & OPENVPN_TCPH_SYN_MASK) != 0)))
+    {
+        return;
+    }
+
     verify_align_4(buf);
     pip = (struct openvpn_iphdr *) BPTR(buf);
 
-    hlen = OPENVPN_IPH_GET_LEN(pip->version_len);
-
-    if (pip->protocol == OPENVPN_IPPROTO_TCP
-        && ntohs(pip->tot_len) == BLEN(buf)
-        && (ntohs(pip->frag_off) & OPENVPN_IP_OFFMASK) == 0
-        && hlen <= BLEN(buf)
-        && BLEN(buf) - hlen
-        >= (int) sizeof(struct openvpn_tcphdr))
+    if (ntohs(pip->tot_len) == BLEN(buf)
+        && (ntohs(pip->frag_off) & OPENVPN_IP_OFFMASK) == 0)
     {
         struct buffer newbuf = *buf;
         if (buf_advance(&newbuf, hlen))
         {
-            struct openvpn_tcphdr *tc = (struct openvpn_tcphdr *) BPTR(&newbuf);
-            if (tc->flags & OPENVPN_TCPH_SYN_MASK)
-            {
-                mss_fixup_dowork(&newbuf, (uint16_t) maxmss);
-            }
+            mss_fixup_dowork(&newbuf, (uint16_t) maxmss);
         }
     }
 }
@@ -86,25 +113,16 @@ void
 mss_fixup_ipv6(struct buffer *buf, int maxmss)
 {
     const struct openvpn_ipv6hdr *pip6;
+    const uint8_t *p = BPTR(buf);
     struct buffer newbuf;
 
-    if (BLEN(buf) < (int) sizeof(struct openvpn_ipv6hdr))
+    if (BLEN(buf) < (int) (sizeof(struct openvpn_ipv6hdr)
+                           + sizeof(struct openvpn_tcphdr)))
     {
         return;
     }
 
-    verify_align_4(buf);
-    pip6 = (struct openvpn_ipv6hdr *) BPTR(buf);
-
-    /* do we have the full IPv6 packet?
-     * "payload_len" does not include IPv6 header (+40 bytes)
-     */
-    if (BLEN(buf) != (int) ntohs(pip6->payload_len)+40)
-    {
-        return;
-    }
-
-    /* follow header chain until we reach final header, then check for TCP
+    /* check for TCP directly after the IPv6 header
      *
      * An IPv6 packet could, theoretically, have a chain of multiple headers
      * before the final header (TCP, UDP, ...), so we'd need to walk that
@@ -112,25 +130,37 @@ mss_fixup_ipv6(struct buffer *buf, int maxmss)
      *
      * In practice, "most typically used" extension headers (AH, routing,
      * fragment, mobility) are very unlikely to be seen inside an OpenVPN
-     * tun, so for now, we only handle the case of "single next header = TCP"
+     * tun, so for now, we only handle the case of "single next header = TCP".
+     *
+     * This doubles as the fast non-SYN bailout: both bytes sit at fixed
+     * offsets, so the overwhelmingly common non-SYN case costs a couple
+     * of loads and a single well-predicted branch.
      */
-    if (pip6->nexthdr != OPENVPN_IPPROTO_TCP)
+    if (!((p[offsetof(struct openvpn_ipv6hdr, nexthdr)] == OPENVPN_IPPROTO_TCP)
+          & ((p[sizeof(struct openvpn_ipv6hdr)
+                + offsetof(struct openvpn_tcphdr, flags)]
+              & OPENVPN_TCPH_SYN_MASK) != 0)))
     {
         return;
     }
 
-    /* skip IPv6 header (40 bytes),
-     * verify remainder is large enough to contain a full TCP header
+    verify_align_4(buf);
+    pip6 = (struct openvpn_ipv6hdr *) BPTR(buf);
+
+    /* do we have the full IPv6 packet?
+     * "payload_len" does not include IPv6 header (+40 bytes)
      */
+    if (BLEN(buf) != (int) ntohs(pip6->payload_len)+40)
+    {
+        return;
+    }
+
+    /* skip IPv6 header (40 bytes) and hand the TCP header to the
+     * option walker */
     newbuf = *buf;
-    if (buf_advance( &newbuf, 40 )
-        && BLEN(&newbuf) >= (int) sizeof(struct openvpn_tcphdr))
+    if (buf_advance( &newbuf, 40 ))
     {
-        struct openvpn_tcphdr *tc = (struct openvpn_tcphdr *) BPTR(&newbuf);
-        if (tc->flags & OPENVPN_TCPH_SYN_MASK)
-        {
-            mss_fixup_dowork(&newbuf, (uint16_t) maxmss-20);
-        }
+        mss_fixup_dowork(&newbuf, (uint16_t) maxmss-20);
     }
 }
 
@@ -145,7 +175,6 @@ mss_fixup_dowork(struct buffer *buf, uint16_t maxmss)
     int hlen, olen, optlen;
     uint8_t *opt;
     uint16_t mssval;
-    int accumulate;
     struct openvpn_tcphdr *tc;
 
     if (BLEN(buf) < (int) sizeof(struct openvpn_tcphdr))
@@ -194,11 +223,9 @@ mss_fixup_dowork(struct buffer *buf, uint16_t maxmss)
                 if (mssval > maxmss)
                 {
                     dmsg(D_MSS, "MSS: %d -> %d", (int) mssval, (int) maxmss);
-                    accumulate = htons(mssval);
                     opt[2] = (maxmss>>8)&0xff;
                     opt[3] = maxmss&0xff;
-                    accumulate -= htons(maxmss);
-                    ADJUST_CHECKSUM(accumulate, tc->check);
+                    mss_checksum_adjust(&tc->check, htons(mssval), htons(maxmss));
                 }
             }
         }
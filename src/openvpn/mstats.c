@@ -39,13 +39,20 @@
 
 #include "error.h"
 #include "misc.h"
+#include "otime.h"
 #include "mstats.h"
 
 #include "memdbg.h"
 
 volatile struct mmap_stats *mmap_stats = NULL; /* GLOBAL */
+static volatile struct mmap_stats_instance *mmap_slots = NULL; /* GLOBAL */
+static int mmap_slot_hint = 0; /* GLOBAL -- rotating allocation cursor */
 static char mmap_fn[128];
 
+#define MSTATS_SEGMENT_SIZE \
+    (sizeof(struct mmap_stats) \
+     + (size_t)MSTATS_N_SLOTS * sizeof(struct mmap_stats_instance))
+
 void
 mstats_open(const char *fn)
 {
@@ -73,10 +80,12 @@ mstats_open(const char *fn)
         return;
     }
 
-    /* set the file to the correct size to contain a
-     * struct mmap_stats, and zero it */
+    /* write the header, then extend the file to cover the
+     * (zeroed) per-instance slots */
     CLEAR(ms);
     ms.state = MSTATS_ACTIVE;
+    ms.version = MSTATS_VERSION;
+    ms.n_slots = MSTATS_N_SLOTS;
     stat = write(fd, &ms, sizeof(ms));
     if (stat != sizeof(ms))
     {
@@ -84,9 +93,15 @@ mstats_open(const char *fn)
         close(fd);
         return;
     }
+    if (ftruncate(fd, (off_t)MSTATS_SEGMENT_SIZE))
+    {
+        msg(M_ERR, "mstats_open: ftruncate error: %s", fn);
+        close(fd);
+        return;
+    }
 
     /* mmap the file */
-    data = mmap(NULL, sizeof(struct mmap_stats), PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+    data = mmap(NULL, MSTATS_SEGMENT_SIZE, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
     if (data == MAP_FAILED)
     {
         msg(M_ERR, "mstats_open: write error: %s", fn);
@@ -103,8 +118,10 @@ mstats_open(const char *fn)
     /* save filename so we can delete it later */
     strcpy(mmap_fn, fn);
 
-    /* save a global pointer to memory-mapped region */
+    /* save global pointers to memory-mapped region */
     mmap_stats = (struct mmap_stats *)data;
+    mmap_slots = (struct mmap_stats_instance *)
+        ((uint8_t *)data + sizeof(struct mmap_stats));
 
     msg(M_INFO, "memstats data will be written to %s", fn);
 }
@@ -115,12 +132,107 @@ mstats_close(void)
     if (mmap_stats)
     {
         mmap_stats->state = MSTATS_EXPIRED;
-        if (munmap((void *)mmap_stats, sizeof(struct mmap_stats)))
+        if (munmap((void *)mmap_stats, MSTATS_SEGMENT_SIZE))
         {
             msg(M_WARN | M_ERRNO, "mstats_close: munmap error");
         }
         platform_unlink(mmap_fn);
         mmap_stats = NULL;
+        mmap_slots = NULL;
+    }
+}
+
+/*
+ * Seqlock write side.  Collectors copy a slot between two even,
+ * equal reads of seq; bumping seq to odd before the update and
+ * back to even afterwards makes torn reads detectable.
+ */
+static inline void
+mstats_slot_write_begin(volatile struct mmap_stats_instance *s)
+{
+    s->seq++;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void
+mstats_slot_write_end(volatile struct mmap_stats_instance *s)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    s->seq++;
+}
+
+/*
+ * Claim a free per-instance slot, or return -1 if the segment is
+ * not mapped or full.  Only ever called from the main thread.
+ */
+int
+mstats_instance_alloc(void)
+{
+    if (mmap_slots)
+    {
+        for (int i = 0; i < MSTATS_N_SLOTS; ++i)
+        {
+            const int slot = (mmap_slot_hint + i) % MSTATS_N_SLOTS;
+            volatile struct mmap_stats_instance *s = &mmap_slots[slot];
+
+            if (!s->in_use)
+            {
+                mstats_slot_write_begin(s);
+                s->in_use = 1;
+                mstats_slot_write_end(s);
+                mmap_slot_hint = (slot + 1) % MSTATS_N_SLOTS;
+                return slot;
+            }
+        }
+    }
+    return -1;
+}
+
+void
+mstats_instance_free(int slot)
+{
+    if (mmap_slots && slot >= 0 && slot < MSTATS_N_SLOTS)
+    {
+        volatile struct mmap_stats_instance *s = &mmap_slots[slot];
+
+        mstats_slot_write_begin(s);
+        s->in_use = 0;
+        s->cid = 0;
+        s->link_read_bytes = 0;
+        s->link_write_bytes = 0;
+        s->tun_read_bytes = 0;
+        s->tun_write_bytes = 0;
+        s->last_seen = 0;
+        s->common_name[0] = '\0';
+        s->cipher[0] = '\0';
+        mstats_slot_write_end(s);
+    }
+}
+
+void
+mstats_instance_update(int slot, unsigned long cid,
+                       const char *common_name, const char *cipher,
+                       counter_type link_read_bytes,
+                       counter_type link_write_bytes,
+                       counter_type tun_read_bytes,
+                       counter_type tun_write_bytes)
+{
+    if (mmap_slots && slot >= 0 && slot < MSTATS_N_SLOTS)
+    {
+        volatile struct mmap_stats_instance *s = &mmap_slots[slot];
+
+        mstats_slot_write_begin(s);
+        s->cid = cid;
+        s->link_read_bytes = link_read_bytes;
+        s->link_write_bytes = link_write_bytes;
+        s->tun_read_bytes = tun_read_bytes;
+        s->tun_write_bytes = tun_write_bytes;
+        s->last_seen = (uint64_t)now;
+        strncpynt((char *)s->common_name, common_name ? common_name : "",
+                  sizeof(s->common_name));
+        strncpynt((char *)s->cipher, cipher ? cipher : "",
+                  sizeof(s->cipher));
+        mstats_slot_write_end(s);
     }
 }
 
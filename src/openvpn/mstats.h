@@ -30,6 +30,17 @@
 
 #include "basic.h"
 
+/*
+ * Layout of the memory-mapped file: a struct mmap_stats header
+ * followed by MSTATS_N_SLOTS struct mmap_stats_instance records.
+ * External collectors read the per-instance records lock-free via
+ * the seqlock in each slot: read seq, copy the record, re-read seq,
+ * and retry if seq changed or was odd.
+ */
+#define MSTATS_VERSION 2
+
+#define MSTATS_N_SLOTS 4096
+
 /* this struct is mapped to the file */
 struct mmap_stats {
     counter_type link_read_bytes; /* counter_type can be assumed to be a uint64_t */
@@ -40,6 +51,24 @@ struct mmap_stats {
 #define MSTATS_ACTIVE  1
 #define MSTATS_EXPIRED 2
     int state;
+
+    /* extended (version 2) header */
+    int version;
+    int n_slots;   /* number of per-instance records following */
+};
+
+/* one per-client record in the mapped segment */
+struct mmap_stats_instance {
+    uint32_t seq;       /* seqlock: odd while the writer is mid-update */
+    uint32_t in_use;
+    uint64_t cid;       /* management client ID, 0 if unavailable */
+    uint64_t link_read_bytes;
+    uint64_t link_write_bytes;
+    uint64_t tun_read_bytes;
+    uint64_t tun_write_bytes;
+    uint64_t last_seen; /* unix time the instance was last serviced */
+    char common_name[64];
+    char cipher[32];
 };
 
 extern volatile struct mmap_stats *mmap_stats; /* GLOBAL */
@@ -48,4 +77,15 @@ void mstats_open(const char *fn);
 
 void mstats_close(void);
 
+int mstats_instance_alloc(void);
+
+void mstats_instance_free(int slot);
+
+void mstats_instance_update(int slot, unsigned long cid,
+                            const char *common_name, const char *cipher,
+                            counter_type link_read_bytes,
+                            counter_type link_write_bytes,
+                            counter_type tun_read_bytes,
+                            counter_type tun_write_bytes);
+
 #endif /* if !defined(OPENVPN_MEMSTATS_H) && defined(ENABLE_MEMSTATS) */
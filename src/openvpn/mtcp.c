@@ -31,6 +31,15 @@
 
 #include "multi.h"
 #include "forward.h"
+#include "fdmisc.h"
+
+#ifdef ENABLE_MEMSTATS
+#include "mstats.h"
+#endif
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 
 #include "memdbg.h"
 
@@ -69,6 +78,12 @@
 
 #define MTCP_N           ((void *)16) /* upper bound on MTCP_x */
 
+/*
+ * Maximum number of queued clients accepted per listen-socket wakeup.
+ * Capped so that a connect storm cannot starve established tunnels.
+ */
+#define MTCP_ACCEPT_BATCH 32
+
 struct ta_iow_flags
 {
     unsigned int flags;
@@ -120,6 +135,28 @@ pract(int action)
     }
 }
 
+/*
+ * Zero-timeout readability check on the listen socket, used to drain
+ * several queued clients per wakeup.  The listen fd is non-blocking,
+ * so a false positive merely costs a failed accept.
+ */
+static bool
+multi_tcp_listen_socket_pending(const struct link_socket *ls)
+{
+    fd_set reads;
+    struct timeval tv;
+
+    if (!socket_defined(ls->sd))
+    {
+        return false;
+    }
+    FD_ZERO(&reads);
+    openvpn_fd_set(ls->sd, &reads);
+    tv.tv_sec = 0;
+    tv.tv_usec = 0;
+    return select((int)ls->sd + 1, &reads, NULL, NULL, &tv) > 0;
+}
+
 static struct multi_instance *
 multi_create_instance_tcp(struct multi_context *m)
 {
@@ -173,7 +210,8 @@ bool
 multi_tcp_instance_specific_init(struct multi_context *m, struct multi_instance *mi)
 {
     /* buffer for queued TCP socket output packets */
-    mi->tcp_link_out_deferred = mbuf_init(m->top.options.n_bcast_buf);
+    mi->tcp_link_out_deferred = mbuf_init(m->top.options.n_bcast_buf,
+                                          BUF_SIZE(&m->top.c2.frame));
 
     ASSERT(mi->context.c2.link_socket);
     ASSERT(mi->context.c2.link_socket->info.lsa);
@@ -208,6 +246,9 @@ multi_tcp_init(int maxevents, int *maxclients)
     mtcp->maxevents = maxevents + extra_events;
     mtcp->es = event_set_init(&mtcp->maxevents, 0);
     wait_signal(mtcp->es, MTCP_SIG);
+#ifdef ENABLE_ASYNC_PUSH
+    mtcp->inotify_set_fd = UNDEFINED_EVENT;
+#endif
     ALLOC_ARRAY(mtcp->esr, struct event_set_return, mtcp->maxevents);
     *maxclients = max_int(min_int(mtcp->maxevents - extra_events, *maxclients), 1);
     msg(D_MULTI_LOW, "MULTI: TCP INIT maxclients=%d maxevents=%d", *maxclients, mtcp->maxevents);
@@ -292,7 +333,8 @@ multi_tcp_wait(const struct context *c,
 
 #ifdef ENABLE_ASYNC_PUSH
     /* arm inotify watcher */
-    event_ctl(mtcp->es, c->c2.inotify_fd, EVENT_READ, MTCP_FILE_CLOSE_WRITE);
+    event_ctl_read_persist(mtcp->es, c->c2.inotify_fd, MTCP_FILE_CLOSE_WRITE,
+                           &mtcp->inotify_set_fd);
 #endif
 
     status = event_wait(mtcp->es, &c->c2.timeval, mtcp->esr, mtcp->maxevents);
@@ -318,6 +360,136 @@ multi_tcp_context(struct multi_context *m, struct multi_instance *mi)
     }
 }
 
+#ifndef _WIN32
+
+/* max packets gathered into one writev() when flushing deferred output */
+#define MTCP_WRITEV_MAX 16
+
+/*
+ * Drain the deferred output queue of a TCP instance with scatter-gather
+ * I/O: prepend the stream length prefix to each queued ciphertext
+ * packet in place, gather up to MTCP_WRITEV_MAX of them into a single
+ * writev() and release what the kernel consumed.  A partially written
+ * packet stays at the head of the queue, marked MF_FRAMED so its prefix
+ * is not prepended twice, and resumes on the next writable event.
+ */
+static bool
+multi_tcp_process_outgoing_link_writev(struct multi_context *m, struct multi_instance *mi, const unsigned int mpp_flags)
+{
+    struct mbuf_set *ms = mi->tcp_link_out_deferred;
+    struct link_socket *ls = mi->context.c2.link_socket;
+    struct iovec iov[MTCP_WRITEV_MAX];
+    struct mbuf_buffer *bufs[MTCP_WRITEV_MAX];
+    unsigned int n = 0;
+    unsigned int i;
+    ssize_t sent;
+    bool ret = true;
+
+    ASSERT(ls);
+
+    /* frame and gather the queued packets */
+    while (n < MTCP_WRITEV_MAX && n < mbuf_len(ms))
+    {
+        struct mbuf_item *item = mbuf_peek_item(ms, n);
+        struct mbuf_buffer *mb = item->buffer;
+        ASSERT(item->instance == mi);
+        if (!(mb->flags & MF_FRAMED))
+        {
+            packet_size_type len = BLEN(&mb->buf);
+            ASSERT(len <= ls->stream_buf.maxlen);
+            len = htonps(len);
+            ASSERT(buf_write_prepend(&mb->buf, &len, sizeof(len)));
+            mb->flags |= MF_FRAMED;
+        }
+        iov[n].iov_base = BPTR(&mb->buf);
+        iov[n].iov_len = BLEN(&mb->buf);
+        bufs[n] = mb;
+        ++n;
+    }
+    if (!n)
+    {
+        return true;
+    }
+
+    set_prefix(mi);
+    dmsg(D_MULTI_TCP, "MULTI TCP: writev flush of %u deferred packets", n);
+
+    sent = writev(ls->sd, iov, n);
+
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        /* nothing consumed; wait for the next writable event */
+        clear_prefix();
+        return true;
+    }
+
+    check_status((int)sent, "write", ls, NULL);
+
+    if (sent < 0)
+    {
+        /* hard error: drop the batch, matching the per-packet behavior */
+        struct mbuf_item item;
+        for (i = 0; i < n; ++i)
+        {
+            ASSERT(mbuf_extract_item(ms, &item));
+            mbuf_free_buf(ms, item.buffer);
+        }
+        clear_prefix();
+        return true;
+    }
+
+    if (sent > 0)
+    {
+        struct context *c = &mi->context;
+
+        /* aggregated equivalent of the process_outgoing_link() accounting */
+        c->c2.link_write_bytes += sent;
+        link_write_bytes_global += sent;
+#ifdef ENABLE_MEMSTATS
+        if (mmap_stats)
+        {
+            mmap_stats->link_write_bytes = link_write_bytes_global;
+        }
+#endif
+#ifdef ENABLE_MANAGEMENT
+        if (management)
+        {
+            management_bytes_out(management, (int)sent);
+            management_bytes_server(management, &c->c2.link_read_bytes, &c->c2.link_write_bytes, &c->c2.mda_context);
+        }
+#endif
+        if (c->options.ping_send_timeout)
+        {
+            event_timeout_reset(&c->c2.ping_send_interval);
+        }
+    }
+
+    /* release fully written packets, keep a partial tail queued */
+    for (i = 0; i < n && sent > 0; ++i)
+    {
+        const ssize_t blen = (ssize_t)iov[i].iov_len;
+        if (sent >= blen)
+        {
+            struct mbuf_item item;
+            ASSERT(mbuf_extract_item(ms, &item));
+            ASSERT(item.buffer == bufs[i]);
+            mbuf_free_buf(ms, item.buffer);
+            sent -= blen;
+        }
+        else
+        {
+            ASSERT(buf_advance(&bufs[i]->buf, (int)sent));
+            sent = 0;
+        }
+    }
+
+    ret = multi_process_post(m, mi, mpp_flags);
+    clear_prefix();
+    return ret;
+}
+
+#endif /* ifndef _WIN32 */
+
 static bool
 multi_tcp_process_outgoing_link_ready(struct multi_context *m, struct multi_instance *mi, const unsigned int mpp_flags)
 {
@@ -325,6 +497,19 @@ multi_tcp_process_outgoing_link_ready(struct multi_context *m, struct multi_inst
     bool ret = true;
     ASSERT(mi);
 
+#ifndef _WIN32
+    /*
+     * Scatter-gather flush of the deferred queue; not used with the
+     * traffic shaper, which paces one packet per event.
+     */
+#ifdef ENABLE_FEATURE_SHAPER
+    if (!mi->context.options.shaper)
+#endif
+    {
+        return multi_tcp_process_outgoing_link_writev(m, mi, mpp_flags);
+    }
+#endif /* ifndef _WIN32 */
+
     /* extract from queue */
     if (mbuf_extract_item(mi->tcp_link_out_deferred, &item)) /* ciphertext IP packet */
     {
@@ -337,7 +522,7 @@ multi_tcp_process_outgoing_link_ready(struct multi_context *m, struct multi_inst
         {
             mi = NULL;
         }
-        mbuf_free_buf(item.buffer);
+        mbuf_free_buf(mi->tcp_link_out_deferred, item.buffer);
     }
     return ret;
 }
@@ -356,15 +541,22 @@ multi_tcp_process_outgoing_link(struct multi_context *m, bool defer, const unsig
             struct buffer *buf = &mi->context.c2.to_link;
             if (BLEN(buf) > 0)
             {
-                struct mbuf_buffer *mb = mbuf_alloc_buf(buf);
+                struct mbuf_buffer *mb = mbuf_alloc_buf(mi->tcp_link_out_deferred, buf);
                 struct mbuf_item item;
 
+                /* tag by inner-packet class so congestion eviction can
+                 * prefer dropping bulk traffic */
+                if (!OPENVPN_DSCP_INTERACTIVE(mi->context.c2.link_dscp))
+                {
+                    mb->flags |= MF_BULK;
+                }
+
                 set_prefix(mi);
                 dmsg(D_MULTI_TCP, "MULTI TCP: queuing deferred packet");
                 item.buffer = mb;
                 item.instance = mi;
                 mbuf_add_item(mi->tcp_link_out_deferred, &item);
-                mbuf_free_buf(mb);
+                mbuf_free_buf(mi->tcp_link_out_deferred, mb);
                 buf_reset(buf);
                 ret = multi_process_post(m, mi, mpp_flags);
                 if (!ret)
@@ -475,6 +667,16 @@ multi_tcp_dispatch(struct multi_context *m, struct multi_instance *mi, const int
             {
                 multi_process_incoming_tun(m, mpp_flags);
             }
+#if defined(TARGET_LINUX)
+            /* --tun-offload: route the remaining segments of a GSO
+             * super-packet; stop if an instance stalled with the
+             * current packet still pending */
+            while (!IS_SIG(&m->top) && !m->pending && tun_gso_pending(&m->top))
+            {
+                tun_gso_emit(&m->top);
+                multi_process_incoming_tun(m, mpp_flags);
+            }
+#endif
             break;
 
         case TA_SOCKET_READ:
@@ -482,6 +684,7 @@ multi_tcp_dispatch(struct multi_context *m, struct multi_instance *mi, const int
             ASSERT(mi);
             ASSERT(mi->context.c2.link_socket);
             set_prefix(mi);
+            multi_instance_lease_buffers(m, mi);
             read_incoming_link(&mi->context);
             clear_prefix();
             if (!IS_SIG(&mi->context))
@@ -733,14 +936,19 @@ multi_tcp_process_io(struct multi_context *m)
             /* new incoming TCP client attempting to connect? */
             else if (e->arg == MTCP_SOCKET)
             {
-                struct multi_instance *mi;
+                int n_accepted = 0;
                 ASSERT(m->top.c2.link_socket);
                 socket_reset_listen_persistent(m->top.c2.link_socket);
-                mi = multi_create_instance_tcp(m);
-                if (mi)
+                do
                 {
-                    multi_tcp_action(m, mi, TA_INITIAL, false);
-                }
+                    struct multi_instance *mi = multi_create_instance_tcp(m);
+                    if (mi)
+                    {
+                        multi_tcp_action(m, mi, TA_INITIAL, false);
+                    }
+                } while (!IS_SIG(&m->top)
+                         && ++n_accepted < MTCP_ACCEPT_BATCH
+                         && multi_tcp_listen_socket_pending(m->top.c2.link_socket));
             }
             /* signal received? */
             else if (e->arg == MTCP_SIG)
@@ -838,6 +1046,9 @@ tunnel_server_tcp(struct context *top)
             multi_tcp_action(&multi, NULL, TA_TIMEOUT, false);
         }
 
+        /* end of iteration: no stage holds instance pointers any more */
+        multi_reclaim_quiesce();
+
         perf_pop();
     }
 
@@ -43,6 +43,10 @@ struct multi_tcp
 #ifdef ENABLE_MANAGEMENT
     unsigned int management_persist_flags;
 #endif
+#ifdef ENABLE_ASYNC_PUSH
+    event_t inotify_set_fd;     /* inotify descriptor armed so far, to
+                                 * skip re-registration per wait */
+#endif
 };
 
 struct multi_instance;
@@ -78,6 +78,8 @@ frame_finalize(struct frame *frame,
     }
 
     frame->link_mtu_dynamic = frame->link_mtu;
+
+    frame_layout_update(frame);
 }
 
 /*
@@ -124,6 +126,7 @@ frame_subtract_extra(struct frame *frame, const struct frame *src)
 {
     frame->extra_frame -= src->extra_frame;
     frame->extra_tun   += src->extra_frame;
+    frame_layout_update(frame);
 }
 
 void
@@ -234,8 +237,26 @@ struct probehdr
     struct timeval tv;
 };
 
+/* maximum number of error-queue messages drained per call, so that a
+ * sustained storm cannot keep us in this loop indefinitely */
+#define ESE_DRAIN_MAX 256
+
+static void
+format_ese_count(struct buffer *out, const char *name, int n)
+{
+    if (n == 1)
+    {
+        buf_printf(out, "%s|", name);
+    }
+    else if (n > 1)
+    {
+        buf_printf(out, "%s x%d|", name, n);
+    }
+}
+
 const char *
-format_extended_socket_error(int fd, int *mtu, struct gc_arena *gc)
+format_extended_socket_error(int fd, int *mtu, int *n_unreachable,
+                             struct gc_arena *gc)
 {
     int res;
     struct probehdr rcvbuf;
@@ -246,10 +267,20 @@ format_extended_socket_error(int fd, int *mtu, struct gc_arena *gc)
     struct sockaddr_in addr;
     struct buffer out = alloc_buf_gc(256, gc);
     char *cbuf = (char *) gc_malloc(256, false, gc);
+    int limit = ESE_DRAIN_MAX;
+
+    /* per-class message counts; the queue is drained in one batch and a
+     * single consolidated line is formatted afterwards, so that bursts
+     * (e.g. port-unreachable storms from a dead peer) cost one counter
+     * increment per message instead of one formatted log fragment */
+    int n_timeout = 0, n_msgsize = 0, n_refused = 0, n_proto = 0;
+    int n_hostunreach = 0, n_netunreach = 0, n_eacces = 0;
+    int n_unknown = 0, n_noinfo = 0;
 
     *mtu = 0;
+    *n_unreachable = 0;
 
-    while (true)
+    while (limit-- > 0)
     {
         memset(&rcvbuf, -1, sizeof(rcvbuf));
         iov.iov_base = &rcvbuf;
@@ -265,7 +296,7 @@ format_extended_socket_error(int fd, int *mtu, struct gc_arena *gc)
         res = recvmsg(fd, &msg, MSG_ERRQUEUE);
         if (res < 0)
         {
-            goto exit;
+            break;
         }
 
         e = NULL;
@@ -286,48 +317,71 @@ format_extended_socket_error(int fd, int *mtu, struct gc_arena *gc)
         }
         if (e == NULL)
         {
-            buf_printf(&out, "NO-INFO|");
-            goto exit;
+            ++n_noinfo;
+            continue;
         }
 
         switch (e->ee_errno)
         {
             case ETIMEDOUT:
-                buf_printf(&out, "ETIMEDOUT|");
+                ++n_timeout;
                 break;
 
             case EMSGSIZE:
-                buf_printf(&out, "EMSGSIZE Path-MTU=%d|", e->ee_info);
-                *mtu = e->ee_info;
+                ++n_msgsize;
+                /* consolidate a burst of PMTU hints into the smallest
+                 * reported value, which is the one the path imposes */
+                if (*mtu == 0 || (int) e->ee_info < *mtu)
+                {
+                    *mtu = e->ee_info;
+                }
                 break;
 
             case ECONNREFUSED:
-                buf_printf(&out, "ECONNREFUSED|");
+                ++n_refused;
                 break;
 
             case EPROTO:
-                buf_printf(&out, "EPROTO|");
+                ++n_proto;
                 break;
 
             case EHOSTUNREACH:
-                buf_printf(&out, "EHOSTUNREACH|");
+                ++n_hostunreach;
                 break;
 
             case ENETUNREACH:
-                buf_printf(&out, "ENETUNREACH|");
+                ++n_netunreach;
                 break;
 
             case EACCES:
-                buf_printf(&out, "EACCES|");
+                ++n_eacces;
                 break;
 
             default:
-                buf_printf(&out, "UNKNOWN|");
+                ++n_unknown;
                 break;
         }
     }
 
-exit:
+    *n_unreachable = n_refused + n_hostunreach + n_netunreach;
+
+    format_ese_count(&out, "ETIMEDOUT", n_timeout);
+    if (n_msgsize == 1)
+    {
+        buf_printf(&out, "EMSGSIZE Path-MTU=%d|", *mtu);
+    }
+    else if (n_msgsize > 1)
+    {
+        buf_printf(&out, "EMSGSIZE x%d Path-MTU=%d|", n_msgsize, *mtu);
+    }
+    format_ese_count(&out, "ECONNREFUSED", n_refused);
+    format_ese_count(&out, "EPROTO", n_proto);
+    format_ese_count(&out, "EHOSTUNREACH", n_hostunreach);
+    format_ese_count(&out, "ENETUNREACH", n_netunreach);
+    format_ese_count(&out, "EACCES", n_eacces);
+    format_ese_count(&out, "UNKNOWN", n_unknown);
+    format_ese_count(&out, "NO-INFO", n_noinfo);
+
     buf_rmtail(&out, '|');
     return BSTR(&out);
 }
@@ -79,12 +79,44 @@
  */
 #define MSSFIX_DEFAULT     1450
 
+/*
+ * --mtu-tuner cadence and reaction threshold.  The tuner only ever
+ * shrinks the dynamic frame size, so a modest interval and a trigger
+ * well above incidental fragmentation keep it from reacting to noise.
+ */
+#define MTU_TUNER_INTERVAL_SECONDS 10
+#define MTU_TUNER_FRAG_TRIGGER     100
+
 /*
  * Alignment of payload data such as IP packet or
  * ethernet frame.
  */
 #define PAYLOAD_ALIGN 4
 
+/*
+ * Alignment wanted by the data channel decrypt path.  AES-NI and
+ * similar SIMD implementations load the ciphertext in 16-byte chunks,
+ * so incoming link buffers are laid out such that the payload
+ * following the opcode/peer-id header starts on a 16-byte boundary.
+ */
+#define CRYPTO_PAYLOAD_ALIGN 16
+
+/*
+ * Size of the P_DATA_V2 data channel header preceding the ciphertext:
+ * 1-byte opcode/key-id plus 3-byte peer-id.
+ */
+#define DATA_V2_HEADER_SIZE 4
+
+/* The alignment machinery in frame_headroom() assumes these invariants. */
+static_assert((PAYLOAD_ALIGN & (PAYLOAD_ALIGN - 1)) == 0,
+              "PAYLOAD_ALIGN must be a power of two");
+static_assert((CRYPTO_PAYLOAD_ALIGN & (CRYPTO_PAYLOAD_ALIGN - 1)) == 0,
+              "CRYPTO_PAYLOAD_ALIGN must be a power of two");
+static_assert(CRYPTO_PAYLOAD_ALIGN % PAYLOAD_ALIGN == 0,
+              "CRYPTO_PAYLOAD_ALIGN must preserve PAYLOAD_ALIGN");
+static_assert(DATA_V2_HEADER_SIZE < CRYPTO_PAYLOAD_ALIGN,
+              "data channel header must fit within one aligned chunk");
+
 
 /**************************************************************************/
 /**
@@ -132,6 +164,23 @@ struct frame {
 #define FRAME_HEADROOM_MARKER_READ_STREAM (1<<3)
     unsigned int align_flags;
     int align_adjust;
+
+    /**
+     * Precomputed layout.  Plain-field copies of the derived sizes
+     * computed by the macros and frame_headroom() below, refreshed by
+     * frame_layout_update() whenever a frame member changes (all
+     * mutations go through the frame_add_to_*() helpers or through
+     * mtu.c).  Per-packet code reads these fields directly instead of
+     * re-evaluating the macro chains on every packet.
+     */
+    struct {
+        int headroom;           /**< FRAME_HEADROOM(f) */
+        int headroom_read_link; /**< frame_headroom() for incoming link
+                                 *   buffers (ciphertext alignment) */
+        int headroom_fragment;  /**< frame_headroom() for fragment
+                                 *   reassembly buffers */
+        int payload_size;       /**< PAYLOAD_SIZE(f) / MAX_RW_SIZE_TUN(f) */
+    } layout;
 };
 
 /* Forward declarations, to prevent includes */
@@ -243,7 +292,8 @@ void frame_init_mssfix(struct frame *frame, const struct options *options);
 
 void set_sock_extended_error_passing(int sd);
 
-const char *format_extended_socket_error(int fd, int *mtu, struct gc_arena *gc);
+const char *format_extended_socket_error(int fd, int *mtu, int *n_unreachable,
+                                         struct gc_arena *gc);
 
 #endif
 
@@ -256,10 +306,43 @@ frame_headroom(const struct frame *f, const unsigned int flag_mask)
 {
     const int offset = FRAME_HEADROOM_BASE(f);
     const int adjust = (flag_mask & f->align_flags) ? f->align_adjust : 0;
-    const int delta = ((PAYLOAD_ALIGN << 24) - (offset + adjust)) & (PAYLOAD_ALIGN - 1);
+    int align = PAYLOAD_ALIGN;
+    int skew = 0;
+
+    /*
+     * For incoming link buffers with no plaintext alignment adjustment
+     * registered (i.e. a cipher is in use), place the buffer such that
+     * the ciphertext following the P_DATA_V2 opcode/peer-id header
+     * lands on a CRYPTO_PAYLOAD_ALIGN boundary for SIMD AEAD loads.
+     */
+    if ((flag_mask & FRAME_HEADROOM_MARKER_READ_LINK)
+        && !(f->align_flags & FRAME_HEADROOM_MARKER_READ_LINK))
+    {
+        align = CRYPTO_PAYLOAD_ALIGN;
+        skew = DATA_V2_HEADER_SIZE;
+    }
+
+    const int delta = ((align << 24) - (offset + adjust + skew)) & (align - 1);
     return offset + delta;
 }
 
+/*
+ * Refresh the precomputed layout fields from the authoritative frame
+ * members.  Cheap enough to run on every mutation, which keeps the
+ * layout valid at all times -- per-packet readers never need to check
+ * whether sizing has been finalized yet.
+ */
+static inline void
+frame_layout_update(struct frame *frame)
+{
+    frame->layout.headroom = frame_headroom(frame, 0);
+    frame->layout.headroom_read_link =
+        frame_headroom(frame, FRAME_HEADROOM_MARKER_READ_LINK);
+    frame->layout.headroom_fragment =
+        frame_headroom(frame, FRAME_HEADROOM_MARKER_FRAGMENT);
+    frame->layout.payload_size = PAYLOAD_SIZE(frame);
+}
+
 /*
  * frame member adjustment functions
  */
@@ -268,54 +351,63 @@ static inline void
 frame_add_to_link_mtu(struct frame *frame, const int increment)
 {
     frame->link_mtu += increment;
+    frame_layout_update(frame);
 }
 
 static inline void
 frame_add_to_extra_frame(struct frame *frame, const unsigned int increment)
 {
     frame->extra_frame += increment;
+    frame_layout_update(frame);
 }
 
 static inline void
 frame_remove_from_extra_frame(struct frame *frame, const unsigned int decrement)
 {
     frame->extra_frame -= decrement;
+    frame_layout_update(frame);
 }
 
 static inline void
 frame_add_to_extra_tun(struct frame *frame, const int increment)
 {
     frame->extra_tun += increment;
+    frame_layout_update(frame);
 }
 
 static inline void
 frame_add_to_extra_link(struct frame *frame, const int increment)
 {
     frame->extra_link += increment;
+    frame_layout_update(frame);
 }
 
 static inline void
 frame_add_to_extra_buffer(struct frame *frame, const int increment)
 {
     frame->extra_buffer += increment;
+    frame_layout_update(frame);
 }
 
 static inline void
 frame_add_to_align_adjust(struct frame *frame, const int increment)
 {
     frame->align_adjust += increment;
+    frame_layout_update(frame);
 }
 
 static inline void
 frame_align_to_extra_frame(struct frame *frame)
 {
     frame->align_adjust = frame->extra_frame + frame->extra_link;
+    frame_layout_update(frame);
 }
 
 static inline void
 frame_or_align_flags(struct frame *frame, const unsigned int flag_mask)
 {
     frame->align_flags |= flag_mask;
+    frame_layout_update(frame);
 }
 
 static inline bool
@@ -30,8 +30,10 @@
 #include "syshead.h"
 
 #include "multi.h"
+#include "multi_worker.h"
 #include <inttypes.h>
 #include "forward.h"
+#include "gremlin.h"
 
 #include "memdbg.h"
 
@@ -84,26 +86,60 @@ multi_get_create_instance_udp(struct multi_context *m, bool *floated)
                         mroute_addr_print(&real, &gc));
                 }
             }
+#ifndef _WIN32
+            else if (!peer_id_disabled && migrate_channel_defined(&m->migrate))
+            {
+                /* a client that floated over from a sibling REUSEPORT
+                 * process; try to pull its session state across */
+                mi = multi_migrate_get(m, &real, peer_id,
+                                       ptr[0] & P_KEY_ID_MASK);
+            }
+#endif
         }
         if (!v2 || peer_id_disabled)
         {
-            he = hash_lookup_fast(hash, bucket, &real, hv);
-            if (he)
+            mi = multi_flow_cache_lookup(m, &real);
+            if (!mi)
             {
-                mi = (struct multi_instance *) he->value;
+                he = hash_lookup_fast(hash, bucket, &real, hv);
+                if (he)
+                {
+                    mi = (struct multi_instance *) he->value;
+                    multi_flow_cache_insert(m, &real, mi);
+                }
             }
         }
         if (!mi)
         {
-            if (!m->top.c2.tls_auth_standalone
-                || tls_pre_decrypt_lite(m->top.c2.tls_auth_standalone, &m->top.c2.from, &m->top.c2.buf))
+            if (srclimit_defined(&m->srclimit)
+                && !srclimit_allow(&m->srclimit, &m->top.c2.from.dest, now))
             {
-                if (frequency_limit_event_allowed(m->new_connection_limiter))
+                /*
+                 * Unknown source over its per-source rate: drop before
+                 * the HMAC cookie check, with no allocation and no
+                 * logging -- any per-packet cost here is an
+                 * amplification lever for a spoofed flood.
+                 */
+            }
+            else if (!m->top.c2.tls_auth_standalone
+                     || tls_pre_decrypt_lite(m->top.c2.tls_auth_standalone, &m->top.c2.from, &m->top.c2.buf))
+            {
+                if (m->top.options.connect_budget > 0
+                    && m->admission_budget <= 0)
+                {
+                    /* the client's reliable layer will retransmit the
+                     * initiation; admit it in a later iteration */
+                    msg(D_MULTI_DEBUG,
+                        "MULTI: Connection from %s deferred: per-iteration admission budget exhausted as controlled by --connect-budget",
+                        mroute_addr_print(&real, &gc));
+                }
+                else if (frequency_limit_event_allowed(m->new_connection_limiter))
                 {
+                    --m->admission_budget;
                     mi = multi_create_instance(m, &real);
                     if (mi)
                     {
-                        int i;
+                        int i = -1;
 
                         hash_add_fast(hash, bucket, &mi->real, hv, mi);
                         mi->did_real_hash = true;
@@ -111,19 +147,37 @@ multi_get_create_instance_udp(struct multi_context *m, bool *floated)
                         /* max_clients must be less then max peer-id value */
                         ASSERT(m->max_clients < MAX_PEER_ID);
 
-                        for (i = 0; i < m->max_clients; ++i)
+                        /*
+                         * Pop the most recently released peer-id so a quick
+                         * reconnect reuses its old id.  Ids taken out of
+                         * order (migrate/persist import) may still sit on
+                         * the stack as stale entries -- skip those.
+                         */
+                        while (m->n_peer_id_free > 0)
                         {
-                            if (!m->instances[i])
+                            const int id = m->peer_id_free[--m->n_peer_id_free];
+                            if (!m->instances[id])
                             {
-                                mi->context.c2.tls_multi->peer_id = i;
-                                m->instances[i] = mi;
+                                i = id;
                                 break;
                             }
                         }
+                        if (i < 0)
+                        {
+                            for (i = 0; i < m->max_clients; ++i)
+                            {
+                                if (!m->instances[i])
+                                {
+                                    break;
+                                }
+                            }
+                        }
 
                         /* should not really end up here, since multi_create_instance returns null
                          * if amount of clients exceeds max_clients */
                         ASSERT(i < m->max_clients);
+                        mi->context.c2.tls_multi->peer_id = i;
+                        m->instances[i] = mi;
                     }
                 }
                 else
@@ -239,6 +293,16 @@ multi_process_io_udp(struct multi_context *m)
         {
             multi_process_incoming_tun(m, mpp_flags);
         }
+#if defined(TARGET_LINUX)
+        /* --tun-offload: route the remaining segments of a GSO
+         * super-packet; stop if an instance stalled with the current
+         * packet still pending, the next TUN_READ resumes */
+        while (!IS_SIG(&m->top) && !m->pending && tun_gso_pending(&m->top))
+        {
+            tun_gso_emit(&m->top);
+            multi_process_incoming_tun(m, mpp_flags);
+        }
+#endif
     }
 #ifdef ENABLE_ASYNC_PUSH
     /* INOTIFY callback */
@@ -247,7 +311,94 @@ multi_process_io_udp(struct multi_context *m)
         multi_process_file_closed(m, mpp_flags);
     }
 #endif
+#ifdef ENABLE_WORKER_THREADS
+    /* packets decrypted by the worker pool are ready for routing */
+    else if (status & WORKER_COMPLETED)
+    {
+        multi_process_worker_completions(m, mpp_flags);
+    }
+#endif
+#ifndef _WIN32
+    /* sibling process asking for a floated client's session state */
+    else if (status & MIGRATE_READ)
+    {
+        migrate_channel_process(m);
+    }
+#endif
+}
+
+#ifdef ENABLE_DEBUG
+/*
+ * --gremlin-replay: feed a captured link trace through the incoming
+ * packet path as fast as possible, with now/now_usec driven by the
+ * recorded timestamps instead of the system clock, then terminate.
+ * See gremlin.c for the capture side and the trace format.
+ */
+static void
+tunnel_server_udp_replay(struct multi_context *m)
+{
+    struct context *c = &m->top;
+    const unsigned int mpp_flags = MPP_PRE_SELECT | MPP_CLOSE_ON_SIGNAL;
+    struct timeval ts;
+    struct timeval start, end;
+    uint64_t n = 0;
+
+    if (!gremlin_trace_replay_open(c->options.gremlin_replay))
+    {
+        register_signal(c, SIGTERM, "gremlin-replay-open-failed");
+        return;
+    }
+
+    msg(M_INFO, "GREMLIN REPLAY: replaying %s", c->options.gremlin_replay);
+    gettimeofday(&start, NULL);
+    time_virtual = true;
+
+    while (!IS_SIG(c))
+    {
+        c->c2.buf = c->c2.buffers->read_link_buf;
+        ASSERT(buf_init(&c->c2.buf, c->c2.frame.layout.headroom_read_link));
+        if (!gremlin_trace_replay_next(&c->c2.buf, &c->c2.from, &ts))
+        {
+            break;
+        }
+
+        /* drive the virtual clock from the recorded timestamp */
+        now = ts.tv_sec;
+#if TIME_BACKTRACK_PROTECTION
+        now_usec = ts.tv_usec;
+#endif
+
+        multi_process_incoming_link(m, NULL, mpp_flags);
+        ++n;
+
+        /* drain work the event loop would have flushed on writability */
+        if (m->pending)
+        {
+            multi_process_outgoing_tun(m, mpp_flags);
+        }
+        while (mbuf_defined(m->mbuf))
+        {
+            multi_process_outgoing_link(m, mpp_flags);
+        }
+    }
+
+    time_virtual = false;
+    gremlin_trace_replay_close();
+    gettimeofday(&end, NULL);
+
+    {
+        const double elapsed = (end.tv_sec - start.tv_sec)
+                               + (end.tv_usec - start.tv_usec) / 1e6;
+        msg(M_INFO, "GREMLIN REPLAY: %" PRIu64 " packets in %.3f s (%.0f pkt/s)",
+            n, elapsed, elapsed > 0 ? n / elapsed : 0.0);
+    }
+
+    if (!IS_SIG(c))
+    {
+        register_signal(c, SIGTERM, "gremlin-replay-end");
+    }
 }
+#endif /* ifdef ENABLE_DEBUG */
 
 /*
  * Return the io_wait() flags appropriate for
@@ -274,7 +425,9 @@ p2mp_iow_flags(const struct multi_context *m)
     }
     else
     {
-        flags |= IOW_READ;
+        /* IOW_CHECK_RESIDUAL picks up datagrams still buffered by
+         * batched I/O (--udp-mmsg) without a trip through event_wait */
+        flags |= IOW_READ|IOW_CHECK_RESIDUAL;
     }
 #ifdef _WIN32
     if (tuntap_ring_empty(m->top.c1.tuntap))
@@ -321,6 +474,28 @@ tunnel_server_udp_single_threaded(struct context *top)
     /* initialize management interface */
     init_management_callback_multi(&multi);
 
+#ifndef _WIN32
+    /* listen for --float-migration queries from sibling processes */
+    if (migrate_channel_defined(&multi.migrate))
+    {
+        multi.top.c2.migrate_fd = migrate_channel_fd(&multi.migrate);
+    }
+
+    /* rebuild client instances saved by the previous process lifetime */
+    multi_persist_state_restore(&multi);
+#endif
+
+#ifdef ENABLE_WORKER_THREADS
+    /* initialize data channel worker thread pool */
+    if (top->options.n_worker_threads > 0)
+    {
+        multi.worker_pool = multi_worker_pool_init(&multi,
+                                                   top->options.n_worker_threads);
+        multi.top.c2.worker_completion_fd =
+            multi_worker_completion_fd(multi.worker_pool);
+    }
+#endif
+
     /* finished with initialization */
     initialization_sequence_completed(top, ISC_SERVER); /* --mode server --proto udp */
 
@@ -332,11 +507,22 @@ tunnel_server_udp_single_threaded(struct context *top)
     }
 #endif
 
+#ifdef ENABLE_DEBUG
+    if (top->options.gremlin_replay)
+    {
+        /* benchmark mode: process a recorded trace instead of the socket */
+        tunnel_server_udp_replay(&multi);
+    }
+    else
+#endif
     /* per-packet event loop */
     while (true)
     {
         perf_push(PERF_EVENT_LOOP);
 
+        /* refill the new-client admission budget for this iteration */
+        multi.admission_budget = top->options.connect_budget;
+
         /* set up and do the io_wait() */
         multi_get_timeout(&multi, &multi.top.c2.timeval);
         io_wait(&multi.top, p2mp_iow_flags(&multi));
@@ -357,6 +543,9 @@ tunnel_server_udp_single_threaded(struct context *top)
             MULTI_CHECK_SIG(&multi);
         }
 
+        /* end of iteration: no stage holds instance pointers any more */
+        multi_reclaim_quiesce();
+
         perf_pop();
     }
 
@@ -364,12 +553,22 @@ tunnel_server_udp_single_threaded(struct context *top)
     close(top->c2.inotify_fd);
 #endif
 
+#ifdef ENABLE_WORKER_THREADS
+    multi_worker_pool_free(multi.worker_pool);
+    multi.worker_pool = NULL;
+#endif
+
     /* shut down management interface */
     uninit_management_callback();
 
     /* save ifconfig-pool */
     multi_ifconfig_pool_persist(&multi, true);
 
+#ifndef _WIN32
+    /* save established client key state for the next process lifetime */
+    multi_persist_state_save(&multi);
+#endif
+
     /* tear down tunnel instance (unless --persist-tun) */
     multi_uninit(&multi);
     multi_top_free(&multi);
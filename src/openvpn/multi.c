@@ -36,6 +36,7 @@
 
 #include "forward.h"
 #include "multi.h"
+#include "multi_worker.h"
 #include "push.h"
 #include "run_command.h"
 #include "otime.h"
@@ -44,6 +45,10 @@
 #include "mstats.h"
 #include "ssl_verify.h"
 #include "ssl_ncp.h"
+#include "intern.h"
+#include "fdmisc.h"
+#include "tls_crypt.h"
+#include "trace.h"
 #include "vlan.h"
 #include <inttypes.h>
 
@@ -54,6 +59,11 @@
 
 /*#define MULTI_DEBUG_EVENT_LOOP*/
 
+static void multi_instance_slab_flush(void);
+static void multi_instance_reclaim_flush(void);
+
+static void ccd_cache_flush(void);
+
 #ifdef MULTI_DEBUG_EVENT_LOOP
 static const char *
 id(struct multi_instance *mi)
@@ -138,11 +148,35 @@ learn_address_script(const struct multi_context *m,
         argv_free(&argv);
     }
 
-    if (m->top.options.learn_address_script)
+    if (m->learn_addr_fd >= 0)
+    {
+        /*
+         * Async mode: write one "operation address [common name]" line
+         * to the long-lived helper instead of forking the script.  The
+         * helper cannot veto the learn, so the event is informational
+         * only.  Lines are shorter than PIPE_BUF and thus written
+         * atomically; if the pipe is full or the helper has gone away
+         * the event is dropped with a warning rather than blocking the
+         * event loop.
+         */
+        struct buffer out = alloc_buf_gc(256, &gc);
+        buf_printf(&out, "%s %s", op, mroute_addr_print(addr, &gc));
+        if (mi)
+        {
+            buf_printf(&out, " %s", tls_common_name(mi->context.c2.tls_multi, false));
+        }
+        buf_printf(&out, "\n");
+        if (write(m->learn_addr_fd, BPTR(&out), BLEN(&out)) != BLEN(&out))
+        {
+            msg(D_MULTI_ERRORS, "MULTI: learn-address event dropped: %s",
+                strerror(errno));
+        }
+    }
+    else if (m->top.options.learn_address_script)
     {
-        struct argv argv = argv_new();
         setenv_str(es, "script_type", "learn-address");
-        argv_parse_cmd(&argv, m->top.options.learn_address_script);
+        struct argv argv = argv_template_expand(&m->learn_address_tmpl,
+                                                m->top.options.learn_address_script);
         argv_printf_cat(&argv, "%s %s", op, mroute_addr_print(addr, &gc));
         if (mi)
         {
@@ -171,6 +205,135 @@ multi_ifconfig_pool_persist(struct multi_context *m, bool force)
     }
 }
 
+/*
+ * Bloom filter front for the virtual address hash.
+ *
+ * On gateway configurations the majority of tun-side destination
+ * lookups are misses -- internet-bound traffic that no client owns --
+ * yet each one probed the vhash.  The filter below answers
+ * "definitely not learned" from a single 64-byte block, so the
+ * guaranteed-miss path touches one cache line instead of walking
+ * hash slots.
+ *
+ * Learned addresses are added when they enter the vhash.  Deletions
+ * are not reflected immediately: a stale bit only costs a false
+ * positive (an unnecessary full lookup), never a wrong answer, so the
+ * filter is rebuilt lazily from the vhash once enough deletions have
+ * accumulated.
+ */
+
+#define VHASH_BLOOM_MIN_BYTES   4096
+#define VHASH_BLOOM_BLOCK_WORDS 8 /* 64 bytes -- one cache line */
+
+struct vhash_bloom
+{
+    uint64_t *bits;
+    int n_blocks;    /* number of 64-byte blocks */
+    int n_deletions; /* vhash deletions since last rebuild */
+};
+
+static struct vhash_bloom *
+vhash_bloom_init(const int n_buckets)
+{
+    struct vhash_bloom *b;
+    int bytes = n_buckets; /* 8 bits per vhash bucket */
+
+    if (bytes < VHASH_BLOOM_MIN_BYTES)
+    {
+        bytes = VHASH_BLOOM_MIN_BYTES;
+    }
+
+    ALLOC_OBJ_CLEAR(b, struct vhash_bloom);
+    b->n_blocks = bytes / (VHASH_BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    ALLOC_ARRAY_CLEAR(b->bits, uint64_t, b->n_blocks * VHASH_BLOOM_BLOCK_WORDS);
+    return b;
+}
+
+static void
+vhash_bloom_free(struct vhash_bloom *b)
+{
+    free(b->bits);
+    free(b);
+}
+
+/*
+ * Derive the block index and two bit positions within the 512-bit
+ * block from the 32-bit table hash.  A multiply-xorshift step spreads
+ * the hash into enough independent index material.
+ */
+static inline void
+vhash_bloom_position(const struct vhash_bloom *b, const uint32_t hv,
+                     int *word0, uint64_t *mask0,
+                     int *word1, uint64_t *mask1)
+{
+    uint64_t x = (uint64_t) hv * 0x9e3779b97f4a7c15ULL;
+    x ^= x >> 29;
+
+    const int block = (int) (((uint64_t) (uint32_t) x * b->n_blocks) >> 32);
+    const int base = block * VHASH_BLOOM_BLOCK_WORDS;
+
+    *word0 = base + (int) ((x >> 32) & (VHASH_BLOOM_BLOCK_WORDS - 1));
+    *mask0 = (uint64_t) 1 << ((x >> 35) & 63);
+    *word1 = base + (int) ((x >> 41) & (VHASH_BLOOM_BLOCK_WORDS - 1));
+    *mask1 = (uint64_t) 1 << ((x >> 44) & 63);
+}
+
+static inline void
+vhash_bloom_add(struct vhash_bloom *b, const uint32_t hv)
+{
+    int w0, w1;
+    uint64_t m0, m1;
+    vhash_bloom_position(b, hv, &w0, &m0, &w1, &m1);
+    b->bits[w0] |= m0;
+    b->bits[w1] |= m1;
+}
+
+static inline bool
+vhash_bloom_test(const struct vhash_bloom *b, const uint32_t hv)
+{
+    int w0, w1;
+    uint64_t m0, m1;
+    vhash_bloom_position(b, hv, &w0, &m0, &w1, &m1);
+    return (b->bits[w0] & m0) && (b->bits[w1] & m1);
+}
+
+static void
+vhash_bloom_rebuild(const struct multi_context *m)
+{
+    struct vhash_bloom *b = m->vhash_bloom;
+    struct hash_iterator hi;
+    struct hash_element *he;
+
+    memset(b->bits, 0,
+           b->n_blocks * VHASH_BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+    b->n_deletions = 0;
+
+    hash_iterator_init(m->vhash, &hi);
+    while ((he = hash_iterator_next(&hi)) != NULL)
+    {
+        vhash_bloom_add(b, he->hash_value);
+    }
+    hash_iterator_free(&hi);
+
+    dmsg(D_MULTI_DEBUG, "MULTI: vhash bloom filter rebuilt (%d routes)",
+         hash_n_elements(m->vhash));
+}
+
+/*
+ * Rebuild once stale bits from deleted routes could meaningfully
+ * raise the false positive rate.  Callers must not hold a live vhash
+ * iterator.
+ */
+static inline void
+vhash_bloom_maybe_rebuild(const struct multi_context *m)
+{
+    struct vhash_bloom *b = m->vhash_bloom;
+    if (b->n_deletions > b->n_blocks * VHASH_BLOOM_BLOCK_WORDS)
+    {
+        vhash_bloom_rebuild(m);
+    }
+}
+
 static void
 multi_reap_range(const struct multi_context *m,
                  int start_bucket,
@@ -196,11 +359,13 @@ multi_reap_range(const struct multi_context *m,
             dmsg(D_MULTI_DEBUG, "MULTI: REAP DEL %s",
                  mroute_addr_print(&r->addr, &gc));
             learn_address_script(m, NULL, "delete", &r->addr);
-            multi_route_del(r);
+            multi_route_del(m, r);
             hash_iterator_delete_element(&hi);
+            ++m->vhash_bloom->n_deletions;
         }
     }
     hash_iterator_free(&hi);
+    vhash_bloom_maybe_rebuild(m);
     gc_free(&gc);
 }
 
@@ -328,16 +493,7 @@ multi_init(struct multi_context *m, struct context *t, bool tcp_mode, int thread
                          get_random(),
                          mroute_addr_hash_function,
                          mroute_addr_compare_function);
-
-    /*
-     * This hash table is a clone of m->hash but with a
-     * bucket size of one so that it can be used
-     * for fast iteration through the list.
-     */
-    m->iter = hash_init(1,
-                        get_random(),
-                        mroute_addr_hash_function,
-                        mroute_addr_compare_function);
+    m->vhash_bloom = vhash_bloom_init(t->options.virtual_hash_size);
 
 #ifdef ENABLE_MANAGEMENT
     m->cid_hash = hash_init(t->options.real_hash_size,
@@ -370,10 +526,45 @@ multi_init(struct multi_context *m, struct context *t, bool tcp_mode, int thread
     m->new_connection_limiter = frequency_limit_init(t->options.cf_max,
                                                      t->options.cf_per);
 
+    /*
+     * Per-source rate accounting, consulted on raw datagrams from
+     * unknown sources before any per-packet work is done for them.
+     */
+    if (t->options.cf_src_rate)
+    {
+        srclimit_init(&m->srclimit, t->options.cf_src_rate,
+                      t->options.cf_src_size);
+    }
+
+#ifndef _WIN32
+    /*
+     * Sibling-process channel for migrating floated clients between
+     * SO_REUSEPORT server processes.
+     */
+    migrate_channel_init(&m->migrate, t->options.migrate_path);
+#endif
+
+#ifdef ENABLE_FEATURE_SHAPER
+    /*
+     * Aggregate output cap: root of the per-instance token-bucket
+     * hierarchy.
+     */
+    if (t->options.shaper_global)
+    {
+        shaper_init(&m->shaper_global, t->options.shaper_global);
+        if (t->options.shaper_global_burst)
+        {
+            shaper_set_burst(&m->shaper_global, t->options.shaper_global_burst);
+        }
+        msg(M_INFO, "MULTI: aggregate output traffic shaping at %d bytes per second (burst %d bytes)",
+            m->shaper_global.bytes_per_second, m->shaper_global.burst);
+    }
+#endif
+
     /*
      * Allocate broadcast/multicast buffer list
      */
-    m->mbuf = mbuf_init(t->options.n_bcast_buf);
+    m->mbuf = mbuf_init(t->options.n_bcast_buf, BUF_SIZE(&t->c2.frame));
 
     /*
      * Different status file format options are available
@@ -415,6 +606,50 @@ multi_init(struct multi_context *m, struct context *t, bool tcp_mode, int thread
      * Help us keep track of routing table.
      */
     m->route_helper = mroute_helper_init(MULTI_CACHE_ROUTE_TTL);
+    m->lpm4 = mroute_lpm_init();
+
+    /*
+     * Serialize the global push list once; clients whose list is not
+     * modified by CCD options assemble their PUSH_REPLY from this
+     * string instead of re-formatting every entry.
+     */
+    push_list_serialize(&t->options.push_list, &t->options.gc);
+
+    /*
+     * Start the long-lived --learn-address helper, so that learning an
+     * address never forks in the packet path.  Events are written down
+     * the pipe instead; the kernel pipe buffer batches them for the
+     * helper.
+     */
+    /*
+     * Pre-parse the constant command prefixes of the per-event scripts,
+     * so that a connect burst only appends the event-specific arguments
+     * instead of re-tokenizing the command strings for every client.
+     */
+    argv_template_init(&m->learn_address_tmpl, t->options.learn_address_script);
+    argv_template_init(&m->client_connect_tmpl, t->options.client_connect_script);
+    argv_template_init(&m->client_disconnect_tmpl, t->options.client_disconnect_script);
+
+    m->learn_addr_fd = -1;
+    if (t->options.learn_address_async && t->options.learn_address_script)
+    {
+        struct argv argv = argv_new();
+        setenv_str(t->c2.es, "script_type", "learn-address");
+        argv_parse_cmd(&argv, t->options.learn_address_script);
+        m->learn_addr_fd = openvpn_popen_stdin(&argv, t->c2.es);
+        if (m->learn_addr_fd >= 0)
+        {
+            set_nonblock(m->learn_addr_fd);
+            set_cloexec(m->learn_addr_fd);
+            msg(M_INFO, "MULTI: --learn-address helper started");
+        }
+        else
+        {
+            msg(M_WARN, "MULTI: could not start --learn-address helper, "
+                "falling back to per-event script execution");
+        }
+        argv_free(&argv);
+    }
 
     /*
      * Initialize route and instance reaper.
@@ -435,6 +670,31 @@ multi_init(struct multi_context *m, struct context *t, bool tcp_mode, int thread
 
     m->instances = calloc(m->max_clients, sizeof(struct multi_instance *));
 
+    /* cache of parked frame buffer sets leased to active TCP client
+     * instances; sized as a high-water cache, not per client -- sets
+     * beyond the cap are simply freed on release */
+    if (tcp_mode)
+    {
+        m->buffers_pool_cap = min_int(m->max_clients, 64);
+        ALLOC_ARRAY_CLEAR(m->buffers_pool, struct context_buffers *,
+                          m->buffers_pool_cap);
+        m->n_buffers_pool = 0;
+    }
+
+    m->work.capacity = 256; /* power of two; overflow falls back to inline execution */
+    m->work.items = calloc(m->work.capacity, sizeof(struct multi_work_item));
+    m->work.bottom = 0;
+    m->work.top = 0;
+
+    /* seed the free-id stack in reverse so ids are first handed out in
+     * ascending order; released ids then sit on top for quick reuse */
+    m->peer_id_free = calloc(m->max_clients, sizeof(int));
+    m->n_peer_id_free = 0;
+    for (int i = m->max_clients - 1; i >= 0; --i)
+    {
+        m->peer_id_free[m->n_peer_id_free++] = i;
+    }
+
     /*
      * Initialize multi-socket TCP I/O wait object
      */
@@ -473,7 +733,14 @@ multi_instance_string(const struct multi_instance *mi, bool null, struct gc_aren
         {
             buf_printf(&out, "%s/", cn);
         }
-        buf_printf(&out, "%s", mroute_addr_print(&mi->real, gc));
+        if (mi->real_print[0])
+        {
+            buf_printf(&out, "%s", mi->real_print);
+        }
+        else
+        {
+            buf_printf(&out, "%s", mroute_addr_print(&mi->real, gc));
+        }
         return BSTR(&out);
     }
     else if (null)
@@ -490,7 +757,14 @@ static void
 generate_prefix(struct multi_instance *mi)
 {
     struct gc_arena gc = gc_new();
-    const char *prefix = multi_instance_string(mi, true, &gc);
+    const char *prefix;
+
+    /* all paths that can change mi->real run through here, so this is
+     * also where the cached presentation string is refreshed */
+    strncpynt(mi->real_print, mroute_addr_print(&mi->real, &gc),
+              sizeof(mi->real_print));
+
+    prefix = multi_instance_string(mi, true, &gc);
     if (prefix)
     {
         strncpynt(mi->msg_prefix, prefix, sizeof(mi->msg_prefix));
@@ -569,7 +843,7 @@ multi_client_disconnect_setenv(struct multi_instance *mi)
 }
 
 static void
-multi_client_disconnect_script(struct multi_instance *mi)
+multi_client_disconnect_script(struct multi_context *m, struct multi_instance *mi)
 {
     multi_client_disconnect_setenv(mi);
 
@@ -583,9 +857,9 @@ multi_client_disconnect_script(struct multi_instance *mi)
 
     if (mi->context.options.client_disconnect_script)
     {
-        struct argv argv = argv_new();
         setenv_str(mi->context.c2.es, "script_type", "client-disconnect");
-        argv_parse_cmd(&argv, mi->context.options.client_disconnect_script);
+        struct argv argv = argv_template_expand(&m->client_disconnect_tmpl,
+                                                mi->context.options.client_disconnect_script);
         openvpn_run_script(&argv, mi->context.c2.es, 0, "--client-disconnect");
         argv_free(&argv);
     }
@@ -597,6 +871,64 @@ multi_client_disconnect_script(struct multi_instance *mi)
 #endif
 }
 
+void
+multi_flow_cache_purge(struct multi_context *m, const struct multi_instance *mi)
+{
+    int i;
+    for (i = 0; i < MULTI_FLOW_CACHE_SIZE; ++i)
+    {
+        if (m->flow_cache[i].mi == mi)
+        {
+            CLEAR(m->flow_cache[i]);
+        }
+    }
+}
+
+/*
+ * Intrusive list of all active instances, so that maintenance passes
+ * enumerate only the instances themselves instead of walking a hash
+ * table's bucket array.
+ */
+static void
+multi_activelist_add(struct multi_context *m, struct multi_instance *mi)
+{
+    mi->active_prev = m->active_tail;
+    mi->active_next = NULL;
+    if (m->active_tail)
+    {
+        m->active_tail->active_next = mi;
+    }
+    else
+    {
+        m->active_head = mi;
+    }
+    m->active_tail = mi;
+    mi->on_active_list = true;
+}
+
+static void
+multi_activelist_remove(struct multi_context *m, struct multi_instance *mi)
+{
+    if (mi->active_prev)
+    {
+        mi->active_prev->active_next = mi->active_next;
+    }
+    else
+    {
+        m->active_head = mi->active_next;
+    }
+    if (mi->active_next)
+    {
+        mi->active_next->active_prev = mi->active_prev;
+    }
+    else
+    {
+        m->active_tail = mi->active_prev;
+    }
+    mi->active_prev = mi->active_next = NULL;
+    mi->on_active_list = false;
+}
+
 void
 multi_close_instance(struct multi_context *m,
                      struct multi_instance *mi,
@@ -609,6 +941,16 @@ multi_close_instance(struct multi_context *m,
 
     dmsg(D_MULTI_DEBUG, "MULTI: multi_close_instance called");
 
+#ifdef ENABLE_WORKER_THREADS
+    /* no worker may still decrypt under key material this teardown
+     * frees; halt is already set, so remaining queued jobs fall
+     * through quickly */
+    if (m->worker_pool)
+    {
+        multi_worker_drain_instance(m->worker_pool, mi);
+    }
+#endif
+
     /* adjust current client connection count */
     m->n_clients += mi->n_clients_delta;
     update_mstat_n_clients(m->n_clients);
@@ -623,6 +965,12 @@ multi_close_instance(struct multi_context *m,
     {
         m->earliest_wakeup = NULL;
     }
+    multi_flow_cache_purge(m, mi);
+
+#ifdef ENABLE_MEMSTATS
+    mstats_instance_free(mi->mstats_slot);
+    mi->mstats_slot = -1;
+#endif
 
     if (!shutdown)
     {
@@ -630,9 +978,9 @@ multi_close_instance(struct multi_context *m,
         {
             ASSERT(hash_remove(m->hash, &mi->real));
         }
-        if (mi->did_iter)
+        if (mi->on_active_list)
         {
-            ASSERT(hash_remove(m->iter, &mi->real));
+            multi_activelist_remove(m, mi);
         }
 #ifdef ENABLE_MANAGEMENT
         if (mi->did_cid_hash)
@@ -652,6 +1000,25 @@ multi_close_instance(struct multi_context *m,
         if (mi->context.c2.tls_multi->peer_id != MAX_PEER_ID)
         {
             m->instances[mi->context.c2.tls_multi->peer_id] = NULL;
+            /* top of the stack, so an immediate reconnect reuses the id;
+             * the stack can hold stale entries when an id was taken out of
+             * order (migrate/persist import), so cap rather than overflow */
+            if (m->n_peer_id_free < m->max_clients)
+            {
+                m->peer_id_free[m->n_peer_id_free++] =
+                    mi->context.c2.tls_multi->peer_id;
+            }
+        }
+
+        /* drop queued work referencing this instance */
+        for (int w = m->work.top; w != m->work.bottom; ++w)
+        {
+            struct multi_work_item *item =
+                &m->work.items[w & (m->work.capacity - 1)];
+            if (item->mi == mi)
+            {
+                item->mi = NULL;
+            }
         }
 
         schedule_remove_entry(m->schedule, (struct schedule_entry *) mi);
@@ -677,7 +1044,7 @@ multi_close_instance(struct multi_context *m,
 #endif
     if (mi->context.c2.context_auth == CAS_SUCCEEDED)
     {
-        multi_client_disconnect_script(mi);
+        multi_client_disconnect_script(m, mi);
     }
 
     close_context(&mi->context, SIGTERM, CC_GC_FREE);
@@ -711,29 +1078,35 @@ multi_uninit(struct multi_context *m)
     {
         if (m->hash)
         {
-            struct hash_iterator hi;
-            struct hash_element *he;
-
-            hash_iterator_init(m->iter, &hi);
-            while ((he = hash_iterator_next(&hi)))
+            while (m->active_head)
             {
-                struct multi_instance *mi = (struct multi_instance *) he->value;
-                mi->did_iter = false;
-                multi_close_instance(m, mi, true);
+                /* multi_close_instance unlinks the head */
+                multi_close_instance(m, m->active_head, true);
             }
-            hash_iterator_free(&hi);
 
             multi_reap_all(m);
 
             hash_free(m->hash);
             hash_free(m->vhash);
-            hash_free(m->iter);
+            vhash_bloom_free(m->vhash_bloom);
 #ifdef ENABLE_MANAGEMENT
             hash_free(m->cid_hash);
 #endif
             m->hash = NULL;
 
+            multi_instance_reclaim_flush();
+            multi_instance_slab_flush();
+
             free(m->instances);
+            free(m->peer_id_free);
+            free(m->work.items);
+
+            for (int i = 0; i < m->n_buffers_pool; ++i)
+            {
+                free_context_buffers(m->buffers_pool[i]);
+            }
+            free(m->buffers_pool);
+            m->buffers_pool = NULL;
 
 #ifdef ENABLE_ASYNC_PUSH
             hash_free(m->inotify_watchers);
@@ -744,14 +1117,135 @@ multi_uninit(struct multi_context *m)
             mbuf_free(m->mbuf);
             ifconfig_pool_free(m->ifconfig_pool);
             frequency_limit_free(m->new_connection_limiter);
+            srclimit_free(&m->srclimit);
+#ifndef _WIN32
+            migrate_channel_uninit(&m->migrate);
+#endif
             multi_reap_free(m->reaper);
             mroute_helper_free(m->route_helper);
+            mroute_lpm_free(m->lpm4);
+            if (m->learn_addr_fd >= 0)
+            {
+                /* helper exits on EOF */
+                close(m->learn_addr_fd);
+                m->learn_addr_fd = -1;
+            }
+            argv_template_free(&m->learn_address_tmpl);
+            argv_template_free(&m->client_connect_tmpl);
+            argv_template_free(&m->client_disconnect_tmpl);
             multi_tcp_free(m->mtcp);
+            tls_crypt_v2_cache_flush();
+            cert_verify_cache_flush();
+            ccd_cache_flush();
             m->thread_mode = MC_UNDEF;
         }
     }
 }
 
+/*
+ * Recycle instance allocations through a small slab.  struct
+ * multi_instance embeds struct context and weighs several kilobytes,
+ * so handing freed instances back to the next connecting client spares
+ * the allocator during client churn.  Only ever touched from the main
+ * thread.
+ */
+#define MULTI_INSTANCE_SLAB_MAX 64
+
+static struct multi_instance *instance_slab[MULTI_INSTANCE_SLAB_MAX];
+static int instance_slab_n;
+
+struct multi_instance *
+multi_instance_alloc(void)
+{
+    struct multi_instance *mi;
+
+    if (instance_slab_n > 0)
+    {
+        mi = instance_slab[--instance_slab_n];
+        memset(mi, 0, sizeof(*mi));
+    }
+    else
+    {
+        ALLOC_OBJ_CLEAR(mi, struct multi_instance);
+    }
+    return mi;
+}
+
+void
+multi_instance_free(struct multi_instance *mi)
+{
+    free_buf(&mi->status_record);
+    if (instance_slab_n < MULTI_INSTANCE_SLAB_MAX)
+    {
+        instance_slab[instance_slab_n++] = mi;
+    }
+    else
+    {
+        free(mi);
+    }
+}
+
+static void
+multi_instance_slab_flush(void)
+{
+    while (instance_slab_n > 0)
+    {
+        free(instance_slab[--instance_slab_n]);
+    }
+}
+
+/*
+ * Epoch-based reclamation.  An instance whose last reference is
+ * dropped is not handed back to the slab immediately but parked for
+ * two epochs; the main event loop declares a quiescent state once per
+ * iteration.  Any stage that picked up an instance pointer during an
+ * iteration -- including deferred work that only inspects mi->halt --
+ * can therefore keep using it until the end of that iteration without
+ * per-packet refcount traffic.  Main thread only, like the slab.
+ */
+static unsigned int instance_reclaim_epoch;
+static struct multi_instance *instance_reclaim_list;
+
+void
+multi_instance_defer_free(struct multi_instance *mi)
+{
+    mi->reclaim_epoch = instance_reclaim_epoch;
+    mi->reclaim_next = instance_reclaim_list;
+    instance_reclaim_list = mi;
+}
+
+void
+multi_reclaim_quiesce(void)
+{
+    struct multi_instance **prev = &instance_reclaim_list;
+    struct multi_instance *mi;
+
+    ++instance_reclaim_epoch;
+    while ((mi = *prev))
+    {
+        if (instance_reclaim_epoch - mi->reclaim_epoch >= 2)
+        {
+            *prev = mi->reclaim_next;
+            multi_instance_free(mi);
+        }
+        else
+        {
+            prev = &mi->reclaim_next;
+        }
+    }
+}
+
+static void
+multi_instance_reclaim_flush(void)
+{
+    while (instance_reclaim_list)
+    {
+        struct multi_instance *mi = instance_reclaim_list;
+        instance_reclaim_list = mi->reclaim_next;
+        multi_instance_free(mi);
+    }
+}
+
 /*
  * Create a client instance object for a newly connected client.
  */
@@ -765,12 +1259,15 @@ multi_create_instance(struct multi_context *m, const struct mroute_addr *real)
 
     msg(D_MULTI_MEDIUM, "MULTI: multi_create_instance called");
 
-    ALLOC_OBJ_CLEAR(mi, struct multi_instance);
+    mi = multi_instance_alloc();
 
     mi->gc = gc_new();
     multi_instance_inc_refcount(mi);
     mi->vaddr_handle = -1;
     mi->created = now;
+#ifdef ENABLE_MEMSTATS
+    mi->mstats_slot = -1;
+#endif
     mroute_addr_init(&mi->real);
 
     if (real)
@@ -802,13 +1299,7 @@ multi_create_instance(struct multi_context *m, const struct mroute_addr *real)
         generate_prefix(mi);
     }
 
-    if (!hash_add(m->iter, &mi->real, mi, false))
-    {
-        msg(D_MULTI_LOW, "MULTI: unable to add real address [%s] to iterator hash table",
-            mroute_addr_print(&mi->real, &gc));
-        goto err;
-    }
-    mi->did_iter = true;
+    multi_activelist_add(m, mi);
 
 #ifdef ENABLE_MANAGEMENT
     do
@@ -829,6 +1320,10 @@ multi_create_instance(struct multi_context *m, const struct mroute_addr *real)
         goto err;
     }
 
+#ifdef ENABLE_MEMSTATS
+    mi->mstats_slot = mstats_instance_alloc();
+#endif
+
     perf_pop();
     gc_free(&gc);
     return mi;
@@ -841,15 +1336,96 @@ err:
 }
 
 /*
- * Dump tables -- triggered by SIGUSR2.
- * If status file is defined, write to file.
- * If status file is NULL, write to syslog.
+ * Maximum length of a cached CLIENT_LIST status record.
  */
-void
-multi_print_status(struct multi_context *m, struct status_output *so, const int version)
-{
-    if (m->hash)
-    {
+#define STATUS_RECORD_SIZE 1024
+
+/*
+ * Return the pre-serialized CLIENT_LIST record for an instance,
+ * reformatting it only when the instance has seen link traffic since
+ * the record was last built (identity fields such as the virtual
+ * address, username, peer-id and cipher only change during exchanges
+ * that move link bytes, so the byte counters double as a change
+ * indicator).  This turns a management 'status' poll over an idle
+ * client set into a bounded copy per instance instead of a full
+ * format, which freezes the event loop measurably with thousands
+ * of clients.
+ */
+static const char *
+multi_instance_status_record(struct multi_instance *mi, const int version, const char sep)
+{
+    struct buffer *buf = &mi->status_record;
+    struct gc_arena gc;
+
+    if (BLEN(buf) > 0
+        && mi->status_record_version == version
+        && mi->status_record_read == mi->context.c2.link_read_bytes
+        && mi->status_record_write == mi->context.c2.link_write_bytes)
+    {
+        return BSTR(buf);
+    }
+
+    if (!buf_defined(buf))
+    {
+        *buf = alloc_buf(STATUS_RECORD_SIZE);
+    }
+    buf_reset_len(buf);
+
+    gc = gc_new();
+    if (version == 1)
+    {
+        buf_printf(buf, "%s,%s," counter_format "," counter_format ",%s",
+                   tls_common_name(mi->context.c2.tls_multi, false),
+                   mi->real_print,
+                   mi->context.c2.link_read_bytes,
+                   mi->context.c2.link_write_bytes,
+                   time_string(mi->created, 0, false, &gc));
+    }
+    else
+    {
+        buf_printf(buf, "CLIENT_LIST%c%s%c%s%c%s%c%s%c" counter_format "%c" counter_format "%c%s%c%u%c%s%c"
+#ifdef ENABLE_MANAGEMENT
+                   "%lu"
+#else
+                   ""
+#endif
+                   "%c%" PRIu32 "%c%s",
+                   sep, tls_common_name(mi->context.c2.tls_multi, false),
+                   sep, mi->real_print,
+                   sep, print_in_addr_t(mi->reporting_addr, IA_EMPTY_IF_UNDEF, &gc),
+                   sep, print_in6_addr(mi->reporting_addr_ipv6, IA_EMPTY_IF_UNDEF, &gc),
+                   sep, mi->context.c2.link_read_bytes,
+                   sep, mi->context.c2.link_write_bytes,
+                   sep, time_string(mi->created, 0, false, &gc),
+                   sep, (unsigned int)mi->created,
+                   sep, tls_username(mi->context.c2.tls_multi, false),
+#ifdef ENABLE_MANAGEMENT
+                   sep, mi->context.c2.mda_context.cid,
+#else
+                   sep,
+#endif
+                   sep, mi->context.c2.tls_multi ? mi->context.c2.tls_multi->peer_id : UINT32_MAX,
+                   sep, translate_cipher_name_to_openvpn(mi->context.options.ciphername));
+    }
+    gc_free(&gc);
+
+    mi->status_record_version = version;
+    mi->status_record_read = mi->context.c2.link_read_bytes;
+    mi->status_record_write = mi->context.c2.link_write_bytes;
+
+    return BSTR(buf);
+}
+
+/*
+ * Dump tables -- triggered by SIGUSR2.
+ * If status file is defined, write to file.
+ * If status file is NULL, write to syslog.
+ */
+void
+multi_print_status(struct multi_context *m, struct status_output *so, const int version)
+{
+    if (m->hash)
+    {
         struct gc_arena gc_top = gc_new();
         struct hash_iterator hi;
         const struct hash_element *he;
@@ -867,19 +1443,12 @@ multi_print_status(struct multi_context *m, struct status_output *so, const int
             hash_iterator_init(m->hash, &hi);
             while ((he = hash_iterator_next(&hi)))
             {
-                struct gc_arena gc = gc_new();
-                const struct multi_instance *mi = (struct multi_instance *) he->value;
+                struct multi_instance *mi = (struct multi_instance *) he->value;
 
                 if (!mi->halt)
                 {
-                    status_printf(so, "%s,%s," counter_format "," counter_format ",%s",
-                                  tls_common_name(mi->context.c2.tls_multi, false),
-                                  mroute_addr_print(&mi->real, &gc),
-                                  mi->context.c2.link_read_bytes,
-                                  mi->context.c2.link_write_bytes,
-                                  time_string(mi->created, 0, false, &gc));
+                    status_printf(so, "%s", multi_instance_status_record(mi, version, ','));
                 }
-                gc_free(&gc);
             }
             hash_iterator_free(&hi);
 
@@ -905,7 +1474,7 @@ multi_print_status(struct multi_context *m, struct status_output *so, const int
                                   mroute_addr_print(ma, &gc),
                                   flags,
                                   tls_common_name(mi->context.c2.tls_multi, false),
-                                  mroute_addr_print(&mi->real, &gc),
+                                  mi->real_print,
                                   time_string(route->last_reference, 0, false, &gc));
                 }
                 gc_free(&gc);
@@ -919,6 +1488,45 @@ multi_print_status(struct multi_context *m, struct status_output *so, const int
                               mbuf_maximum_queued(m->mbuf));
             }
 
+            status_printf(so, "REPLAY STATS");
+            status_printf(so, "Common Name,Replay Drops,Out-of-Window Drops,Time Drops,Max Reorder Depth");
+            hash_iterator_init(m->hash, &hi);
+            while ((he = hash_iterator_next(&hi)))
+            {
+                const struct multi_instance *mi = (struct multi_instance *) he->value;
+
+                if (!mi->halt && mi->context.c2.tls_multi)
+                {
+                    const struct packet_id_rec_stats *rs = &mi->context.c2.tls_multi->replay_stats;
+                    status_printf(so, "%s," counter_format "," counter_format "," counter_format ",%d",
+                                  tls_common_name(mi->context.c2.tls_multi, false),
+                                  rs->n_replay,
+                                  rs->n_out_of_window,
+                                  rs->n_time_backtrack,
+                                  rs->max_reorder);
+                }
+            }
+            hash_iterator_free(&hi);
+
+            status_printf(so, "OUTPUT CONGESTION");
+            status_printf(so, "Common Name,ECN Marked,Bulk Drops,Tail Drops");
+            hash_iterator_init(m->hash, &hi);
+            while ((he = hash_iterator_next(&hi)))
+            {
+                const struct multi_instance *mi = (struct multi_instance *) he->value;
+
+                if (!mi->halt
+                    && (mi->n_ecn_marked || mi->n_drops_bulk || mi->n_drops_tail))
+                {
+                    status_printf(so, "%s," counter_format "," counter_format "," counter_format,
+                                  tls_common_name(mi->context.c2.tls_multi, false),
+                                  mi->n_ecn_marked,
+                                  mi->n_drops_bulk,
+                                  mi->n_drops_tail);
+                }
+            }
+            hash_iterator_free(&hi);
+
             status_printf(so, "END");
         }
         else if (version == 2 || version == 3)
@@ -935,36 +1543,12 @@ multi_print_status(struct multi_context *m, struct status_output *so, const int
             hash_iterator_init(m->hash, &hi);
             while ((he = hash_iterator_next(&hi)))
             {
-                struct gc_arena gc = gc_new();
-                const struct multi_instance *mi = (struct multi_instance *) he->value;
+                struct multi_instance *mi = (struct multi_instance *) he->value;
 
                 if (!mi->halt)
                 {
-                    status_printf(so, "CLIENT_LIST%c%s%c%s%c%s%c%s%c" counter_format "%c" counter_format "%c%s%c%u%c%s%c"
-#ifdef ENABLE_MANAGEMENT
-                                  "%lu"
-#else
-                                  ""
-#endif
-                                  "%c%" PRIu32 "%c%s",
-                                  sep, tls_common_name(mi->context.c2.tls_multi, false),
-                                  sep, mroute_addr_print(&mi->real, &gc),
-                                  sep, print_in_addr_t(mi->reporting_addr, IA_EMPTY_IF_UNDEF, &gc),
-                                  sep, print_in6_addr(mi->reporting_addr_ipv6, IA_EMPTY_IF_UNDEF, &gc),
-                                  sep, mi->context.c2.link_read_bytes,
-                                  sep, mi->context.c2.link_write_bytes,
-                                  sep, time_string(mi->created, 0, false, &gc),
-                                  sep, (unsigned int)mi->created,
-                                  sep, tls_username(mi->context.c2.tls_multi, false),
-#ifdef ENABLE_MANAGEMENT
-                                  sep, mi->context.c2.mda_context.cid,
-#else
-                                  sep,
-#endif
-                                  sep, mi->context.c2.tls_multi ? mi->context.c2.tls_multi->peer_id : UINT32_MAX,
-                                  sep, translate_cipher_name_to_openvpn(mi->context.options.ciphername));
+                    status_printf(so, "%s", multi_instance_status_record(mi, version, sep));
                 }
-                gc_free(&gc);
             }
             hash_iterator_free(&hi);
 
@@ -989,7 +1573,7 @@ multi_print_status(struct multi_context *m, struct status_output *so, const int
                     status_printf(so, "ROUTING_TABLE%c%s%s%c%s%c%s%c%s%c%u",
                                   sep, mroute_addr_print(ma, &gc), flags,
                                   sep, tls_common_name(mi->context.c2.tls_multi, false),
-                                  sep, mroute_addr_print(&mi->real, &gc),
+                                  sep, mi->real_print,
                                   sep, time_string(route->last_reference, 0, false, &gc),
                                   sep, (unsigned int)route->last_reference);
                 }
@@ -1003,6 +1587,45 @@ multi_print_status(struct multi_context *m, struct status_output *so, const int
                               sep, sep, mbuf_maximum_queued(m->mbuf));
             }
 
+            status_printf(so, "HEADER%cREPLAY_STATS%cCommon Name%cReplay Drops%cOut-of-Window Drops%cTime Drops%cMax Reorder Depth",
+                          sep, sep, sep, sep, sep, sep);
+            hash_iterator_init(m->hash, &hi);
+            while ((he = hash_iterator_next(&hi)))
+            {
+                const struct multi_instance *mi = (struct multi_instance *) he->value;
+
+                if (!mi->halt && mi->context.c2.tls_multi)
+                {
+                    const struct packet_id_rec_stats *rs = &mi->context.c2.tls_multi->replay_stats;
+                    status_printf(so, "REPLAY_STATS%c%s%c" counter_format "%c" counter_format "%c" counter_format "%c%d",
+                                  sep, tls_common_name(mi->context.c2.tls_multi, false),
+                                  sep, rs->n_replay,
+                                  sep, rs->n_out_of_window,
+                                  sep, rs->n_time_backtrack,
+                                  sep, rs->max_reorder);
+                }
+            }
+            hash_iterator_free(&hi);
+
+            status_printf(so, "HEADER%cOUTPUT_CONGESTION%cCommon Name%cECN Marked%cBulk Drops%cTail Drops",
+                          sep, sep, sep, sep, sep);
+            hash_iterator_init(m->hash, &hi);
+            while ((he = hash_iterator_next(&hi)))
+            {
+                const struct multi_instance *mi = (struct multi_instance *) he->value;
+
+                if (!mi->halt
+                    && (mi->n_ecn_marked || mi->n_drops_bulk || mi->n_drops_tail))
+                {
+                    status_printf(so, "OUTPUT_CONGESTION%c%s%c" counter_format "%c" counter_format "%c" counter_format,
+                                  sep, tls_common_name(mi->context.c2.tls_multi, false),
+                                  sep, mi->n_ecn_marked,
+                                  sep, mi->n_drops_bulk,
+                                  sep, mi->n_drops_tail);
+                }
+            }
+            hash_iterator_free(&hi);
+
             status_printf(so, "END");
         }
         else
@@ -1108,7 +1731,7 @@ multi_learn_addr(struct multi_context *m,
                 route_quota_inc(mi);
 
                 /* delete old route */
-                multi_route_del(oldroute);
+                multi_route_del(m, oldroute);
 
                 /* modify hash table entry, replacing old route */
                 he->key = &newroute->addr;
@@ -1126,9 +1749,20 @@ multi_learn_addr(struct multi_context *m,
 
                 /* add new route */
                 hash_add_fast(m->vhash, bucket, &newroute->addr, hv, newroute);
+                vhash_bloom_add(m->vhash_bloom, hv);
             }
         }
 
+        /* index IPv4 network routes in the LPM trie as well, so CIDR
+         * lookups don't have to probe the hash once per netlength */
+        if (learn_succeeded
+            && (newroute->addr.type & MR_ADDR_MASK) == MR_ADDR_IPV4
+            && (newroute->addr.type & MR_WITH_NETBITS))
+        {
+            mroute_lpm_add(m->lpm4, ntohl(newroute->addr.v4.addr),
+                           newroute->addr.netbits, newroute);
+        }
+
         msg(D_MULTI_LOW, "MULTI: Learn%s: %s -> %s",
             learn_succeeded ? "" : " FAILED",
             mroute_addr_print(&newroute->addr, &gc),
@@ -1161,7 +1795,19 @@ multi_get_instance_by_virtual_addr(struct multi_context *m,
         return NULL;
     }
 
-    route = (struct multi_route *) hash_lookup(m->vhash, addr);
+    /* bloom filter rejects never-learned destinations (the common
+     * case on gateways, where most tun traffic is internet-bound)
+     * without probing the vhash */
+    const uint32_t hv = hash_value(m->vhash, addr);
+    route = NULL;
+    if (vhash_bloom_test(m->vhash_bloom, hv))
+    {
+        struct hash_element *he = hash_lookup_fast(m->vhash, NULL, addr, hv);
+        if (he)
+        {
+            route = (struct multi_route *) he->value;
+        }
+    }
 
     /* does host route (possible cached) exist? */
     if (route && multi_route_defined(m, route))
@@ -1172,28 +1818,65 @@ multi_get_instance_by_virtual_addr(struct multi_context *m,
     }
     else if (cidr_routing) /* do we need to regenerate a host route cache entry? */
     {
-        struct mroute_helper *rh = m->route_helper;
-        struct mroute_addr tryaddr;
-        int i;
-
-        /* cycle through each CIDR length */
-        for (i = 0; i < rh->n_net_len; ++i)
+        if ((addr->type & MR_ADDR_MASK) == MR_ADDR_IPV4)
         {
-            tryaddr = *addr;
-            tryaddr.type |= MR_WITH_NETBITS;
-            tryaddr.netbits = rh->net_len[i];
-            mroute_addr_mask_host_bits(&tryaddr);
+            /* single trie walk finds all IPv4 networks containing the
+             * address, longest match last */
+            void *matches[32 + 1];
+            int n = mroute_lpm_lookup(m->lpm4, ntohl(addr->v4.addr),
+                                      matches, (int) SIZE(matches));
 
-            /* look up a possible route with netbits netmask */
-            route = (struct multi_route *) hash_lookup(m->vhash, &tryaddr);
+            while (n-- > 0)
+            {
+                struct multi_route *nr = (struct multi_route *) matches[n];
+                if (multi_route_defined(m, nr))
+                {
+                    /* found an applicable route, cache host route */
+                    struct multi_instance *mi = nr->instance;
+                    multi_learn_addr(m, mi, addr, MULTI_ROUTE_CACHE|MULTI_ROUTE_AGEABLE);
+                    route = nr;
+                    ret = mi;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            struct mroute_helper *rh = m->route_helper;
+            struct mroute_addr tryaddr;
+            int i;
 
-            if (route && multi_route_defined(m, route))
+            /* cycle through each CIDR length (IPv6 only; IPv4 is
+             * served by the LPM trie above) */
+            for (i = 0; i < rh->n_net_len; ++i)
             {
-                /* found an applicable route, cache host route */
-                struct multi_instance *mi = route->instance;
-                multi_learn_addr(m, mi, addr, MULTI_ROUTE_CACHE|MULTI_ROUTE_AGEABLE);
-                ret = mi;
-                break;
+                tryaddr = *addr;
+                tryaddr.type |= MR_WITH_NETBITS;
+                tryaddr.netbits = rh->net_len[i];
+                mroute_addr_mask_host_bits(&tryaddr);
+
+                /* look up a possible route with netbits netmask,
+                 * consulting the bloom filter first */
+                const uint32_t tryhv = hash_value(m->vhash, &tryaddr);
+                route = NULL;
+                if (vhash_bloom_test(m->vhash_bloom, tryhv))
+                {
+                    struct hash_element *he =
+                        hash_lookup_fast(m->vhash, NULL, &tryaddr, tryhv);
+                    if (he)
+                    {
+                        route = (struct multi_route *) he->value;
+                    }
+                }
+
+                if (route && multi_route_defined(m, route))
+                {
+                    /* found an applicable route, cache host route */
+                    struct multi_instance *mi = route->instance;
+                    multi_learn_addr(m, mi, addr, MULTI_ROUTE_CACHE|MULTI_ROUTE_AGEABLE);
+                    ret = mi;
+                    break;
+                }
             }
         }
     }
@@ -1268,9 +1951,9 @@ multi_learn_in6_addr(struct multi_context *m,
 {
     struct mroute_addr addr;
 
+    CLEAR(addr);
     addr.len = 16;
     addr.type = MR_ADDR_IPV6;
-    addr.netbits = 0;
     addr.v6.addr = a6;
 
     if (netbits >= 0)
@@ -1353,27 +2036,23 @@ multi_delete_dup(struct multi_context *m, struct multi_instance *new_mi)
         const char *new_cn = tls_common_name(new_mi->context.c2.tls_multi, true);
         if (new_cn)
         {
-            struct hash_iterator hi;
-            struct hash_element *he;
+            struct multi_instance *mi;
+            struct multi_instance *next;
             int count = 0;
 
-            hash_iterator_init(m->iter, &hi);
-            while ((he = hash_iterator_next(&hi)))
+            for (mi = m->active_head; mi; mi = next)
             {
-                struct multi_instance *mi = (struct multi_instance *) he->value;
+                next = mi->active_next;
                 if (mi != new_mi && !mi->halt)
                 {
                     const char *cn = tls_common_name(mi->context.c2.tls_multi, true);
                     if (cn && !strcmp(cn, new_cn))
                     {
-                        mi->did_iter = false;
                         multi_close_instance(m, mi, false);
-                        hash_iterator_delete_element(&hi);
                         ++count;
                     }
                 }
             }
-            hash_iterator_free(&hi);
 
             if (count)
             {
@@ -1401,11 +2080,13 @@ check_stale_routes(struct multi_context *m)
             dmsg(D_MULTI_DEBUG, "MULTI: Deleting stale route for address '%s'",
                  mroute_addr_print(&r->addr, &gc));
             learn_address_script(m, NULL, "delete", &r->addr);
-            multi_route_del(r);
+            multi_route_del(m, r);
             hash_iterator_delete_element(&hi);
+            ++m->vhash_bloom->n_deletions;
         }
     }
     hash_iterator_free(&hi);
+    vhash_bloom_maybe_rebuild(m);
     gc_free(&gc);
 }
 
@@ -1481,6 +2162,10 @@ multi_select_virtual_addr(struct multi_context *m, struct multi_instance *mi)
         mi->vaddr_handle = ifconfig_pool_acquire(m->ifconfig_pool, &local, &remote, &remote_ipv6, cn);
         if (mi->vaddr_handle >= 0)
         {
+            /* journal the new assignment to the persist file */
+            ifconfig_pool_journal(m->top.c1.ifconfig_pool_persist,
+                                  m->ifconfig_pool, mi->vaddr_handle);
+
             const int tunnel_type = TUNNEL_TYPE(mi->context.c1.tuntap);
             const int tunnel_topology = TUNNEL_TOPOLOGY(mi->context.c1.tuntap);
 
@@ -1818,6 +2503,17 @@ multi_client_set_protocol_options(struct context *c)
     o->data_channel_use_ekm = (proto & IV_PROTO_TLS_KEY_EXPORT);
 #endif
 
+    /* fall back to the cheaper HKDF expansion only when the TLS library
+     * cannot export keying material for either side */
+    o->data_channel_use_hkdf = (proto & IV_PROTO_HKDF_EXPANSION)
+                               && !o->data_channel_use_ekm;
+
+    o->push_digest_peer = (proto & IV_PROTO_PUSH_DIGEST);
+
+    /* use 64-bit AEAD packet IDs whenever the client supports them, so
+     * bulk flows never renegotiate purely due to counter width */
+    o->data_channel_pkt_id_64 = (proto & IV_PROTO_PKT_ID_64);
+
     /* Select cipher if client supports Negotiable Crypto Parameters */
     if (!o->ncp_enabled)
     {
@@ -2274,7 +2970,8 @@ multi_client_connect_call_script(struct multi_context *m,
 
     if (mi->context.options.client_connect_script)
     {
-        struct argv argv = argv_new();
+        struct argv argv = argv_template_expand(&m->client_connect_tmpl,
+                                                mi->context.options.client_connect_script);
         struct gc_arena gc = gc_new();
 
         setenv_str(mi->context.c2.es, "script_type", "client-connect");
@@ -2286,7 +2983,6 @@ multi_client_connect_call_script(struct multi_context *m,
             goto cleanup;
         }
 
-        argv_parse_cmd(&argv, mi->context.options.client_connect_script);
         argv_printf_cat(&argv, "%s", ccs->config_file);
 
         if (openvpn_run_script(&argv, mi->context.c2.es, 0, "--client-connect"))
@@ -2357,6 +3053,41 @@ multi_client_connect_late_setup(struct multi_context *m,
      */
     do_deferred_options(&mi->context, option_types_found);
 
+#ifdef ENABLE_FEATURE_SHAPER
+    /*
+     * Per-client output rate limit, chained under the aggregate
+     * bucket.  Server instances are policed (see
+     * process_outgoing_link_once), so no wakeup scheduling is needed.
+     */
+    if (mi->context.options.shaper)
+    {
+        shaper_init(&mi->context.c2.shaper, mi->context.options.shaper);
+        if (mi->context.options.shaper_burst)
+        {
+            shaper_set_burst(&mi->context.c2.shaper,
+                             mi->context.options.shaper_burst);
+        }
+
+        /*
+         * TCP children own their socket, so the kernel can pace it;
+         * UDP children share the listen socket and stay policed.
+         */
+        if (mi->context.options.shaper_pacing
+            && mi->context.mode == CM_CHILD_TCP
+            && mi->context.c2.link_socket
+            && socket_defined(mi->context.c2.link_socket->sd))
+        {
+            mi->context.c2.shaper.kernel_paced =
+                socket_set_pacing_rate(mi->context.c2.link_socket->sd,
+                                       mi->context.options.shaper);
+        }
+    }
+    if (m->shaper_global.bytes_per_second)
+    {
+        mi->context.c2.shaper.parent = &m->shaper_global;
+    }
+#endif
+
     /*
      * make sure we got ifconfig settings from somewhere
      */
@@ -2490,6 +3221,133 @@ multi_client_connect_early_setup(struct multi_context *m,
     multi_client_connect_setenv(m, mi);
 }
 
+/*
+ * Cache of --client-config-dir file contents, keyed by common name.
+ * Reconnecting clients -- auth-token reconnects in particular -- source
+ * the same CCD file over and over, and the stat/open/read cycle shows
+ * up as the dominant syscall cost of a reconnect on busy servers.  A
+ * cached entry is revalidated with a single stat() of the file it was
+ * read from and applied from its pre-tokenized form via
+ * options_import_parsed(), so an unchanged config costs one stat and
+ * neither file I/O nor a tokenizer pass.  Any size or mtime change
+ * invalidates the entry and takes the regular file path again; an entry
+ * sourced from the DEFAULT fallback is also invalidated as soon as a
+ * common-name file appears, since that file takes precedence.
+ */
+#define CCD_CACHE_SIZE 256
+
+struct ccd_cache_entry
+{
+    bool in_use;
+    char *common_name;
+    char *file;                 /* ccd file the content was read from */
+    bool is_default;            /* file is the DEFAULT fallback, not the
+                                 * client's own ccd file */
+    time_t mtime;
+    off_t size;
+    char *content;
+    struct gc_arena parsed_gc;  /* owns the pre-tokenized lines below */
+    struct parsed_option_line *lines;
+    int n_lines;
+    uint64_t last_used;         /* ccd_cache_clock at last hit */
+};
+
+static struct ccd_cache_entry *ccd_cache;
+static uint64_t ccd_cache_clock;
+
+static void
+ccd_cache_entry_clear(struct ccd_cache_entry *e)
+{
+    free(e->common_name);
+    free(e->file);
+    free(e->content);
+    gc_free(&e->parsed_gc);
+    CLEAR(*e);
+}
+
+static struct ccd_cache_entry *
+ccd_cache_lookup(const char *common_name)
+{
+    if (!ccd_cache || !common_name)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < CCD_CACHE_SIZE; ++i)
+    {
+        struct ccd_cache_entry *e = &ccd_cache[i];
+        if (e->in_use && strcmp(e->common_name, common_name) == 0)
+        {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void
+ccd_cache_insert(const char *common_name, const char *file, bool is_default,
+                 const platform_stat_t *st, const char *content)
+{
+    if (!ccd_cache)
+    {
+        ALLOC_ARRAY_CLEAR(ccd_cache, struct ccd_cache_entry, CCD_CACHE_SIZE);
+    }
+
+    struct ccd_cache_entry *e = ccd_cache_lookup(common_name);
+    if (!e)
+    {
+        /* reuse a free slot, or evict the least recently used entry */
+        e = &ccd_cache[0];
+        for (int i = 0; i < CCD_CACHE_SIZE; ++i)
+        {
+            struct ccd_cache_entry *c = &ccd_cache[i];
+            if (!c->in_use)
+            {
+                e = c;
+                break;
+            }
+            if (c->last_used < e->last_used)
+            {
+                e = c;
+            }
+        }
+    }
+    ccd_cache_entry_clear(e);
+
+    e->common_name = string_alloc(common_name, NULL);
+    e->file = string_alloc(file, NULL);
+    e->is_default = is_default;
+    e->mtime = st->st_mtime;
+    e->size = st->st_size;
+    e->content = string_alloc(content, NULL);
+
+    /* tokenize once, so cache hits skip the parser as well as the disk */
+    e->parsed_gc = gc_new();
+    e->n_lines = options_parse_string(e->file, e->content, &e->lines,
+                                      D_IMPORT_ERRORS|M_OPTERR,
+                                      &e->parsed_gc);
+
+    e->in_use = true;
+    e->last_used = ++ccd_cache_clock;
+}
+
+static void
+ccd_cache_flush(void)
+{
+    if (!ccd_cache)
+    {
+        return;
+    }
+    for (int i = 0; i < CCD_CACHE_SIZE; ++i)
+    {
+        if (ccd_cache[i].in_use)
+        {
+            ccd_cache_entry_clear(&ccd_cache[i]);
+        }
+    }
+    free(ccd_cache);
+    ccd_cache = NULL;
+}
+
 /**
  * Try to source a dynamic config file from the
  * --client-config-dir directory.
@@ -2508,10 +3366,49 @@ multi_client_connect_source_ccd(struct multi_context *m,
     {
         struct gc_arena gc = gc_new();
         const char *ccd_file = NULL;
+        const char *common_name =
+            tls_common_name(mi->context.c2.tls_multi, false);
+
+        /* reconnect with an unchanged ccd file: apply the cached content */
+        struct ccd_cache_entry *e = ccd_cache_lookup(common_name);
+        if (e)
+        {
+            bool superseded = false;
+            if (e->is_default)
+            {
+                /* the DEFAULT content only applies as long as the client
+                 * has no ccd file of its own; one created since the entry
+                 * was cached must win, as it would on the uncached path */
+                const char *ccd_client =
+                    platform_gen_path(mi->context.options.client_config_dir,
+                                      common_name, &gc);
+                superseded = platform_test_file(ccd_client);
+            }
+            platform_stat_t ccd_stat;
+            if (!superseded
+                && platform_stat(e->file, &ccd_stat) == 0
+                && ccd_stat.st_mtime == e->mtime
+                && ccd_stat.st_size == e->size)
+            {
+                e->last_used = ++ccd_cache_clock;
+                options_import_parsed(&mi->context.options,
+                                      e->lines, e->n_lines,
+                                      e->file,
+                                      D_IMPORT_ERRORS|M_OPTERR,
+                                      CLIENT_CONNECT_OPT_MASK,
+                                      option_types_found,
+                                      mi->context.c2.es);
+                multi_select_virtual_addr(m, mi);
+                multi_client_connect_setenv(m, mi);
+                gc_free(&gc);
+                return CC_RET_SUCCEEDED;
+            }
+            ccd_cache_entry_clear(e);
+        }
 
         const char *ccd_client =
             platform_gen_path(mi->context.options.client_config_dir,
-                              tls_common_name(mi->context.c2.tls_multi, false),
+                              common_name,
                               &gc);
 
         const char *ccd_default =
@@ -2546,6 +3443,19 @@ multi_client_connect_source_ccd(struct multi_context *m,
 
             multi_client_connect_setenv(m, mi);
 
+            /* remember the file content for the next reconnect */
+            platform_stat_t ccd_stat;
+            if (common_name && platform_stat(ccd_file, &ccd_stat) == 0)
+            {
+                struct buffer content = buffer_read_from_file(ccd_file, &gc);
+                if (buf_valid(&content))
+                {
+                    ccd_cache_insert(common_name, ccd_file,
+                                     ccd_file == ccd_default, &ccd_stat,
+                                     BSTR(&content));
+                }
+            }
+
             ret = CC_RET_SUCCEEDED;
         }
         gc_free(&gc);
@@ -2685,7 +3595,7 @@ multi_connection_established(struct multi_context *m, struct multi_instance *mi)
          * did not fail */
         if (mi->context.c2.context_auth == CAS_PENDING_DEFERRED_PARTIAL)
         {
-            multi_client_disconnect_script(mi);
+            multi_client_disconnect_script(m, mi);
         }
 
         mi->context.c2.context_auth = CAS_FAILED;
@@ -2777,7 +3687,8 @@ multi_add_mbuf(struct multi_context *m,
     }
     else
     {
-        msg(D_MULTI_DROPPED, "MULTI: packet dropped due to output saturation (multi_add_mbuf)");
+        ++mi->n_drops_tail;
+        msg_rl(D_MULTI_DROPPED, "MULTI: packet dropped due to output saturation (multi_add_mbuf)");
     }
 }
 
@@ -2793,10 +3704,10 @@ multi_unicast(struct multi_context *m,
 
     if (BLEN(buf) > 0)
     {
-        mb = mbuf_alloc_buf(buf);
+        mb = mbuf_alloc_buf(m->mbuf, buf);
         mb->flags = MF_UNICAST;
         multi_add_mbuf(m, mi, mb);
-        mbuf_free_buf(mb);
+        mbuf_free_buf(m->mbuf, mb);
     }
 }
 
@@ -2810,8 +3721,6 @@ multi_bcast(struct multi_context *m,
             const struct mroute_addr *sender_addr,
             uint16_t vid)
 {
-    struct hash_iterator hi;
-    struct hash_element *he;
     struct multi_instance *mi;
     struct mbuf_buffer *mb;
 
@@ -2821,12 +3730,10 @@ multi_bcast(struct multi_context *m,
 #ifdef MULTI_DEBUG_EVENT_LOOP
         printf("BCAST len=%d\n", BLEN(buf));
 #endif
-        mb = mbuf_alloc_buf(buf);
-        hash_iterator_init(m->iter, &hi);
+        mb = mbuf_alloc_buf(m->mbuf, buf);
 
-        while ((he = hash_iterator_next(&hi)))
+        for (mi = m->active_head; mi; mi = mi->active_next)
         {
-            mi = (struct multi_instance *) he->value;
             if (mi != sender_instance && !mi->halt)
             {
 #ifdef ENABLE_PF
@@ -2866,8 +3773,7 @@ multi_bcast(struct multi_context *m,
             }
         }
 
-        hash_iterator_free(&hi);
-        mbuf_free_buf(mb);
+        mbuf_free_buf(m->mbuf, mb);
         perf_pop();
     }
 }
@@ -2909,7 +3815,7 @@ static void
 multi_schedule_context_wakeup(struct multi_context *m, struct multi_instance *mi)
 {
     /* calculate an absolute wakeup time */
-    ASSERT(!openvpn_gettimeofday(&mi->wakeup, NULL));
+    ASSERT(!openvpn_gettimeofday_coarse(&mi->wakeup));
     tv_add(&mi->wakeup, &mi->context.c2.timeval);
 
     /* tell scheduler to wake us up at some point in the future */
@@ -2945,37 +3851,180 @@ add_inotify_file_watch(struct multi_context *m, struct multi_instance *mi,
 }
 #endif /* if defined(ENABLE_ASYNC_PUSH) */
 
-/*
- * Figure instance-specific timers, convert
- * earliest to absolute time in mi->wakeup,
- * call scheduler with our future wakeup time.
- *
- * Also close context on signal.
- */
-bool
-multi_process_post(struct multi_context *m, struct multi_instance *mi, const unsigned int flags)
+void
+multi_instance_lease_buffers(struct multi_context *m, struct multi_instance *mi)
 {
-    bool ret = true;
+    struct context *c = &mi->context;
 
-    if (!IS_SIG(&mi->context) && ((flags & MPP_PRE_SELECT) || ((flags & MPP_CONDITIONAL_PRE_SELECT) && !ANY_OUT(&mi->context))))
+    if (c->c2.buffers || c->mode != CM_CHILD_TCP)
     {
-#if defined(ENABLE_ASYNC_PUSH)
-        bool was_unauthenticated = true;
-        struct key_state *ks = NULL;
-        if (mi->context.c2.tls_multi)
+        return;
+    }
+
+    /* parked sets are sized for the frame they were created with;
+     * anything too small for this client is retired on the spot */
+    struct context_buffers *b = NULL;
+    while (m->n_buffers_pool > 0)
+    {
+        b = m->buffers_pool[--m->n_buffers_pool];
+        if (b->buf_size >= BUF_SIZE(&c->c2.frame))
         {
-            ks = &mi->context.c2.tls_multi->session[TM_ACTIVE].key[KS_PRIMARY];
-            was_unauthenticated = (ks->authenticated == KS_AUTH_FALSE);
+            break;
         }
-#endif
+        free_context_buffers(b);
+        b = NULL;
+    }
 
-        /* figure timeouts and fetch possible outgoing
-         * to_link packets (such as ping or TLS control) */
-        pre_select(&mi->context);
+    if (b)
+    {
+        context_buffers_setup(b);
+    }
+    else
+    {
+        b = init_context_buffers(&c->c2.frame);
+    }
+    c->c2.buffers = b;
+    c->c2.buffers_owned = true;
+}
 
-#if defined(ENABLE_ASYNC_PUSH)
-        /*
-         * if we see the state transition from unauthenticated to deferred
+void
+multi_instance_release_buffers(struct multi_context *m, struct multi_instance *mi)
+{
+    struct context *c = &mi->context;
+
+    /* pending output still aliases slices of the arena */
+    if (c->mode != CM_CHILD_TCP || !c->c2.buffers
+        || ANY_OUT(c) || mi == m->pending)
+    {
+        return;
+    }
+
+    /* c2.buf may point into the arena; make sure a stale length can
+     * never be mistaken for a packet after the arena changes hands */
+    buf_reset(&c->c2.buf);
+
+    if (m->n_buffers_pool < m->buffers_pool_cap)
+    {
+        m->buffers_pool[m->n_buffers_pool++] = c->c2.buffers;
+    }
+    else
+    {
+        free_context_buffers(c->c2.buffers);
+    }
+    c->c2.buffers = NULL;
+    c->c2.buffers_owned = false;
+}
+
+/*
+ * Queue a post-processing step on the work deque.  Returns false when
+ * the deque is full, in which case the caller must run the step inline.
+ */
+static inline bool
+multi_work_push(struct multi_context *m, const enum multi_work_type type,
+                struct multi_instance *mi)
+{
+    struct multi_work_deque *dq = &m->work;
+
+    if (dq->bottom - dq->top >= dq->capacity)
+    {
+        return false;
+    }
+
+    struct multi_work_item *item = &dq->items[dq->bottom & (dq->capacity - 1)];
+    item->type = type;
+    item->mi = mi;
+    ++dq->bottom;
+    return true;
+}
+
+/*
+ * Execute one work item.  The guarding conditions are re-checked at
+ * execution time rather than at queue time, so items are idempotent
+ * and stay valid if the instance state changed while queued -- a
+ * property the future stolen-by-worker path will rely on.
+ */
+static void
+multi_work_execute(struct multi_context *m, const struct multi_work_item *item)
+{
+    if (!item->mi)
+    {
+        return; /* instance was closed while the item was queued */
+    }
+
+    switch (item->type)
+    {
+        case MW_CONNECTION_ESTABLISHED:
+            if (is_cas_pending(item->mi->context.c2.context_auth)
+                && CONNECTION_ESTABLISHED(&item->mi->context))
+            {
+                multi_connection_established(m, item->mi);
+            }
+            break;
+    }
+}
+
+/*
+ * Run all queued work items on the event thread.  The owner end drains
+ * newest-first, matching the pop order of a work-stealing deque; once
+ * empty the indices are rewound so they never overflow.
+ */
+static void
+multi_work_drain(struct multi_context *m)
+{
+    struct multi_work_deque *dq = &m->work;
+
+    while (dq->bottom != dq->top)
+    {
+        --dq->bottom;
+        multi_work_execute(m, &dq->items[dq->bottom & (dq->capacity - 1)]);
+    }
+    dq->bottom = 0;
+    dq->top = 0;
+}
+
+/*
+ * Figure instance-specific timers, convert
+ * earliest to absolute time in mi->wakeup,
+ * call scheduler with our future wakeup time.
+ *
+ * Also close context on signal.
+ */
+bool
+multi_process_post(struct multi_context *m, struct multi_instance *mi, const unsigned int flags)
+{
+    bool ret = true;
+
+    if (!IS_SIG(&mi->context) && ((flags & MPP_PRE_SELECT) || ((flags & MPP_CONDITIONAL_PRE_SELECT) && !ANY_OUT(&mi->context))))
+    {
+#if defined(ENABLE_ASYNC_PUSH)
+        bool was_unauthenticated = true;
+        struct key_state *ks = NULL;
+        if (mi->context.c2.tls_multi)
+        {
+            ks = &mi->context.c2.tls_multi->session[TM_ACTIVE].key[KS_PRIMARY];
+            was_unauthenticated = (ks->authenticated == KS_AUTH_FALSE);
+        }
+#endif
+
+        /* pre_select may emit ping/OCC/TLS output into the frame buffers */
+        multi_instance_lease_buffers(m, mi);
+
+#ifdef ENABLE_WORKER_THREADS
+        /* TLS housekeeping below may rotate or free data channel keys;
+         * wait until no worker still decrypts under them */
+        if (m->worker_pool && mi->n_worker_jobs > 0)
+        {
+            multi_worker_drain_instance(m->worker_pool, mi);
+        }
+#endif
+
+        /* figure timeouts and fetch possible outgoing
+         * to_link packets (such as ping or TLS control) */
+        pre_select(&mi->context);
+
+#if defined(ENABLE_ASYNC_PUSH)
+        /*
+         * if we see the state transition from unauthenticated to deferred
          * and an auth_control_file, we assume it got just added and add
          * inotify watch to that file
          */
@@ -2994,8 +4043,16 @@ multi_process_post(struct multi_context *m, struct multi_instance *mi, const uns
             if (is_cas_pending(mi->context.c2.context_auth)
                 && CONNECTION_ESTABLISHED(&mi->context))
             {
-                multi_connection_established(m, mi);
+                if (!multi_work_push(m, MW_CONNECTION_ESTABLISHED, mi))
+                {
+                    multi_connection_established(m, mi);
+                }
             }
+
+            /* run queued post-processing; still on the event thread, so
+             * the effects land before the checks below, as they did when
+             * the steps ran inline */
+            multi_work_drain(m);
 #if defined(ENABLE_ASYNC_PUSH)
             if (is_cas_pending(mi->context.c2.context_auth)
                 && mi->client_connect_defer_state.deferred_ret_file)
@@ -3023,6 +4080,28 @@ multi_process_post(struct multi_context *m, struct multi_instance *mi, const uns
         /* continue to pend on output? */
         multi_set_pending(m, ANY_OUT(&mi->context) ? mi : NULL);
 
+        /* idle again -- park the frame buffers for the next active client */
+        multi_instance_release_buffers(m, mi);
+
+#ifdef ENABLE_MEMSTATS
+        /* refresh this instance's record in the shared stats segment */
+        if (mi->mstats_slot >= 0)
+        {
+            mstats_instance_update(mi->mstats_slot,
+#ifdef ENABLE_MANAGEMENT
+                                   mi->context.c2.mda_context.cid,
+#else
+                                   0,
+#endif
+                                   tls_common_name(mi->context.c2.tls_multi, false),
+                                   mi->context.options.ciphername,
+                                   mi->context.c2.link_read_bytes,
+                                   mi->context.c2.link_write_bytes,
+                                   mi->context.c2.tun_read_bytes,
+                                   mi->context.c2.tun_write_bytes);
+        }
+#endif
+
 #ifdef MULTI_DEBUG_EVENT_LOOP
         printf("POST %s[%d] to=%d lo=%d/%d w=%" PRIi64 "/%ld\n",
                id(mi),
@@ -3070,49 +4149,661 @@ multi_process_float(struct multi_context *m, struct multi_instance *mi)
         /* do not float if target address is taken by client with another cert */
         if (!cert_hash_compare(m1->locked_cert_hash_set, m2->locked_cert_hash_set))
         {
-            msg(D_MULTI_LOW, "Disallow float to an address taken by another client %s",
+            msg_rl(D_MULTI_LOW, "Disallow float to an address taken by another client %s",
                 multi_instance_string(ex_mi, false, &gc));
 
             mi->context.c2.buf.len = 0;
 
             goto done;
         }
-
-        msg(D_MULTI_MEDIUM, "closing instance %s", multi_instance_string(ex_mi, false, &gc));
-        multi_close_instance(m, ex_mi, false);
+
+        msg(D_MULTI_MEDIUM, "closing instance %s", multi_instance_string(ex_mi, false, &gc));
+        multi_close_instance(m, ex_mi, false);
+    }
+
+    msg(D_MULTI_MEDIUM, "peer %" PRIu32 " (%s) floated from %s to %s",
+        mi->context.c2.tls_multi->peer_id,
+        tls_common_name(mi->context.c2.tls_multi, false),
+        mi->real_print,
+        print_link_socket_actual(&m->top.c2.from, &gc));
+
+    /* remove old address from hash table and flow cache before changing address */
+    multi_flow_cache_purge(m, mi);
+    ASSERT(hash_remove(m->hash, &mi->real));
+
+    /* change external network address of the remote peer */
+    mi->real = real;
+    generate_prefix(mi);
+
+    mi->context.c2.from = m->top.c2.from;
+    mi->context.c2.to_link_addr = &mi->context.c2.from;
+
+    /* inherit parent link_socket and link_socket_info */
+    mi->context.c2.link_socket = m->top.c2.link_socket;
+    mi->context.c2.link_socket_info->lsa->actual = m->top.c2.from;
+
+    tls_update_remote_addr(mi->context.c2.tls_multi, &mi->context.c2.from);
+
+    ASSERT(hash_add(m->hash, &mi->real, mi, false));
+
+#ifdef ENABLE_MANAGEMENT
+    ASSERT(hash_add(m->cid_hash, &mi->context.c2.mda_context.cid, mi, true));
+#endif
+
+done:
+    gc_free(&gc);
+}
+
+#ifndef _WIN32
+
+bool
+multi_migrate_export(struct multi_context *m, uint32_t peer_id,
+                     uint32_t key_id, bool commit,
+                     struct migrate_client_state *state)
+{
+    state->found = 0;
+    if (peer_id >= (uint32_t)m->max_clients || !m->instances[peer_id])
+    {
+        return false;
+    }
+
+    struct multi_instance *mi = m->instances[peer_id];
+    struct tls_multi *tm = mi->context.c2.tls_multi;
+    struct key_state *ks = &tm->session[TM_ACTIVE].key[KS_PRIMARY];
+
+    if (ks->state < S_ACTIVE || ks->authenticated != KS_AUTH_TRUE
+        || ks->key_id != (int)key_id || !ks->migrate_key2
+        || !ks->crypto_options.key_ctx_bi.initialized)
+    {
+        return false;
+    }
+
+    state->key_id = key_id;
+    strncpynt(state->ciphername, mi->context.options.ciphername,
+              sizeof(state->ciphername));
+    strncpynt(state->authname, mi->context.options.authname,
+              sizeof(state->authname));
+    const char *cn = tls_common_name(tm, true);
+    if (cn)
+    {
+        strncpynt(state->common_name, cn, sizeof(state->common_name));
+    }
+    state->key2 = *ks->migrate_key2;
+    state->crypto_flags = ks->crypto_options.flags;
+    state->send_id = ks->crypto_options.packet_id.send.id;
+    state->send_time = ks->crypto_options.packet_id.send.time;
+    state->rec_id = ks->crypto_options.packet_id.rec.id;
+    state->rec_time = ks->crypto_options.packet_id.rec.time;
+    state->found = 1;
+
+    /* only a commit -- sent after the sibling authenticated the
+     * client's packet with these keys -- transfers ownership; a plain
+     * query must not let a spoofed header kill a live session */
+    if (commit)
+    {
+        msg(D_MULTI_MEDIUM,
+            "MIGRATE: handing peer %" PRIu32 " (%s) over to a sibling process",
+            peer_id, tls_common_name(tm, false));
+        multi_close_instance(m, mi, false);
+    }
+    return true;
+}
+
+/*
+ * Build a local instance around data channel state migrated in from a
+ * sibling process.  The control channel (TLS) state cannot leave the
+ * process owning its SSL objects, so the instance starts with a fresh,
+ * idle TLS session; the client's next renegotiation re-establishes it
+ * through the normal soft reset path.
+ */
+static struct multi_instance *
+multi_migrate_import(struct multi_context *m, const struct mroute_addr *real,
+                     uint32_t peer_id, const struct migrate_client_state *st)
+{
+    struct multi_instance *mi = multi_create_instance(m, real);
+    if (!mi)
+    {
+        return NULL;
+    }
+
+    ASSERT(hash_add(m->hash, &mi->real, mi, false));
+    mi->did_real_hash = true;
+
+    /* the client keeps addressing us with the peer-id assigned by the
+     * exporting process, so the instance must live in the same slot */
+    struct tls_multi *tm = mi->context.c2.tls_multi;
+    tm->peer_id = peer_id;
+    tm->use_peer_id = true;
+    m->instances[peer_id] = mi;
+
+    struct tls_session *session = &tm->session[TM_ACTIVE];
+    struct key_state *ks = &session->key[KS_PRIMARY];
+
+    /* negotiated data channel parameters travel with the client */
+    mi->context.options.ciphername =
+        string_alloc(st->ciphername, &mi->context.options.gc);
+    mi->context.options.authname =
+        string_alloc(st->authname, &mi->context.options.gc);
+
+    struct key_type kt;
+    init_key_type(&kt, st->ciphername, st->authname,
+                  mi->context.options.keysize, true, false);
+
+    struct key2 key2 = st->key2;
+    init_key_contexts(&ks->crypto_options.key_ctx_bi, &kt, true, &key2,
+                      (st->crypto_flags & CO_PACKET_ID_64));
+
+    /* keep our own migratable copy for a possible next hand-over */
+    if (session->opt->migrate)
+    {
+        ALLOC_OBJ(ks->migrate_key2, struct key2);
+        *ks->migrate_key2 = key2;
+    }
+    secure_memzero(&key2, sizeof(key2));
+
+    /* restore the data channel packet-id state; the packet-id format is
+     * a property of the migrated keys, not of the fresh session */
+    ks->crypto_options.flags = session->opt->crypto_flags;
+    ks->crypto_options.flags |= (st->crypto_flags & CO_PACKET_ID_64);
+    ks->crypto_options.packet_id.send.id = st->send_id;
+    ks->crypto_options.packet_id.send.time = st->send_time;
+    ks->crypto_options.packet_id.rec.id = st->rec_id;
+    ks->crypto_options.packet_id.rec.time = st->rec_time;
+
+    /* present the key as an established, authenticated session */
+    ks->key_id = st->key_id;
+    session->key_id = st->key_id;
+    ks->state = S_ACTIVE;
+    ks->authenticated = KS_AUTH_TRUE;
+    ks->established = now;
+    ks->remote_addr = m->top.c2.from;
+
+    if (st->common_name[0])
+    {
+        string_intern_release(session->common_name);
+        session->common_name = string_intern(st->common_name);
+    }
+    generate_prefix(mi);
+
+    return mi;
+}
+
+/*
+ * Authenticate the data packet in m->top.c2.buf against migrated key
+ * material before the hand-over is committed.  The migration trigger is
+ * a raw P_DATA_V2 header, which anyone can spoof; only a packet that
+ * decrypts and authenticates under the exported keys proves the sender
+ * holds the session.  Works on throwaway copies of the packet and the
+ * replay state, so nothing is consumed -- the real decrypt runs through
+ * the regular processing path once the instance exists.
+ */
+static bool
+multi_migrate_verify_packet(struct multi_context *m,
+                            const struct migrate_client_state *st)
+{
+    struct context *c = &m->top;
+    struct crypto_options co;
+    struct key_type kt;
+    struct key2 key2 = st->key2;
+    bool ret = false;
+
+    CLEAR(co);
+    init_key_type(&kt, st->ciphername, st->authname, c->options.keysize,
+                  true, false);
+    init_key_contexts(&co.key_ctx_bi, &kt, true, &key2,
+                      (st->crypto_flags & CO_PACKET_ID_64));
+    secure_memzero(&key2, sizeof(key2));
+
+    packet_id_init(&co.packet_id, c->options.replay_window,
+                   c->options.replay_time, "MIGRATE", 0);
+    co.packet_id.rec.id = st->rec_id;
+    co.packet_id.rec.time = st->rec_time;
+    co.flags = st->crypto_flags | CO_MUTE_REPLAY_WARNINGS;
+
+    struct buffer pkt = clone_buf(&c->c2.buf);
+    struct buffer work = alloc_buf(BUF_SIZE(&c->c2.frame));
+    const uint8_t *ad_start = BPTR(&pkt);
+    if (buf_advance(&pkt, 4))   /* opcode/key-id byte + peer-id */
+    {
+        ret = openvpn_decrypt(&pkt, work, &co, &c->c2.frame, ad_start);
+    }
+
+    free_buf(&pkt);
+    free_buf(&work);
+    free_key_ctx_bi(&co.key_ctx_bi);
+    packet_id_free(&co.packet_id);
+    return ret;
+}
+
+struct multi_instance *
+multi_migrate_get(struct multi_context *m, const struct mroute_addr *real,
+                  uint32_t peer_id, uint32_t key_id)
+{
+    struct multi_instance *mi = NULL;
+    struct migrate_client_state state;
+    char owner[PATH_MAX];
+
+    /* the peer-id slot must be free here, since the client keeps using
+     * the id the exporting process assigned */
+    if (peer_id >= (uint32_t)m->max_clients || m->instances[peer_id])
+    {
+        return NULL;
+    }
+    if (!migrate_channel_query_allowed(&m->migrate, now))
+    {
+        return NULL;
+    }
+
+    if (migrate_channel_query(&m->migrate, peer_id, key_id, &state,
+                              owner, sizeof(owner)))
+    {
+        if (!multi_migrate_verify_packet(m, &state))
+        {
+            /* spoofed or stale trigger; the owning sibling keeps the
+             * session, so the client is unaffected */
+            msg(D_MULTI_MEDIUM,
+                "MIGRATE: packet for peer %" PRIu32 " failed authentication"
+                " against the exported keys -- hand-over aborted", peer_id);
+        }
+        else if (migrate_channel_commit(&m->migrate, owner, peer_id, key_id))
+        {
+            mi = multi_migrate_import(m, real, peer_id, &state);
+            if (mi)
+            {
+                msg(D_MULTI_MEDIUM,
+                    "MIGRATE: peer %" PRIu32 " (%s) migrated in from a sibling process, key_id=%" PRIu32,
+                    peer_id, tls_common_name(mi->context.c2.tls_multi, false),
+                    key_id);
+            }
+        }
+    }
+    secure_memzero(&state, sizeof(state));
+    return mi;
+}
+
+/*
+ * --persist-state: graceful-restart support.  On shutdown the server
+ * serializes every established client's migratable data channel state
+ * -- the same record --float-migration exchanges between sibling
+ * processes -- plus the client's transport address and peer-id to a
+ * file; on startup the records are turned back into instances, so data
+ * flow resumes without forcing all clients into a simultaneous
+ * renegotiation.  Control channel (TLS) state cannot be serialized and
+ * is re-established lazily by each client's next renegotiation.
+ */
+
+#define PERSIST_STATE_MAGIC   0x4f565053 /* "OVPS" */
+#define PERSIST_STATE_VERSION MIGRATE_VERSION
+
+struct persist_state_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t n_clients;
+};
+
+struct persist_state_entry
+{
+    uint32_t peer_id;
+    struct openvpn_sockaddr real;       /* client's transport address */
+    struct migrate_client_state state;
+};
+
+void
+multi_persist_state_save(struct multi_context *m)
+{
+    const char *file = m->top.options.persist_state_file;
+    struct persist_state_header hdr = { PERSIST_STATE_MAGIC,
+                                        PERSIST_STATE_VERSION, 0 };
+    struct persist_state_entry e;
+
+    if (!file || !m->instances)
+    {
+        return;
+    }
+
+    int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        msg(M_WARN | M_ERRNO, "PERSIST-STATE: cannot write %s", file);
+        return;
+    }
+
+    /* placeholder header, rewritten with the final count below */
+    if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+    {
+        goto err;
+    }
+
+    for (int i = 0; i < m->max_clients; ++i)
+    {
+        struct multi_instance *mi = m->instances[i];
+        if (!mi || mi->halt || !mi->context.c2.tls_multi)
+        {
+            continue;
+        }
+        struct tls_multi *tm = mi->context.c2.tls_multi;
+        struct key_state *ks = &tm->session[TM_ACTIVE].key[KS_PRIMARY];
+        if (ks->state < S_ACTIVE || ks->authenticated != KS_AUTH_TRUE
+            || !ks->migrate_key2 || !ks->crypto_options.key_ctx_bi.initialized)
+        {
+            continue;
+        }
+
+        CLEAR(e);
+        e.peer_id = (uint32_t)i;
+        e.real = mi->context.c2.from.dest;
+        e.state.magic = MIGRATE_MAGIC;
+        e.state.version = MIGRATE_VERSION;
+        e.state.found = 1;
+        e.state.key_id = (uint32_t)ks->key_id;
+        strncpynt(e.state.ciphername, mi->context.options.ciphername,
+                  sizeof(e.state.ciphername));
+        strncpynt(e.state.authname, mi->context.options.authname,
+                  sizeof(e.state.authname));
+        const char *cn = tls_common_name(tm, true);
+        if (cn)
+        {
+            strncpynt(e.state.common_name, cn, sizeof(e.state.common_name));
+        }
+        e.state.key2 = *ks->migrate_key2;
+        e.state.crypto_flags = ks->crypto_options.flags;
+        e.state.send_id = ks->crypto_options.packet_id.send.id;
+        e.state.send_time = ks->crypto_options.packet_id.send.time;
+        e.state.rec_id = ks->crypto_options.packet_id.rec.id;
+        e.state.rec_time = ks->crypto_options.packet_id.rec.time;
+
+        if (write(fd, &e, sizeof(e)) != sizeof(e))
+        {
+            goto err;
+        }
+        ++hdr.n_clients;
+    }
+
+    if (lseek(fd, 0, SEEK_SET) != 0
+        || write(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+    {
+        goto err;
+    }
+
+    secure_memzero(&e, sizeof(e));
+    close(fd);
+    msg(M_INFO, "PERSIST-STATE: saved %" PRIu32 " client session(s) to %s",
+        hdr.n_clients, file);
+    return;
+
+err:
+    msg(M_WARN | M_ERRNO, "PERSIST-STATE: error writing %s", file);
+    secure_memzero(&e, sizeof(e));
+    close(fd);
+    platform_unlink(file);
+}
+
+void
+multi_persist_state_restore(struct multi_context *m)
+{
+    const char *file = m->top.options.persist_state_file;
+    struct persist_state_header hdr;
+    struct persist_state_entry e;
+    uint32_t n_restored = 0;
+
+    if (!file)
+    {
+        return;
+    }
+
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+    {
+        if (errno != ENOENT)
+        {
+            msg(M_WARN | M_ERRNO, "PERSIST-STATE: cannot read %s", file);
+        }
+        return;
+    }
+
+    if (read(fd, &hdr, sizeof(hdr)) != sizeof(hdr)
+        || hdr.magic != PERSIST_STATE_MAGIC
+        || hdr.version != PERSIST_STATE_VERSION)
+    {
+        msg(M_WARN, "PERSIST-STATE: %s is not a compatible state file, ignored",
+            file);
+        goto done;
+    }
+
+    for (uint32_t i = 0; i < hdr.n_clients; ++i)
+    {
+        if (read(fd, &e, sizeof(e)) != sizeof(e))
+        {
+            msg(M_WARN, "PERSIST-STATE: %s is truncated", file);
+            break;
+        }
+        if (!e.state.found || e.state.magic != MIGRATE_MAGIC
+            || e.peer_id >= (uint32_t)m->max_clients
+            || m->instances[e.peer_id])
+        {
+            continue;
+        }
+
+        struct mroute_addr real;
+        if (!mroute_extract_openvpn_sockaddr(&real, &e.real, true))
+        {
+            continue;
+        }
+
+        /* multi_migrate_import picks the client's address up from the
+         * top context, as it does on the normal packet-driven path */
+        CLEAR(m->top.c2.from);
+        m->top.c2.from.dest = e.real;
+
+        if (multi_migrate_import(m, &real, e.peer_id, &e.state))
+        {
+            ++n_restored;
+        }
+    }
+
+    msg(M_INFO, "PERSIST-STATE: restored %" PRIu32 " of %" PRIu32
+        " client session(s) from %s", n_restored, hdr.n_clients, file);
+
+done:
+    secure_memzero(&e, sizeof(e));
+    CLEAR(m->top.c2.from);
+    close(fd);
+    /* records are single use: the keys must never be replayed into a
+     * second process lifetime once clients have moved past them */
+    platform_unlink(file);
+}
+
+#endif /* ifndef _WIN32 */
+
+/*
+ * Route a decrypted packet received from a client to its destination:
+ * the tun/tap device, a broadcast/multicast group, or another client.
+ * Expects the decrypted packet in c->c2.to_tun and m->pending set to
+ * the instance the packet was received from.
+ */
+static void
+multi_process_incoming_link_route(struct multi_context *m, struct context *c)
+{
+    struct gc_arena gc = gc_new();
+    struct mroute_addr src, dest;
+    unsigned int mroute_flags;
+    struct multi_instance *mi;
+
+    if (TUNNEL_TYPE(m->top.c1.tuntap) == DEV_TYPE_TUN)
+    {
+        /* extract packet source and dest addresses */
+        mroute_flags = mroute_extract_addr_from_packet(&src,
+                                                       &dest,
+                                                       NULL,
+                                                       NULL,
+                                                       0,
+                                                       &c->c2.to_tun,
+                                                       DEV_TYPE_TUN);
+
+        /* drop packet if extract failed */
+        if (!(mroute_flags & MROUTE_EXTRACT_SUCCEEDED))
+        {
+            c->c2.to_tun.len = 0;
+        }
+        /* make sure that source address is associated with this client */
+        else if (multi_get_instance_by_virtual_addr(m, &src, true) != m->pending)
+        {
+            /* IPv6 link-local address (fe80::xxx)? */
+            if ( (src.type & MR_ADDR_MASK) == MR_ADDR_IPV6
+                 && IN6_IS_ADDR_LINKLOCAL(&src.v6.addr) )
+            {
+                /* do nothing, for now.  TODO: add address learning */
+            }
+            else
+            {
+                msg_rl(D_MULTI_DROPPED, "MULTI: bad source address from client [%s], packet dropped",
+                    mroute_addr_print(&src, &gc));
+            }
+            c->c2.to_tun.len = 0;
+        }
+        /* client-to-client communication enabled? */
+        else if (m->enable_c2c)
+        {
+            /* multicast? */
+            if (mroute_flags & MROUTE_EXTRACT_MCAST)
+            {
+                /* for now, treat multicast as broadcast */
+                multi_bcast(m, &c->c2.to_tun, m->pending, NULL, 0);
+            }
+            else /* possible client to client routing */
+            {
+                ASSERT(!(mroute_flags & MROUTE_EXTRACT_BCAST));
+                mi = multi_get_instance_by_virtual_addr(m, &dest, true);
+
+                /* if dest addr is a known client, route to it */
+                if (mi)
+                {
+#ifdef ENABLE_PF
+                    if (!pf_c2c_test(&c->c2.pf, c->c2.tls_multi,
+                                     &mi->context.c2.pf,
+                                     mi->context.c2.tls_multi,
+                                     "tun_c2c"))
+                    {
+                        msg(D_PF_DROPPED, "PF: client -> client[%s] packet dropped by TUN packet filter",
+                            mi_prefix(mi));
+                    }
+                    else
+#endif
+                    {
+                        multi_unicast(m, &c->c2.to_tun, mi);
+                        register_activity(c, BLEN(&c->c2.to_tun));
+                    }
+                    c->c2.to_tun.len = 0;
+                }
+            }
+        }
+#ifdef ENABLE_PF
+        if (c->c2.to_tun.len && !pf_addr_test(&c->c2.pf, c, &dest,
+                                              "tun_dest_addr"))
+        {
+            msg(D_PF_DROPPED, "PF: client -> addr[%s] packet dropped by TUN packet filter",
+                mroute_addr_print_ex(&dest, MAPF_SHOW_ARP, &gc));
+            c->c2.to_tun.len = 0;
+        }
+#endif
     }
+    else if (TUNNEL_TYPE(m->top.c1.tuntap) == DEV_TYPE_TAP)
+    {
+        uint16_t vid = 0;
+#ifdef ENABLE_PF
+        struct mroute_addr edest;
+        mroute_addr_reset(&edest);
+#endif
 
-    msg(D_MULTI_MEDIUM, "peer %" PRIu32 " (%s) floated from %s to %s",
-        mi->context.c2.tls_multi->peer_id,
-        tls_common_name(mi->context.c2.tls_multi, false),
-        mroute_addr_print(&mi->real, &gc),
-        print_link_socket_actual(&m->top.c2.from, &gc));
-
-    /* remove old address from hash table before changing address */
-    ASSERT(hash_remove(m->hash, &mi->real));
-    ASSERT(hash_remove(m->iter, &mi->real));
-
-    /* change external network address of the remote peer */
-    mi->real = real;
-    generate_prefix(mi);
-
-    mi->context.c2.from = m->top.c2.from;
-    mi->context.c2.to_link_addr = &mi->context.c2.from;
-
-    /* inherit parent link_socket and link_socket_info */
-    mi->context.c2.link_socket = m->top.c2.link_socket;
-    mi->context.c2.link_socket_info->lsa->actual = m->top.c2.from;
-
-    tls_update_remote_addr(mi->context.c2.tls_multi, &mi->context.c2.from);
+        if (m->top.options.vlan_tagging)
+        {
+            if (vlan_is_tagged(&c->c2.to_tun))
+            {
+                /* Drop VLAN-tagged frame. */
+                msg(D_VLAN_DEBUG, "dropping incoming VLAN-tagged frame");
+                c->c2.to_tun.len = 0;
+            }
+            else
+            {
+                vid = c->options.vlan_pvid;
+            }
+        }
+        /* extract packet source and dest addresses */
+        mroute_flags = mroute_extract_addr_from_packet(&src,
+                                                       &dest,
+                                                       NULL,
+#ifdef ENABLE_PF
+                                                       &edest,
+#else
+                                                       NULL,
+#endif
+                                                       vid,
+                                                       &c->c2.to_tun,
+                                                       DEV_TYPE_TAP);
 
-    ASSERT(hash_add(m->hash, &mi->real, mi, false));
-    ASSERT(hash_add(m->iter, &mi->real, mi, false));
+        if (mroute_flags & MROUTE_EXTRACT_SUCCEEDED)
+        {
+            if (multi_learn_addr(m, m->pending, &src, 0) == m->pending)
+            {
+                /* check for broadcast */
+                if (m->enable_c2c)
+                {
+                    if (mroute_flags & (MROUTE_EXTRACT_BCAST|MROUTE_EXTRACT_MCAST))
+                    {
+                        multi_bcast(m, &c->c2.to_tun, m->pending, NULL,
+                                    vid);
+                    }
+                    else /* try client-to-client routing */
+                    {
+                        mi = multi_get_instance_by_virtual_addr(m, &dest, false);
 
-#ifdef ENABLE_MANAGEMENT
-    ASSERT(hash_add(m->cid_hash, &mi->context.c2.mda_context.cid, mi, true));
+                        /* if dest addr is a known client, route to it */
+                        if (mi)
+                        {
+#ifdef ENABLE_PF
+                            if (!pf_c2c_test(&c->c2.pf, c->c2.tls_multi,
+                                             &mi->context.c2.pf,
+                                             mi->context.c2.tls_multi,
+                                             "tap_c2c"))
+                            {
+                                msg(D_PF_DROPPED, "PF: client -> client[%s] packet dropped by TAP packet filter",
+                                    mi_prefix(mi));
+                            }
+                            else
 #endif
+                            {
+                                multi_unicast(m, &c->c2.to_tun, mi);
+                                register_activity(c, BLEN(&c->c2.to_tun));
+                            }
+                            c->c2.to_tun.len = 0;
+                        }
+                    }
+                }
+#ifdef ENABLE_PF
+                if (c->c2.to_tun.len && !pf_addr_test(&c->c2.pf, c,
+                                                      &edest,
+                                                      "tap_dest_addr"))
+                {
+                    msg(D_PF_DROPPED, "PF: client -> addr[%s] packet dropped by TAP packet filter",
+                        mroute_addr_print_ex(&edest, MAPF_SHOW_ARP, &gc));
+                    c->c2.to_tun.len = 0;
+                }
+#endif
+            }
+            else
+            {
+                msg_rl(D_MULTI_DROPPED, "MULTI: bad source address from client [%s], packet dropped",
+                    mroute_addr_print(&src, &gc));
+                c->c2.to_tun.len = 0;
+            }
+        }
+        else
+        {
+            c->c2.to_tun.len = 0;
+        }
+    }
 
-done:
     gc_free(&gc);
 }
 
@@ -3126,9 +4817,6 @@ multi_process_incoming_link(struct multi_context *m, struct multi_instance *inst
     struct gc_arena gc = gc_new();
 
     struct context *c;
-    struct mroute_addr src, dest;
-    unsigned int mroute_flags;
-    struct multi_instance *mi;
     bool ret = true;
     bool floated = false;
 
@@ -3173,8 +4861,23 @@ multi_process_incoming_link(struct multi_context *m, struct multi_instance *inst
             struct link_socket_info *lsi;
             const uint8_t *orig_buf;
 
+#ifdef ENABLE_WORKER_THREADS
+            if (m->worker_pool && !instance
+                && multi_worker_dispatch(m->worker_pool, m->pending, floated))
+            {
+                /* the worker pool owns a copy of the packet now; routing
+                 * and postprocessing happen on the main thread once the
+                 * decrypted packet comes back through the completion pipe */
+                clear_prefix();
+                multi_set_pending(m, NULL);
+                gc_free(&gc);
+                return true;
+            }
+#endif
+
             /* decrypt in instance context */
 
+            OPENVPN_PROBE2(multi_link_process_start, m->pending, BLEN(&c->c2.buf));
             perf_push(PERF_PROC_IN_LINK);
             lsi = get_link_socket_info(c);
             orig_buf = c->c2.buf.data;
@@ -3189,191 +4892,69 @@ multi_process_incoming_link(struct multi_context *m, struct multi_instance *inst
                 process_incoming_link_part2(c, lsi, orig_buf);
             }
             perf_pop();
+            OPENVPN_PROBE2(multi_link_process_done, m->pending, BLEN(&c->c2.to_tun));
 
-            if (TUNNEL_TYPE(m->top.c1.tuntap) == DEV_TYPE_TUN)
-            {
-                /* extract packet source and dest addresses */
-                mroute_flags = mroute_extract_addr_from_packet(&src,
-                                                               &dest,
-                                                               NULL,
-                                                               NULL,
-                                                               0,
-                                                               &c->c2.to_tun,
-                                                               DEV_TYPE_TUN);
+            multi_process_incoming_link_route(m, c);
+        }
 
-                /* drop packet if extract failed */
-                if (!(mroute_flags & MROUTE_EXTRACT_SUCCEEDED))
-                {
-                    c->c2.to_tun.len = 0;
-                }
-                /* make sure that source address is associated with this client */
-                else if (multi_get_instance_by_virtual_addr(m, &src, true) != m->pending)
-                {
-                    /* IPv6 link-local address (fe80::xxx)? */
-                    if ( (src.type & MR_ADDR_MASK) == MR_ADDR_IPV6
-                         && IN6_IS_ADDR_LINKLOCAL(&src.v6.addr) )
-                    {
-                        /* do nothing, for now.  TODO: add address learning */
-                    }
-                    else
-                    {
-                        msg(D_MULTI_DROPPED, "MULTI: bad source address from client [%s], packet dropped",
-                            mroute_addr_print(&src, &gc));
-                    }
-                    c->c2.to_tun.len = 0;
-                }
-                /* client-to-client communication enabled? */
-                else if (m->enable_c2c)
-                {
-                    /* multicast? */
-                    if (mroute_flags & MROUTE_EXTRACT_MCAST)
-                    {
-                        /* for now, treat multicast as broadcast */
-                        multi_bcast(m, &c->c2.to_tun, m->pending, NULL, 0);
-                    }
-                    else /* possible client to client routing */
-                    {
-                        ASSERT(!(mroute_flags & MROUTE_EXTRACT_BCAST));
-                        mi = multi_get_instance_by_virtual_addr(m, &dest, true);
+        /* postprocess and set wakeup */
+        ret = multi_process_post(m, m->pending, mpp_flags);
 
-                        /* if dest addr is a known client, route to it */
-                        if (mi)
-                        {
-#ifdef ENABLE_PF
-                            if (!pf_c2c_test(&c->c2.pf, c->c2.tls_multi,
-                                             &mi->context.c2.pf,
-                                             mi->context.c2.tls_multi,
-                                             "tun_c2c"))
-                            {
-                                msg(D_PF_DROPPED, "PF: client -> client[%s] packet dropped by TUN packet filter",
-                                    mi_prefix(mi));
-                            }
-                            else
-#endif
-                            {
-                                multi_unicast(m, &c->c2.to_tun, mi);
-                                register_activity(c, BLEN(&c->c2.to_tun));
-                            }
-                            c->c2.to_tun.len = 0;
-                        }
-                    }
-                }
-#ifdef ENABLE_PF
-                if (c->c2.to_tun.len && !pf_addr_test(&c->c2.pf, c, &dest,
-                                                      "tun_dest_addr"))
-                {
-                    msg(D_PF_DROPPED, "PF: client -> addr[%s] packet dropped by TUN packet filter",
-                        mroute_addr_print_ex(&dest, MAPF_SHOW_ARP, &gc));
-                    c->c2.to_tun.len = 0;
-                }
-#endif
-            }
-            else if (TUNNEL_TYPE(m->top.c1.tuntap) == DEV_TYPE_TAP)
-            {
-                uint16_t vid = 0;
-#ifdef ENABLE_PF
-                struct mroute_addr edest;
-                mroute_addr_reset(&edest);
-#endif
+        clear_prefix();
+    }
 
-                if (m->top.options.vlan_tagging)
-                {
-                    if (vlan_is_tagged(&c->c2.to_tun))
-                    {
-                        /* Drop VLAN-tagged frame. */
-                        msg(D_VLAN_DEBUG, "dropping incoming VLAN-tagged frame");
-                        c->c2.to_tun.len = 0;
-                    }
-                    else
-                    {
-                        vid = c->options.vlan_pvid;
-                    }
-                }
-                /* extract packet source and dest addresses */
-                mroute_flags = mroute_extract_addr_from_packet(&src,
-                                                               &dest,
-                                                               NULL,
-#ifdef ENABLE_PF
-                                                               &edest,
-#else
-                                                               NULL,
-#endif
-                                                               vid,
-                                                               &c->c2.to_tun,
-                                                               DEV_TYPE_TAP);
+    gc_free(&gc);
+    return ret;
+}
 
-                if (mroute_flags & MROUTE_EXTRACT_SUCCEEDED)
-                {
-                    if (multi_learn_addr(m, m->pending, &src, 0) == m->pending)
-                    {
-                        /* check for broadcast */
-                        if (m->enable_c2c)
-                        {
-                            if (mroute_flags & (MROUTE_EXTRACT_BCAST|MROUTE_EXTRACT_MCAST))
-                            {
-                                multi_bcast(m, &c->c2.to_tun, m->pending, NULL,
-                                            vid);
-                            }
-                            else /* try client-to-client routing */
-                            {
-                                mi = multi_get_instance_by_virtual_addr(m, &dest, false);
+#ifdef ENABLE_WORKER_THREADS
+/*
+ * Finish processing of packets whose decrypt stage ran on a worker
+ * thread.  This is the second half of multi_process_incoming_link()
+ * and always runs on the main thread.
+ */
+bool
+multi_process_worker_completions(struct multi_context *m, const unsigned int mpp_flags)
+{
+    struct multi_worker_job *job;
+    bool ret = true;
 
-                                /* if dest addr is a known client, route to it */
-                                if (mi)
-                                {
-#ifdef ENABLE_PF
-                                    if (!pf_c2c_test(&c->c2.pf, c->c2.tls_multi,
-                                                     &mi->context.c2.pf,
-                                                     mi->context.c2.tls_multi,
-                                                     "tap_c2c"))
-                                    {
-                                        msg(D_PF_DROPPED, "PF: client -> client[%s] packet dropped by TAP packet filter",
-                                            mi_prefix(mi));
-                                    }
-                                    else
-#endif
-                                    {
-                                        multi_unicast(m, &c->c2.to_tun, mi);
-                                        register_activity(c, BLEN(&c->c2.to_tun));
-                                    }
-                                    c->c2.to_tun.len = 0;
-                                }
-                            }
-                        }
-#ifdef ENABLE_PF
-                        if (c->c2.to_tun.len && !pf_addr_test(&c->c2.pf, c,
-                                                              &edest,
-                                                              "tap_dest_addr"))
-                        {
-                            msg(D_PF_DROPPED, "PF: client -> addr[%s] packet dropped by TAP packet filter",
-                                mroute_addr_print_ex(&edest, MAPF_SHOW_ARP, &gc));
-                            c->c2.to_tun.len = 0;
-                        }
-#endif
-                    }
-                    else
-                    {
-                        msg(D_MULTI_DROPPED, "MULTI: bad source address from client [%s], packet dropped",
-                            mroute_addr_print(&src, &gc));
-                        c->c2.to_tun.len = 0;
-                    }
-                }
-                else
+    while (!m->pending && ret
+           && (job = multi_worker_pop_completed(m->worker_pool)))
+    {
+        struct multi_instance *mi = job->mi;
+
+        if (!mi->halt)
+        {
+            struct context *c = &mi->context;
+
+            multi_set_pending(m, mi);
+            set_prefix(mi);
+
+            c->c2.buf = job->buf;
+            c->c2.from = job->from;
+
+            if (job->decrypt_ok)
+            {
+                if (job->floated && c->c2.buf.len > 0)
                 {
-                    c->c2.to_tun.len = 0;
+                    multi_process_float(m, mi);
                 }
+                process_incoming_link_part2(c, get_link_socket_info(c),
+                                            job->buf.data);
             }
-        }
 
-        /* postprocess and set wakeup */
-        ret = multi_process_post(m, m->pending, mpp_flags);
+            multi_process_incoming_link_route(m, c);
 
-        clear_prefix();
-    }
+            ret = multi_process_post(m, mi, mpp_flags);
 
-    gc_free(&gc);
+            clear_prefix();
+        }
+        multi_worker_release_job(m->worker_pool, job);
+    }
     return ret;
 }
+#endif /* ENABLE_WORKER_THREADS */
 
 /*
  * Process packets in the TUN/TAP interface -> TCP/UDP socket direction,
@@ -3464,8 +5045,21 @@ multi_process_incoming_tun(struct multi_context *m, const unsigned int mpp_flags
                     /* get instance context */
                     c = &m->pending->context;
 
+#ifdef ENABLE_WORKER_THREADS
+                    /* a worker decrypt job writes c2.buf/c2.from and swaps
+                     * c2.buffers in this context; the encrypt below must not
+                     * run until the instance is idle on its worker */
+                    if (m->worker_pool && m->pending->n_worker_jobs > 0)
+                    {
+                        multi_worker_drain_instance(m->worker_pool, m->pending);
+                    }
+#endif
+
                     set_prefix(m->pending);
 
+                    /* encrypt_sign needs this instance's frame buffers */
+                    multi_instance_lease_buffers(m, m->pending);
+
 #ifdef ENABLE_PF
                     if (!pf_addr_test(&c->c2.pf, c, e2, "tun_tap_src_addr"))
                     {
@@ -3478,13 +5072,31 @@ multi_process_incoming_tun(struct multi_context *m, const unsigned int mpp_flags
                     {
                         if (multi_output_queue_ready(m, m->pending))
                         {
+                            /* above the watermark, CE-mark ECN-capable
+                             * flows so they back off before the queue
+                             * overflows and we have to drop */
+                            if (multi_output_queue_congested(m, m->pending)
+                                && ip_packet_ecn_mark_ce(&m->top.c2.buf, dev_type))
+                            {
+                                ++m->pending->n_ecn_marked;
+                            }
                             /* transfer packet pointer from top-level context buffer to instance */
                             c->c2.buf = m->top.c2.buf;
                         }
+                        else if (OPENVPN_DSCP_INTERACTIVE(ip_packet_dscp(&m->top.c2.buf, dev_type))
+                                 && mbuf_evict_bulk(m->pending->tcp_link_out_deferred))
+                        {
+                            /* full queue: make room for an interactive
+                             * packet by dropping a queued bulk packet
+                             * instead of tail-dropping the new one */
+                            ++m->pending->n_drops_bulk;
+                            c->c2.buf = m->top.c2.buf;
+                        }
                         else
                         {
                             /* drop packet */
-                            msg(D_MULTI_DROPPED, "MULTI: packet dropped due to output saturation (multi_process_incoming_tun)");
+                            ++m->pending->n_drops_tail;
+                            msg_rl(D_MULTI_DROPPED, "MULTI: packet dropped due to output saturation (multi_process_incoming_tun)");
                             buf_reset_len(&c->c2.buf);
                         }
                     }
@@ -3509,23 +5121,49 @@ multi_process_incoming_tun(struct multi_context *m, const unsigned int mpp_flags
  * queue.
  */
 struct multi_instance *
-multi_get_queue(struct mbuf_set *ms)
+multi_get_queue(struct multi_context *m)
 {
+    struct mbuf_set *ms = m->mbuf;
     struct mbuf_item item;
 
     if (mbuf_extract_item(ms, &item)) /* cleartext IP packet */
     {
-        unsigned int pip_flags = PIPV4_PASSTOS | PIPV6_IMCP_NOHOST_SERVER;
+        unsigned int pip_flags = PIPV4_PASSTOS | PIPV6_IMCP_NOHOST_SERVER
+                                 | PIP_RECORD_DSCP;
+        struct context *c = &item.instance->context;
+
+#ifdef ENABLE_WORKER_THREADS
+        /* same exclusion as multi_process_incoming_tun(): no worker may be
+         * writing this context while we encrypt from the mbuf queue */
+        if (m->worker_pool && item.instance->n_worker_jobs > 0)
+        {
+            multi_worker_drain_instance(m->worker_pool, item.instance);
+        }
+#endif
 
         set_prefix(item.instance);
-        item.instance->context.c2.buf = item.buffer->buf;
+        multi_instance_lease_buffers(m, item.instance);
+        if (item.buffer->refcount > 1)
+        {
+            /* Other queued instances still reference this packet, and
+             * encrypt_sign() may encrypt c2.buf in place, so hand the
+             * pipeline a private copy.
+             */
+            c->c2.buf = c->c2.buffers->read_tun_buf;
+            ASSERT(buf_init(&c->c2.buf, item.buffer->buf.offset));
+            ASSERT(buf_copy(&c->c2.buf, &item.buffer->buf));
+        }
+        else
+        {
+            c->c2.buf = item.buffer->buf;
+        }
         if (item.buffer->flags & MF_UNICAST) /* --mssfix doesn't make sense for broadcast or multicast */
         {
             pip_flags |= PIP_MSSFIX;
         }
         process_ip_header(&item.instance->context, pip_flags, &item.instance->context.c2.buf);
         encrypt_sign(&item.instance->context, true);
-        mbuf_free_buf(item.buffer);
+        mbuf_free_buf(ms, item.buffer);
 
         dmsg(D_MULTI_DEBUG, "MULTI: C2C/MCAST/BCAST");
 
@@ -3705,22 +5343,18 @@ is_exit_restart(int sig)
 static void
 multi_push_restart_schedule_exit(struct multi_context *m, bool next_server)
 {
-    struct hash_iterator hi;
-    struct hash_element *he;
+    struct multi_instance *mi;
     struct timeval tv;
 
     /* tell all clients to restart */
-    hash_iterator_init(m->iter, &hi);
-    while ((he = hash_iterator_next(&hi)))
+    for (mi = m->active_head; mi; mi = mi->active_next)
     {
-        struct multi_instance *mi = (struct multi_instance *) he->value;
         if (!mi->halt)
         {
             send_control_channel_string(&mi->context, next_server ? "RESTART,[N]" : "RESTART", D_PUSH);
             multi_schedule_context_wakeup(m, mi);
         }
     }
-    hash_iterator_free(&hi);
 
     /* reschedule signal */
     ASSERT(!openvpn_gettimeofday(&m->deferred_shutdown_signal.wakeup, NULL));
@@ -3817,14 +5451,13 @@ static int
 management_callback_kill_by_cn(void *arg, const char *del_cn)
 {
     struct multi_context *m = (struct multi_context *) arg;
-    struct hash_iterator hi;
-    struct hash_element *he;
+    struct multi_instance *mi;
+    struct multi_instance *next;
     int count = 0;
 
-    hash_iterator_init(m->iter, &hi);
-    while ((he = hash_iterator_next(&hi)))
+    for (mi = m->active_head; mi; mi = next)
     {
-        struct multi_instance *mi = (struct multi_instance *) he->value;
+        next = mi->active_next;
         if (!mi->halt)
         {
             const char *cn = tls_common_name(mi->context.c2.tls_multi, false);
@@ -3835,7 +5468,6 @@ management_callback_kill_by_cn(void *arg, const char *del_cn)
             }
         }
     }
-    hash_iterator_free(&hi);
     return count;
 }
 
@@ -3843,8 +5475,8 @@ static int
 management_callback_kill_by_addr(void *arg, const in_addr_t addr, const int port)
 {
     struct multi_context *m = (struct multi_context *) arg;
-    struct hash_iterator hi;
-    struct hash_element *he;
+    struct multi_instance *mi;
+    struct multi_instance *next;
     struct openvpn_sockaddr saddr;
     struct mroute_addr maddr;
     int count = 0;
@@ -3855,21 +5487,65 @@ management_callback_kill_by_addr(void *arg, const in_addr_t addr, const int port
     saddr.addr.in4.sin_port = htons(port);
     if (mroute_extract_openvpn_sockaddr(&maddr, &saddr, true))
     {
-        hash_iterator_init(m->iter, &hi);
-        while ((he = hash_iterator_next(&hi)))
+        for (mi = m->active_head; mi; mi = next)
         {
-            struct multi_instance *mi = (struct multi_instance *) he->value;
+            next = mi->active_next;
             if (!mi->halt && mroute_addr_equal(&maddr, &mi->real))
             {
                 multi_signal_instance(m, mi, SIGTERM);
                 ++count;
             }
         }
-        hash_iterator_free(&hi);
     }
     return count;
 }
 
+/*
+ * Hot-reload of certificate verification state without SIGHUP: swap
+ * the shared CRL store, optionally replace the tls-verify command,
+ * and force the per-instance pf rule files to be re-read.  Connected
+ * clients are left untouched; revocations take effect at their next
+ * handshake.
+ */
+static bool
+management_callback_verify_reload(void *arg, const char *tls_verify_cmd)
+{
+    struct multi_context *m = (struct multi_context *) arg;
+    struct context *c = &m->top;
+    struct options *o = &c->options;
+
+    if (tls_verify_cmd)
+    {
+        o->tls_verify = string_alloc(tls_verify_cmd, &o->gc);
+        msg(M_INFO, "verify-reload: tls-verify command is now '%s'",
+            o->tls_verify);
+    }
+
+    if (o->crl_file)
+    {
+        /* the X509 store behind c1.ks.ssl_ctx is shared by all client
+         * instances, so the swap is visible to every future handshake */
+        tls_ctx_reload_crl_now(&c->c1.ks.ssl_ctx, o->crl_file,
+                               o->crl_file_inline);
+        msg(M_INFO, "verify-reload: CRL reloaded from '%s'", o->crl_file);
+    }
+
+#if defined(ENABLE_PF) && defined(PLUGIN_PF)
+    /* nudge the per-instance pf pollers so changed rule files are
+     * re-read on their next wakeup even when the mtime is unchanged */
+    struct multi_instance *mi;
+    for (mi = m->active_head; mi; mi = mi->active_next)
+    {
+        if (!mi->halt && mi->context.c2.pf.enabled)
+        {
+            mi->context.c2.pf.file_last_mod = 0;
+        }
+    }
+#endif
+
+    return true;
+}
+
 static void
 management_delete_event(void *arg, event_t event)
 {
@@ -4030,6 +5706,7 @@ init_management_callback_multi(struct multi_context *m)
         cb.client_auth = management_client_auth;
         cb.client_pending_auth = management_client_pending_auth;
         cb.get_peer_info = management_get_peer_info;
+        cb.verify_reload = management_callback_verify_reload;
 #ifdef MANAGEMENT_PF
         cb.client_pf = management_client_pf;
 #endif
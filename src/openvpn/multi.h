@@ -28,6 +28,7 @@
 #ifndef MULTI_H
 #define MULTI_H
 
+#include "argv.h"
 #include "init.h"
 #include "forward.h"
 #include "mroute.h"
@@ -38,6 +39,8 @@
 #include "mudp.h"
 #include "mtcp.h"
 #include "perf.h"
+#include "srclimit.h"
+#include "migrate.h"
 #include "vlan.h"
 
 #define MULTI_PREFIX_MAX_LENGTH 256
@@ -99,45 +102,149 @@ struct client_connect_defer_state
  */
 struct multi_instance {
     struct schedule_entry se;  /* this must be the first element of the structure */
-    struct gc_arena gc;
+
+    /*
+     * Hot header: the fields the per-packet forwarding path reads and
+     * writes, packed together so it touches only the first couple of
+     * cache lines of an instance.
+     */
     bool halt;
+    bool socket_set_called;
     int refcount;
+#ifdef ENABLE_WORKER_THREADS
+    int n_worker_jobs;         /**< jobs queued to or executing on the
+                                *   instance's worker; main thread only.
+                                *   While nonzero the main thread must not
+                                *   touch the instance's crypto state --
+                                *   see multi_worker_drain_instance() */
+#endif
+    unsigned int tcp_rwflags;  /* queued outgoing data in Server/TCP mode */
+    struct mbuf_set *tcp_link_out_deferred;
+    struct timeval wakeup;     /* absolute time */
+    struct mroute_addr real;    /**< External network address of the
+                                 *   remote peer. */
+
+    /*
+     * Cold tail: configuration and bookkeeping touched at connect,
+     * disconnect and status time only.
+     */
+    struct gc_arena gc;
+    struct multi_instance *reclaim_next; /**< link in the epoch reclamation
+                                          *   list once refcount hits zero */
+    unsigned int reclaim_epoch; /**< epoch in which the last reference
+                                 *   was dropped */
     int route_count;           /* number of routes (including cached routes) owned by this instance */
+
+    /* output congestion accounting */
+    counter_type n_ecn_marked;  /* packets ECN-marked above the queue watermark */
+    counter_type n_drops_bulk;  /* queued bulk packets evicted for interactive ones */
+    counter_type n_drops_tail;  /* packets tail-dropped at a full output queue */
+
     time_t created;             /**< Time at which a VPN tunnel instance
                                  *   was created.  This parameter is set
                                  *   by the \c multi_create_instance()
                                  *   function. */
-    struct timeval wakeup;     /* absolute time */
-    struct mroute_addr real;    /**< External network address of the
-                                 *   remote peer. */
     ifconfig_pool_handle vaddr_handle;
     char msg_prefix[MULTI_PREFIX_MAX_LENGTH];
 
-    /* queued outgoing data in Server/TCP mode */
-    unsigned int tcp_rwflags;
-    struct mbuf_set *tcp_link_out_deferred;
-    bool socket_set_called;
+    /* cached presentation string for 'real', refreshed whenever the
+     * address can change (instance creation, float); lets status and
+     * logging paths read a pointer instead of re-formatting */
+    char real_print[64];
 
     in_addr_t reporting_addr;     /* IP address shown in status listing */
     struct in6_addr reporting_addr_ipv6; /* IPv6 address in status listing */
 
+    /* cached pre-serialized CLIENT_LIST status record, rebuilt only
+     * when the instance has seen traffic since it was last formatted */
+    struct buffer status_record;
+    int status_record_version;
+    counter_type status_record_read;
+    counter_type status_record_write;
+
     bool did_real_hash;
-    bool did_iter;
+
+    /*
+     * Intrusive membership in multi_context.active_head, so that
+     * maintenance passes can enumerate instances without walking a
+     * hash table.  Links are key-independent and survive a float.
+     */
+    struct multi_instance *active_next;
+    struct multi_instance *active_prev;
+    bool on_active_list;
 #ifdef ENABLE_MANAGEMENT
     bool did_cid_hash;
     struct buffer_list *cc_config;
 #endif
     bool did_iroutes;
     int n_clients_delta; /* added to multi_context.n_clients when instance is closed */
+#ifdef ENABLE_MEMSTATS
+    int mstats_slot; /* slot in the shared stats segment, -1 if none */
+#endif
 
-    struct context context;     /**< The context structure storing state
-                                 *   for this VPN tunnel. */
     struct client_connect_defer_state client_connect_defer_state;
 #ifdef ENABLE_ASYNC_PUSH
     int inotify_watch; /* watch descriptor for acf */
 #endif
+
+    struct context context;     /**< The context structure storing state
+                                 *   for this VPN tunnel. */
+};
+
+
+/**
+ * Direct-mapped cache of the most recently seen client instances,
+ * consulted before the real-address hash table on the UDP datagram
+ * path.  Consecutive datagrams overwhelmingly come from the same
+ * peer, so even a few entries absorb most lookups.
+ */
+#define MULTI_FLOW_CACHE_SIZE 4 /* must be a power of 2 */
+
+struct multi_flow_cache_entry
+{
+    struct mroute_addr addr;    /* real address of cached peer */
+    struct multi_instance *mi;  /* NULL if entry is unused */
+};
+
+
+/**
+ * Typed work items for deferred per-instance post-processing.
+ *
+ * Steps which used to run inline from multi_process_post() -- guarded
+ * only by flags on the instance -- are queued here instead, making the
+ * control flow explicit and, eventually, schedulable off the event
+ * thread.
+ */
+enum multi_work_type
+{
+    MW_CONNECTION_ESTABLISHED,  /**< run multi_connection_established():
+                                 *   client-connect scripts/plugins,
+                                 *   ifconfig-pool assignment, push reply */
+};
+
+struct multi_work_item
+{
+    enum multi_work_type type;
+    struct multi_instance *mi;  /**< NULLed if the instance is closed
+                                 *   while the item is queued */
 };
 
+/**
+ * Ring deque of pending post-processing work.
+ *
+ * The event thread pushes and pops at the bottom end; the top end is
+ * reserved for worker threads to steal from once the handlers are
+ * thread-safe, giving the deque classic work-stealing semantics.
+ * Today both ends are driven by the event thread only, so no
+ * synchronization is needed yet.
+ */
+struct multi_work_deque
+{
+    struct multi_work_item *items;
+    int capacity;               /**< size of \c items, power of two */
+    int bottom;                 /**< push/pop end (event thread) */
+    int top;                    /**< steal end (future workers) */
+};
 
 /**
  * Main OpenVPN server state structure.
@@ -161,13 +268,56 @@ struct multi_context {
     struct multi_instance **instances;  /**< Array of multi_instances. An instance can be
                                          * accessed using peer-id as an index. */
 
+    struct multi_work_deque work;   /**< Deferred instance post-processing
+                                     *   work items, see multi_work_type. */
+
+    struct context_buffers **buffers_pool;  /**< Parked frame buffer sets for
+                                             *   leasing to TCP client
+                                             *   instances; idle instances
+                                             *   hold no buffers.  See
+                                             *   multi_instance_lease_buffers(). */
+    int n_buffers_pool;         /**< Number of parked sets in \c buffers_pool. */
+    int buffers_pool_cap;       /**< Allocated size of \c buffers_pool. */
+
+    int *peer_id_free;          /**< LIFO stack of unassigned peer-ids.  The
+                                 *   most recently released id is handed out
+                                 *   first, so a client reconnecting shortly
+                                 *   after its old instance was reaped gets
+                                 *   its previous peer-id back. */
+    int n_peer_id_free;         /**< Number of entries in \c peer_id_free. */
+
     struct hash *hash;          /**< VPN tunnel instances indexed by real
                                  *   address of the remote peer. */
     struct hash *vhash;         /**< VPN tunnel instances indexed by
                                  *   virtual address of remote hosts. */
-    struct hash *iter;          /**< VPN tunnel instances indexed by real
-                                 *   address of the remote peer, optimized
-                                 *   for iteration. */
+    struct mroute_lpm *lpm4;    /**< Longest-prefix-match trie over
+                                 *   learned IPv4 network routes, for
+                                 *   CIDR lookups on vhash misses. */
+    struct vhash_bloom *vhash_bloom; /**< Bloom filter over learned
+                                      *   virtual addresses; rejects
+                                      *   guaranteed-miss lookups with a
+                                      *   single cache line access. */
+    int learn_addr_fd;          /**< Write end of the pipe to the
+                                 *   --learn-address-async helper
+                                 *   process, or -1 when synchronous
+                                 *   script invocation is used. */
+    struct argv_template learn_address_tmpl;
+                                /**< Pre-parsed --learn-address command,
+                                 *   so that per-event argv construction
+                                 *   skips re-tokenizing the command
+                                 *   string. */
+    struct argv_template client_connect_tmpl;
+                                /**< Pre-parsed --client-connect command. */
+    struct argv_template client_disconnect_tmpl;
+                                /**< Pre-parsed --client-disconnect
+                                 *   command. */
+    struct multi_instance *active_head; /**< Intrusive doubly-linked list of
+                                         *   all active instances, for
+                                         *   enumeration without hash walks. */
+    struct multi_instance *active_tail;
+    struct multi_flow_cache_entry flow_cache[MULTI_FLOW_CACHE_SIZE];
+                                /**< per-packet fast path cache in front
+                                 *   of the real-address hash table */
     struct schedule *schedule;
     struct mbuf_set *mbuf;      /**< Set of buffers for passing data
                                  *   channel packets between VPN tunnel
@@ -175,7 +325,22 @@ struct multi_context {
     struct multi_tcp *mtcp;     /**< State specific to OpenVPN using TCP
                                  *   as external transport. */
     struct ifconfig_pool *ifconfig_pool;
+#ifdef ENABLE_FEATURE_SHAPER
+    struct shaper shaper_global;  /**< Root token bucket capping aggregate
+                                   *   output across all instances; undefined
+                                   *   unless --shaper-global is set. */
+#endif
     struct frequency_limit *new_connection_limiter;
+    struct srclimit srclimit;   /**< Per-source-IP rate accounting for
+                                 *   datagrams from unknown peers; undefined
+                                 *   unless --connect-freq-src is set. */
+#ifndef _WIN32
+    struct migrate_channel migrate; /**< Sibling-process state transfer
+                                     *   channel for --float-migration. */
+#endif
+    int admission_budget;       /**< Remaining new-client admissions in the
+                                 *   current event-loop iteration, refilled
+                                 *   from --connect-budget each iteration. */
     struct mroute_helper *route_helper;
     struct multi_reap *reaper;
     struct mroute_addr local;
@@ -190,6 +355,11 @@ struct multi_context {
     unsigned long cid_counter;
 #endif
 
+#ifdef ENABLE_WORKER_THREADS
+    struct multi_worker_pool *worker_pool; /**< data channel worker thread
+                                            *   pool, see --worker-threads */
+#endif
+
     struct multi_instance *pending;
     struct multi_instance *earliest_wakeup;
     struct multi_instance **mpp_touched;
@@ -269,6 +439,25 @@ void multi_top_init(struct multi_context *m, const struct context *top);
 
 void multi_top_free(struct multi_context *m);
 
+/* slab recycling for instance allocations (multi.c) */
+struct multi_instance *multi_instance_alloc(void);
+
+void multi_instance_free(struct multi_instance *mi);
+
+/**
+ * Park an instance whose last reference was dropped; it is recycled by
+ * multi_reclaim_quiesce() two epochs later.
+ */
+void multi_instance_defer_free(struct multi_instance *mi);
+
+/**
+ * Declare a quiescent state: no stage still holds instance pointers
+ * picked up in earlier event loop iterations.  Called once per
+ * iteration by the server event loops; advances the reclamation epoch
+ * and recycles instances parked for two epochs.
+ */
+void multi_reclaim_quiesce(void);
+
 struct multi_instance *multi_create_instance(struct multi_context *m, const struct mroute_addr *real);
 
 void multi_close_instance(struct multi_context *m, struct multi_instance *mi, bool shutdown);
@@ -285,6 +474,46 @@ bool multi_process_timeout(struct multi_context *m, const unsigned int mpp_flags
  */
 void multi_process_float(struct multi_context *m, struct multi_instance *mi);
 
+/**
+ * Drop any flow cache entries pointing at an instance which is about
+ * to float to another address or be closed.
+ */
+void multi_flow_cache_purge(struct multi_context *m, const struct multi_instance *mi);
+
+#ifndef _WIN32
+/**
+ * Serialize the data channel state of the instance owning the given
+ * peer-id into *state for hand-over to a sibling process.  Called on
+ * behalf of a --float-migration query; leaves state->found zero if we
+ * do not own a matching, fully keyed instance.  The local instance is
+ * only closed when commit is set, i.e. when the requesting process has
+ * authenticated the triggering packet and takes ownership.
+ */
+bool multi_migrate_export(struct multi_context *m, uint32_t peer_id,
+                          uint32_t key_id, bool commit,
+                          struct migrate_client_state *state);
+
+/**
+ * Handle a data packet from an unknown source carrying a peer-id we have
+ * no instance for: query sibling processes over the --float-migration
+ * channel, authenticate the packet against the exported keys and, on
+ * success, commit the hand-over and build a local instance around the
+ * migrated data channel state.  Returns the new instance or NULL.
+ */
+struct multi_instance *multi_migrate_get(struct multi_context *m,
+                                         const struct mroute_addr *real,
+                                         uint32_t peer_id, uint32_t key_id);
+
+/**
+ * --persist-state: serialize established clients' data channel state to
+ * the configured file on shutdown / restore it on startup, so a server
+ * restart does not trigger a renegotiation stampede.
+ */
+void multi_persist_state_save(struct multi_context *m);
+
+void multi_persist_state_restore(struct multi_context *m);
+#endif
+
 #define MPP_PRE_SELECT             (1<<0)
 #define MPP_CONDITIONAL_PRE_SELECT (1<<1)
 #define MPP_CLOSE_ON_SIGNAL        (1<<2)
@@ -315,6 +544,26 @@ void multi_process_float(struct multi_context *m, struct multi_instance *mi);
  */
 bool multi_process_post(struct multi_context *m, struct multi_instance *mi, const unsigned int flags);
 
+/**
+ * Attach a frame buffer set to a TCP client instance about to process
+ * packets, taking one from the shared pool when available.
+ *
+ * TCP client instances do not own context buffers while idle -- see
+ * multi_instance_release_buffers() -- so this must run before any code
+ * path that dereferences \c mi->context.c2.buffers.  A no-op for
+ * instances that already hold buffers and for UDP instances, which
+ * share the top-level context's set.
+ */
+void multi_instance_lease_buffers(struct multi_context *m, struct multi_instance *mi);
+
+/**
+ * Return a TCP client instance's frame buffer set to the shared pool
+ * when the instance has no output pending.  Caps buffer memory at
+ * roughly (active clients x set size) instead of (connected clients x
+ * set size).
+ */
+void multi_instance_release_buffers(struct multi_context *m, struct multi_instance *mi);
+
 
 /**************************************************************************/
 /**
@@ -341,6 +590,22 @@ bool multi_process_post(struct multi_context *m, struct multi_instance *mi, cons
  */
 bool multi_process_incoming_link(struct multi_context *m, struct multi_instance *instance, const unsigned int mpp_flags);
 
+#ifdef ENABLE_WORKER_THREADS
+/**
+ * Finish processing of packets decrypted by the worker thread pool.
+ * @ingroup external_multiplexer
+ *
+ * Called from the UDP server event loop when the worker pool's
+ * completion pipe becomes readable.  Performs the routing and
+ * postprocessing steps of \c multi_process_incoming_link() for each
+ * completed packet, on the main thread.
+ *
+ * @param m            - The single \c multi_context structure.
+ * @param mpp_flags    - Fast I/O optimization flags.
+ */
+bool multi_process_worker_completions(struct multi_context *m, const unsigned int mpp_flags);
+#endif
+
 
 /**
  * Determine the destination VPN tunnel of a packet received over the
@@ -364,7 +629,7 @@ void multi_process_drop_outgoing_tun(struct multi_context *m, const unsigned int
 
 void multi_print_status(struct multi_context *m, struct status_output *so, const int version);
 
-struct multi_instance *multi_get_queue(struct mbuf_set *ms);
+struct multi_instance *multi_get_queue(struct multi_context *m);
 
 void multi_add_mbuf(struct multi_context *m,
                     struct multi_instance *mi,
@@ -407,6 +672,26 @@ multi_output_queue_ready(const struct multi_context *m,
     }
 }
 
+/*
+ * Return true once our output queue has crossed its high watermark
+ * (3/4 of --tcp-queue-limit), i.e. we should start signaling
+ * congestion before packets are actually dropped.
+ */
+static inline bool
+multi_output_queue_congested(const struct multi_context *m,
+                             const struct multi_instance *mi)
+{
+    if (mi->tcp_link_out_deferred)
+    {
+        return mbuf_len(mi->tcp_link_out_deferred)
+               >= (unsigned int) (m->tcp_queue_limit - m->tcp_queue_limit / 4);
+    }
+    else
+    {
+        return false;
+    }
+}
+
 /*
  * Determine which instance has pending output
  * and prepare the output for sending in
@@ -423,11 +708,43 @@ multi_process_outgoing_link_pre(struct multi_context *m)
     }
     else if (mbuf_defined(m->mbuf))
     {
-        mi = multi_get_queue(m->mbuf);
+        mi = multi_get_queue(m);
     }
     return mi;
 }
 
+/*
+ * Per-packet fast path flow cache, indexed by a trivial function of the
+ * peer's real address.  A miss costs one compare on top of the regular
+ * hash lookup; a hit skips the hash table entirely.
+ */
+static inline int
+multi_flow_cache_slot(const struct mroute_addr *addr)
+{
+    return (addr->raw_addr[0] ^ addr->raw_addr[addr->len - 1])
+           & (MULTI_FLOW_CACHE_SIZE - 1);
+}
+
+static inline struct multi_instance *
+multi_flow_cache_lookup(const struct multi_context *m, const struct mroute_addr *addr)
+{
+    const struct multi_flow_cache_entry *e = &m->flow_cache[multi_flow_cache_slot(addr)];
+    if (e->mi && mroute_addr_equal(&e->addr, addr))
+    {
+        return e->mi;
+    }
+    return NULL;
+}
+
+static inline void
+multi_flow_cache_insert(struct multi_context *m, const struct mroute_addr *addr,
+                        struct multi_instance *mi)
+{
+    struct multi_flow_cache_entry *e = &m->flow_cache[multi_flow_cache_slot(addr)];
+    e->addr = *addr;
+    e->mi = mi;
+}
+
 /*
  * Per-client route quota management
  */
@@ -477,14 +794,19 @@ multi_instance_dec_refcount(struct multi_instance *mi)
     if (--mi->refcount <= 0)
     {
         gc_free(&mi->gc);
-        free(mi);
+        multi_instance_defer_free(mi);
     }
 }
 
 static inline void
-multi_route_del(struct multi_route *route)
+multi_route_del(const struct multi_context *m, struct multi_route *route)
 {
     struct multi_instance *mi = route->instance;
+    if ((route->addr.type & MR_ADDR_MASK) == MR_ADDR_IPV4
+        && (route->addr.type & MR_WITH_NETBITS))
+    {
+        mroute_lpm_del(m->lpm4, ntohl(route->addr.v4.addr), route->addr.netbits);
+    }
     route_quota_dec(mi);
     multi_instance_dec_refcount(mi);
     free(route);
@@ -605,7 +927,7 @@ multi_get_timeout(struct multi_context *m, struct timeval *dest)
     m->earliest_wakeup = (struct multi_instance *) schedule_get_earliest_wakeup(m->schedule, &tv);
     if (m->earliest_wakeup)
     {
-        ASSERT(!openvpn_gettimeofday(&current, NULL));
+        ASSERT(!openvpn_gettimeofday_coarse(&current));
         tv_delta(dest, &current, &tv);
         if (dest->tv_sec >= REAP_MAX_WAKEUP)
         {
@@ -661,7 +983,8 @@ multi_process_outgoing_tun(struct multi_context *m, const unsigned int mpp_flags
 
 #define CLIENT_CONNECT_OPT_MASK (OPT_P_INSTANCE | OPT_P_INHERIT   \
                                  |OPT_P_PUSH | OPT_P_TIMER | OPT_P_CONFIG   \
-                                 |OPT_P_ECHO | OPT_P_COMP | OPT_P_SOCKFLAGS)
+                                 |OPT_P_ECHO | OPT_P_COMP | OPT_P_SOCKFLAGS \
+                                 |OPT_P_SHAPER)
 
 static inline bool
 multi_process_outgoing_link_dowork(struct multi_context *m, struct multi_instance *mi, const unsigned int mpp_flags)
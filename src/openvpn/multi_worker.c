@@ -0,0 +1,458 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#include "syshead.h"
+
+#ifdef ENABLE_WORKER_THREADS
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "multi.h"
+#include "multi_worker.h"
+#include "mpscq.h"
+#include "fdmisc.h"
+#include "forward.h"
+#include "init.h"
+#include "ssl.h"
+
+#include "memdbg.h"
+
+/*
+ * One worker thread together with its private input queue.  Jobs for a
+ * given multi_instance always land on the same queue (selected by
+ * hashing the instance pointer), which keeps per-client packet order
+ * intact without any cross-thread synchronization on the fast path.
+ */
+struct multi_worker_thread
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct multi_worker_job *queue_head;
+    struct multi_worker_job *queue_tail;
+    bool halt;
+    struct multi_worker_pool *pool;
+    struct context_buffers *buffers; /**< private work buffers, so workers
+                                      *   never share decrypt scratch space
+                                      *   with each other or the main thread */
+};
+
+struct multi_worker_pool
+{
+    struct multi_worker_thread *threads;
+    int n_threads;
+
+    struct multi_context *multi;
+    int buf_size;                   /**< allocation size for job storage */
+
+    /* lock-free completion queue, filled by workers, drained by the
+     * main thread; n_inflight (main thread only) bounds the number of
+     * outstanding jobs so a push can never find the ring full */
+    struct mpscq done;
+    int n_inflight;
+
+    /* free list of recycled jobs, only touched by the main thread */
+    struct multi_worker_job *free_list;
+
+    /* completed jobs popped out of turn by a drain, handed out FIFO by
+     * multi_worker_pop_completed() before the ring is consulted so the
+     * per-client routing order is preserved; main thread only */
+    struct multi_worker_job *deferred_head;
+    struct multi_worker_job *deferred_tail;
+
+    int notify_fds[2];              /**< pipe, [0] registered with event set */
+};
+
+static void
+multi_worker_complete(struct multi_worker_pool *pool, struct multi_worker_job *job)
+{
+    const uint8_t wakeup = 0;
+
+    job->next = NULL;
+    ASSERT(mpscq_push(&pool->done, job));
+
+    if (write(pool->notify_fds[1], &wakeup, sizeof(wakeup)) < 0)
+    {
+        /* pipe full implies a wakeup is already pending */
+    }
+}
+
+/*
+ * Run the decrypt stage for one job in the context of its instance.
+ * This is the only piece of per-instance state a worker touches; the
+ * completion handler on the main thread does everything else.
+ */
+static void
+multi_worker_do_job(struct multi_worker_thread *wt, struct multi_worker_job *job)
+{
+    struct context *c = &job->mi->context;
+
+    job->decrypt_ok = false;
+    if (!job->mi->halt)
+    {
+        struct context_buffers *saved_buffers = c->c2.buffers;
+
+        c->c2.buffers = wt->buffers;
+        c->c2.buf = job->buf;
+        c->c2.from = job->from;
+        job->decrypt_ok = process_incoming_link_part1(c, get_link_socket_info(c),
+                                                      job->floated);
+
+        /* the decrypted packet may now live in this thread's private work
+         * buffers; copy it back to job-owned storage so the main thread
+         * can pick it up after this worker has moved on to the next job */
+        if (c->c2.buf.data != job->storage.data)
+        {
+            job->buf = job->storage;
+            ASSERT(buf_init(&job->buf, c->c2.buf.offset));
+            ASSERT(buf_copy(&job->buf, &c->c2.buf));
+        }
+        else
+        {
+            job->buf = c->c2.buf;
+        }
+
+        c->c2.buffers = saved_buffers;
+    }
+
+    multi_worker_complete(wt->pool, job);
+}
+
+static void *
+multi_worker_thread_func(void *arg)
+{
+    struct multi_worker_thread *wt = (struct multi_worker_thread *) arg;
+
+    pthread_mutex_lock(&wt->mutex);
+    while (true)
+    {
+        while (!wt->queue_head && !wt->halt)
+        {
+            pthread_cond_wait(&wt->cond, &wt->mutex);
+        }
+        if (wt->halt)
+        {
+            break;
+        }
+
+        struct multi_worker_job *job = wt->queue_head;
+        wt->queue_head = job->next;
+        if (!wt->queue_head)
+        {
+            wt->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&wt->mutex);
+
+        multi_worker_do_job(wt, job);
+
+        pthread_mutex_lock(&wt->mutex);
+    }
+    pthread_mutex_unlock(&wt->mutex);
+    return NULL;
+}
+
+struct multi_worker_pool *
+multi_worker_pool_init(struct multi_context *m, int n_threads)
+{
+    struct multi_worker_pool *pool;
+    int i;
+
+    ASSERT(n_threads > 0 && n_threads <= MAX_WORKER_THREADS);
+
+    ALLOC_OBJ_CLEAR(pool, struct multi_worker_pool);
+    pool->multi = m;
+    pool->n_threads = n_threads;
+    pool->buf_size = BUF_SIZE(&m->top.c2.frame);
+
+    if (pipe(pool->notify_fds) < 0)
+    {
+        msg(M_ERR, "WORKER: cannot create completion pipe");
+    }
+    set_nonblock(pool->notify_fds[0]);
+    set_nonblock(pool->notify_fds[1]);
+    set_cloexec(pool->notify_fds[0]);
+    set_cloexec(pool->notify_fds[1]);
+
+    mpscq_init(&pool->done, MULTI_WORKER_MAX_INFLIGHT);
+
+    ALLOC_ARRAY_CLEAR(pool->threads, struct multi_worker_thread, n_threads);
+    for (i = 0; i < n_threads; ++i)
+    {
+        struct multi_worker_thread *wt = &pool->threads[i];
+        wt->pool = pool;
+        wt->buffers = init_context_buffers(&m->top.c2.frame);
+        ASSERT(pthread_mutex_init(&wt->mutex, NULL) == 0);
+        ASSERT(pthread_cond_init(&wt->cond, NULL) == 0);
+        if (pthread_create(&wt->thread, NULL, multi_worker_thread_func, wt) != 0)
+        {
+            msg(M_ERR, "WORKER: cannot create worker thread");
+        }
+    }
+
+    msg(M_INFO, "WORKER: data channel worker pool initialized with %d threads",
+        n_threads);
+    return pool;
+}
+
+void
+multi_worker_pool_free(struct multi_worker_pool *pool)
+{
+    int i;
+
+    if (!pool)
+    {
+        return;
+    }
+
+    for (i = 0; i < pool->n_threads; ++i)
+    {
+        struct multi_worker_thread *wt = &pool->threads[i];
+        pthread_mutex_lock(&wt->mutex);
+        wt->halt = true;
+        pthread_cond_signal(&wt->cond);
+        pthread_mutex_unlock(&wt->mutex);
+        pthread_join(wt->thread, NULL);
+        pthread_mutex_destroy(&wt->mutex);
+        pthread_cond_destroy(&wt->cond);
+        free_context_buffers(wt->buffers);
+    }
+
+    /* drain whatever completed after halt so buffers are not leaked */
+    struct multi_worker_job *job;
+    while ((job = multi_worker_pop_completed(pool)))
+    {
+        multi_worker_release_job(pool, job);
+    }
+    while ((job = pool->free_list))
+    {
+        pool->free_list = job->next;
+        free_buf(&job->storage);
+        free(job);
+    }
+
+    mpscq_uninit(&pool->done);
+    close(pool->notify_fds[0]);
+    close(pool->notify_fds[1]);
+    free(pool->threads);
+    free(pool);
+}
+
+static struct multi_worker_job *
+multi_worker_job_new(struct multi_worker_pool *pool)
+{
+    struct multi_worker_job *job = pool->free_list;
+    if (job)
+    {
+        pool->free_list = job->next;
+    }
+    else
+    {
+        ALLOC_OBJ_CLEAR(job, struct multi_worker_job);
+        job->storage = alloc_buf(pool->buf_size);
+    }
+    return job;
+}
+
+bool
+multi_worker_dispatch(struct multi_worker_pool *pool,
+                      struct multi_instance *mi,
+                      bool floated)
+{
+    struct context *c = &mi->context;
+    const uint8_t *ptr = BPTR(&c->c2.buf);
+    uint8_t op;
+
+    if (BLEN(&c->c2.buf) < 1)
+    {
+        return false;
+    }
+
+    /* only dispatch data channel packets; control channel packets touch
+     * TLS state that must stay on the main thread.  Their processing
+     * may rotate or free the very keys a queued job decrypts under, so
+     * the instance must be idle on its worker before the caller
+     * proceeds inline. */
+    op = ptr[0] >> P_OPCODE_SHIFT;
+    if (op != P_DATA_V1 && op != P_DATA_V2)
+    {
+        multi_worker_drain_instance(pool, mi);
+        return false;
+    }
+
+    /* backpressure: the completion queue is full.  An idle instance can
+     * fall back to synchronous processing; one with jobs in flight must
+     * not -- the worker may be mid-decrypt in the same key and replay
+     * state -- so its packet is dropped, as the socket buffer would
+     * drop it under the same overload. */
+    if (pool->n_inflight >= MULTI_WORKER_MAX_INFLIGHT)
+    {
+        if (mi->n_worker_jobs > 0)
+        {
+            msg_rl(D_LOW, "WORKER: completion backlog full, dropping packet");
+            return true;
+        }
+        return false;
+    }
+
+    struct multi_worker_job *job = multi_worker_job_new(pool);
+    job->buf = job->storage;
+    ASSERT(buf_init(&job->buf, c->c2.buf.offset));
+    if (!buf_copy(&job->buf, &c->c2.buf))
+    {
+        multi_worker_release_job(pool, job);
+        return false;
+    }
+    job->mi = mi;
+    job->from = c->c2.from;
+    job->floated = floated;
+    job->decrypt_ok = false;
+
+    /* keep the instance alive while the job is in flight */
+    multi_instance_inc_refcount(mi);
+
+    /* per-instance ordering: one instance always maps to one worker */
+    struct multi_worker_thread *wt =
+        &pool->threads[(((uintptr_t) mi) >> 6) % pool->n_threads];
+
+    pthread_mutex_lock(&wt->mutex);
+    job->next = NULL;
+    if (wt->queue_tail)
+    {
+        wt->queue_tail->next = job;
+    }
+    else
+    {
+        wt->queue_head = job;
+    }
+    wt->queue_tail = job;
+    pthread_cond_signal(&wt->cond);
+    pthread_mutex_unlock(&wt->mutex);
+
+    ++pool->n_inflight;
+    ++mi->n_worker_jobs;
+    return true;
+}
+
+/*
+ * Take one job off the completion ring.  This is where a job stops
+ * counting as in flight on its instance: once it sits in the ring the
+ * worker is done with it, and per-instance ordering guarantees the
+ * worker is done with every earlier job of that instance too.
+ */
+static struct multi_worker_job *
+multi_worker_take_completed(struct multi_worker_pool *pool)
+{
+    struct multi_worker_job *job = (struct multi_worker_job *) mpscq_pop(&pool->done);
+
+    if (job)
+    {
+        --job->mi->n_worker_jobs;
+        ASSERT(job->mi->n_worker_jobs >= 0);
+    }
+    return job;
+}
+
+struct multi_worker_job *
+multi_worker_pop_completed(struct multi_worker_pool *pool)
+{
+    struct multi_worker_job *job = pool->deferred_head;
+    if (job)
+    {
+        pool->deferred_head = job->next;
+        if (!pool->deferred_head)
+        {
+            pool->deferred_tail = NULL;
+        }
+        return job;
+    }
+
+    job = multi_worker_take_completed(pool);
+    if (!job)
+    {
+        /* queue fully drained -- eat the pending pipe wakeup */
+        uint8_t drain[16];
+        while (read(pool->notify_fds[0], drain, sizeof(drain)) > 0)
+        {
+        }
+    }
+    return job;
+}
+
+void
+multi_worker_drain_instance(struct multi_worker_pool *pool,
+                            struct multi_instance *mi)
+{
+    while (mi->n_worker_jobs > 0)
+    {
+        struct multi_worker_job *job = multi_worker_take_completed(pool);
+        if (job)
+        {
+            /* park it; the routing stage runs later, in arrival order,
+             * via multi_worker_pop_completed() */
+            job->next = NULL;
+            if (pool->deferred_tail)
+            {
+                pool->deferred_tail->next = job;
+            }
+            else
+            {
+                pool->deferred_head = job;
+            }
+            pool->deferred_tail = job;
+        }
+        else
+        {
+            /* the worker is mid-job; a decrypt takes microseconds */
+            sched_yield();
+        }
+    }
+}
+
+void
+multi_worker_release_job(struct multi_worker_pool *pool,
+                         struct multi_worker_job *job)
+{
+    if (job->mi)
+    {
+        multi_instance_dec_refcount(job->mi);
+        job->mi = NULL;
+        --pool->n_inflight;
+    }
+    job->next = pool->free_list;
+    pool->free_list = job;
+}
+
+int
+multi_worker_completion_fd(const struct multi_worker_pool *pool)
+{
+    return pool->notify_fds[0];
+}
+
+#endif /* ENABLE_WORKER_THREADS */
@@ -0,0 +1,111 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/**
+ * @file
+ * Worker thread pool for the UDP server data path (--worker-threads).
+ *
+ * When enabled, client instance lookup stays on the main event loop
+ * thread, while the CPU-intensive data channel decrypt of incoming
+ * P_DATA packets is dispatched to a pool of worker threads.  Packets
+ * belonging to the same multi_instance are always handled by the same
+ * worker, which preserves per-client packet ordering.  Completed jobs
+ * are handed back to the main thread through a pipe that is registered
+ * with the event set, so routing and all shared-state manipulation
+ * remain single threaded.
+ */
+
+#ifndef MULTI_WORKER_H
+#define MULTI_WORKER_H
+
+#ifdef ENABLE_WORKER_THREADS
+
+#include "basic.h"
+#include "buffer.h"
+#include "socket.h"
+
+struct multi_context;
+struct multi_instance;
+
+/**
+ * A single unit of work for the pool: one incoming link packet
+ * belonging to one client instance.
+ */
+struct multi_worker_job
+{
+    struct multi_worker_job *next;
+
+    struct multi_instance *mi;      /**< instance, refcounted while queued */
+    struct buffer storage;          /**< owned packet storage */
+    struct buffer buf;              /**< packet within storage */
+    struct link_socket_actual from; /**< address of incoming datagram */
+    bool floated;                   /**< peer address possibly floated */
+    bool decrypt_ok;                /**< result of the part1 processing */
+};
+
+/** Maximum number of worker threads accepted by --worker-threads */
+#define MAX_WORKER_THREADS 64
+
+/** Bound on jobs in flight, also sizes the lock-free completion queue */
+#define MULTI_WORKER_MAX_INFLIGHT 1024
+
+struct multi_worker_pool *multi_worker_pool_init(struct multi_context *m,
+                                                 int n_threads);
+
+void multi_worker_pool_free(struct multi_worker_pool *pool);
+
+/**
+ * Try to hand the packet currently held in mi->context.c2.buf over to
+ * the worker owning @p mi.  Returns false if the packet is not
+ * eligible for worker processing (e.g. a control channel packet), in
+ * which case the caller must process it inline as usual.
+ */
+bool multi_worker_dispatch(struct multi_worker_pool *pool,
+                           struct multi_instance *mi,
+                           bool floated);
+
+/**
+ * Pop one completed job, or NULL if none are pending.  Must only be
+ * called from the main thread.
+ */
+struct multi_worker_job *multi_worker_pop_completed(struct multi_worker_pool *pool);
+
+/**
+ * Wait until no worker holds a queued or executing job for @p mi, so
+ * the main thread may safely touch the instance's crypto state (inline
+ * packet processing, key rotation, teardown).  Completed jobs of other
+ * instances popped while waiting are parked and later handed out by
+ * multi_worker_pop_completed() in order.  Main thread only.
+ */
+void multi_worker_drain_instance(struct multi_worker_pool *pool,
+                                 struct multi_instance *mi);
+
+/** Return the job's buffers to the pool free list and drop the instance ref. */
+void multi_worker_release_job(struct multi_worker_pool *pool,
+                              struct multi_worker_job *job);
+
+/** File descriptor to register with the event set (readable on completion). */
+int multi_worker_completion_fd(const struct multi_worker_pool *pool);
+
+#endif /* ENABLE_WORKER_THREADS */
+#endif /* MULTI_WORKER_H */
@@ -51,6 +51,20 @@ net_ctx_free(openvpn_net_ctx_t *ctx)
 {
     (void)ctx;
 }
+
+static inline int
+net_route_batch_start(openvpn_net_ctx_t *ctx)
+{
+    (void)ctx;
+    return 0;
+}
+
+static inline int
+net_route_batch_commit(openvpn_net_ctx_t *ctx)
+{
+    (void)ctx;
+    return 0;
+}
 #endif /* ifdef ENABLE_SITNL */
 
 #if defined(ENABLE_SITNL) || defined(ENABLE_IPROUTE)
@@ -259,6 +273,29 @@ int net_route_v6_del(openvpn_net_ctx_t *ctx, const struct in6_addr *dst,
                      const openvpn_net_iface_t *iface,
                      uint32_t table, int metric);
 
+/**
+ * Start batching route changes.  Until the following
+ * net_route_batch_commit() call, net_route_v4/v6_add/del() requests may
+ * be queued instead of applied and report errors at commit time only.
+ * Implementations without batching support apply each request directly.
+ *
+ * @param ctx       the implementation specific context
+ *
+ * @return          0 on success, a negative error code otherwise
+ */
+int net_route_batch_start(openvpn_net_ctx_t *ctx);
+
+/**
+ * Apply all route changes queued since net_route_batch_start() and stop
+ * batching.
+ *
+ * @param ctx       the implementation specific context
+ *
+ * @return          0 if all queued requests succeeded, a negative error
+ *                  code otherwise
+ */
+int net_route_batch_commit(openvpn_net_ctx_t *ctx);
+
 /**
  * Retrieve the gateway and outgoing interface for the specified IPv4
  * address/network
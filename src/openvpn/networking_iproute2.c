@@ -47,6 +47,7 @@ net_ctx_init(struct context *c, openvpn_net_ctx_t *ctx)
         ctx->es = c->es;
     }
     ctx->gc = gc_new();
+    ctx->batch = NULL;
 
     return 0;
 }
@@ -60,6 +61,8 @@ net_ctx_reset(openvpn_net_ctx_t *ctx)
 void
 net_ctx_free(openvpn_net_ctx_t *ctx)
 {
+    buffer_list_free(ctx->batch);
+    ctx->batch = NULL;
     gc_free(&ctx->gc);
 }
 
@@ -200,6 +203,88 @@ net_addr_ptp_v4_del(openvpn_net_ctx_t *ctx, const char *iface,
     return 0;
 }
 
+int
+net_route_batch_start(openvpn_net_ctx_t *ctx)
+{
+    ASSERT(!ctx->batch);
+    ctx->batch = buffer_list_new(0);
+
+    return 0;
+}
+
+/*
+ * Queue the route command held in 'a' on the current batch, if one is
+ * active.  The iproute_path argv[0] and any "-6" family option are
+ * stripped: a batch file contains plain subcommands, and ip(8) infers
+ * the address family from the prefix format.
+ */
+static bool
+net_route_batch_queue(openvpn_net_ctx_t *ctx, const struct argv *a)
+{
+    struct gc_arena gc;
+    struct buffer out;
+    size_t i = 1;
+
+    if (!ctx->batch)
+    {
+        return false;
+    }
+
+    gc = gc_new();
+    out = alloc_buf_gc(256, &gc);
+    if (i < a->argc && !strcmp(a->argv[i], "-6"))
+    {
+        ++i;
+    }
+    for (; i < a->argc; ++i)
+    {
+        buf_printf(&out, BLEN(&out) ? " %s" : "%s", a->argv[i]);
+    }
+    buffer_list_push(ctx->batch, BSTR(&out));
+
+    gc_free(&gc);
+    return true;
+}
+
+int
+net_route_batch_commit(openvpn_net_ctx_t *ctx)
+{
+    int ret = 0;
+
+    if (ctx->batch)
+    {
+        struct buffer_list *bl = ctx->batch;
+        struct buffer *cmds;
+
+        ctx->batch = NULL;
+
+        buffer_list_aggregate_separator(bl, 1 << 20, "\n");
+        cmds = buffer_list_peek(bl);
+        if (cmds && BLEN(cmds) > 0)
+        {
+            struct argv argv = argv_new();
+
+            /* -force: keep going after a failed command, like the
+             * one-process-per-route path does */
+            argv_printf(&argv, "%s -force -batch -", iproute_path);
+            argv_msg(D_ROUTE, &argv);
+
+            const int status = openvpn_execve_stdin(&argv, ctx->es, 0,
+                                                    (const char *)BPTR(cmds),
+                                                    BLEN(cmds));
+            if (!platform_system_ok(status))
+            {
+                msg(M_WARN, "ERROR: Linux ip -batch command failed");
+                ret = -1;
+            }
+            argv_free(&argv);
+        }
+        buffer_list_free(bl);
+    }
+
+    return ret;
+}
+
 int
 net_route_v4_add(openvpn_net_ctx_t *ctx, const in_addr_t *dst, int prefixlen,
                  const in_addr_t *gw, const char *iface, uint32_t table,
@@ -228,7 +313,10 @@ net_route_v4_add(openvpn_net_ctx_t *ctx, const in_addr_t *dst, int prefixlen,
     }
 
     argv_msg(D_ROUTE, &argv);
-    openvpn_execve_check(&argv, ctx->es, 0, "ERROR: Linux route add command failed");
+    if (!net_route_batch_queue(ctx, &argv))
+    {
+        openvpn_execve_check(&argv, ctx->es, 0, "ERROR: Linux route add command failed");
+    }
 
     argv_free(&argv);
 
@@ -259,7 +347,10 @@ net_route_v6_add(openvpn_net_ctx_t *ctx, const struct in6_addr *dst,
     }
 
     argv_msg(D_ROUTE, &argv);
-    openvpn_execve_check(&argv, ctx->es, 0, "ERROR: Linux route -6 add command failed");
+    if (!net_route_batch_queue(ctx, &argv))
+    {
+        openvpn_execve_check(&argv, ctx->es, 0, "ERROR: Linux route -6 add command failed");
+    }
 
     argv_free(&argv);
 
@@ -282,7 +373,10 @@ net_route_v4_del(openvpn_net_ctx_t *ctx, const in_addr_t *dst, int prefixlen,
     }
 
     argv_msg(D_ROUTE, &argv);
-    openvpn_execve_check(&argv, ctx->es, 0, "ERROR: Linux route delete command failed");
+    if (!net_route_batch_queue(ctx, &argv))
+    {
+        openvpn_execve_check(&argv, ctx->es, 0, "ERROR: Linux route delete command failed");
+    }
 
     argv_free(&argv);
 
@@ -313,7 +407,10 @@ net_route_v6_del(openvpn_net_ctx_t *ctx, const struct in6_addr *dst,
     }
 
     argv_msg(D_ROUTE, &argv);
-    openvpn_execve_check(&argv, ctx->es, 0, "ERROR: Linux route -6 del command failed");
+    if (!net_route_batch_queue(ctx, &argv))
+    {
+        openvpn_execve_check(&argv, ctx->es, 0, "ERROR: Linux route -6 del command failed");
+    }
 
     argv_free(&argv);
 
@@ -30,6 +30,10 @@ struct openvpn_net_ctx
 {
     struct env_set *es;
     struct gc_arena gc;
+
+    /* route commands queued between net_route_batch_start() and
+     * net_route_batch_commit(), run as a single "ip -batch" */
+    struct buffer_list *batch;
 };
 
 typedef struct openvpn_net_ctx openvpn_net_ctx_t;
@@ -828,6 +828,190 @@ sitnl_addr_ptp_del(sa_family_t af_family, const char *iface,
     return sitnl_addr_set(RTM_DELADDR, 0, ifindex, af_family, local, NULL, 0);
 }
 
+/*
+ * Batched route programming: between net_route_batch_start() and
+ * net_route_batch_commit(), route requests are packed into a single
+ * buffer and sent as one netlink datagram followed by one ACK
+ * collection pass, instead of paying a socket round-trip per route.
+ */
+#define SITNL_BATCH_SIZE (32 * 1024)
+
+static struct
+{
+    bool active;
+    int n_msgs;
+    unsigned int seq;
+    size_t len;
+    char buf[SITNL_BATCH_SIZE];
+} sitnl_batch;
+
+static int
+sitnl_batch_flush(void)
+{
+    struct sockaddr_nl nladdr;
+    struct nlmsghdr *h;
+    char buf[1024 * 16];
+    int fd, ret = 0, acked = 0, rcv_len, len, rem_len;
+    const int expected = sitnl_batch.n_msgs;
+    struct iovec iov =
+    {
+        .iov_base = sitnl_batch.buf,
+        .iov_len = sitnl_batch.len,
+    };
+    struct msghdr nlmsg =
+    {
+        .msg_name = &nladdr,
+        .msg_namelen = sizeof(nladdr),
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+    };
+
+    if (!expected)
+    {
+        return 0;
+    }
+
+    sitnl_batch.n_msgs = 0;
+    sitnl_batch.len = 0;
+
+    CLEAR(nladdr);
+    nladdr.nl_family = AF_NETLINK;
+
+    fd = sitnl_socket();
+    if (fd < 0)
+    {
+        msg(M_WARN | M_ERRNO, "%s: can't open rtnl socket", __func__);
+        return -errno;
+    }
+
+    ret = sitnl_bind(fd, 0);
+    if (ret < 0)
+    {
+        msg(M_WARN | M_ERRNO, "%s: can't bind rtnl socket", __func__);
+        ret = -errno;
+        goto out;
+    }
+
+    if (sendmsg(fd, &nlmsg, 0) < 0)
+    {
+        msg(M_WARN | M_ERRNO, "%s: rtnl: error on sendmsg()", __func__);
+        ret = -errno;
+        goto out;
+    }
+
+    iov.iov_base = buf;
+
+    /* collect one ACK (NLMSG_ERROR with error == 0) per queued message */
+    while (acked < expected)
+    {
+        iov.iov_len = sizeof(buf);
+        rcv_len = recvmsg(fd, &nlmsg, 0);
+        if (rcv_len < 0)
+        {
+            if ((errno == EINTR) || (errno == EAGAIN))
+            {
+                continue;
+            }
+            msg(M_WARN | M_ERRNO, "%s: rtnl: error on recvmsg()", __func__);
+            ret = -errno;
+            goto out;
+        }
+        if (rcv_len == 0)
+        {
+            msg(M_WARN, "%s: rtnl: socket reached unexpected EOF", __func__);
+            ret = -EIO;
+            goto out;
+        }
+
+        h = (struct nlmsghdr *)buf;
+        while (rcv_len >= (int)sizeof(*h))
+        {
+            len = h->nlmsg_len;
+            rem_len = len - sizeof(*h);
+
+            if ((rem_len < 0) || (len > rcv_len))
+            {
+                msg(M_WARN, "%s: malformed message: len=%d", __func__, len);
+                ret = -EIO;
+                goto out;
+            }
+
+            if (h->nlmsg_type == NLMSG_ERROR)
+            {
+                struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA(h);
+                if (rem_len < (int)sizeof(struct nlmsgerr))
+                {
+                    msg(M_WARN, "%s: ERROR truncated", __func__);
+                    ret = -EIO;
+                    goto out;
+                }
+                /* tolerate EEXIST like the non-batched path does */
+                if (err->error && err->error != -EEXIST)
+                {
+                    msg(M_WARN, "%s: rtnl: error (%d): %s", __func__,
+                        err->error, strerror(-err->error));
+                    if (!ret)
+                    {
+                        ret = err->error;
+                    }
+                }
+                ++acked;
+            }
+            else
+            {
+                msg(M_WARN, "%s: RTNL: unexpected reply", __func__);
+            }
+
+            rcv_len -= NLMSG_ALIGN(len);
+            h = (struct nlmsghdr *)((char *)h + NLMSG_ALIGN(len));
+        }
+    }
+out:
+    close(fd);
+
+    return ret;
+}
+
+static int
+sitnl_batch_append(struct nlmsghdr *payload)
+{
+    int ret = 0;
+    const size_t aligned = NLMSG_ALIGN(payload->nlmsg_len);
+
+    if (aligned > sizeof(sitnl_batch.buf) - sitnl_batch.len)
+    {
+        ret = sitnl_batch_flush();
+    }
+
+    payload->nlmsg_flags |= NLM_F_ACK;
+    payload->nlmsg_seq = ++sitnl_batch.seq;
+
+    memset(sitnl_batch.buf + sitnl_batch.len, 0, aligned);
+    memcpy(sitnl_batch.buf + sitnl_batch.len, payload, payload->nlmsg_len);
+    sitnl_batch.len += aligned;
+    ++sitnl_batch.n_msgs;
+
+    return ret;
+}
+
+int
+net_route_batch_start(openvpn_net_ctx_t *ctx)
+{
+    ASSERT(!sitnl_batch.active);
+    sitnl_batch.active = true;
+    sitnl_batch.seq = time(NULL);
+
+    return 0;
+}
+
+int
+net_route_batch_commit(openvpn_net_ctx_t *ctx)
+{
+    sitnl_batch.active = false;
+
+    return sitnl_batch_flush();
+}
+
 static int
 sitnl_route_set(int cmd, uint32_t flags, int ifindex, sa_family_t af_family,
                 const void *dst, int prefixlen,
@@ -893,6 +1077,13 @@ sitnl_route_set(int cmd, uint32_t flags, int ifindex, sa_family_t af_family,
         SITNL_ADDATTR(&req.n, sizeof(req), RTA_PRIORITY, &metric, 4);
     }
 
+    if (sitnl_batch.active)
+    {
+        /* queue for net_route_batch_commit(); errors from the kernel are
+         * reported when the batch is flushed */
+        return sitnl_batch_append(&req.n);
+    }
+
     ret = sitnl_send(&req.n, 0, 0, NULL, NULL);
     if (ret == -EEXIST)
     {
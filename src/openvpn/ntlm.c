@@ -39,6 +39,7 @@
 #include "ntlm.h"
 #include "base64.h"
 #include "crypto.h"
+#include "list.h"
 
 #include "memdbg.h"
 
@@ -188,8 +189,99 @@ ntlm_phase_1(const struct http_proxy_info *p, struct gc_arena *gc)
     return (BSTR(&out));
 }
 
+/*
+ * Keyed hash identifying the credentials the cached material in
+ * struct http_proxy_info was derived from, so that credentials
+ * re-queried after an auth failure invalidate the cache.
+ */
+static uint32_t
+ntlm_session_id(const struct http_proxy_info *p)
+{
+    uint32_t id = hash_func((const uint8_t *)p->up.username,
+                            strlen(p->up.username) + 1, 0);
+    id = hash_func((const uint8_t *)p->up.password,
+                   strlen(p->up.password) + 1, id);
+    return hash_func((const uint8_t *)&p->auth_method,
+                     sizeof(p->auth_method), id);
+}
+
+/*
+ * (Re)compute the credential-only NTLM material: user/domain split,
+ * padded MD4 password hash, and the NTLMv2 key or NTLMv1 DES round
+ * keys.  None of it depends on the proxy challenge, so it is cached
+ * on the proxy session and reused across handshake retries -- proxies
+ * that force re-auth on every reconnect otherwise pay the full hash
+ * and key setup each time.
+ */
+static void
+ntlm_session_prime(struct http_proxy_info *p, const uint32_t session_id)
+{
+    char pwbuf[sizeof(p->up.password) * 2]; /* for unicode password */
+    char userdomain_u[256];     /* for uppercase unicode username and domain */
+    char userdomain[128];       /* the same as previous but ascii */
+    char *separator;
+    size_t len;
+
+    /* username parsing */
+    separator = strchr(p->up.username, '\\');
+    if (separator == NULL)
+    {
+        strncpy(p->ntlm_username, p->up.username, sizeof(p->ntlm_username)-1);
+        p->ntlm_username[sizeof(p->ntlm_username)-1] = 0;
+        p->ntlm_domain[0] = 0;
+    }
+    else
+    {
+        strncpy(p->ntlm_username, separator+1, sizeof(p->ntlm_username)-1);
+        p->ntlm_username[sizeof(p->ntlm_username)-1] = 0;
+        len = separator - p->up.username;
+        if (len > sizeof(p->ntlm_domain) - 1)
+        {
+            len = sizeof(p->ntlm_domain) - 1;
+        }
+        strncpy(p->ntlm_domain, p->up.username, len);
+        p->ntlm_domain[len] = 0;
+    }
+
+    /* fill 1st 16 bytes with md4 hash, disregard terminating null */
+    int unicode_len = unicodize(pwbuf, p->up.password) - 2;
+    gen_md4_hash((uint8_t *)pwbuf, unicode_len, p->ntlm_md4_hash);
+
+    /* pad to 21 bytes */
+    memset(p->ntlm_md4_hash + MD4_DIGEST_LENGTH, 0, 5);
+
+    if (p->auth_method == HTTP_AUTH_NTLM2)
+    {
+        /* NTLMv2 hash */
+        strcpy(userdomain, p->ntlm_username);
+        my_strupr(userdomain);
+        if (strlen(p->ntlm_username) + strlen(p->ntlm_domain) < sizeof(userdomain))
+        {
+            strcat(userdomain, p->ntlm_domain);
+        }
+        else
+        {
+            msg(M_INFO, "Warning: Username or domain too long");
+        }
+        unicodize(userdomain_u, userdomain);
+        gen_hmac_md5((uint8_t *)userdomain_u, 2 * strlen(userdomain),
+                     p->ntlm_md4_hash, MD5_DIGEST_LENGTH, p->ntlm_ntlmv2_hash);
+    }
+    else
+    {
+        create_des_keys(p->ntlm_md4_hash, p->ntlm_des_keys[0]);
+        create_des_keys(&p->ntlm_md4_hash[DES_KEY_LENGTH - 1],
+                        p->ntlm_des_keys[1]);
+        create_des_keys(&p->ntlm_md4_hash[2 * (DES_KEY_LENGTH - 1)],
+                        p->ntlm_des_keys[2]);
+    }
+
+    p->ntlm_cache_id = session_id;
+    p->ntlm_cached = true;
+}
+
 const char *
-ntlm_phase_3(const struct http_proxy_info *p, const char *phase_2,
+ntlm_phase_3(struct http_proxy_info *p, const char *phase_2,
              struct gc_arena *gc)
 {
     /* NTLM handshake
@@ -198,27 +290,17 @@ ntlm_phase_3(const struct http_proxy_info *p, const char *phase_2,
      *
      */
 
-    char pwbuf[sizeof(p->up.password) * 2]; /* for unicode password */
     uint8_t buf2[128]; /* decoded reply from proxy */
     uint8_t phase3[464];
 
-    uint8_t md4_hash[MD4_DIGEST_LENGTH + 5];
     uint8_t challenge[8], ntlm_response[24];
     int i, ret_val;
 
     uint8_t ntlmv2_response[144];
-    char userdomain_u[256];     /* for uppercase unicode username and domain */
-    char userdomain[128];       /* the same as previous but ascii */
-    uint8_t ntlmv2_hash[MD5_DIGEST_LENGTH];
     uint8_t ntlmv2_hmacmd5[16];
     uint8_t *ntlmv2_blob = ntlmv2_response + 16;     /* inside ntlmv2_response, length: 128 */
     int ntlmv2_blob_size = 0;
     int phase3_bufpos = 0x40;     /* offset to next security buffer data to be added */
-    size_t len;
-
-    char domain[128];
-    char username[128];
-    char *separator;
 
     bool ntlmv2_enabled = (p->auth_method == HTTP_AUTH_NTLM2);
 
@@ -227,34 +309,12 @@ ntlm_phase_3(const struct http_proxy_info *p, const char *phase_2,
     ASSERT(strlen(p->up.username) > 0);
     ASSERT(strlen(p->up.password) > 0);
 
-    /* username parsing */
-    separator = strchr(p->up.username, '\\');
-    if (separator == NULL)
+    /* credential-only material survives across handshake retries */
+    const uint32_t session_id = ntlm_session_id(p);
+    if (!p->ntlm_cached || p->ntlm_cache_id != session_id)
     {
-        strncpy(username, p->up.username, sizeof(username)-1);
-        username[sizeof(username)-1] = 0;
-        domain[0] = 0;
+        ntlm_session_prime(p, session_id);
     }
-    else
-    {
-        strncpy(username, separator+1, sizeof(username)-1);
-        username[sizeof(username)-1] = 0;
-        len = separator - p->up.username;
-        if (len > sizeof(domain) - 1)
-        {
-            len = sizeof(domain) - 1;
-        }
-        strncpy(domain, p->up.username,  len);
-        domain[len] = 0;
-    }
-
-
-    /* fill 1st 16 bytes with md4 hash, disregard terminating null */
-    int unicode_len = unicodize(pwbuf, p->up.password) - 2;
-    gen_md4_hash((uint8_t *)pwbuf, unicode_len, md4_hash);
-
-    /* pad to 21 bytes */
-    memset(md4_hash + MD4_DIGEST_LENGTH, 0, 5);
 
     ret_val = openvpn_base64_decode(phase_2, buf2, -1);
     if (ret_val < 0)
@@ -275,21 +335,6 @@ ntlm_phase_3(const struct http_proxy_info *p, const char *phase_2,
     {
         int tib_len;
 
-        /* NTLMv2 hash */
-        strcpy(userdomain, username);
-        my_strupr(userdomain);
-        if (strlen(username) + strlen(domain) < sizeof(userdomain))
-        {
-            strcat(userdomain, domain);
-        }
-        else
-        {
-            msg(M_INFO, "Warning: Username or domain too long");
-        }
-        unicodize(userdomain_u, userdomain);
-        gen_hmac_md5((uint8_t *)userdomain_u, 2 * strlen(userdomain), md4_hash,
-                     MD5_DIGEST_LENGTH, ntlmv2_hash);
-
         /* NTLMv2 Blob */
         memset(ntlmv2_blob, 0, 128);                        /* Clear blob buffer */
         ntlmv2_blob[0x00] = 1;                              /* Signature */
@@ -352,8 +397,8 @@ ntlm_phase_3(const struct http_proxy_info *p, const char *phase_2,
         memcpy(&ntlmv2_response[8], challenge, 8);
 
         /* hmac-md5 */
-        gen_hmac_md5(&ntlmv2_response[8], ntlmv2_blob_size + 8, ntlmv2_hash,
-                     MD5_DIGEST_LENGTH, ntlmv2_hmacmd5);
+        gen_hmac_md5(&ntlmv2_response[8], ntlmv2_blob_size + 8,
+                     p->ntlm_ntlmv2_hash, MD5_DIGEST_LENGTH, ntlmv2_hmacmd5);
 
         /* Add hmac-md5 result to the blob.
          * Note: This overwrites challenge previously written at
@@ -362,17 +407,12 @@ ntlm_phase_3(const struct http_proxy_info *p, const char *phase_2,
     }
     else /* Generate NTLM response */
     {
-        unsigned char key1[DES_KEY_LENGTH], key2[DES_KEY_LENGTH];
-        unsigned char key3[DES_KEY_LENGTH];
-
-        create_des_keys(md4_hash, key1);
-        cipher_des_encrypt_ecb(key1, challenge, ntlm_response);
-
-        create_des_keys(&md4_hash[DES_KEY_LENGTH - 1], key2);
-        cipher_des_encrypt_ecb(key2, challenge, &ntlm_response[DES_KEY_LENGTH]);
-
-        create_des_keys(&md4_hash[2 * (DES_KEY_LENGTH - 1)], key3);
-        cipher_des_encrypt_ecb(key3, challenge,
+        /* the DES round keys depend only on the password hash and
+         * come from the session cache */
+        cipher_des_encrypt_ecb(p->ntlm_des_keys[0], challenge, ntlm_response);
+        cipher_des_encrypt_ecb(p->ntlm_des_keys[1], challenge,
+                               &ntlm_response[DES_KEY_LENGTH]);
+        cipher_des_encrypt_ecb(p->ntlm_des_keys[2], challenge,
                                &ntlm_response[DES_KEY_LENGTH * 2]);
     }
 
@@ -393,12 +433,13 @@ ntlm_phase_3(const struct http_proxy_info *p, const char *phase_2,
     }
 
     /* username in ascii */
-    add_security_buffer(0x24, username, strlen(username), phase3,
-                        &phase3_bufpos);
+    add_security_buffer(0x24, p->ntlm_username, strlen(p->ntlm_username),
+                        phase3, &phase3_bufpos);
 
     /* Set domain. If <domain> is empty, default domain will be used
      * (i.e. proxy's domain) */
-    add_security_buffer(0x1c, domain, strlen(domain), phase3, &phase3_bufpos);
+    add_security_buffer(0x1c, p->ntlm_domain, strlen(p->ntlm_domain),
+                        phase3, &phase3_bufpos);
 
     /* other security buffers will be empty */
     phase3[0x10] = phase3_bufpos;     /* lm not used */
@@ -212,6 +212,142 @@ check_send_occ_load_test_dowork(struct context *c)
     }
 }
 
+/*
+ * Binary-search path MTU probe.
+ *
+ * Each round sends an OCC_MTU_LOAD padded to the probe size, followed
+ * immediately by an OCC_MTU_REQUEST.  The peer's OCC_MTU_REPLY carries
+ * the largest packet it has received from us: if that covers the probe
+ * size the probe passed and becomes the new lower bound, otherwise the
+ * probe was dropped on the path and we retry, eventually lowering the
+ * upper bound.  The first round tries the full frame so a correctly
+ * sized link converges in a single round trip.
+ */
+static void
+occ_mtu_probe_send(struct context *c, int size)
+{
+    c->c2.occ_mtu_probe_size = size;
+    c->c2.occ_mtu_load_size = size;
+    c->c2.occ_op = OCC_MTU_LOAD;
+    c->c2.occ_mtu_probe_want_req = true;
+}
+
+static void
+occ_mtu_probe_finish(struct context *c)
+{
+    const int pmtu = c->c2.occ_mtu_probe_lo;
+
+    event_timeout_clear(&c->c2.occ_mtu_probe_interval);
+    c->c2.occ_mtu_probe_size = 0;
+
+    if (pmtu > 0 && pmtu < EXPANDED_SIZE(&c->c2.frame))
+    {
+        msg(M_INFO, "NOTE: path MTU probe converged on %d byte link packets "
+            "(frame allows %d), adjusting frame",
+            pmtu, EXPANDED_SIZE(&c->c2.frame));
+        frame_set_mtu_dynamic(&c->c2.frame, pmtu, SET_MTU_UPPER_BOUND);
+#ifdef ENABLE_FRAGMENT
+        if (c->c2.fragment)
+        {
+            frame_set_mtu_dynamic(&c->c2.frame_fragment, pmtu,
+                                  SET_MTU_UPPER_BOUND);
+        }
+#endif
+    }
+    else if (pmtu > 0)
+    {
+        msg(M_INFO, "NOTE: path MTU probe: full %d byte link packets pass, "
+            "no adjustment needed", pmtu);
+    }
+    else
+    {
+        msg(M_INFO, "NOTE: path MTU probe failed -- no probe was answered "
+            "(peer may predate OCC MTU support)");
+    }
+}
+
+static void
+occ_mtu_probe_step(struct context *c)
+{
+    const int floor_size = EXPANDED_SIZE_MIN(&c->c2.frame);
+    const int lo = max_int(c->c2.occ_mtu_probe_lo, floor_size);
+
+    if (c->c2.occ_mtu_probe_hi - lo <= OCC_MTU_PROBE_PRECISION)
+    {
+        occ_mtu_probe_finish(c);
+        return;
+    }
+    c->c2.occ_mtu_probe_tries = 0;
+    occ_mtu_probe_send(c, (lo + c->c2.occ_mtu_probe_hi + 1) / 2);
+}
+
+/* the current probe size was never answered -- declare it unreachable */
+static void
+occ_mtu_probe_fail_size(struct context *c)
+{
+    c->c2.occ_mtu_probe_hi = c->c2.occ_mtu_probe_size - 1;
+    if (c->c2.occ_mtu_probe_hi <= EXPANDED_SIZE_MIN(&c->c2.frame))
+    {
+        occ_mtu_probe_finish(c);
+        return;
+    }
+    occ_mtu_probe_step(c);
+}
+
+void
+check_send_occ_mtu_probe_dowork(struct context *c)
+{
+    if (!CONNECTION_ESTABLISHED(c))
+    {
+        return;                 /* wait for the link to come up */
+    }
+    if (!c->c2.occ_mtu_probe_size)
+    {
+        c->c2.occ_mtu_probe_lo = 0;
+        c->c2.occ_mtu_probe_hi = EXPANDED_SIZE(&c->c2.frame);
+        c->c2.occ_mtu_probe_tries = 0;
+        occ_mtu_probe_send(c, c->c2.occ_mtu_probe_hi);
+        return;
+    }
+
+    /* a full interval passed without a conclusive reply */
+    if (++c->c2.occ_mtu_probe_tries >= OCC_MTU_PROBE_TRIES)
+    {
+        occ_mtu_probe_fail_size(c);
+    }
+    else
+    {
+        occ_mtu_probe_send(c, c->c2.occ_mtu_probe_size);
+    }
+}
+
+/*
+ * Called on OCC_MTU_REPLY while a probe is outstanding.
+ */
+void
+occ_mtu_probe_reply(struct context *c)
+{
+    if (!event_timeout_defined(&c->c2.occ_mtu_probe_interval)
+        || !c->c2.occ_mtu_probe_size)
+    {
+        return;
+    }
+    if (c->c2.max_recv_size_remote >= c->c2.occ_mtu_probe_size)
+    {
+        c->c2.occ_mtu_probe_lo = c->c2.occ_mtu_probe_size;
+        occ_mtu_probe_step(c);
+    }
+    else if (++c->c2.occ_mtu_probe_tries >= OCC_MTU_PROBE_TRIES)
+    {
+        /* the small query got through while the probe did not */
+        occ_mtu_probe_fail_size(c);
+    }
+    else
+    {
+        occ_mtu_probe_send(c, c->c2.occ_mtu_probe_size);
+    }
+}
+
 void
 check_send_occ_msg_dowork(struct context *c)
 {
@@ -344,12 +480,24 @@ check_send_occ_msg_dowork(struct context *c)
         encrypt_sign(c, true);
     }
 
-    c->c2.occ_op = -1;
+    if (c->c2.occ_mtu_probe_want_req && c->c2.occ_op == OCC_MTU_LOAD)
+    {
+        /* follow a path MTU probe immediately with the size query */
+        c->c2.occ_op = OCC_MTU_REQUEST;
+        c->c2.occ_mtu_probe_want_req = false;
+    }
+    else
+    {
+        c->c2.occ_op = -1;
+    }
 }
 
 void
 process_received_occ_msg(struct context *c)
 {
+    /* most cases below set occ_op, which check_send_occ_msg() must see
+     * on the next pre_select pass */
+    context_wakeup_pre_select(c);
     ASSERT(buf_advance(&c->c2.buf, OCC_STRING_SIZE));
     switch (buf_read_u8(&c->c2.buf))
     {
@@ -392,6 +540,7 @@ process_received_occ_msg(struct context *c)
             dmsg(D_PACKET_CONTENT, "RECEIVED OCC_MTU_REPLY");
             c->c2.max_recv_size_remote = buf_read_u16(&c->c2.buf);
             c->c2.max_send_size_remote = buf_read_u16(&c->c2.buf);
+            occ_mtu_probe_reply(c);
             if (c->options.mtu_test
                 && c->c2.max_recv_size_remote > 0
                 && c->c2.max_send_size_remote > 0)
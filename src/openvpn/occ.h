@@ -61,6 +61,16 @@
  */
 #define OCC_MTU_LOAD_INTERVAL_SECONDS 3
 
+/*
+ * Binary-search path MTU probe (--mtu-probe).  Convergence is driven
+ * by OCC_MTU_REPLY arrivals, so it normally completes within a few
+ * RTTs; the interval timer only resends lost probes and eventually
+ * declares a size unreachable.
+ */
+#define OCC_MTU_PROBE_INTERVAL_SECONDS 1
+#define OCC_MTU_PROBE_TRIES            3   /* sends per size before giving up on it */
+#define OCC_MTU_PROBE_PRECISION        16  /* stop when the bracket is this tight */
+
 /*
  * Send an exit message to remote.
  */
@@ -92,6 +102,10 @@ void check_send_occ_req_dowork(struct context *c);
 
 void check_send_occ_load_test_dowork(struct context *c);
 
+void check_send_occ_mtu_probe_dowork(struct context *c);
+
+void occ_mtu_probe_reply(struct context *c);
+
 void check_send_occ_msg_dowork(struct context *c);
 
 /*
@@ -134,6 +148,21 @@ check_send_occ_load_test(struct context *c)
     }
 }
 
+/*
+ * Should we advance the path MTU probe?
+ */
+static inline void
+check_send_occ_mtu_probe(struct context *c)
+{
+    if (event_timeout_defined(&c->c2.occ_mtu_probe_interval)
+        && event_timeout_trigger(&c->c2.occ_mtu_probe_interval,
+                                 &c->c2.timeval,
+                                 (!TO_LINK_DEF(c) && c->c2.occ_op < 0) ? ETT_DEFAULT : 0))
+    {
+        check_send_occ_mtu_probe_dowork(c);
+    }
+}
+
 /*
  * Should we send an OCC message?
  */
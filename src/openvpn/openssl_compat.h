@@ -799,4 +799,35 @@ SSL_CTX_set_max_proto_version(SSL_CTX *ctx, long tls_ver_max)
 }
 #endif /* SSL_CTX_set_max_proto_version */
 
+#if OPENSSL_VERSION_NUMBER < 0x10100000L \
+    || (defined(LIBRESSL_VERSION_NUMBER) && LIBRESSL_VERSION_NUMBER < 0x2070000fL)
+/*
+ * Custom BIO method support for OpenSSL < 1.1, where BIO and
+ * BIO_METHOD are not opaque yet and the accessor API does not exist.
+ */
+#define BIO_get_data(b)               ((b)->ptr)
+#define BIO_set_data(b, v)            ((b)->ptr = (v))
+#define BIO_set_init(b, v)            ((b)->init = (v))
+
+/** Allocate a BIO method structure, mimics OpenSSL 1.1 BIO_meth_new */
+static inline BIO_METHOD *
+BIO_meth_new(int type, const char *name)
+{
+    BIO_METHOD *biom = calloc(1, sizeof(BIO_METHOD));
+    if (biom)
+    {
+        biom->type = type;
+        biom->name = name;
+    }
+    return biom;
+}
+
+#define BIO_meth_set_write(biom, f)   (((biom)->bwrite = (f)), 1)
+#define BIO_meth_set_read(biom, f)    (((biom)->bread = (f)), 1)
+#define BIO_meth_set_puts(biom, f)    (((biom)->bputs = (f)), 1)
+#define BIO_meth_set_ctrl(biom, f)    (((biom)->ctrl = (f)), 1)
+#define BIO_meth_set_create(biom, f)  (((biom)->create = (f)), 1)
+#define BIO_meth_set_destroy(biom, f) (((biom)->destroy = (f)), 1)
+#endif /* custom BIO method support */
+
 #endif /* OPENSSL_COMPAT_H_ */
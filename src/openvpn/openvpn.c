@@ -32,6 +32,7 @@
 #include "init.h"
 #include "forward.h"
 #include "multi.h"
+#include "gremlin.h"
 #include "win32.h"
 #include "platform.h"
 
@@ -255,6 +256,13 @@ openvpn_main(int argc, char *argv[])
                 write_pid_file(c.options.writepid, c.options.chroot_dir);
             }
 
+#ifdef ENABLE_WORKER_THREADS
+            /* start the deferred log writer once daemonization has
+             * settled -- a thread started earlier would not survive
+             * the daemon() fork */
+            error_log_writer_start();
+#endif
+
 #ifdef ENABLE_MANAGEMENT
             /* open management subsystem */
             if (!open_management(&c))
@@ -315,6 +323,11 @@ openvpn_main(int argc, char *argv[])
 
     context_gc_free(&c);
 
+#ifdef ENABLE_DEBUG
+    /* finalize a --gremlin-capture trace file, if one was written */
+    gremlin_trace_capture_close();
+#endif
+
 #ifdef ENABLE_MANAGEMENT
     /* close management interface */
     close_management();
@@ -46,6 +46,9 @@
 #include "pool.h"
 #include "plugin.h"
 #include "manage.h"
+#ifdef TARGET_LINUX
+#include "dco_linux.h"
+#endif
 
 /*
  * Our global key schedules, packaged thusly
@@ -91,6 +94,11 @@ packet_id_persist_init(struct packet_id_persist *p)
  */
 struct context_buffers
 {
+    /* single backing allocation that all of the buffers below slice up;
+     * buf_size is the per-buffer capacity the arena was built for */
+    uint8_t *arena;
+    int buf_size;
+
     /* miscellaneous buffer, used by ping, occ, etc. */
     struct buffer aux_buf;
 
@@ -118,6 +126,10 @@ struct context_buffers
 struct context_persist
 {
     int restart_sleep_seconds;
+
+    /* frame buffers carried over a SIGUSR1 restart for reuse by
+     * do_init_buffers(), NULL otherwise */
+    struct context_buffers *buffers;
 };
 
 
@@ -174,6 +186,13 @@ struct context_1
     /**< List of routing information. See the
      *   \c --route command line option. */
 
+    bool dhcp_router_extracted;
+    /**< Latch: the DHCP exchange on a TAP
+     *   interface yielded the router address, so
+     *   packets headed for the tun device no
+     *   longer need to be scanned for DHCP ACKs.
+     *   Re-armed when the interface is opened. */
+
     /* list of --route-ipv6 directives */
     struct route_ipv6_list *route_ipv6_list;
 
@@ -249,6 +268,30 @@ struct context_2
     int event_set_max;
     bool event_set_owned;
 
+    /* rwflags currently armed for the link socket and tun device, used
+     * to elide redundant event_ctl() calls on persistent backends such
+     * as epoll; reset to EVENT_UNDEF whenever the event set is created */
+    unsigned int link_set_rwflags;
+    unsigned int tun_set_rwflags;
+
+    /* registration tracking for the remaining io_wait_dowork() event
+     * sources, so that a steady-state iteration issues no event_ctl()
+     * calls at all on persistent backends; reset whenever the event
+     * set is created */
+#ifdef ENABLE_MANAGEMENT
+    unsigned int management_set_state;  /* management_socket_set() persist state */
+#endif
+#ifdef ENABLE_ASYNC_PUSH
+    event_t inotify_set_fd;
+#endif
+#ifdef ENABLE_WORKER_THREADS
+    event_t worker_set_fd;
+#endif
+#ifndef _WIN32
+    event_t tls_async_set_fd;
+    event_t migrate_set_fd;
+#endif
+
     /* event flags returned by io_wait */
 #define SOCKET_READ       (1<<0)
 #define SOCKET_WRITE      (1<<1)
@@ -262,12 +305,24 @@ struct context_2
 #endif
 #ifdef ENABLE_ASYNC_PUSH
 #define FILE_CLOSED       (1<<8)
+#endif
+#ifdef ENABLE_WORKER_THREADS
+#define WORKER_COMPLETED  (1<<10)
+#endif
+#ifndef _WIN32
+#define TLS_ASYNC_READY   (1<<12)
+#define MIGRATE_READ      (1<<14)
 #endif
 
     unsigned int event_set_status;
 
+    int event_drain_budget;   /* remaining --event-drain speculative reads
+                               * before the next mandatory event_wait() */
+    bool link_read_empty;     /* last link read returned no packet */
+
     struct link_socket *link_socket;     /* socket used for TCP/UDP connection to remote */
     bool link_socket_owned;
+    int n_link_failovers;    /* --link-standby migrations done this session */
     struct link_socket_info *link_socket_info;
     const struct link_socket *accept_from; /* possibly do accept() on a parent link_socket */
 
@@ -293,6 +348,32 @@ struct context_2
     struct shaper shaper;
 #endif
 
+    /* 3-band strict-priority staging queue between tun read and
+     * encryption (--prio-queue); NULL when disabled */
+    struct prio_queue *pq;
+
+#ifdef TARGET_LINUX
+    /*
+     * --tun-offload: a coalesced (GSO) TCP super-packet read from the
+     * tun device, and the resegmentation cursor over its payload.
+     * gso_remaining > 0 while MTU-sized segments are still to be cut
+     * from gso_buf and fed through the encrypt path.
+     */
+    struct buffer gso_buf;      /* undefined unless --tun-offload */
+    int gso_hdr_len;            /* ip + tcp header bytes to replicate */
+    int gso_mss;                /* payload bytes per segment */
+    int gso_off;                /* payload bytes already emitted */
+    int gso_remaining;          /* payload bytes still queued */
+#endif
+
+#ifdef TARGET_LINUX
+    /*
+     * Kernel data channel offload: control socket to the offload
+     * module, disabled unless --dco is set and the module is loaded.
+     */
+    struct dco_context dco;
+#endif
+
     /*
      * Statistics
      */
@@ -316,9 +397,11 @@ struct context_2
     struct event_timeout ping_send_interval;
     struct event_timeout ping_rec_interval;
 
-    /* --inactive */
+    /* --inactive: bytes moved since the timeout last expired; bumped
+     * on the per-packet path, sampled and reset only when the timer
+     * fires */
     struct event_timeout inactivity_interval;
-    int inactivity_bytes;
+    counter_type inactivity_bytes;
 
     /* the option strings must match across peers */
     char *options_string_local;
@@ -345,6 +428,22 @@ struct context_2
     struct event_timeout occ_mtu_load_test_interval;
     int occ_mtu_load_n_tries;
 
+    /*
+     * Binary-search path MTU probe state (--mtu-probe).
+     * lo is the largest link packet size confirmed to pass (0 if none
+     * yet), hi the current upper bound of the search bracket.
+     */
+    int occ_mtu_probe_lo;
+    int occ_mtu_probe_hi;
+    int occ_mtu_probe_size;      /* probe size in flight, 0 = none */
+    int occ_mtu_probe_tries;     /* unanswered sends of the current probe */
+    bool occ_mtu_probe_want_req; /* follow the OCC_MTU_LOAD probe with an
+                                  * OCC_MTU_REQUEST */
+    struct event_timeout occ_mtu_probe_interval;
+
+    /* closed-loop frame size tuning (--mtu-tuner) */
+    struct event_timeout mtu_tuner_interval;
+
     /*
      * TLS-mode crypto objects.
      */
@@ -398,6 +497,11 @@ struct context_2
     struct buffer to_tun;
     struct buffer to_link;
 
+    /* DSCP of the inner packet currently being encrypted towards the
+     * link, recorded by process_ip_header() and used for drop priority
+     * when the output queue congests */
+    uint8_t link_dscp;
+
     /* should we print R|W|r|w to console on packet transfers? */
     bool log_rw;
 
@@ -418,6 +522,23 @@ struct context_2
     /* next wakeup for processing coarse timers (>1 sec resolution) */
     time_t coarse_timer_wakeup;
 
+    /* earliest deadline computed by the last full pre_select() pass;
+     * until it expires, pre_select() can skip the per-subsystem timer
+     * checks.  Zeroed whenever an event creates work for one of them. */
+    time_t pre_select_deadline;
+
+    /*
+     * --realtime: housekeeping slicing state.  hk_stage is the next
+     * pre_select() stage to resume (0 = start a full pass), hk_entry
+     * the entry timestamp of the current pass, hk_slices counts passes
+     * cut short by the budget and hk_max_us is the worst observed
+     * housekeeping time in microseconds.
+     */
+    int hk_stage;
+    struct timeval hk_entry;
+    counter_type hk_slices;
+    int hk_max_us;
+
     /* maintain a random delta to add to timeouts to avoid contexts
      * waking up simultaneously */
     time_t update_timeout_random_component;
@@ -486,6 +607,16 @@ struct context_2
 #ifdef ENABLE_ASYNC_PUSH
     int inotify_fd; /* descriptor for monitoring file changes */
 #endif
+
+#ifdef ENABLE_WORKER_THREADS
+    int worker_completion_fd; /* readable when the worker thread pool has
+                               * finished packets, see --worker-threads */
+#endif
+
+#ifndef _WIN32
+    int migrate_fd; /* listening socket for --float-migration sibling
+                     * queries, 0 if unused */
+#endif
 };
 
 
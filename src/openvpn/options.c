@@ -243,7 +243,24 @@ static const char usage_message[] =
     "                  1 -- (default) only call built-ins such as ifconfig\n"
     "                  2 -- allow calling of built-ins and scripts\n"
     "                  3 -- allow password to be passed to scripts via env\n"
-    "--shaper n      : Restrict output to peer to n bytes per second.\n"
+    "--shaper n [burst] : Restrict output to peer to n bytes per second,\n"
+    "                  allowing bursts of up to burst bytes (default: 100 ms\n"
+    "                  worth of traffic).\n"
+    "--shaper-global n [burst] : In server mode, cap aggregate output across\n"
+    "                  all clients to n bytes per second.\n"
+    "--shaper-pacing : Offload --shaper rate limiting to the kernel fq qdisc\n"
+    "                  (SO_MAX_PACING_RATE) when available.\n"
+    "--prio-queue n  : Stage up to n packets per band in a 3-band strict\n"
+    "                  priority queue ahead of encryption, so interactive\n"
+    "                  packets overtake bulk traffic (point-to-point only).\n"
+#ifdef TARGET_LINUX
+    "--dco           : Offload the data channel to the kernel module when it\n"
+    "                  is loaded (Linux, --proto udp point-to-point only).\n"
+    "--udp-prefilter : Drop datagrams that cannot be valid OpenVPN packets in\n"
+    "                  the kernel, before they cost a syscall (Linux, UDP).\n"
+    "--numa-node n   : Prefer NUMA node n for memory allocation, keeping\n"
+    "                  data-path state local to the forwarding cores.\n"
+#endif
     "--keepalive n m : Helper option for setting timeouts in server mode.  Send\n"
     "                  ping once every n seconds, restart if ping not received\n"
     "                  for m seconds.\n"
@@ -254,10 +271,26 @@ static const char usage_message[] =
     "--ping-timer-rem: Run the --ping-exit/--ping-restart timer only if we have a\n"
     "                  remote address.\n"
     "--ping n        : Ping remote once every n seconds over TCP/UDP port.\n"
+    "--link-standby host : On the first --ping-restart expiry, rebind the UDP\n"
+    "                  link to this alternate local address instead of\n"
+    "                  restarting, keeping the session and keys intact.\n"
 #if ENABLE_IP_PKTINFO
     "--multihome     : Configure a multi-homed UDP server.\n"
 #endif
     "--fast-io       : (experimental) Optimize TUN/TAP/UDP writes.\n"
+#ifdef ENABLE_UDP_MMSG
+    "--udp-mmsg n    : (experimental) Batch up to n UDP datagrams per syscall\n"
+    "                  using recvmmsg()/sendmmsg().\n"
+#endif
+    "--event-drain n : (experimental) Attempt up to n speculative link reads\n"
+    "                  before returning to the event wait.\n"
+    "--realtime n    : (experimental) Bound event-loop housekeeping to n\n"
+    "                  microseconds per iteration, slicing control work\n"
+    "                  across iterations to protect data-path latency.\n"
+#ifdef ENABLE_WORKER_THREADS
+    "--worker-threads n : (experimental) Decrypt data channel packets in n\n"
+    "                  worker threads (UDP server mode only).\n"
+#endif
     "--remap-usr1 s  : On SIGUSR1 signals, remap signal (s='SIGHUP' or 'SIGTERM').\n"
     "--persist-tun   : Keep tun/tap device open across SIGUSR1 or --ping-restart.\n"
     "--persist-remote-ip : Keep remote IP address across SIGUSR1 or --ping-restart.\n"
@@ -278,6 +311,10 @@ static const char usage_message[] =
     "                  'maybe' -- Use per-route hints\n"
     "                  'yes'   -- Always DF (Don't Fragment)\n"
     "--mtu-test      : Empirically measure and report MTU.\n"
+    "--mtu-probe     : Binary-search the path MTU right after connect and\n"
+    "                  adjust the frame to the result.\n"
+    "--mtu-tuner     : Keep adjusting the frame and TCP MSS clamp from OS\n"
+    "                  path-MTU hints and fragmentation feedback.\n"
 #ifdef ENABLE_FRAGMENT
     "--fragment max  : Enable internal datagram fragmentation so that no UDP\n"
     "                  datagrams are sent which are larger than max bytes.\n"
@@ -295,6 +332,17 @@ static const char usage_message[] =
     "                  via a VRF present on the system.\n"
 #endif
     "--txqueuelen n  : Set the tun/tap TX queue length to n (Linux only).\n"
+    "--tun-sndbuf n  : Set the tun/tap send buffer size to n (Linux only).\n"
+    "--tun-napi      : Receive packets through a NAPI poll loop in the kernel\n"
+    "                  instead of per-packet softirq work (Linux only).\n"
+    "--tun-queues n  : Open the tun/tap device with n IFF_MULTI_QUEUE queues\n"
+    "                  (Linux only).\n"
+    "--tun-offload   : Enable checksum/TSO offload on the tun device so the\n"
+    "                  kernel delivers coalesced TCP super-packets (Linux only).\n"
+    "--tun-fd-socket path : Receive an already-configured tun device fd from a\n"
+    "                  privileged helper listening on unix socket path, so the\n"
+    "                  main process never needs CAP_NET_ADMIN (Linux only).\n"
+    "                  Implies --ifconfig-noexec.\n"
 #ifdef ENABLE_MEMSTATS
     "--memstats file : Write live usage stats to memory mapped binary file.\n"
 #endif
@@ -351,6 +399,15 @@ static const char usage_message[] =
     "--disable-occ   : Disable options consistency check between peers.\n"
 #ifdef ENABLE_DEBUG
     "--gremlin mask  : Special stress testing mode (for debugging only).\n"
+    "--gremlin-capture file : Record all link reads with timestamps into a\n"
+    "                  binary trace file (for benchmarking only).\n"
+    "--gremlin-replay file : Server mode: replay a captured trace through\n"
+    "                  the incoming packet path instead of reading the\n"
+    "                  socket, then exit (for benchmarking only).\n"
+    "--bench-traffic n size [pps] : Send n synthetic tun packets of the given\n"
+    "                  size (0 selects an IMIX-like mix), optionally rate\n"
+    "                  limited to pps packets/sec, and report data channel\n"
+    "                  throughput (for benchmarking only).\n"
 #endif
 #if defined(USE_COMP)
     "--compress alg  : Use compression algorithm alg\n"
@@ -471,7 +528,28 @@ static const char usage_message[] =
     "--tcp-nodelay   : Macro that sets TCP_NODELAY socket flag on the server\n"
     "                  as well as pushes it to connecting clients.\n"
     "--learn-address cmd : Run command cmd to validate client virtual addresses.\n"
+    "--learn-address-async : Run the --learn-address command once as a\n"
+    "                  long-lived helper and feed it events on stdin,\n"
+    "                  instead of forking it for every address.\n"
     "--connect-freq n s : Allow a maximum of n new connections per s seconds.\n"
+    "--connect-freq-src n [size] : Allow a maximum of n datagrams per second\n"
+    "                  per source IP from unknown peers; excess is dropped\n"
+    "                  silently.  size sets the accounting table slots.\n"
+    "--connect-budget n : Admit at most n new client handshakes per event-loop\n"
+    "                  iteration; excess initiations are deferred to the\n"
+    "                  client's retransmit so established-client traffic\n"
+    "                  keeps flowing during handshake floods.\n"
+    "--float-migration path : Migrate floated clients' data channel state\n"
+    "                  between --socket-flags REUSEPORT server processes over\n"
+    "                  local sockets created at path.<pid>.\n"
+    "--persist-state file : Save established clients' data channel key state\n"
+    "                  to file on shutdown and restore it on startup, so a\n"
+    "                  server restart does not force all clients into\n"
+    "                  simultaneous renegotiation (UDP server only).\n"
+    "--inherit-link-fd n : Adopt the already bound link socket passed as fd n\n"
+    "                  by a supervising process instead of creating and\n"
+    "                  binding a new one.  systemd socket activation\n"
+    "                  (LISTEN_FDS) is detected automatically.\n"
     "--max-clients n : Allow a maximum of n simultaneously connected clients.\n"
     "--max-routes-per-client n : Allow a maximum of n internal routes per client.\n"
     "--stale-routes-check n [t] : Remove routes with a last activity timestamp\n"
@@ -539,15 +617,21 @@ static const char usage_message[] =
 #endif
 #ifndef ENABLE_CRYPTO_MBEDTLS
     "--engine [name] : Enable OpenSSL hardware crypto engine functionality.\n"
+    "--tls-async     : Run TLS handshake crypto asynchronously through the\n"
+    "                  configured OpenSSL async engine (SSL_MODE_ASYNC).\n"
 #endif
     "--no-replay     : (DEPRECATED) Disable replay protection.\n"
     "--mute-replay-warnings : Silence the output of replay warnings to log file.\n"
     "--replay-window n [t]  : Use a replay protection sliding window of size n\n"
     "                         and a time window of t seconds.\n"
     "                         Default n=%d t=%d\n"
+    "--replay-adaptive : Grow the replay window on demand when deep packet\n"
+    "                  reordering is observed.\n"
     "--replay-persist file : Persist replay-protection state across sessions\n"
     "                  using file.\n"
     "--test-crypto   : Run a self-test of crypto features enabled.\n"
+    "--test-crypto-perf n : Additionally run timed encrypt/decrypt workloads\n"
+    "                  of n packets each, reporting pps and p99 latency.\n"
     "                  For debugging only.\n"
 #ifdef ENABLE_PREDICTION_RESISTANCE
     "--use-prediction-resistance: Enable prediction resistance on the random\n"
@@ -634,12 +718,19 @@ static const char usage_message[] =
     "                  client-supplied tls-crypt-v2 client key\n"
     "--askpass [file]: Get PEM password from controlling tty before we daemonize.\n"
     "--auth-nocache  : Don't cache --askpass or --auth-user-pass passwords.\n"
-    "--crl-verify crl ['dir']: Check peer certificate against a CRL.\n"
+    "--crl-verify crl ['dir'|'index']: Check peer certificate against a CRL.\n"
+    "                  With 'index', maintain a sorted, memory-mapped serial\n"
+    "                  number index beside the CRL for O(log n) lookups and\n"
+    "                  incremental reloads of appended entries.\n"
     "--tls-verify cmd: Run command cmd to verify the X509 name of a\n"
     "                  pending TLS connection that has otherwise passed all other\n"
     "                  tests of certification.  cmd should return 0 to allow\n"
     "                  TLS handshake to proceed, or 1 to fail.  (cmd is\n"
     "                  executed as 'cmd certificate_depth subject')\n"
+    "--tls-verify-cache n : Cache successful peer certificate verification\n"
+    "                  results for n seconds, so that a reconnecting client\n"
+    "                  presenting the same certificate skips the external\n"
+    "                  --tls-verify/plugin and CRL checks.\n"
     "--tls-export-cert [directory] : Get peer cert in PEM format and store it \n"
     "                  in an openvpn temporary file in [directory]. Peer cert is \n"
     "                  stored before tls-verify script execution and deleted after.\n"
@@ -730,6 +821,8 @@ static const char usage_message[] =
     "                  on connection initiation.\n"
     "--tap-sleep n   : Sleep for n seconds after TAP adapter open before\n"
     "                  attempting to set adapter properties.\n"
+    "--wintun-spin n : Busy-poll the wintun send ring for up to n iterations\n"
+    "                  before blocking on the driver event (default=0, off).\n"
     "--pause-exit         : When run from a console window, pause before exiting.\n"
     "--service ex [0|1]   : For use when " PACKAGE_NAME " is being instantiated by a\n"
     "                       service, and should not be used directly by end-users.\n"
@@ -819,6 +912,9 @@ init_options(struct options *o, const bool init_gc)
     o->resolve_retry_seconds = RESOLV_RETRY_INFINITE;
     o->resolve_in_advance = false;
     o->proto_force = -1;
+#ifdef TARGET_LINUX
+    o->numa_node = -1;
+#endif
     o->occ = true;
 #ifdef ENABLE_MANAGEMENT
     o->management_log_history_cache = 250;
@@ -854,7 +950,7 @@ init_options(struct options *o, const bool init_gc)
     o->scheduled_exit_interval = 5;
 #endif
     o->ncp_enabled = true;
-    o->ncp_ciphers = "AES-256-GCM:AES-128-GCM";
+    o->ncp_ciphers = ncp_default_ciphers();
     o->authname = "SHA1";
     o->prng_hash = "SHA1";
     o->prng_nonce_secret_len = 16;
@@ -1159,6 +1255,7 @@ show_tuntap_options(const struct tuntap_options *o)
     SHOW_INT(dhcp_masq_offset);
     SHOW_INT(dhcp_lease_time);
     SHOW_INT(tap_sleep);
+    SHOW_INT(wintun_spin);
     SHOW_BOOL(dhcp_options);
     SHOW_BOOL(dhcp_renew);
     SHOW_BOOL(dhcp_pre_release);
@@ -1283,6 +1380,7 @@ show_p2mp_parms(const struct options *o)
     SHOW_INT(virtual_hash_size);
     SHOW_STR(client_connect_script);
     SHOW_STR(learn_address_script);
+    SHOW_BOOL(learn_address_async);
     SHOW_STR(client_disconnect_script);
     SHOW_STR(client_config_dir);
     SHOW_BOOL(ccd_exclusive);
@@ -1297,6 +1395,11 @@ show_p2mp_parms(const struct options *o)
     SHOW_BOOL(duplicate_cn);
     SHOW_INT(cf_max);
     SHOW_INT(cf_per);
+    SHOW_INT(cf_src_rate);
+    SHOW_INT(cf_src_size);
+    SHOW_INT(connect_budget);
+    SHOW_STR(migrate_path);
+    SHOW_STR(persist_state_file);
     SHOW_INT(max_clients);
     SHOW_INT(max_routes_per_client);
     SHOW_STR(auth_user_pass_verify_script);
@@ -1564,8 +1667,20 @@ show_settings(const struct options *o)
 
 #ifdef ENABLE_FEATURE_SHAPER
     SHOW_INT(shaper);
+    SHOW_INT(shaper_burst);
+    SHOW_BOOL(shaper_pacing);
+    SHOW_INT(shaper_global);
+    SHOW_INT(shaper_global_burst);
 #endif
+    SHOW_INT(prio_queue);
     SHOW_INT(mtu_test);
+    SHOW_BOOL(mtu_probe);
+    SHOW_BOOL(mtu_tuner);
+#ifdef TARGET_LINUX
+    SHOW_BOOL(dco);
+    SHOW_BOOL(udp_prefilter);
+    SHOW_INT(numa_node);
+#endif
 
     SHOW_BOOL(mlock);
 
@@ -1575,6 +1690,7 @@ show_settings(const struct options *o)
     SHOW_INT(ping_send_timeout);
     SHOW_INT(ping_rec_timeout);
     SHOW_INT(ping_rec_timeout_action);
+    SHOW_STR(link_standby_local);
     SHOW_BOOL(ping_timer_remote);
     SHOW_INT(remap_sigusr1);
     SHOW_BOOL(persist_tun);
@@ -1612,6 +1728,9 @@ show_settings(const struct options *o)
     SHOW_INT(mute);
 #ifdef ENABLE_DEBUG
     SHOW_INT(gremlin);
+    SHOW_INT(bench_traffic_n);
+    SHOW_INT(bench_traffic_size);
+    SHOW_INT(bench_traffic_pps);
 #endif
     SHOW_STR(status_file);
     SHOW_INT(status_file_version);
@@ -1683,13 +1802,16 @@ show_settings(const struct options *o)
     SHOW_INT(keysize);
 #ifndef ENABLE_CRYPTO_MBEDTLS
     SHOW_BOOL(engine);
+    SHOW_BOOL(tls_async);
 #endif /* ENABLE_CRYPTO_MBEDTLS */
     SHOW_BOOL(replay);
     SHOW_BOOL(mute_replay_warnings);
     SHOW_INT(replay_window);
     SHOW_INT(replay_time);
+    SHOW_BOOL(replay_adaptive);
     SHOW_STR(packet_id_file);
     SHOW_BOOL(test_crypto);
+    SHOW_INT(test_crypto_perf);
 #ifdef ENABLE_PREDICTION_RESISTANCE
     SHOW_BOOL(use_prediction_resistance);
 #endif
@@ -2077,6 +2199,31 @@ options_postprocess_verify_ce(const struct options *options,
         msg(M_USAGE, "--mtu-test only makes sense with --proto udp");
     }
 
+    if (!proto_is_udp(ce->proto) && options->mtu_probe)
+    {
+        msg(M_USAGE, "--mtu-probe only makes sense with --proto udp");
+    }
+
+    if (!proto_is_udp(ce->proto) && options->mtu_tuner)
+    {
+        msg(M_USAGE, "--mtu-tuner only makes sense with --proto udp");
+    }
+
+#ifdef TARGET_LINUX
+    if (options->dco && !proto_is_udp(ce->proto))
+    {
+        msg(M_USAGE, "--dco only makes sense with --proto udp");
+    }
+    if (options->udp_prefilter && !proto_is_udp(ce->proto))
+    {
+        msg(M_USAGE, "--udp-prefilter only makes sense with --proto udp");
+    }
+    if (options->dco && options->mode != MODE_POINT_TO_POINT)
+    {
+        msg(M_USAGE, "--dco is not yet supported in --mode server");
+    }
+#endif
+
     /* will we be pulling options from server? */
 #if P2MP
     pull = options->pull;
@@ -2281,6 +2428,12 @@ options_postprocess_verify_ce(const struct options *options,
             msg(M_USAGE, "--mode server currently only supports "
                 "--proto udp or --proto tcp-server or proto tcp6-server");
         }
+#ifdef ENABLE_WORKER_THREADS
+        if (options->n_worker_threads > 0 && !proto_is_udp(ce->proto))
+        {
+            msg(M_USAGE, "--worker-threads only supports --proto udp");
+        }
+#endif
 #if PORT_SHARE
         if ((options->port_share_host || options->port_share_port)
             && (ce->proto != PROTO_TCP_SERVER))
@@ -2318,10 +2471,6 @@ options_postprocess_verify_ce(const struct options *options,
             msg(M_USAGE, "<connection> cannot be used with --mode server");
         }
 
-        if (options->shaper)
-        {
-            msg(M_USAGE, "--shaper cannot be used with --mode server");
-        }
         if (options->inetd)
         {
             msg(M_USAGE, "--inetd cannot be used with --mode server");
@@ -2342,6 +2491,22 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--connect-freq only works with --mode server --proto udp.  Try --max-clients instead.");
         }
+        if (!proto_is_udp(ce->proto) && options->connect_budget)
+        {
+            msg(M_USAGE, "--connect-budget only works with --mode server --proto udp");
+        }
+        if (!proto_is_udp(ce->proto) && options->cf_src_rate)
+        {
+            msg(M_USAGE, "--connect-freq-src only works with --mode server --proto udp");
+        }
+        if (!proto_is_udp(ce->proto) && options->migrate_path)
+        {
+            msg(M_USAGE, "--float-migration only works with --mode server --proto udp");
+        }
+        if (!proto_is_udp(ce->proto) && options->persist_state_file)
+        {
+            msg(M_USAGE, "--persist-state only works with --mode server --proto udp");
+        }
         if (!(dev == DEV_TYPE_TAP || (dev == DEV_TYPE_TUN && options->topology == TOP_SUBNET)) && options->ifconfig_pool_netmask)
         {
             msg(M_USAGE, "The third parameter to --ifconfig-pool (netmask) is only valid in --dev tap mode");
@@ -2405,6 +2570,10 @@ options_postprocess_verify_ce(const struct options *options,
             }
         }
 
+        if (options->learn_address_async && !options->learn_address_script)
+        {
+            msg(M_USAGE, "--learn-address-async requires --learn-address");
+        }
         if (options->vlan_tagging && dev != DEV_TYPE_TAP)
         {
             msg(M_USAGE, "--vlan-tagging must be used with --dev tap");
@@ -2440,10 +2609,20 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--hash-size requires --mode server");
         }
+#ifdef ENABLE_FEATURE_SHAPER
+        if (options->shaper_global)
+        {
+            msg(M_USAGE, "--shaper-global requires --mode server");
+        }
+#endif
         if (options->learn_address_script)
         {
             msg(M_USAGE, "--learn-address requires --mode server");
         }
+        if (options->learn_address_async)
+        {
+            msg(M_USAGE, "--learn-address-async requires --mode server");
+        }
         if (options->client_connect_script)
         {
             msg(M_USAGE, "--client-connect requires --mode server");
@@ -2464,10 +2643,32 @@ options_postprocess_verify_ce(const struct options *options,
         {
             msg(M_USAGE, "--duplicate-cn requires --mode server");
         }
+#ifdef ENABLE_WORKER_THREADS
+        if (options->n_worker_threads > 0)
+        {
+            msg(M_USAGE, "--worker-threads requires --mode server");
+        }
+#endif
         if (options->cf_max || options->cf_per)
         {
             msg(M_USAGE, "--connect-freq requires --mode server");
         }
+        if (options->cf_src_rate)
+        {
+            msg(M_USAGE, "--connect-freq-src requires --mode server");
+        }
+        if (options->connect_budget)
+        {
+            msg(M_USAGE, "--connect-budget requires --mode server");
+        }
+        if (options->migrate_path)
+        {
+            msg(M_USAGE, "--float-migration requires --mode server");
+        }
+        if (options->persist_state_file)
+        {
+            msg(M_USAGE, "--persist-state requires --mode server");
+        }
         if (options->ssl_flags & (SSLF_CLIENT_CERT_NOT_REQUIRED|SSLF_CLIENT_CERT_OPTIONAL))
         {
             msg(M_USAGE, "--verify-client-cert requires --mode server");
@@ -4745,6 +4946,16 @@ check_inline_file_via_buf(struct buffer *multiline, char *p[],
     return check_inline_file(&is, p, gc);
 }
 
+/*
+ * Option-name test for the dispatch chain in add_option().  The token
+ * length is computed once per directive and checked before the bytes,
+ * so the hundreds of non-matching names on the chain are rejected with
+ * a single integer compare, and the remaining constant-size memcmp()
+ * is inlined by the compiler instead of calling strcmp() per branch.
+ */
+#define streq_opt(name) \
+    (p0len == sizeof(name) - 1 && !memcmp(p[0], (name), sizeof(name) - 1))
+
 static void
 add_option(struct options *options,
            char *p[],
@@ -4867,6 +5078,89 @@ read_config_string(const char *prefix,
     secure_memzero(line, sizeof(line));
 }
 
+/*
+ * Tokenize a multi-line option string once, including resolution of
+ * inline file blocks, so it can be applied repeatedly with
+ * options_import_parsed() without re-running the tokenizer.  Returns
+ * the number of non-empty lines stored in *lines; both the array and
+ * the token strings are allocated in 'gc'.
+ */
+int
+options_parse_string(const char *prefix,
+                     const char *config,
+                     struct parsed_option_line **lines,
+                     const int msglevel,
+                     struct gc_arena *gc)
+{
+    char line[OPTION_LINE_SIZE];
+    struct buffer multiline;
+    int line_num = 0;
+    int n = 0;
+    int max_lines = 1;
+
+    for (const char *s = config; *s; ++s)
+    {
+        if (*s == '\n')
+        {
+            ++max_lines;
+        }
+    }
+    ALLOC_ARRAY_CLEAR_GC(*lines, struct parsed_option_line, max_lines, gc);
+
+    buf_set_read(&multiline, (uint8_t *)config, strlen(config));
+    while (buf_parse(&multiline, '\n', line, sizeof(line)))
+    {
+        char *p[MAX_PARMS+1];
+        CLEAR(p);
+        ++line_num;
+        if (parse_line(line, p, SIZE(p)-1, prefix, line_num, msglevel, gc))
+        {
+            struct parsed_option_line *pl = &(*lines)[n++];
+
+            bypass_doubledash(&p[0]);
+            pl->is_inline = check_inline_file_via_buf(&multiline, p, gc);
+            pl->line_num = line_num;
+            for (int i = 0; i < MAX_PARMS && p[i]; ++i)
+            {
+                pl->parms[pl->nparms++] = p[i];
+            }
+        }
+    }
+    secure_memzero(line, sizeof(line));
+    return n;
+}
+
+/*
+ * Apply lines pre-tokenized by options_parse_string().  Tokens are
+ * duplicated into the options gc arena first: add_option() stores
+ * token pointers into 'options', which must outlive whatever arena
+ * the cached tokens came from.
+ */
+void
+options_import_parsed(struct options *options,
+                      const struct parsed_option_line *lines,
+                      int n_lines,
+                      const char *prefix,
+                      const int msglevel,
+                      const unsigned int permission_mask,
+                      unsigned int *option_types_found,
+                      struct env_set *es)
+{
+    for (int i = 0; i < n_lines; ++i)
+    {
+        const struct parsed_option_line *pl = &lines[i];
+        char *p[MAX_PARMS+1];
+        CLEAR(p);
+        for (int j = 0; j < pl->nparms; ++j)
+        {
+            p[j] = string_alloc(pl->parms[j], &options->gc);
+        }
+        add_option(options, p, pl->is_inline, prefix, pl->line_num, 0,
+                   msglevel, permission_mask, option_types_found, es);
+        CLEAR(p);
+    }
+}
+
 void
 parse_argv(struct options *options,
            const int argc,
@@ -5234,7 +5528,12 @@ add_option(struct options *options,
         file = "[CMD-LINE]";
         line = 1;
     }
-    if (streq(p[0], "help"))
+
+    /* token length for the streq_opt() length-prefiltered compares,
+     * computed after the "setenv opt" prefix may have advanced p */
+    const size_t p0len = strlen(p[0]);
+
+    if (streq_opt("help"))
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         usage();
@@ -5244,12 +5543,12 @@ add_option(struct options *options,
             goto err;
         }
     }
-    if (streq(p[0], "version") && !p[1])
+    if (streq_opt("version") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         usage_version();
     }
-    else if (streq(p[0], "config") && p[1] && !p[2])
+    else if (streq_opt("config") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_CONFIG);
 
@@ -5262,7 +5561,7 @@ add_option(struct options *options,
         read_config_file(options, p[1], level, file, line, msglevel, permission_mask, option_types_found, es);
     }
 #if defined(ENABLE_DEBUG) && !defined(ENABLE_SMALL)
-    else if (streq(p[0], "show-gateway") && !p[2])
+    else if (streq_opt("show-gateway") && !p[2])
     {
         struct route_gateway_info rgi;
         struct route_ipv6_gateway_info rgi6;
@@ -5281,13 +5580,13 @@ add_option(struct options *options,
     }
 #endif
 #if 0
-    else if (streq(p[0], "foreign-option") && p[1])
+    else if (streq_opt("foreign-option") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_IPWIN32);
         foreign_option(options, p, 3, es);
     }
 #endif
-    else if (streq(p[0], "echo") || streq(p[0], "parameter"))
+    else if (streq_opt("echo") || streq_opt("parameter"))
     {
         struct buffer string = alloc_buf_gc(OPTION_PARM_SIZE, &gc);
         int j;
@@ -5329,7 +5628,7 @@ add_option(struct options *options,
         }
     }
 #ifdef ENABLE_MANAGEMENT
-    else if (streq(p[0], "management") && p[1] && p[2] && !p[4])
+    else if (streq_opt("management") && p[1] && p[2] && !p[4])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[2], "unix"))
@@ -5349,59 +5648,59 @@ add_option(struct options *options,
             options->management_user_pass = p[3];
         }
     }
-    else if (streq(p[0], "management-client-user") && p[1] && !p[2])
+    else if (streq_opt("management-client-user") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_client_user = p[1];
     }
-    else if (streq(p[0], "management-client-group") && p[1] && !p[2])
+    else if (streq_opt("management-client-group") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_client_group = p[1];
     }
-    else if (streq(p[0], "management-query-passwords") && !p[1])
+    else if (streq_opt("management-query-passwords") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_QUERY_PASSWORDS;
     }
-    else if (streq(p[0], "management-query-remote") && !p[1])
+    else if (streq_opt("management-query-remote") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_QUERY_REMOTE;
     }
-    else if (streq(p[0], "management-query-proxy") && !p[1])
+    else if (streq_opt("management-query-proxy") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_QUERY_PROXY;
     }
-    else if (streq(p[0], "management-hold") && !p[1])
+    else if (streq_opt("management-hold") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_HOLD;
     }
-    else if (streq(p[0], "management-signal") && !p[1])
+    else if (streq_opt("management-signal") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_SIGNAL;
     }
-    else if (streq(p[0], "management-forget-disconnect") && !p[1])
+    else if (streq_opt("management-forget-disconnect") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_FORGET_DISCONNECT;
     }
-    else if (streq(p[0], "management-up-down") && !p[1])
+    else if (streq_opt("management-up-down") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_UP_DOWN;
     }
-    else if (streq(p[0], "management-client") && !p[2])
+    else if (streq_opt("management-client") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_CONNECT_AS_CLIENT;
         options->management_write_peer_info_file = p[1];
     }
 #ifdef ENABLE_MANAGEMENT
-    else if (streq(p[0], "management-external-key"))
+    else if (streq_opt("management-external-key"))
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         for (int j = 1; j < MAX_PARMS && p[j] != NULL; ++j)
@@ -5430,26 +5729,26 @@ add_option(struct options *options,
         }
         options->management_flags |= MF_EXTERNAL_KEY;
     }
-    else if (streq(p[0], "management-external-cert") && p[1] && !p[2])
+    else if (streq_opt("management-external-cert") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_EXTERNAL_CERT;
         options->management_certificate = p[1];
     }
-    else if (streq(p[0], "management-client-auth") && !p[1])
+    else if (streq_opt("management-client-auth") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= MF_CLIENT_AUTH;
     }
 #endif /* ifdef ENABLE_MANAGEMENT */
 #ifdef MANAGEMENT_PF
-    else if (streq(p[0], "management-client-pf") && !p[1])
+    else if (streq_opt("management-client-pf") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->management_flags |= (MF_CLIENT_PF | MF_CLIENT_AUTH);
     }
 #endif
-    else if (streq(p[0], "management-log-cache") && p[1] && !p[2])
+    else if (streq_opt("management-log-cache") && p[1] && !p[2])
     {
         int cache;
 
@@ -5464,7 +5763,7 @@ add_option(struct options *options,
     }
 #endif /* ifdef ENABLE_MANAGEMENT */
 #ifdef ENABLE_PLUGIN
-    else if (streq(p[0], "plugin") && p[1])
+    else if (streq_opt("plugin") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_PLUGIN);
         if (!options->plugin_list)
@@ -5478,7 +5777,7 @@ add_option(struct options *options,
         }
     }
 #endif
-    else if (streq(p[0], "mode") && p[1] && !p[2])
+    else if (streq_opt("mode") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[1], "p2p"))
@@ -5495,29 +5794,29 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "dev") && p[1] && !p[2])
+    else if (streq_opt("dev") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->dev = p[1];
     }
-    else if (streq(p[0], "dev-type") && p[1] && !p[2])
+    else if (streq_opt("dev-type") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->dev_type = p[1];
     }
 #ifdef _WIN32
-    else if (streq(p[0], "windows-driver") && p[1] && !p[2])
+    else if (streq_opt("windows-driver") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->windows_driver = parse_windows_driver(p[1], M_FATAL);
     }
 #endif
-    else if (streq(p[0], "dev-node") && p[1] && !p[2])
+    else if (streq_opt("dev-node") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->dev_node = p[1];
     }
-    else if (streq(p[0], "lladdr") && p[1] && !p[2])
+    else if (streq_opt("lladdr") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_UP);
         if (mac_addr_safe(p[1])) /* MAC address only */
@@ -5530,12 +5829,12 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "topology") && p[1] && !p[2])
+    else if (streq_opt("topology") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_UP);
         options->topology = parse_topology(p[1], msglevel);
     }
-    else if (streq(p[0], "tun-ipv6") && !p[1])
+    else if (streq_opt("tun-ipv6") && !p[1])
     {
         if (!pull_mode)
         {
@@ -5543,13 +5842,13 @@ add_option(struct options *options,
         }
     }
 #ifdef ENABLE_IPROUTE
-    else if (streq(p[0], "iproute") && p[1] && !p[2])
+    else if (streq_opt("iproute") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         iproute_path = p[1];
     }
 #endif
-    else if (streq(p[0], "ifconfig") && p[1] && p[2] && !p[3])
+    else if (streq_opt("ifconfig") && p[1] && p[2] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_UP);
         if (ip_or_dns_addr_safe(p[1], options->allow_pull_fqdn) && ip_or_dns_addr_safe(p[2], options->allow_pull_fqdn)) /* FQDN -- may be DNS name */
@@ -5563,7 +5862,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "ifconfig-ipv6") && p[1] && p[2] && !p[3])
+    else if (streq_opt("ifconfig-ipv6") && p[1] && p[2] && !p[3])
     {
         unsigned int netbits;
 
@@ -5587,27 +5886,27 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "ifconfig-noexec") && !p[1])
+    else if (streq_opt("ifconfig-noexec") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_UP);
         options->ifconfig_noexec = true;
     }
-    else if (streq(p[0], "ifconfig-nowarn") && !p[1])
+    else if (streq_opt("ifconfig-nowarn") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_UP);
         options->ifconfig_nowarn = true;
     }
-    else if (streq(p[0], "local") && p[1] && !p[2])
+    else if (streq_opt("local") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.local = p[1];
     }
-    else if (streq(p[0], "remote-random") && !p[1])
+    else if (streq_opt("remote-random") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->remote_random = true;
     }
-    else if (streq(p[0], "connection") && p[1] && !p[3])
+    else if (streq_opt("connection") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         if (is_inline)
@@ -5637,7 +5936,7 @@ add_option(struct options *options,
             uninit_options(&sub);
         }
     }
-    else if (streq(p[0], "ignore-unknown-option") && p[1])
+    else if (streq_opt("ignore-unknown-option") && p[1])
     {
         int i;
         int j;
@@ -5685,7 +5984,7 @@ add_option(struct options *options,
         options->ignore_unknown_option[i] = NULL;
     }
 #if ENABLE_MANAGEMENT
-    else if (streq(p[0], "http-proxy-override") && p[1] && p[2] && !p[4])
+    else if (streq_opt("http-proxy-override") && p[1] && p[2] && !p[4])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->http_proxy_override = parse_http_proxy_override(p[1], p[2], p[3], msglevel, &options->gc);
@@ -5695,7 +5994,7 @@ add_option(struct options *options,
         }
     }
 #endif
-    else if (streq(p[0], "remote") && p[1] && !p[4])
+    else if (streq_opt("remote") && p[1] && !p[4])
     {
         struct remote_entry re;
         re.remote = re.remote_port = NULL;
@@ -5736,7 +6035,7 @@ add_option(struct options *options,
             connection_entry_load_re(&options->ce, &re);
         }
     }
-    else if (streq(p[0], "resolv-retry") && p[1] && !p[2])
+    else if (streq_opt("resolv-retry") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[1], "infinite"))
@@ -5748,7 +6047,7 @@ add_option(struct options *options,
             options->resolve_retry_seconds = positive_atoi(p[1]);
         }
     }
-    else if ((streq(p[0], "preresolve") || streq(p[0], "ip-remote-hint")) && !p[2])
+    else if ((streq_opt("preresolve") || streq_opt("ip-remote-hint")) && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->resolve_in_advance = true;
@@ -5759,7 +6058,7 @@ add_option(struct options *options,
             options->ip_remote_hint = p[1];
         }
     }
-    else if (streq(p[0], "connect-retry") && p[1] && !p[3])
+    else if (streq_opt("connect-retry") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.connect_retry_seconds = positive_atoi(p[1]);
@@ -5780,18 +6079,18 @@ add_option(struct options *options,
                 max_int(positive_atoi(p[2]), options->ce.connect_retry_seconds);
         }
     }
-    else if ((streq(p[0], "connect-timeout") || streq(p[0], "server-poll-timeout"))
+    else if ((streq_opt("connect-timeout") || streq_opt("server-poll-timeout"))
              && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.connect_timeout = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "connect-retry-max") && p[1] && !p[2])
+    else if (streq_opt("connect-retry-max") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->connect_retry_max = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "ipchange") && p[1])
+    else if (streq_opt("ipchange") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -5803,24 +6102,44 @@ add_option(struct options *options,
                         string_substitute(p[1], ',', ' ', &options->gc),
                         "ipchange", true);
     }
-    else if (streq(p[0], "float") && !p[1])
+    else if (streq_opt("float") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.remote_float = true;
     }
 #ifdef ENABLE_DEBUG
-    else if (streq(p[0], "gremlin") && p[1] && !p[2])
+    else if (streq_opt("gremlin") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->gremlin = positive_atoi(p[1]);
     }
+    else if (streq_opt("gremlin-capture") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->gremlin_capture = p[1];
+    }
+    else if (streq_opt("gremlin-replay") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->gremlin_replay = p[1];
+    }
+    else if (streq_opt("bench-traffic") && p[1] && p[2] && !p[4])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->bench_traffic_n = positive_atoi(p[1]);
+        options->bench_traffic_size = positive_atoi(p[2]);
+        if (p[3])
+        {
+            options->bench_traffic_pps = positive_atoi(p[3]);
+        }
+    }
 #endif
-    else if (streq(p[0], "chroot") && p[1] && !p[2])
+    else if (streq_opt("chroot") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->chroot_dir = p[1];
     }
-    else if (streq(p[0], "cd") && p[1] && !p[2])
+    else if (streq_opt("cd") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (platform_chdir(p[1]))
@@ -5831,18 +6150,18 @@ add_option(struct options *options,
         options->cd_dir = p[1];
     }
 #ifdef ENABLE_SELINUX
-    else if (streq(p[0], "setcon") && p[1] && !p[2])
+    else if (streq_opt("setcon") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->selinux_context = p[1];
     }
 #endif
-    else if (streq(p[0], "writepid") && p[1] && !p[2])
+    else if (streq_opt("writepid") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->writepid = p[1];
     }
-    else if (streq(p[0], "up") && p[1])
+    else if (streq_opt("up") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -5851,7 +6170,7 @@ add_option(struct options *options,
         }
         set_user_script(options, &options->up_script, p[1], "up", false);
     }
-    else if (streq(p[0], "down") && p[1])
+    else if (streq_opt("down") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -5860,27 +6179,27 @@ add_option(struct options *options,
         }
         set_user_script(options, &options->down_script, p[1], "down", true);
     }
-    else if (streq(p[0], "down-pre") && !p[1])
+    else if (streq_opt("down-pre") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->down_pre = true;
     }
-    else if (streq(p[0], "up-delay") && !p[1])
+    else if (streq_opt("up-delay") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->up_delay = true;
     }
-    else if (streq(p[0], "up-restart") && !p[1])
+    else if (streq_opt("up-restart") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->up_restart = true;
     }
-    else if (streq(p[0], "syslog") && !p[2])
+    else if (streq_opt("syslog") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         open_syslog(p[1], false);
     }
-    else if (streq(p[0], "daemon") && !p[2])
+    else if (streq_opt("daemon") && !p[2])
     {
         bool didit = false;
         VERIFY_PERMISSION(OPT_P_GENERAL);
@@ -5898,7 +6217,7 @@ add_option(struct options *options,
             }
         }
     }
-    else if (streq(p[0], "inetd") && !p[3])
+    else if (streq_opt("inetd") && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (!options->inetd)
@@ -5959,50 +6278,50 @@ add_option(struct options *options,
             open_syslog(name, true);
         }
     }
-    else if (streq(p[0], "log") && p[1] && !p[2])
+    else if (streq_opt("log") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->log = true;
         redirect_stdout_stderr(p[1], false);
     }
-    else if (streq(p[0], "suppress-timestamps") && !p[1])
+    else if (streq_opt("suppress-timestamps") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->suppress_timestamps = true;
         set_suppress_timestamps(true);
     }
-    else if (streq(p[0], "machine-readable-output") && !p[1])
+    else if (streq_opt("machine-readable-output") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->machine_readable_output = true;
         set_machine_readable_output(true);
     }
-    else if (streq(p[0], "log-append") && p[1] && !p[2])
+    else if (streq_opt("log-append") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->log = true;
         redirect_stdout_stderr(p[1], true);
     }
 #ifdef ENABLE_MEMSTATS
-    else if (streq(p[0], "memstats") && p[1] && !p[2])
+    else if (streq_opt("memstats") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->memstats_fn = p[1];
     }
 #endif
-    else if (streq(p[0], "mlock") && !p[1])
+    else if (streq_opt("mlock") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->mlock = true;
     }
 #if ENABLE_IP_PKTINFO
-    else if (streq(p[0], "multihome") && !p[1])
+    else if (streq_opt("multihome") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->sockflags |= SF_USE_IP_PKTINFO;
     }
 #endif
-    else if (streq(p[0], "verb") && p[1] && !p[2])
+    else if (streq_opt("verb") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_MESSAGES);
         options->verbosity = positive_atoi(p[1]);
@@ -6015,17 +6334,17 @@ add_option(struct options *options,
         }
 #endif
     }
-    else if (streq(p[0], "mute") && p[1] && !p[2])
+    else if (streq_opt("mute") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_MESSAGES);
         options->mute = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "errors-to-stderr") && !p[1])
+    else if (streq_opt("errors-to-stderr") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_MESSAGES);
         errors_to_stderr();
     }
-    else if (streq(p[0], "status") && p[1] && !p[3])
+    else if (streq_opt("status") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->status_file = p[1];
@@ -6034,7 +6353,7 @@ add_option(struct options *options,
             options->status_file_update_freq = positive_atoi(p[2]);
         }
     }
-    else if (streq(p[0], "status-version") && p[1] && !p[2])
+    else if (streq_opt("status-version") && p[1] && !p[2])
     {
         int version;
 
@@ -6047,7 +6366,7 @@ add_option(struct options *options,
         }
         options->status_file_version = version;
     }
-    else if (streq(p[0], "remap-usr1") && p[1] && !p[2])
+    else if (streq_opt("remap-usr1") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[1], "SIGHUP"))
@@ -6064,71 +6383,81 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if ((streq(p[0], "link-mtu") || streq(p[0], "udp-mtu")) && p[1] && !p[2])
+    else if ((streq_opt("link-mtu") || streq_opt("udp-mtu")) && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_MTU|OPT_P_CONNECTION);
         options->ce.link_mtu = positive_atoi(p[1]);
         options->ce.link_mtu_defined = true;
     }
-    else if (streq(p[0], "tun-mtu") && p[1] && !p[2])
+    else if (streq_opt("tun-mtu") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_MTU|OPT_P_CONNECTION);
         options->ce.tun_mtu = positive_atoi(p[1]);
         options->ce.tun_mtu_defined = true;
     }
-    else if (streq(p[0], "tun-mtu-extra") && p[1] && !p[2])
+    else if (streq_opt("tun-mtu-extra") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_MTU|OPT_P_CONNECTION);
         options->ce.tun_mtu_extra = positive_atoi(p[1]);
         options->ce.tun_mtu_extra_defined = true;
     }
 #ifdef ENABLE_FRAGMENT
-    else if (streq(p[0], "mtu-dynamic"))
+    else if (streq_opt("mtu-dynamic"))
     {
         VERIFY_PERMISSION(OPT_P_MTU|OPT_P_CONNECTION);
         msg(msglevel, "--mtu-dynamic has been replaced by --fragment");
         goto err;
     }
-    else if (streq(p[0], "fragment") && p[1] && !p[2])
+    else if (streq_opt("fragment") && p[1] && !p[2])
     {
 /*      VERIFY_PERMISSION (OPT_P_MTU); */
         VERIFY_PERMISSION(OPT_P_MTU|OPT_P_CONNECTION);
         options->ce.fragment = positive_atoi(p[1]);
     }
 #endif
-    else if (streq(p[0], "mtu-disc") && p[1] && !p[2])
+    else if (streq_opt("mtu-disc") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_MTU|OPT_P_CONNECTION);
         options->ce.mtu_discover_type = translate_mtu_discover_type_name(p[1]);
     }
-    else if (streq(p[0], "mtu-test") && !p[1])
+    else if (streq_opt("mtu-test") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->mtu_test = true;
     }
-    else if (streq(p[0], "nice") && p[1] && !p[2])
+    else if (streq_opt("mtu-probe") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->mtu_probe = true;
+    }
+    else if (streq_opt("mtu-tuner") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->mtu_tuner = true;
+    }
+    else if (streq_opt("nice") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_NICE);
         options->nice = atoi(p[1]);
     }
-    else if (streq(p[0], "rcvbuf") && p[1] && !p[2])
+    else if (streq_opt("rcvbuf") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_SOCKBUF);
         options->rcvbuf = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "sndbuf") && p[1] && !p[2])
+    else if (streq_opt("sndbuf") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_SOCKBUF);
         options->sndbuf = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "mark") && p[1] && !p[2])
+    else if (streq_opt("mark") && p[1] && !p[2])
     {
 #if defined(TARGET_LINUX) && HAVE_DECL_SO_MARK
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->mark = atoi(p[1]);
 #endif
     }
-    else if (streq(p[0], "socket-flags"))
+    else if (streq_opt("socket-flags"))
     {
         int j;
         VERIFY_PERMISSION(OPT_P_SOCKFLAGS);
@@ -6138,6 +6467,10 @@ add_option(struct options *options,
             {
                 options->sockflags |= SF_TCP_NODELAY;
             }
+            else if (streq(p[j], "REUSEPORT"))
+            {
+                options->sockflags |= SF_REUSEPORT;
+            }
             else
             {
                 msg(msglevel, "unknown socket flag: %s", p[j]);
@@ -6151,7 +6484,7 @@ add_option(struct options *options,
         options->bind_dev = p[1];
     }
 #endif
-    else if (streq(p[0], "txqueuelen") && p[1] && !p[2])
+    else if (streq_opt("txqueuelen") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
 #ifdef TARGET_LINUX
@@ -6161,7 +6494,67 @@ add_option(struct options *options,
         goto err;
 #endif
     }
-    else if (streq(p[0], "shaper") && p[1] && !p[2])
+    else if (streq_opt("tun-sndbuf") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef TARGET_LINUX
+        options->tuntap_options.sndbuf = positive_atoi(p[1]);
+#else
+        msg(msglevel, "--tun-sndbuf not supported on this OS");
+        goto err;
+#endif
+    }
+    else if (streq_opt("tun-queues") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef TARGET_LINUX
+        int queues = positive_atoi(p[1]);
+        if (queues < 1 || queues > TUN_MAX_QUEUES)
+        {
+            msg(msglevel, "--tun-queues parameter must be between 1 and %d",
+                TUN_MAX_QUEUES);
+            goto err;
+        }
+        options->tuntap_options.n_queues = queues;
+#else
+        msg(msglevel, "--tun-queues not supported on this OS");
+        goto err;
+#endif
+    }
+    else if (streq_opt("tun-napi") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef TARGET_LINUX
+        options->tuntap_options.napi = true;
+#else
+        msg(msglevel, "--tun-napi not supported on this OS");
+        goto err;
+#endif
+    }
+    else if (streq_opt("tun-fd-socket") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef TARGET_LINUX
+        options->tuntap_options.fd_socket = p[1];
+        /* the helper owns interface configuration; behave as if
+         * --ifconfig-noexec had been given */
+        options->ifconfig_noexec = true;
+#else
+        msg(msglevel, "--tun-fd-socket not supported on this OS");
+        goto err;
+#endif
+    }
+    else if (streq_opt("tun-offload") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef TARGET_LINUX
+        options->tuntap_options.offload = true;
+#else
+        msg(msglevel, "--tun-offload not supported on this OS");
+        goto err;
+#endif
+    }
+    else if (streq_opt("shaper") && p[1] && !p[3])
     {
 #ifdef ENABLE_FEATURE_SHAPER
         int shaper;
@@ -6175,29 +6568,128 @@ add_option(struct options *options,
             goto err;
         }
         options->shaper = shaper;
+        if (p[2])
+        {
+            const int burst = atoi(p[2]);
+            if (burst <= 0)
+            {
+                msg(msglevel, "Bad shaper burst value, must be positive");
+                goto err;
+            }
+            options->shaper_burst = burst;
+        }
 #else /* ENABLE_FEATURE_SHAPER */
         VERIFY_PERMISSION(OPT_P_GENERAL);
         msg(msglevel, "--shaper requires the gettimeofday() function which is missing");
         goto err;
 #endif /* ENABLE_FEATURE_SHAPER */
     }
-    else if (streq(p[0], "port") && p[1] && !p[2])
+    else if (streq_opt("shaper-global") && p[1] && !p[3])
+    {
+#ifdef ENABLE_FEATURE_SHAPER
+        int shaper;
+
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        shaper = atoi(p[1]);
+        if (shaper < SHAPER_MIN || shaper > SHAPER_MAX)
+        {
+            msg(msglevel, "Bad shaper-global value, must be between %d and %d",
+                SHAPER_MIN, SHAPER_MAX);
+            goto err;
+        }
+        options->shaper_global = shaper;
+        if (p[2])
+        {
+            const int burst = atoi(p[2]);
+            if (burst <= 0)
+            {
+                msg(msglevel, "Bad shaper-global burst value, must be positive");
+                goto err;
+            }
+            options->shaper_global_burst = burst;
+        }
+#else /* ENABLE_FEATURE_SHAPER */
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        msg(msglevel, "--shaper-global requires the gettimeofday() function which is missing");
+        goto err;
+#endif /* ENABLE_FEATURE_SHAPER */
+    }
+    else if (streq_opt("prio-queue") && p[1] && !p[2])
+    {
+        int prio_queue;
+
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        prio_queue = atoi(p[1]);
+        if (prio_queue < 1)
+        {
+            msg(msglevel, "--prio-queue parameter must be > 0");
+            goto err;
+        }
+        options->prio_queue = prio_queue;
+    }
+    else if (streq_opt("shaper-pacing") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef ENABLE_FEATURE_SHAPER
+        options->shaper_pacing = true;
+#else
+        msg(msglevel, "--shaper-pacing requires the gettimeofday() function which is missing");
+        goto err;
+#endif
+    }
+    else if (streq_opt("dco") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef TARGET_LINUX
+        options->dco = true;
+#else
+        msg(msglevel, "--dco is only supported on Linux");
+        goto err;
+#endif
+    }
+    else if (streq_opt("udp-prefilter") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef TARGET_LINUX
+        options->udp_prefilter = true;
+#else
+        msg(msglevel, "--udp-prefilter is only supported on Linux");
+        goto err;
+#endif
+    }
+    else if (streq_opt("numa-node") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+#ifdef TARGET_LINUX
+        const int node = atoi(p[1]);
+        if (node < 0)
+        {
+            msg(msglevel, "--numa-node must be >= 0");
+            goto err;
+        }
+        options->numa_node = node;
+#else
+        msg(msglevel, "--numa-node is only supported on Linux");
+        goto err;
+#endif
+    }
+    else if (streq_opt("port") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.local_port = options->ce.remote_port = p[1];
     }
-    else if (streq(p[0], "lport") && p[1] && !p[2])
+    else if (streq_opt("lport") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.local_port_defined = true;
         options->ce.local_port = p[1];
     }
-    else if (streq(p[0], "rport") && p[1] && !p[2])
+    else if (streq_opt("rport") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.remote_port = p[1];
     }
-    else if (streq(p[0], "bind") && !p[2])
+    else if (streq_opt("bind") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.bind_defined = true;
@@ -6207,17 +6699,73 @@ add_option(struct options *options,
         }
 
     }
-    else if (streq(p[0], "nobind") && !p[1])
+    else if (streq_opt("nobind") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         options->ce.bind_local = false;
     }
-    else if (streq(p[0], "fast-io") && !p[1])
+    else if (streq_opt("fast-io") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->fast_io = true;
     }
-    else if (streq(p[0], "inactive") && p[1] && !p[3])
+#ifdef ENABLE_UDP_MMSG
+    else if (streq_opt("udp-mmsg") && p[1] && !p[2])
+    {
+        int batch;
+
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        batch = positive_atoi(p[1]);
+        if (batch < 1 || batch > 64)
+        {
+            msg(msglevel, "--udp-mmsg parameter must be between 1 and 64");
+            goto err;
+        }
+        options->udp_mmsg = batch;
+    }
+#endif
+    else if (streq_opt("event-drain") && p[1] && !p[2])
+    {
+        int budget;
+
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        budget = positive_atoi(p[1]);
+        if (budget < 1 || budget > 1024)
+        {
+            msg(msglevel, "--event-drain parameter must be between 1 and 1024");
+            goto err;
+        }
+        options->event_drain = budget;
+    }
+    else if (streq_opt("realtime") && p[1] && !p[2])
+    {
+        int budget;
+
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        budget = positive_atoi(p[1]);
+        if (budget < 50 || budget > 1000000)
+        {
+            msg(msglevel, "--realtime parameter must be between 50 and 1000000 microseconds");
+            goto err;
+        }
+        options->realtime_budget = budget;
+    }
+#ifdef ENABLE_WORKER_THREADS
+    else if (streq_opt("worker-threads") && p[1] && !p[2])
+    {
+        int n_threads;
+
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        n_threads = positive_atoi(p[1]);
+        if (n_threads < 1 || n_threads > 64)
+        {
+            msg(msglevel, "--worker-threads parameter must be between 1 and 64");
+            goto err;
+        }
+        options->n_worker_threads = n_threads;
+    }
+#endif
+    else if (streq_opt("inactive") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_TIMER);
         options->inactivity_timeout = positive_atoi(p[1]);
@@ -6226,7 +6774,7 @@ add_option(struct options *options,
             options->inactivity_minimum_bytes = positive_atoi(p[2]);
         }
     }
-    else if (streq(p[0], "proto") && p[1] && !p[2])
+    else if (streq_opt("proto") && p[1] && !p[2])
     {
         int proto;
         sa_family_t af;
@@ -6244,7 +6792,7 @@ add_option(struct options *options,
         options->ce.proto = proto;
         options->ce.af = af;
     }
-    else if (streq(p[0], "proto-force") && p[1] && !p[2])
+    else if (streq_opt("proto-force") && p[1] && !p[2])
     {
         int proto_force;
         VERIFY_PERMISSION(OPT_P_GENERAL);
@@ -6256,7 +6804,7 @@ add_option(struct options *options,
         }
         options->proto_force = proto_force;
     }
-    else if (streq(p[0], "http-proxy") && p[1] && !p[5])
+    else if (streq_opt("http-proxy") && p[1] && !p[5])
     {
         struct http_proxy_options *ho;
 
@@ -6304,7 +6852,7 @@ add_option(struct options *options,
             ho->auth_method_string = "none";
         }
     }
-    else if (streq(p[0], "http-proxy-user-pass") && p[1])
+    else if (streq_opt("http-proxy-user-pass") && p[1])
     {
         struct http_proxy_options *ho;
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
@@ -6312,20 +6860,20 @@ add_option(struct options *options,
         ho->auth_file = p[1];
         ho->inline_creds = is_inline;
     }
-    else if (streq(p[0], "http-proxy-retry") || streq(p[0], "socks-proxy-retry"))
+    else if (streq_opt("http-proxy-retry") || streq_opt("socks-proxy-retry"))
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         msg(M_WARN, "DEPRECATED OPTION: http-proxy-retry and socks-proxy-retry: "
             "In OpenVPN 2.4 proxy connection retries are handled like regular connections. "
             "Use connect-retry-max 1 to get a similar behavior as before.");
     }
-    else if (streq(p[0], "http-proxy-timeout") && p[1] && !p[2])
+    else if (streq_opt("http-proxy-timeout") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         msg(M_WARN, "DEPRECATED OPTION: http-proxy-timeout: In OpenVPN 2.4 the timeout until a connection to a "
             "server is established is managed with a single timeout set by connect-timeout");
     }
-    else if (streq(p[0], "http-proxy-option") && p[1] && !p[4])
+    else if (streq_opt("http-proxy-option") && p[1] && !p[4])
     {
         struct http_proxy_options *ho;
 
@@ -6374,7 +6922,7 @@ add_option(struct options *options,
             msg(msglevel, "Bad http-proxy-option or missing or extra parameter: '%s'", p[1]);
         }
     }
-    else if (streq(p[0], "socks-proxy") && p[1] && !p[4])
+    else if (streq_opt("socks-proxy") && p[1] && !p[4])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
 
@@ -6389,35 +6937,40 @@ add_option(struct options *options,
         options->ce.socks_proxy_server = p[1];
         options->ce.socks_proxy_authfile = p[3]; /* might be NULL */
     }
-    else if (streq(p[0], "keepalive") && p[1] && p[2] && !p[3])
+    else if (streq_opt("keepalive") && p[1] && p[2] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->keepalive_ping = atoi(p[1]);
         options->keepalive_timeout = atoi(p[2]);
     }
-    else if (streq(p[0], "ping") && p[1] && !p[2])
+    else if (streq_opt("ping") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_TIMER);
         options->ping_send_timeout = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "ping-exit") && p[1] && !p[2])
+    else if (streq_opt("ping-exit") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_TIMER);
         options->ping_rec_timeout = positive_atoi(p[1]);
         options->ping_rec_timeout_action = PING_EXIT;
     }
-    else if (streq(p[0], "ping-restart") && p[1] && !p[2])
+    else if (streq_opt("ping-restart") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_TIMER);
         options->ping_rec_timeout = positive_atoi(p[1]);
         options->ping_rec_timeout_action = PING_RESTART;
     }
-    else if (streq(p[0], "ping-timer-rem") && !p[1])
+    else if (streq_opt("ping-timer-rem") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_TIMER);
         options->ping_timer_remote = true;
     }
-    else if (streq(p[0], "explicit-exit-notify") && !p[2])
+    else if (streq_opt("link-standby") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->link_standby_local = p[1];
+    }
+    else if (streq_opt("explicit-exit-notify") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION|OPT_P_EXPLICIT_NOTIFY);
         if (p[1])
@@ -6429,33 +6982,33 @@ add_option(struct options *options,
             options->ce.explicit_exit_notification = 1;
         }
     }
-    else if (streq(p[0], "persist-tun") && !p[1])
+    else if (streq_opt("persist-tun") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_PERSIST);
         options->persist_tun = true;
     }
-    else if (streq(p[0], "persist-key") && !p[1])
+    else if (streq_opt("persist-key") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_PERSIST);
         options->persist_key = true;
     }
-    else if (streq(p[0], "persist-local-ip") && !p[1])
+    else if (streq_opt("persist-local-ip") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_PERSIST_IP);
         options->persist_local_ip = true;
     }
-    else if (streq(p[0], "persist-remote-ip") && !p[1])
+    else if (streq_opt("persist-remote-ip") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_PERSIST_IP);
         options->persist_remote_ip = true;
     }
-    else if (streq(p[0], "client-nat") && p[1] && p[2] && p[3] && p[4] && !p[5])
+    else if (streq_opt("client-nat") && p[1] && p[2] && p[3] && p[4] && !p[5])
     {
         VERIFY_PERMISSION(OPT_P_ROUTE);
         cnol_check_alloc(options);
         add_client_nat_to_option_list(options->client_nat, p[1], p[2], p[3], p[4], msglevel);
     }
-    else if (streq(p[0], "route") && p[1] && !p[5])
+    else if (streq_opt("route") && p[1] && !p[5])
     {
         VERIFY_PERMISSION(OPT_P_ROUTE);
         rol_check_alloc(options);
@@ -6479,7 +7032,7 @@ add_option(struct options *options,
         }
         add_route_to_option_list(options->routes, p[1], p[2], p[3], p[4]);
     }
-    else if (streq(p[0], "route-ipv6") && p[1] && !p[4])
+    else if (streq_opt("route-ipv6") && p[1] && !p[4])
     {
         VERIFY_PERMISSION(OPT_P_ROUTE);
         rol6_check_alloc(options);
@@ -6499,14 +7052,14 @@ add_option(struct options *options,
         }
         add_route_ipv6_to_option_list(options->routes_ipv6, p[1], p[2], p[3]);
     }
-    else if (streq(p[0], "max-routes") && !p[2])
+    else if (streq_opt("max-routes") && !p[2])
     {
         msg(M_WARN, "DEPRECATED OPTION: --max-routes option ignored."
             "The number of routes is unlimited as of OpenVPN 2.4. "
             "This option will be removed in a future version, "
             "please remove it from your configuration.");
     }
-    else if (streq(p[0], "route-gateway") && p[1] && !p[2])
+    else if (streq_opt("route-gateway") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_ROUTE_EXTRAS);
         if (streq(p[1], "dhcp"))
@@ -6526,7 +7079,7 @@ add_option(struct options *options,
             }
         }
     }
-    else if (streq(p[0], "route-ipv6-gateway") && p[1] && !p[2])
+    else if (streq_opt("route-ipv6-gateway") && p[1] && !p[2])
     {
         if (ipv6_addr_safe(p[1]))
         {
@@ -6538,12 +7091,12 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "route-metric") && p[1] && !p[2])
+    else if (streq_opt("route-metric") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_ROUTE);
         options->route_default_metric = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "route-delay") && !p[3])
+    else if (streq_opt("route-delay") && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_ROUTE_EXTRAS);
         options->route_delay_defined = true;
@@ -6560,7 +7113,7 @@ add_option(struct options *options,
             options->route_delay = 0;
         }
     }
-    else if (streq(p[0], "route-up") && p[1])
+    else if (streq_opt("route-up") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -6569,7 +7122,7 @@ add_option(struct options *options,
         }
         set_user_script(options, &options->route_script, p[1], "route-up", false);
     }
-    else if (streq(p[0], "route-pre-down") && p[1])
+    else if (streq_opt("route-pre-down") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -6581,17 +7134,17 @@ add_option(struct options *options,
                         p[1],
                         "route-pre-down", true);
     }
-    else if (streq(p[0], "route-noexec") && !p[1])
+    else if (streq_opt("route-noexec") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         options->route_noexec = true;
     }
-    else if (streq(p[0], "route-nopull") && !p[1])
+    else if (streq_opt("route-nopull") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->route_nopull = true;
     }
-    else if (streq(p[0], "pull-filter") && p[1] && p[2] && !p[3])
+    else if (streq_opt("pull-filter") && p[1] && p[2] && !p[3])
     {
         struct pull_filter *f;
         VERIFY_PERMISSION(OPT_P_GENERAL)
@@ -6617,12 +7170,12 @@ add_option(struct options *options,
         f->pattern = p[2];
         f->size = strlen(p[2]);
     }
-    else if (streq(p[0], "allow-pull-fqdn") && !p[1])
+    else if (streq_opt("allow-pull-fqdn") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->allow_pull_fqdn = true;
     }
-    else if (streq(p[0], "redirect-gateway") || streq(p[0], "redirect-private"))
+    else if (streq_opt("redirect-gateway") || streq_opt("redirect-private"))
     {
         int j;
         VERIFY_PERMISSION(OPT_P_ROUTE);
@@ -6639,7 +7192,7 @@ add_option(struct options *options,
 
         options->routes->flags |= RG_ENABLE;
 
-        if (streq(p[0], "redirect-gateway"))
+        if (streq_opt("redirect-gateway"))
         {
             options->routes->flags |= RG_REROUTE_GW;
         }
@@ -6689,17 +7242,17 @@ add_option(struct options *options,
         remap_redirect_gateway_flags(options);
 #endif
     }
-    else if (streq(p[0], "block-ipv6") && !p[1])
+    else if (streq_opt("block-ipv6") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_ROUTE);
         options->block_ipv6 = true;
     }
-    else if (streq(p[0], "remote-random-hostname") && !p[1])
+    else if (streq_opt("remote-random-hostname") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->sockflags |= SF_HOST_RANDOMIZE;
     }
-    else if (streq(p[0], "setenv") && p[1] && !p[3])
+    else if (streq_opt("setenv") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[1], "REMOTE_RANDOM_HOSTNAME") && !p[2])
@@ -6729,17 +7282,17 @@ add_option(struct options *options,
             setenv_str(es, p[1], p[2] ? p[2] : "");
         }
     }
-    else if (streq(p[0], "setenv-safe") && p[1] && !p[3])
+    else if (streq_opt("setenv-safe") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_SETENV);
         setenv_str_safe(es, p[1], p[2] ? p[2] : "");
     }
-    else if (streq(p[0], "script-security") && p[1] && !p[2])
+    else if (streq_opt("script-security") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         script_security_set(atoi(p[1]));
     }
-    else if (streq(p[0], "mssfix") && !p[2])
+    else if (streq_opt("mssfix") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION);
         if (p[1])
@@ -6752,13 +7305,13 @@ add_option(struct options *options,
         }
 
     }
-    else if (streq(p[0], "disable-occ") && !p[1])
+    else if (streq_opt("disable-occ") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->occ = false;
     }
 #if P2MP
-    else if (streq(p[0], "server") && p[1] && p[2] && !p[4])
+    else if (streq_opt("server") && p[1] && p[2] && !p[4])
     {
         const int lev = M_WARN;
         bool error = false;
@@ -6789,7 +7342,7 @@ add_option(struct options *options,
             }
         }
     }
-    else if (streq(p[0], "server-ipv6") && p[1] && !p[3])
+    else if (streq_opt("server-ipv6") && p[1] && !p[3])
     {
         const int lev = M_WARN;
         struct in6_addr network;
@@ -6819,7 +7372,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "server-bridge") && p[1] && p[2] && p[3] && p[4] && !p[5])
+    else if (streq_opt("server-bridge") && p[1] && p[2] && p[3] && p[4] && !p[5])
     {
         const int lev = M_WARN;
         bool error = false;
@@ -6841,34 +7394,34 @@ add_option(struct options *options,
         options->server_bridge_pool_start = pool_start;
         options->server_bridge_pool_end = pool_end;
     }
-    else if (streq(p[0], "server-bridge") && p[1] && streq(p[1], "nogw") && !p[2])
+    else if (streq_opt("server-bridge") && p[1] && streq(p[1], "nogw") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->server_bridge_proxy_dhcp = true;
         options->server_flags |= SF_NO_PUSH_ROUTE_GATEWAY;
     }
-    else if (streq(p[0], "server-bridge") && !p[1])
+    else if (streq_opt("server-bridge") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->server_bridge_proxy_dhcp = true;
     }
-    else if (streq(p[0], "push") && p[1] && !p[2])
+    else if (streq_opt("push") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_PUSH);
         push_options(options, &p[1], msglevel, &options->gc);
     }
-    else if (streq(p[0], "push-reset") && !p[1])
+    else if (streq_opt("push-reset") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_INSTANCE);
         push_reset(options);
     }
-    else if (streq(p[0], "push-remove") && p[1] && !p[2])
+    else if (streq_opt("push-remove") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_INSTANCE);
         msg(D_PUSH, "PUSH_REMOVE '%s'", p[1]);
         push_remove_option(options,p[1]);
     }
-    else if (streq(p[0], "ifconfig-pool") && p[1] && p[2] && !p[4])
+    else if (streq_opt("ifconfig-pool") && p[1] && p[2] && !p[4])
     {
         const int lev = M_WARN;
         bool error = false;
@@ -6899,7 +7452,7 @@ add_option(struct options *options,
             options->ifconfig_pool_netmask = netmask;
         }
     }
-    else if (streq(p[0], "ifconfig-pool-persist") && p[1] && !p[3])
+    else if (streq_opt("ifconfig-pool-persist") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->ifconfig_pool_persist_filename = p[1];
@@ -6908,7 +7461,7 @@ add_option(struct options *options,
             options->ifconfig_pool_persist_refresh_freq = positive_atoi(p[2]);
         }
     }
-    else if (streq(p[0], "ifconfig-ipv6-pool") && p[1] && !p[2])
+    else if (streq_opt("ifconfig-ipv6-pool") && p[1] && !p[2])
     {
         const int lev = M_WARN;
         struct in6_addr network;
@@ -6932,7 +7485,7 @@ add_option(struct options *options,
         options->ifconfig_ipv6_pool_base = network;
         options->ifconfig_ipv6_pool_netbits = netbits;
     }
-    else if (streq(p[0], "hash-size") && p[1] && p[2] && !p[3])
+    else if (streq_opt("hash-size") && p[1] && p[2] && !p[3])
     {
         int real, virtual;
 
@@ -6947,7 +7500,7 @@ add_option(struct options *options,
         options->real_hash_size = real;
         options->virtual_hash_size = real;
     }
-    else if (streq(p[0], "connect-freq") && p[1] && p[2] && !p[3])
+    else if (streq_opt("connect-freq") && p[1] && p[2] && !p[3])
     {
         int cf_max, cf_per;
 
@@ -6962,7 +7515,56 @@ add_option(struct options *options,
         options->cf_max = cf_max;
         options->cf_per = cf_per;
     }
-    else if (streq(p[0], "max-clients") && p[1] && !p[2])
+    else if (streq_opt("connect-freq-src") && p[1] && !p[3])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        const int rate = atoi(p[1]);
+        if (rate <= 0)
+        {
+            msg(msglevel, "--connect-freq-src rate must be > 0");
+            goto err;
+        }
+        options->cf_src_rate = rate;
+        if (p[2])
+        {
+            const int size = atoi(p[2]);
+            if (size <= 0)
+            {
+                msg(msglevel, "--connect-freq-src table size must be > 0");
+                goto err;
+            }
+            options->cf_src_size = size;
+        }
+    }
+    else if (streq_opt("connect-budget") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->connect_budget = positive_atoi(p[1]);
+    }
+#ifndef _WIN32
+    else if (streq_opt("float-migration") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->migrate_path = p[1];
+    }
+    else if (streq_opt("persist-state") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->persist_state_file = p[1];
+    }
+    else if (streq_opt("inherit-link-fd") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        int fd = positive_atoi(p[1]);
+        if (fd < 3)
+        {
+            msg(msglevel, "--inherit-link-fd parameter must be >= 3");
+            goto err;
+        }
+        save_inherited_link_socket_descriptor(fd);
+    }
+#endif
+    else if (streq_opt("max-clients") && p[1] && !p[2])
     {
         int max_clients;
 
@@ -6980,17 +7582,17 @@ add_option(struct options *options,
         }
         options->max_clients = max_clients;
     }
-    else if (streq(p[0], "max-routes-per-client") && p[1] && !p[2])
+    else if (streq_opt("max-routes-per-client") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_INHERIT);
         options->max_routes_per_client = max_int(atoi(p[1]), 1);
     }
-    else if (streq(p[0], "client-cert-not-required") && !p[1])
+    else if (streq_opt("client-cert-not-required") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         msg(M_FATAL, "REMOVED OPTION: --client-cert-not-required, use '--verify-client-cert none' instead");
     }
-    else if (streq(p[0], "verify-client-cert") && !p[2])
+    else if (streq_opt("verify-client-cert") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
 
@@ -7014,22 +7616,22 @@ add_option(struct options *options,
             }
         }
     }
-    else if (streq(p[0], "username-as-common-name") && !p[1])
+    else if (streq_opt("username-as-common-name") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->ssl_flags |= SSLF_USERNAME_AS_COMMON_NAME;
     }
-    else if (streq(p[0], "auth-user-pass-optional") && !p[1])
+    else if (streq_opt("auth-user-pass-optional") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->ssl_flags |= SSLF_AUTH_USER_PASS_OPTIONAL;
     }
-    else if (streq(p[0], "opt-verify") && !p[1])
+    else if (streq_opt("opt-verify") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->ssl_flags |= SSLF_OPT_VERIFY;
     }
-    else if (streq(p[0], "auth-user-pass-verify") && p[1])
+    else if (streq_opt("auth-user-pass-verify") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 3, NM_QUOTE_HINT))
@@ -7061,7 +7663,7 @@ add_option(struct options *options,
                         &options->auth_user_pass_verify_script,
                         p[1], "auth-user-pass-verify", true);
     }
-    else if (streq(p[0], "auth-gen-token") && !p[3])
+    else if (streq_opt("auth-gen-token") && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->auth_token_generate = true;
@@ -7079,14 +7681,14 @@ add_option(struct options *options,
         }
 
     }
-    else if (streq(p[0], "auth-gen-token-secret") && p[1] && !p[2])
+    else if (streq_opt("auth-gen-token-secret") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         options->auth_token_secret_file = p[1];
         options->auth_token_secret_file_inline = is_inline;
 
     }
-    else if (streq(p[0], "client-connect") && p[1])
+    else if (streq_opt("client-connect") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -7096,7 +7698,7 @@ add_option(struct options *options,
         set_user_script(options, &options->client_connect_script,
                         p[1], "client-connect", true);
     }
-    else if (streq(p[0], "client-disconnect") && p[1])
+    else if (streq_opt("client-disconnect") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -7106,7 +7708,7 @@ add_option(struct options *options,
         set_user_script(options, &options->client_disconnect_script,
                         p[1], "client-disconnect", true);
     }
-    else if (streq(p[0], "learn-address") && p[1])
+    else if (streq_opt("learn-address") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -7116,22 +7718,27 @@ add_option(struct options *options,
         set_user_script(options, &options->learn_address_script,
                         p[1], "learn-address", true);
     }
-    else if (streq(p[0], "tmp-dir") && p[1] && !p[2])
+    else if (streq_opt("learn-address-async") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->learn_address_async = true;
+    }
+    else if (streq_opt("tmp-dir") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->tmp_dir = p[1];
     }
-    else if (streq(p[0], "client-config-dir") && p[1] && !p[2])
+    else if (streq_opt("client-config-dir") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->client_config_dir = p[1];
     }
-    else if (streq(p[0], "ccd-exclusive") && !p[1])
+    else if (streq_opt("ccd-exclusive") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->ccd_exclusive = true;
     }
-    else if (streq(p[0], "bcast-buffers") && p[1] && !p[2])
+    else if (streq_opt("bcast-buffers") && p[1] && !p[2])
     {
         int n_bcast_buf;
 
@@ -7143,7 +7750,7 @@ add_option(struct options *options,
         }
         options->n_bcast_buf = n_bcast_buf;
     }
-    else if (streq(p[0], "tcp-queue-limit") && p[1] && !p[2])
+    else if (streq_opt("tcp-queue-limit") && p[1] && !p[2])
     {
         int tcp_queue_limit;
 
@@ -7156,7 +7763,7 @@ add_option(struct options *options,
         options->tcp_queue_limit = tcp_queue_limit;
     }
 #if PORT_SHARE
-    else if (streq(p[0], "port-share") && p[1] && p[2] && !p[4])
+    else if (streq_opt("port-share") && p[1] && p[2] && !p[4])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->port_share_host = p[1];
@@ -7164,17 +7771,17 @@ add_option(struct options *options,
         options->port_share_journal_dir = p[3];
     }
 #endif
-    else if (streq(p[0], "client-to-client") && !p[1])
+    else if (streq_opt("client-to-client") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->enable_c2c = true;
     }
-    else if (streq(p[0], "duplicate-cn") && !p[1])
+    else if (streq_opt("duplicate-cn") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->duplicate_cn = true;
     }
-    else if (streq(p[0], "iroute") && p[1] && !p[3])
+    else if (streq_opt("iroute") && p[1] && !p[3])
     {
         const char *netmask = NULL;
 
@@ -7185,12 +7792,12 @@ add_option(struct options *options,
         }
         option_iroute(options, p[1], netmask, msglevel);
     }
-    else if (streq(p[0], "iroute-ipv6") && p[1] && !p[2])
+    else if (streq_opt("iroute-ipv6") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_INSTANCE);
         option_iroute_ipv6(options, p[1], msglevel);
     }
-    else if (streq(p[0], "ifconfig-push") && p[1] && p[2] && !p[4])
+    else if (streq_opt("ifconfig-push") && p[1] && p[2] && !p[4])
     {
         in_addr_t local, remote_netmask;
 
@@ -7213,7 +7820,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "ifconfig-push-constraint") && p[1] && p[2] && !p[3])
+    else if (streq_opt("ifconfig-push-constraint") && p[1] && p[2] && !p[3])
     {
         in_addr_t network, netmask;
 
@@ -7232,7 +7839,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "ifconfig-ipv6-push") && p[1] && !p[3])
+    else if (streq_opt("ifconfig-ipv6-push") && p[1] && !p[3])
     {
         struct in6_addr local, remote;
         unsigned int netbits;
@@ -7270,17 +7877,17 @@ add_option(struct options *options,
         options->push_ifconfig_ipv6_remote = remote;
         options->push_ifconfig_ipv6_blocked = false;
     }
-    else if (streq(p[0], "disable") && !p[1])
+    else if (streq_opt("disable") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_INSTANCE);
         options->disable = true;
     }
-    else if (streq(p[0], "tcp-nodelay") && !p[1])
+    else if (streq_opt("tcp-nodelay") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->server_flags |= SF_TCP_NODELAY_HELPER;
     }
-    else if (streq(p[0], "stale-routes-check") && p[1] && !p[3])
+    else if (streq_opt("stale-routes-check") && p[1] && !p[3])
     {
         int ageing_time, check_interval;
 
@@ -7304,22 +7911,33 @@ add_option(struct options *options,
         options->stale_routes_check_interval = check_interval;
     }
 
-    else if (streq(p[0], "client") && !p[1])
+    else if (streq_opt("client") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->client = true;
     }
-    else if (streq(p[0], "pull") && !p[1])
+    else if (streq_opt("pull") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->pull = true;
     }
-    else if (streq(p[0], "push-continuation") && p[1] && !p[2])
+    else if (streq_opt("push-continuation") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_PULL_MODE);
         options->push_continuation = atoi(p[1]);
     }
-    else if (streq(p[0], "auth-user-pass") && !p[2])
+    else if (streq_opt("push-digest") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_PULL_MODE);
+        options->push_digest = p[1];
+    }
+    else if (streq_opt("push-diff") && !p[1])
+    {
+        /* marker at the head of a diff-style push reply; handled in
+         * process_incoming_push_reply() */
+        VERIFY_PERMISSION(OPT_P_PULL_MODE);
+    }
+    else if (streq_opt("auth-user-pass") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (p[1])
@@ -7331,13 +7949,13 @@ add_option(struct options *options,
             options->auth_user_pass_file = "stdin";
         }
     }
-    else if (streq(p[0], "auth-retry") && p[1] && !p[2])
+    else if (streq_opt("auth-retry") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         auth_retry_set(msglevel, p[1]);
     }
 #ifdef ENABLE_MANAGEMENT
-    else if (streq(p[0], "static-challenge") && p[1] && p[2] && !p[3])
+    else if (streq_opt("static-challenge") && p[1] && p[2] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->sc_info.challenge_text = p[1];
@@ -7348,7 +7966,7 @@ add_option(struct options *options,
     }
 #endif
 #endif /* if P2MP */
-    else if (streq(p[0], "msg-channel") && p[1])
+    else if (streq_opt("msg-channel") && p[1])
     {
 #ifdef _WIN32
         VERIFY_PERMISSION(OPT_P_GENERAL);
@@ -7367,7 +7985,7 @@ add_option(struct options *options,
 #endif
     }
 #ifdef _WIN32
-    else if (streq(p[0], "win-sys") && p[1] && !p[2])
+    else if (streq_opt("win-sys") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[1], "env"))
@@ -7381,7 +7999,7 @@ add_option(struct options *options,
             set_win_sys_path(p[1], es);
         }
     }
-    else if (streq(p[0], "route-method") && p[1] && !p[2])
+    else if (streq_opt("route-method") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_ROUTE_EXTRAS);
         if (streq(p[1], "adaptive"))
@@ -7402,7 +8020,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "ip-win32") && p[1] && !p[4])
+    else if (streq_opt("ip-win32") && p[1] && !p[4])
     {
         const int index = ascii2ipset(p[1]);
         struct tuntap_options *to = &options->tuntap_options;
@@ -7460,7 +8078,7 @@ add_option(struct options *options,
     }
 #endif /* ifdef _WIN32 */
 #if defined(_WIN32) || defined(TARGET_ANDROID)
-    else if (streq(p[0], "dhcp-option") && p[1] && !p[3])
+    else if (streq_opt("dhcp-option") && p[1] && !p[3])
     {
         struct tuntap_options *o = &options->tuntap_options;
         VERIFY_PERMISSION(OPT_P_IPWIN32);
@@ -7543,25 +8161,25 @@ add_option(struct options *options,
     }
 #endif /* if defined(_WIN32) || defined(TARGET_ANDROID) */
 #ifdef _WIN32
-    else if (streq(p[0], "show-adapters") && !p[1])
+    else if (streq_opt("show-adapters") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         show_tap_win_adapters(M_INFO|M_NOPREFIX, M_WARN|M_NOPREFIX);
         openvpn_exit(OPENVPN_EXIT_STATUS_GOOD); /* exit point */
     }
-    else if (streq(p[0], "show-net") && !p[1])
+    else if (streq_opt("show-net") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         show_routes(M_INFO|M_NOPREFIX);
         show_adapters(M_INFO|M_NOPREFIX);
         openvpn_exit(OPENVPN_EXIT_STATUS_GOOD); /* exit point */
     }
-    else if (streq(p[0], "show-net-up") && !p[1])
+    else if (streq_opt("show-net-up") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_UP);
         options->show_net_up = true;
     }
-    else if (streq(p[0], "tap-sleep") && p[1] && !p[2])
+    else if (streq_opt("tap-sleep") && p[1] && !p[2])
     {
         int s;
         VERIFY_PERMISSION(OPT_P_IPWIN32);
@@ -7573,22 +8191,34 @@ add_option(struct options *options,
         }
         options->tuntap_options.tap_sleep = s;
     }
-    else if (streq(p[0], "dhcp-renew") && !p[1])
+    else if (streq_opt("wintun-spin") && p[1] && !p[2])
+    {
+        int s;
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        s = atoi(p[1]);
+        if (s < 0 || s > 10000000)
+        {
+            msg(msglevel, "--wintun-spin parameter must be between 0 and 10000000");
+            goto err;
+        }
+        options->tuntap_options.wintun_spin = s;
+    }
+    else if (streq_opt("dhcp-renew") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_IPWIN32);
         options->tuntap_options.dhcp_renew = true;
     }
-    else if (streq(p[0], "dhcp-pre-release") && !p[1])
+    else if (streq_opt("dhcp-pre-release") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_IPWIN32);
         options->tuntap_options.dhcp_pre_release = true;
         options->tuntap_options.dhcp_renew = true;
     }
-    else if (streq(p[0], "dhcp-release") && !p[1])
+    else if (streq_opt("dhcp-release") && !p[1])
     {
         msg(M_WARN, "Obsolete option --dhcp-release detected. This is now on by default");
     }
-    else if (streq(p[0], "dhcp-internal") && p[1] && !p[2]) /* standalone method for internal use */
+    else if (streq_opt("dhcp-internal") && p[1] && !p[2]) /* standalone method for internal use */
     {
         unsigned int adapter_index;
         VERIFY_PERMISSION(OPT_P_GENERAL);
@@ -7605,17 +8235,17 @@ add_option(struct options *options,
         }
         openvpn_exit(OPENVPN_EXIT_STATUS_GOOD); /* exit point */
     }
-    else if (streq(p[0], "register-dns") && !p[1])
+    else if (streq_opt("register-dns") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_IPWIN32);
         options->tuntap_options.register_dns = true;
     }
-    else if (streq(p[0], "block-outside-dns") && !p[1])
+    else if (streq_opt("block-outside-dns") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_IPWIN32);
         options->block_outside_dns = true;
     }
-    else if (streq(p[0], "rdns-internal") && !p[1])
+    else if (streq_opt("rdns-internal") && !p[1])
     /* standalone method for internal use
      *
      * (if --register-dns is set, openvpn needs to call itself in a
@@ -7631,18 +8261,18 @@ add_option(struct options *options,
         }
         openvpn_exit(OPENVPN_EXIT_STATUS_GOOD); /* exit point */
     }
-    else if (streq(p[0], "show-valid-subnets") && !p[1])
+    else if (streq_opt("show-valid-subnets") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         show_valid_win32_tun_subnets();
         openvpn_exit(OPENVPN_EXIT_STATUS_GOOD); /* exit point */
     }
-    else if (streq(p[0], "pause-exit") && !p[1])
+    else if (streq_opt("pause-exit") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         set_pause_exit_win32();
     }
-    else if (streq(p[0], "service") && p[1] && !p[3])
+    else if (streq_opt("service") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->exit_event_name = p[1];
@@ -7651,52 +8281,52 @@ add_option(struct options *options,
             options->exit_event_initial_state = (atoi(p[2]) != 0);
         }
     }
-    else if (streq(p[0], "allow-nonadmin") && !p[2])
+    else if (streq_opt("allow-nonadmin") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         tap_allow_nonadmin_access(p[1]);
         openvpn_exit(OPENVPN_EXIT_STATUS_GOOD); /* exit point */
     }
-    else if (streq(p[0], "user") && p[1] && !p[2])
+    else if (streq_opt("user") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         msg(M_WARN, "NOTE: --user option is not implemented on Windows");
     }
-    else if (streq(p[0], "group") && p[1] && !p[2])
+    else if (streq_opt("group") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         msg(M_WARN, "NOTE: --group option is not implemented on Windows");
     }
 #else  /* ifdef _WIN32 */
-    else if (streq(p[0], "user") && p[1] && !p[2])
+    else if (streq_opt("user") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->username = p[1];
     }
-    else if (streq(p[0], "group") && p[1] && !p[2])
+    else if (streq_opt("group") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->groupname = p[1];
     }
-    else if (streq(p[0], "dhcp-option") && p[1] && !p[3])
+    else if (streq_opt("dhcp-option") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_IPWIN32);
         foreign_option(options, p, 3, es);
     }
-    else if (streq(p[0], "route-method") && p[1] && !p[2]) /* ignore when pushed to non-Windows OS */
+    else if (streq_opt("route-method") && p[1] && !p[2]) /* ignore when pushed to non-Windows OS */
     {
         VERIFY_PERMISSION(OPT_P_ROUTE_EXTRAS);
     }
 #endif /* ifdef _WIN32 */
 #if PASSTOS_CAPABILITY
-    else if (streq(p[0], "passtos") && !p[1])
+    else if (streq_opt("passtos") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->passtos = true;
     }
 #endif
 #if defined(USE_COMP)
-    else if (streq(p[0], "allow-compression") && p[1] && !p[2])
+    else if (streq_opt("allow-compression") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
 
@@ -7738,7 +8368,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "comp-lzo") && !p[2])
+    else if (streq_opt("comp-lzo") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_COMP);
 
@@ -7785,7 +8415,7 @@ add_option(struct options *options,
         show_compression_warning(&options->comp);
 #endif /* if defined(ENABLE_LZO) */
     }
-    else if (streq(p[0], "comp-noadapt") && !p[1])
+    else if (streq_opt("comp-noadapt") && !p[1])
     {
         /*
          * We do not need to check here if we allow compression since
@@ -7794,7 +8424,7 @@ add_option(struct options *options,
         VERIFY_PERMISSION(OPT_P_COMP);
         options->comp.flags &= ~COMP_F_ADAPTIVE;
     }
-    else if (streq(p[0], "compress") && !p[2])
+    else if (streq_opt("compress") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_COMP);
         if (p[1])
@@ -7833,6 +8463,11 @@ add_option(struct options *options,
             {
                 options->comp.alg = COMP_ALGV2_LZ4;
             }
+            else if (streq(p[1], "lz4-stream"))
+            {
+                options->comp.alg = COMP_ALG_LZ4_STREAM;
+                options->comp.flags |= COMP_F_SWAP;
+            }
 #endif
             else
             {
@@ -7848,22 +8483,22 @@ add_option(struct options *options,
         show_compression_warning(&options->comp);
     }
 #endif /* USE_COMP */
-    else if (streq(p[0], "show-ciphers") && !p[1])
+    else if (streq_opt("show-ciphers") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->show_ciphers = true;
     }
-    else if (streq(p[0], "show-digests") && !p[1])
+    else if (streq_opt("show-digests") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->show_digests = true;
     }
-    else if (streq(p[0], "show-engines") && !p[1])
+    else if (streq_opt("show-engines") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->show_engines = true;
     }
-    else if (streq(p[0], "key-direction") && p[1] && !p[2])
+    else if (streq_opt("key-direction") && p[1] && !p[2])
     {
         int key_direction;
 
@@ -7886,7 +8521,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "secret") && p[1] && !p[3])
+    else if (streq_opt("secret") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         options->shared_secret_file = p[1];
@@ -7906,7 +8541,7 @@ add_option(struct options *options,
             }
         }
     }
-    else if (streq(p[0], "genkey") && !p[4])
+    else if (streq_opt("genkey") && !p[4])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->genkey = true;
@@ -7948,34 +8583,34 @@ add_option(struct options *options,
             options->genkey_filename = p[2];
         }
     }
-    else if (streq(p[0], "auth") && p[1] && !p[2])
+    else if (streq_opt("auth") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->authname = p[1];
     }
-    else if (streq(p[0], "cipher") && p[1] && !p[2])
+    else if (streq_opt("cipher") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_NCP|OPT_P_INSTANCE);
         options->ciphername = p[1];
     }
-    else if (streq(p[0], "data-ciphers-fallback") && p[1] && !p[2])
+    else if (streq_opt("data-ciphers-fallback") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INSTANCE);
         options->ciphername = p[1];
         options->enable_ncp_fallback = true;
     }
-    else if ((streq(p[0], "data-ciphers") || streq(p[0], "ncp-ciphers"))
+    else if ((streq_opt("data-ciphers") || streq_opt("ncp-ciphers"))
              && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INSTANCE);
-        if (streq(p[0], "ncp-ciphers"))
+        if (streq_opt("ncp-ciphers"))
         {
             msg(M_INFO, "Note: Treating option '--ncp-ciphers' as "
                 " '--data-ciphers' (renamed in OpenVPN 2.5).");
         }
         options->ncp_ciphers = p[1];
     }
-    else if (streq(p[0], "key-derivation") && p[1])
+    else if (streq_opt("key-derivation") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_NCP)
 #ifdef HAVE_EXPORT_KEYING_MATERIAL
@@ -7985,11 +8620,21 @@ add_option(struct options *options,
         }
         else
 #endif
+        if (streq(p[1], "openvpn-hkdf"))
+        {
+            options->data_channel_use_hkdf = true;
+        }
+        else
         {
             msg(msglevel, "Unknown key-derivation method %s", p[1]);
         }
     }
-    else if (streq(p[0], "ncp-disable") && !p[1])
+    else if (streq_opt("packet-id-64") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_NCP)
+        options->data_channel_pkt_id_64 = true;
+    }
+    else if (streq_opt("ncp-disable") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INSTANCE);
         options->ncp_enabled = false;
@@ -7997,7 +8642,7 @@ add_option(struct options *options,
             "cipher negotiation is a deprecated debug feature that "
             "will be removed in OpenVPN 2.6");
     }
-    else if (streq(p[0], "prng") && p[1] && !p[3])
+    else if (streq_opt("prng") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[1], "none"))
@@ -8023,12 +8668,12 @@ add_option(struct options *options,
             }
         }
     }
-    else if (streq(p[0], "no-replay") && !p[1])
+    else if (streq_opt("no-replay") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->replay = false;
     }
-    else if (streq(p[0], "replay-window") && !p[3])
+    else if (streq_opt("replay-window") && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (p[1])
@@ -8068,23 +8713,34 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "mute-replay-warnings") && !p[1])
+    else if (streq_opt("replay-adaptive") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->replay_adaptive = true;
+    }
+    else if (streq_opt("mute-replay-warnings") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->mute_replay_warnings = true;
     }
-    else if (streq(p[0], "replay-persist") && p[1] && !p[2])
+    else if (streq_opt("replay-persist") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->packet_id_file = p[1];
     }
-    else if (streq(p[0], "test-crypto") && !p[1])
+    else if (streq_opt("test-crypto") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->test_crypto = true;
     }
+    else if (streq_opt("test-crypto-perf") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->test_crypto = true;
+        options->test_crypto_perf = positive_atoi(p[1]);
+    }
 #ifndef ENABLE_CRYPTO_MBEDTLS
-    else if (streq(p[0], "engine") && !p[2])
+    else if (streq_opt("engine") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (p[1])
@@ -8096,9 +8752,14 @@ add_option(struct options *options,
             options->engine = "auto";
         }
     }
+    else if (streq_opt("tls-async") && !p[1])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->tls_async = true;
+    }
 #endif /* ENABLE_CRYPTO_MBEDTLS */
 #ifdef HAVE_EVP_CIPHER_CTX_SET_KEY_LENGTH
-    else if (streq(p[0], "keysize") && p[1] && !p[2])
+    else if (streq_opt("keysize") && p[1] && !p[2])
     {
         int keysize;
 
@@ -8113,23 +8774,23 @@ add_option(struct options *options,
     }
 #endif
 #ifdef ENABLE_PREDICTION_RESISTANCE
-    else if (streq(p[0], "use-prediction-resistance") && !p[1])
+    else if (streq_opt("use-prediction-resistance") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->use_prediction_resistance = true;
     }
 #endif
-    else if (streq(p[0], "show-tls") && !p[1])
+    else if (streq_opt("show-tls") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->show_tls_ciphers = true;
     }
-    else if ((streq(p[0], "show-curves") || streq(p[0], "show-groups")) && !p[1])
+    else if ((streq_opt("show-curves") || streq_opt("show-groups")) && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->show_curves = true;
     }
-    else if (streq(p[0], "ecdh-curve") && p[1] && !p[2])
+    else if (streq_opt("ecdh-curve") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         msg(M_WARN, "Consider setting groups/curves preference with "
@@ -8137,48 +8798,48 @@ add_option(struct options *options,
             "ecdh-curve.");
         options->ecdh_curve = p[1];
     }
-    else if (streq(p[0], "tls-server") && !p[1])
+    else if (streq_opt("tls-server") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->tls_server = true;
     }
-    else if (streq(p[0], "tls-client") && !p[1])
+    else if (streq_opt("tls-client") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->tls_client = true;
     }
-    else if (streq(p[0], "ca") && p[1] && !p[2])
+    else if (streq_opt("ca") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         options->ca_file = p[1];
         options->ca_file_inline = is_inline;
     }
 #ifndef ENABLE_CRYPTO_MBEDTLS
-    else if (streq(p[0], "capath") && p[1] && !p[2])
+    else if (streq_opt("capath") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->ca_path = p[1];
     }
 #endif /* ENABLE_CRYPTO_MBEDTLS */
-    else if (streq(p[0], "dh") && p[1] && !p[2])
+    else if (streq_opt("dh") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         options->dh_file = p[1];
         options->dh_file_inline = is_inline;
     }
-    else if (streq(p[0], "cert") && p[1] && !p[2])
+    else if (streq_opt("cert") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         options->cert_file = p[1];
         options->cert_file_inline = is_inline;
     }
-    else if (streq(p[0], "extra-certs") && p[1] && !p[2])
+    else if (streq_opt("extra-certs") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         options->extra_certs_file = p[1];
         options->extra_certs_file_inline = is_inline;
     }
-    else if (streq(p[0], "verify-hash") && p[1] && !p[3])
+    else if (streq_opt("verify-hash") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
 
@@ -8199,19 +8860,19 @@ add_option(struct options *options,
         }
     }
 #ifdef ENABLE_CRYPTOAPI
-    else if (streq(p[0], "cryptoapicert") && p[1] && !p[2])
+    else if (streq_opt("cryptoapicert") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->cryptoapi_cert = p[1];
     }
 #endif
-    else if (streq(p[0], "key") && p[1] && !p[2])
+    else if (streq_opt("key") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         options->priv_key_file = p[1];
         options->priv_key_file_inline = is_inline;
     }
-    else if (streq(p[0], "tls-version-min") && p[1] && !p[3])
+    else if (streq_opt("tls-version-min") && p[1] && !p[3])
     {
         int ver;
         VERIFY_PERMISSION(OPT_P_GENERAL);
@@ -8225,7 +8886,7 @@ add_option(struct options *options,
             ~(SSLF_TLS_VERSION_MIN_MASK << SSLF_TLS_VERSION_MIN_SHIFT);
         options->ssl_flags |= (ver << SSLF_TLS_VERSION_MIN_SHIFT);
     }
-    else if (streq(p[0], "tls-version-max") && p[1] && !p[2])
+    else if (streq_opt("tls-version-max") && p[1] && !p[2])
     {
         int ver;
         VERIFY_PERMISSION(OPT_P_GENERAL);
@@ -8240,14 +8901,14 @@ add_option(struct options *options,
         options->ssl_flags |= (ver << SSLF_TLS_VERSION_MAX_SHIFT);
     }
 #ifndef ENABLE_CRYPTO_MBEDTLS
-    else if (streq(p[0], "pkcs12") && p[1] && !p[2])
+    else if (streq_opt("pkcs12") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
         options->pkcs12_file = p[1];
         options->pkcs12_file_inline = is_inline;
     }
 #endif /* ENABLE_CRYPTO_MBEDTLS */
-    else if (streq(p[0], "askpass") && !p[2])
+    else if (streq_opt("askpass") && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (p[1])
@@ -8259,12 +8920,12 @@ add_option(struct options *options,
             options->key_pass_file = "stdin";
         }
     }
-    else if (streq(p[0], "auth-nocache") && !p[1])
+    else if (streq_opt("auth-nocache") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         ssl_set_auth_nocache();
     }
-    else if (streq(p[0], "auth-token") && p[1] && !p[2])
+    else if (streq_opt("auth-token") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_ECHO);
         ssl_set_auth_token(p[1]);
@@ -8275,42 +8936,43 @@ add_option(struct options *options,
         }
 #endif
     }
-    else if (streq(p[0], "single-session") && !p[1])
+    else if (streq_opt("single-session") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->single_session = true;
     }
-    else if (streq(p[0], "push-peer-info") && !p[1])
+    else if (streq_opt("push-peer-info") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->push_peer_info = true;
     }
-    else if (streq(p[0], "tls-exit") && !p[1])
+    else if (streq_opt("tls-exit") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->tls_exit = true;
     }
-    else if (streq(p[0], "tls-cipher") && p[1] && !p[2])
+    else if (streq_opt("tls-cipher") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->cipher_list = p[1];
     }
-    else if (streq(p[0], "tls-cert-profile") && p[1] && !p[2])
+    else if (streq_opt("tls-cert-profile") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->tls_cert_profile = p[1];
     }
-    else if (streq(p[0], "tls-ciphersuites") && p[1] && !p[2])
+    else if (streq_opt("tls-ciphersuites") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->cipher_list_tls13 = p[1];
     }
-    else if (streq(p[0], "tls-groups") && p[1] && !p[2])
+    else if (streq_opt("tls-groups") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->tls_groups = p[1];
     }
-    else if (streq(p[0], "crl-verify") && p[1] && ((p[2] && streq(p[2], "dir"))
+    else if (streq_opt("crl-verify") && p[1] && ((p[2] && streq(p[2], "dir"))
+                                                   || (p[2] && streq(p[2], "index"))
                                                    || !p[2]))
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INLINE);
@@ -8318,10 +8980,26 @@ add_option(struct options *options,
         {
             options->ssl_flags |= SSLF_CRL_VERIFY_DIR;
         }
+        else if (p[2] && streq(p[2], "index"))
+        {
+#if defined(ENABLE_CRYPTO_OPENSSL) && !defined(_WIN32)
+            if (is_inline)
+            {
+                msg(msglevel, "--crl-verify 'index' mode requires a CRL file, "
+                    "inline CRLs cannot be indexed");
+                goto err;
+            }
+            options->ssl_flags |= SSLF_CRL_INDEX;
+#else
+            msg(msglevel, "--crl-verify 'index' mode is only supported with "
+                "OpenSSL builds on platforms with mmap()");
+            goto err;
+#endif
+        }
         options->crl_file = p[1];
         options->crl_file_inline = is_inline;
     }
-    else if (streq(p[0], "tls-verify") && p[1])
+    else if (streq_opt("tls-verify") && p[1])
     {
         VERIFY_PERMISSION(OPT_P_SCRIPT);
         if (!no_more_than_n_args(msglevel, p, 2, NM_QUOTE_HINT))
@@ -8332,28 +9010,33 @@ add_option(struct options *options,
                         string_substitute(p[1], ',', ' ', &options->gc),
                         "tls-verify", true);
     }
+    else if (streq_opt("tls-verify-cache") && p[1] && !p[2])
+    {
+        VERIFY_PERMISSION(OPT_P_GENERAL);
+        options->tls_verify_cache = positive_atoi(p[1]);
+    }
 #ifndef ENABLE_CRYPTO_MBEDTLS
-    else if (streq(p[0], "tls-export-cert") && p[1] && !p[2])
+    else if (streq_opt("tls-export-cert") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->tls_export_cert = p[1];
     }
 #endif
-    else if (streq(p[0], "compat-names"))
+    else if (streq_opt("compat-names"))
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         msg(msglevel, "--compat-names was removed in OpenVPN 2.5. "
             "Update your configuration.");
         goto err;
     }
-    else if (streq(p[0], "no-name-remapping") && !p[1])
+    else if (streq_opt("no-name-remapping") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         msg(msglevel, "--no-name-remapping was removed in OpenVPN 2.5. "
             "Update your configuration.");
         goto err;
     }
-    else if (streq(p[0], "verify-x509-name") && p[1] && strlen(p[1]) && !p[3])
+    else if (streq_opt("verify-x509-name") && p[1] && strlen(p[1]) && !p[3])
     {
         int type = VERIFY_X509_SUBJECT_DN;
         VERIFY_PERMISSION(OPT_P_GENERAL);
@@ -8380,7 +9063,7 @@ add_option(struct options *options,
         options->verify_x509_type = type;
         options->verify_x509_name = p[1];
     }
-    else if (streq(p[0], "ns-cert-type") && p[1] && !p[2])
+    else if (streq_opt("ns-cert-type") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[1], "server"))
@@ -8397,7 +9080,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "remote-cert-ku"))
+    else if (streq_opt("remote-cert-ku"))
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
 
@@ -8412,12 +9095,12 @@ add_option(struct options *options,
             options->remote_cert_ku[0] = OPENVPN_KU_REQUIRED;
         }
     }
-    else if (streq(p[0], "remote-cert-eku") && p[1] && !p[2])
+    else if (streq_opt("remote-cert-eku") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->remote_cert_eku = p[1];
     }
-    else if (streq(p[0], "remote-cert-tls") && p[1] && !p[2])
+    else if (streq_opt("remote-cert-tls") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
 
@@ -8437,22 +9120,22 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "tls-timeout") && p[1] && !p[2])
+    else if (streq_opt("tls-timeout") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_TLS_PARMS);
         options->tls_timeout = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "reneg-bytes") && p[1] && !p[2])
+    else if (streq_opt("reneg-bytes") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_TLS_PARMS);
         options->renegotiate_bytes = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "reneg-pkts") && p[1] && !p[2])
+    else if (streq_opt("reneg-pkts") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_TLS_PARMS);
         options->renegotiate_packets = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "reneg-sec") && p[1] && !p[3])
+    else if (streq_opt("reneg-sec") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_TLS_PARMS);
         options->renegotiate_seconds = positive_atoi(p[1]);
@@ -8461,17 +9144,17 @@ add_option(struct options *options,
             options->renegotiate_seconds_min = positive_atoi(p[2]);
         }
     }
-    else if (streq(p[0], "hand-window") && p[1] && !p[2])
+    else if (streq_opt("hand-window") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_TLS_PARMS);
         options->handshake_window = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "tran-window") && p[1] && !p[2])
+    else if (streq_opt("tran-window") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_TLS_PARMS);
         options->transition_window = positive_atoi(p[1]);
     }
-    else if (streq(p[0], "tls-auth") && p[1] && !p[3])
+    else if (streq_opt("tls-auth") && p[1] && !p[3])
     {
         int key_direction = -1;
 
@@ -8510,7 +9193,7 @@ add_option(struct options *options,
             }
         }
     }
-    else if (streq(p[0], "tls-crypt") && p[1] && !p[3])
+    else if (streq_opt("tls-crypt") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION|OPT_P_INLINE);
         if (permission_mask & OPT_P_GENERAL)
@@ -8524,7 +9207,7 @@ add_option(struct options *options,
             options->ce.tls_crypt_file_inline = is_inline;
         }
     }
-    else if (streq(p[0], "tls-crypt-v2") && p[1] && !p[3])
+    else if (streq_opt("tls-crypt-v2") && p[1] && !p[3])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_CONNECTION|OPT_P_INLINE);
         if (permission_mask & OPT_P_GENERAL)
@@ -8538,18 +9221,18 @@ add_option(struct options *options,
             options->ce.tls_crypt_v2_file_inline = is_inline;
         }
     }
-    else if (streq(p[0], "tls-crypt-v2-verify") && p[1] && !p[2])
+    else if (streq_opt("tls-crypt-v2-verify") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->tls_crypt_v2_verify_script = p[1];
     }
-    else if (streq(p[0], "x509-track") && p[1] && !p[2])
+    else if (streq_opt("x509-track") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         x509_track_add(&options->x509_track, p[1], msglevel, &options->gc);
     }
 #ifdef ENABLE_X509ALTUSERNAME
-    else if (streq(p[0], "x509-username-field") && p[1])
+    else if (streq_opt("x509-username-field") && p[1])
     {
         /* This option used to automatically upcase the fieldnames passed as the
          * option arguments, e.g., "ou" became "OU". Now, this "helpfulness" is
@@ -8590,7 +9273,7 @@ add_option(struct options *options,
     }
 #endif /* ENABLE_X509ALTUSERNAME */
 #ifdef ENABLE_PKCS11
-    else if (streq(p[0], "show-pkcs11-ids") && !p[3])
+    else if (streq_opt("show-pkcs11-ids") && !p[3])
     {
         char *provider =  p[1];
         bool cert_private = (p[2] == NULL ? false : ( atoi(p[2]) != 0 ));
@@ -8626,7 +9309,7 @@ add_option(struct options *options,
         show_pkcs11_ids(provider, cert_private);
         openvpn_exit(OPENVPN_EXIT_STATUS_GOOD); /* exit point */
     }
-    else if (streq(p[0], "pkcs11-providers") && p[1])
+    else if (streq_opt("pkcs11-providers") && p[1])
     {
         int j;
 
@@ -8637,7 +9320,7 @@ add_option(struct options *options,
             options->pkcs11_providers[j-1] = p[j];
         }
     }
-    else if (streq(p[0], "pkcs11-protected-authentication"))
+    else if (streq_opt("pkcs11-protected-authentication"))
     {
         int j;
 
@@ -8648,7 +9331,7 @@ add_option(struct options *options,
             options->pkcs11_protected_authentication[j-1] = atoi(p[j]) != 0 ? 1 : 0;
         }
     }
-    else if (streq(p[0], "pkcs11-private-mode") && p[1])
+    else if (streq_opt("pkcs11-private-mode") && p[1])
     {
         int j;
 
@@ -8659,7 +9342,7 @@ add_option(struct options *options,
             sscanf(p[j], "%x", &(options->pkcs11_private_mode[j-1]));
         }
     }
-    else if (streq(p[0], "pkcs11-cert-private"))
+    else if (streq_opt("pkcs11-cert-private"))
     {
         int j;
 
@@ -8670,42 +9353,42 @@ add_option(struct options *options,
             options->pkcs11_cert_private[j-1] = atoi(p[j]) != 0 ? 1 : 0;
         }
     }
-    else if (streq(p[0], "pkcs11-pin-cache") && p[1] && !p[2])
+    else if (streq_opt("pkcs11-pin-cache") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->pkcs11_pin_cache_period = atoi(p[1]);
     }
-    else if (streq(p[0], "pkcs11-id") && p[1] && !p[2])
+    else if (streq_opt("pkcs11-id") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->pkcs11_id = p[1];
     }
-    else if (streq(p[0], "pkcs11-id-management") && !p[1])
+    else if (streq_opt("pkcs11-id-management") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->pkcs11_id_management = true;
     }
 #endif /* ifdef ENABLE_PKCS11 */
-    else if (streq(p[0], "rmtun") && !p[1])
+    else if (streq_opt("rmtun") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->persist_config = true;
         options->persist_mode = 0;
     }
-    else if (streq(p[0], "mktun") && !p[1])
+    else if (streq_opt("mktun") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->persist_config = true;
         options->persist_mode = 1;
     }
-    else if (streq(p[0], "peer-id") && p[1] && !p[2])
+    else if (streq_opt("peer-id") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_PEER_ID);
         options->use_peer_id = true;
         options->peer_id = atoi(p[1]);
     }
 #ifdef HAVE_EXPORT_KEYING_MATERIAL
-    else if (streq(p[0], "keying-material-exporter") && p[1] && p[2])
+    else if (streq_opt("keying-material-exporter") && p[1] && p[2])
     {
         int ekm_length = positive_atoi(p[2]);
 
@@ -8732,17 +9415,17 @@ add_option(struct options *options,
         options->keying_material_exporter_length = ekm_length;
     }
 #endif /* HAVE_EXPORT_KEYING_MATERIAL */
-    else if (streq(p[0], "allow-recursive-routing") && !p[1])
+    else if (streq_opt("allow-recursive-routing") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->allow_recursive_routing = true;
     }
-    else if (streq(p[0], "vlan-tagging") && !p[1])
+    else if (streq_opt("vlan-tagging") && !p[1])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         options->vlan_tagging = true;
     }
-    else if (streq(p[0], "vlan-accept") && p[1] && !p[2])
+    else if (streq_opt("vlan-accept") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL);
         if (streq(p[1], "tagged"))
@@ -8763,7 +9446,7 @@ add_option(struct options *options,
             goto err;
         }
     }
-    else if (streq(p[0], "vlan-pvid") && p[1] && !p[2])
+    else if (streq_opt("vlan-pvid") && p[1] && !p[2])
     {
         VERIFY_PERMISSION(OPT_P_GENERAL|OPT_P_INSTANCE);
         options->vlan_pvid = positive_atoi(p[1]);
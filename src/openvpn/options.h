@@ -258,11 +258,30 @@ struct options
     bool ifconfig_nowarn;
 #ifdef ENABLE_FEATURE_SHAPER
     int shaper;
+    int shaper_burst;           /* per-context bucket size, 0 = default */
+    bool shaper_pacing;         /* offload rate limiting to the kernel
+                                 * via SO_MAX_PACING_RATE when possible */
+    int shaper_global;          /* server: aggregate output cap, bytes/sec */
+    int shaper_global_burst;    /* server: aggregate bucket size, 0 = default */
 #endif
 
+    int prio_queue;             /* packets per band of the 3-band priority
+                                 * staging queue, 0 = disabled */
+
     int proto_force;
 
+#ifdef TARGET_LINUX
+    bool dco;                   /* offload the data channel to the kernel
+                                 * module when it is available */
+    bool udp_prefilter;         /* attach a BPF filter to the UDP socket
+                                 * dropping non-OpenVPN datagrams in kernel */
+    int numa_node;              /* prefer this NUMA node for memory
+                                 * allocation, -1 = no preference */
+#endif
+
     bool mtu_test;
+    bool mtu_probe;
+    bool mtu_tuner;
 
 #ifdef ENABLE_MEMSTATS
     char *memstats_fn;
@@ -285,6 +304,9 @@ struct options
 #define PING_RESTART 2
     int ping_rec_timeout_action; /* What action to take on ping_rec_timeout (exit or restart)? */
 
+    const char *link_standby_local; /* alternate local address to fail the UDP link over to
+                                     * on the first ping-restart expiry (point-to-point only) */
+
     bool persist_tun;           /* Don't close/reopen TUN/TAP dev on SIGUSR1 or PING_RESTART */
     bool persist_local_ip;      /* Don't re-resolve local address on SIGUSR1 or PING_RESTART */
     bool persist_remote_ip;     /* Don't re-resolve remote address on SIGUSR1 or PING_RESTART */
@@ -331,6 +353,13 @@ struct options
 
 #ifdef ENABLE_DEBUG
     int gremlin;
+    /* --bench-traffic synthetic traffic generator */
+    int bench_traffic_n;
+    int bench_traffic_size;
+    int bench_traffic_pps;
+    /* link read record/replay, see gremlin.c */
+    const char *gremlin_capture;
+    const char *gremlin_replay;
 #endif
 
     const char *status_file;
@@ -340,6 +369,21 @@ struct options
     /* optimize TUN/TAP/UDP writes */
     bool fast_io;
 
+    /* batched UDP I/O via recvmmsg()/sendmmsg(), 0 to disable */
+    int udp_mmsg;
+
+    /* greedy event-loop drain budget, 0 to disable */
+    int event_drain;
+
+    /* per-iteration housekeeping time budget in microseconds, 0 to
+     * disable; see --realtime */
+    int realtime_budget;
+
+#ifdef ENABLE_WORKER_THREADS
+    /* number of data channel worker threads (UDP server mode only) */
+    int n_worker_threads;
+#endif
+
 #ifdef USE_COMP
     struct compress_options comp;
 #endif
@@ -440,6 +484,7 @@ struct options
     const char *client_connect_script;
     const char *client_disconnect_script;
     const char *learn_address_script;
+    bool learn_address_async;
     const char *client_config_dir;
     bool ccd_exclusive;
     bool disable;
@@ -464,6 +509,12 @@ struct options
     bool duplicate_cn;
     int cf_max;
     int cf_per;
+    int cf_src_rate;            /* per-source unknown-datagram rate, 0 = off */
+    int cf_src_size;            /* per-source table slots, 0 = default */
+    int connect_budget;
+    const char *migrate_path;   /* --float-migration socket base path */
+    const char *persist_state_file; /* --persist-state: save established client
+                                     * key state across a server restart */
     int max_clients;
     int max_routes_per_client;
     int stale_routes_check_interval;
@@ -512,12 +563,15 @@ struct options
     const char *prng_hash;
     int prng_nonce_secret_len;
     const char *engine;
+    bool tls_async;
     bool replay;
     bool mute_replay_warnings;
     int replay_window;
     int replay_time;
+    bool replay_adaptive;
     const char *packet_id_file;
     bool test_crypto;
+    int test_crypto_perf;       /* iterations for the timed self-test, 0 to disable */
 #ifdef ENABLE_PREDICTION_RESISTANCE
     bool use_prediction_resistance;
 #endif
@@ -544,6 +598,7 @@ struct options
     const char *tls_cert_profile;
     const char *ecdh_curve;
     const char *tls_verify;
+    int tls_verify_cache; /* seconds to cache successful peer cert verification */
     int verify_x509_type;
     const char *verify_x509_name;
     const char *tls_export_cert;
@@ -651,6 +706,21 @@ struct options
 
     /* Use RFC5705 key export to generate data channel keys */
     bool data_channel_use_ekm;
+
+    /* use HKDF-SHA256 instead of the TLS 1.0 PRF for data channel key
+     * expansion (negotiated, see IV_PROTO_HKDF_EXPANSION) */
+    bool data_channel_use_hkdf;
+
+    /* Use 64-bit packet IDs on the AEAD data channel (negotiated) */
+    bool data_channel_pkt_id_64;
+
+    /* digest of the applied push set as pushed by the server; echoed in
+     * peer-info on reconnect so an unchanged set need not be resent
+     * (negotiated, see IV_PROTO_PUSH_DIGEST) */
+    const char *push_digest;
+
+    /* client announced IV_PROTO_PUSH_DIGEST support (server side) */
+    bool push_digest_peer;
 };
 
 #define streq(x, y) (!strcmp((x), (y)))
@@ -821,6 +891,35 @@ int parse_line(const char *line,
                int msglevel,
                struct gc_arena *gc);
 
+/*
+ * A configuration line pre-tokenized by options_parse_string(), for
+ * callers that apply the same option string repeatedly and want to
+ * skip re-tokenization.  Token strings are owned by the gc arena the
+ * string was parsed into.
+ */
+struct parsed_option_line
+{
+    bool is_inline;
+    int line_num;               /* line number in the original string */
+    int nparms;
+    char *parms[MAX_PARMS + 1];
+};
+
+int options_parse_string(const char *prefix,
+                         const char *config,
+                         struct parsed_option_line **lines,
+                         const int msglevel,
+                         struct gc_arena *gc);
+
+void options_import_parsed(struct options *options,
+                           const struct parsed_option_line *lines,
+                           int n_lines,
+                           const char *prefix,
+                           const int msglevel,
+                           const unsigned int permission_mask,
+                           unsigned int *option_types_found,
+                           struct env_set *es);
+
 /*
  * parse/print topology coding
  */
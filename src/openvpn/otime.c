@@ -35,6 +35,49 @@
 
 time_t now = 0;            /* GLOBAL */
 
+bool time_virtual = false; /* GLOBAL -- trace replay drives now/now_usec */
+
+struct timeval now_tv = { 0, 0 }; /* GLOBAL -- cached coarse timestamp */
+bool now_tv_valid = false;        /* GLOBAL */
+
+/*
+ * Refresh the cached coarse timestamp.  This is called at the
+ * explicit refresh points in the event loop (io_wait_dowork())
+ * so that per-packet time consumers can copy the cached value
+ * instead of issuing a time syscall per packet.  On Linux the
+ * refresh itself uses CLOCK_REALTIME_COARSE, which is a vDSO
+ * memory read with no kernel round trip.
+ */
+void
+time_cache_refresh(void)
+{
+    struct timeval tv;
+
+#ifdef CLOCK_REALTIME_COARSE
+    struct timespec ts;
+    if (!clock_gettime(CLOCK_REALTIME_COARSE, &ts))
+    {
+        tv.tv_sec = ts.tv_sec;
+        tv.tv_usec = (int)(ts.tv_nsec / 1000);
+    }
+    else
+#endif
+    if (gettimeofday(&tv, NULL))
+    {
+        return;
+    }
+
+#if TIME_BACKTRACK_PROTECTION
+    update_now_usec(&tv);
+    tv.tv_sec = now;
+    tv.tv_usec = now_usec;
+#else
+    now = tv.tv_sec;
+#endif
+    now_tv = tv;
+    now_tv_valid = true;
+}
+
 #if TIME_BACKTRACK_PROTECTION
 
 static time_t now_adj = 0; /* GLOBAL */
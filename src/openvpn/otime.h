@@ -53,6 +53,16 @@ const char *tv_string_abs(const struct timeval *tv, struct gc_arena *gc);
 
 extern time_t now; /* updated frequently to time(NULL) */
 
+/* when set, update_time() is a no-op and the trace replay driver
+ * assigns now/now_usec from recorded timestamps (see gremlin.c) */
+extern bool time_virtual;
+
+/* cached coarse timestamp, refreshed once per event-loop pass */
+extern struct timeval now_tv;
+extern bool now_tv_valid;
+
+void time_cache_refresh(void);
+
 void time_test(void);
 
 #if TIME_BACKTRACK_PROTECTION
@@ -78,6 +88,10 @@ openvpn_gettimeofday(struct timeval *tv, void *tz)
 static inline void
 update_time(void)
 {
+    if (time_virtual)
+    {
+        return;
+    }
 #ifdef _WIN32
     /* on _WIN32, gettimeofday is faster than time(NULL) */
     struct timeval tv;
@@ -93,6 +107,10 @@ update_time(void)
 static inline void
 update_time(void)
 {
+    if (time_virtual)
+    {
+        return;
+    }
 #if defined(_WIN32)
     /* on _WIN32, gettimeofday is faster than time(NULL) */
     struct timeval tv;
@@ -120,6 +138,25 @@ openvpn_gettimeofday(struct timeval *tv, void *tz)
 
 #endif /* TIME_BACKTRACK_PROTECTION */
 
+/*
+ * Copy the cached coarse timestamp, falling back to a real
+ * gettimeofday() before the first event-loop refresh.  The cache
+ * is refreshed once per io_wait_dowork() pass, which bounds its
+ * error by the duration of a single pass -- the same tolerance
+ * that 'now' already operates under.  Use this in per-packet
+ * paths where that tolerance is acceptable.
+ */
+static inline int
+openvpn_gettimeofday_coarse(struct timeval *tv)
+{
+    if (now_tv_valid)
+    {
+        *tv = now_tv;
+        return 0;
+    }
+    return openvpn_gettimeofday(tv, NULL);
+}
+
 static inline time_t
 openvpn_time(time_t *t)
 {
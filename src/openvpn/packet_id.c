@@ -46,13 +46,6 @@
 
 /* #define PID_SIMULATE_BACKTRACK */
 
-/*
- * Special time_t value that indicates that
- * sequence number has expired.
- */
-#define SEQ_UNSEEN  ((time_t)0)
-#define SEQ_EXPIRED ((time_t)1)
-
 static void packet_id_debug_print(int msglevel,
                                   const struct packet_id_rec *p,
                                   const struct packet_id_net *pin,
@@ -90,7 +83,8 @@ packet_id_init(struct packet_id *p, int seq_backtrack, int time_backtrack, const
     {
         ASSERT(MIN_SEQ_BACKTRACK <= seq_backtrack && seq_backtrack <= MAX_SEQ_BACKTRACK);
         ASSERT(MIN_TIME_BACKTRACK <= time_backtrack && time_backtrack <= MAX_TIME_BACKTRACK);
-        CIRC_LIST_ALLOC(p->rec.seq_list, struct seq_list, seq_backtrack);
+        p->rec.bitmap_words = (seq_backtrack + 63) / 64;
+        ALLOC_ARRAY_CLEAR(p->rec.seq_bitmap, uint64_t, p->rec.bitmap_words);
         p->rec.seq_backtrack = seq_backtrack;
         p->rec.time_backtrack = time_backtrack;
     }
@@ -103,92 +97,144 @@ packet_id_free(struct packet_id *p)
     if (p)
     {
         dmsg(D_PID_DEBUG, "PID packet_id_free");
-        free(p->rec.seq_list);
+        free(p->rec.seq_bitmap);
         CLEAR(*p);
     }
 }
 
-void
-packet_id_add(struct packet_id_rec *p, const struct packet_id_net *pin)
+static inline struct packet_id_rec_stats *
+packet_id_stats(struct packet_id_rec *p)
 {
-    const time_t local_now = now;
-    if (p->seq_list)
+    return p->stats_sink ? p->stats_sink : &p->stats;
+}
+
+static inline bool
+packet_id_bitmap_test(const struct packet_id_rec *p, uint64_t diff)
+{
+    return (p->seq_bitmap[diff / 64] >> (diff % 64)) & 1;
+}
+
+static inline void
+packet_id_bitmap_set(struct packet_id_rec *p, uint64_t diff)
+{
+    p->seq_bitmap[diff / 64] |= ((uint64_t)1) << (diff % 64);
+}
+
+/*
+ * Slide the window forward by n sequence numbers, i.e. shift every
+ * bit towards higher diff values.
+ */
+static void
+packet_id_bitmap_advance(struct packet_id_rec *p, uint64_t n)
+{
+    if (n >= (uint64_t)p->seq_backtrack)
+    {
+        memset(p->seq_bitmap, 0, p->bitmap_words * sizeof(uint64_t));
+    }
+    else
     {
-        packet_id_type diff;
+        const int word_shift = n / 64;
+        const int bit_shift = n % 64;
+        int i;
 
-        /*
-         * If time value increases, start a new
-         * sequence number sequence.
-         */
-        if (!CIRC_LIST_SIZE(p->seq_list)
-            || pin->time > p->time
-            || (pin->id >= (packet_id_type)p->seq_backtrack
-                && pin->id - (packet_id_type)p->seq_backtrack > p->id))
+        for (i = p->bitmap_words - 1; i >= 0; --i)
         {
-            p->time = pin->time;
-            p->id = 0;
-            if (pin->id > (packet_id_type)p->seq_backtrack)
+            const int src = i - word_shift;
+            uint64_t v = 0;
+
+            if (src >= 0)
             {
-                p->id = pin->id - (packet_id_type)p->seq_backtrack;
+                v = p->seq_bitmap[src] << bit_shift;
+                if (bit_shift && src > 0)
+                {
+                    v |= p->seq_bitmap[src - 1] >> (64 - bit_shift);
+                }
             }
-            CIRC_LIST_RESET(p->seq_list);
+            p->seq_bitmap[i] = v;
         }
+    }
+}
 
-        while (p->id < pin->id
-#ifdef PID_SIMULATE_BACKTRACK
-               || (get_random() % 64) < 31
-#endif
-               )
-        {
-            CIRC_LIST_PUSH(p->seq_list, SEQ_UNSEEN);
-            ++p->id;
-        }
+/*
+ * Adaptive replay window: grow the bitmap in power-of-two steps, up to
+ * seq_backtrack_max, so that deep but legitimate reordering does not
+ * cost drops.  Bits are indexed relative to the highest sequence number
+ * received, so growing only extends the window into the past; existing
+ * bits keep their positions.
+ */
+static void
+packet_id_window_grow(struct packet_id_rec *p, uint64_t min_backtrack)
+{
+    int new_backtrack = p->seq_backtrack;
 
-        diff = p->id - pin->id;
-        if (diff < (packet_id_type) CIRC_LIST_SIZE(p->seq_list)
-            && local_now > SEQ_EXPIRED)
-        {
-            CIRC_LIST_ITEM(p->seq_list, diff) = local_now;
-        }
+    while (new_backtrack < p->seq_backtrack_max
+           && (uint64_t)new_backtrack < min_backtrack)
+    {
+        new_backtrack *= 2;
     }
-    else
+    if (new_backtrack > p->seq_backtrack_max)
     {
-        p->time = pin->time;
-        p->id = pin->id;
+        new_backtrack = p->seq_backtrack_max;
+    }
+    if (new_backtrack <= p->seq_backtrack)
+    {
+        return;
     }
+
+    const int new_words = (new_backtrack + 63) / 64;
+    uint64_t *new_bitmap;
+    ALLOC_ARRAY_CLEAR(new_bitmap, uint64_t, new_words);
+    memcpy(new_bitmap, p->seq_bitmap, p->bitmap_words * sizeof(uint64_t));
+    free(p->seq_bitmap);
+    p->seq_bitmap = new_bitmap;
+    p->bitmap_words = new_words;
+
+    msg(D_REPLAY_ERRORS, "PID: deep reorder detected [%s-%d], growing "
+        "replay window %d -> %d", p->name, p->unit,
+        p->seq_backtrack, new_backtrack);
+    p->seq_backtrack = new_backtrack;
 }
 
-/*
- * Expire sequence numbers which can no longer
- * be accepted because they would violate
- * time_backtrack.
- */
 void
-packet_id_reap(struct packet_id_rec *p)
+packet_id_add(struct packet_id_rec *p, const struct packet_id_net *pin)
 {
     const time_t local_now = now;
-    if (p->time_backtrack)
+    if (p->seq_bitmap)
     {
-        int i;
-        bool expire = false;
-        for (i = 0; i < CIRC_LIST_SIZE(p->seq_list); ++i)
+        /*
+         * If the time value increases, or nothing has been received
+         * yet, start a new sequence number sequence.
+         */
+        if (!p->id || pin->time > p->time)
         {
-            const time_t t = CIRC_LIST_ITEM(p->seq_list, i);
-            if (t == SEQ_EXPIRED)
-            {
-                break;
-            }
-            if (!expire && t && t + p->time_backtrack < local_now)
-            {
-                expire = true;
-            }
-            if (expire)
+            p->time = pin->time;
+            p->id = pin->id;
+            memset(p->seq_bitmap, 0, p->bitmap_words * sizeof(uint64_t));
+            packet_id_bitmap_set(p, 0);
+            p->last_advance = local_now;
+        }
+        else if (pin->id > p->id)
+        {
+            /* slide the window; a jump beyond the window zeroes it */
+            packet_id_bitmap_advance(p, pin->id - p->id);
+            p->id = pin->id;
+            packet_id_bitmap_set(p, 0);
+            p->last_advance = local_now;
+        }
+        else
+        {
+            const uint64_t diff = p->id - pin->id;
+            if (diff < (uint64_t)p->seq_backtrack)
             {
-                CIRC_LIST_ITEM(p->seq_list, i) = SEQ_EXPIRED;
+                packet_id_bitmap_set(p, diff);
             }
         }
     }
-    p->last_reap = local_now;
+    else
+    {
+        p->time = pin->time;
+        p->id = pin->id;
+    }
 }
 
 /*
@@ -199,7 +245,7 @@ bool
 packet_id_test(struct packet_id_rec *p,
                const struct packet_id_net *pin)
 {
-    packet_id_type diff;
+    uint64_t diff;
 
     packet_id_debug(D_PID_DEBUG, p, pin, "PID_TEST", 0);
 
@@ -230,35 +276,58 @@ packet_id_test(struct packet_id_rec *p,
             diff = p->id - pin->id;
 
             /* keep track of maximum backtrack seen for debugging purposes */
-            if ((int)diff > p->max_backtrack_stat)
+            if (diff < INT_MAX && (int)diff > p->max_backtrack_stat)
             {
                 p->max_backtrack_stat = (int)diff;
                 packet_id_debug(D_PID_DEBUG_LOW, p, pin, "PID_ERR replay-window backtrack occurred", p->max_backtrack_stat);
+                if (p->max_backtrack_stat > packet_id_stats(p)->max_reorder)
+                {
+                    packet_id_stats(p)->max_reorder = p->max_backtrack_stat;
+                }
+            }
+
+            /* adaptive mode: grow the window, with some headroom, when
+             * the reorder depth approaches its current size */
+            if (p->seq_backtrack_max > p->seq_backtrack
+                && diff + (diff / 4) >= (uint64_t)p->seq_backtrack)
+            {
+                packet_id_window_grow(p, diff + (diff / 4));
             }
 
-            if (diff >= (packet_id_type) CIRC_LIST_SIZE(p->seq_list))
+            if (diff >= (uint64_t)p->seq_backtrack)
             {
                 packet_id_debug(D_PID_DEBUG_LOW, p, pin, "PID_ERR large diff", diff);
+                ++packet_id_stats(p)->n_out_of_window;
                 return false;
             }
 
+            if (packet_id_bitmap_test(p, diff))
             {
-                const time_t v = CIRC_LIST_ITEM(p->seq_list, diff);
-                if (v == 0)
-                {
-                    return true;
-                }
-                else
-                {
-                    /* raised from D_PID_DEBUG_LOW to reduce verbosity */
-                    packet_id_debug(D_PID_DEBUG_MEDIUM, p, pin, "PID_ERR replay", diff);
-                    return false;
-                }
+                /* raised from D_PID_DEBUG_LOW to reduce verbosity */
+                packet_id_debug(D_PID_DEBUG_MEDIUM, p, pin, "PID_ERR replay", diff);
+                ++packet_id_stats(p)->n_replay;
+                return false;
+            }
+
+            /*
+             * If the window has been stale for longer than
+             * time_backtrack, unseen sequence numbers within it are
+             * too old to still be acceptable.
+             */
+            if (p->time_backtrack
+                && p->last_advance + p->time_backtrack < now)
+            {
+                packet_id_debug(D_PID_DEBUG_LOW, p, pin, "PID_ERR expired", diff);
+                ++packet_id_stats(p)->n_time_backtrack;
+                return false;
             }
+
+            return true;
         }
         else if (pin->time < p->time) /* if time goes back, reject */
         {
             packet_id_debug(D_PID_DEBUG_LOW, p, pin, "PID_ERR time backtrack", 0);
+            ++packet_id_stats(p)->n_time_backtrack;
             return false;
         }
         else                        /* time moved forward */
@@ -276,15 +345,33 @@ packet_id_test(struct packet_id_rec *p,
          */
         if (pin->time == p->time)
         {
-            return !p->id || pin->id == p->id + 1;
+            if (!p->id || pin->id == p->id + 1)
+            {
+                return true;
+            }
+            if (pin->id <= p->id)
+            {
+                ++packet_id_stats(p)->n_replay;
+            }
+            else
+            {
+                ++packet_id_stats(p)->n_out_of_window;
+            }
+            return false;
         }
         else if (pin->time < p->time) /* if time goes back, reject */
         {
+            ++packet_id_stats(p)->n_time_backtrack;
             return false;
         }
         else                        /* time moved forward */
         {
-            return pin->id == 1;
+            if (pin->id == 1)
+            {
+                return true;
+            }
+            ++packet_id_stats(p)->n_out_of_window;
+            return false;
         }
     }
 }
@@ -351,7 +438,7 @@ packet_id_write(struct packet_id_send *p, struct buffer *buf, bool long_form,
         return false;
     }
 
-    const packet_id_type net_id = htonpid(p->id);
+    const packet_id_type net_id = htonpid((packet_id_type)p->id);
     const net_time_t net_time = htontime(p->time);
     if (prepend)
     {
@@ -384,12 +471,42 @@ packet_id_write(struct packet_id_send *p, struct buffer *buf, bool long_form,
     return true;
 }
 
+bool
+packet_id_read64(struct packet_id_net *pin, struct buffer *buf)
+{
+    uint32_t net_id[2];
+
+    pin->id = 0;
+    pin->time = 0;
+
+    if (!buf_read(buf, net_id, sizeof(net_id)))
+    {
+        return false;
+    }
+    pin->id = ((uint64_t)ntohl(net_id[0]) << 32) | ntohl(net_id[1]);
+    return true;
+}
+
+bool
+packet_id_write64(struct packet_id_send *p, struct buffer *buf)
+{
+    if (p->id == UINT64_MAX)
+    {
+        return false;
+    }
+    ++p->id;
+
+    const uint32_t net_id[2] = { htonl((uint32_t)(p->id >> 32)),
+                                 htonl((uint32_t)p->id) };
+    return buf_write(buf, net_id, sizeof(net_id));
+}
+
 const char *
 packet_id_net_print(const struct packet_id_net *pin, bool print_timestamp, struct gc_arena *gc)
 {
     struct buffer out = alloc_buf_gc(256, gc);
 
-    buf_printf(&out, "[ #" packet_id_format, (packet_id_print_type)pin->id);
+    buf_printf(&out, "[ #%" PRIu64, pin->id);
     if (print_timestamp && pin->time)
     {
         buf_printf(&out, " / time = (" packet_id_format ") %s",
@@ -562,7 +679,6 @@ packet_id_debug_print(int msglevel,
     struct buffer out = alloc_buf_gc(256, &gc);
     struct timeval tv;
     const time_t prev_now = now;
-    const struct seq_list *sl = p->seq_list;
     int i;
 
     CLEAR(tv);
@@ -570,43 +686,15 @@ packet_id_debug_print(int msglevel,
 
     buf_printf(&out, "%s [%d]", message, value);
     buf_printf(&out, " [%s-%d] [", p->name, p->unit);
-    for (i = 0; sl != NULL && i < sl->x_size; ++i)
+    for (i = 0; p->seq_bitmap != NULL && i < p->seq_backtrack && i < 256; ++i)
     {
-        char c;
-        time_t v;
-        int diff;
-
-        v = CIRC_LIST_ITEM(sl, i);
-        if (v == SEQ_UNSEEN)
-        {
-            c = '_';
-        }
-        else if (v == SEQ_EXPIRED)
-        {
-            c = 'E';
-        }
-        else
-        {
-            diff = (int) prev_now - v;
-            if (diff < 0)
-            {
-                c = 'N';
-            }
-            else if (diff < 10)
-            {
-                c = '0' + diff;
-            }
-            else
-            {
-                c = '>';
-            }
-        }
-        buf_printf(&out, "%c", c);
+        buf_printf(&out, "%c",
+                   (p->seq_bitmap[i / 64] >> (i % 64)) & 1 ? 'x' : '_');
     }
-    buf_printf(&out, "] %" PRIi64 ":" packet_id_format, (int64_t)p->time, (packet_id_print_type)p->id);
+    buf_printf(&out, "] %" PRIi64 ":%" PRIu64, (int64_t)p->time, p->id);
     if (pin)
     {
-        buf_printf(&out, " %" PRIi64 ":" packet_id_format, (int64_t)pin->time, (packet_id_print_type)pin->id);
+        buf_printf(&out, " %" PRIi64 ":%" PRIu64, (int64_t)pin->time, pin->id);
     }
 
     buf_printf(&out, " t=%" PRIi64 "[%d]",
@@ -614,20 +702,11 @@ packet_id_debug_print(int msglevel,
                (int)(prev_now - tv.tv_sec));
 
     buf_printf(&out, " r=[%d,%d,%d,%d,%d]",
-               (int)(p->last_reap - tv.tv_sec),
+               (int)(p->last_advance - tv.tv_sec),
                p->seq_backtrack,
                p->time_backtrack,
                p->max_backtrack_stat,
                (int)p->initialized);
-    if (sl != NULL)
-    {
-        buf_printf(&out, " sl=[%d,%d,%d,%d]",
-                   sl->x_head,
-                   sl->x_size,
-                   sl->x_cap,
-                   sl->x_sizeof);
-    }
-
 
     msg(msglevel, "%s", BSTR(&out));
     gc_free(&gc);
@@ -661,7 +740,6 @@ packet_id_interactive_test(void)
         update_time();
         if (sscanf(buf, "%lu,%u", &pin.time, &pin.id) == 2)
         {
-            packet_id_reap_test(&pid.rec);
             test = packet_id_test(&pid.rec, &pin);
             printf("packet_id_test (%" PRIi64 ", " packet_id_format ") returned %d\n",
                    (int64_t)pin.time,
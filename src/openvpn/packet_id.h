@@ -30,7 +30,6 @@
 #ifndef PACKET_ID_H
 #define PACKET_ID_H
 
-#include "circ_list.h"
 #include "buffer.h"
 #include "error.h"
 #include "otime.h"
@@ -89,6 +88,14 @@ typedef uint16_t net_time_t;
 
 #endif /* if 1 */
 
+/*
+ * With the negotiated 64-bit packet ID format (AEAD data channel only),
+ * the full 64-bit counter is sent on the wire and the counter cannot
+ * realistically be exhausted, but keep a trigger for symmetry with the
+ * 32-bit form.
+ */
+#define PACKET_ID64_WRAP_TRIGGER 0xFF00000000000000ull
+
 /*
  * Printf formats for special types
  */
@@ -114,31 +121,46 @@ typedef unsigned int packet_id_print_type;
 #define DEFAULT_TIME_BACKTRACK 15
 
 /*
- * Do a reap pass through the sequence number
- * array once every n seconds in order to
- * expire sequence numbers which can no longer
- * be accepted because they would violate
- * TIME_BACKTRACK.
+ * Replay window drop statistics, kept by the receiving side.  Counts
+ * go into the packet_id_rec's own struct, or into an external
+ * accumulator when one is configured with
+ * packet_id_rec_set_stats_sink(), so that per-client totals survive
+ * data channel rekeying.
  */
-#define SEQ_REAP_INTERVAL 5
-
-CIRC_LIST(seq_list, time_t);
+struct packet_id_rec_stats
+{
+    counter_type n_replay;         /* duplicate sequence number */
+    counter_type n_out_of_window;  /* reorder depth exceeded the window */
+    counter_type n_time_backtrack; /* timestamp went backwards or window expired */
+    int max_reorder;               /* deepest reorder depth observed */
+};
 
 /*
  * This is the data structure we keep on the receiving side,
  * to check that no packet-id (i.e. sequence number + optional timestamp)
  * is accepted more than once.
+ *
+ * The replay "memory" is a sliding bitmap window as used by IPsec:
+ * bit i of seq_bitmap records whether sequence number (id - i) has
+ * been seen, giving constant-time test/add with no periodic reap
+ * pass and 1 bit (rather than sizeof(time_t)) per --replay-window
+ * entry.
  */
 struct packet_id_rec
 {
-    time_t last_reap;         /* last call of packet_id_reap */
     time_t time;              /* highest time stamp received */
-    packet_id_type id;        /* highest sequence number received */
+    time_t last_advance;      /* time 'id' last moved forward */
+    uint64_t id;              /* highest sequence number received */
     int seq_backtrack;        /* set from --replay-window */
     int time_backtrack;       /* set from --replay-window */
+    int seq_backtrack_max;    /* upper bound for adaptive window growth,
+                               * 0 for a fixed-size window */
     int max_backtrack_stat;   /* maximum backtrack seen so far */
     bool initialized;         /* true if packet_id_init was called */
-    struct seq_list *seq_list; /* packet-id "memory" */
+    uint64_t *seq_bitmap;     /* sliding replay window */
+    int bitmap_words;         /* 64-bit words allocated in seq_bitmap */
+    struct packet_id_rec_stats stats;       /* drop statistics */
+    struct packet_id_rec_stats *stats_sink; /* optional external accumulator */
     const char *name;
     int unit;
 };
@@ -169,7 +191,7 @@ struct packet_id_persist_file_image
  */
 struct packet_id_send
 {
-    packet_id_type id;
+    uint64_t id;
     time_t time;
 };
 
@@ -177,7 +199,10 @@ struct packet_id_send
  * Communicate packet-id over the wire.
  * A short packet-id is just a 32 bit
  * sequence number.  A long packet-id
- * includes a timestamp as well.
+ * includes a timestamp as well.  The
+ * negotiated AEAD format carries the
+ * full 64-bit sequence number instead
+ * (see packet_id_read64/write64).
  *
  * Long packet-ids are used as IVs for
  * CFB/OFB ciphers.
@@ -198,7 +223,7 @@ struct packet_id_send
  */
 struct packet_id_net
 {
-    packet_id_type id;
+    uint64_t id;
     time_t time; /* converted to net_time_t before transmission */
 };
 
@@ -220,9 +245,6 @@ bool packet_id_test(struct packet_id_rec *p,
 void packet_id_add(struct packet_id_rec *p,
                    const struct packet_id_net *pin);
 
-/* expire TIME_BACKTRACK sequence numbers */
-void packet_id_reap(struct packet_id_rec *p);
-
 /*
  * packet ID persistence
  */
@@ -265,6 +287,24 @@ bool packet_id_read(struct packet_id_net *pin, struct buffer *buf, bool long_for
 bool packet_id_write(struct packet_id_send *p, struct buffer *buf,
                      bool long_form, bool prepend);
 
+/*
+ * Read/write the 64-bit packet ID format: the full sequence number,
+ * big-endian, no timestamp.  Used for the AEAD data channel when
+ * 64-bit packet IDs have been negotiated.
+ */
+
+bool packet_id_read64(struct packet_id_net *pin, struct buffer *buf);
+
+/**
+ * Write a 64-bit packet ID to buf, and update the packet ID state.
+ *
+ * @param p             Packet ID state.
+ * @param buf           Buffer to append the packet ID to.
+ *
+ * @return true if successful, false otherwise.
+ */
+bool packet_id_write64(struct packet_id_send *p, struct buffer *buf);
+
 /*
  * Inline functions.
  */
@@ -276,6 +316,26 @@ packet_id_initialized(const struct packet_id *pid)
     return pid->rec.initialized;
 }
 
+/** Route replay drop statistics into \c sink, a longer-lived
+ * accumulator, instead of the record's own counters. */
+static inline void
+packet_id_rec_set_stats_sink(struct packet_id_rec *rec,
+                             struct packet_id_rec_stats *sink)
+{
+    rec->stats_sink = sink;
+}
+
+/** Allow the replay window to grow on demand up to \c seq_backtrack_max
+ * sequence numbers when deep packet reordering is observed. */
+static inline void
+packet_id_rec_set_adaptive(struct packet_id_rec *rec, int seq_backtrack_max)
+{
+    if (rec->seq_bitmap && seq_backtrack_max > rec->seq_backtrack)
+    {
+        rec->seq_backtrack_max = seq_backtrack_max;
+    }
+}
+
 /* are we in enabled state? */
 static inline bool
 packet_id_persist_enabled(const struct packet_id_persist *p)
@@ -290,7 +350,9 @@ packet_id_persist_save_obj(struct packet_id_persist *p, const struct packet_id *
     if (packet_id_persist_enabled(p) && pid->rec.time)
     {
         p->time = pid->rec.time;
-        p->id = pid->rec.id;
+        /* persistence is only used in static key mode, where the
+         * on-the-wire sequence number is 32-bit */
+        p->id = (packet_id_type)pid->rec.id;
     }
 }
 
@@ -308,9 +370,10 @@ packet_id_size(bool long_form)
 }
 
 static inline bool
-packet_id_close_to_wrapping(const struct packet_id_send *p)
+packet_id_close_to_wrapping(const struct packet_id_send *p, bool wide)
 {
-    return p->id >= PACKET_ID_WRAP_TRIGGER;
+    return p->id >= (wide ? PACKET_ID64_WRAP_TRIGGER
+                          : (uint64_t)PACKET_ID_WRAP_TRIGGER);
 }
 
 static inline bool
@@ -330,13 +393,4 @@ check_timestamp_delta(time_t remote, unsigned int max_delta)
     return abs <= max_delta;
 }
 
-static inline void
-packet_id_reap_test(struct packet_id_rec *p)
-{
-    if (p->last_reap + SEQ_REAP_INTERVAL <= now)
-    {
-        packet_id_reap(p);
-    }
-}
-
 #endif /* PACKET_ID_H */
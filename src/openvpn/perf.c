@@ -31,8 +31,6 @@
 
 #include "perf.h"
 
-#ifdef ENABLE_PERFORMANCE_METRICS
-
 #include "error.h"
 #include "otime.h"
 
@@ -61,6 +59,217 @@ static const char *metric_names[] = {
     "PERF_PROC_OUT_TUN_MTCP"
 };
 
+/*
+ * Always-compiled latency histogram layer (see perf.h).  All state
+ * is only ever touched from the main thread.
+ */
+
+struct perf_hist
+{
+    uint64_t count;
+    uint64_t sum;   /* raw time units (TSC cycles or nanoseconds) */
+    uint64_t max;
+    uint32_t bucket[PERF_HIST_BUCKETS]; /* log2(raw delta) buckets */
+};
+
+static struct perf_hist perf_hist[PERF_N]; /* GLOBAL */
+
+/* monotonic wallclock used to calibrate raw time units at dump time */
+static uint64_t
+perf_wallclock_ns(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER c, f;
+    QueryPerformanceCounter(&c);
+    QueryPerformanceFrequency(&f);
+    return (uint64_t)((double)c.QuadPart * 1e9 / (double)f.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/* cheap raw timestamp: TSC on x86, monotonic nanoseconds elsewhere */
+static inline uint64_t
+perf_cycles(void)
+{
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+    return __rdtsc();
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return perf_wallclock_ns();
+#endif
+}
+
+/* calibration baseline, taken at the first recorded sample */
+static uint64_t perf_cal_cycles; /* GLOBAL */
+static uint64_t perf_cal_ns;     /* GLOBAL */
+
+static void
+perf_hist_record(const int type, const uint64_t delta)
+{
+    struct perf_hist *h = &perf_hist[type];
+    uint64_t d = delta;
+    int b = 0;
+
+    if (!perf_cal_ns)
+    {
+        perf_cal_cycles = perf_cycles();
+        perf_cal_ns = perf_wallclock_ns();
+    }
+
+    ++h->count;
+    h->sum += delta;
+    if (delta > h->max)
+    {
+        h->max = delta;
+    }
+    while (d > 1 && b < PERF_HIST_BUCKETS - 1)
+    {
+        d >>= 1;
+        ++b;
+    }
+    ++h->bucket[b];
+}
+
+/* raw time units per microsecond, measured against the monotonic clock */
+static double
+perf_cycles_per_usec(void)
+{
+    if (perf_cal_ns)
+    {
+        const uint64_t ns = perf_wallclock_ns();
+        if (ns > perf_cal_ns)
+        {
+            return (double)(perf_cycles() - perf_cal_cycles) * 1000.0
+                   / (double)(ns - perf_cal_ns);
+        }
+    }
+    return 1000.0; /* raw units are nanoseconds until calibrated */
+}
+
+/* upper bound of a histogram bucket, converted to microseconds */
+static double
+perf_bucket_usec(const int bucket, const double cpu)
+{
+    return (double)((uint64_t)1 << (bucket + 1)) / cpu;
+}
+
+static double
+perf_hist_percentile_usec(const struct perf_hist *h, const double frac,
+                          const double cpu)
+{
+    const uint64_t target = (uint64_t)((double)h->count * frac);
+    uint64_t acc = 0;
+
+    for (int b = 0; b < PERF_HIST_BUCKETS; ++b)
+    {
+        acc += h->bucket[b];
+        if (acc > target)
+        {
+            return perf_bucket_usec(b, cpu);
+        }
+    }
+    return (double)h->max / cpu;
+}
+
+void
+perf_hist_reset(void)
+{
+    CLEAR(perf_hist);
+    perf_cal_cycles = 0;
+    perf_cal_ns = 0;
+}
+
+/*
+ * Dump the histograms to the management client -- handler for the
+ * 'perf' command.  p50/p99 are bucket upper bounds, i.e. accurate
+ * to a factor of two.
+ */
+void
+perf_hist_output_client(void)
+{
+    const double cpu = perf_cycles_per_usec();
+
+    msg(M_CLIENT, "PERF,name,n,mean_usec,p50_usec,p99_usec,max_usec");
+    for (int i = 0; i < PERF_N; ++i)
+    {
+        const struct perf_hist *h = &perf_hist[i];
+        if (h->count)
+        {
+            msg(M_CLIENT, "PERF,%s,%" PRIu64 ",%.1f,%.1f,%.1f,%.1f",
+                metric_names[i],
+                h->count,
+                (double)h->sum / (double)h->count / cpu,
+                perf_hist_percentile_usec(h, 0.50, cpu),
+                perf_hist_percentile_usec(h, 0.99, cpu),
+                (double)h->max / cpu);
+        }
+    }
+    msg(M_CLIENT, "END");
+}
+
+/* event-loop service time: everything between two event waits */
+static uint64_t perf_loop_start; /* GLOBAL */
+
+void
+perf_loop_enter(void)
+{
+    perf_loop_start = perf_cycles();
+}
+
+void
+perf_loop_exit(void)
+{
+    if (perf_loop_start)
+    {
+        perf_hist_record(PERF_EVENT_LOOP, perf_cycles() - perf_loop_start);
+        perf_loop_start = 0;
+    }
+}
+
+#ifndef ENABLE_PERFORMANCE_METRICS
+
+/*
+ * Default perf_push()/perf_pop(): a depth-capped stack of start
+ * timestamps feeding the histograms.  Unlike the full
+ * ENABLE_PERFORMANCE_METRICS profiler below, nested sections are
+ * included in their parent's time.
+ */
+static int perf_hist_stack[STACK_N];           /* GLOBAL */
+static uint64_t perf_hist_start[STACK_N];      /* GLOBAL */
+static int perf_hist_depth;                    /* GLOBAL */
+
+void
+perf_push(int type)
+{
+    if (perf_hist_depth < STACK_N && type >= 0 && type < PERF_N)
+    {
+        perf_hist_stack[perf_hist_depth] = type;
+        perf_hist_start[perf_hist_depth] = perf_cycles();
+        ++perf_hist_depth;
+    }
+}
+
+void
+perf_pop(void)
+{
+    if (perf_hist_depth > 0)
+    {
+        --perf_hist_depth;
+        perf_hist_record(perf_hist_stack[perf_hist_depth],
+                         perf_cycles() - perf_hist_start[perf_hist_depth]);
+    }
+}
+
+#endif /* ifndef ENABLE_PERFORMANCE_METRICS */
+
+#ifdef ENABLE_PERFORMANCE_METRICS
+
 struct perf
 {
 #define PS_INITIAL            0
@@ -319,11 +528,4 @@ perf_print_state(int lev)
     gc_free(&gc);
 }
 
-#else  /* ifdef ENABLE_PERFORMANCE_METRICS */
-#ifdef _MSC_VER  /* Dummy function needed to avoid empty file compiler warning in Microsoft VC */
-static void
-dummy(void)
-{
-}
-#endif
 #endif /* ifdef ENABLE_PERFORMANCE_METRICS */
@@ -57,8 +57,6 @@
 #define PERF_PROC_OUT_TUN_MTCP      19
 #define PERF_N                      20
 
-#ifdef ENABLE_PERFORMANCE_METRICS
-
 #include "basic.h"
 
 /*
@@ -70,18 +68,32 @@ void perf_push(int type);
 
 void perf_pop(void);
 
+/*
+ * Lightweight latency histograms, compiled in by default.  Each
+ * perf_push()/perf_pop() section records its duration (including
+ * nested sections) into a per-metric log2 histogram using the TSC
+ * where available, so p50/p99/max per section can be dumped at
+ * runtime via the management 'perf' command.  perf_loop_exit() and
+ * perf_loop_enter() bracket the event wait in io_wait_dowork() and
+ * feed the PERF_EVENT_LOOP metric with the time spent servicing one
+ * loop pass (i.e. everything between two waits).
+ */
+#define PERF_HIST_BUCKETS 32
+
+void perf_loop_enter(void);
+
+void perf_loop_exit(void);
+
+void perf_hist_reset(void);
+
+void perf_hist_output_client(void);
+
+#ifdef ENABLE_PERFORMANCE_METRICS
+
 void perf_output_results(void);
 
 #else  /* ifdef ENABLE_PERFORMANCE_METRICS */
 
-static inline void
-perf_push(int type)
-{
-}
-static inline void
-perf_pop(void)
-{
-}
 static inline void
 perf_output_results(void)
 {
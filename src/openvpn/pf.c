@@ -68,6 +68,7 @@ pf_destroy(struct pf_set *pfs)
                 l = next;
             }
         }
+        free(pfs->sns.ranges);
         free(pfs);
     }
 }
@@ -177,6 +178,88 @@ genhash(struct pf_cn_set *cns, const char *prefix, const int n_clients)
     return status;
 }
 
+static int
+uint64_compare_function(const void *a, const void *b)
+{
+    const uint64_t av = *(const uint64_t *)a;
+    const uint64_t bv = *(const uint64_t *)b;
+    if (av < bv)
+    {
+        return -1;
+    }
+    else if (av > bv)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/*
+ * Compile the subnet rule list into pf_addr_range entries.  Rule edges
+ * partition the address space into elementary ranges; each range is
+ * resolved to the first rule covering it, so overlapping rules keep
+ * their first-match-wins order, and adjacent ranges resolving to the
+ * same rule are merged.  With n rules this yields at most 2n ranges.
+ */
+static void
+gen_ranges(struct pf_subnet_set *sns)
+{
+    const struct pf_subnet *e;
+    uint64_t *bounds;
+    int n = 0;
+    int n_bounds = 0;
+    int i;
+
+    for (e = sns->list; e != NULL; e = e->next)
+    {
+        ++n;
+    }
+    if (!n)
+    {
+        return;
+    }
+
+    /* collect and sort the edges of all rules */
+    ALLOC_ARRAY(bounds, uint64_t, 2 * n);
+    for (e = sns->list; e != NULL; e = e->next)
+    {
+        bounds[n_bounds++] = e->rule.network;
+        bounds[n_bounds++] = (uint64_t)(e->rule.network | ~e->rule.netmask) + 1;
+    }
+    qsort(bounds, n_bounds, sizeof(*bounds), uint64_compare_function);
+
+    ALLOC_ARRAY_CLEAR(sns->ranges, struct pf_addr_range, 2 * n);
+    for (i = 0; i < n_bounds - 1; ++i)
+    {
+        const in_addr_t start = (in_addr_t)bounds[i];
+        if (bounds[i] == bounds[i + 1])
+        {
+            continue; /* duplicate edge */
+        }
+        for (e = sns->list; e != NULL; e = e->next)
+        {
+            if ((start & e->rule.netmask) == e->rule.network)
+            {
+                struct pf_addr_range *r = &sns->ranges[sns->n_ranges];
+                if (sns->n_ranges > 0 && (r - 1)->rule == &e->rule
+                    && (uint64_t)(r - 1)->end + 1 == bounds[i])
+                {
+                    (r - 1)->end = (in_addr_t)(bounds[i + 1] - 1);
+                }
+                else
+                {
+                    r->start = start;
+                    r->end = (in_addr_t)(bounds[i + 1] - 1);
+                    r->rule = &e->rule;
+                    ++sns->n_ranges;
+                }
+                break;
+            }
+        }
+    }
+    free(bounds);
+}
+
 static struct pf_set *
 pf_init(const struct buffer_list *bl, const char *prefix, const bool allow_kill)
 {
@@ -306,6 +389,7 @@ done:
             {
                 ++n_errors;
             }
+            gen_ranges(&pfs->sns);
         }
         if (n_errors)
         {
@@ -503,20 +587,33 @@ pf_addr_test_dowork(const struct context *src, const struct mroute_addr *dest, c
     if (pfs && !pfs->kill)
     {
         const in_addr_t addr = in_addr_t_from_mroute_addr(dest);
-        const struct pf_subnet *se = pfs->sns.list;
-        while (se)
+        const struct pf_addr_range *ranges = pfs->sns.ranges;
+        int lo = 0;
+        int hi = pfs->sns.n_ranges - 1;
+
+        /* binary search over the compiled, disjoint address ranges */
+        while (lo <= hi)
         {
-            if ((addr & se->rule.netmask) == se->rule.network)
+            const int mid = (lo + hi) / 2;
+            if (addr < ranges[mid].start)
+            {
+                hi = mid - 1;
+            }
+            else if (addr > ranges[mid].end)
+            {
+                lo = mid + 1;
+            }
+            else
             {
 #ifdef ENABLE_DEBUG
                 if (check_debug_level(D_PF_DEBUG))
                 {
-                    pf_addr_test_print("PF_ADDR_MATCH", prefix, src, dest, !se->rule.exclude, &se->rule);
+                    pf_addr_test_print("PF_ADDR_MATCH", prefix, src, dest,
+                                       !ranges[mid].rule->exclude, ranges[mid].rule);
                 }
 #endif
-                return !se->rule.exclude;
+                return !ranges[mid].rule->exclude;
             }
-            se = se->next;
         }
 #ifdef ENABLE_DEBUG
         if (check_debug_level(D_PF_DEBUG))
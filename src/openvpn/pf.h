@@ -47,9 +47,24 @@ struct pf_subnet {
     struct ipv4_subnet rule;
 };
 
+/*
+ * Compiled form of a subnet ruleset: disjoint address ranges sorted by
+ * start address, so the per-packet test is a binary search instead of
+ * a walk over the rule list.  'rule' points at the first list entry
+ * matching the range, preserving first-match-wins semantics of the
+ * original rule order.
+ */
+struct pf_addr_range {
+    in_addr_t start;                /* host byte order, inclusive */
+    in_addr_t end;                  /* host byte order, inclusive */
+    const struct ipv4_subnet *rule; /* first rule covering this range */
+};
+
 struct pf_subnet_set {
     bool default_allow;
     struct pf_subnet *list;
+    struct pf_addr_range *ranges;   /* compiled from list at ruleset load */
+    int n_ranges;
 };
 
 struct pf_cn {
@@ -60,6 +60,32 @@ trigger_ping_timeout_signal(struct context *c)
             break;
 
         case PING_RESTART:
+            /*
+             * Before tearing the session down, try to move the link to
+             * the standby local address.  The session state and data
+             * channel keys survive the switch; the peer sees a floating
+             * address.  Only one such migration is attempted per
+             * session -- if the standby path is dead too, the next
+             * expiry falls through to the normal restart.
+             */
+            if (c->options.link_standby_local
+                && c->options.mode == MODE_POINT_TO_POINT
+                && c->c2.n_link_failovers < 1
+                && c->c2.link_socket
+                && link_socket_standby_failover(c->c2.link_socket,
+                                                c->options.link_standby_local))
+            {
+                ++c->c2.n_link_failovers;
+                c->c2.link_set_rwflags = EVENT_UNDEF; /* force event loop re-registration */
+                msg(M_INFO, "%sInactivity timeout (--ping-restart), failing over to standby local address %s",
+                    format_common_name(c, &gc), c->options.link_standby_local);
+                /* elicit an immediate reply so the peer learns the new address */
+                if (c->c2.to_link.len == 0)
+                {
+                    check_ping_send_dowork(c);
+                }
+                break;
+            }
             msg(M_INFO, "%sInactivity timeout (--ping-restart), restarting",
                 format_common_name(c, &gc));
             c->sig->signal_received = SIGUSR1; /* SOFT-SIGUSR1 -- Ping Restart */
@@ -74,6 +100,17 @@ trigger_ping_timeout_signal(struct context *c)
 
 /*
  * Should we ping the remote?
+ *
+ * Note on keepalive cost: a pre-encrypted ping template is not
+ * possible.  AEAD modes require a fresh IV for every packet, and a new
+ * IV changes every byte of the ciphertext and tag, not just the
+ * packet-id bytes.  The encrypt path a ping takes is already free of
+ * avoidable per-packet work, though: the payload is encrypted in place
+ * in this buffer (no work-buffer carry), compression is skipped below
+ * COMPRESS_THRESHOLD, and data channel key selection breaks out at the
+ * first usable key.  What remains here is staging the 16 plaintext
+ * bytes, which the in-place encrypt consumes and which must therefore
+ * be rewritten before each send.
  */
 void
 check_ping_send_dowork(struct context *c)
@@ -355,6 +355,8 @@ cleanup:
     return rv == CKR_OK;
 }
 
+static void pkcs11_free_cached_id_list(void);
+
 void
 pkcs11_terminate(void)
 {
@@ -363,6 +365,8 @@ pkcs11_terminate(void)
         "PKCS#11: pkcs11_terminate - entered"
         );
 
+    pkcs11_free_cached_id_list();
+
     pkcs11h_terminate();
 
     dmsg(
@@ -427,6 +431,105 @@ pkcs11_logout(void)
     return pkcs11h_logout() == CKR_OK;
 }
 
+/*
+ * Cached certificate enumeration.
+ *
+ * The management interface queries certificates one index at a time and
+ * every query used to re-run the full C_GetSlotList/C_FindObjects walk;
+ * on slow tokens and network HSMs that is seconds per certificate.  The
+ * enumeration result is kept here and reused until it goes stale or the
+ * next count query forces a refresh.
+ */
+#define PKCS11_ID_LIST_CACHE_TTL 60 /* seconds */
+
+static pkcs11h_certificate_id_list_t s_cached_id_list = NULL;
+static time_t s_cached_id_list_time = 0;
+
+static void
+pkcs11_free_cached_id_list(void)
+{
+    pkcs11h_certificate_freeCertificateIdList(s_cached_id_list);
+    s_cached_id_list = NULL;
+    s_cached_id_list_time = 0;
+}
+
+static CK_RV
+pkcs11_get_cached_id_list(
+    const bool refresh,
+    pkcs11h_certificate_id_list_t *id_list
+    )
+{
+    CK_RV rv = CKR_OK;
+    const time_t local_now = openvpn_time(NULL);
+
+    if (
+        refresh
+        || s_cached_id_list == NULL
+        || local_now >= s_cached_id_list_time + PKCS11_ID_LIST_CACHE_TTL
+        )
+    {
+        pkcs11_free_cached_id_list();
+
+        if (
+            (rv = pkcs11h_certificate_enumCertificateIds(
+                 PKCS11H_ENUM_METHOD_CACHE_EXIST,
+                 NULL,
+                 PKCS11H_PROMPT_MASK_ALLOW_ALL,
+                 NULL,
+                 &s_cached_id_list
+                 )) != CKR_OK
+            )
+        {
+            return rv;
+        }
+        s_cached_id_list_time = local_now;
+    }
+
+    *id_list = s_cached_id_list;
+    return rv;
+}
+
+void
+pkcs11_warmup(void)
+{
+    pkcs11h_certificate_id_list_t id_list = NULL;
+    CK_RV rv = CKR_OK;
+
+    dmsg(
+        D_PKCS11_DEBUG,
+        "PKCS#11: pkcs11_warmup - entered"
+        );
+
+    /*
+     * Prime the pkcs11-helper token/session caches and our own
+     * enumeration cache so the first TLS handshake does not pay for
+     * the initial slot walk.  Prompt mask is empty -- startup must
+     * never block on a PIN or token prompt, so a token that needs
+     * interaction is simply skipped here.
+     */
+    if (
+        (rv = pkcs11h_certificate_enumCertificateIds(
+             PKCS11H_ENUM_METHOD_CACHE_EXIST,
+             NULL,
+             0,
+             NULL,
+             &id_list
+             )) == CKR_OK
+        )
+    {
+        pkcs11_free_cached_id_list();
+        s_cached_id_list = id_list;
+        s_cached_id_list_time = openvpn_time(NULL);
+    }
+
+    dmsg(
+        D_PKCS11_DEBUG,
+        "PKCS#11: pkcs11_warmup - return rv=%ld-'%s'",
+        rv,
+        pkcs11h_getMessage(rv)
+        );
+}
+
 int
 pkcs11_management_id_count(void)
 {
@@ -440,12 +543,11 @@ pkcs11_management_id_count(void)
         "PKCS#11: pkcs11_management_id_count - entered"
         );
 
+    /* a count query begins a new management enumeration sequence, so
+     * force a refresh; the id-get queries that follow reuse the cache */
     if (
-        (rv = pkcs11h_certificate_enumCertificateIds(
-             PKCS11H_ENUM_METHOD_CACHE_EXIST,
-             NULL,
-             PKCS11H_PROMPT_MASK_ALLOW_ALL,
-             NULL,
+        (rv = pkcs11_get_cached_id_list(
+             true,
              &id_list
              )) != CKR_OK
         )
@@ -461,9 +563,6 @@ pkcs11_management_id_count(void)
 
 cleanup:
 
-    pkcs11h_certificate_freeCertificateIdList(id_list);
-    id_list = NULL;
-
     dmsg(
         D_PKCS11_DEBUG,
         "PKCS#11: pkcs11_management_id_count - return count=%d",
@@ -508,11 +607,8 @@ pkcs11_management_id_get(
     *base64 = NULL;
 
     if (
-        (rv = pkcs11h_certificate_enumCertificateIds(
-             PKCS11H_ENUM_METHOD_CACHE_EXIST,
-             NULL,
-             PKCS11H_PROMPT_MASK_ALLOW_ALL,
-             NULL,
+        (rv = pkcs11_get_cached_id_list(
+             false,
              &id_list
              )) != CKR_OK
         )
@@ -627,9 +723,6 @@ pkcs11_management_id_get(
 
 cleanup:
 
-    pkcs11h_certificate_freeCertificateIdList(id_list);
-    id_list = NULL;
-
     free(internal_id);
     internal_id = NULL;
 
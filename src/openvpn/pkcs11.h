@@ -48,6 +48,9 @@ pkcs11_addProvider(
 int
 pkcs11_logout();
 
+void
+pkcs11_warmup(void);
+
 int
 pkcs11_management_id_count();
 
@@ -117,6 +117,8 @@ unsigned int platform_getpid(void);
 
 void platform_mlockall(bool print_msg);  /* Disable paging */
 
+void platform_set_numa_node(int node);   /* Prefer a NUMA node for allocation */
+
 int platform_chdir(const char *dir);
 
 /* interpret the status code returned by execve() */
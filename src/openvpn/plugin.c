@@ -302,6 +302,7 @@ plugin_init_item(struct plugin *p, const struct plugin_option *o)
     PLUGIN_SYM(client_destructor, "openvpn_plugin_client_destructor_v1", 0);
     PLUGIN_SYM(min_version_required, "openvpn_plugin_min_version_required_v1", 0);
     PLUGIN_SYM(initialization_point, "openvpn_plugin_select_initialization_point_v1", 0);
+    PLUGIN_SYM(data_v1, "openvpn_plugin_data_v1", 0);
 
     if (!p->open1 && !p->open2 && !p->open3)
     {
@@ -704,6 +705,10 @@ plugin_common_init(const struct plugin_option_list *list)
     {
         plugin_init_item(&pc->plugins[i],
                          &list->plugins[i]);
+        if (pc->plugins[i].data_v1)
+        {
+            pc->data_hooks = true;
+        }
         pc->n = i + 1;
     }
 
@@ -923,6 +928,25 @@ plugin_defined(const struct plugin_list *pl, const int type)
     return ret;
 }
 
+void
+plugin_data_call(const struct plugin_list *pl, const int hook,
+                 const uint8_t *data, int len)
+{
+    const struct plugin_common *pc = pl->common;
+    const struct openvpn_plugin_data_pkt pkt = { data, len };
+    struct openvpn_plugin_args_data_in args = { hook, 1, &pkt, NULL };
+
+    for (int i = 0; i < pc->n; ++i)
+    {
+        const struct plugin *p = &pc->plugins[i];
+        if (p->plugin_handle && p->data_v1)
+        {
+            args.per_client_context = pl->per_client.per_client_context[i];
+            (*p->data_v1)(p->plugin_handle, &args);
+        }
+    }
+}
+
 /*
  * Plugin return functions
  */
@@ -74,6 +74,7 @@ struct plugin {
     openvpn_plugin_abort_v1 abort;
     openvpn_plugin_client_constructor_v1 client_constructor;
     openvpn_plugin_client_destructor_v1 client_destructor;
+    openvpn_plugin_data_v1 data_v1;
     openvpn_plugin_min_version_required_v1 min_version_required;
     openvpn_plugin_select_initialization_point_v1 initialization_point;
 
@@ -88,6 +89,8 @@ struct plugin_per_client
 struct plugin_common
 {
     int n;
+    bool data_hooks;            /**< at least one plugin exports
+                                 *   openvpn_plugin_data_v1 */
     struct plugin plugins[MAX_PLUGINS];
 };
 
@@ -137,6 +140,21 @@ void plugin_list_close(struct plugin_list *pl);
 
 bool plugin_defined(const struct plugin_list *pl, const int type);
 
+/**
+ * Invoke the data plane hooks of all plugins that export
+ * openvpn_plugin_data_v1, passing the packet by reference.  Callers
+ * should guard with plugin_data_defined().
+ */
+void plugin_data_call(const struct plugin_list *pl, const int hook,
+                      const uint8_t *data, int len);
+
+/** Fast per-packet check whether any data plane hooks are registered */
+static inline bool
+plugin_data_defined(const struct plugin_list *pl)
+{
+    return pl && pl->common && pl->common->data_hooks;
+}
+
 void plugin_return_get_column(const struct plugin_return *src,
                               struct plugin_return *dest,
                               const char *colname);
@@ -183,6 +201,18 @@ plugin_defined(const struct plugin_list *pl, const int type)
     return false;
 }
 
+static inline bool
+plugin_data_defined(const struct plugin_list *pl)
+{
+    return false;
+}
+
+static inline void
+plugin_data_call(const struct plugin_list *pl, const int hook,
+                 const uint8_t *data, int len)
+{
+}
+
 static inline int
 plugin_call_ssl(const struct plugin_list *pl,
                 const int type,
@@ -32,6 +32,7 @@
 #include "pool.h"
 #include "buffer.h"
 #include "error.h"
+#include "intern.h"
 #include "socket.h"
 #include "otime.h"
 
@@ -39,83 +40,154 @@
 
 #if P2MP
 
+static uint32_t
+cn_hash_function(const void *key, uint32_t iv)
+{
+    return hash_func((uint8_t *)key, strlen((char *)key) + 1, iv);
+}
+
+static bool
+cn_compare_function(const void *key1, const void *key2)
+{
+    return !strcmp((const char *)key1, (const char *)key2);
+}
+
+/*
+ * Maintenance of the allocatable slot list (see struct ifconfig_pool).
+ */
+
+static bool
+ifconfig_pool_slot_linked(const struct ifconfig_pool *pool, const int i)
+{
+    return pool->list[i].free_prev >= 0 || pool->free_head == i;
+}
+
 static void
-ifconfig_pool_entry_free(struct ifconfig_pool_entry *ipe, bool hard)
+ifconfig_pool_slot_unlink(struct ifconfig_pool *pool, const int i)
 {
-    ipe->in_use = false;
-    if (hard && ipe->common_name)
+    struct ifconfig_pool_entry *ipe = &pool->list[i];
+
+    if (!ifconfig_pool_slot_linked(pool, i))
     {
-        free(ipe->common_name);
-        ipe->common_name = NULL;
+        return;
     }
-    if (hard)
+    if (ipe->free_prev >= 0)
     {
-        ipe->last_release = 0;
+        pool->list[ipe->free_prev].free_next = ipe->free_next;
     }
     else
     {
-        ipe->last_release = now;
+        pool->free_head = ipe->free_next;
     }
+    if (ipe->free_next >= 0)
+    {
+        pool->list[ipe->free_next].free_prev = ipe->free_prev;
+    }
+    else
+    {
+        pool->free_tail = ipe->free_prev;
+    }
+    ipe->free_prev = ipe->free_next = -1;
 }
 
-static int
-ifconfig_pool_find(struct ifconfig_pool *pool, const char *common_name)
+static void
+ifconfig_pool_slot_link_head(struct ifconfig_pool *pool, const int i)
 {
-    int i;
-    time_t earliest_release = 0;
-    int previous_usage = -1;
-    int new_usage = -1;
+    struct ifconfig_pool_entry *ipe = &pool->list[i];
 
-    for (i = 0; i < pool->size; ++i)
+    ifconfig_pool_slot_unlink(pool, i);
+    ipe->free_next = pool->free_head;
+    if (pool->free_head >= 0)
     {
-        struct ifconfig_pool_entry *ipe = &pool->list[i];
-        if (!ipe->in_use)
-        {
-            /*
-             * If duplicate_cn mode, take first available IP address
-             */
-            if (pool->duplicate_cn)
-            {
-                new_usage = i;
-                break;
-            }
+        pool->list[pool->free_head].free_prev = i;
+    }
+    else
+    {
+        pool->free_tail = i;
+    }
+    pool->free_head = i;
+}
 
-            /*
-             * Keep track of the unused IP address entry which
-             * was released earliest.
-             */
-            if ((new_usage == -1 || ipe->last_release < earliest_release) && !ipe->fixed)
-            {
-                earliest_release = ipe->last_release;
-                new_usage = i;
-            }
+static void
+ifconfig_pool_slot_link_tail(struct ifconfig_pool *pool, const int i)
+{
+    struct ifconfig_pool_entry *ipe = &pool->list[i];
 
-            /*
-             * Keep track of a possible allocation to us
-             * from an earlier session.
-             */
-            if (previous_usage < 0
-                && common_name
-                && ipe->common_name
-                && !strcmp(common_name, ipe->common_name))
-            {
-                previous_usage = i;
-            }
+    ifconfig_pool_slot_unlink(pool, i);
+    ipe->free_prev = pool->free_tail;
+    if (pool->free_tail >= 0)
+    {
+        pool->list[pool->free_tail].free_next = i;
+    }
+    else
+    {
+        pool->free_head = i;
+    }
+    pool->free_tail = i;
+}
 
+static void
+ifconfig_pool_entry_free(struct ifconfig_pool *pool,
+                         struct ifconfig_pool_entry *ipe, bool hard)
+{
+    ipe->in_use = false;
+    if (hard && ipe->common_name)
+    {
+        if (hash_lookup(pool->cn_hash, ipe->common_name) == ipe)
+        {
+            hash_remove(pool->cn_hash, ipe->common_name);
         }
+        string_intern_release(ipe->common_name);
+        ipe->common_name = NULL;
     }
-
-    if (previous_usage >= 0)
+    if (hard)
+    {
+        ipe->last_release = 0;
+    }
+    else
     {
-        return previous_usage;
+        ipe->last_release = now;
     }
+    if (!ipe->fixed)
+    {
+        /* hard-freed slots are reusable immediately, released ones only
+         * after every slot freed earlier has been handed out again */
+        if (hard)
+        {
+            ifconfig_pool_slot_link_head(pool, (int) (ipe - pool->list));
+        }
+        else
+        {
+            ifconfig_pool_slot_link_tail(pool, (int) (ipe - pool->list));
+        }
+    }
+}
 
-    if (new_usage >= 0)
+static int
+ifconfig_pool_find(struct ifconfig_pool *pool, const char *common_name)
+{
+    /*
+     * Check for an allocation to us from an earlier session via the
+     * common name hash, so that a reconnect does not need to scan
+     * the pool.
+     */
+    if (common_name && !pool->duplicate_cn)
     {
-        return new_usage;
+        const struct ifconfig_pool_entry *ipe =
+            (struct ifconfig_pool_entry *) hash_lookup(pool->cn_hash,
+                                                       common_name);
+        if (ipe && !ipe->in_use)
+        {
+            return (int) (ipe - pool->list);
+        }
     }
 
-    return -1;
+    /*
+     * Otherwise hand out the head of the allocatable slot list, which
+     * is the slot with the earliest release time (-1 if the pool is
+     * exhausted).
+     */
+    return pool->free_head;
 }
 
 /*
@@ -285,6 +357,16 @@ ifconfig_pool_init(const bool ipv4_pool, enum pool_type type, in_addr_t start,
     ASSERT(pool->size > 0);
 
     ALLOC_ARRAY_CLEAR(pool->list, struct ifconfig_pool_entry, pool->size);
+    pool->cn_hash = hash_init(pool->size < 16 ? 16 : pool->size, 0,
+                              cn_hash_function, cn_compare_function);
+
+    /* initially every slot is allocatable, in index order */
+    pool->free_head = pool->free_tail = -1;
+    for (int i = 0; i < pool->size; ++i)
+    {
+        pool->list[i].free_prev = pool->list[i].free_next = -1;
+        ifconfig_pool_slot_link_tail(pool, i);
+    }
 
     gc_free(&gc);
     return pool;
@@ -299,8 +381,9 @@ ifconfig_pool_free(struct ifconfig_pool *pool)
 
         for (i = 0; i < pool->size; ++i)
         {
-            ifconfig_pool_entry_free(&pool->list[i], true);
+            ifconfig_pool_entry_free(pool, &pool->list[i], true);
         }
+        hash_free(pool->cn_hash);
         free(pool->list);
         free(pool);
     }
@@ -316,11 +399,13 @@ ifconfig_pool_acquire(struct ifconfig_pool *pool, in_addr_t *local, in_addr_t *r
     {
         struct ifconfig_pool_entry *ipe = &pool->list[i];
         ASSERT(!ipe->in_use);
-        ifconfig_pool_entry_free(ipe, true);
+        ifconfig_pool_entry_free(pool, ipe, true);
         ipe->in_use = true;
+        ifconfig_pool_slot_unlink(pool, i);
         if (common_name)
         {
-            ipe->common_name = string_alloc(common_name, NULL);
+            ipe->common_name = string_intern(common_name);
+            hash_add(pool->cn_hash, ipe->common_name, ipe, true);
         }
 
         if (pool->ipv4.enabled && local && remote)
@@ -364,7 +449,7 @@ ifconfig_pool_release(struct ifconfig_pool *pool, ifconfig_pool_handle hand, con
 
     if (pool && hand >= 0 && hand < pool->size)
     {
-        ifconfig_pool_entry_free(&pool->list[hand], hard);
+        ifconfig_pool_entry_free(pool, &pool->list[hand], hard);
         ret = true;
     }
     return ret;
@@ -493,11 +578,34 @@ ifconfig_pool_set(struct ifconfig_pool *pool, const char *cn,
                   ifconfig_pool_handle h, const bool fixed)
 {
     struct ifconfig_pool_entry *e = &pool->list[h];
-    ifconfig_pool_entry_free(e, true);
+    struct ifconfig_pool_entry *old;
+
+    ifconfig_pool_entry_free(pool, e, true);
+
+    /*
+     * A journaled persist file may contain several lines for the same
+     * common name; the last one wins, so drop any earlier assignment.
+     */
+    old = (struct ifconfig_pool_entry *) hash_lookup(pool->cn_hash, cn);
+    if (old)
+    {
+        old->fixed = false;
+        ifconfig_pool_entry_free(pool, old, true);
+    }
+
     e->in_use = false;
-    e->common_name = string_alloc(cn, NULL);
+    e->common_name = string_intern(cn);
     e->last_release = now;
     e->fixed = fixed;
+    if (fixed)
+    {
+        ifconfig_pool_slot_unlink(pool, h);
+    }
+    else
+    {
+        ifconfig_pool_slot_link_tail(pool, h);
+    }
+    hash_add(pool->cn_hash, e->common_name, e, false);
 }
 
 static void
@@ -585,10 +693,18 @@ ifconfig_pool_persist_close(struct ifconfig_pool_persist *persist)
     }
 }
 
+/*
+ * Acquired addresses are journaled to the persist file as they are
+ * handed out (see ifconfig_pool_journal below), so the periodic full
+ * rewrite is only needed to compact the journal once enough lines
+ * have accumulated.
+ */
+#define IFCONFIG_POOL_COMPACT 64
+
 bool
 ifconfig_pool_write_trigger(struct ifconfig_pool_persist *persist)
 {
-    if (persist->file)
+    if (persist->file && persist->n_appended >= IFCONFIG_POOL_COMPACT)
     {
         return status_trigger(persist->file);
     }
@@ -635,7 +751,7 @@ ifconfig_pool_read(struct ifconfig_pool_persist *persist, struct ifconfig_pool *
                 continue;
             }
 
-            msg(M_INFO, "ifconfig_pool_read(), in='%s'", BSTR(&in));
+            msg(D_IFCONFIG_POOL, "ifconfig_pool_read(), in='%s'", BSTR(&in));
 
             /* The expected format of a line is: "CN,IP4,IP6".
              *
@@ -724,7 +840,7 @@ ifconfig_pool_read(struct ifconfig_pool_persist *persist, struct ifconfig_pool *
              */
             if (h >= 0)
             {
-                msg(M_INFO, "succeeded -> ifconfig_pool_set(hand=%d)",h);
+                msg(D_IFCONFIG_POOL, "succeeded -> ifconfig_pool_set(hand=%d)",h);
                 ifconfig_pool_set(pool, cn_buf, h, persist->fixed);
             }
         }
@@ -743,6 +859,47 @@ ifconfig_pool_write(struct ifconfig_pool_persist *persist, const struct ifconfig
         status_reset(persist->file);
         ifconfig_pool_list(pool, persist->file);
         status_flush(persist->file);
+        persist->n_appended = 0;
+    }
+}
+
+/*
+ * Append a single "CN,IP4,IP6" line for a newly acquired handle to the
+ * persist file, instead of rewriting the whole file.  On read, a later
+ * line for the same common name supersedes earlier ones.
+ */
+void
+ifconfig_pool_journal(struct ifconfig_pool_persist *persist,
+                      const struct ifconfig_pool *pool,
+                      ifconfig_pool_handle hand)
+{
+    if (persist && persist->file
+        && (status_rw_flags(persist->file) & STATUS_OUTPUT_WRITE)
+        && pool && hand >= 0 && hand < pool->size)
+    {
+        const struct ifconfig_pool_entry *e = &pool->list[hand];
+
+        if (e->common_name)
+        {
+            struct gc_arena gc = gc_new();
+            const char *ip_str = "";
+            const char *ip6_str = "";
+
+            if (pool->ipv4.enabled)
+            {
+                ip_str = print_in_addr_t(ifconfig_pool_handle_to_ip_base(pool, hand), 0, &gc);
+            }
+            if (pool->ipv6.enabled)
+            {
+                ip6_str = print_in6_addr(ifconfig_pool_handle_to_ipv6_base(pool, hand), 0, &gc);
+            }
+
+            status_seek_end(persist->file);
+            status_printf(persist->file, "%s,%s,%s", e->common_name, ip_str, ip6_str);
+            ++persist->n_appended;
+
+            gc_free(&gc);
+        }
     }
 }
 
@@ -29,6 +29,7 @@
 /*#define IFCONFIG_POOL_TEST*/
 
 #include "basic.h"
+#include "list.h"
 #include "status.h"
 
 #define IFCONFIG_POOL_MAX         65536
@@ -46,6 +47,8 @@ struct ifconfig_pool_entry
     char *common_name;
     time_t last_release;
     bool fixed;
+    int free_prev;              /* links of the allocatable slot list, -1 = none */
+    int free_next;
 };
 
 struct ifconfig_pool
@@ -62,12 +65,22 @@ struct ifconfig_pool
     } ipv6;
     int size;
     struct ifconfig_pool_entry *list;
+    struct hash *cn_hash;       /* common name -> most recent pool entry */
+
+    /*
+     * Doubly-linked list of allocatable (not in use, not fixed) slots,
+     * ordered by release time: the head is the slot released earliest,
+     * so acquisition is O(1) instead of a scan over the pool.
+     */
+    int free_head;
+    int free_tail;
 };
 
 struct ifconfig_pool_persist
 {
     struct status_output *file;
     bool fixed;
+    int n_appended;             /* journal lines appended since last rewrite */
 };
 
 typedef int ifconfig_pool_handle;
@@ -97,6 +110,8 @@ void ifconfig_pool_read(struct ifconfig_pool_persist *persist, struct ifconfig_p
 
 void ifconfig_pool_write(struct ifconfig_pool_persist *persist, const struct ifconfig_pool *pool);
 
+void ifconfig_pool_journal(struct ifconfig_pool_persist *persist, const struct ifconfig_pool *pool, ifconfig_pool_handle hand);
+
 #ifdef IFCONFIG_POOL_TEST
 void ifconfig_pool_test(in_addr_t start, in_addr_t end);
 
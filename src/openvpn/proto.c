@@ -120,6 +120,70 @@ is_ipv6(int tunnel_type, struct buffer *buf)
     return is_ipv_X( tunnel_type, buf, 6 );
 }
 
+/*
+ * Return the DSCP value of a raw tunnel packet, or 0 if the
+ * packet is not IP.
+ */
+uint8_t
+ip_packet_dscp(const struct buffer *buf, int tunnel_type)
+{
+    struct buffer ipbuf = *buf;
+
+    if (is_ipv4(tunnel_type, &ipbuf))
+    {
+        const struct openvpn_iphdr *pip
+            = (const struct openvpn_iphdr *) BPTR(&ipbuf);
+        return OPENVPN_IP_DSCP(pip->tos);
+    }
+    else if (is_ipv6(tunnel_type, &ipbuf))
+    {
+        const struct openvpn_ipv6hdr *pip6
+            = (const struct openvpn_ipv6hdr *) BPTR(&ipbuf);
+        return OPENVPN_IP_DSCP(((pip6->version_prio & 0x0F) << 4)
+                               | (pip6->flow_lbl[0] >> 4));
+    }
+    return 0;
+}
+
+/*
+ * If a raw tunnel packet is IP and its sender declared it ECN-capable
+ * (ECT(0) or ECT(1) set), mark it "congestion experienced" as a
+ * backpressure signal instead of dropping it later.  Packets from
+ * non-ECN flows are left alone.  Returns true if the packet was marked.
+ */
+bool
+ip_packet_ecn_mark_ce(struct buffer *buf, int tunnel_type)
+{
+    struct buffer ipbuf = *buf;
+
+    if (is_ipv4(tunnel_type, &ipbuf))
+    {
+        struct openvpn_iphdr *pip = (struct openvpn_iphdr *) BPTR(&ipbuf);
+        const uint8_t ecn = pip->tos & OPENVPN_IP_ECN_MASK;
+        if (ecn && ecn != OPENVPN_IP_ECN_CE)
+        {
+            /* the TOS byte shares a 16-bit checksum word with version/len */
+            uint16_t *word = (uint16_t *) BPTR(&ipbuf);
+            int accumulate = *word;
+            pip->tos |= OPENVPN_IP_ECN_CE;
+            accumulate -= *word;
+            ADJUST_CHECKSUM(accumulate, pip->check);
+            return true;
+        }
+    }
+    else if (is_ipv6(tunnel_type, &ipbuf))
+    {
+        struct openvpn_ipv6hdr *pip6 = (struct openvpn_ipv6hdr *) BPTR(&ipbuf);
+        const uint8_t ecn = (pip6->flow_lbl[0] >> 4) & OPENVPN_IP_ECN_MASK;
+        if (ecn && ecn != OPENVPN_IP_ECN_CE)
+        {
+            pip6->flow_lbl[0] |= (OPENVPN_IP_ECN_CE << 4);
+            return true;
+        }
+    }
+    return false;
+}
+
 
 uint16_t
 ip_checksum(const sa_family_t af, const uint8_t *payload, const int len_payload,
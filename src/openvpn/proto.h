@@ -306,6 +306,24 @@ bool is_ipv4(int tunnel_type, struct buffer *buf);
 
 bool is_ipv6(int tunnel_type, struct buffer *buf);
 
+/*
+ * DiffServ / ECN fields of the IPv4 TOS byte and the IPv6 traffic class
+ * (RFC 2474, RFC 3168).
+ */
+#define OPENVPN_IP_ECN_MASK 0x03
+#define OPENVPN_IP_ECN_CE   0x03    /* congestion experienced */
+#define OPENVPN_IP_DSCP(tos) (((tos) >> 2) & 0x3F)
+
+/*
+ * Treat IP precedence >= 4 (CS4 and up: AF4x, EF, network control) as
+ * interactive when deciding which packets to drop under congestion.
+ */
+#define OPENVPN_DSCP_INTERACTIVE(dscp) (((dscp) >> 3) >= 4)
+
+uint8_t ip_packet_dscp(const struct buffer *buf, int tunnel_type);
+
+bool ip_packet_ecn_mark_ce(struct buffer *buf, int tunnel_type);
+
 /**
  *  Calculates an IP or IPv6 checksum with a pseudo header as required by
  *  TCP, UDP and ICMPv6
@@ -83,14 +83,13 @@ recv_line(socket_descriptor_t sd,
     {
         int status;
         ssize_t size;
+        ssize_t take;
+        ssize_t i;
         fd_set reads;
         struct timeval tv;
+        uint8_t chunk[256];
         uint8_t c;
-
-        if (buf_defined(&la))
-        {
-            ASSERT(buf_init(&la, 0));
-        }
+        bool eol = false;
 
         FD_ZERO(&reads);
         openvpn_fd_set(sd, &reads);
@@ -125,11 +124,15 @@ recv_line(socket_descriptor_t sd,
             goto error;
         }
 
-        /* read single char */
-        size = recv(sd, &c, 1, MSG_NOSIGNAL);
+        /*
+         * Peek at a chunk and consume only up to the first newline
+         * (or offending non-ASCII byte), so we read whole lines per
+         * recv() pair without ever reading past the end of the line.
+         */
+        size = recv(sd, chunk, sizeof(chunk), MSG_NOSIGNAL | MSG_PEEK);
 
         /* error? */
-        if (size != 1)
+        if (size <= 0)
         {
             if (verbose)
             {
@@ -138,46 +141,70 @@ recv_line(socket_descriptor_t sd,
             goto error;
         }
 
-#if 0
-        if (isprint(c))
+        take = 0;
+        while (take < size)
         {
-            msg(M_INFO, "PROXY: read '%c' (%d)", c, (int)c);
-        }
-        else
-        {
-            msg(M_INFO, "PROXY: read (%d)", (int)c);
+            c = chunk[take++];
+            if (c == '\n')
+            {
+                break;
+            }
+            if (buf_defined(&la) && !isprint(c) && !isspace(c))
+            {
+                break;
+            }
         }
-#endif
 
-        /* store char in buffer */
-        if (len > 1)
+        size = recv(sd, chunk, take, MSG_NOSIGNAL);
+        if (size != take)
         {
-            *buf++ = c;
-            --len;
+            if (verbose)
+            {
+                msg(D_LINK_ERRORS | M_ERRNO, "recv_line: TCP port read failed on recv()");
+            }
+            goto error;
         }
 
-        /* also store char in lookahead buffer */
-        if (buf_defined(&la))
+        for (i = 0; i < size; ++i)
         {
-            buf_write_u8(&la, c);
-            if (!isprint(c) && !isspace(c)) /* not ascii? */
+            c = chunk[i];
+
+            /* store char in buffer */
+            if (len > 1)
+            {
+                *buf++ = c;
+                --len;
+            }
+
+            /* also store char in lookahead buffer */
+            if (buf_defined(&la))
             {
-                if (verbose)
+                ASSERT(buf_init(&la, 0));
+                buf_write_u8(&la, c);
+                if (!isprint(c) && !isspace(c)) /* not ascii? */
                 {
-                    msg(D_LINK_ERRORS | M_ERRNO, "recv_line: Non-ASCII character (%d) read on recv()", (int)c);
+                    if (verbose)
+                    {
+                        msg(D_LINK_ERRORS | M_ERRNO, "recv_line: Non-ASCII character (%d) read on recv()", (int)c);
+                    }
+                    *lookahead = la;
+                    return false;
                 }
-                *lookahead = la;
-                return false;
             }
-        }
 
-        /* end of line? */
-        if (lastc == '\r' && c == '\n')
+            /* end of line? */
+            if (lastc == '\r' && c == '\n')
+            {
+                eol = true;
+                break;
+            }
+
+            lastc = c;
+        }
+        if (eol)
         {
             break;
         }
-
-        lastc = c;
     }
 
     /* append trailing null */
@@ -71,6 +71,24 @@ struct http_proxy_info {
     struct user_pass up;
     char *proxy_authenticate;
     bool queried_creds;
+
+#if NTLM
+    /*
+     * Cached NTLM material that depends only on the configured
+     * credentials (ntlm.c): the padded MD4 password hash, the derived
+     * NTLMv2 key, the NTLMv1 DES round keys and the parsed user/domain
+     * split.  Computed on the first handshake and reused across the
+     * re-auth retry loop; ntlm_cache_id is a keyed hash of the
+     * credentials so re-queried credentials invalidate the cache.
+     */
+    uint8_t ntlm_md4_hash[21];
+    uint8_t ntlm_ntlmv2_hash[16];
+    uint8_t ntlm_des_keys[3][8];
+    char ntlm_username[128];
+    char ntlm_domain[128];
+    uint32_t ntlm_cache_id;
+    bool ntlm_cached;
+#endif
 };
 
 struct http_proxy_options *init_http_proxy_options_once(struct http_proxy_options **hpo,
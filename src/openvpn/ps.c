@@ -75,6 +75,18 @@ struct proxy_connection {
     int rwflags;
     int sd;
     char *jfn;
+
+#ifdef TARGET_LINUX
+    /*
+     * Zero-copy forwarding: once the sniffed initial data has been
+     * flushed, bytes move sd -> pipe -> counterpart sd via splice(2)
+     * and never touch userspace.  splice_len counts bytes parked in
+     * the pipe; splice_fail falls back to recv/send for good.
+     */
+    int splice_pipe[2];
+    int splice_len;
+    bool splice_fail;
+#endif
 };
 
 #if 0
@@ -280,6 +292,14 @@ proxy_entry_mark_for_close(struct proxy_connection *pc, struct event_set *es)
         struct proxy_connection *cp = pc->counterpart;
         proxy_entry_close_sd(pc, es);
         free_buf(&pc->buf);
+#ifdef TARGET_LINUX
+        if (pc->splice_pipe[0] >= 0)
+        {
+            close(pc->splice_pipe[0]);
+            close(pc->splice_pipe[1]);
+            pc->splice_pipe[0] = pc->splice_pipe[1] = -1;
+        }
+#endif
         pc->buffer_initial = false;
         pc->rwflags = 0;
         pc->defined = false;
@@ -448,6 +468,11 @@ proxy_entry_new(struct proxy_connection **list,
     ALLOC_OBJ_CLEAR(pc, struct proxy_connection);
     ALLOC_OBJ_CLEAR(cp, struct proxy_connection);
 
+#ifdef TARGET_LINUX
+    pc->splice_pipe[0] = pc->splice_pipe[1] = -1;
+    cp->splice_pipe[0] = cp->splice_pipe[1] = -1;
+#endif
+
     /* client object */
     pc->defined = true;
     pc->next = cp;
@@ -635,6 +660,86 @@ proxy_connection_io_send(struct proxy_connection *pc, int *bytes_sent)
     return IOSTAT_GOOD;
 }
 
+#ifdef TARGET_LINUX
+
+/* per-splice ceiling; the pipe holds at most 64 kB by default anyway */
+#define PROXY_SPLICE_CHUNK (64 * 1024)
+
+static bool
+proxy_splice_pipe_init(struct proxy_connection *pc)
+{
+    if (pc->splice_pipe[0] < 0)
+    {
+        if (pipe(pc->splice_pipe) != 0)
+        {
+            msg(M_WARN|M_ERRNO, "PORT SHARE PROXY: pipe() for splice failed");
+            pc->splice_fail = true;
+            return false;
+        }
+        set_nonblock(pc->splice_pipe[0]);
+        set_nonblock(pc->splice_pipe[1]);
+        set_cloexec(pc->splice_pipe[0]);
+        set_cloexec(pc->splice_pipe[1]);
+    }
+    return true;
+}
+
+/*
+ * Zero-copy variant of proxy_connection_io_xfer(): move bytes from
+ * pc->sd to pc->counterpart->sd through a pipe with splice(2).  Bytes
+ * that fit into the pipe but not yet into the destination socket stay
+ * parked in the pipe and drain on the next writable event, mirroring
+ * the partial-send handling of the buffered path.
+ */
+static int
+proxy_connection_io_xfer_splice(struct proxy_connection *pc, const int max_transfer)
+{
+    int transferred = 0;
+    while (transferred < max_transfer)
+    {
+        if (!pc->splice_len)
+        {
+            const ssize_t n = splice(pc->sd, NULL, pc->splice_pipe[1], NULL,
+                                     PROXY_SPLICE_CHUNK,
+                                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0)
+            {
+                return (errno == EAGAIN) ? IOSTAT_EAGAIN_ON_READ : IOSTAT_READ_ERROR;
+            }
+            if (!n)
+            {
+                return IOSTAT_READ_ERROR;
+            }
+            dmsg(D_PS_PROXY_DEBUG, "PORT SHARE PROXY: spliced in[%d] %d",
+                 (int)pc->sd, (int)n);
+            pc->splice_len = (int)n;
+        }
+
+        if (pc->splice_len)
+        {
+            const ssize_t n = splice(pc->splice_pipe[0], NULL,
+                                     pc->counterpart->sd, NULL,
+                                     pc->splice_len,
+                                     SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n < 0)
+            {
+                return (errno == EAGAIN) ? IOSTAT_EAGAIN_ON_WRITE : IOSTAT_WRITE_ERROR;
+            }
+            dmsg(D_PS_PROXY_DEBUG, "PORT SHARE PROXY: spliced out[%d] %d",
+                 (int)pc->counterpart->sd, (int)n);
+            pc->splice_len -= (int)n;
+            transferred += (int)n;
+            if (pc->splice_len)
+            {
+                return IOSTAT_EAGAIN_ON_WRITE;
+            }
+        }
+    }
+    return IOSTAT_EAGAIN_ON_READ;
+}
+
+#endif /* ifdef TARGET_LINUX */
+
 /*
  * Forward data from pc to pc->counterpart.
  */
@@ -643,6 +748,19 @@ static int
 proxy_connection_io_xfer(struct proxy_connection *pc, const int max_transfer)
 {
     int transferred = 0;
+
+#ifdef TARGET_LINUX
+    /*
+     * Once the sniffed initial data has been flushed, the connection
+     * is plain passthrough and the kernel can move the bytes for us.
+     */
+    if (!BLEN(&pc->buf) && !pc->buffer_initial && !pc->splice_fail
+        && proxy_splice_pipe_init(pc))
+    {
+        return proxy_connection_io_xfer_splice(pc, max_transfer);
+    }
+#endif
+
     while (transferred < max_transfer)
     {
         if (!BLEN(&pc->buf))
@@ -483,9 +483,53 @@ prepare_push_reply(struct context *c, struct gc_arena *gc,
     {
         push_option_fmt(gc, push_list, M_USAGE, "key-derivation tls-ekm");
     }
+    else if (o->data_channel_use_hkdf)
+    {
+        push_option_fmt(gc, push_list, M_USAGE, "key-derivation openvpn-hkdf");
+    }
+    if (o->data_channel_pkt_id_64)
+    {
+        push_option_fmt(gc, push_list, M_USAGE, "packet-id-64");
+    }
     return true;
 }
 
+/*
+ * Build the comma-joined serialization of the enabled entries in a push
+ * list, so that repeated PUSH_REPLY assembly is a copy rather than a
+ * per-entry format.  The string is invalidated by any later change to
+ * the list.
+ */
+void
+push_list_serialize(struct push_list *pl, struct gc_arena *gc)
+{
+    const struct push_entry *e;
+    size_t len = 0;
+    char *serial, *out;
+
+    for (e = pl->head; e; e = e->next)
+    {
+        if (e->enable)
+        {
+            len += strlen(e->option) + 1;   /* leading comma */
+        }
+    }
+    serial = out = (char *) gc_malloc(len + 1, false, gc);
+    for (e = pl->head; e; e = e->next)
+    {
+        if (e->enable)
+        {
+            const size_t l = strlen(e->option);
+            *out++ = ',';
+            memcpy(out, e->option, l);
+            out += l;
+        }
+    }
+    *out = '\0';
+    pl->serial = serial;
+    pl->serial_len = (int) len;
+}
+
 static bool
 send_push_options(struct context *c, struct buffer *buf,
                   struct push_list *push_list, int safe_cap,
@@ -493,6 +537,56 @@ send_push_options(struct context *c, struct buffer *buf,
 {
     struct push_entry *e = push_list->head;
 
+    if (push_list->serial)
+    {
+        /*
+         * Fast path: the list was serialized up front, copy it into the
+         * reply in chunks, splitting only at option boundaries (every
+         * chunk starts with a comma).
+         */
+        const char *s = push_list->serial;
+        int rem = push_list->serial_len;
+        while (rem > 0)
+        {
+            int n = rem;
+            if (BLEN(buf) + n >= safe_cap)
+            {
+                /* find the last option boundary that still fits */
+                n = safe_cap - BLEN(buf) - 1;
+                while (n > 0 && s[n] != ',')
+                {
+                    --n;
+                }
+            }
+            if (n > 0)
+            {
+                buf_write(buf, s, n);
+                buf_null_terminate(buf);
+                s += n;
+                rem -= n;
+            }
+            else if (BLEN(buf) <= (int) sizeof(push_reply_cmd) - 1)
+            {
+                msg(M_WARN, "--push option is too long");
+                return false;
+            }
+            if (rem > 0)
+            {
+                buf_printf(buf, ",push-continuation 2");
+                const bool status = send_control_channel_string(c, BSTR(buf), D_PUSH);
+                if (!status)
+                {
+                    return false;
+                }
+                *push_sent = true;
+                *multi_push = true;
+                buf_reset_len(buf);
+                buf_printf(buf, "%s", push_reply_cmd);
+            }
+        }
+        return true;
+    }
+
     e = push_list->head;
     while (e)
     {
@@ -636,6 +730,7 @@ push_option_ex(struct gc_arena *gc, struct push_list *push_list,
             push_list->head = e;
             push_list->tail = e;
         }
+        push_list->serial = NULL;
     }
 }
 
@@ -651,6 +746,8 @@ clone_push_list(struct options *o)
     if (o->push_list.head)
     {
         const struct push_entry *e = o->push_list.head;
+        const char *serial = o->push_list.serial;
+        const int serial_len = o->push_list.serial_len;
         push_reset(o);
         while (e)
         {
@@ -658,6 +755,13 @@ clone_push_list(struct options *o)
                            string_alloc(e->option, &o->gc), true, M_FATAL);
             e = e->next;
         }
+        /* cloning does not change the list content, so an existing
+         * serialization stays valid -- duplicate it into our gc */
+        if (serial)
+        {
+            o->push_list.serial = string_alloc(serial, &o->gc);
+            o->push_list.serial_len = serial_len;
+        }
     }
 }
 
@@ -724,6 +828,7 @@ push_remove_option(struct options *o, const char *p)
             {
                 msg(D_PUSH_DEBUG, "PUSH_REMOVE removing: '%s'", e->option);
                 e->enable = false;
+                o->push_list.serial = NULL;
             }
 
             e = e->next;
@@ -731,6 +836,92 @@ push_remove_option(struct options *o, const char *p)
     }
 }
 
+/*
+ * Digest the non-volatile portion of the push set, i.e. everything
+ * except per-connection options like peer-id and auth-token.  The
+ * result is pushed to capable clients as "push-digest" and echoed back
+ * opaquely on reconnect, so only this function ever computes it and
+ * the serialization merely has to be deterministic.
+ */
+static void
+push_options_digest(struct context *c, const struct push_list *per_client,
+                    struct sha256_digest *digest)
+{
+    const struct push_list *lists[2] = { &c->options.push_list, per_client };
+    md_ctx_t *ctx = md_ctx_get();
+
+    md_ctx_init(ctx, md_kt_get("SHA256"));
+    for (int i = 0; i < 2; ++i)
+    {
+        const struct push_entry *e = lists[i]->head;
+        while (e)
+        {
+            if (e->enable
+                && !strprefix(e->option, "peer-id ")
+                && !strprefix(e->option, "auth-token ")
+                && !strprefix(e->option, "push-digest "))
+            {
+                md_ctx_update(ctx, (const uint8_t *) e->option,
+                              strlen(e->option) + 1);
+            }
+            e = e->next;
+        }
+    }
+    md_ctx_final(ctx, digest->digest);
+    md_ctx_cleanup(ctx);
+    md_ctx_put(ctx);
+}
+
+/*
+ * Extract the push set digest a reconnecting client echoed in its peer
+ * info, or NULL if it did not send one.
+ */
+static const char *
+extract_push_digest_echo(const char *peer_info, struct gc_arena *gc)
+{
+    const char *optstr = peer_info ? strstr(peer_info, "IV_PUSH_DIGEST=") : NULL;
+    if (optstr)
+    {
+        char echo[2 * SHA256_DIGEST_LENGTH + 1] = { 0 };
+        if (sscanf(optstr, "IV_PUSH_DIGEST=%64s", echo) == 1
+            && strlen(echo) == 2 * SHA256_DIGEST_LENGTH)
+        {
+            return string_alloc(echo, gc);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Reply to a push request whose echoed digest matched the current push
+ * set: resend only the per-connection options the client cannot cache
+ * (peer-id, auth-token), prefixed with the push-diff marker telling the
+ * client to keep its applied option set instead of re-pulling it.
+ */
+static bool
+send_push_reply_diff(struct context *c, const struct push_list *per_client)
+{
+    struct gc_arena gc = gc_new();
+    struct buffer buf = alloc_buf_gc(PUSH_BUNDLE_SIZE, &gc);
+    const struct push_entry *e = per_client->head;
+    bool status;
+
+    buf_printf(&buf, "%s,push-diff", push_reply_cmd);
+    while (e)
+    {
+        if (e->enable
+            && (strprefix(e->option, "peer-id ")
+                || strprefix(e->option, "auth-token ")))
+        {
+            buf_printf(&buf, ",%s", e->option);
+        }
+        e = e->next;
+    }
+    status = send_control_channel_string(c, BSTR(&buf), D_PUSH);
+    gc_free(&gc);
+    return status;
+}
+
 int
 process_incoming_push_request(struct context *c)
 {
@@ -758,11 +949,40 @@ process_incoming_push_request(struct context *c)
             struct push_list push_list = { 0 };
             struct gc_arena gc = gc_new();
 
-            if (prepare_push_reply(c, &gc, &push_list)
-                && send_push_reply(c, &push_list))
+            if (prepare_push_reply(c, &gc, &push_list))
             {
-                ret = PUSH_MSG_REQUEST;
-                c->c2.sent_push_reply_expiry = now + 30;
+                bool sent = false;
+
+                if (c->options.push_digest_peer)
+                {
+                    struct sha256_digest digest;
+                    const char *echo =
+                        extract_push_digest_echo(c->c2.tls_multi->peer_info, &gc);
+
+                    push_options_digest(c, &push_list, &digest);
+                    const char *hex = format_hex_ex(digest.digest,
+                                                    sizeof(digest.digest),
+                                                    0, 0, NULL, &gc);
+                    if (echo && streq(echo, hex))
+                    {
+                        msg(D_PUSH, "PUSH: echoed digest matches, sending diff reply");
+                        sent = send_push_reply_diff(c, &push_list);
+                    }
+                    else
+                    {
+                        push_option_fmt(&gc, &push_list, M_USAGE,
+                                        "push-digest %s", hex);
+                    }
+                }
+                if (!sent)
+                {
+                    sent = send_push_reply(c, &push_list);
+                }
+                if (sent)
+                {
+                    ret = PUSH_MSG_REQUEST;
+                    c->c2.sent_push_reply_expiry = now + 30;
+                }
             }
             gc_free(&gc);
         }
@@ -806,16 +1026,26 @@ process_incoming_push_reply(struct context *c,
     if (ch == ',')
     {
         struct buffer buf_orig = (*buf);
-        if (!c->c2.pulled_options_digest_init_done)
+        const bool diff = strprefix(BSTR(buf), "push-diff");
+        if (diff && !c->options.push_digest)
+        {
+            /* we never echoed a digest, so there is nothing to diff
+             * against */
+            return PUSH_MSG_ERROR;
+        }
+        if (!diff && !c->c2.pulled_options_digest_init_done)
         {
-            c->c2.pulled_options_state = md_ctx_new();
+            c->c2.pulled_options_state = md_ctx_get();
             md_ctx_init(c->c2.pulled_options_state, md_kt_get("SHA256"));
             c->c2.pulled_options_digest_init_done = true;
         }
-        if (!c->c2.did_pre_pull_restore)
+        if (!diff && !c->c2.did_pre_pull_restore)
         {
             pre_pull_restore(&c->options, &c->c2.gc);
             c->c2.did_pre_pull_restore = true;
+            /* a fresh pull invalidates the previously echoed digest
+             * until the server sends a new one */
+            c->options.push_digest = NULL;
         }
         if (apply_push_options(&c->options,
                                buf,
@@ -823,6 +1053,14 @@ process_incoming_push_reply(struct context *c,
                                option_types_found,
                                c->c2.es))
         {
+            if (diff)
+            {
+                /* the server confirmed our cached push set: keep the
+                 * applied options and the digest they hashed to, so
+                 * do_up() will not reprogram the tun device or routes */
+                c->c2.pulled_options_digest = c->c1.pulled_options_digest_save;
+                return PUSH_MSG_REPLY;
+            }
             push_update_digest(c->c2.pulled_options_state, &buf_orig,
                                &c->options);
             switch (c->options.push_continuation)
@@ -832,7 +1070,7 @@ process_incoming_push_reply(struct context *c,
                     md_ctx_final(c->c2.pulled_options_state,
                                  c->c2.pulled_options_digest.digest);
                     md_ctx_cleanup(c->c2.pulled_options_state);
-                    md_ctx_free(c->c2.pulled_options_state);
+                    md_ctx_put(c->c2.pulled_options_state);
                     c->c2.pulled_options_state = NULL;
                     c->c2.pulled_options_digest_init_done = false;
                     ret = PUSH_MSG_REPLY;
@@ -59,6 +59,8 @@ void incoming_push_message(struct context *c, const struct buffer *buffer);
 
 void clone_push_list(struct options *o);
 
+void push_list_serialize(struct push_list *pl, struct gc_arena *gc);
+
 void push_option(struct options *o, const char *opt, int msglevel);
 
 void push_options(struct options *o, char **p, int msglevel,
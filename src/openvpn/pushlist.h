@@ -35,6 +35,15 @@ struct push_entry {
 struct push_list {
     struct push_entry *head;
     struct push_entry *tail;
+
+    /*
+     * Cached comma-joined serialization of the enabled entries
+     * (",opt1,opt2,..."), built by push_list_serialize() and set to NULL
+     * whenever the list is modified.  When present, PUSH_REPLY assembly
+     * copies it instead of formatting each entry.
+     */
+    const char *serial;
+    int serial_len;
 };
 
 #endif /* if !defined(PUSHLIST_H) && P2MP */
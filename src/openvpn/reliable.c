@@ -37,6 +37,7 @@
 #include "buffer.h"
 #include "error.h"
 #include "common.h"
+#include "integer.h"
 #include "reliable.h"
 
 #include "memdbg.h"
@@ -142,6 +143,10 @@ reliable_ack_acknowledge_packet_id(struct reliable_ack *ack, packet_id_type pid)
 {
     if (!reliable_ack_packet_id_present(ack, pid) && ack->len < RELIABLE_ACK_SIZE)
     {
+        const packet_id_type net_pid = htonpid(pid);
+
+        memcpy(&ack->framed[ack->len * sizeof(net_pid)], &net_pid,
+               sizeof(net_pid));
         ack->packet_id[ack->len++] = pid;
         dmsg(D_REL_DEBUG, "ACK acknowledge ID " packet_id_format " (ack->len=%d)",
              (packet_id_print_type)pid, ack->len);
@@ -229,15 +234,13 @@ reliable_ack_write(struct reliable_ack *ack,
         goto error;
     }
     ASSERT(buf_write(&sub, &n, sizeof(n)));
-    for (i = 0; i < n; ++i)
-    {
-        packet_id_type pid = ack->packet_id[i];
-        packet_id_type net_pid = htonpid(pid);
-        ASSERT(buf_write(&sub, &net_pid, sizeof(net_pid)));
-        dmsg(D_REL_DEBUG, "ACK write ID " packet_id_format " (ack->len=%d, n=%d)", (packet_id_print_type)pid, ack->len, n);
-    }
     if (n)
     {
+        /* IDs are kept preframed in network order by
+         * reliable_ack_acknowledge_packet_id(), so the whole list is
+         * attached with one bounded copy */
+        ASSERT(buf_write(&sub, ack->framed, n * sizeof(packet_id_type)));
+        dmsg(D_REL_DEBUG, "ACK write %d IDs (ack->len=%d)", n, ack->len);
         ASSERT(session_id_defined(sid));
         ASSERT(session_id_write(sid, &sub));
         for (i = 0, j = n; j < ack->len; )
@@ -245,6 +248,11 @@ reliable_ack_write(struct reliable_ack *ack,
             ack->packet_id[i++] = ack->packet_id[j++];
         }
         ack->len = i;
+        if (i)
+        {
+            memmove(ack->framed, &ack->framed[n * sizeof(packet_id_type)],
+                    i * sizeof(packet_id_type));
+        }
     }
 
     return true;
@@ -314,11 +322,15 @@ reliable_init(struct reliable *rel, int buf_size, int offset, int array_size, bo
     ASSERT(array_size > 0 && array_size <= RELIABLE_CAPACITY);
     rel->hold = hold;
     rel->size = array_size;
+    rel->cwnd = min_int(RELIABLE_CWND_INITIAL, array_size);
     rel->offset = offset;
+    rel->buf_size = buf_size;
     for (i = 0; i < rel->size; ++i)
     {
         struct reliable_entry *e = &rel->array[i];
-        e->buf = alloc_buf(buf_size);
+        /* start in the small size class; reliable_buf_promote grows
+         * the slot to buf_size when a larger packet needs it */
+        e->buf = alloc_buf(min_int(buf_size, offset + RELIABLE_SMALL_PAYLOAD));
         ASSERT(buf_init(&e->buf, offset));
     }
 }
@@ -382,6 +394,12 @@ reliable_send_purge(struct reliable *rel, const struct reliable_ack *ack)
                 }
 #endif
                 e->active = false;
+                /* the peer is keeping up -- open the congestion window */
+                if (rel->cwnd < rel->size)
+                {
+                    ++rel->cwnd;
+                    dmsg(D_REL_DEBUG, "ACK congestion window now %d", rel->cwnd);
+                }
                 break;
             }
         }
@@ -490,6 +508,33 @@ reliable_get_buf(struct reliable *rel)
     return NULL;
 }
 
+/* promote a small-class entry to full frame size if payload_size won't fit */
+struct buffer *
+reliable_buf_promote(struct reliable *rel, struct buffer *buf, int payload_size)
+{
+    int i;
+    for (i = 0; i < rel->size; ++i)
+    {
+        struct reliable_entry *e = &rel->array[i];
+        if (buf == &e->buf)
+        {
+            ASSERT(!e->active);
+            if (buf_forward_capacity(&e->buf) < payload_size
+                && e->buf.capacity < rel->buf_size)
+            {
+                dmsg(D_REL_DEBUG, "ACK promote buffer %d to %d bytes (payload=%d)",
+                     i, rel->buf_size, payload_size);
+                free_buf(&e->buf);
+                e->buf = alloc_buf(rel->buf_size);
+                ASSERT(buf_init(&e->buf, rel->offset));
+            }
+            return &e->buf;
+        }
+    }
+    ASSERT(0);                  /* buf not found in rel */
+    return NULL;
+}
+
 /* grab a free buffer, fail if buffer clogged by unacknowledged low packet IDs */
 struct buffer *
 reliable_get_buf_output_sequenced(struct reliable *rel)
@@ -498,6 +543,7 @@ reliable_get_buf_output_sequenced(struct reliable *rel)
     int i;
     packet_id_type min_id = 0;
     bool min_id_defined = false;
+    int n_active = 0;
     struct buffer *ret = NULL;
 
     /* find minimum active packet_id */
@@ -506,6 +552,7 @@ reliable_get_buf_output_sequenced(struct reliable *rel)
         const struct reliable_entry *e = &rel->array[i];
         if (e->active)
         {
+            ++n_active;
             if (!min_id_defined || reliable_pid_min(e->packet_id, min_id))
             {
                 min_id_defined = true;
@@ -514,7 +561,12 @@ reliable_get_buf_output_sequenced(struct reliable *rel)
         }
     }
 
-    if (!min_id_defined || reliable_pid_in_range1(rel->packet_id, min_id, rel->size))
+    if (n_active >= rel->cwnd)
+    {
+        dmsg(D_REL_LOW, "ACK output congestion window full (cwnd=%d): %s",
+             rel->cwnd, reliable_print_ids(rel, &gc));
+    }
+    else if (!min_id_defined || reliable_pid_in_range1(rel->packet_id, min_id, rel->size))
     {
         ret = reliable_get_buf(rel);
     }
@@ -591,6 +643,13 @@ reliable_send(struct reliable *rel, int *opcode)
     }
     if (best)
     {
+        if (best->timeout > rel->initial_timeout)
+        {
+            /* retransmission -- treat as a loss signal and back the
+             * congestion window off multiplicatively */
+            rel->cwnd = max_int(rel->cwnd / 2, min_int(RELIABLE_CWND_MIN, rel->size));
+            dmsg(D_REL_DEBUG, "ACK congestion window now %d (retransmit)", rel->cwnd);
+        }
 #ifdef EXPONENTIAL_BACKOFF
         /* exponential backoff */
         best->next_try = local_now + best->timeout;
@@ -615,6 +674,7 @@ reliable_schedule_now(struct reliable *rel)
     int i;
     dmsg(D_REL_DEBUG, "ACK reliable_schedule_now");
     rel->hold = false;
+    rel->cwnd = min_int(RELIABLE_CWND_INITIAL, rel->size);
     for (i = 0; i < rel->size; ++i)
     {
         struct reliable_entry *e = &rel->array[i];
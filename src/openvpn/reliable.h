@@ -43,15 +43,40 @@
 
 #define EXPONENTIAL_BACKOFF
 
-#define RELIABLE_ACK_SIZE 8     /**< The maximum number of packet IDs
+#define RELIABLE_ACK_SIZE 16    /**< The maximum number of packet IDs
                                  *   waiting to be acknowledged which can
                                  *   be stored in one \c reliable_ack
                                  *   structure. */
 
-#define RELIABLE_CAPACITY 8     /**< The maximum number of packets that
+#define RELIABLE_ACK_WRITE_MAX 8 /**< The maximum number of packet IDs
+                                  *   written to one on-wire acknowledgment
+                                  *   record.  Peers reject records larger
+                                  *   than their own \c RELIABLE_ACK_SIZE,
+                                  *   which is 8 in all released versions,
+                                  *   so this must not be raised even when
+                                  *   the local storage grows. */
+
+#define RELIABLE_CAPACITY 16    /**< The maximum number of packets that
                                  *   the reliability layer for one VPN
                                  *   tunnel in one direction can store. */
 
+#define RELIABLE_CWND_INITIAL 4 /**< Initial congestion window: the number
+                                 *   of unacknowledged packets the send side
+                                 *   will put in flight before the peer has
+                                 *   demonstrated it can keep up.  Grows by
+                                 *   one per acknowledged packet up to the
+                                 *   array size. */
+
+#define RELIABLE_CWND_MIN 2     /**< Floor for the congestion window after
+                                 *   retransmission-triggered shrinking. */
+
+#define RELIABLE_SMALL_PAYLOAD 128 /**< Payload capacity of the small buffer
+                                    *   size class.  Entries start out small,
+                                    *   which covers ACKs and bare resets, and
+                                    *   are promoted to full frame size by \c
+                                    *   reliable_buf_promote() when a larger
+                                    *   packet needs the slot. */
+
 /**
  * The acknowledgment structure in which packet IDs are stored for later
  * acknowledgment.
@@ -60,6 +85,11 @@ struct reliable_ack
 {
     int len;
     packet_id_type packet_id[RELIABLE_ACK_SIZE];
+    /* The same IDs preframed in network byte order, maintained by
+     * reliable_ack_acknowledge_packet_id() so that reliable_ack_write()
+     * can attach them with a single bounded copy.  Acks populated via
+     * reliable_ack_read() (purge-only) leave this unused. */
+    uint8_t framed[RELIABLE_ACK_SIZE * sizeof(packet_id_type)];
 };
 
 /**
@@ -83,9 +113,11 @@ struct reliable_entry
 struct reliable
 {
     int size;
+    int cwnd;  /* congestion window: max active packets in the send array */
     interval_t initial_timeout;
     packet_id_type packet_id;
     int offset;
+    int buf_size; /* large size class: full frame, see reliable_buf_promote */
     bool hold; /* don't xmit until reliable_schedule_now is called */
     struct reliable_entry array[RELIABLE_CAPACITY];
 };
@@ -284,6 +316,31 @@ bool reliable_ack_read_packet_id(struct buffer *buf, packet_id_type *pid);
  */
 struct buffer *reliable_get_buf(struct reliable *rel);
 
+/**
+ * Ensure a buffer returned by a get function can hold a payload.
+ *
+ * Entries are allocated in the small size class (\c
+ * RELIABLE_SMALL_PAYLOAD bytes of payload), which is sufficient for
+ * ACKs and bare resets.  This function promotes the entry owning \a
+ * buf to the full frame size when \a payload_size does not fit, and
+ * must be called between the get function and the corresponding
+ * mark-active function.  Promotion is permanent for the life of the
+ * reliable structure; since the get functions hand out the lowest
+ * free slot first, large packets cluster in the low slots and rarely
+ * used slots stay small.
+ *
+ * @param rel The reliable structure owning \a buf.
+ * @param buf The buffer previously returned by a get function.
+ * @param payload_size The number of payload bytes the caller intends
+ *     to store in the buffer.
+ *
+ * @return A pointer to the (possibly reallocated) entry buffer.  The
+ *     passed-in \a buf pointer remains valid but may now reference a
+ *     buffer of the large size class.
+ */
+struct buffer *reliable_buf_promote(struct reliable *rel, struct buffer *buf,
+                                    int payload_size);
+
 /**
  * Mark the %reliable entry associated with the given buffer as active
  * incoming.
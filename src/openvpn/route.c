@@ -525,8 +525,66 @@ add_route_ipv6_to_option_list(struct route_ipv6_option_list *l,
 static void
 clear_route_list(struct route_list *rl)
 {
+    struct route_ipv4 *store = rl->store;
+    const int store_capacity = rl->store_capacity;
+
     gc_free(&rl->gc);
     CLEAR(*rl);
+
+    /* the bulk route storage survives the clear so the next
+     * init_route_list() re-parses into already-allocated memory */
+    rl->store = store;
+    rl->store_capacity = store_capacity;
+}
+
+void
+free_route_list_storage(struct route_list *rl)
+{
+    free(rl->store);
+    rl->store = NULL;
+    rl->n_store = 0;
+    rl->store_capacity = 0;
+}
+
+/*
+ * Allocate the next route from the contiguous backing store, growing
+ * it on demand.  Growth rebases the intra-store list pointers, which
+ * is safe because the only live references into the store are
+ * rl->routes and the next fields of the nodes themselves.
+ */
+static struct route_ipv4 *
+route_list_alloc_route(struct route_list *rl)
+{
+    if (rl->n_store == rl->store_capacity)
+    {
+        const int new_capacity = rl->store_capacity ? rl->store_capacity * 2 : 64;
+        struct route_ipv4 *new_store;
+        int i;
+
+        ALLOC_ARRAY(new_store, struct route_ipv4, new_capacity);
+        if (rl->store)
+        {
+            memcpy(new_store, rl->store, sizeof(*new_store) * rl->n_store);
+            for (i = 0; i < rl->n_store; ++i)
+            {
+                if (new_store[i].next)
+                {
+                    new_store[i].next = new_store + (new_store[i].next - rl->store);
+                }
+            }
+            if (rl->routes)
+            {
+                rl->routes = new_store + (rl->routes - rl->store);
+            }
+            free(rl->store);
+        }
+        rl->store = new_store;
+        rl->store_capacity = new_capacity;
+    }
+
+    struct route_ipv4 *r = &rl->store[rl->n_store++];
+    CLEAR(*r);
+    return r;
 }
 
 static void
@@ -559,11 +617,9 @@ add_block_local_item(struct route_list *rl,
         struct route_ipv4 *r1, *r2;
         unsigned int l2;
 
-        ALLOC_OBJ_GC(r1, struct route_ipv4, &rl->gc);
-        ALLOC_OBJ_GC(r2, struct route_ipv4, &rl->gc);
-
         /* split a route into two smaller blocking routes, and direct them to target */
         l2 = ((~gateway->netmask)+1)>>1;
+        r1 = route_list_alloc_route(rl);
         r1->flags = RT_DEFINED;
         r1->gateway = target;
         r1->network = gateway->addr & gateway->netmask;
@@ -571,7 +627,10 @@ add_block_local_item(struct route_list *rl,
         r1->next = rl->routes;
         rl->routes = r1;
 
-        *r2 = *r1;
+        /* the store may have been rebased by the second allocation, so
+         * copy from the list head rather than the stale r1 pointer */
+        r2 = route_list_alloc_route(rl);
+        *r2 = *rl->routes;
         r2->network += l2;
         r2->next = rl->routes;
         rl->routes = r2;
@@ -708,8 +767,7 @@ init_route_list(struct route_list *rl,
                 struct addrinfo *curele;
                 for (curele = netlist; curele; curele = curele->ai_next)
                 {
-                    struct route_ipv4 *new;
-                    ALLOC_OBJ_GC(new, struct route_ipv4, &rl->gc);
+                    struct route_ipv4 *new = route_list_alloc_route(rl);
                     *new = r;
                     new->network = ntohl(((struct sockaddr_in *)curele->ai_addr)->sin_addr.s_addr);
                     new->next = rl->routes;
@@ -1218,6 +1276,7 @@ add_routes(struct route_list *rl, struct route_ipv6_list *rl6,
         }
 #endif
 
+        net_route_batch_start(ctx);
         for (r = rl->routes; r; r = r->next)
         {
             check_subnet_conflict(r->network, r->netmask, "route");
@@ -1227,6 +1286,7 @@ add_routes(struct route_list *rl, struct route_ipv6_list *rl6,
             }
             add_route(r, tt, flags, &rl->rgi, es, ctx);
         }
+        net_route_batch_commit(ctx);
         rl->iflags |= RL_ROUTES_ADDED;
     }
     if (rl6 && !(rl6->iflags & RL_ROUTES_ADDED) )
@@ -1241,6 +1301,7 @@ add_routes(struct route_list *rl, struct route_ipv6_list *rl6,
                 "as expected.", tt->actual_name);
         }
 
+        net_route_batch_start(ctx);
         for (r = rl6->routes_ipv6; r; r = r->next)
         {
             if (flags & ROUTE_DELETE_FIRST)
@@ -1249,6 +1310,7 @@ add_routes(struct route_list *rl, struct route_ipv6_list *rl6,
             }
             add_route_ipv6(r, tt, flags, es, ctx);
         }
+        net_route_batch_commit(ctx);
         rl6->iflags |= RL_ROUTES_ADDED;
     }
 }
@@ -1261,10 +1323,28 @@ delete_routes(struct route_list *rl, struct route_ipv6_list *rl6,
     if (rl && rl->iflags & RL_ROUTES_ADDED)
     {
         struct route_ipv4 *r;
+        int skipped = 0;
+        net_route_batch_start(ctx);
         for (r = rl->routes; r; r = r->next)
         {
+            /* routes via the VPN endpoint lead into the disappearing
+             * interface; the kernel drops them with the device, so the
+             * per-route delete can be skipped */
+            if ((flags & ROUTE_IFACE_DOWN)
+                && (rl->spec.flags & RTSA_REMOTE_ENDPOINT)
+                && r->gateway == rl->spec.remote_endpoint)
+            {
+                r->flags &= ~RT_ADDED;
+                ++skipped;
+                continue;
+            }
             delete_route(r, tt, flags, &rl->rgi, es, ctx);
         }
+        net_route_batch_commit(ctx);
+        if (skipped)
+        {
+            msg(D_ROUTE, "ROUTE: skipped deletion of %d route(s) bound to the closing interface", skipped);
+        }
         rl->iflags &= ~RL_ROUTES_ADDED;
     }
 
@@ -1278,10 +1358,25 @@ delete_routes(struct route_list *rl, struct route_ipv6_list *rl6,
     if (rl6 && (rl6->iflags & RL_ROUTES_ADDED) )
     {
         struct route_ipv6 *r6;
+        int skipped = 0;
+        net_route_batch_start(ctx);
         for (r6 = rl6->routes_ipv6; r6; r6 = r6->next)
         {
+            /* without an explicit interface these routes carry
+             * "dev <tun>" and vanish with the device */
+            if ((flags & ROUTE_IFACE_DOWN) && !r6->iface)
+            {
+                r6->flags &= ~RT_ADDED;
+                ++skipped;
+                continue;
+            }
             delete_route_ipv6(r6, tt, flags, es, ctx);
         }
+        net_route_batch_commit(ctx);
+        if (skipped)
+        {
+            msg(D_ROUTE, "ROUTE6: skipped deletion of %d route(s) bound to the closing interface", skipped);
+        }
         rl6->iflags &= ~RL_ROUTES_ADDED;
     }
 
@@ -3225,6 +3320,72 @@ get_default_gateway_ipv6(struct route_ipv6_gateway_info *rgi6,
 
 #elif defined(TARGET_LINUX)
 
+/*
+ * Cached default gateway state.
+ *
+ * get_default_gateway() is called on every tunnel (re-)establishment and
+ * issues a blocking RTM_GETROUTE lookup followed by a series of interface
+ * ioctls.  To avoid paying that cost on every reconnect, a netlink socket
+ * subscribed to routing table and interface changes is kept open for the
+ * lifetime of the process; as long as no change notification has arrived
+ * since the last full query, the previous result is still valid and is
+ * returned from memory.
+ */
+static int gdg_watch_fd = -1;
+static bool gdg_cache_defined;
+static struct route_gateway_info gdg_cache;
+
+static void
+gdg_watch_open(void)
+{
+    struct sockaddr_nl snl;
+
+    gdg_watch_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                          NETLINK_ROUTE);
+    if (gdg_watch_fd < 0)
+    {
+        return;
+    }
+
+    CLEAR(snl);
+    snl.nl_family = AF_NETLINK;
+    snl.nl_groups = RTMGRP_IPV4_ROUTE | RTMGRP_IPV4_IFADDR | RTMGRP_LINK;
+    if (bind(gdg_watch_fd, (struct sockaddr *) &snl, sizeof(snl)) < 0)
+    {
+        close(gdg_watch_fd);
+        gdg_watch_fd = -1;
+    }
+}
+
+/*
+ * Drain queued change notifications.  Returns true if the routing state
+ * may have changed since the last full query; on a socket error the
+ * watcher is disabled and every subsequent call falls back to a full
+ * query.
+ */
+static bool
+gdg_watch_dirty(void)
+{
+    bool dirty = false;
+    char buf[4096];
+    ssize_t len;
+
+    while ((len = recv(gdg_watch_fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+    {
+        dirty = true;
+    }
+    if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+    {
+        if (errno != ENOBUFS)
+        {
+            close(gdg_watch_fd);
+            gdg_watch_fd = -1;
+        }
+        dirty = true;
+    }
+    return dirty;
+}
+
 void
 get_default_gateway(struct route_gateway_info *rgi, openvpn_net_ctx_t *ctx)
 {
@@ -3235,6 +3396,18 @@ get_default_gateway(struct route_gateway_info *rgi, openvpn_net_ctx_t *ctx)
     CLEAR(*rgi);
     CLEAR(best_name);
 
+    /* consult the cache unless a routing change has been seen */
+    if (gdg_watch_fd < 0)
+    {
+        gdg_watch_open();
+    }
+    else if (gdg_cache_defined && !gdg_watch_dirty())
+    {
+        *rgi = gdg_cache;
+        gc_free(&gc);
+        return;
+    }
+
     /* get default gateway IP addr */
     if (net_route_v4_best_gw(ctx, NULL, &rgi->gateway.addr, best_name) == 0)
     {
@@ -3349,6 +3522,12 @@ get_default_gateway(struct route_gateway_info *rgi, openvpn_net_ctx_t *ctx)
     }
 
 done:
+    /* remember the result; it stays valid until the watcher reports a change */
+    if (gdg_watch_fd >= 0)
+    {
+        gdg_cache = *rgi;
+        gdg_cache_defined = true;
+    }
     if (sd >= 0)
     {
         close(sd);
@@ -49,6 +49,9 @@
  */
 #define ROUTE_DELETE_FIRST  (1<<2)
 #define ROUTE_REF_GW        (1<<3)
+/* the tun/tap interface is about to be destroyed: deletion of routes
+ * the kernel drops together with the interface may be skipped */
+#define ROUTE_IFACE_DOWN    (1<<4)
 
 struct route_bypass
 {
@@ -213,6 +216,12 @@ struct route_list {
     struct route_gateway_info rgi;
     unsigned int flags;   /* RG_x flags */
     struct route_ipv4 *routes;
+    /* contiguous backing store the 'routes' list threads through; kept
+     * across clear_route_list() so a restart re-parses into
+     * already-allocated memory instead of rebuilding a gc chain */
+    struct route_ipv4 *store;
+    int n_store;
+    int store_capacity;
     struct gc_arena gc;
 };
 
@@ -291,6 +300,8 @@ bool init_route_list(struct route_list *rl,
                      struct env_set *es,
                      openvpn_net_ctx_t *ctx);
 
+void free_route_list_storage(struct route_list *rl);
+
 bool init_route_ipv6_list(struct route_ipv6_list *rl6,
                           const struct route_ipv6_option_list *opt6,
                           const char *remote_endpoint,
@@ -29,6 +29,10 @@
 
 #include "syshead.h"
 
+#ifdef HAVE_POSIX_SPAWN
+#include <spawn.h>
+#endif
+
 #include "buffer.h"
 #include "error.h"
 #include "platform.h"
@@ -147,6 +151,21 @@ openvpn_execve(const struct argv *a, const struct env_set *es, const unsigned in
             char *const *envp = (char *const *)make_env_array(es, true, &gc);
             pid_t pid;
 
+#ifdef HAVE_POSIX_SPAWN
+            /* posix_spawn() avoids duplicating the page tables of a
+             * large server process the way fork() does */
+            if (posix_spawn(&pid, cmd, NULL, NULL, argv, envp) == 0)
+            {
+                if (waitpid(pid, &ret, 0) != pid)
+                {
+                    ret = OPENVPN_EXECVE_ERROR;
+                }
+            }
+            else
+            {
+                msg(M_ERR, "openvpn_execve: unable to spawn");
+            }
+#else  /* ifdef HAVE_POSIX_SPAWN */
             pid = fork();
             if (pid == (pid_t)0) /* child side */
             {
@@ -164,6 +183,7 @@ openvpn_execve(const struct argv *a, const struct env_set *es, const unsigned in
                     ret = OPENVPN_EXECVE_ERROR;
                 }
             }
+#endif /* ifdef HAVE_POSIX_SPAWN */
         }
         else
         {
@@ -186,6 +206,124 @@ openvpn_execve(const struct argv *a, const struct env_set *es, const unsigned in
     gc_free(&gc);
     return ret;
 }
+
+/*
+ * Like openvpn_execve(), but supply a block of data on the child's
+ * standard input.  Returns the exit status of the child,
+ * OPENVPN_EXECVE_NOT_ALLOWED if openvpn_execve_allowed() returns false,
+ * or OPENVPN_EXECVE_ERROR on other errors.
+ */
+int
+openvpn_execve_stdin(const struct argv *a, const struct env_set *es,
+                     const unsigned int flags, const char *input,
+                     size_t input_len)
+{
+    struct gc_arena gc = gc_new();
+    int ret = OPENVPN_EXECVE_ERROR;
+    static bool warn_shown = false;
+
+    if (a && a->argv[0])
+    {
+#if defined(ENABLE_FEATURE_EXECVE)
+        if (openvpn_execve_allowed(flags))
+        {
+            const char *cmd = a->argv[0];
+            char *const *argv = a->argv;
+            char *const *envp = (char *const *)make_env_array(es, true, &gc);
+            int pipe_stdin[2];
+            pid_t pid;
+
+            if (pipe(pipe_stdin) < 0)
+            {
+                msg(M_ERR, "openvpn_execve_stdin: unable to create pipe");
+            }
+
+#ifdef HAVE_POSIX_SPAWN
+            posix_spawn_file_actions_t fa;
+            posix_spawn_file_actions_init(&fa);
+            posix_spawn_file_actions_adddup2(&fa, pipe_stdin[0], 0);
+            posix_spawn_file_actions_addclose(&fa, pipe_stdin[0]);
+            posix_spawn_file_actions_addclose(&fa, pipe_stdin[1]);
+
+            const int spawn_status = posix_spawn(&pid, cmd, &fa, NULL,
+                                                 argv, envp);
+            posix_spawn_file_actions_destroy(&fa);
+            if (spawn_status != 0)
+            {
+                close(pipe_stdin[0]);
+                close(pipe_stdin[1]);
+                msg(M_ERR, "openvpn_execve_stdin: unable to spawn");
+            }
+#else  /* ifdef HAVE_POSIX_SPAWN */
+            pid = fork();
+            if (pid == (pid_t)0) /* child side */
+            {
+                close(pipe_stdin[1]);
+                if (dup2(pipe_stdin[0], 0) < 0)
+                {
+                    exit(OPENVPN_EXECVE_FAILURE);
+                }
+                close(pipe_stdin[0]);
+                execve(cmd, argv, envp);
+                exit(OPENVPN_EXECVE_FAILURE);
+            }
+            else if (pid < (pid_t)0) /* fork failed */
+            {
+                close(pipe_stdin[0]);
+                close(pipe_stdin[1]);
+                msg(M_ERR, "openvpn_execve_stdin: unable to fork");
+            }
+            else /* parent side */
+#endif /* ifdef HAVE_POSIX_SPAWN */
+            {
+                size_t off = 0;
+
+                close(pipe_stdin[0]);
+                while (off < input_len)
+                {
+                    const ssize_t n = write(pipe_stdin[1], input + off,
+                                            input_len - off);
+                    if (n < 0)
+                    {
+                        if (errno == EINTR)
+                        {
+                            continue;
+                        }
+                        msg(M_WARN | M_ERRNO,
+                            "openvpn_execve_stdin: error writing to child");
+                        break;
+                    }
+                    off += n;
+                }
+                close(pipe_stdin[1]);
+
+                if (waitpid(pid, &ret, 0) != pid)
+                {
+                    ret = OPENVPN_EXECVE_ERROR;
+                }
+            }
+        }
+        else
+        {
+            ret = OPENVPN_EXECVE_NOT_ALLOWED;
+            if (!warn_shown && (script_security() < SSEC_SCRIPTS))
+            {
+                msg(M_WARN, SCRIPT_SECURITY_WARNING);
+                warn_shown = true;
+            }
+        }
+#else  /* if defined(ENABLE_FEATURE_EXECVE) */
+        msg(M_WARN, "openvpn_execve_stdin: execve function not available");
+#endif /* if defined(ENABLE_FEATURE_EXECVE) */
+    }
+    else
+    {
+        msg(M_FATAL, "openvpn_execve_stdin: called with empty argv");
+    }
+
+    gc_free(&gc);
+    return ret;
+}
 #endif /* ifndef _WIN32 */
 
 /*
@@ -286,3 +424,71 @@ openvpn_popen(const struct argv *a,  const struct env_set *es)
     gc_free(&gc);
     return ret;
 }
+
+/*
+ * Like openvpn_popen(), but the pipe is connected to the child's stdin
+ * and the child is left running: the caller gets the write end of the
+ * pipe and the coprocess sees EOF when that fd is closed.  Used for
+ * long-lived helpers which are fed events instead of being forked per
+ * event.
+ */
+int
+openvpn_popen_stdin(const struct argv *a, const struct env_set *es)
+{
+    struct gc_arena gc = gc_new();
+    int ret = -1;
+
+    if (a && a->argv[0])
+    {
+#if defined(ENABLE_FEATURE_EXECVE)
+        if (script_security() >= SSEC_BUILT_IN)
+        {
+            const char *cmd = a->argv[0];
+            char *const *argv = a->argv;
+            char *const *envp = (char *const *)make_env_array(es, true, &gc);
+            pid_t pid;
+            int pipe_stdin[2];
+
+            if (pipe(pipe_stdin) == 0)
+            {
+                pid = fork();
+                if (pid == (pid_t)0)       /* child side */
+                {
+                    close(pipe_stdin[1]);          /* Close write end */
+                    dup2(pipe_stdin[0], 0);
+                    execve(cmd, argv, envp);
+                    exit(OPENVPN_EXECVE_FAILURE);
+                }
+                else if (pid > (pid_t)0)       /* parent side */
+                {
+                    close(pipe_stdin[0]);         /* Close read end */
+                    ret = pipe_stdin[1];
+                }
+                else       /* fork failed */
+                {
+                    close(pipe_stdin[0]);
+                    close(pipe_stdin[1]);
+                    msg(M_ERR, "openvpn_popen_stdin: unable to fork %s", cmd);
+                }
+            }
+            else
+            {
+                msg(M_WARN, "openvpn_popen_stdin: unable to create stdin pipe for %s", cmd);
+            }
+        }
+        else
+        {
+            msg(M_WARN, SCRIPT_SECURITY_WARNING);
+        }
+#else  /* if defined(ENABLE_FEATURE_EXECVE) */
+        msg(M_WARN, "openvpn_popen_stdin: execve function not available");
+#endif /* if defined(ENABLE_FEATURE_EXECVE) */
+    }
+    else
+    {
+        msg(M_FATAL, "openvpn_popen_stdin: called with empty argv");
+    }
+
+    gc_free(&gc);
+    return ret;
+}
@@ -48,6 +48,16 @@ void script_security_set(int level);
 /* wrapper around the execve() call */
 int openvpn_popen(const struct argv *a,  const struct env_set *es);
 
+/* start a long-lived coprocess, return the write end of a pipe
+ * connected to its stdin, or -1 on error */
+int openvpn_popen_stdin(const struct argv *a, const struct env_set *es);
+
+/* run a command with a block of data on its stdin, wait for it and
+ * return its exit status */
+int openvpn_execve_stdin(const struct argv *a, const struct env_set *es,
+                         const unsigned int flags, const char *input,
+                         size_t input_len);
+
 bool openvpn_execve_allowed(const unsigned int flags);
 
 bool openvpn_execve_check(const struct argv *a, const struct env_set *es,
@@ -40,10 +40,9 @@
 
 struct status
 {
-    int sru;
     int ins;
-    int coll;
-    int lsteps;
+    int casc;
+    int scans;
 };
 
 static struct status z;
@@ -57,10 +56,11 @@ schedule_entry_debug_info(const char *caller, const struct schedule_entry *e)
     struct gc_arena gc = gc_new();
     if (e)
     {
-        dmsg(D_SCHEDULER, "SCHEDULE: %s wakeup=[%s] pri=%u",
+        dmsg(D_SCHEDULER, "SCHEDULE: %s wakeup=[%s] level=%d slot=%d",
              caller,
              tv_string_abs(&e->tv, &gc),
-             e->pri);
+             e->level,
+             e->slot);
     }
     else
     {
@@ -71,276 +71,147 @@ schedule_entry_debug_info(const char *caller, const struct schedule_entry *e)
 }
 #endif
 
-static inline void
-schedule_set_pri(struct schedule_entry *e)
+static inline uint64_t
+schedule_tv_to_tick(const struct timeval *tv)
 {
-    e->pri = random();
-    if (e->pri < 1)
-    {
-        e->pri = 1;
-    }
+    return (((uint64_t)tv->tv_sec * 1000000) + tv->tv_usec)
+           >> SCHEDULE_TICK_SHIFT;
 }
 
-/* This is the master key comparison routine.  A key is
- * simply a struct timeval containing the absolute time for
- * an event.  The unique treap priority (pri) is used to ensure
- * that keys do not collide.
- */
-static inline int
-schedule_entry_compare(const struct schedule_entry *e1,
-                       const struct schedule_entry *e2)
+/* total tick range representable by all wheel levels */
+static inline uint64_t
+wheel_horizon(void)
 {
-    if (e1->tv.tv_sec < e2->tv.tv_sec)
-    {
-        return -1;
-    }
-    else if (e1->tv.tv_sec > e2->tv.tv_sec)
-    {
-        return 1;
-    }
-    else
-    {
-        if (e1->tv.tv_usec < e2->tv.tv_usec)
-        {
-            return -1;
-        }
-        else if (e1->tv.tv_usec > e2->tv.tv_usec)
-        {
-            return 1;
-        }
-        else
-        {
-            if (e1->pri < e2->pri)
-            {
-                return -1;
-            }
-            else if (e1->pri > e2->pri)
-            {
-                return 1;
-            }
-            else
-            {
-                return 0;
-            }
-        }
-    }
+    return (uint64_t)1 << (SCHEDULE_WHEEL_BITS * SCHEDULE_WHEEL_LEVELS);
 }
 
 /*
- * Detach a btree node from its parent
+ * Return the cyclic distance from slot 'start' to the first
+ * occupied slot at a wheel level, or -1 if the level is empty.
  */
-static inline void
-schedule_detach_parent(struct schedule *s, struct schedule_entry *e)
+static int
+wheel_scan(const uint64_t *occupied, int start)
 {
-    if (e)
+    int j = 0;
+    while (j < SCHEDULE_WHEEL_SLOTS)
     {
-        if (e->parent)
-        {
-            if (e->parent->lt == e)
-            {
-                e->parent->lt = NULL;
-            }
-            else if (e->parent->gt == e)
-            {
-                e->parent->gt = NULL;
-            }
-            else
-            {
-                /* parent <-> child linkage is corrupted */
-                ASSERT(0);
-            }
-            e->parent = NULL;
-        }
-        else
+        const int slot = (start + j) & SCHEDULE_WHEEL_MASK;
+        uint64_t word = occupied[slot >> 6] >> (slot & 63);
+        if (word)
         {
-            if (s->root == e) /* last element deleted, tree is empty */
+            while (!(word & 1))
             {
-                s->root = NULL;
+                word >>= 1;
+                ++j;
             }
+            return j < SCHEDULE_WHEEL_SLOTS ? j : -1;
         }
+        j += 64 - (slot & 63);
     }
+    return -1;
 }
 
 /*
- *
- * Given a binary search tree, move a node toward the root
- * while still maintaining the correct ordering relationships
- * within the tree.  This function is the workhorse
- * of the tree balancer.
- *
- * This code will break on key collisions, which shouldn't
- * happen because the treap priority is considered part of the key
- * and is guaranteed to be unique.
+ * Map an absolute tick to a wheel level and slot, given the
+ * current cursor position.  Past-due ticks land in the cursor
+ * slot so they fire on the next query.
  */
 static void
-schedule_rotate_up(struct schedule *s, struct schedule_entry *e)
+wheel_position(uint64_t base, uint64_t tick, int *level, int *slot)
 {
-    if (e && e->parent)
-    {
-        struct schedule_entry *lt = e->lt;
-        struct schedule_entry *gt = e->gt;
-        struct schedule_entry *p = e->parent;
-        struct schedule_entry *gp = p->parent;
-
-        if (gp) /* if grandparent exists, modify its child link */
-        {
-            if (gp->gt == p)
-            {
-                gp->gt = e;
-            }
-            else if (gp->lt == p)
-            {
-                gp->lt = e;
-            }
-            else
-            {
-                ASSERT(0);
-            }
-        }
-        else /* no grandparent, now we are the root */
-        {
-            s->root = e;
-        }
-
-        /* grandparent is now our parent */
-        e->parent = gp;
+    int l = 0;
 
-        /* parent is now our child */
-        p->parent = e;
+    if (tick < base)
+    {
+        tick = base;
+    }
+    while (tick - base >= ((uint64_t)1 << (SCHEDULE_WHEEL_BITS * (l + 1))))
+    {
+        ++l;
+    }
+    ASSERT(l < SCHEDULE_WHEEL_LEVELS);
+    *level = l;
+    *slot = (int)((tick >> (SCHEDULE_WHEEL_BITS * l)) & SCHEDULE_WHEEL_MASK);
+}
 
-        /* reorient former parent's links
-         * to reflect new position in the tree */
-        if (p->gt == e)
-        {
-            e->lt = p;
-            p->gt = lt;
-            if (lt)
-            {
-                lt->parent = p;
-            }
-        }
-        else if (p->lt == e)
-        {
-            e->gt = p;
-            p->lt = gt;
-            if (gt)
-            {
-                gt->parent = p;
-            }
-        }
-        else
-        {
-            /* parent <-> child linkage is corrupted */
-            ASSERT(0);
-        }
+static void
+wheel_link(struct schedule *s, struct schedule_entry *e)
+{
+    struct schedule_wheel_level *wl;
 
-#ifdef SCHEDULE_TEST
-        ++z.sru;
-#endif
+    wheel_position(s->base, e->tick, &e->level, &e->slot);
+    wl = &s->level[e->level];
+    e->next = wl->slot[e->slot];
+    if (e->next)
+    {
+        e->next->pprev = &e->next;
     }
+    e->pprev = &wl->slot[e->slot];
+    wl->slot[e->slot] = e;
+    wl->occupied[e->slot >> 6] |= ((uint64_t)1 << (e->slot & 63));
 }
 
-/*
- * This is the treap deletion algorithm:
- *
- * Rotate lesser-priority children up in the tree
- * until we are childless.  Then delete.
- */
-void
-schedule_remove_node(struct schedule *s, struct schedule_entry *e)
+static void
+wheel_unlink(struct schedule *s, struct schedule_entry *e)
 {
-    while (e->lt || e->gt)
+    struct schedule_wheel_level *wl = &s->level[e->level];
+
+    *e->pprev = e->next;
+    if (e->next)
     {
-        if (e->lt)
-        {
-            if (e->gt)
-            {
-                if (e->lt->pri < e->gt->pri)
-                {
-                    schedule_rotate_up(s, e->lt);
-                }
-                else
-                {
-                    schedule_rotate_up(s, e->gt);
-                }
-            }
-            else
-            {
-                schedule_rotate_up(s, e->lt);
-            }
-        }
-        else if (e->gt)
-        {
-            schedule_rotate_up(s, e->gt);
-        }
+        e->next->pprev = e->pprev;
+        e->next = NULL;
+    }
+    e->pprev = NULL;
+    if (!wl->slot[e->slot])
+    {
+        wl->occupied[e->slot >> 6] &= ~((uint64_t)1 << (e->slot & 63));
     }
-
-    schedule_detach_parent(s, e);
-    e->pri = 0;
 }
 
 /*
- * Trivially add a node to a binary search tree without
- * regard for balance.
+ * Move all entries hanging on a higher-level slot down to the
+ * level(s) below.  Because the cursor has been advanced to the
+ * start of the expanded slot, every entry re-links at a lower
+ * level, so the cascade always terminates.
  */
 static void
-schedule_insert(struct schedule *s, struct schedule_entry *e)
+wheel_expand(struct schedule *s, int level, int slot)
 {
-    struct schedule_entry *c = s->root;
-    while (true)
+    struct schedule_wheel_level *wl = &s->level[level];
+    struct schedule_entry *e = wl->slot[slot];
+
+    wl->slot[slot] = NULL;
+    wl->occupied[slot >> 6] &= ~((uint64_t)1 << (slot & 63));
+
+    while (e)
     {
-        const int comp = schedule_entry_compare(e, c);
+        struct schedule_entry *next = e->next;
+        wheel_link(s, e);
+        e = next;
+    }
 
 #ifdef SCHEDULE_TEST
-        ++z.ins;
+    ++z.casc;
 #endif
+}
 
-        if (comp == -1)
-        {
-            if (c->lt)
-            {
-                c = c->lt;
-                continue;
-            }
-            else
-            {
-                c->lt = e;
-                e->parent = c;
-                break;
-            }
-        }
-        else if (comp == 1)
-        {
-            if (c->gt)
-            {
-                c = c->gt;
-                continue;
-            }
-            else
-            {
-                c->gt = e;
-                e->parent = c;
-                break;
-            }
-        }
-        else
-        {
-            /* rare key/priority collision -- no big deal,
-             * just choose another priority and retry */
-#ifdef SCHEDULE_TEST
-            ++z.coll;
-#endif
-            schedule_set_pri(e);
-            /* msg (M_INFO, "PRI COLLISION pri=%u", e->pri); */
-            c = s->root;
-            continue;
-        }
+/*
+ * Remove a node from the wheel if it's currently queued.
+ */
+void
+schedule_remove_node(struct schedule *s, struct schedule_entry *e)
+{
+    if (IN_WHEEL(e))
+    {
+        wheel_unlink(s, e);
+        --s->count;
     }
 }
 
 /*
- * Given an element, remove it from the btree if it's already
- * there and re-insert it based on its current key.
+ * Given an element, remove it from the wheel if it's already
+ * there and re-insert it based on its current wakeup time.
  */
 void
 schedule_add_modify(struct schedule *s, struct schedule_entry *e)
@@ -352,58 +223,105 @@ schedule_add_modify(struct schedule *s, struct schedule_entry *e)
     }
 #endif
 
-    /* already in tree, remove */
-    if (IN_TREE(e))
-    {
-        schedule_remove_node(s, e);
-    }
+    /* already in wheel, remove */
+    schedule_remove_node(s, e);
 
-    /* set random priority */
-    schedule_set_pri(e);
+    e->tick = schedule_tv_to_tick(&e->tv);
 
-    if (s->root)
+    if (s->count == 0)
     {
-        schedule_insert(s, e);   /* trivial insert into tree */
+        /* wheel is empty -- resync the cursor so the full
+         * slot range is available in front of the new entry */
+        s->base = e->tick;
     }
-    else
+    else if (e->tick >= s->base + wheel_horizon())
     {
-        s->root = e; /* tree was empty, we are the first element */
-
-    }
-    /* This is the magic of the randomized treap algorithm which
-     * keeps the tree balanced.  Move the node up the tree until
-     * its own priority is greater than that of its parent */
-    while (e->parent && e->parent->pri > e->pri)
-    {
-        schedule_rotate_up(s, e);
+        /* beyond the outermost level (~816 days); park the entry
+         * at the far edge so it fires early and gets rescheduled */
+        e->tick = s->base + wheel_horizon() - 1;
     }
+
+    wheel_link(s, e);
+    ++s->count;
+
+#ifdef SCHEDULE_TEST
+    ++z.ins;
+#endif
 }
 
 /*
- * Find the earliest event to be scheduled
+ * Find the earliest event to be scheduled, advancing the wheel
+ * cursor and cascading higher-level slots down as their time
+ * window is reached.  The returned entry stays queued.
  */
 struct schedule_entry *
-schedule_find_least(struct schedule_entry *e)
+schedule_find_least(struct schedule *s)
 {
-    if (e)
+    struct schedule_entry *least = NULL;
+
+    while (s->count)
     {
-        while (e->lt)
+        int d = wheel_scan(s->level[0].occupied,
+                           (int)(s->base & SCHEDULE_WHEEL_MASK));
+        if (d >= 0)
         {
+            const struct schedule_entry *e;
+            int slot;
+
+            s->base += d;
+            slot = (int)(s->base & SCHEDULE_WHEEL_MASK);
+            for (e = s->level[0].slot[slot]; e; e = e->next)
+            {
 #ifdef SCHEDULE_TEST
-            ++z.lsteps;
+                ++z.scans;
 #endif
-            e = e->lt;
+                if (!least || tv_lt(&e->tv, &least->tv))
+                {
+                    least = (struct schedule_entry *)e;
+                }
+            }
+            break;
+        }
+
+        /* level 0 is empty: pull the next occupied
+         * higher-level slot down and retry */
+        {
+            int l;
+            for (l = 1; l < SCHEDULE_WHEEL_LEVELS; ++l)
+            {
+                const int shift = SCHEDULE_WHEEL_BITS * l;
+                const int cursor =
+                    (int)((s->base >> shift) & SCHEDULE_WHEEL_MASK);
+
+                d = wheel_scan(s->level[l].occupied, cursor);
+                if (d >= 0)
+                {
+                    if (d > 0)
+                    {
+                        /* jump the cursor to the start of the
+                         * slot we are about to expand */
+                        s->base = ((s->base >> shift) + d) << shift;
+                    }
+                    wheel_expand(s, l,
+                                 (int)((s->base >> shift)
+                                       & SCHEDULE_WHEEL_MASK));
+                    break;
+                }
+            }
+
+            /* count > 0 but all levels empty -- wheel is corrupted */
+            ASSERT(l < SCHEDULE_WHEEL_LEVELS);
         }
     }
 
 #ifdef ENABLE_DEBUG
     if (check_debug_level(D_SCHEDULER))
     {
-        schedule_entry_debug_info("schedule_find_least", e);
+        schedule_entry_debug_info("schedule_find_least", least);
     }
 #endif
 
-    return e;
+    return least;
 }
 
 /*
@@ -438,285 +356,104 @@ schedule_remove_entry(struct schedule *s, struct schedule_entry *e)
 
 #ifdef SCHEDULE_TEST
 
-static inline struct schedule_entry *
-schedule_find_earliest_wakeup(struct schedule *s)
-{
-    return schedule_find_least(s->root);
-}
-
 /*
- * Recursively check that the treap (btree) is
- * internally consistent.
+ * Walk every slot at every level and verify that the linkage
+ * and occupancy bitmaps are internally consistent.
  */
-int
-schedule_debug_entry(const struct schedule_entry *e,
-                     int depth,
-                     int *count,
-                     struct timeval *least,
-                     const struct timeval *min,
-                     const struct timeval *max)
+static int
+schedule_debug_count(struct schedule *s)
 {
-    struct gc_arena gc = gc_new();
-    int maxdepth = depth;
-    if (e)
-    {
-        int d;
-
-        ASSERT(e != e->lt);
-        ASSERT(e != e->gt);
-        ASSERT(e != e->parent);
-        ASSERT(!e->parent || e->parent != e->lt);
-        ASSERT(!e->parent || e->parent != e->gt);
-        ASSERT(!e->lt || e->lt != e->gt);
-
-        if (e->lt)
-        {
-            ASSERT(e->lt->parent == e);
-            ASSERT(schedule_entry_compare(e->lt, e) == -1);
-            ASSERT(e->lt->pri >= e->pri);
-        }
-
-        if (e->gt)
-        {
-            ASSERT(e->gt->parent == e);
-            ASSERT(schedule_entry_compare(e->gt, e));
-            ASSERT(e->gt->pri >= e->pri);
-        }
-
-        ASSERT(tv_le(min, &e->tv));
-        ASSERT(tv_le(&e->tv, max));
-
-        if (count)
-        {
-            ++(*count);
-        }
-
-        if (least && tv_lt(&e->tv, least))
-        {
-            *least = e->tv;
-        }
+    int count = 0;
 
-        d = schedule_debug_entry(e->lt, depth+1, count, least, min, &e->tv);
-        if (d > maxdepth)
+    for (int l = 0; l < SCHEDULE_WHEEL_LEVELS; ++l)
+    {
+        struct schedule_wheel_level *wl = &s->level[l];
+        for (int i = 0; i < SCHEDULE_WHEEL_SLOTS; ++i)
         {
-            maxdepth = d;
-        }
+            struct schedule_entry *e = wl->slot[i];
+            const bool occ =
+                (wl->occupied[i >> 6] >> (i & 63)) & 1;
 
-        d = schedule_debug_entry(e->gt, depth+1, count, least, &e->tv, max);
-        if (d > maxdepth)
-        {
-            maxdepth = d;
+            ASSERT(occ == (e != NULL));
+            while (e)
+            {
+                ASSERT(e->level == l);
+                ASSERT(e->slot == i);
+                ASSERT(IN_WHEEL(e));
+                ASSERT(!e->next || e->next->pprev == &e->next);
+                ++count;
+                e = e->next;
+            }
         }
     }
-    gc_free(&gc);
-    return maxdepth;
+    ASSERT(count == s->count);
+    return count;
 }
 
-int
-schedule_debug(struct schedule *s, int *count, struct timeval *least)
-{
-    struct timeval min;
-    struct timeval max;
-
-    min.tv_sec = 0;
-    min.tv_usec = 0;
-    max.tv_sec = 0x7FFFFFFF;
-    max.tv_usec = 0x7FFFFFFF;
-
-    if (s->root)
-    {
-        ASSERT(s->root->parent == NULL);
-    }
-    return schedule_debug_entry(s->root, 0, count, least, &min, &max);
-}
-
-#if 1
-
-void
+static void
 tv_randomize(struct timeval *tv)
 {
     tv->tv_sec += random() % 100;
     tv->tv_usec = random() % 100;
 }
 
-#else  /* if 1 */
-
-void
-tv_randomize(struct timeval *tv)
-{
-    struct gc_arena gc = gc_new();
-    long int choice = get_random();
-    if ((choice & 0xFF) == 0)
-    {
-        tv->tv_usec += ((choice >> 8) & 0xFF);
-    }
-    else
-    {
-        prng_bytes((uint8_t *)tv, sizeof(struct timeval));
-    }
-    gc_free(&gc);
-}
-
-#endif /* if 1 */
-
-void
-schedule_verify(struct schedule *s)
-{
-    struct gc_arena gc = gc_new();
-    struct timeval least;
-    int count;
-    int maxlev;
-    struct schedule_entry *e;
-    const struct status zz = z;
-
-    least.tv_sec = least.tv_usec = 0x7FFFFFFF;
-
-    count = 0;
-
-    maxlev = schedule_debug(s, &count, &least);
-
-    e = schedule_find_earliest_wakeup(s);
-
-    if (e)
-    {
-        printf("Verification Phase  count=%d maxlev=%d sru=%d ins=%d coll=%d ls=%d l=%s",
-               count,
-               maxlev,
-               zz.sru,
-               zz.ins,
-               zz.coll,
-               zz.lsteps,
-               tv_string(&e->tv, &gc));
-
-        if (!tv_eq(&least, &e->tv))
-        {
-            printf(" [COMPUTED DIFFERENT MIN VALUES!]");
-        }
-
-        printf("\n");
-    }
-
-    CLEAR(z);
-    gc_free(&gc);
-}
-
-void
-schedule_randomize_array(struct schedule_entry **array, int size)
-{
-    int i;
-    for (i = 0; i < size; ++i)
-    {
-        const int src = get_random() % size;
-        struct schedule_entry *tmp = array [i];
-        if (i != src)
-        {
-            array [i] = array [src];
-            array [src] = tmp;
-        }
-    }
-}
-
-void
-schedule_print_work(struct schedule_entry *e, int indent)
-{
-    struct gc_arena gc = gc_new();
-    int i;
-    for (i = 0; i < indent; ++i)
-    {
-        printf(" ");
-    }
-    if (e)
-    {
-        printf("%s [%u] e=" ptr_format ", p=" ptr_format " lt=" ptr_format " gt=" ptr_format "\n",
-               tv_string(&e->tv, &gc),
-               e->pri,
-               (ptr_type)e,
-               (ptr_type)e->parent,
-               (ptr_type)e->lt,
-               (ptr_type)e->gt);
-        schedule_print_work(e->lt, indent+1);
-        schedule_print_work(e->gt, indent+1);
-    }
-    else
-    {
-        printf("NULL\n");
-    }
-    gc_free(&gc);
-}
-
-void
-schedule_print(struct schedule *s)
-{
-    printf("*************************\n");
-    schedule_print_work(s->root, 0);
-}
-
+#define NENT 1000
 void
 schedule_test(void)
 {
     struct gc_arena gc = gc_new();
-    int n = 1000;
-    int n_mod = 25;
+    int i;
+    struct schedule_entry *e;
+    struct schedule_entry *array[NENT];
+    struct timeval least_tv;
+    bool have_least = false;
 
-    int i, j;
-    struct schedule_entry **array;
     struct schedule *s = schedule_init();
-    struct schedule_entry *e;
 
     CLEAR(z);
-    ALLOC_ARRAY(array, struct schedule_entry *, n);
+    CLEAR(least_tv);
 
-    printf("Creation/Insertion Phase\n");
-
-    for (i = 0; i < n; ++i)
+    for (i = 0; i < NENT; ++i)
     {
-        ALLOC_OBJ_CLEAR(array[i], struct schedule_entry);
-        tv_randomize(&array[i]->tv);
-        /*schedule_print (s);*/
-        /*schedule_verify (s);*/
-        schedule_add_modify(s, array[i]);
+        ALLOC_OBJ_CLEAR(e, struct schedule_entry);
+        array[i] = e;
+        e->tv.tv_sec = now;
+        tv_randomize(&e->tv);
+        schedule_add_entry(s, e, &e->tv, 0);
     }
+    schedule_debug_count(s);
 
-    schedule_randomize_array(array, n);
-
-    /*schedule_print (s);*/
-    schedule_verify(s);
-
-    for (j = 1; j <= n_mod; ++j)
+    /* repeatedly pull the earliest entry, verify that wakeup
+     * times come out in non-decreasing order, and push each
+     * entry back in at a later time */
+    for (i = 0; i < NENT * 10; ++i)
     {
-        printf("Modification Phase Pass %d\n", j);
+        struct timeval wakeup;
 
-        for (i = 0; i < n; ++i)
+        e = schedule_get_earliest_wakeup(s, &wakeup);
+        ASSERT(e);
+        if (have_least)
         {
-            e = schedule_find_earliest_wakeup(s);
-            /*printf ("BEFORE %s\n", tv_string (&e->tv, &gc));*/
-            tv_randomize(&e->tv);
-            /*printf ("AFTER %s\n", tv_string (&e->tv, &gc));*/
-            schedule_add_modify(s, e);
-            /*schedule_verify (s);*/
-            /*schedule_print (s);*/
+            ASSERT(!tv_lt(&wakeup, &least_tv));
         }
-        schedule_verify(s);
-        /*schedule_print (s);*/
-    }
+        least_tv = wakeup;
+        have_least = true;
 
-    /*printf ("INS=%d\n", z.ins);*/
-
-    while ((e = schedule_find_earliest_wakeup(s)))
-    {
-        schedule_remove_node(s, e);
-        /*schedule_verify (s);*/
+        wakeup.tv_sec += 1 + (random() % 100);
+        schedule_add_entry(s, e, &wakeup, 0);
     }
-    schedule_verify(s);
+    schedule_debug_count(s);
 
-    printf("S->ROOT is %s\n", s->root ? "NOT NULL" : "NULL");
+    msg(M_INFO, "SCHEDULE: ins=%d casc=%d scans=%d count=%d",
+        z.ins, z.casc, z.scans, s->count);
 
-    for (i = 0; i < n; ++i)
+    for (i = 0; i < NENT; ++i)
     {
+        schedule_remove_entry(s, array[i]);
         free(array[i]);
     }
-    free(array);
-    free(s);
+    ASSERT(s->count == 0);
+    schedule_free(s);
     gc_free(&gc);
 }
 
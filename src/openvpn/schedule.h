@@ -26,13 +26,21 @@
 
 /*
  * This code implements an efficient scheduler using
- * a random treap binary tree.
+ * a hierarchical timing wheel.
  *
  * The scheduler is used by the server executive to
  * keep track of which instances need service at a
  * known time in the future.  Instances need to
  * schedule events for things such as sending
  * a ping or scheduling a TLS renegotiation.
+ *
+ * Wakeup times are quantized to wheel ticks of
+ * 2^SCHEDULE_TICK_SHIFT microseconds (~16 ms), which
+ * is well below the sigma window the server executive
+ * schedules with.  Insertion and removal are O(1);
+ * finding the earliest wakeup is amortized O(1) as the
+ * wheel cursor only moves forward over slots whose
+ * time has come.
  */
 
 /* define to enable a special test mode */
@@ -41,19 +49,39 @@
 #include "otime.h"
 #include "error.h"
 
+/* each wheel level covers 256 slots of the level below */
+#define SCHEDULE_WHEEL_BITS   8
+#define SCHEDULE_WHEEL_SLOTS  (1 << SCHEDULE_WHEEL_BITS)
+#define SCHEDULE_WHEEL_MASK   (SCHEDULE_WHEEL_SLOTS - 1)
+#define SCHEDULE_WHEEL_LEVELS 4
+
+/* one wheel tick = 2^14 microseconds (~16.4 ms) */
+#define SCHEDULE_TICK_SHIFT   14
+
 struct schedule_entry
 {
-    struct timeval tv;           /* wakeup time */
-    unsigned int pri;            /* random treap priority */
-    struct schedule_entry *parent; /* treap (btree) links */
-    struct schedule_entry *lt;
-    struct schedule_entry *gt;
+    struct timeval tv;              /* wakeup time */
+    uint64_t tick;                  /* tv quantized to wheel ticks */
+    int level;                      /* wheel level the entry hangs on */
+    int slot;                       /* slot within that level */
+    struct schedule_entry *next;    /* doubly-linked slot list */
+    struct schedule_entry **pprev;
+};
+
+struct schedule_wheel_level
+{
+    struct schedule_entry *slot[SCHEDULE_WHEEL_SLOTS];
+
+    /* one bit per slot, so an empty level is skipped 64 slots at a time */
+    uint64_t occupied[SCHEDULE_WHEEL_SLOTS / 64];
 };
 
 struct schedule
 {
     struct schedule_entry *earliest_wakeup; /* cached earliest wakeup */
-    struct schedule_entry *root;          /* the root of the treap (btree) */
+    uint64_t base;                          /* tick of current wheel cursor */
+    int count;                              /* number of queued entries */
+    struct schedule_wheel_level level[SCHEDULE_WHEEL_LEVELS];
 };
 
 /* Public functions */
@@ -71,10 +99,10 @@ void schedule_test(void);
 
 /* Private Functions */
 
-/* is node already in tree? */
-#define IN_TREE(e) ((e)->pri)
+/* is node already in the wheel? */
+#define IN_WHEEL(e) ((e)->pprev != NULL)
 
-struct schedule_entry *schedule_find_least(struct schedule_entry *e);
+struct schedule_entry *schedule_find_least(struct schedule *s);
 
 void schedule_add_modify(struct schedule *s, struct schedule_entry *e);
 
@@ -84,7 +112,7 @@ void schedule_remove_node(struct schedule *s, struct schedule_entry *e);
 
 /*
  * Add a struct schedule_entry (whose storage is managed by
- * caller) to the btree.  tv signifies the wakeup time for
+ * caller) to the timing wheel.  tv signifies the wakeup time for
  * a future event.  sigma is a time interval measured
  * in microseconds -- the event window being represented
  * starts at (tv - sigma) and ends at (tv + sigma).
@@ -100,7 +128,7 @@ schedule_add_entry(struct schedule *s,
                    const struct timeval *tv,
                    unsigned int sigma)
 {
-    if (!IN_TREE(e) || !sigma || !tv_within_sigma(tv, &e->tv, sigma))
+    if (!IN_WHEEL(e) || !sigma || !tv_within_sigma(tv, &e->tv, sigma))
     {
         e->tv = *tv;
         schedule_add_modify(s, e);
@@ -110,9 +138,8 @@ schedule_add_entry(struct schedule *s,
 
 /*
  * Return the node with the earliest wakeup time.  If two
- * nodes have the exact same wakeup time, select based on
- * the random priority assigned to each node (the priority
- * is randomized every time an entry is re-added).
+ * nodes land in the same wheel slot, the one with the
+ * earliest tv is selected.
  */
 static inline struct schedule_entry *
 schedule_get_earliest_wakeup(struct schedule *s,
@@ -123,7 +150,7 @@ schedule_get_earliest_wakeup(struct schedule *s,
     /* cache result */
     if (!s->earliest_wakeup)
     {
-        s->earliest_wakeup = schedule_find_least(s->root);
+        s->earliest_wakeup = schedule_find_least(s);
     }
     ret = s->earliest_wakeup;
     if (ret)
@@ -82,17 +82,11 @@ shaper_soonest_event(struct timeval *tv, int delay)
     return ret;
 }
 
-void
-shaper_reset_wakeup(struct shaper *s)
-{
-    CLEAR(s->wakeup);
-}
-
 void
 shaper_msg(struct shaper *s)
 {
-    msg(M_INFO, "Output Traffic Shaping initialized at %d bytes per second",
-        s->bytes_per_second);
+    msg(M_INFO, "Output Traffic Shaping initialized at %d bytes per second (burst %d bytes)",
+        s->bytes_per_second, s->burst);
 }
 
 #else  /* ifdef ENABLE_FEATURE_SHAPER */
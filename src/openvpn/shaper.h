@@ -35,8 +35,12 @@
 #include "interval.h"
 
 /*
- * A simple traffic shaper for
- * the output direction.
+ * A token-bucket traffic shaper for the output direction.
+ *
+ * Buckets may be chained via the parent pointer into a hierarchy
+ * (e.g. per-client -> global); a packet must find credit in every
+ * bucket along the chain.  A bucket with bytes_per_second == 0 is
+ * undefined and transparent to the chain.
  */
 
 #define SHAPER_MIN 100          /* bytes per second */
@@ -44,24 +48,25 @@
 
 #define SHAPER_MAX_TIMEOUT 10   /* seconds */
 
-#define SHAPER_USE_FP
+/* bucket capacity when no explicit burst size is configured: 100 ms
+ * worth of traffic, within the bounds below */
+#define SHAPER_BURST_MIN 16384
+#define SHAPER_BURST_MAX (16*1024*1024)
 
 struct shaper
 {
     int bytes_per_second;
-    struct timeval wakeup;
-
-#ifdef SHAPER_USE_FP
-    double factor;
-#else
-    int factor;
-#endif
+    int burst;                  /* bucket capacity in bytes */
+    int64_t tokens;             /* current credit; negative = debt */
+    struct timeval last_fill;
+    struct shaper *parent;      /* next bucket up the hierarchy, or NULL */
+    bool kernel_paced;          /* rate enforced by the kernel via
+                                 * SO_MAX_PACING_RATE; bucket is
+                                 * transparent to the chain */
 };
 
 void shaper_msg(struct shaper *s);
 
-void shaper_reset_wakeup(struct shaper *s);
-
 /*
  * We want to wake up in delay microseconds.  If timeval is larger
  * than delay, set timeval to delay.
@@ -77,18 +82,42 @@ shaper_reset(struct shaper *s, int bytes_per_second)
 {
     s->bytes_per_second = constrain_int(bytes_per_second, SHAPER_MIN, SHAPER_MAX);
 
-#ifdef SHAPER_USE_FP
-    s->factor = 1000000.0 / (double)s->bytes_per_second;
-#else
-    s->factor = 1000000 / s->bytes_per_second;
-#endif
+    if (!s->burst)
+    {
+        s->burst = constrain_int(s->bytes_per_second / 10,
+                                 SHAPER_BURST_MIN, SHAPER_BURST_MAX);
+    }
+    if (s->tokens > s->burst)
+    {
+        s->tokens = s->burst;
+    }
+}
+
+/*
+ * Override the default bucket capacity.  Call after shaper_init.
+ */
+static inline void
+shaper_set_burst(struct shaper *s, int burst)
+{
+    if (burst > 0)
+    {
+        s->burst = burst;
+        if (s->tokens > s->burst)
+        {
+            s->tokens = s->burst;
+        }
+    }
 }
 
 static inline void
 shaper_init(struct shaper *s, int bytes_per_second)
 {
+    struct shaper *parent = s->parent;
+
+    CLEAR(*s);
+    s->parent = parent;
     shaper_reset(s, bytes_per_second);
-    shaper_reset_wakeup(s);
+    s->tokens = s->burst;       /* start with a full bucket */
 }
 
 static inline int
@@ -97,81 +126,124 @@ shaper_current_bandwidth(struct shaper *s)
     return s->bytes_per_second;
 }
 
+/*
+ * Credit the bucket with tokens accumulated since the last fill.
+ * last_fill only advances when at least one whole token accrued, so
+ * sub-token intervals are not lost to integer truncation.
+ */
+static inline void
+shaper_refill(struct shaper *s)
+{
+    struct timeval now;
+
+    ASSERT(!openvpn_gettimeofday_coarse(&now));
+    if (tv_defined(&s->last_fill))
+    {
+        const int elapsed = tv_subtract(&now, &s->last_fill, SHAPER_MAX_TIMEOUT);
+        if (elapsed > 0)
+        {
+            const int64_t credit = (int64_t)elapsed * s->bytes_per_second / 1000000;
+            if (credit > 0)
+            {
+                s->tokens = min_int64(s->tokens + credit, s->burst);
+                s->last_fill = now;
+            }
+        }
+    }
+    else
+    {
+        s->tokens = s->burst;
+        s->last_fill = now;
+    }
+}
+
 /*
  * Returns traffic shaping delay in microseconds relative to current
- * time, or 0 if no delay.
+ * time, or 0 if no bucket in the hierarchy is in debt.
  */
 static inline int
 shaper_delay(struct shaper *s)
 {
-    struct timeval tv;
     int delay = 0;
 
-    if (tv_defined(&s->wakeup))
+    for (; s; s = s->parent)
     {
-        ASSERT(!openvpn_gettimeofday(&tv, NULL));
-        delay = tv_subtract(&s->wakeup, &tv, SHAPER_MAX_TIMEOUT);
+        if (!s->bytes_per_second || s->kernel_paced)
+        {
+            continue;
+        }
+        shaper_refill(s);
+        if (s->tokens < 0)
+        {
+            const int64_t d = -s->tokens * 1000000 / s->bytes_per_second;
+            delay = max_int(delay, (int)min_int64(d, SHAPER_MAX_TIMEOUT*1000000));
+        }
+    }
 #ifdef SHAPER_DEBUG
-        dmsg(D_SHAPER_DEBUG, "SHAPER shaper_delay delay=%d", delay);
+    dmsg(D_SHAPER_DEBUG, "SHAPER shaper_delay delay=%d", delay);
 #endif
-    }
 
-    return delay > 0 ? delay : 0;
+    return delay;
 }
 
 
 /*
- * We are about to send a datagram of nbytes bytes.
- *
- * Compute when we can send another datagram,
- * based on target throughput (s->bytes_per_second).
+ * We just sent a datagram of nbytes bytes.  Charge every bucket in
+ * the hierarchy; buckets may go into debt, which shaper_delay turns
+ * into a wakeup time.
  */
 static inline void
 shaper_wrote_bytes(struct shaper *s, int nbytes)
 {
-    struct timeval tv;
-
-    /* compute delay in microseconds */
-    tv.tv_sec = 0;
-#ifdef SHAPER_USE_FP
-    tv.tv_usec = min_int((int)((double)max_int(nbytes, 100) * s->factor), (SHAPER_MAX_TIMEOUT*1000000));
-#else
-    tv.tv_usec = s->bytes_per_second
-                 ? min_int(max_int(nbytes, 100) * s->factor, (SHAPER_MAX_TIMEOUT*1000000))
-                 : 0;
-#endif
-
-    if (tv.tv_usec)
+    for (; s; s = s->parent)
     {
-        ASSERT(!openvpn_gettimeofday(&s->wakeup, NULL));
-        tv_add(&s->wakeup, &tv);
+        if (!s->bytes_per_second || s->kernel_paced)
+        {
+            continue;
+        }
+        shaper_refill(s);
+        s->tokens -= max_int(nbytes, 100);
 
 #ifdef SHAPER_DEBUG
-        dmsg(D_SHAPER_DEBUG, "SHAPER shaper_wrote_bytes bytes=%d delay=%ld sec=%" PRIi64 " usec=%ld",
-             nbytes,
-             (long)tv.tv_usec,
-             (int64_t)s->wakeup.tv_sec,
-             (long)s->wakeup.tv_usec);
+        dmsg(D_SHAPER_DEBUG, "SHAPER shaper_wrote_bytes bytes=%d tokens=%" PRIi64,
+             nbytes, s->tokens);
 #endif
     }
 }
 
-#if 0
 /*
- * Increase/Decrease bandwidth by a percentage.
- *
- * Return true if bandwidth changed.
+ * Policing mode: try to take nbytes from every bucket in the
+ * hierarchy.  Returns false -- without charging any bucket -- if one
+ * of them lacks the credit; the caller is expected to drop the
+ * packet.  Used on the server, where instances have no per-context
+ * event-loop wakeup to pace against.
  */
 static inline bool
-shaper_change_pct(struct shaper *s, int pct)
+shaper_reserve(struct shaper *s, int nbytes)
 {
-    const int orig_bandwidth = s->bytes_per_second;
-    const int new_bandwidth = orig_bandwidth + (orig_bandwidth * pct / 100);
-    ASSERT(s->bytes_per_second);
-    shaper_reset(s, new_bandwidth);
-    return s->bytes_per_second != orig_bandwidth;
+    struct shaper *b;
+
+    for (b = s; b; b = b->parent)
+    {
+        if (!b->bytes_per_second || b->kernel_paced)
+        {
+            continue;
+        }
+        shaper_refill(b);
+        if (b->tokens < nbytes)
+        {
+            return false;
+        }
+    }
+    for (b = s; b; b = b->parent)
+    {
+        if (b->bytes_per_second && !b->kernel_paced)
+        {
+            b->tokens -= nbytes;
+        }
+    }
+    return true;
 }
-#endif
 
 #endif /* ENABLE_FEATURE_SHAPER */
 
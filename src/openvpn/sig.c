@@ -36,6 +36,7 @@
 #include "status.h"
 #include "sig.h"
 #include "occ.h"
+#include "forward.h"
 #include "manage.h"
 #include "openvpn.h"
 
@@ -314,6 +315,36 @@ print_status(const struct context *c, struct status_output *so)
     status_printf(so, "Pre-encrypt truncations," counter_format, c->c2.n_trunc_pre_encrypt);
     status_printf(so, "Post-decrypt truncations," counter_format, c->c2.n_trunc_post_decrypt);
 #endif
+    {
+        const struct packet_id_rec_stats *rs = NULL;
+        if (c->c2.tls_multi)
+        {
+            rs = &c->c2.tls_multi->replay_stats;
+        }
+        else if (packet_id_initialized(&c->c2.crypto_options.packet_id))
+        {
+            rs = &c->c2.crypto_options.packet_id.rec.stats;
+        }
+        if (rs)
+        {
+            status_printf(so, "Replay drops," counter_format, rs->n_replay);
+            status_printf(so, "Out-of-window drops," counter_format, rs->n_out_of_window);
+            status_printf(so, "Replay time drops," counter_format, rs->n_time_backtrack);
+            status_printf(so, "Max reorder depth,%d", rs->max_reorder);
+        }
+    }
+#if EXTENDED_SOCKET_ERROR_CAPABILITY
+    if (c->c2.link_socket && c->c2.link_socket->errq_unreachable)
+    {
+        status_printf(so, "ICMP unreachable," counter_format,
+                      c->c2.link_socket->errq_unreachable);
+    }
+#endif
+    if (c->c2.pq)
+    {
+        status_printf(so, "Priority queue drops," counter_format,
+                      c->c2.pq->n_dropped);
+    }
 #ifdef _WIN32
     if (tuntap_defined(c->c1.tuntap))
     {
@@ -322,6 +353,13 @@ print_status(const struct context *c, struct status_output *so)
         {
             status_printf(so, "TAP-WIN32 driver status,\"%s\"", extended_msg);
         }
+        if (tuntap_is_wintun(c->c1.tuntap))
+        {
+            status_printf(so, "Wintun send ring empty waits," counter_format,
+                          c->c1.tuntap->wintun_ring_empty);
+            status_printf(so, "Wintun receive ring full drops," counter_format,
+                          c->c1.tuntap->wintun_ring_full);
+        }
     }
 #endif
 
@@ -42,8 +42,16 @@
 #include "openvpn.h"
 #include "forward.h"
 
+#ifdef TARGET_LINUX
+#include <linux/filter.h>
+#endif
+
 #include "memdbg.h"
 
+#ifdef ENABLE_UDP_MMSG
+static void udp_mmsg_free(struct udp_mmsg *um);
+#endif
+
 const int proto_overhead[] = { /* indexed by PROTO_x */
     0,
     IPv4_UDP_HEADER_SIZE, /* IPv4 */
@@ -250,6 +258,12 @@ streqnull(const char *a, const char *b)
     }
 }
 
+/* How long a preresolved name is served before it is looked up again.
+ * getaddrinfo() does not expose the real record TTL, so refresh on a
+ * conservative fixed interval instead of pinning the first answer for
+ * the lifetime of the process. */
+#define DNS_CACHE_TTL 300
+
 /*
  * get_cached_dns_entry return 0 on success and -1
  * otherwise. (like getaddrinfo)
@@ -275,6 +289,33 @@ get_cached_dns_entry(struct cached_dns_entry *dns_cache,
             && ph->ai_family == ai_family
             && ph->flags == flags)
         {
+            if (ph->expiry && now >= ph->expiry)
+            {
+                /* entry expired -- try one fresh lookup, but keep
+                 * serving the stale addresses if it fails: a stale
+                 * answer still beats no answer during a DNS outage.
+                 * The previous chain may be referenced by an open link
+                 * socket, so it stays registered in the owning arena
+                 * instead of being freed here. */
+                const unsigned int refresh_flags =
+                    (resolve_flags & GETADDR_CACHE_MASK)
+                    | GETADDR_RESOLVE | GETADDR_TRY_ONCE;
+                struct addrinfo *fresh = NULL;
+
+                if (openvpn_getaddrinfo(refresh_flags, hostname, servname,
+                                        0, NULL, ai_family, &fresh) == 0)
+                {
+                    gc_addspecial(fresh, &gc_freeaddrinfo_callback, ph->gc);
+                    ph->ai = fresh;
+                }
+                else
+                {
+                    msg(D_RESOLVE_ERRORS,
+                        "RESOLVE: refresh of cached entry for %s failed, "
+                        "using previous addresses", np(hostname));
+                }
+                ph->expiry = now + DNS_CACHE_TTL;
+            }
             *ai = ph->ai;
             return 0;
         }
@@ -316,6 +357,8 @@ do_preresolve_host(struct context *c,
         ph->hostname = hostname;
         ph->servname = servname;
         ph->flags = flags & GETADDR_CACHE_MASK;
+        ph->expiry = now + DNS_CACHE_TTL;
+        ph->gc = &c->gc;
 
         if (!c->c1.dns_cache)
         {
@@ -337,96 +380,121 @@ do_preresolve_host(struct context *c,
     return status;
 }
 
-void
-do_preresolve(struct context *c)
+static int
+do_preresolve_connection_entry(struct context *c,
+                               const struct connection_entry *ce,
+                               const unsigned int base_flags)
 {
-    int i;
-    struct connection_list *l = c->options.connection_list;
-    const unsigned int preresolve_flags = GETADDR_RESOLVE
-                                          |GETADDR_UPDATE_MANAGEMENT_STATE
-                                          |GETADDR_MENTION_RESOLVE_RETRY
-                                          |GETADDR_FATAL;
+    int status;
+    const char *remote;
+    int flags = base_flags;
 
+    if (proto_is_dgram(ce->proto))
+    {
+        flags |= GETADDR_DATAGRAM;
+    }
 
-    for (i = 0; i < l->len; ++i)
+    if (c->options.sockflags & SF_HOST_RANDOMIZE)
     {
-        int status;
-        const char *remote;
-        int flags = preresolve_flags;
+        flags |= GETADDR_RANDOMIZE;
+    }
 
-        struct connection_entry *ce = c->options.connection_list->array[i];
+    if (c->options.ip_remote_hint)
+    {
+        remote = c->options.ip_remote_hint;
+    }
+    else
+    {
+        remote = ce->remote;
+    }
 
-        if (proto_is_dgram(ce->proto))
+    /* HTTP remote hostname does not need to be resolved */
+    if (!ce->http_proxy_options)
+    {
+        status = do_preresolve_host(c, remote, ce->remote_port,
+                                    ce->af, flags);
+        if (status != 0)
         {
-            flags |= GETADDR_DATAGRAM;
+            return status;
         }
+    }
 
-        if (c->options.sockflags & SF_HOST_RANDOMIZE)
-        {
-            flags |= GETADDR_RANDOMIZE;
-        }
+    /* Preresolve proxy */
+    if (ce->http_proxy_options)
+    {
+        status = do_preresolve_host(c,
+                                    ce->http_proxy_options->server,
+                                    ce->http_proxy_options->port,
+                                    ce->af,
+                                    base_flags);
 
-        if (c->options.ip_remote_hint)
+        if (status != 0)
         {
-            remote = c->options.ip_remote_hint;
+            return status;
         }
-        else
+    }
+
+    if (ce->socks_proxy_server)
+    {
+        status = do_preresolve_host(c,
+                                    ce->socks_proxy_server,
+                                    ce->socks_proxy_port,
+                                    ce->af,
+                                    flags);
+        if (status != 0)
         {
-            remote = ce->remote;
+            return status;
         }
+    }
 
-        /* HTTP remote hostname does not need to be resolved */
-        if (!ce->http_proxy_options)
+    if (ce->bind_local)
+    {
+        flags |= GETADDR_PASSIVE;
+        flags &= ~GETADDR_RANDOMIZE;
+        status = do_preresolve_host(c, ce->local, ce->local_port,
+                                    ce->af, flags);
+        if (status != 0)
         {
-            status = do_preresolve_host(c, remote, ce->remote_port,
-                                        ce->af, flags);
-            if (status != 0)
-            {
-                goto err;
-            }
+            return status;
         }
 
-        /* Preresolve proxy */
-        if (ce->http_proxy_options)
-        {
-            status = do_preresolve_host(c,
-                                        ce->http_proxy_options->server,
-                                        ce->http_proxy_options->port,
-                                        ce->af,
-                                        preresolve_flags);
+    }
+    return 0;
+}
 
-            if (status != 0)
-            {
-                goto err;
-            }
-        }
+void
+do_preresolve(struct context *c)
+{
+    int i;
+    struct connection_list *l = c->options.connection_list;
+    const unsigned int preresolve_flags = GETADDR_RESOLVE
+                                          |GETADDR_UPDATE_MANAGEMENT_STATE
+                                          |GETADDR_MENTION_RESOLVE_RETRY
+                                          |GETADDR_FATAL;
 
-        if (ce->socks_proxy_server)
+    /*
+     * First sweep every connection profile once without the fatal/retry
+     * machinery, so that one dead name cannot serially stall resolution
+     * of the remaining failover candidates, then apply the configured
+     * retry policy only to the names still missing from the cache.
+     */
+    for (i = 0; i < l->len; ++i)
+    {
+        do_preresolve_connection_entry(c, l->array[i],
+                                       (preresolve_flags & ~GETADDR_FATAL)
+                                       | GETADDR_TRY_ONCE);
+        if (IS_SIG(c))
         {
-            status = do_preresolve_host(c,
-                                        ce->socks_proxy_server,
-                                        ce->socks_proxy_port,
-                                        ce->af,
-                                        flags);
-            if (status != 0)
-            {
-                goto err;
-            }
+            return;
         }
+    }
 
-        if (ce->bind_local)
+    for (i = 0; i < l->len; ++i)
+    {
+        if (do_preresolve_connection_entry(c, l->array[i], preresolve_flags) != 0)
         {
-            flags |= GETADDR_PASSIVE;
-            flags &= ~GETADDR_RANDOMIZE;
-            status = do_preresolve_host(c, ce->local, ce->local_port,
-                                        ce->af, flags);
-            if (status != 0)
-            {
-                goto err;
-            }
-
+            goto err;
         }
-
     }
     return;
 
@@ -908,8 +976,12 @@ socket_set_buffers(int fd, const struct socket_buffer_size *sbs)
 {
     if (sbs)
     {
-        const int sndbuf_old = socket_get_sndbuf(fd);
-        const int rcvbuf_old = socket_get_rcvbuf(fd);
+        /* the before/after getsockopt() reads exist only for the debug
+         * line below; don't pay four syscalls per (re)connect for a
+         * message that would be dropped anyway */
+        const bool report = check_debug_level(D_OSBUF);
+        const int sndbuf_old = report ? socket_get_sndbuf(fd) : 0;
+        const int rcvbuf_old = report ? socket_get_rcvbuf(fd) : 0;
 
         if (sbs->sndbuf)
         {
@@ -921,14 +993,74 @@ socket_set_buffers(int fd, const struct socket_buffer_size *sbs)
             socket_set_rcvbuf(fd, sbs->rcvbuf);
         }
 
-        msg(D_OSBUF, "Socket Buffers: R=[%d->%d] S=[%d->%d]",
-            rcvbuf_old,
-            socket_get_rcvbuf(fd),
-            sndbuf_old,
-            socket_get_sndbuf(fd));
+        if (report)
+        {
+            msg(D_OSBUF, "Socket Buffers: R=[%d->%d] S=[%d->%d]",
+                rcvbuf_old,
+                socket_get_rcvbuf(fd),
+                sndbuf_old,
+                socket_get_sndbuf(fd));
+        }
+    }
+}
+
+#ifdef TARGET_LINUX
+
+/* socket option values are kernel ABI (asm/socket.h, linux/sock_diag.h) */
+#ifndef SO_MEMINFO
+#define SO_MEMINFO 55
+#endif
+#define SK_MEMINFO_DROPS_IDX 8
+#define SK_MEMINFO_NVARS 9
+
+/* how often to sample the kernel drop counter, in seconds */
+#define SOCKET_RX_DROP_CHECK_SECONDS 2
+
+/* ceiling for automatic receive-buffer growth */
+#define SOCKET_RCVBUF_AUTO_MAX (8 * 1024 * 1024)
+
+/*
+ * Periodically sample the socket's drop counter and double the receive
+ * buffer when the kernel reports packets lost to rcvbuf overflow.
+ * Only active when --rcvbuf was not given, so explicit tuning wins.
+ */
+static void
+link_socket_rcvbuf_adjust(struct link_socket *sock)
+{
+    uint32_t mem[SK_MEMINFO_NVARS];
+    socklen_t len = sizeof(mem);
+
+    sock->rx_drops_check = now + SOCKET_RX_DROP_CHECK_SECONDS;
+
+    if (getsockopt(sock->sd, SOL_SOCKET, SO_MEMINFO, mem, &len) != 0
+        || len < sizeof(mem))
+    {
+        /* no kernel support; never sample again */
+        sock->rx_drops_check = 0x7fffffff;
+        return;
+    }
+
+    if (mem[SK_MEMINFO_DROPS_IDX] != sock->rx_drops_last)
+    {
+        const uint32_t dropped = mem[SK_MEMINFO_DROPS_IDX] - sock->rx_drops_last;
+        sock->rx_drops_last = mem[SK_MEMINFO_DROPS_IDX];
+        if (!sock->socket_buffer_sizes.rcvbuf)
+        {
+            const int rcvbuf = socket_get_rcvbuf(sock->sd);
+            if (rcvbuf > 0 && rcvbuf < SOCKET_RCVBUF_AUTO_MAX
+                && socket_set_rcvbuf(sock->sd, rcvbuf))
+            {
+                /* setting the getsockopt() value doubles the effective
+                 * size, since the kernel reports it with overhead */
+                msg(D_OSBUF, "Socket Buffers: %u packet(s) dropped, rcvbuf grown %d -> %d",
+                    (unsigned int)dropped, rcvbuf, socket_get_rcvbuf(sock->sd));
+            }
+        }
     }
 }
 
+#endif /* ifdef TARGET_LINUX */
+
 /*
  * Set other socket options
  */
@@ -953,6 +1085,132 @@ socket_set_tcp_nodelay(int sd, int state)
 #endif
 }
 
+/*
+ * Default unsent low-water mark for TCP links.  Keeping the unsent
+ * backlog small bounds bufferbloat on the link and moves queueing
+ * back into our own deferred output queue, where stale packets can
+ * at least be counted and dropped.
+ */
+#define SOCKET_TCP_NOTSENT_LOWAT_DEFAULT (16 * 1024)
+
+static void
+socket_set_tcp_notsent_lowat(int sd, int bytes)
+{
+#if defined(HAVE_SETSOCKOPT) && defined(IPPROTO_TCP) && defined(TCP_NOTSENT_LOWAT)
+    /* kernel support does not change at runtime; remember a rejection
+     * so reconnect retries do not repeat a known-failing syscall */
+    static bool unsupported; /* GLOBAL */
+
+    if (unsupported)
+    {
+        return;
+    }
+    if (setsockopt(sd, IPPROTO_TCP, TCP_NOTSENT_LOWAT, (void *) &bytes, sizeof(bytes)) != 0)
+    {
+        if (errno == ENOPROTOOPT || errno == EINVAL)
+        {
+            unsupported = true;
+        }
+        dmsg(D_OSBUF, "NOTE: setsockopt TCP_NOTSENT_LOWAT=%d failed", bytes);
+    }
+    else
+    {
+        dmsg(D_OSBUF, "Socket flags: TCP_NOTSENT_LOWAT=%d succeeded", bytes);
+    }
+#endif
+}
+
+/*
+ * Offload output rate limiting to the kernel (fq qdisc / sch_fq
+ * pacing).  Returns true if the kernel accepted the rate, in which
+ * case the userspace shaper can stand aside.
+ */
+bool
+socket_set_pacing_rate(socket_descriptor_t sd, int bytes_per_second)
+{
+#if defined(HAVE_SETSOCKOPT) && defined(SO_MAX_PACING_RATE)
+    /* as with TCP_NOTSENT_LOWAT, cache a kernel-level rejection so the
+     * shaper does not retry the syscall on every rate change */
+    static bool unsupported; /* GLOBAL */
+    const uint32_t rate = (uint32_t)bytes_per_second;
+
+    if (unsupported)
+    {
+        return false;
+    }
+    if (setsockopt(sd, SOL_SOCKET, SO_MAX_PACING_RATE, (void *) &rate, sizeof(rate)) == 0)
+    {
+        dmsg(D_OSBUF, "Socket flags: SO_MAX_PACING_RATE=%u succeeded", (unsigned int)rate);
+        return true;
+    }
+    if (errno == ENOPROTOOPT || errno == EINVAL)
+    {
+        unsupported = true;
+    }
+    dmsg(D_OSBUF, "NOTE: setsockopt SO_MAX_PACING_RATE=%u failed", (unsigned int)rate);
+    return false;
+#else
+    return false;
+#endif
+}
+
+/*
+ * Attach a classic BPF filter to the UDP server socket that discards
+ * packets which cannot possibly be valid OpenVPN before they are queued
+ * to the socket: a flood of random datagrams is then dropped in the
+ * kernel instead of costing one recvfrom() wakeup each, and only frames
+ * that could pass the tls_pre_decrypt_lite() cookie check ever reach
+ * userspace.
+ *
+ * For a UDP socket the filter sees the UDP header followed by the
+ * payload.  We require a plausible opcode in the first payload byte and
+ * the minimum control channel envelope (opcode + session id + ack count
+ * + packet id) for control opcodes; data channel opcodes only need to
+ * be non-empty, since their length depends on the cipher.
+ */
+bool
+socket_set_udp_prefilter(socket_descriptor_t sd)
+{
+#if defined(TARGET_LINUX) && defined(SO_ATTACH_FILTER)
+    /* 1 (opcode) + 8 (session id) + 1 (ack count) + 4 (packet id) */
+    const int min_control = 14;
+    struct sock_filter flt[] = {
+        /* A = UDP length field = 8 + payload length */
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 4),
+        /* empty payload -> drop */
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 8 + 1, 0, 9),
+        /* A = opcode from the first payload byte */
+        BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 8),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, P_OPCODE_SHIFT),
+        /* opcode 0 or beyond the protocol -> drop */
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0, 6, 0),
+        BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, P_LAST_OPCODE, 5, 0),
+        /* data channel packets have no fixed minimum beyond the opcode */
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, P_DATA_V1, 3, 0),
+        BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, P_DATA_V2, 2, 0),
+        /* control channel packets must carry the full envelope */
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 4),
+        BPF_JUMP(BPF_JMP | BPF_JGE | BPF_K, 8 + min_control, 0, 1),
+        BPF_STMT(BPF_RET | BPF_K, 0xffffffff), /* accept */
+        BPF_STMT(BPF_RET | BPF_K, 0),          /* drop */
+    };
+    struct sock_fprog prog = {
+        .len = SIZE(flt),
+        .filter = flt,
+    };
+
+    if (setsockopt(sd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog)) == 0)
+    {
+        dmsg(D_OSBUF, "Socket flags: SO_ATTACH_FILTER (UDP prefilter) succeeded");
+        return true;
+    }
+    msg(M_WARN | M_ERRNO, "NOTE: setsockopt SO_ATTACH_FILTER failed");
+    return false;
+#else  /* if defined(TARGET_LINUX) && defined(SO_ATTACH_FILTER) */
+    return false;
+#endif
+}
+
 static inline void
 socket_set_mark(int sd, int mark)
 {
@@ -1102,20 +1360,73 @@ bind_local(struct link_socket *sock, const sa_family_t ai_family)
         if (sock->socks_proxy && sock->info.proto == PROTO_UDP)
         {
             socket_bind(sock->ctrl_sd, sock->info.lsa->bind_local,
-                        ai_family, "SOCKS", false);
+                        ai_family, "SOCKS", false, sock->sockflags);
         }
         else
         {
             socket_bind(sock->sd, sock->info.lsa->bind_local,
                         ai_family,
-                        "TCP/UDP", sock->info.bind_ipv6_only);
+                        "TCP/UDP", sock->info.bind_ipv6_only, sock->sockflags);
         }
     }
 }
 
+/*
+ * Check that an inherited descriptor really is a socket of the family
+ * and type we are about to create, so a misconfigured --inherit-link-fd
+ * falls back to a fresh socket instead of sending VPN traffic down an
+ * arbitrary fd.
+ */
+static bool
+inherited_socket_matches(socket_descriptor_t sd, const struct addrinfo *addr)
+{
+    int type = 0;
+    socklen_t typelen = sizeof(type);
+    struct sockaddr_storage bound;
+    socklen_t boundlen = sizeof(bound);
+
+    if (getsockopt(sd, SOL_SOCKET, SO_TYPE, (void *)&type, &typelen)
+        || type != addr->ai_socktype)
+    {
+        return false;
+    }
+    if (getsockname(sd, (struct sockaddr *)&bound, &boundlen)
+        || bound.ss_family != addr->ai_family)
+    {
+        return false;
+    }
+    return true;
+}
+
 static void
 create_socket(struct link_socket *sock, struct addrinfo *addr)
 {
+    /* adopt a socket inherited across exec instead of rebinding */
+    if (socket_defined(inherited_link_socket_descriptor)
+        && !sock->http_proxy && !sock->socks_proxy)
+    {
+        socket_descriptor_t sd = inherited_link_socket_descriptor;
+        inherited_link_socket_descriptor = SOCKET_UNDEFINED; /* single use */
+
+        if (inherited_socket_matches(sd, addr))
+        {
+            msg(M_INFO, "Using inherited link socket fd %d", (int)sd);
+            sock->sd = sd;
+            if (addr->ai_socktype == SOCK_DGRAM)
+            {
+                sock->sockflags |= SF_GETADDRINFO_DGRAM;
+            }
+            set_cloexec(sock->sd);
+            socket_set_buffers(sock->sd, &sock->socket_buffer_sizes);
+            socket_set_mark(sock->sd, sock->mark);
+            /* the inherited socket is already bound */
+            return;
+        }
+        msg(M_WARN, "Inherited link socket fd %d does not match the configured"
+            " address family or protocol -- creating a new socket", (int)sd);
+        openvpn_close_socket(sd);
+    }
+
     if (addr->ai_protocol == IPPROTO_UDP || addr->ai_socktype == SOCK_DGRAM)
     {
         sock->sd = create_socket_udp(addr, sock->sockflags);
@@ -1201,6 +1512,19 @@ socket_do_listen(socket_descriptor_t sd,
         {
             msg(M_ERR, "TCP: listen() failed");
         }
+#if defined(TARGET_LINUX) && defined(TCP_DEFER_ACCEPT)
+        /* only wake the accept loop once the client has sent data (i.e.
+         * its TLS ClientHello), so idle connects and SYN scans never
+         * reach userspace; failure is harmless, accept just fires earlier */
+        {
+            int timeout = 30;
+            if (setsockopt(sd, IPPROTO_TCP, TCP_DEFER_ACCEPT,
+                           (void *) &timeout, sizeof(timeout)))
+            {
+                msg(M_WARN | M_ERRNO, "NOTE: setsockopt TCP_DEFER_ACCEPT failed");
+            }
+        }
+#endif
     }
 
     /* set socket to non-blocking mode */
@@ -1398,7 +1722,8 @@ socket_bind(socket_descriptor_t sd,
             struct addrinfo *local,
             int ai_family,
             const char *prefix,
-            bool ipv6only)
+            bool ipv6only,
+            unsigned int sockflags)
 {
     struct gc_arena gc = gc_new();
 
@@ -1438,6 +1763,18 @@ socket_bind(socket_descriptor_t sd,
             msg(M_NONFATAL|M_ERRNO, "Setting IPV6_V6ONLY=%d failed", v6only);
         }
     }
+#if defined(SO_REUSEPORT)
+    if (sockflags & SF_REUSEPORT)
+    {
+        int on = 1;
+
+        if (setsockopt(sd, SOL_SOCKET, SO_REUSEPORT,
+                       (void *) &on, sizeof(on)) < 0)
+        {
+            msg(M_ERR, "%s: Cannot setsockopt SO_REUSEPORT on socket", prefix);
+        }
+    }
+#endif
     if (bind(sd, cur->ai_addr, cur->ai_addrlen))
     {
         msg(M_FATAL | M_ERRNO, "%s: Socket bind failed on local address %s",
@@ -1634,60 +1971,298 @@ done:
     gc_free(&gc);
 }
 
+#ifdef CONNECT_NONBLOCK
+
 /*
- * Stream buffer handling prototypes -- stream_buf is a helper class
- * to assist in the packetization of stream transport protocols
- * such as TCP.
+ * Happy-eyeballs-style connect: race non-blocking connects to all
+ * resolved addresses of the current remote and keep the first one that
+ * completes, so a single unreachable address cannot consume the whole
+ * connect timeout before the next candidate is ever tried.  The caller
+ * guarantees at least two candidate addresses and no local bind (the
+ * extra sockets would collide on the local port).
  */
+#define CONNECT_RACE_MAX 4
 
 static void
-stream_buf_init(struct stream_buf *sb, struct buffer *buf,
-                const unsigned int sockflags, const int proto);
-
-static void
-stream_buf_close(struct stream_buf *sb);
+socket_connect_race(struct link_socket *sock,
+                    int connect_timeout,
+                    struct signal_info *sig_info)
+{
+    struct gc_arena gc = gc_new();
+    struct link_socket_addr *lsa = sock->info.lsa;
+    struct addrinfo *ai[CONNECT_RACE_MAX];
+    socket_descriptor_t sd[CONNECT_RACE_MAX];
+    struct addrinfo *cur;
+    int n = 0;
+    int pending = 0;
+    int winner = -1;
+    int i;
 
-static bool
-stream_buf_added(struct stream_buf *sb, int length_added);
+    for (cur = lsa->current_remote; cur && n < CONNECT_RACE_MAX; cur = cur->ai_next)
+    {
+        ai[n++] = cur;
+    }
+    ASSERT(n >= 2);
 
-/* For stream protocols, allocate a buffer to build up packet.
- * Called after frame has been finalized. */
+    msg(M_INFO, "Attempting to establish TCP connection with %s "
+        "[racing %d candidate addresses]",
+        print_sockaddr(ai[0]->ai_addr, &gc), n);
 
-static void
-socket_frame_init(const struct frame *frame, struct link_socket *sock)
-{
-#ifdef _WIN32
-    overlapped_io_init(&sock->reads, frame, FALSE, false);
-    overlapped_io_init(&sock->writes, frame, TRUE, false);
-    sock->rw_handle.read = sock->reads.overlapped.hEvent;
-    sock->rw_handle.write = sock->writes.overlapped.hEvent;
+#ifdef ENABLE_MANAGEMENT
+    if (management)
+    {
+        management_set_state(management,
+                             OPENVPN_STATE_TCP_CONNECT,
+                             NULL,
+                             NULL,
+                             NULL,
+                             NULL,
+                             NULL);
+    }
 #endif
 
-    if (link_socket_connection_oriented(sock))
+    for (i = 0; i < n; ++i)
     {
-#ifdef _WIN32
-        stream_buf_init(&sock->stream_buf,
-                        &sock->reads.buf_init,
-                        sock->sockflags,
-                        sock->info.proto);
-#else
-        alloc_buf_sock_tun(&sock->stream_buf_data,
-                           frame,
-                           false,
-                           FRAME_HEADROOM_MARKER_READ_STREAM);
+        int status;
 
-        stream_buf_init(&sock->stream_buf,
-                        &sock->stream_buf_data,
-                        sock->sockflags,
-                        sock->info.proto);
+        if (i == 0)
+        {
+            sd[i] = sock->sd;
+            sock->sd = SOCKET_UNDEFINED;
+        }
+        else
+        {
+            sd[i] = create_socket_tcp(ai[i]);
+            socket_set_buffers(sd[i], &sock->socket_buffer_sizes);
+            socket_set_mark(sd[i], sock->mark);
+        }
+#ifdef TARGET_ANDROID
+        protect_fd_nonlocal(sd[i], ai[i]->ai_addr);
 #endif
-    }
-}
+        set_nonblock(sd[i]);
 
-/*
- * Adjust frame structure based on a Path MTU value given
- * to us by the OS.
- */
+        status = connect(sd[i], ai[i]->ai_addr,
+                         af_addr_size(ai[i]->ai_addr->sa_family));
+        if (status == 0)
+        {
+            winner = i;
+            goto done;
+        }
+        status = openvpn_errno();
+#ifdef _WIN32
+        if (status == WSAEWOULDBLOCK)
+#else
+        if (status == EINPROGRESS)
+#endif
+        {
+            ++pending;
+        }
+        else
+        {
+            msg(D_LINK_ERRORS, "TCP: connect to %s failed: %s",
+                print_sockaddr(ai[i]->ai_addr, &gc), strerror(status));
+            openvpn_close_socket(sd[i]);
+            sd[i] = SOCKET_UNDEFINED;
+        }
+    }
+
+    while (pending > 0)
+    {
+        int status;
+
+#if POLL
+        struct pollfd fds[CONNECT_RACE_MAX];
+        int nfds = 0;
+
+        for (i = 0; i < n; ++i)
+        {
+            if (socket_defined(sd[i]))
+            {
+                fds[nfds].fd = sd[i];
+                fds[nfds].events = POLLOUT;
+                ++nfds;
+            }
+        }
+        status = poll(fds, nfds, (connect_timeout > 0) ? 1000 : 0);
+#else
+        fd_set writes;
+        struct timeval tv;
+        socket_descriptor_t maxsd = 0;
+
+        FD_ZERO(&writes);
+        for (i = 0; i < n; ++i)
+        {
+            if (socket_defined(sd[i]))
+            {
+                openvpn_fd_set(sd[i], &writes);
+                maxsd = max_int(maxsd, sd[i]);
+            }
+        }
+        tv.tv_sec = (connect_timeout > 0) ? 1 : 0;
+        tv.tv_usec = 0;
+
+        status = select(maxsd + 1, NULL, &writes, NULL, &tv);
+#endif
+        get_signal(&sig_info->signal_received);
+        if (sig_info->signal_received)
+        {
+            goto done;
+        }
+        if (status < 0)
+        {
+            msg(D_LINK_ERRORS, "TCP: connect wait failed: %s",
+                strerror(openvpn_errno()));
+            break;
+        }
+        if (status == 0)
+        {
+            if (--connect_timeout < 0)
+            {
+                msg(D_LINK_ERRORS, "TCP: connect to %s timed out",
+                    print_sockaddr(ai[0]->ai_addr, &gc));
+                break;
+            }
+            management_sleep(0);
+            continue;
+        }
+
+        for (i = 0; i < n; ++i)
+        {
+            int val = 0;
+            socklen_t len = sizeof(val);
+            bool ready;
+
+            if (!socket_defined(sd[i]))
+            {
+                continue;
+            }
+#if POLL
+            {
+                int j;
+                ready = false;
+                for (j = 0; j < nfds; ++j)
+                {
+                    if (fds[j].fd == sd[i] && (fds[j].revents & (POLLOUT|POLLERR|POLLHUP)))
+                    {
+                        ready = true;
+                        break;
+                    }
+                }
+            }
+#else
+            ready = FD_ISSET(sd[i], &writes);
+#endif
+            if (!ready)
+            {
+                continue;
+            }
+
+            if (getsockopt(sd[i], SOL_SOCKET, SO_ERROR, (void *) &val, &len) != 0)
+            {
+                val = openvpn_errno();
+            }
+            if (val == 0)
+            {
+                winner = i;
+                goto done;
+            }
+            msg(D_LINK_ERRORS, "TCP: connect to %s failed: %s",
+                print_sockaddr(ai[i]->ai_addr, &gc), strerror(val));
+            openvpn_close_socket(sd[i]);
+            sd[i] = SOCKET_UNDEFINED;
+            --pending;
+        }
+    }
+
+done:
+    for (i = 0; i < n; ++i)
+    {
+        if (i != winner && socket_defined(sd[i]))
+        {
+            openvpn_close_socket(sd[i]);
+            sd[i] = SOCKET_UNDEFINED;
+        }
+    }
+
+    if (winner >= 0)
+    {
+        sock->sd = sd[winner];
+        if (winner != 0)
+        {
+            /* record which candidate won so that the actual address and
+             * any subsequent reconnect match the established connection */
+            lsa->current_remote = ai[winner];
+            set_actual_address(&lsa->actual, ai[winner]);
+        }
+        msg(M_INFO, "TCP connection established with %s",
+            print_sockaddr(ai[winner]->ai_addr, &gc));
+    }
+    else if (!sig_info->signal_received)
+    {
+        sock->sd = SOCKET_UNDEFINED;
+        sig_info->signal_received = SIGUSR1;
+        sig_info->source = SIG_SOURCE_CONNECTION_FAILED;
+    }
+
+    gc_free(&gc);
+}
+
+#endif /* CONNECT_NONBLOCK */
+
+/*
+ * Stream buffer handling prototypes -- stream_buf is a helper class
+ * to assist in the packetization of stream transport protocols
+ * such as TCP.
+ */
+
+static void
+stream_buf_init(struct stream_buf *sb, struct buffer *buf,
+                const unsigned int sockflags, const int proto);
+
+static void
+stream_buf_close(struct stream_buf *sb);
+
+static bool
+stream_buf_added(struct stream_buf *sb, int length_added);
+
+/* For stream protocols, allocate a buffer to build up packet.
+ * Called after frame has been finalized. */
+
+static void
+socket_frame_init(const struct frame *frame, struct link_socket *sock)
+{
+#ifdef _WIN32
+    overlapped_io_init(&sock->reads, frame, FALSE, false);
+    overlapped_io_init(&sock->writes, frame, TRUE, false);
+    sock->rw_handle.read = sock->reads.overlapped.hEvent;
+    sock->rw_handle.write = sock->writes.overlapped.hEvent;
+#endif
+
+    if (link_socket_connection_oriented(sock))
+    {
+#ifdef _WIN32
+        stream_buf_init(&sock->stream_buf,
+                        &sock->reads.buf_init,
+                        sock->sockflags,
+                        sock->info.proto);
+#else
+        alloc_buf_sock_tun(&sock->stream_buf_data,
+                           frame,
+                           false,
+                           FRAME_HEADROOM_MARKER_READ_STREAM);
+
+        stream_buf_init(&sock->stream_buf,
+                        &sock->stream_buf_data,
+                        sock->sockflags,
+                        sock->info.proto);
+#endif
+    }
+}
+
+/*
+ * Adjust frame structure based on a Path MTU value given
+ * to us by the OS.
+ */
 void
 frame_adjust_path_mtu(struct frame *frame, int pmtu, int proto)
 {
@@ -2074,6 +2649,12 @@ phase2_set_socket_flags(struct link_socket *sock)
     /* set misc socket parameters */
     socket_set_flags(sock->sd, sock->sockflags);
 
+    /* bound the unsent backlog on stream links */
+    if (proto_is_tcp(sock->info.proto))
+    {
+        socket_set_tcp_notsent_lowat(sock->sd, SOCKET_TCP_NOTSENT_LOWAT_DEFAULT);
+    }
+
     /* set socket to non-blocking mode */
     set_nonblock(sock->sd);
 
@@ -2180,10 +2761,24 @@ phase2_tcp_client(struct link_socket *sock, struct signal_info *sig_info)
     bool proxy_retry = false;
     do
     {
-        socket_connect(&sock->sd,
-                       sock->info.lsa->current_remote->ai_addr,
-                       get_server_poll_remaining_time(sock->server_poll_timeout),
-                       sig_info);
+#ifdef CONNECT_NONBLOCK
+        /* race the resolved addresses when there is more than one and no
+         * local bind; proxy retries reconnect to the address that won */
+        if (!proxy_retry && !sock->bind_local
+            && sock->info.lsa->current_remote->ai_next)
+        {
+            socket_connect_race(sock,
+                                get_server_poll_remaining_time(sock->server_poll_timeout),
+                                sig_info);
+        }
+        else
+#endif
+        {
+            socket_connect(&sock->sd,
+                           sock->info.lsa->current_remote->ai_addr,
+                           get_server_poll_remaining_time(sock->server_poll_timeout),
+                           sig_info);
+        }
 
         if (sig_info->signal_received)
         {
@@ -2426,6 +3021,10 @@ link_socket_close(struct link_socket *sock)
 
         stream_buf_close(&sock->stream_buf);
         free_buf(&sock->stream_buf_data);
+#ifdef ENABLE_UDP_MMSG
+        udp_mmsg_free(sock->mmsg);
+        sock->mmsg = NULL;
+#endif
         if (!gremlin)
         {
             free(sock);
@@ -2433,6 +3032,69 @@ link_socket_close(struct link_socket *sock)
     }
 }
 
+/*
+ * --link-standby fast failover: replace the descriptor of an
+ * established UDP link socket with a fresh one bound to an alternate
+ * local address, keeping the session -- and thus the negotiated data
+ * channel keys -- intact.  The remote sees the switch as a floating
+ * peer.  Returns true on success; on failure the original descriptor
+ * is left untouched so the caller can fall back to a full restart.
+ */
+bool
+link_socket_standby_failover(struct link_socket *sock, const char *local_host)
+{
+    struct addrinfo *local = NULL;
+    socket_descriptor_t sd = SOCKET_UNDEFINED;
+    const struct link_socket_actual *remote = &sock->info.lsa->actual;
+
+    if (!proto_is_udp(sock->info.proto) || !link_socket_actual_defined(remote))
+    {
+        return false;
+    }
+
+    if (openvpn_getaddrinfo(GETADDR_RESOLVE | GETADDR_DATAGRAM | GETADDR_TRY_ONCE,
+                            local_host, NULL, 0, NULL,
+                            remote->dest.addr.sa.sa_family, &local))
+    {
+        msg(M_WARN, "LINK STANDBY: cannot resolve local address %s", local_host);
+        return false;
+    }
+
+    sd = socket(local->ai_family, SOCK_DGRAM, local->ai_protocol);
+    if (!socket_defined(sd))
+    {
+        msg(M_WARN | M_ERRNO, "LINK STANDBY: cannot create UDP socket");
+        goto err;
+    }
+    if (bind(sd, local->ai_addr, local->ai_addrlen))
+    {
+        msg(M_WARN | M_ERRNO, "LINK STANDBY: bind to %s failed", local_host);
+        goto err;
+    }
+
+    /* carry the tuning of the old descriptor over to the new one */
+    set_nonblock(sd);
+    set_cloexec(sd);
+    socket_set_buffers(sd, &sock->socket_buffer_sizes);
+    socket_set_mark(sd, sock->mark);
+#if EXTENDED_SOCKET_ERROR_CAPABILITY
+    set_sock_extended_error_passing(sd);
+#endif
+
+    openvpn_close_socket(sock->sd);
+    sock->sd = sd;
+    freeaddrinfo(local);
+    return true;
+
+err:
+    if (socket_defined(sd))
+    {
+        openvpn_close_socket(sd);
+    }
+    freeaddrinfo(local);
+    return false;
+}
+
 /* for stream protocols, allow for packet length prefix */
 void
 socket_adjust_frame_parameters(struct frame *frame, int proto)
@@ -2676,6 +3338,7 @@ stream_buf_init(struct stream_buf *sb,
     sb->maxlen = sb->buf_init.len;
     sb->buf_init.len = 0;
     sb->residual = alloc_buf(sb->maxlen);
+    buf_reset(&sb->pending);
     sb->error = false;
 #if PORT_SHARE
     sb->port_share_state = ((sockflags & SF_PORT_SHARE) && (proto == PROTO_TCP_SERVER))
@@ -2690,10 +3353,24 @@ stream_buf_init(struct stream_buf *sb,
 static inline void
 stream_buf_set_next(struct stream_buf *sb)
 {
+    const int need = (sb->len >= 0 ? sb->len : sb->maxlen) - sb->buf.len;
+
+    /* in-place packet extraction walks forward through the backing buffer;
+     * slide the partial packet back to the head once the tail runs out of
+     * room -- this replaces the per-packet residual copies with an
+     * occasional memmove of an incomplete fragment */
+    if (sb->buf.offset != sb->buf_init.offset && !buf_safe(&sb->buf, need))
+    {
+        dmsg(D_STREAM_DEBUG, "STREAM: SLIDE offset=%d len=%d",
+             sb->buf.offset, sb->buf.len);
+        memmove(sb->buf.data + sb->buf_init.offset, BPTR(&sb->buf), sb->buf.len);
+        sb->buf.offset = sb->buf_init.offset;
+    }
+
     /* set up 'next' for next i/o read */
     sb->next = sb->buf;
     sb->next.offset = sb->buf.offset + sb->buf.len;
-    sb->next.len = (sb->len >= 0 ? sb->len : sb->maxlen) - sb->buf.len;
+    sb->next.len = need;
     dmsg(D_STREAM_DEBUG, "STREAM: SET NEXT, buf=[%d,%d] next=[%d,%d] len=%d maxlen=%d",
          sb->buf.offset, sb->buf.len,
          sb->next.offset, sb->next.len,
@@ -2723,21 +3400,36 @@ stream_buf_get_next(struct stream_buf *sb, struct buffer *buf)
 bool
 stream_buf_read_setup_dowork(struct link_socket *sock)
 {
-    if (sock->stream_buf.residual.len && !sock->stream_buf.residual_fully_formed)
+    struct stream_buf *sb = &sock->stream_buf;
+
+    if (sb->pending.len && !sb->residual_fully_formed)
     {
-        ASSERT(buf_copy(&sock->stream_buf.buf, &sock->stream_buf.residual));
-        ASSERT(buf_init(&sock->stream_buf.residual, 0));
-        sock->stream_buf.residual_fully_formed = stream_buf_added(&sock->stream_buf, 0);
+        /* excess bytes of a previous read -- adopt them where they sit
+         * instead of copying them back to the head of the buffer */
+        sb->buf = sb->pending;
+        buf_reset(&sb->pending);
+        sb->residual_fully_formed = stream_buf_added(sb, 0);
+        dmsg(D_STREAM_DEBUG, "STREAM: PENDING FULLY FORMED [%s], len=%d",
+             sb->residual_fully_formed ? "YES" : "NO",
+             sb->buf.len);
+    }
+    else if (sb->residual.len && !sb->residual_fully_formed)
+    {
+        /* leftover bytes captured during the proxy handshake -- copied
+         * at most once per connection */
+        ASSERT(buf_copy(&sb->buf, &sb->residual));
+        ASSERT(buf_init(&sb->residual, 0));
+        sb->residual_fully_formed = stream_buf_added(sb, 0);
         dmsg(D_STREAM_DEBUG, "STREAM: RESIDUAL FULLY FORMED [%s], len=%d",
-             sock->stream_buf.residual_fully_formed ? "YES" : "NO",
-             sock->stream_buf.residual.len);
+             sb->residual_fully_formed ? "YES" : "NO",
+             sb->residual.len);
     }
 
-    if (!sock->stream_buf.residual_fully_formed)
+    if (!sb->residual_fully_formed)
     {
-        stream_buf_set_next(&sock->stream_buf);
+        stream_buf_set_next(sb);
     }
-    return !sock->stream_buf.residual_fully_formed;
+    return !sb->residual_fully_formed;
 }
 
 static bool
@@ -2788,15 +3480,14 @@ stream_buf_added(struct stream_buf *sb,
     /* is our incoming packet fully read? */
     if (sb->len > 0 && sb->buf.len >= sb->len)
     {
-        /* save any residual data that's part of the next packet */
-        ASSERT(buf_init(&sb->residual, 0));
-        if (sb->buf.len > sb->len)
-        {
-            ASSERT(buf_copy_excess(&sb->residual, &sb->buf, sb->len));
-        }
-        dmsg(D_STREAM_DEBUG, "STREAM: ADD returned TRUE, buf_len=%d, residual_len=%d",
+        /* alias any residual data that's part of the next packet in place;
+         * it is adopted by the next read setup without being copied out */
+        sb->pending = sb->buf;
+        ASSERT(buf_advance(&sb->pending, sb->len));
+        sb->buf.len = sb->len;
+        dmsg(D_STREAM_DEBUG, "STREAM: ADD returned TRUE, buf_len=%d, pending_len=%d",
              BLEN(&sb->buf),
-             BLEN(&sb->residual));
+             BLEN(&sb->pending));
         return true;
     }
     else
@@ -3427,7 +4118,21 @@ link_socket_read_udp_posix_recvmsg(struct link_socket *sock,
     if (buf->len >= 0)
     {
         struct cmsghdr *cmsg;
+        bool parsed = false;
         fromlen = mesg.msg_namelen;
+
+        /* fast path: identical ancillary bytes as the previous
+         * datagram -- reuse the cached parse instead of walking the
+         * cmsg chain again */
+        if (mesg.msg_controllen > 0
+            && mesg.msg_controllen == sock->rx_cmsg_cache_len
+            && memcmp(pktinfo_buf, sock->rx_cmsg_cache,
+                      sock->rx_cmsg_cache_len) == 0)
+        {
+            from->pi = sock->rx_cmsg_pi;
+            return fromlen;
+        }
+
         cmsg = CMSG_FIRSTHDR(&mesg);
         if (cmsg != NULL
             && CMSG_NXTHDR(&mesg, cmsg) == NULL
@@ -3452,6 +4157,7 @@ link_socket_read_udp_posix_recvmsg(struct link_socket *sock,
 #else  /* if defined(HAVE_IN_PKTINFO) && defined(HAVE_IPI_SPEC_DST) */
 #error ENABLE_IP_PKTINFO is set without IP_PKTINFO xor IP_RECVDSTADDR (fix syshead.h)
 #endif
+            parsed = true;
         }
         else if (cmsg != NULL
                  && CMSG_NXTHDR(&mesg, cmsg) == NULL
@@ -3462,17 +4168,426 @@ link_socket_read_udp_posix_recvmsg(struct link_socket *sock,
             struct in6_pktinfo *pkti6 = (struct in6_pktinfo *) CMSG_DATA(cmsg);
             from->pi.in6.ipi6_ifindex = pkti6->ipi6_ifindex;
             from->pi.in6.ipi6_addr = pkti6->ipi6_addr;
+            parsed = true;
         }
         else if (cmsg != NULL)
         {
             msg(M_WARN, "CMSG received that cannot be parsed (cmsg_level=%d, cmsg_type=%d, cmsg=len=%d)", (int)cmsg->cmsg_level, (int)cmsg->cmsg_type, (int)cmsg->cmsg_len );
         }
+
+        if (parsed && mesg.msg_controllen <= sizeof(sock->rx_cmsg_cache))
+        {
+            memcpy(sock->rx_cmsg_cache, pktinfo_buf, mesg.msg_controllen);
+            sock->rx_cmsg_cache_len = mesg.msg_controllen;
+            sock->rx_cmsg_pi = from->pi;
+        }
     }
 
     return fromlen;
 }
 #endif /* if ENABLE_IP_PKTINFO */
 
+#ifdef ENABLE_UDP_MMSG
+
+/*
+ * Batched datagram I/O (--udp-mmsg).  Incoming datagrams are read up
+ * to n at a time with recvmmsg() into a preallocated ring and handed
+ * out one by one; socket_read_residual() keeps the event loop from
+ * sleeping while buffered datagrams are pending.  Outgoing datagrams
+ * are queued and flushed through sendmmsg() when the queue fills up or
+ * before the event loop waits.
+ */
+
+#define UDP_MMSG_MAX 64
+
+/*
+ * On Linux the batch can additionally be offloaded to the kernel as a
+ * single super-datagram: UDP_SEGMENT hands sendmsg() one buffer that
+ * the stack (or the NIC) splits into MTU-sized packets, and UDP_GRO
+ * delivers coalesced datagrams that we slice back up here.  Support is
+ * probed at setup time and silently degrades to plain sendmmsg()/
+ * recvmmsg() on older kernels.
+ */
+#if defined(TARGET_LINUX)
+#define UDP_MMSG_OFFLOAD 1
+/* socket option values are kernel ABI, appeared in Linux 4.18/5.0 */
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#define UDP_MMSG_MAX_GSO_BYTES 65507   /* maximum UDP payload */
+#endif
+
+struct udp_mmsg_slot
+{
+    struct buffer buf;                 /* owned packet storage */
+    struct sockaddr_storage addr;
+#ifdef UDP_MMSG_OFFLOAD
+    char ctrl[CMSG_SPACE(sizeof(int))]; /* receive side UDP_GRO cmsg */
+#endif
+};
+
+struct udp_mmsg
+{
+    int n;                             /* configured batch size */
+
+    /* receive ring */
+    struct udp_mmsg_slot rx[UDP_MMSG_MAX];
+    struct mmsghdr rx_vec[UDP_MMSG_MAX];
+    struct iovec rx_iov[UDP_MMSG_MAX];
+    int rx_head;
+    int rx_count;
+
+    /* transmit queue */
+    struct udp_mmsg_slot tx[UDP_MMSG_MAX];
+    struct mmsghdr tx_vec[UDP_MMSG_MAX];
+    struct iovec tx_iov[UDP_MMSG_MAX];
+    int tx_count;
+
+#ifdef UDP_MMSG_OFFLOAD
+    bool gso_ok;                       /* kernel accepts UDP_SEGMENT */
+    bool gro_ok;                       /* kernel delivers UDP_GRO */
+    int rx_off;                        /* consumed bytes of head slot */
+    int rx_seg;                        /* GRO segment size of head slot */
+#endif
+};
+
+void
+link_socket_enable_mmsg(struct link_socket *sock,
+                        const struct frame *frame,
+                        int n)
+{
+    if (!sock || n <= 0 || !proto_is_udp(sock->info.proto))
+    {
+        return;
+    }
+    if (sock->sockflags & SF_USE_IP_PKTINFO)
+    {
+        msg(M_WARN, "NOTE: --udp-mmsg is not compatible with --multihome, "
+            "batched I/O disabled");
+        return;
+    }
+
+    struct udp_mmsg *um;
+    ALLOC_OBJ_CLEAR(um, struct udp_mmsg);
+    um->n = min_int(n, UDP_MMSG_MAX);
+
+    int rx_size = BUF_SIZE(frame);
+#ifdef UDP_MMSG_OFFLOAD
+    {
+        int zero = 0;
+        int on = 1;
+
+        um->gso_ok = (setsockopt(sock->sd, IPPROTO_UDP, UDP_SEGMENT,
+                                 &zero, sizeof(zero)) == 0);
+        um->gro_ok = (setsockopt(sock->sd, IPPROTO_UDP, UDP_GRO,
+                                 &on, sizeof(on)) == 0);
+        if (um->gro_ok)
+        {
+            /* GRO can coalesce up to a full UDP payload per slot */
+            rx_size = UDP_MMSG_MAX_GSO_BYTES;
+        }
+    }
+#endif
+
+    for (int i = 0; i < um->n; ++i)
+    {
+        um->rx[i].buf = alloc_buf(rx_size);
+        um->tx[i].buf = alloc_buf(BUF_SIZE(frame));
+    }
+    sock->mmsg = um;
+#ifdef UDP_MMSG_OFFLOAD
+    msg(M_INFO, "UDP batched I/O enabled, batch size %d (GSO %s, GRO %s)",
+        um->n, um->gso_ok ? "on" : "off", um->gro_ok ? "on" : "off");
+#else
+    msg(M_INFO, "UDP batched I/O enabled, batch size %d", um->n);
+#endif
+}
+
+static void
+udp_mmsg_free(struct udp_mmsg *um)
+{
+    if (um)
+    {
+        for (int i = 0; i < um->n; ++i)
+        {
+            free_buf(&um->rx[i].buf);
+            free_buf(&um->tx[i].buf);
+        }
+        free(um);
+    }
+}
+
+bool
+link_socket_udp_mmsg_pending(const struct link_socket *sock)
+{
+    return sock->mmsg && sock->mmsg->rx_count > 0;
+}
+
+static void
+udp_mmsg_fill(struct link_socket *sock)
+{
+    struct udp_mmsg *um = sock->mmsg;
+
+    for (int i = 0; i < um->n; ++i)
+    {
+        struct mmsghdr *mh = &um->rx_vec[i];
+        um->rx_iov[i].iov_base = um->rx[i].buf.data;
+        um->rx_iov[i].iov_len = um->rx[i].buf.capacity;
+        CLEAR(*mh);
+        mh->msg_hdr.msg_iov = &um->rx_iov[i];
+        mh->msg_hdr.msg_iovlen = 1;
+        mh->msg_hdr.msg_name = &um->rx[i].addr;
+        mh->msg_hdr.msg_namelen = sizeof(um->rx[i].addr);
+#ifdef UDP_MMSG_OFFLOAD
+        if (um->gro_ok)
+        {
+            mh->msg_hdr.msg_control = um->rx[i].ctrl;
+            mh->msg_hdr.msg_controllen = sizeof(um->rx[i].ctrl);
+        }
+#endif
+    }
+
+    const int n = recvmmsg(sock->sd, um->rx_vec, um->n, MSG_DONTWAIT, NULL);
+    um->rx_head = 0;
+    um->rx_count = (n > 0) ? n : 0;
+}
+
+#ifdef UDP_MMSG_OFFLOAD
+static int
+udp_mmsg_gro_seg(struct msghdr *mh)
+{
+    struct cmsghdr *cm;
+
+    for (cm = CMSG_FIRSTHDR(mh); cm; cm = CMSG_NXTHDR(mh, cm))
+    {
+        if (cm->cmsg_level == IPPROTO_UDP && cm->cmsg_type == UDP_GRO)
+        {
+            int seg;
+            memcpy(&seg, CMSG_DATA(cm), sizeof(seg));
+            return seg;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Length of the run of queued datagrams starting at "first" that can be
+ * merged into one UDP_SEGMENT send: same destination, equal sizes (the
+ * final member may be shorter) and within the UDP payload limit.
+ */
+static int
+udp_mmsg_gso_run(const struct udp_mmsg *um, int first)
+{
+    const size_t seg = um->tx_iov[first].iov_len;
+    const socklen_t namelen = um->tx_vec[first].msg_hdr.msg_namelen;
+    size_t total = seg;
+    int i;
+
+    for (i = first + 1; i < um->tx_count; ++i)
+    {
+        const size_t len = um->tx_iov[i].iov_len;
+
+        if (len > seg
+            || um->tx_vec[i].msg_hdr.msg_namelen != namelen
+            || memcmp(&um->tx[i].addr, &um->tx[first].addr, namelen)
+            || total + len > UDP_MMSG_MAX_GSO_BYTES)
+        {
+            break;
+        }
+        total += len;
+        if (len < seg)
+        {
+            /* a shorter datagram may only close the super-packet */
+            ++i;
+            break;
+        }
+    }
+    return i - first;
+}
+
+static ssize_t
+udp_mmsg_send_gso(struct link_socket *sock, struct udp_mmsg *um,
+                  int first, int run)
+{
+    struct msghdr mh;
+    struct cmsghdr *cm;
+    char ctrl[CMSG_SPACE(sizeof(uint16_t))];
+    const uint16_t seg = (uint16_t) um->tx_iov[first].iov_len;
+
+    CLEAR(mh);
+    CLEAR(ctrl);
+    mh.msg_iov = (struct iovec *) &um->tx_iov[first];
+    mh.msg_iovlen = run;
+    mh.msg_name = um->tx_vec[first].msg_hdr.msg_name;
+    mh.msg_namelen = um->tx_vec[first].msg_hdr.msg_namelen;
+    mh.msg_control = ctrl;
+    mh.msg_controllen = sizeof(ctrl);
+
+    cm = CMSG_FIRSTHDR(&mh);
+    cm->cmsg_level = IPPROTO_UDP;
+    cm->cmsg_type = UDP_SEGMENT;
+    cm->cmsg_len = CMSG_LEN(sizeof(seg));
+    memcpy(CMSG_DATA(cm), &seg, sizeof(seg));
+
+    return sendmsg(sock->sd, &mh, 0);
+}
+#endif /* UDP_MMSG_OFFLOAD */
+
+static int
+link_socket_read_udp_posix_mmsg(struct link_socket *sock,
+                                struct buffer *buf,
+                                struct link_socket_actual *from,
+                                socklen_t *fromlen)
+{
+    struct udp_mmsg *um = sock->mmsg;
+
+    if (um->rx_count == 0)
+    {
+        udp_mmsg_fill(sock);
+        if (um->rx_count == 0)
+        {
+            return buf->len = -1;
+        }
+    }
+
+    const int i = um->rx_head;
+    const int total = um->rx_vec[i].msg_len;
+    int off = 0;
+    int len = total;
+    bool slot_done = true;
+
+#ifdef UDP_MMSG_OFFLOAD
+    if (um->gro_ok)
+    {
+        /* a slot may hold several GRO-coalesced datagrams of rx_seg
+         * bytes each; hand them out one per call */
+        if (um->rx_off == 0)
+        {
+            um->rx_seg = udp_mmsg_gro_seg(&um->rx_vec[i].msg_hdr);
+        }
+        if (um->rx_seg > 0)
+        {
+            off = um->rx_off;
+            len = min_int(um->rx_seg, total - off);
+            um->rx_off += len;
+            slot_done = (um->rx_off >= total);
+            if (slot_done)
+            {
+                um->rx_off = 0;
+            }
+        }
+    }
+#endif
+
+    if (len <= buf_forward_capacity(buf))
+    {
+        memcpy(BPTR(buf), um->rx[i].buf.data + off, len);
+        buf->len = len;
+    }
+    else
+    {
+        buf->len = -1;
+    }
+    memcpy(&from->dest.addr, &um->rx[i].addr,
+           min_int(um->rx_vec[i].msg_hdr.msg_namelen, sizeof(from->dest.addr)));
+    *fromlen = um->rx_vec[i].msg_hdr.msg_namelen;
+
+    if (slot_done)
+    {
+        ++um->rx_head;
+        --um->rx_count;
+    }
+
+    return buf->len;
+}
+
+size_t
+link_socket_write_udp_posix_mmsg(struct link_socket *sock,
+                                 struct buffer *buf,
+                                 struct link_socket_actual *to)
+{
+    struct udp_mmsg *um = sock->mmsg;
+    const int len = BLEN(buf);
+    struct udp_mmsg_slot *slot = &um->tx[um->tx_count];
+
+    if (len <= 0 || len > slot->buf.capacity)
+    {
+        return sendto(sock->sd, BPTR(buf), len, 0,
+                      (struct sockaddr *) &to->dest.addr.sa,
+                      (socklen_t) af_addr_size(to->dest.addr.sa.sa_family));
+    }
+
+    memcpy(slot->buf.data, BPTR(buf), len);
+    memcpy(&slot->addr, &to->dest.addr, af_addr_size(to->dest.addr.sa.sa_family));
+
+    struct mmsghdr *mh = &um->tx_vec[um->tx_count];
+    um->tx_iov[um->tx_count].iov_base = slot->buf.data;
+    um->tx_iov[um->tx_count].iov_len = len;
+    CLEAR(*mh);
+    mh->msg_hdr.msg_iov = &um->tx_iov[um->tx_count];
+    mh->msg_hdr.msg_iovlen = 1;
+    mh->msg_hdr.msg_name = &slot->addr;
+    mh->msg_hdr.msg_namelen = af_addr_size(to->dest.addr.sa.sa_family);
+
+    if (++um->tx_count >= um->n)
+    {
+        link_socket_mmsg_flush(sock);
+    }
+
+    return len;
+}
+
+void
+link_socket_mmsg_flush(struct link_socket *sock)
+{
+    struct udp_mmsg *um = sock ? sock->mmsg : NULL;
+
+    if (!um || um->tx_count == 0)
+    {
+        return;
+    }
+
+    int sent = 0;
+    while (sent < um->tx_count)
+    {
+#ifdef UDP_MMSG_OFFLOAD
+        if (um->gso_ok)
+        {
+            const int run = udp_mmsg_gso_run(um, sent);
+            if (run > 1)
+            {
+                if (udp_mmsg_send_gso(sock, um, sent, run) >= 0)
+                {
+                    sent += run;
+                    continue;
+                }
+                /* hand the same datagrams to sendmmsg() below instead */
+                um->gso_ok = false;
+                msg(D_LINK_ERRORS | M_ERRNO,
+                    "UDP: UDP_SEGMENT send failed, disabling GSO offload");
+            }
+        }
+#endif
+        const int n = sendmmsg(sock->sd, &um->tx_vec[sent],
+                               um->tx_count - sent, 0);
+        if (n <= 0)
+        {
+            /* UDP: drop the remainder of the batch on error */
+            msg(D_LINK_ERRORS | M_ERRNO,
+                "UDP: sendmmsg() failed, dropping %d queued datagrams",
+                um->tx_count - sent);
+            break;
+        }
+        sent += n;
+    }
+    um->tx_count = 0;
+}
+
+#endif /* ENABLE_UDP_MMSG */
+
 int
 link_socket_read_udp_posix(struct link_socket *sock,
                            struct buffer *buf,
@@ -3481,6 +4596,19 @@ link_socket_read_udp_posix(struct link_socket *sock,
     socklen_t fromlen = sizeof(from->dest.addr);
     socklen_t expectedlen = af_addr_size(sock->info.af);
     addr_zero_host(&from->dest);
+#ifdef TARGET_LINUX
+    if (now >= sock->rx_drops_check)
+    {
+        link_socket_rcvbuf_adjust(sock);
+    }
+#endif
+#ifdef ENABLE_UDP_MMSG
+    if (sock->mmsg)
+    {
+        link_socket_read_udp_posix_mmsg(sock, buf, from, &fromlen);
+    }
+    else
+#endif
 #if ENABLE_IP_PKTINFO
     /* Both PROTO_UDPv4 and PROTO_UDPv6 */
     if (sock->info.proto == PROTO_UDP && sock->sockflags & SF_USE_IP_PKTINFO)
@@ -3532,70 +4660,99 @@ link_socket_write_udp_posix_sendmsg(struct link_socket *sock,
     struct iovec iov;
     struct msghdr mesg;
     struct cmsghdr *cmsg;
-    uint8_t pktinfo_buf[PKTINFO_BUF_SIZE];
+    const sa_family_t af = to->dest.addr.sa.sa_family;
 
     iov.iov_base = BPTR(buf);
     iov.iov_len = BLEN(buf);
     mesg.msg_iov = &iov;
     mesg.msg_iovlen = 1;
-    switch (to->dest.addr.sa.sa_family)
+    mesg.msg_name = &to->dest.addr.sa;
+    mesg.msg_flags = 0;
+
+    switch (af)
     {
         case AF_INET:
-        {
-            mesg.msg_name = &to->dest.addr.sa;
             mesg.msg_namelen = sizeof(struct sockaddr_in);
-            mesg.msg_control = pktinfo_buf;
-            mesg.msg_flags = 0;
-#if defined(HAVE_IN_PKTINFO) && defined(HAVE_IPI_SPEC_DST)
-            mesg.msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
-            cmsg = CMSG_FIRSTHDR(&mesg);
-            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
-            cmsg->cmsg_level = SOL_IP;
-            cmsg->cmsg_type = IP_PKTINFO;
+            break;
+
+        case AF_INET6:
+            mesg.msg_namelen = sizeof(struct sockaddr_in6);
+            break;
+
+        default:
+            ASSERT(0);
+    }
+
+    /* reuse the control block built for the previous send unless the
+     * pktinfo changed (float or interface change) */
+    if (sock->tx_cmsg_len == 0
+        || sock->tx_cmsg_af != af
+        || memcmp(&sock->tx_cmsg_pi, &to->pi, sizeof(to->pi)) != 0)
+    {
+        mesg.msg_control = sock->tx_cmsg_buf;
+
+        switch (af)
+        {
+            case AF_INET:
             {
-                struct in_pktinfo *pkti;
-                pkti = (struct in_pktinfo *) CMSG_DATA(cmsg);
-                pkti->ipi_ifindex = to->pi.in4.ipi_ifindex;
-                pkti->ipi_spec_dst = to->pi.in4.ipi_spec_dst;
-                pkti->ipi_addr.s_addr = 0;
-            }
+#if defined(HAVE_IN_PKTINFO) && defined(HAVE_IPI_SPEC_DST)
+                mesg.msg_controllen = CMSG_SPACE(sizeof(struct in_pktinfo));
+                cmsg = CMSG_FIRSTHDR(&mesg);
+                cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_pktinfo));
+                cmsg->cmsg_level = SOL_IP;
+                cmsg->cmsg_type = IP_PKTINFO;
+                {
+                    struct in_pktinfo *pkti;
+                    pkti = (struct in_pktinfo *) CMSG_DATA(cmsg);
+                    pkti->ipi_ifindex = to->pi.in4.ipi_ifindex;
+                    pkti->ipi_spec_dst = to->pi.in4.ipi_spec_dst;
+                    pkti->ipi_addr.s_addr = 0;
+                }
 #elif defined(IP_RECVDSTADDR)
-            ASSERT( CMSG_SPACE(sizeof(struct in_addr)) <= sizeof(pktinfo_buf) );
-            mesg.msg_controllen = CMSG_SPACE(sizeof(struct in_addr));
-            cmsg = CMSG_FIRSTHDR(&mesg);
-            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_addr));
-            cmsg->cmsg_level = IPPROTO_IP;
-            cmsg->cmsg_type = IP_RECVDSTADDR;
-            *(struct in_addr *) CMSG_DATA(cmsg) = to->pi.in4;
+                ASSERT( CMSG_SPACE(sizeof(struct in_addr)) <= sizeof(sock->tx_cmsg_buf) );
+                mesg.msg_controllen = CMSG_SPACE(sizeof(struct in_addr));
+                cmsg = CMSG_FIRSTHDR(&mesg);
+                cmsg->cmsg_len = CMSG_LEN(sizeof(struct in_addr));
+                cmsg->cmsg_level = IPPROTO_IP;
+                cmsg->cmsg_type = IP_RECVDSTADDR;
+                *(struct in_addr *) CMSG_DATA(cmsg) = to->pi.in4;
 #else  /* if defined(HAVE_IN_PKTINFO) && defined(HAVE_IPI_SPEC_DST) */
 #error ENABLE_IP_PKTINFO is set without IP_PKTINFO xor IP_RECVDSTADDR (fix syshead.h)
 #endif /* if defined(HAVE_IN_PKTINFO) && defined(HAVE_IPI_SPEC_DST) */
-            break;
-        }
+                break;
+            }
 
-        case AF_INET6:
-        {
-            struct in6_pktinfo *pkti6;
-            mesg.msg_name = &to->dest.addr.sa;
-            mesg.msg_namelen = sizeof(struct sockaddr_in6);
+            case AF_INET6:
+            {
+                struct in6_pktinfo *pkti6;
+
+                ASSERT( CMSG_SPACE(sizeof(struct in6_pktinfo)) <= sizeof(sock->tx_cmsg_buf) );
+                mesg.msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
+                cmsg = CMSG_FIRSTHDR(&mesg);
+                cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
+                cmsg->cmsg_level = IPPROTO_IPV6;
+                cmsg->cmsg_type = IPV6_PKTINFO;
+
+                pkti6 = (struct in6_pktinfo *) CMSG_DATA(cmsg);
+                pkti6->ipi6_ifindex = to->pi.in6.ipi6_ifindex;
+                pkti6->ipi6_addr = to->pi.in6.ipi6_addr;
+                break;
+            }
 
-            ASSERT( CMSG_SPACE(sizeof(struct in6_pktinfo)) <= sizeof(pktinfo_buf) );
-            mesg.msg_control = pktinfo_buf;
-            mesg.msg_controllen = CMSG_SPACE(sizeof(struct in6_pktinfo));
-            mesg.msg_flags = 0;
-            cmsg = CMSG_FIRSTHDR(&mesg);
-            cmsg->cmsg_len = CMSG_LEN(sizeof(struct in6_pktinfo));
-            cmsg->cmsg_level = IPPROTO_IPV6;
-            cmsg->cmsg_type = IPV6_PKTINFO;
-
-            pkti6 = (struct in6_pktinfo *) CMSG_DATA(cmsg);
-            pkti6->ipi6_ifindex = to->pi.in6.ipi6_ifindex;
-            pkti6->ipi6_addr = to->pi.in6.ipi6_addr;
-            break;
+            default:
+                ASSERT(0);
         }
 
-        default: ASSERT(0);
+        sock->tx_cmsg_len = mesg.msg_controllen;
+        sock->tx_cmsg_af = af;
+        sock->tx_cmsg_pi = to->pi;
+    }
+    else
+    {
+        mesg.msg_control = sock->tx_cmsg_buf;
+        mesg.msg_controllen = sock->tx_cmsg_len;
     }
+
     return sendmsg(sock->sd, &mesg, 0);
 }
 
@@ -3603,6 +4760,18 @@ link_socket_write_udp_posix_sendmsg(struct link_socket *sock,
 
 /*
  * Win32 overlapped socket I/O functions.
+ *
+ * Note on per-packet event signaling: each queued operation costs two
+ * kernel transitions on its event object even when the socket is ready
+ * and the WSA call completes inline.  Neither can be elided within this
+ * model: the ResetEvent must precede the WSA call (resetting after a
+ * WSA_IO_PENDING return races the completion's own SetEvent and can
+ * lose the wakeup), and the SetEvent on immediate return is what wakes
+ * the event loop, which blocks on the handle in WSAWaitForMultipleEvents.
+ * Amortizing the signaling below one event per packet requires a
+ * completion-ring backend (Registered I/O) with its own notification
+ * path through the event_set abstraction, not a change local to these
+ * functions.
  */
 
 #ifdef _WIN32
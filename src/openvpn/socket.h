@@ -40,6 +40,15 @@
  */
 #define OPENVPN_PORT "1194"
 
+/*
+ * Batched UDP datagram I/O (--udp-mmsg) needs both recvmmsg() and
+ * sendmmsg().
+ */
+#if defined(HAVE_RECVMMSG) && defined(HAVE_SENDMMSG) && !defined(_WIN32)
+#define ENABLE_UDP_MMSG 1
+struct udp_mmsg;
+#endif
+
 /*
  * Number of seconds that "resolv-retry infinite"
  * represents.
@@ -77,6 +86,8 @@ struct cached_dns_entry {
     const char *servname;
     int ai_family;
     int flags;
+    time_t expiry;              /* re-resolve after this time, 0 = never */
+    struct gc_arena *gc;        /* arena owning refreshed addrinfo chains */
     struct addrinfo *ai;
     struct cached_dns_entry *next;
 };
@@ -88,7 +99,7 @@ struct link_socket_actual
 
     struct openvpn_sockaddr dest;
 #if ENABLE_IP_PKTINFO
-    union {
+    union link_socket_pktinfo {
 #if defined(HAVE_IN_PKTINFO) && defined(HAVE_IPI_SPEC_DST)
         struct in_pktinfo in4;
 #elif defined(IP_RECVDSTADDR)
@@ -135,6 +146,9 @@ struct stream_buf
 
     struct buffer buf;
     struct buffer next;
+    struct buffer pending; /* zero-copy alias of excess bytes read beyond the
+                            * current packet; parsed in place on the next
+                            * read setup */
     int len;   /* -1 if not yet known */
 
     bool error; /* if true, fatal TCP error has occurred,
@@ -203,22 +217,55 @@ struct link_socket
 
     struct socket_buffer_size socket_buffer_sizes;
 
+#ifdef TARGET_LINUX
+    /* adaptive receive-buffer growth, driven by kernel drop counts */
+    uint32_t rx_drops_last;
+    time_t rx_drops_check;
+#endif
+
     int mtu;                    /* OS discovered MTU, or 0 if unknown */
 
+    counter_type errq_unreachable; /* cumulative ICMP unreachable messages
+                                    * drained from the socket error queue */
+
 #define SF_USE_IP_PKTINFO (1<<0)
 #define SF_TCP_NODELAY (1<<1)
 #define SF_PORT_SHARE (1<<2)
 #define SF_HOST_RANDOMIZE (1<<3)
 #define SF_GETADDRINFO_DGRAM (1<<4)
+#define SF_REUSEPORT (1<<5)
     unsigned int sockflags;
     int mark;
     const char *bind_dev;
 
+#if ENABLE_IP_PKTINFO
+    /*
+     * --multihome fast path.  The ancillary pktinfo changes only on a
+     * float or an interface change, so cache the raw cmsg bytes of the
+     * last receive-side parse together with its result, and keep the
+     * last built send-side cmsg for reuse; both are validated with a
+     * cheap memcmp per packet.
+     */
+    uint8_t rx_cmsg_cache[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    socklen_t rx_cmsg_cache_len;            /* 0 = cache empty */
+    union link_socket_pktinfo rx_cmsg_pi;   /* parse result of the cache */
+
+    uint8_t tx_cmsg_buf[CMSG_SPACE(sizeof(struct in6_pktinfo))];
+    socklen_t tx_cmsg_len;                  /* 0 = not built yet */
+    union link_socket_pktinfo tx_cmsg_pi;   /* pi the buffer was built from */
+    sa_family_t tx_cmsg_af;
+#endif
+
     /* for stream sockets */
     struct stream_buf stream_buf;
     struct buffer stream_buf_data;
     bool stream_reset;
 
+#ifdef ENABLE_UDP_MMSG
+    /* batched datagram I/O state (--udp-mmsg), NULL if disabled */
+    struct udp_mmsg *mmsg;
+#endif
+
     /* HTTP proxy */
     struct http_proxy_info *http_proxy;
 
@@ -285,7 +332,8 @@ void socket_bind(socket_descriptor_t sd,
                  struct addrinfo *local,
                  int af_family,
                  const char *prefix,
-                 bool ipv6only);
+                 bool ipv6only,
+                 unsigned int sockflags);
 
 int openvpn_connect(socket_descriptor_t sd,
                     const struct sockaddr *remote,
@@ -344,6 +392,8 @@ void frame_adjust_path_mtu(struct frame *frame, int pmtu, int proto);
 
 void link_socket_close(struct link_socket *sock);
 
+bool link_socket_standby_failover(struct link_socket *sock, const char *local_host);
+
 void sd_close(socket_descriptor_t *sd);
 
 #define PS_SHOW_PORT_IF_DEFINED (1<<0)
@@ -455,6 +505,10 @@ bool link_socket_update_flags(struct link_socket *ls, unsigned int sockflags);
 
 void link_socket_update_buffer_sizes(struct link_socket *ls, int rcvbuf, int sndbuf);
 
+bool socket_set_pacing_rate(socket_descriptor_t sd, int bytes_per_second);
+
+bool socket_set_udp_prefilter(socket_descriptor_t sd);
+
 /*
  * Low-level functions
  */
@@ -1045,6 +1099,26 @@ int link_socket_read_udp_posix(struct link_socket *sock,
 
 #endif
 
+#ifdef ENABLE_UDP_MMSG
+
+/* enable batched datagram I/O on a UDP socket (--udp-mmsg) */
+void link_socket_enable_mmsg(struct link_socket *sock,
+                             const struct frame *frame,
+                             int n);
+
+/* true if batched reads are buffered and waiting to be consumed */
+bool link_socket_udp_mmsg_pending(const struct link_socket *sock);
+
+/* queue an outgoing datagram, flushing with sendmmsg() when full */
+size_t link_socket_write_udp_posix_mmsg(struct link_socket *sock,
+                                        struct buffer *buf,
+                                        struct link_socket_actual *to);
+
+/* flush all queued outgoing datagrams through sendmmsg() */
+void link_socket_mmsg_flush(struct link_socket *sock);
+
+#endif /* ENABLE_UDP_MMSG */
+
 /* read a TCP or UDP packet from link */
 static inline int
 link_socket_read(struct link_socket *sock,
@@ -1131,6 +1205,18 @@ link_socket_write_udp_posix(struct link_socket *sock,
         return link_socket_write_udp_posix_sendmsg(sock, buf, to);
     }
     else
+#endif
+#ifdef ENABLE_UDP_MMSG
+    if (sock->mmsg
+#if PASSTOS_CAPABILITY
+        /* --passtos sets TOS per packet, which batching would reorder */
+        && !sock->ptos_defined
+#endif
+        )
+    {
+        return link_socket_write_udp_posix_mmsg(sock, buf, to);
+    }
+    else
 #endif
     return sendto(sock->sd, BPTR(buf), BLEN(buf), 0,
                   (struct sockaddr *) &to->dest.addr.sa,
@@ -1218,7 +1304,11 @@ link_socket_set_tos(struct link_socket *ls)
 static inline bool
 socket_read_residual(const struct link_socket *s)
 {
-    return s && s->stream_buf.residual_fully_formed;
+    return s && (s->stream_buf.residual_fully_formed
+#ifdef ENABLE_UDP_MMSG
+                 || (s->mmsg && link_socket_udp_mmsg_pending(s))
+#endif
+                 );
 }
 
 static inline event_t
@@ -563,27 +563,22 @@ void
 socks_process_incoming_udp(struct buffer *buf,
                            struct link_socket_actual *from)
 {
-    int atyp;
+    const uint8_t *head = BPTR(buf);
 
     if (BLEN(buf) < 10)
     {
         goto error;
     }
 
-    buf_read_u16(buf);
-    if (buf_read_u8(buf) != 0)
+    /* RSV (bytes 0-1) ignored, FRAG == 0, ATYP == 1 (IP V4) */
+    if (head[2] != 0 || head[3] != 1)
     {
         goto error;
     }
 
-    atyp = buf_read_u8(buf);
-    if (atyp != 1)              /* ATYP == 1 (IP V4) */
-    {
-        goto error;
-    }
-
-    buf_read(buf, &from->dest.addr.in4.sin_addr, sizeof(from->dest.addr.in4.sin_addr));
-    buf_read(buf, &from->dest.addr.in4.sin_port, sizeof(from->dest.addr.in4.sin_port));
+    memcpy(&from->dest.addr.in4.sin_addr, head + 4, sizeof(from->dest.addr.in4.sin_addr));
+    memcpy(&from->dest.addr.in4.sin_port, head + 8, sizeof(from->dest.addr.in4.sin_port));
+    ASSERT(buf_advance(buf, 10));
 
     return;
 
@@ -599,7 +594,8 @@ error:
  * Returns the size of the header.
  */
 int
-socks_process_outgoing_udp(struct buffer *buf,
+socks_process_outgoing_udp(struct socks_proxy_info *sp,
+                           struct buffer *buf,
                            const struct link_socket_actual *to)
 {
     /*
@@ -612,11 +608,30 @@ socks_process_outgoing_udp(struct buffer *buf,
     /* crash if not enough headroom in buf */
     ASSERT(buf_defined(&head));
 
-    buf_write_u16(&head, 0);    /* RSV = 0 */
-    buf_write_u8(&head, 0);     /* FRAG = 0 */
-    buf_write_u8(&head, '\x01'); /* ATYP = 1 (IP V4) */
-    buf_write(&head, &to->dest.addr.in4.sin_addr, sizeof(to->dest.addr.in4.sin_addr));
-    buf_write(&head, &to->dest.addr.in4.sin_port, sizeof(to->dest.addr.in4.sin_port));
+    /*
+     * The destination doesn't change mid-session, so format the
+     * header once and apply it with a single copy thereafter.
+     */
+    if (!sp->udp_header_defined
+        || sp->udp_header_addr != to->dest.addr.in4.sin_addr.s_addr
+        || sp->udp_header_port != to->dest.addr.in4.sin_port)
+    {
+        struct buffer hb = clear_buf();
+
+        buf_set_write(&hb, sp->udp_header, sizeof(sp->udp_header));
+        buf_write_u16(&hb, 0);    /* RSV = 0 */
+        buf_write_u8(&hb, 0);     /* FRAG = 0 */
+        buf_write_u8(&hb, '\x01'); /* ATYP = 1 (IP V4) */
+        buf_write(&hb, &to->dest.addr.in4.sin_addr, sizeof(to->dest.addr.in4.sin_addr));
+        buf_write(&hb, &to->dest.addr.in4.sin_port, sizeof(to->dest.addr.in4.sin_port));
+        ASSERT(BLEN(&hb) == sizeof(sp->udp_header));
+
+        sp->udp_header_addr = to->dest.addr.in4.sin_addr.s_addr;
+        sp->udp_header_port = to->dest.addr.in4.sin_port;
+        sp->udp_header_defined = true;
+    }
+
+    ASSERT(buf_write(&head, sp->udp_header, sizeof(sp->udp_header)));
 
     return 10;
 }
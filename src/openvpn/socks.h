@@ -40,6 +40,15 @@ struct socks_proxy_info {
     char server[128];
     const char *port;
     char authfile[256];
+
+    /*
+     * Preformatted 10-byte UDP relay header, rebuilt only when the
+     * destination address changes (normally never mid-session).
+     */
+    uint8_t udp_header[10];
+    uint32_t udp_header_addr;  /* network order */
+    uint16_t udp_header_port;  /* network order */
+    bool udp_header_defined;
 };
 
 void socks_adjust_frame_parameters(struct frame *frame, int proto);
@@ -65,7 +74,8 @@ void establish_socks_proxy_udpassoc(struct socks_proxy_info *p,
 void socks_process_incoming_udp(struct buffer *buf,
                                 struct link_socket_actual *from);
 
-int socks_process_outgoing_udp(struct buffer *buf,
+int socks_process_outgoing_udp(struct socks_proxy_info *sp,
+                               struct buffer *buf,
                                const struct link_socket_actual *to);
 
 #endif /* ifndef SOCKS_H */
@@ -0,0 +1,203 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#include "syshead.h"
+
+#include "error.h"
+#include "buffer.h"
+#include "crypto.h"
+#include "integer.h"
+#include "srclimit.h"
+
+#include "memdbg.h"
+
+/*
+ * SipHash-2-4 with a 64-bit result, after the reference implementation
+ * by Aumasson and Bernstein.  Unlike the Jenkins hash in list.c this is
+ * a keyed PRF, so a remote sender cannot construct source addresses
+ * that pile into one bucket.
+ */
+
+#define SIPROUND                                        \
+    do {                                                \
+        v0 += v1; v1 = (v1 << 13) | (v1 >> 51); v1 ^= v0; \
+        v0 = (v0 << 32) | (v0 >> 32);                   \
+        v2 += v3; v3 = (v3 << 16) | (v3 >> 48); v3 ^= v2; \
+        v0 += v3; v3 = (v3 << 21) | (v3 >> 43); v3 ^= v0; \
+        v2 += v1; v1 = (v1 << 17) | (v1 >> 47); v1 ^= v2; \
+        v2 = (v2 << 32) | (v2 >> 32);                   \
+    } while (0)
+
+static uint64_t
+siphash(const uint8_t *data, size_t len, const uint64_t key[2])
+{
+    uint64_t v0 = key[0] ^ UINT64_C(0x736f6d6570736575);
+    uint64_t v1 = key[1] ^ UINT64_C(0x646f72616e646f6d);
+    uint64_t v2 = key[0] ^ UINT64_C(0x6c7967656e657261);
+    uint64_t v3 = key[1] ^ UINT64_C(0x7465646279746573);
+    const size_t tail = len & 7;
+    uint64_t m;
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8)
+    {
+        memcpy(&m, data + i, sizeof(m));
+        v3 ^= m;
+        SIPROUND;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    m = (uint64_t)len << 56;
+    if (tail)
+    {
+        uint8_t last[8] = { 0 };
+        uint64_t t;
+        memcpy(last, data + i, tail);
+        memcpy(&t, last, sizeof(t));
+        m |= t;
+    }
+    v3 ^= m;
+    SIPROUND;
+    SIPROUND;
+    v0 ^= m;
+
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/*
+ * Hash the source IP address only -- a flood from one host cycling
+ * through source ports must still land in one bucket.
+ */
+static uint64_t
+srclimit_hash_addr(const struct srclimit *sl,
+                   const struct openvpn_sockaddr *from)
+{
+    switch (from->addr.sa.sa_family)
+    {
+        case AF_INET:
+            return siphash((const uint8_t *)&from->addr.in4.sin_addr,
+                           sizeof(from->addr.in4.sin_addr), sl->key);
+
+        case AF_INET6:
+            return siphash((const uint8_t *)&from->addr.in6.sin6_addr,
+                           sizeof(from->addr.in6.sin6_addr), sl->key);
+
+        default:
+            return 0;
+    }
+}
+
+void
+srclimit_init(struct srclimit *sl, int rate, int size)
+{
+    int n = SRCLIMIT_DEFAULT_SIZE;
+
+    CLEAR(*sl);
+
+    if (size > 0)
+    {
+        /* round the requested size up to a power of two */
+        n = 1;
+        while (n < size)
+        {
+            n <<= 1;
+        }
+    }
+
+    sl->rate = max_int(rate, 1);
+    /* one second's worth of credit, with headroom for retransmits */
+    sl->burst = max_int(sl->rate, 4);
+    sl->mask = n - 1;
+    sl->slots = (struct srclimit_entry *)
+        calloc(n, sizeof(struct srclimit_entry));
+    check_malloc_return(sl->slots);
+    prng_bytes((uint8_t *)sl->key, sizeof(sl->key));
+}
+
+void
+srclimit_free(struct srclimit *sl)
+{
+    free(sl->slots);
+    CLEAR(*sl);
+}
+
+bool
+srclimit_allow(struct srclimit *sl, const struct openvpn_sockaddr *from,
+               time_t now)
+{
+    const uint64_t h = srclimit_hash_addr(sl, from);
+    struct srclimit_entry *e;
+
+    if (!h)
+    {
+        /* unhashable address family; let later checks deal with it */
+        return true;
+    }
+
+    e = &sl->slots[h & sl->mask];
+    if (e->id != h)
+    {
+        /*
+         * Slot empty, or owned by a different source: take it over.
+         * Eviction costs the previous owner nothing but its accumulated
+         * credit, and the keyed hash keeps a flood from steering itself
+         * into a victim's slot.
+         */
+        e->id = h;
+        e->tokens = sl->burst;
+        e->last_fill = now;
+    }
+    else if (now > e->last_fill)
+    {
+        const time_t elapsed = now - e->last_fill;
+        if (elapsed > sl->burst / sl->rate)
+        {
+            e->tokens = sl->burst;
+        }
+        else
+        {
+            e->tokens = min_int(sl->burst, e->tokens + (int)elapsed * sl->rate);
+        }
+        e->last_fill = now;
+    }
+
+    if (e->tokens > 0)
+    {
+        --e->tokens;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,77 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Per-source-IP rate accounting for datagrams from unknown peers.
+ *
+ * A fixed-size table of token buckets, indexed by a SipHash of the
+ * source address so an attacker cannot aim for collisions.  Lookup,
+ * refill and charge are O(1) with no allocation and no logging, which
+ * makes the table safe to consult on every raw datagram before any
+ * per-packet work is done on behalf of an unauthenticated source.
+ */
+
+#ifndef SRCLIMIT_H
+#define SRCLIMIT_H
+
+#include "basic.h"
+#include "socket.h"
+
+struct srclimit_entry
+{
+    uint64_t id;                /* full source hash, 0 = slot empty */
+    int tokens;
+    time_t last_fill;
+};
+
+struct srclimit
+{
+    struct srclimit_entry *slots; /* power-of-two sized table, or NULL */
+    unsigned int mask;
+    int rate;                   /* tokens credited per second */
+    int burst;                  /* bucket size */
+    uint64_t key[2];            /* random SipHash key */
+};
+
+/* default number of table slots; at 24 bytes a slot this is ~100KB */
+#define SRCLIMIT_DEFAULT_SIZE 4096
+
+void srclimit_init(struct srclimit *sl, int rate, int size);
+
+void srclimit_free(struct srclimit *sl);
+
+/*
+ * Charge one datagram from the given source against its bucket.
+ * Returns false when the source has exceeded its rate and the packet
+ * should be dropped without further processing.
+ */
+bool srclimit_allow(struct srclimit *sl, const struct openvpn_sockaddr *from,
+                    time_t now);
+
+static inline bool
+srclimit_defined(const struct srclimit *sl)
+{
+    return sl->slots != NULL;
+}
+
+#endif /* ifndef SRCLIMIT_H */
@@ -52,9 +52,13 @@
 #include "perf.h"
 #include "status.h"
 #include "gremlin.h"
+#include "intern.h"
 #include "pkcs11.h"
 #include "route.h"
 #include "tls_crypt.h"
+#ifdef TARGET_LINUX
+#include "dco_linux.h"
+#endif
 
 #include "ssl.h"
 #include "ssl_verify.h"
@@ -249,9 +253,12 @@ static const tls_cipher_name_pair tls_cipher_name_translation_table[] = {
  * @param ctx                   Encrypt/decrypt key context
  * @param key                   HMAC key, used to calculate implicit IV
  * @param key_len               HMAC key length
+ * @param pid64                 64-bit packet IDs negotiated; the explicit
+ *                              IV part grows to 8 bytes
  */
 static void
-key_ctx_update_implicit_iv(struct key_ctx *ctx, uint8_t *key, size_t key_len);
+key_ctx_update_implicit_iv(struct key_ctx *ctx, uint8_t *key, size_t key_len,
+                           bool pid64);
 
 const tls_cipher_name_pair *
 tls_get_cipher_name_pair(const char *cipher_name, size_t len)
@@ -548,6 +555,11 @@ tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
     /* if something goes wrong with stat(), we'll store 0 as mtime */
     platform_stat_t crl_stat = {0};
 
+#ifdef ENABLE_WORKER_THREADS
+    /* install the result of a previously started background parse */
+    backend_tls_ctx_crl_collect(ssl_ctx);
+#endif
+
     /*
      * an inline CRL can't change at runtime, therefore there is no need to
      * reload it. It will be reloaded upon config change + SIGHUP.
@@ -575,11 +587,41 @@ tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
         return;
     }
 
+#ifdef ENABLE_WORKER_THREADS
+    /* hand the expensive re-parse to a worker thread; handshakes keep
+     * using the previously loaded CRL until the parse completes */
+    const int async = backend_tls_ctx_reload_crl_async(ssl_ctx, crl_file,
+                                                       crl_file_inline);
+    if (async == CRL_RELOAD_STARTED)
+    {
+        ssl_ctx->crl_last_mtime = crl_stat.st_mtime;
+        ssl_ctx->crl_last_size = crl_stat.st_size;
+        return;
+    }
+    else if (async == CRL_RELOAD_BUSY)
+    {
+        /* leave crl_last_* untouched so the change is retried once the
+         * running parse has been collected */
+        return;
+    }
+#endif
+
     ssl_ctx->crl_last_mtime = crl_stat.st_mtime;
     ssl_ctx->crl_last_size = crl_stat.st_size;
     backend_tls_ctx_reload_crl(ssl_ctx, crl_file, crl_file_inline);
 }
 
+void
+tls_ctx_reload_crl_now(struct tls_root_ctx *ssl_ctx, const char *crl_file,
+                       bool crl_file_inline)
+{
+    /* forget the cached stat so the file is re-parsed even if its
+     * mtime and size are unchanged */
+    ssl_ctx->crl_last_mtime = 0;
+    ssl_ctx->crl_last_size = 0;
+    tls_ctx_reload_crl(ssl_ctx, crl_file, crl_file_inline);
+}
+
 /*
  * Initialize SSL context.
  * All files are in PEM format.
@@ -700,8 +742,10 @@ init_ssl(const struct options *options, struct tls_root_ctx *new_ctx)
     /* Check certificate notBefore and notAfter */
     tls_ctx_check_cert_time(new_ctx);
 
-    /* Read CRL */
-    if (options->crl_file && !(options->ssl_flags & SSLF_CRL_VERIFY_DIR))
+    /* Read CRL -- in dir and index modes the CRL is consulted by
+     * verify_cert() instead of being loaded into the TLS library */
+    if (options->crl_file
+        && !(options->ssl_flags & (SSLF_CRL_VERIFY_DIR | SSLF_CRL_INDEX)))
     {
         tls_ctx_reload_crl(new_ctx, options->crl_file, options->crl_file_inline);
     }
@@ -950,6 +994,13 @@ key_state_init(struct tls_session *session, struct key_state *ks)
         packet_id_init(&ks->crypto_options.packet_id,
                        session->opt->replay_window, session->opt->replay_time, "SSL",
                        ks->key_id);
+        packet_id_rec_set_stats_sink(&ks->crypto_options.packet_id.rec,
+                                     session->replay_stats_sink);
+        if (session->opt->replay_adaptive)
+        {
+            packet_id_rec_set_adaptive(&ks->crypto_options.packet_id.rec,
+                                       MAX_SEQ_BACKTRACK);
+        }
     }
 
     ks->crypto_options.pid_persist = NULL;
@@ -992,6 +1043,13 @@ key_state_free(struct key_state *ks, bool clear)
     free(ks->rec_ack);
     free(ks->key_src);
 
+    if (ks->migrate_key2)
+    {
+        secure_memzero(ks->migrate_key2, sizeof(*ks->migrate_key2));
+        free(ks->migrate_key2);
+        ks->migrate_key2 = NULL;
+    }
+
     packet_id_free(&ks->crypto_options.packet_id);
 
 #ifdef PLUGIN_DEF_AUTH
@@ -1061,6 +1119,9 @@ tls_session_init(struct tls_multi *multi, struct tls_session *session)
     /* Set options data to point to parent's option structure */
     session->opt = &multi->opt;
 
+    /* accumulate replay drop statistics across rekeys */
+    session->replay_stats_sink = &multi->replay_stats;
+
     /* Randomize session # if it is 0 */
     while (!session_id_defined(&session->session_id))
     {
@@ -1128,7 +1189,7 @@ tls_session_free(struct tls_session *session, bool clear)
         key_state_free(&session->key[i], false);
     }
 
-    free(session->common_name);
+    string_intern_release(session->common_name);
 
     cert_hash_free(session->cert_hash_set);
 
@@ -1585,7 +1646,13 @@ key_source2_print(const struct key_source2 *k)
 /*
  * Generate the hash required by for the \c tls1_PRF function.
  *
+ * The two HMAC contexts are supplied by the caller so that they can be
+ * reused across the multiple invocations a key expansion needs; the
+ * function (re-)keys them and wipes the key before returning.
+ *
  * @param md_kt         Message digest to use
+ * @param ctx           HMAC context to use (keyed by this function)
+ * @param ctx_tmp       Scratch HMAC context (keyed by this function)
  * @param sec           Secret to base the hash on
  * @param sec_len       Length of the secret
  * @param seed          Seed to hash
@@ -1595,6 +1662,8 @@ key_source2_print(const struct key_source2 *k)
  */
 static void
 tls1_P_hash(const md_kt_t *md_kt,
+            hmac_ctx_t *ctx,
+            hmac_ctx_t *ctx_tmp,
             const uint8_t *sec,
             int sec_len,
             const uint8_t *seed,
@@ -1610,9 +1679,6 @@ tls1_P_hash(const md_kt_t *md_kt,
     const uint8_t *out_orig = out;
 #endif
 
-    hmac_ctx_t *ctx = hmac_ctx_new();
-    hmac_ctx_t *ctx_tmp = hmac_ctx_new();
-
     dmsg(D_SHOW_KEY_SOURCE, "tls1_P_hash sec: %s", format_hex(sec, sec_len, 0, &gc));
     dmsg(D_SHOW_KEY_SOURCE, "tls1_P_hash seed: %s", format_hex(seed, seed_len, 0, &gc));
 
@@ -1648,9 +1714,7 @@ tls1_P_hash(const md_kt_t *md_kt,
         }
     }
     hmac_ctx_cleanup(ctx);
-    hmac_ctx_free(ctx);
     hmac_ctx_cleanup(ctx_tmp);
-    hmac_ctx_free(ctx_tmp);
     secure_memzero(A1, sizeof(A1));
 
     dmsg(D_SHOW_KEY_SOURCE, "tls1_P_hash out: %s", format_hex(out_orig, olen_orig, 0, &gc));
@@ -1677,7 +1741,9 @@ tls1_P_hash(const md_kt_t *md_kt,
  * (2) The pre-master secret is generated by the client.
  */
 static void
-tls1_PRF(const uint8_t *label,
+tls1_PRF(hmac_ctx_t *ctx,
+         hmac_ctx_t *ctx_tmp,
+         const uint8_t *label,
          int label_len,
          const uint8_t *sec,
          int slen,
@@ -1695,8 +1761,8 @@ tls1_PRF(const uint8_t *label,
     const uint8_t *S2 = &(sec[len]);
     len += (slen&1); /* add for odd, make longer */
 
-    tls1_P_hash(md5,S1,len,label,label_len,out1,olen);
-    tls1_P_hash(sha1,S2,len,label,label_len,out2,olen);
+    tls1_P_hash(md5, ctx, ctx_tmp, S1, len, label, label_len, out1, olen);
+    tls1_P_hash(sha1, ctx, ctx_tmp, S2, len, label, label_len, out2, olen);
 
     for (int i = 0; i<olen; i++)
     {
@@ -1711,7 +1777,9 @@ tls1_PRF(const uint8_t *label,
 }
 
 static void
-openvpn_PRF(const uint8_t *secret,
+openvpn_PRF(hmac_ctx_t *ctx,
+            hmac_ctx_t *ctx_tmp,
+            const uint8_t *secret,
             int secret_len,
             const char *label,
             const uint8_t *client_seed,
@@ -1744,7 +1812,8 @@ openvpn_PRF(const uint8_t *secret,
     }
 
     /* compute PRF */
-    tls1_PRF(BPTR(&seed), BLEN(&seed), secret, secret_len, output, output_len);
+    tls1_PRF(ctx, ctx_tmp, BPTR(&seed), BLEN(&seed), secret, secret_len,
+             output, output_len);
 
     buf_clear(&seed);
     free_buf(&seed);
@@ -1752,11 +1821,12 @@ openvpn_PRF(const uint8_t *secret,
     VALGRIND_MAKE_READABLE((void *)output, output_len);
 }
 
-static void
+void
 init_key_contexts(struct key_ctx_bi *key,
                   const struct key_type *key_type,
                   bool server,
-                  struct key2 *key2)
+                  struct key2 *key2,
+                  bool pid64)
 {
     /* Initialize key contexts */
     int key_direction = server ? KEY_DIRECTION_INVERSE : KEY_DIRECTION_NORMAL;
@@ -1764,9 +1834,9 @@ init_key_contexts(struct key_ctx_bi *key,
 
     /* Initialize implicit IVs */
     key_ctx_update_implicit_iv(&key->encrypt, (*key2).keys[(int)server].hmac,
-                               MAX_HMAC_KEY_LENGTH);
+                               MAX_HMAC_KEY_LENGTH, pid64);
     key_ctx_update_implicit_iv(&key->decrypt, (*key2).keys[1-(int)server].hmac,
-                               MAX_HMAC_KEY_LENGTH);
+                               MAX_HMAC_KEY_LENGTH, pid64);
 
 }
 
@@ -1800,8 +1870,15 @@ generate_key_expansion_openvpn_prf(const struct tls_session *session)
     /* debugging print of source key material */
     key_source2_print(key_src);
 
+    /* One context pair serves all four P_hash passes of a key expansion,
+     * so a renegotiation does not repeatedly allocate and free HMAC
+     * contexts on the main thread. */
+    hmac_ctx_t *ctx = hmac_ctx_get();
+    hmac_ctx_t *ctx_tmp = hmac_ctx_get();
+
     /* compute master secret */
-    openvpn_PRF(key_src->client.pre_master,
+    openvpn_PRF(ctx, ctx_tmp,
+                key_src->client.pre_master,
                 sizeof(key_src->client.pre_master),
                 KEY_EXPANSION_ID " master secret",
                 key_src->client.random1,
@@ -1815,7 +1892,8 @@ generate_key_expansion_openvpn_prf(const struct tls_session *session)
 
     struct key2 key2;
     /* compute key expansion */
-    openvpn_PRF(master,
+    openvpn_PRF(ctx, ctx_tmp,
+                master,
                 sizeof(master),
                 KEY_EXPANSION_ID " key expansion",
                 key_src->client.random2,
@@ -1827,6 +1905,8 @@ generate_key_expansion_openvpn_prf(const struct tls_session *session)
                 (uint8_t *)key2.keys,
                 sizeof(key2.keys));
     secure_memzero(&master, sizeof(master));
+    hmac_ctx_put(ctx);
+    hmac_ctx_put(ctx_tmp);
 
     /*
      * fixup_key only correctly sets DES parity bits if the cipher is a
@@ -1849,6 +1929,122 @@ generate_key_expansion_openvpn_prf(const struct tls_session *session)
     return key2;
 }
 
+/*
+ * HKDF-Expand [RFC5869].  ctx must already be keyed with the PRK; each
+ * output block is one HMAC pass over T(i-1) | info | counter, so the
+ * whole expansion reuses the single keyed context -- no per-block
+ * re-init, and half the hash passes of the MD5+SHA1 PRF.
+ */
+static void
+hkdf_expand(hmac_ctx_t *ctx,
+            const uint8_t *info,
+            int info_len,
+            uint8_t *out,
+            int olen)
+{
+    uint8_t T[MAX_HMAC_KEY_LENGTH] = { 0 };
+    const int chunk = hmac_ctx_size(ctx);
+    int T_len = 0;
+    uint8_t counter = 1;
+
+    ASSERT(olen <= 255 * chunk);
+
+    while (olen > 0)
+    {
+        hmac_ctx_reset(ctx);
+        hmac_ctx_update(ctx, T, T_len);
+        hmac_ctx_update(ctx, info, info_len);
+        hmac_ctx_update(ctx, &counter, 1);
+        hmac_ctx_final(ctx, T);
+        T_len = chunk;
+
+        const int n = min_int(olen, chunk);
+        memcpy(out, T, n);
+        out += n;
+        olen -= n;
+        ++counter;
+    }
+    secure_memzero(T, sizeof(T));
+}
+
+/*
+ * HKDF-SHA256 based replacement for the double-PRF key expansion,
+ * negotiated via IV_PROTO_HKDF_EXPANSION.  Extract condenses the
+ * pre-master secret under the handshake randoms, Expand derives the
+ * whole key block with one keyed context, which keeps renegotiation
+ * storms off the MD5+SHA1 path entirely.
+ */
+static struct key2
+generate_key_expansion_openvpn_hkdf(const struct tls_session *session)
+{
+    const struct key_state *ks = &session->key[KS_PRIMARY];
+    const struct key_source2 *key_src = ks->key_src;
+
+    const struct session_id *client_sid = session->opt->server ?
+                                          &ks->session_id_remote : &session->session_id;
+    const struct session_id *server_sid = !session->opt->server ?
+                                          &ks->session_id_remote : &session->session_id;
+
+    /* debugging print of source key material */
+    key_source2_print(key_src);
+
+    const md_kt_t *sha256 = md_kt_get("SHA256");
+    uint8_t prk[MAX_HMAC_KEY_LENGTH];
+    hmac_ctx_t *ctx = hmac_ctx_get();
+
+    /* HKDF-Extract: salt = label | randoms, IKM = pre-master secret */
+    struct buffer salt = alloc_buf(strlen(KEY_EXPANSION_ID " hkdf extract")
+                                   + sizeof(key_src->client.random1)
+                                   + sizeof(key_src->server.random1));
+    ASSERT(buf_write(&salt, KEY_EXPANSION_ID " hkdf extract",
+                     strlen(KEY_EXPANSION_ID " hkdf extract")));
+    ASSERT(buf_write(&salt, key_src->client.random1,
+                     sizeof(key_src->client.random1)));
+    ASSERT(buf_write(&salt, key_src->server.random1,
+                     sizeof(key_src->server.random1)));
+
+    hmac_ctx_init(ctx, BPTR(&salt), BLEN(&salt), sha256);
+    hmac_ctx_update(ctx, key_src->client.pre_master,
+                    sizeof(key_src->client.pre_master));
+    hmac_ctx_final(ctx, prk);
+    free_buf(&salt);
+
+    /* HKDF-Expand: info = label | randoms | session ids */
+    struct buffer info = alloc_buf(strlen(KEY_EXPANSION_ID " hkdf expand")
+                                   + sizeof(key_src->client.random2)
+                                   + sizeof(key_src->server.random2)
+                                   + SID_SIZE * 2);
+    ASSERT(buf_write(&info, KEY_EXPANSION_ID " hkdf expand",
+                     strlen(KEY_EXPANSION_ID " hkdf expand")));
+    ASSERT(buf_write(&info, key_src->client.random2,
+                     sizeof(key_src->client.random2)));
+    ASSERT(buf_write(&info, key_src->server.random2,
+                     sizeof(key_src->server.random2)));
+    ASSERT(buf_write(&info, client_sid->id, SID_SIZE));
+    ASSERT(buf_write(&info, server_sid->id, SID_SIZE));
+
+    struct key2 key2;
+    hmac_ctx_init(ctx, prk, md_kt_size(sha256), sha256);
+    hkdf_expand(ctx, BPTR(&info), BLEN(&info),
+                (uint8_t *)key2.keys, sizeof(key2.keys));
+
+    hmac_ctx_cleanup(ctx);
+    hmac_ctx_put(ctx);
+    secure_memzero(prk, sizeof(prk));
+    free_buf(&info);
+
+    VALGRIND_MAKE_READABLE((void *)key2.keys, sizeof(key2.keys));
+
+    /* same DES parity fixup as the PRF path, for the legacy ciphers */
+    for (int i = 0; i < 2; ++i)
+    {
+        fixup_key(&key2.keys[i], &session->opt->key_type);
+    }
+    key2.n = 2;
+
+    return key2;
+}
+
 /*
  * Using source entropy from local and remote hosts, mix into
  * master key.
@@ -1876,6 +2072,10 @@ generate_key_expansion(struct key_ctx_bi *key,
             goto exit;
         }
     }
+    else if (session->opt->crypto_flags & CO_USE_HKDF_KEY_EXPANSION)
+    {
+        key2 = generate_key_expansion_openvpn_hkdf(session);
+    }
     else
     {
         key2 = generate_key_expansion_openvpn_prf(session);
@@ -1893,7 +2093,34 @@ generate_key_expansion(struct key_ctx_bi *key,
             goto exit;
         }
     }
-    init_key_contexts(key, &session->opt->key_type, server, &key2);
+    init_key_contexts(key, &session->opt->key_type, server, &key2,
+                      (session->opt->crypto_flags & CO_PACKET_ID_64));
+
+#ifdef TARGET_LINUX
+    /*
+     * This is the only point where the raw data channel key material
+     * still exists, so the kernel offload copy has to happen here,
+     * before the wipe below.
+     */
+    if (dco_enabled(session->opt->dco))
+    {
+        dco_install_key(session->opt->dco, session->opt->dco_peer_id,
+                        session->key[KS_PRIMARY].key_id,
+                        &session->opt->key_type, &key2, server);
+    }
+#endif
+
+    /* --float-migration: retain the raw key material so the session can
+     * be handed over to a sibling process later */
+    if (session->opt->migrate)
+    {
+        struct key_state *ks = &session->key[KS_PRIMARY];
+        if (!ks->migrate_key2)
+        {
+            ALLOC_OBJ(ks->migrate_key2, struct key2);
+        }
+        *ks->migrate_key2 = key2;
+    }
     ret = true;
 
 exit:
@@ -1903,7 +2130,8 @@ exit:
 }
 
 static void
-key_ctx_update_implicit_iv(struct key_ctx *ctx, uint8_t *key, size_t key_len)
+key_ctx_update_implicit_iv(struct key_ctx *ctx, uint8_t *key, size_t key_len,
+                           bool pid64)
 {
     const cipher_kt_t *cipher_kt = cipher_ctx_get_cipher_kt(ctx->cipher);
 
@@ -1912,7 +2140,8 @@ key_ctx_update_implicit_iv(struct key_ctx *ctx, uint8_t *key, size_t key_len)
     {
         size_t impl_iv_len = 0;
         ASSERT(cipher_kt_iv_size(cipher_kt) >= OPENVPN_AEAD_MIN_IV_LEN);
-        impl_iv_len = cipher_kt_iv_size(cipher_kt) - sizeof(packet_id_type);
+        impl_iv_len = cipher_kt_iv_size(cipher_kt)
+                      - (pid64 ? sizeof(uint64_t) : sizeof(packet_id_type));
         ASSERT(impl_iv_len <= OPENVPN_MAX_IV_LENGTH);
         ASSERT(impl_iv_len <= key_len);
         memcpy(ctx->implicit_iv, key, impl_iv_len);
@@ -1982,6 +2211,23 @@ tls_session_update_crypto_params(struct tls_session *session,
     {
         session->opt->crypto_flags |= CO_USE_TLS_KEY_MATERIAL_EXPORT;
     }
+    else if (options->data_channel_use_hkdf)
+    {
+        session->opt->crypto_flags |= CO_USE_HKDF_KEY_EXPANSION;
+    }
+
+    /* 64-bit packet IDs are negotiated for AEAD ciphers only, where the
+     * packet ID doubles as the explicit IV part */
+    session->opt->crypto_flags &= ~(CO_PACKET_ID_64);
+    if (options->data_channel_pkt_id_64
+        && strcmp(options->ciphername, "none") != 0)
+    {
+        const cipher_kt_t *cipher = cipher_kt_get(options->ciphername);
+        if (cipher && cipher_kt_mode_aead(cipher))
+        {
+            session->opt->crypto_flags |= CO_PACKET_ID_64;
+        }
+    }
 
     if (strcmp(options->ciphername, session->opt->config_ciphername))
     {
@@ -2011,10 +2257,14 @@ tls_session_update_crypto_params(struct tls_session *session,
         session->opt->crypto_flags |= CO_PACKET_ID_LONG_FORM;
     }
 
+    /* The long form and the 64-bit format both carry 8 bytes on the wire */
+    const bool packet_id_8byte = packet_id_long_form
+                                 || (session->opt->crypto_flags & CO_PACKET_ID_64);
+
     /* Update frame parameters: undo worst-case overhead, add actual overhead */
     frame_remove_from_extra_frame(frame, crypto_max_overhead());
     crypto_adjust_frame_parameters(frame, &session->opt->key_type,
-                                   options->replay, packet_id_long_form);
+                                   options->replay, packet_id_8byte);
     frame_finalize(frame, options->ce.link_mtu_defined, options->ce.link_mtu,
                    options->ce.tun_mtu_defined, options->ce.tun_mtu);
     frame_init_mssfix(frame, options);
@@ -2031,7 +2281,7 @@ tls_session_update_crypto_params(struct tls_session *session,
     {
         frame_remove_from_extra_frame(frame_fragment, crypto_max_overhead());
         crypto_adjust_frame_parameters(frame_fragment, &session->opt->key_type,
-                                       options->replay, packet_id_long_form);
+                                       options->replay, packet_id_8byte);
         frame_set_mtu_dynamic(frame_fragment, options->ce.fragment, SET_MTU_UPPER_BOUND);
         frame_print(frame_fragment, D_MTU_INFO, "Fragmentation MTU parms");
     }
@@ -2270,6 +2520,7 @@ push_peer_info(struct buffer *buf, struct tls_session *session)
         if (session->opt->pull)
         {
             iv_proto |= IV_PROTO_REQUEST_PUSH;
+            iv_proto |= IV_PROTO_PUSH_DIGEST;
         }
 
         /* support for Negotiable Crypto Parameters */
@@ -2287,10 +2538,31 @@ push_peer_info(struct buffer *buf, struct tls_session *session)
 #ifdef HAVE_EXPORT_KEYING_MATERIAL
             iv_proto |= IV_PROTO_TLS_KEY_EXPORT;
 #endif
+            iv_proto |= IV_PROTO_HKDF_EXPANSION;
         }
 
+        /* support for 64-bit AEAD data channel packet IDs.  The kernel
+         * data channel offload only understands 32-bit packet IDs, so do
+         * not offer the wide format when it is in use. */
+#ifdef TARGET_LINUX
+        if (!dco_enabled(session->opt->dco))
+        {
+            iv_proto |= IV_PROTO_PKT_ID_64;
+        }
+#else
+        iv_proto |= IV_PROTO_PKT_ID_64;
+#endif
+
         buf_printf(&out, "IV_PROTO=%d\n", iv_proto);
 
+        /* echo the digest of the push set we still have applied, so the
+         * server can answer with a diff reply instead of resending an
+         * unchanged set */
+        if (session->opt->push_digest)
+        {
+            buf_printf(&out, "IV_PUSH_DIGEST=%s\n", session->opt->push_digest);
+        }
+
         /* push compression status */
 #ifdef USE_COMP
         comp_generate_peer_info_string(&session->opt->comp_options, &out);
@@ -2727,7 +2999,9 @@ tls_process(struct tls_multi *multi,
                 && ks->n_bytes >= session->opt->renegotiate_bytes)
             || (session->opt->renegotiate_packets
                 && ks->n_packets >= session->opt->renegotiate_packets)
-            || (packet_id_close_to_wrapping(&ks->crypto_options.packet_id.send))))
+            || (packet_id_close_to_wrapping(&ks->crypto_options.packet_id.send,
+                                            (ks->crypto_options.flags
+                                             & CO_PACKET_ID_64)))))
     {
         msg(D_TLS_DEBUG_LOW, "TLS: soft reset sec=%d/%d bytes=" counter_format
             "/%d pkts=" counter_format "/%d",
@@ -2818,7 +3092,7 @@ tls_process(struct tls_multi *multi,
              * the file was not modified since the last reload
              */
             if (session->opt->crl_file
-                && !(session->opt->ssl_flags & SSLF_CRL_VERIFY_DIR))
+                && !(session->opt->ssl_flags & (SSLF_CRL_VERIFY_DIR | SSLF_CRL_INDEX)))
             {
                 tls_ctx_reload_crl(&session->opt->ssl_ctx,
                                    session->opt->crl_file, session->opt->crl_file_inline);
@@ -2987,6 +3261,9 @@ tls_process(struct tls_multi *multi,
             buf = reliable_get_buf_output_sequenced(ks->send_reliable);
             if (buf)
             {
+                /* TLS records can be up to full frame size */
+                buf = reliable_buf_promote(ks->send_reliable, buf,
+                                           PAYLOAD_SIZE_DYNAMIC(&multi->opt.frame));
                 int status = key_state_read_ciphertext(&ks->ks_ssl, buf, PAYLOAD_SIZE_DYNAMIC(&multi->opt.frame));
                 if (status == -1)
                 {
@@ -3014,7 +3291,7 @@ tls_process(struct tls_multi *multi,
         struct buffer buf = ks->ack_write_buf;
         ASSERT(buf_init(&buf, FRAME_HEADROOM(&multi->opt.frame)));
         write_control_auth(session, ks, &buf, to_link_addr, P_ACK_V1,
-                           RELIABLE_ACK_SIZE, false);
+                           RELIABLE_ACK_WRITE_MAX, false);
         *to_link = buf;
         active = true;
         dmsg(D_TLS_DEBUG, "Dedicated ACK -> TCP/UDP");
@@ -3039,6 +3316,15 @@ tls_process(struct tls_multi *multi,
                                     ks->established + session->opt->renegotiate_seconds - now);
         }
 
+        /* an async crypto operation is in flight (--tls-async); re-poll
+         * the handshake at the next one-second wakeup instead of waiting
+         * for a control channel packet or coarse timeout */
+        if (key_state_ssl_async_pending(&ks->ks_ssl))
+        {
+            compute_earliest_wakeup(wakeup, 1);
+            active = true;
+        }
+
         /* prevent event-loop spinning by setting minimum wakeup of 1 second */
         if (*wakeup <= 0)
         {
@@ -3064,6 +3350,25 @@ error:
     return false;
 }
 
+int
+tls_multi_async_fd(struct tls_multi *multi)
+{
+    for (int i = 0; i < TM_SIZE; ++i)
+    {
+        struct tls_session *session = &multi->session[i];
+
+        for (int j = 0; j < KS_SIZE; ++j)
+        {
+            const int fd = key_state_ssl_async_fd(&session->key[j].ks_ssl);
+            if (fd >= 0)
+            {
+                return fd;
+            }
+        }
+    }
+    return -1;
+}
+
 /*
  * Called by the top-level event loop.
  *
@@ -3330,6 +3635,50 @@ done:
     gc_free(&gc);
 }
 
+/*
+ * Branch-minimal fast path for P_DATA_V2 against the primary key slot.
+ *
+ * Virtually all packets on an established tunnel are P_DATA_V2 carried
+ * by session[TM_ACTIVE].key[KS_PRIMARY], so this inline handles that
+ * case without the gc arena, the key-scan loop or the per-opcode
+ * re-tests of handle_data_channel_packet().  Any mismatch (renegotiation
+ * in progress, lame duck key, short packet) falls back to the full scan,
+ * as does a debug level high enough to want the key-select trace.
+ *
+ * Returns true if the packet was fully classified; *opt and *ad_start
+ * are then set up for decryption.
+ */
+static inline bool
+tls_pre_decrypt_data_v2_fast(struct tls_multi *multi,
+                             const struct link_socket_actual *from,
+                             struct buffer *buf,
+                             struct crypto_options **opt,
+                             bool floated,
+                             const uint8_t **ad_start)
+{
+    const int key_id = *BPTR(buf) & P_KEY_ID_MASK;
+    struct key_state *ks = &multi->session[TM_ACTIVE].key[KS_PRIMARY];
+
+    if (!(TLS_AUTHENTICATED(multi, ks)
+          && key_id == ks->key_id
+          && ks->authenticated == KS_AUTH_TRUE
+          && ks->crypto_options.key_ctx_bi.initialized
+          && (floated || link_socket_actual_match(from, &ks->remote_addr))
+          && buf->len >= 5
+          && !check_debug_level(D_TLS_KEYSELECT)))
+    {
+        return false;
+    }
+
+    *opt = &ks->crypto_options;
+    *ad_start = BPTR(buf);
+    ASSERT(buf_advance(buf, 4)); /* opcode/key-id byte plus 3-byte peer-id */
+
+    ++ks->n_packets;
+    ks->n_bytes += buf->len;
+    return true;
+}
+
 /*
  *
  * When we are in TLS mode, this is the first routine which sees
@@ -3371,19 +3720,59 @@ tls_pre_decrypt(struct tls_multi *multi,
         return false;
     }
 
-    struct gc_arena gc = gc_new();
-    bool ret = false;
-
     /* get opcode  */
     uint8_t pkt_firstbyte = *BPTR(buf);
     int op = pkt_firstbyte >> P_OPCODE_SHIFT;
 
-    if ((op == P_DATA_V1) || (op == P_DATA_V2))
+    /*
+     * Dispatch on the opcode.  The data channel cases come first and
+     * return without touching the gc arena; everything else is control
+     * channel traffic and falls through to the session matching below.
+     */
+    switch (op)
     {
-        handle_data_channel_packet(multi, from, buf, opt, floated, ad_start);
-        return false;
+        case P_DATA_V2:
+            if (tls_pre_decrypt_data_v2_fast(multi, from, buf, opt,
+                                             floated, ad_start))
+            {
+                return false;
+            }
+        /* fall through to the full key scan */
+        case P_DATA_V1:
+            handle_data_channel_packet(multi, from, buf, opt, floated, ad_start);
+            return false;
+
+        case P_CONTROL_SOFT_RESET_V1:
+        case P_CONTROL_V1:
+        case P_ACK_V1:
+        case P_CONTROL_HARD_RESET_CLIENT_V2:
+        case P_CONTROL_HARD_RESET_SERVER_V2:
+        case P_CONTROL_HARD_RESET_CLIENT_V3:
+            break;
+
+        default:
+        {
+            struct gc_arena errgc = gc_new();
+            if (op == P_CONTROL_HARD_RESET_CLIENT_V1
+                || op == P_CONTROL_HARD_RESET_SERVER_V1)
+            {
+                msg(D_TLS_ERRORS, "Peer tried unsupported key-method 1");
+            }
+            msg(D_TLS_ERRORS,
+                "TLS Error: unknown opcode received from %s op=%d",
+                print_link_socket_actual(from, &errgc), op);
+            gc_free(&errgc);
+            ++multi->n_soft_errors;
+            tls_clear_error();
+            buf->len = 0;
+            *opt = NULL;
+            return false;
+        }
     }
 
+    struct gc_arena gc = gc_new();
+    bool ret = false;
+
     /* get key_id */
     int key_id = pkt_firstbyte & P_KEY_ID_MASK;
 
@@ -3392,20 +3781,6 @@ tls_pre_decrypt(struct tls_multi *multi,
     bool new_link = false;
     struct session_id sid;         /* remote session ID */
 
-    /* verify legal opcode */
-    if (op < P_FIRST_OPCODE || op > P_LAST_OPCODE)
-    {
-        if (op == P_CONTROL_HARD_RESET_CLIENT_V1
-            || op == P_CONTROL_HARD_RESET_SERVER_V1)
-        {
-            msg(D_TLS_ERRORS, "Peer tried unsupported key-method 1");
-        }
-        msg(D_TLS_ERRORS,
-            "TLS Error: unknown opcode received from %s op=%d",
-            print_link_socket_actual(from, &gc), op);
-        goto error;
-    }
-
     /* hard reset ? */
     if (is_hard_reset_method2(op))
     {
@@ -3440,37 +3815,61 @@ tls_pre_decrypt(struct tls_multi *multi,
         }
     }
 
-    int i;
-    /* use session ID to match up packet with appropriate tls_session object */
-    for (i = 0; i < TM_SIZE; ++i)
+    /*
+     * Use the remote session ID to match up the packet with the
+     * appropriate tls_session object.  Consecutive control packets
+     * almost always belong to the same session (handshake and
+     * renegotiation run as bursts), so first try the slot that matched
+     * last time and fall back to scanning all slots on a miss.
+     */
+    int i = multi->session_sid_hint;
+    if (session_id_equal(&multi->session[i].key[KS_PRIMARY].session_id_remote,
+                         &sid))
     {
-        struct tls_session *session = &multi->session[i];
-        struct key_state *ks = &session->key[KS_PRIMARY];
-
+        if (i == TM_LAME_DUCK)
+        {
+            msg(D_TLS_ERRORS,
+                "TLS ERROR: received control packet with stale session-id=%s",
+                session_id_print(&sid, &gc));
+            goto error;
+        }
         dmsg(D_TLS_DEBUG,
-             "TLS: initial packet test, i=%d state=%s, mysid=%s, rec-sid=%s, rec-ip=%s, stored-sid=%s, stored-ip=%s",
-             i,
-             state_name(ks->state),
-             session_id_print(&session->session_id, &gc),
-             session_id_print(&sid, &gc),
-             print_link_socket_actual(from, &gc),
-             session_id_print(&ks->session_id_remote, &gc),
-             print_link_socket_actual(&ks->remote_addr, &gc));
-
-        if (session_id_equal(&ks->session_id_remote, &sid))
-        /* found a match */
+             "TLS: found match, session[%d], sid=%s",
+             i, session_id_print(&sid, &gc));
+    }
+    else
+    {
+        for (i = 0; i < TM_SIZE; ++i)
         {
-            if (i == TM_LAME_DUCK)
+            struct tls_session *session = &multi->session[i];
+            struct key_state *ks = &session->key[KS_PRIMARY];
+
+            dmsg(D_TLS_DEBUG,
+                 "TLS: initial packet test, i=%d state=%s, mysid=%s, rec-sid=%s, rec-ip=%s, stored-sid=%s, stored-ip=%s",
+                 i,
+                 state_name(ks->state),
+                 session_id_print(&session->session_id, &gc),
+                 session_id_print(&sid, &gc),
+                 print_link_socket_actual(from, &gc),
+                 session_id_print(&ks->session_id_remote, &gc),
+                 print_link_socket_actual(&ks->remote_addr, &gc));
+
+            if (session_id_equal(&ks->session_id_remote, &sid))
+            /* found a match */
             {
-                msg(D_TLS_ERRORS,
-                    "TLS ERROR: received control packet with stale session-id=%s",
-                    session_id_print(&sid, &gc));
-                goto error;
+                multi->session_sid_hint = i;
+                if (i == TM_LAME_DUCK)
+                {
+                    msg(D_TLS_ERRORS,
+                        "TLS ERROR: received control packet with stale session-id=%s",
+                        session_id_print(&sid, &gc));
+                    goto error;
+                }
+                dmsg(D_TLS_DEBUG,
+                     "TLS: found match, session[%d], sid=%s",
+                     i, session_id_print(&sid, &gc));
+                break;
             }
-            dmsg(D_TLS_DEBUG,
-                 "TLS: found match, session[%d], sid=%s",
-                 i, session_id_print(&sid, &gc));
-            break;
         }
     }
 
@@ -3720,6 +4119,7 @@ tls_pre_decrypt(struct tls_multi *multi,
                     /* Save incoming ciphertext packet to reliable buffer */
                     struct buffer *in = reliable_get_buf(ks->rec_reliable);
                     ASSERT(in);
+                    in = reliable_buf_promote(ks->rec_reliable, in, BLEN(buf));
                     if (!buf_copy(in, buf))
                     {
                         msg(D_MULTI_DROPPED,
@@ -3747,6 +4147,47 @@ error:
     goto done;
 }
 
+/*
+ * Verify the --tls-auth HMAC of an initial packet directly from the wire
+ * layout:
+ *
+ *   [op/key-id (1)] [session-id (8)] [HMAC] [packet-id (8)] [payload]
+ *
+ * The authenticated data order is packet-id, op/session-id, payload --
+ * the same order openvpn_decrypt() sees after swap_hmac().  Screening
+ * the live buffer avoids the per-packet clone and header shuffle of the
+ * full unwrap path, and the persistent HMAC context in the standalone
+ * wrap state retains its precomputed inner/outer key pads across
+ * packets, which is what bounds our drop rate during handshake floods.
+ */
+static bool
+tls_auth_standalone_check_hmac(const struct tls_auth_standalone *tas,
+                               const struct buffer *buf)
+{
+    const struct key_ctx *ctx = &tas->tls_wrap.opt.key_ctx_bi.decrypt;
+    ASSERT(ctx->hmac);
+
+    const int hmac_len = hmac_ctx_size(ctx->hmac);
+    const int pid_size = packet_id_size(true);
+    const int osid_size = 1 + SID_SIZE;
+    uint8_t local_hmac[MAX_HMAC_KEY_LENGTH];
+    const uint8_t *b = BPTR(buf);
+
+    if (buf->len < osid_size + hmac_len + pid_size)
+    {
+        return false;
+    }
+
+    hmac_ctx_reset(ctx->hmac);
+    hmac_ctx_update(ctx->hmac, b + osid_size + hmac_len, pid_size);
+    hmac_ctx_update(ctx->hmac, b, osid_size);
+    hmac_ctx_update(ctx->hmac, b + osid_size + hmac_len + pid_size,
+                    buf->len - (osid_size + hmac_len + pid_size));
+    hmac_ctx_final(ctx->hmac, local_hmac);
+
+    return memcmp_constant_time(local_hmac, b + osid_size, hmac_len) == 0;
+}
+
 /*
  * This function is similar to tls_pre_decrypt, except it is called
  * when we are in server mode and receive an initial incoming
@@ -3811,20 +4252,35 @@ tls_pre_decrypt_lite(const struct tls_auth_standalone *tas,
     }
 
 
-    struct buffer newbuf = clone_buf(buf);
-    struct tls_wrap_ctx tls_wrap_tmp = tas->tls_wrap;
-
-    /* HMAC test, if --tls-auth was specified */
-    bool status = read_control_auth(&newbuf, &tls_wrap_tmp, from, NULL);
-    free_buf(&newbuf);
-    free_buf(&tls_wrap_tmp.tls_crypt_v2_metadata);
-    if (tls_wrap_tmp.cleanup_key_ctx)
+    if (tas->tls_wrap.mode == TLS_WRAP_AUTH)
     {
-        free_key_ctx_bi(&tls_wrap_tmp.opt.key_ctx_bi);
+        /* --tls-auth HMAC test, performed on the live packet without
+         * cloning the buffer or shuffling the header */
+        if (!tls_auth_standalone_check_hmac(tas, buf))
+        {
+            dmsg(D_TLS_STATE_ERRORS,
+                 "TLS State Error: HMAC prefilter failed for packet from %s",
+                 print_link_socket_actual(from, &gc));
+            goto error;
+        }
     }
-    if (!status)
+    else
     {
-        goto error;
+        struct buffer newbuf = clone_buf(buf);
+        struct tls_wrap_ctx tls_wrap_tmp = tas->tls_wrap;
+
+        /* HMAC test, if --tls-crypt was specified */
+        bool status = read_control_auth(&newbuf, &tls_wrap_tmp, from, NULL);
+        free_buf(&newbuf);
+        free_buf(&tls_wrap_tmp.tls_crypt_v2_metadata);
+        if (tls_wrap_tmp.cleanup_key_ctx)
+        {
+            free_key_ctx_bi(&tls_wrap_tmp.opt.key_ctx_bi);
+        }
+        if (!status)
+        {
+            goto error;
+        }
     }
 
     /*
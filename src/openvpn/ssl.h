@@ -76,13 +76,20 @@
  * Set the max number of acknowledgments that can "hitch a ride" on an outgoing
  * non-P_ACK_V1 control packet.
  */
-#define CONTROL_SEND_ACK_MAX 4
+#define CONTROL_SEND_ACK_MAX 8
 
 /*
  * Define number of buffers for send and receive in the reliability layer.
+ * The send buffer count only bounds memory -- the number of packets
+ * actually in flight is governed by the reliable layer's congestion
+ * window, which starts at RELIABLE_CWND_INITIAL and only grows while the
+ * peer keeps acknowledging.  Unpatched peers drop packets more than 8
+ * ahead of their receive window as sequence breakers; the resulting ACK
+ * silence shrinks the congestion window back, so probing beyond 8 is
+ * safe against them.
  */
-#define TLS_RELIABLE_N_SEND_BUFFERS  4 /* also window size for reliability layer */
-#define TLS_RELIABLE_N_REC_BUFFERS   8
+#define TLS_RELIABLE_N_SEND_BUFFERS  16
+#define TLS_RELIABLE_N_REC_BUFFERS   16
 
 /*
  * Various timeouts
@@ -119,6 +126,16 @@
 /** Supports key derivation via TLS key material exporter [RFC5705] */
 #define IV_PROTO_TLS_KEY_EXPORT (1<<3)
 
+/** Supports 64-bit packet IDs for the AEAD data channel */
+#define IV_PROTO_PKT_ID_64      (1<<4)
+
+/** Supports HKDF-SHA256 [RFC5869] data channel key expansion */
+#define IV_PROTO_HKDF_EXPANSION (1<<5)
+
+/** Understands the push-digest option and push-diff replies, and echoes
+ * the digest of its applied push set in IV_PUSH_DIGEST on reconnect */
+#define IV_PROTO_PUSH_DIGEST    (1<<6)
+
 /* Default field in X509 to be username */
 #define X509_USERNAME_FIELD_DEFAULT "CN"
 
@@ -158,6 +175,22 @@ void free_ssl_lib(void);
  */
 void init_ssl(const struct options *options, struct tls_root_ctx *ctx);
 
+/**
+ * Reload the CRL file into the SSL context unconditionally.
+ *
+ * Unlike the periodic per-handshake reload, this ignores the cached
+ * stat of the CRL file, so it swaps the store even when the file's
+ * mtime and size are unchanged.  Used by the management interface's
+ * verify-reload command.
+ *
+ * @param ssl_ctx       The TLS context to reload the CRL into.
+ * @param crl_file      The file name to load the CRL from, or the
+ *                      inline CRL itself.
+ * @param crl_file_inline True if \a crl_file is an inline CRL.
+ */
+void tls_ctx_reload_crl_now(struct tls_root_ctx *ssl_ctx,
+                            const char *crl_file, bool crl_file_inline);
+
 /** @addtogroup control_processor
  *  @{ */
 
@@ -252,6 +285,14 @@ int tls_multi_process(struct tls_multi *multi,
                       struct link_socket_info *to_link_socket_info,
                       interval_t *wakeup);
 
+/**
+ * Return the crypto library's wait file descriptor for an asynchronous
+ * operation currently in flight on any of the key states of this
+ * tls_multi, or -1 if none.  The descriptor may be registered with the
+ * event loop so that completion of the operation wakes the process.
+ */
+int tls_multi_async_fd(struct tls_multi *multi);
+
 
 /**************************************************************************/
 /**
@@ -499,6 +540,18 @@ bool tls_session_update_crypto_params(struct tls_session *session,
                                       struct frame *frame,
                                       struct frame *frame_fragment);
 
+/**
+ * Initialize the data channel key contexts (cipher, HMAC and implicit
+ * IVs for both directions) from raw key material.  Used during key
+ * expansion, and to rebuild the contexts from key material migrated in
+ * from a sibling process (--float-migration).
+ */
+void init_key_contexts(struct key_ctx_bi *key,
+                       const struct key_type *key_type,
+                       bool server,
+                       struct key2 *key2,
+                       bool pid64);
+
 /*
  * inline functions
  */
@@ -378,6 +378,27 @@ void key_state_ssl_init(struct key_state_ssl *ks_ssl,
  */
 void key_state_ssl_free(struct key_state_ssl *ks_ssl);
 
+/**
+ * Returns true if the SSL channel has an asynchronous crypto operation
+ * in flight (--tls-async), i.e. the handshake should be re-polled soon
+ * rather than waiting for the next control channel packet or coarse
+ * timeout.  Always false for backends without async support.
+ *
+ * @param ks_ssl        The SSL channel's state info
+ */
+bool key_state_ssl_async_pending(struct key_state_ssl *ks_ssl);
+
+/**
+ * Returns the crypto library's wait file descriptor for the async
+ * operation currently in flight on this SSL channel, or -1 if there is
+ * none.  The descriptor becomes readable when the operation completes
+ * and may be registered with the event loop; it is owned by the crypto
+ * library and disappears when the operation finishes.
+ *
+ * @param ks_ssl        The SSL channel's state info
+ */
+int key_state_ssl_async_fd(struct key_state_ssl *ks_ssl);
+
 /**
  * Reload the Certificate Revocation List for the SSL channel
  *
@@ -389,6 +410,34 @@ void key_state_ssl_free(struct key_state_ssl *ks_ssl);
 void backend_tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx,
                                 const char *crl_file, bool crl_inline);
 
+#ifdef ENABLE_WORKER_THREADS
+/** Return values of backend_tls_ctx_reload_crl_async() */
+#define CRL_RELOAD_STARTED      1  /**< background parse launched */
+#define CRL_RELOAD_BUSY         0  /**< previous parse still running, retry */
+#define CRL_RELOAD_UNSUPPORTED -1  /**< backend has no async reload */
+
+/**
+ * Kick off a background re-parse of the CRL file on a worker thread.
+ *
+ * The calling (event loop) thread keeps serving handshakes with the
+ * previously loaded CRL while the parse is running.  The parsed result
+ * is installed into the certificate store by a later call to
+ * backend_tls_ctx_crl_collect(), so all store manipulation stays on the
+ * main thread.
+ *
+ * @return CRL_RELOAD_STARTED, CRL_RELOAD_BUSY or CRL_RELOAD_UNSUPPORTED.
+ */
+int backend_tls_ctx_reload_crl_async(struct tls_root_ctx *ssl_ctx,
+                                     const char *crl_file, bool crl_inline);
+
+/**
+ * Install the result of a finished background CRL parse into the
+ * certificate store.  No-op while the parse is still running or when no
+ * parse is pending.  Must be called from the main thread.
+ */
+void backend_tls_ctx_crl_collect(struct tls_root_ctx *ssl_ctx);
+#endif /* ENABLE_WORKER_THREADS */
+
 #define EXPORT_KEY_DATA_LABEL       "EXPORTER-OpenVPN-datakeys"
 /**
  * Keying Material Exporters [RFC 5705] allows additional keying material to be
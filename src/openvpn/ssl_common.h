@@ -187,6 +187,13 @@ struct key_state
 
     struct key_source2 *key_src;       /* source entropy for key expansion */
 
+    /*
+     * Copy of the raw data channel key material, retained only when
+     * --float-migration is configured so an established session can be
+     * handed over to a sibling process.  Wiped on key_state_free().
+     */
+    struct key2 *migrate_key2;
+
     struct buffer plaintext_read_buf;
     struct buffer plaintext_write_buf;
     struct buffer ack_write_buf;
@@ -251,6 +258,9 @@ struct tls_options
     /* if true, don't xmit until first packet from peer is received */
     bool xmit_hold;
 
+    /* retain raw data channel keys for --float-migration hand-over */
+    bool migrate;
+
     /* local and remote options strings
      * that must match between client and server */
     const char *local_options;
@@ -259,10 +269,13 @@ struct tls_options
     /* from command line */
     bool replay;
     bool single_session;
+    bool tls_async;
     bool disable_occ;
     int mode;
     bool pull;
     int push_peer_info_detail;
+    const char *push_digest;    /* digest of our applied push set, echoed
+                                 * to the server as IV_PUSH_DIGEST */
     int transition_window;
     int handshake_window;
     interval_t packet_timeout;
@@ -272,6 +285,7 @@ struct tls_options
 
     /* cert verification parms */
     const char *verify_command;
+    int verify_cache_lifetime; /* --tls-verify-cache, 0 disables the cache */
     const char *verify_export_cert;
     int verify_x509_type;
     const char *verify_x509_name;
@@ -297,6 +311,7 @@ struct tls_options
 
     int replay_window;                 /* --replay-window parm */
     int replay_time;                   /* --replay-window parm */
+    bool replay_adaptive;              /* --replay-adaptive */
     bool tcp_mode;
 
     const char *config_ciphername;
@@ -345,6 +360,7 @@ struct tls_options
 #define SSLF_AUTH_USER_PASS_OPTIONAL  (1<<3)
 #define SSLF_OPT_VERIFY               (1<<4)
 #define SSLF_CRL_VERIFY_DIR           (1<<5)
+#define SSLF_CRL_INDEX                (1<<14)
 #define SSLF_TLS_VERSION_MIN_SHIFT    6
 #define SSLF_TLS_VERSION_MIN_MASK     0xF  /* (uses bit positions 6 to 9) */
 #define SSLF_TLS_VERSION_MAX_SHIFT    10
@@ -368,6 +384,12 @@ struct tls_options
     const char *ekm_label;
     size_t ekm_label_size;
     size_t ekm_size;
+
+#ifdef TARGET_LINUX
+    /* kernel data channel offload context, or NULL when not in use */
+    struct dco_context *dco;
+    uint32_t dco_peer_id;
+#endif
 };
 
 /** @addtogroup control_processor
@@ -405,6 +427,10 @@ struct tls_session
     /* const options and config info */
     struct tls_options *opt;
 
+    /* where data channel replay drop statistics accumulate; points into
+     * the owning tls_multi so that the counts survive rekeying */
+    struct packet_id_rec_stats *replay_stats_sink;
+
     /* during hard reset used to control burst retransmit */
     bool burst;
 
@@ -516,12 +542,24 @@ struct tls_multi
     int n_sessions;             /**< Number of sessions negotiated thus
                                  *   far. */
 
+    int session_sid_hint;       /**< Session slot whose remote session-id
+                                 *   matched the last incoming control
+                                 *   packet; tried first by
+                                 *   tls_pre_decrypt() before scanning
+                                 *   all slots. */
+
     /*
      * Number of errors.
      */
     int n_hard_errors; /* errors due to TLS negotiation failure */
     int n_soft_errors; /* errors due to unrecognized or failed-to-authenticate incoming packets */
 
+    /*
+     * Data channel replay window drop statistics, accumulated across
+     * key states (exported through the status output).
+     */
+    struct packet_id_rec_stats replay_stats;
+
     /*
      * Our locked common name, username, and cert hashes (cannot change during the life of this tls_multi object)
      */
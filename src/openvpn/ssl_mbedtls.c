@@ -1043,6 +1043,21 @@ err:
     mbedtls_x509_crl_free(ctx->crl);
 }
 
+#ifdef ENABLE_WORKER_THREADS
+int
+backend_tls_ctx_reload_crl_async(struct tls_root_ctx *ssl_ctx,
+                                 const char *crl_file, bool crl_inline)
+{
+    /* the mbed TLS backend reloads CRLs synchronously */
+    return CRL_RELOAD_UNSUPPORTED;
+}
+
+void
+backend_tls_ctx_crl_collect(struct tls_root_ctx *ssl_ctx)
+{
+}
+#endif /* ENABLE_WORKER_THREADS */
+
 void
 key_state_ssl_init(struct key_state_ssl *ks_ssl,
                    const struct tls_root_ctx *ssl_ctx, bool is_server,
@@ -1185,6 +1200,19 @@ key_state_ssl_free(struct key_state_ssl *ks_ssl)
     }
 }
 
+bool
+key_state_ssl_async_pending(struct key_state_ssl *ks_ssl)
+{
+    /* mbed TLS has no asynchronous handshake mode */
+    return false;
+}
+
+int
+key_state_ssl_async_fd(struct key_state_ssl *ks_ssl)
+{
+    return -1;
+}
+
 int
 key_state_write_plaintext(struct key_state_ssl *ks, struct buffer *buf)
 {
@@ -92,6 +92,29 @@ tls_peer_supports_ncp(const char *peer_info)
     }
 }
 
+const char *
+ncp_default_ciphers(void)
+{
+    /*
+     * Only offer ChaCha20-Poly1305 if the crypto library provides it.
+     * On CPUs without hardware AES support the software ChaCha20 path
+     * is significantly faster than software AES-GCM, so prefer it
+     * there; otherwise append it after the AES-GCM ciphers.
+     */
+    if (!cipher_kt_get("CHACHA20-POLY1305"))
+    {
+        return "AES-256-GCM:AES-128-GCM";
+    }
+    else if (!cipher_aes_hw_accelerated())
+    {
+        return "CHACHA20-POLY1305:AES-256-GCM:AES-128-GCM";
+    }
+    else
+    {
+        return "AES-256-GCM:AES-128-GCM:CHACHA20-POLY1305";
+    }
+}
+
 char *
 mutate_ncp_cipher_list(const char *list, struct gc_arena *gc)
 {
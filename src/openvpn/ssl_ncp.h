@@ -33,6 +33,15 @@
 #include "buffer.h"
 #include "options.h"
 
+/**
+ * Returns the default --data-ciphers list, depending on what the
+ * crypto library offers and whether this CPU has hardware AES
+ * support.  ChaCha20-Poly1305 is preferred over the AES-GCM ciphers
+ * on CPUs that would have to run AES in software.
+ */
+const char *
+ncp_default_ciphers(void);
+
 /**
  * Returns whether the client supports NCP either by
  * announcing IV_NCP>=2 or the IV_CIPHERS list
@@ -38,6 +38,7 @@
 
 #include "errlevel.h"
 #include "buffer.h"
+#include "integer.h"
 #include "misc.h"
 #include "manage.h"
 #include "memdbg.h"
@@ -65,6 +66,20 @@
 #include <openssl/ec.h>
 #endif
 
+#ifdef ENABLE_WORKER_THREADS
+#include <pthread.h>
+
+/* background CRL parse job, see backend_tls_ctx_reload_crl_async() */
+struct crl_reload_job
+{
+    pthread_t thread;
+    char *crl_file;
+    bool crl_inline;
+    STACK_OF(X509_CRL) *crls;   /* parse result */
+    int done;                   /* set by the worker with release semantics */
+};
+#endif
+
 /*
  * Allocate space in SSL objects in which to store a struct tls_session
  * pointer back to parent.
@@ -144,6 +159,18 @@ void
 tls_ctx_free(struct tls_root_ctx *ctx)
 {
     ASSERT(NULL != ctx);
+#ifdef ENABLE_WORKER_THREADS
+    if (ctx->crl_job)
+    {
+        /* wait for a background CRL parse and discard its result */
+        struct crl_reload_job *job = ctx->crl_job;
+        pthread_join(job->thread, NULL);
+        sk_X509_CRL_pop_free(job->crls, X509_CRL_free);
+        free(job->crl_file);
+        free(job);
+        ctx->crl_job = NULL;
+    }
+#endif
     SSL_CTX_free(ctx->ctx);
     ctx->ctx = NULL;
 }
@@ -1040,35 +1067,22 @@ end:
     return ret;
 }
 
-void
-backend_tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
-                           bool crl_inline)
+/*
+ * Parse all CRLs contained in crl_file.  Returns a stack holding the
+ * parsed CRLs (possibly empty on error).  Pure parsing work without any
+ * certificate store access, so it is safe to run off the main thread.
+ */
+static STACK_OF(X509_CRL) *
+tls_ctx_parse_crl_file(const char *crl_file, bool crl_inline)
 {
     BIO *in = NULL;
+    STACK_OF(X509_CRL) *crls = sk_X509_CRL_new_null();
 
-    X509_STORE *store = SSL_CTX_get_cert_store(ssl_ctx->ctx);
-    if (!store)
+    if (!crls)
     {
-        crypto_msg(M_FATAL, "Cannot get certificate store");
-    }
-
-    /* Always start with a cleared CRL list, for that we
-     * we need to manually find the CRL object from the stack
-     * and remove it */
-    STACK_OF(X509_OBJECT) *objs = X509_STORE_get0_objects(store);
-    for (int i = 0; i < sk_X509_OBJECT_num(objs); i++)
-    {
-        X509_OBJECT *obj = sk_X509_OBJECT_value(objs, i);
-        ASSERT(obj);
-        if (X509_OBJECT_get_type(obj) == X509_LU_CRL)
-        {
-            sk_X509_OBJECT_delete(objs, i);
-            X509_OBJECT_free(obj);
-        }
+        crypto_msg(M_FATAL, "CRL: cannot allocate CRL stack");
     }
 
-    X509_STORE_set_flags(store, X509_V_FLAG_CRL_CHECK | X509_V_FLAG_CRL_CHECK_ALL);
-
     if (crl_inline)
     {
         in = BIO_new_mem_buf((char *) crl_file, -1);
@@ -1085,7 +1099,6 @@ backend_tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
         goto end;
     }
 
-    int num_crls_loaded = 0;
     while (true)
     {
         X509_CRL *crl = PEM_read_bio_X509_CRL(in, NULL, NULL, NULL);
@@ -1096,7 +1109,7 @@ backend_tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
              */
             bool eof = ERR_GET_REASON(ERR_peek_error()) == PEM_R_NO_START_LINE;
             /* but warn if no CRLs have been loaded */
-            if (num_crls_loaded > 0 && eof)
+            if (sk_X509_CRL_num(crls) > 0 && eof)
             {
                 /* remove that error from error stack */
                 (void)ERR_get_error();
@@ -1108,6 +1121,55 @@ backend_tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
             break;
         }
 
+        if (!sk_X509_CRL_push(crls, crl))
+        {
+            X509_CRL_free(crl);
+            crypto_msg(M_WARN, "CRL: cannot store CRL from %s",
+                       print_key_filename(crl_file, crl_inline));
+            break;
+        }
+    }
+end:
+    BIO_free(in);
+    return crls;
+}
+
+/*
+ * Replace the CRLs in the context's certificate store with the given
+ * parsed stack.  Consumes the stack.  Must be called from the main
+ * thread, which owns the store.
+ */
+static void
+tls_ctx_install_crls(struct tls_root_ctx *ssl_ctx, STACK_OF(X509_CRL) *crls,
+                     const char *crl_file, bool crl_inline)
+{
+    X509_STORE *store = SSL_CTX_get_cert_store(ssl_ctx->ctx);
+    if (!store)
+    {
+        crypto_msg(M_FATAL, "Cannot get certificate store");
+    }
+
+    /* Always start with a cleared CRL list, for that we
+     * we need to manually find the CRL object from the stack
+     * and remove it */
+    STACK_OF(X509_OBJECT) *objs = X509_STORE_get0_objects(store);
+    for (int i = 0; i < sk_X509_OBJECT_num(objs); i++)
+    {
+        X509_OBJECT *obj = sk_X509_OBJECT_value(objs, i);
+        ASSERT(obj);
+        if (X509_OBJECT_get_type(obj) == X509_LU_CRL)
+        {
+            sk_X509_OBJECT_delete(objs, i);
+            X509_OBJECT_free(obj);
+        }
+    }
+
+    X509_STORE_set_flags(store, X509_V_FLAG_CRL_CHECK | X509_V_FLAG_CRL_CHECK_ALL);
+
+    int num_crls_loaded = 0;
+    while (sk_X509_CRL_num(crls) > 0)
+    {
+        X509_CRL *crl = sk_X509_CRL_pop(crls);
         if (!X509_STORE_add_crl(store, crl))
         {
             X509_CRL_free(crl);
@@ -1118,11 +1180,82 @@ backend_tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
         X509_CRL_free(crl);
         num_crls_loaded++;
     }
+    sk_X509_CRL_pop_free(crls, X509_CRL_free);
     msg(M_INFO, "CRL: loaded %d CRLs from file %s", num_crls_loaded, crl_file);
-end:
-    BIO_free(in);
 }
 
+void
+backend_tls_ctx_reload_crl(struct tls_root_ctx *ssl_ctx, const char *crl_file,
+                           bool crl_inline)
+{
+    STACK_OF(X509_CRL) *crls = tls_ctx_parse_crl_file(crl_file, crl_inline);
+    tls_ctx_install_crls(ssl_ctx, crls, crl_file, crl_inline);
+}
+
+#ifdef ENABLE_WORKER_THREADS
+
+/*
+ * Background CRL reload.  Parsing a large CRL can block the event loop
+ * for tens of milliseconds, so when the file changes the re-parse is
+ * pushed to a transient worker thread while handshakes keep using the
+ * previously loaded CRL.  Only the parse runs off-thread; the store
+ * swap happens on the main thread in backend_tls_ctx_crl_collect().
+ */
+static void *
+crl_reload_thread_func(void *arg)
+{
+    struct crl_reload_job *job = arg;
+    job->crls = tls_ctx_parse_crl_file(job->crl_file, job->crl_inline);
+    __atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+int
+backend_tls_ctx_reload_crl_async(struct tls_root_ctx *ssl_ctx,
+                                 const char *crl_file, bool crl_inline)
+{
+    if (crl_inline)
+    {
+        /* inline CRLs never change at runtime; load them synchronously */
+        return CRL_RELOAD_UNSUPPORTED;
+    }
+    if (ssl_ctx->crl_job)
+    {
+        return CRL_RELOAD_BUSY;
+    }
+
+    struct crl_reload_job *job;
+    ALLOC_OBJ_CLEAR(job, struct crl_reload_job);
+    job->crl_file = string_alloc(crl_file, NULL);
+    job->crl_inline = crl_inline;
+    if (pthread_create(&job->thread, NULL, crl_reload_thread_func, job))
+    {
+        msg(M_WARN, "CRL: cannot create background reload thread");
+        free(job->crl_file);
+        free(job);
+        return CRL_RELOAD_UNSUPPORTED;
+    }
+    ssl_ctx->crl_job = job;
+    return CRL_RELOAD_STARTED;
+}
+
+void
+backend_tls_ctx_crl_collect(struct tls_root_ctx *ssl_ctx)
+{
+    struct crl_reload_job *job = ssl_ctx->crl_job;
+    if (!job || !__atomic_load_n(&job->done, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    pthread_join(job->thread, NULL);
+    tls_ctx_install_crls(ssl_ctx, job->crls, job->crl_file, job->crl_inline);
+    free(job->crl_file);
+    free(job);
+    ssl_ctx->crl_job = NULL;
+}
+
+#endif /* ENABLE_WORKER_THREADS */
+
 
 #ifdef ENABLE_MANAGEMENT
 
@@ -1795,6 +1928,243 @@ bio_write(BIO *bio, const uint8_t *data, int size, const char *desc)
     return ret;
 }
 
+/*
+ * Chunked queue BIO for the control channel ciphertext streams.
+ *
+ * BIO_s_mem() backs each stream with a single BUF_MEM that is grown
+ * with realloc and compacted with memmove as records are appended and
+ * consumed, which churns the allocator on every handshake record.
+ * This method keeps the queued bytes in a list of fixed-size chunks
+ * drawn from a small static freelist that is reused across key states
+ * and handshakes, so steady-state operation performs no allocator
+ * calls at all.  Read/retry semantics match a memory BIO: reading an
+ * empty queue returns -1 with the retry flag set.
+ */
+
+#define BIO_Q_CHUNK_CAP 4096
+
+struct bio_q_chunk {
+    struct bio_q_chunk *next;
+    int off;                    /* next byte to hand out */
+    int len;                    /* bytes stored */
+    uint8_t data[BIO_Q_CHUNK_CAP];
+};
+
+struct bio_q {
+    struct bio_q_chunk *head;   /* read end */
+    struct bio_q_chunk *tail;   /* write end */
+};
+
+/* freelist shared by all control channel BIOs; the control channel
+ * runs on the event thread only, so no locking is needed */
+static struct bio_q_chunk *bio_q_free_list;
+static int bio_q_n_free;
+#define BIO_Q_POOL_MAX 16
+
+static struct bio_q_chunk *
+bio_q_chunk_get(void)
+{
+    struct bio_q_chunk *c = bio_q_free_list;
+    if (c)
+    {
+        bio_q_free_list = c->next;
+        --bio_q_n_free;
+    }
+    else
+    {
+        ALLOC_OBJ(c, struct bio_q_chunk);
+    }
+    c->next = NULL;
+    c->off = 0;
+    c->len = 0;
+    return c;
+}
+
+static void
+bio_q_chunk_put(struct bio_q_chunk *c)
+{
+    if (bio_q_n_free < BIO_Q_POOL_MAX)
+    {
+        c->next = bio_q_free_list;
+        bio_q_free_list = c;
+        ++bio_q_n_free;
+    }
+    else
+    {
+        free(c);
+    }
+}
+
+static int
+bio_q_create(BIO *b)
+{
+    struct bio_q *q;
+    ALLOC_OBJ_CLEAR(q, struct bio_q);
+    BIO_set_data(b, q);
+    BIO_set_init(b, 1);
+    return 1;
+}
+
+static int
+bio_q_destroy(BIO *b)
+{
+    if (!b)
+    {
+        return 0;
+    }
+    struct bio_q *q = BIO_get_data(b);
+    if (q)
+    {
+        struct bio_q_chunk *c = q->head;
+        while (c)
+        {
+            struct bio_q_chunk *next = c->next;
+            bio_q_chunk_put(c);
+            c = next;
+        }
+        free(q);
+        BIO_set_data(b, NULL);
+    }
+    BIO_set_init(b, 0);
+    return 1;
+}
+
+static int
+bio_q_write(BIO *b, const char *in, int inl)
+{
+    struct bio_q *q = BIO_get_data(b);
+    int rest = inl;
+
+    BIO_clear_retry_flags(b);
+    if (!in || inl <= 0)
+    {
+        return 0;
+    }
+    while (rest > 0)
+    {
+        struct bio_q_chunk *t = q->tail;
+        int space = t ? BIO_Q_CHUNK_CAP - t->len : 0;
+        if (space == 0)
+        {
+            struct bio_q_chunk *c = bio_q_chunk_get();
+            if (t)
+            {
+                t->next = c;
+            }
+            else
+            {
+                q->head = c;
+            }
+            q->tail = c;
+            t = c;
+            space = BIO_Q_CHUNK_CAP;
+        }
+        int n = min_int(space, rest);
+        memcpy(t->data + t->len, in, n);
+        t->len += n;
+        in += n;
+        rest -= n;
+    }
+    return inl;
+}
+
+static int
+bio_q_read(BIO *b, char *out, int outl)
+{
+    struct bio_q *q = BIO_get_data(b);
+    int n = 0;
+
+    BIO_clear_retry_flags(b);
+    if (!out || outl <= 0)
+    {
+        return 0;
+    }
+    while (n < outl && q->head)
+    {
+        struct bio_q_chunk *h = q->head;
+        int take = min_int(h->len - h->off, outl - n);
+        memcpy(out + n, h->data + h->off, take);
+        h->off += take;
+        n += take;
+        if (h->off == h->len)
+        {
+            q->head = h->next;
+            if (!q->head)
+            {
+                q->tail = NULL;
+            }
+            bio_q_chunk_put(h);
+        }
+    }
+    if (n == 0)
+    {
+        BIO_set_retry_read(b);
+        return -1;
+    }
+    return n;
+}
+
+static int
+bio_q_puts(BIO *b, const char *str)
+{
+    return bio_q_write(b, str, (int) strlen(str));
+}
+
+static long
+bio_q_ctrl(BIO *b, int cmd, long num, void *ptr)
+{
+    struct bio_q *q = BIO_get_data(b);
+    long ret;
+
+    switch (cmd)
+    {
+        case BIO_CTRL_PENDING:
+        {
+            const struct bio_q_chunk *c;
+            ret = 0;
+            for (c = q->head; c; c = c->next)
+            {
+                ret += c->len - c->off;
+            }
+            break;
+        }
+
+        case BIO_CTRL_EOF:
+            ret = q->head ? 0 : 1;
+            break;
+
+        case BIO_CTRL_FLUSH:
+        case BIO_CTRL_DUP:
+            ret = 1;
+            break;
+
+        default:
+            ret = 0;
+            break;
+    }
+    return ret;
+}
+
+static BIO_METHOD *bio_q_method; /* lazily built, lives for the process */
+
+static BIO_METHOD *
+getbio_q_method(void)
+{
+    if (!bio_q_method)
+    {
+        bio_q_method = BIO_meth_new(BIO_TYPE_SOURCE_SINK | 99,
+                                    "openvpn ciphertext queue");
+        ASSERT(bio_q_method);
+        BIO_meth_set_write(bio_q_method, bio_q_write);
+        BIO_meth_set_read(bio_q_method, bio_q_read);
+        BIO_meth_set_puts(bio_q_method, bio_q_puts);
+        BIO_meth_set_ctrl(bio_q_method, bio_q_ctrl);
+        BIO_meth_set_create(bio_q_method, bio_q_create);
+        BIO_meth_set_destroy(bio_q_method, bio_q_destroy);
+    }
+    return bio_q_method;
+}
+
 /*
  * Inline functions for reading from and writing
  * to BIOs.
@@ -1887,8 +2257,8 @@ key_state_ssl_init(struct key_state_ssl *ks_ssl, const struct tls_root_ctx *ssl_
     SSL_set_ex_data(ks_ssl->ssl, mydata_index, session);
 
     ASSERT((ks_ssl->ssl_bio = BIO_new(BIO_f_ssl())));
-    ASSERT((ks_ssl->ct_in = BIO_new(BIO_s_mem())));
-    ASSERT((ks_ssl->ct_out = BIO_new(BIO_s_mem())));
+    ASSERT((ks_ssl->ct_in = BIO_new(getbio_q_method())));
+    ASSERT((ks_ssl->ct_out = BIO_new(getbio_q_method())));
 
 #ifdef BIO_DEBUG
     bio_debug_oc("open ssl_bio", ks_ssl->ssl_bio);
@@ -1896,6 +2266,16 @@ key_state_ssl_init(struct key_state_ssl *ks_ssl, const struct tls_root_ctx *ssl_
     bio_debug_oc("open ct_out", ks_ssl->ct_out);
 #endif
 
+#ifdef SSL_MODE_ASYNC
+    if (session->opt->tls_async)
+    {
+        /* Hand asymmetric handshake operations to the configured async
+         * engine.  WANT_ASYNC surfaces as a BIO retry, which the
+         * handshake pump already treats as "try again later". */
+        SSL_set_mode(ks_ssl->ssl, SSL_MODE_ASYNC);
+    }
+#endif
+
     if (is_server)
     {
         SSL_set_accept_state(ks_ssl->ssl);
@@ -1922,6 +2302,36 @@ key_state_ssl_free(struct key_state_ssl *ks_ssl)
         BIO_free_all(ks_ssl->ssl_bio);
         SSL_free(ks_ssl->ssl);
     }
+    CLEAR(*ks_ssl);
+}
+
+bool
+key_state_ssl_async_pending(struct key_state_ssl *ks_ssl)
+{
+#ifdef SSL_MODE_ASYNC
+    return ks_ssl->ssl && SSL_waiting_for_async(ks_ssl->ssl);
+#else
+    return false;
+#endif
+}
+
+int
+key_state_ssl_async_fd(struct key_state_ssl *ks_ssl)
+{
+#ifdef SSL_MODE_ASYNC
+    if (ks_ssl->ssl && SSL_waiting_for_async(ks_ssl->ssl))
+    {
+        OSSL_ASYNC_FD fds[4];
+        size_t numfds = 0;
+        if (SSL_get_all_async_fds(ks_ssl->ssl, NULL, &numfds)
+            && numfds > 0 && numfds <= SIZE(fds)
+            && SSL_get_all_async_fds(ks_ssl->ssl, fds, &numfds))
+        {
+            return (int)fds[0];
+        }
+    }
+#endif
+    return -1;
 }
 
 int
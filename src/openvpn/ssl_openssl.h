@@ -39,6 +39,9 @@ struct tls_root_ctx {
     SSL_CTX *ctx;
     time_t crl_last_mtime;
     off_t crl_last_size;
+#ifdef ENABLE_WORKER_THREADS
+    struct crl_reload_job *crl_job; /* in-flight background CRL parse */
+#endif
 };
 
 struct key_state_ssl {
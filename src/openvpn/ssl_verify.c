@@ -46,6 +46,7 @@
 #endif
 #include "auth_token.h"
 #include "push.h"
+#include "intern.h"
 
 /** Maximum length of common name */
 #define TLS_USERNAME_LEN 64
@@ -92,7 +93,7 @@ set_common_name(struct tls_session *session, const char *common_name)
 {
     if (session->common_name)
     {
-        free(session->common_name);
+        string_intern_release(session->common_name);
         session->common_name = NULL;
 #ifdef ENABLE_PF
         session->common_name_hashval = 0;
@@ -100,8 +101,8 @@ set_common_name(struct tls_session *session, const char *common_name)
     }
     if (common_name)
     {
-        /* FIXME: Last alloc will never be freed */
-        session->common_name = string_alloc(common_name, NULL);
+        /* intern pool: one shared copy per distinct common name */
+        session->common_name = string_intern(common_name);
 #ifdef ENABLE_PF
         {
             const uint32_t len = (uint32_t) strlen(common_name);
@@ -640,6 +641,126 @@ cleanup:
     return ret;
 }
 
+/*
+ * Cache of recently verified peer certificates, keyed on the SHA-256
+ * fingerprint of the leaf certificate (--tls-verify-cache).  A roaming
+ * client reconnects with the same certificate it presented moments ago,
+ * and re-running the --tls-verify plugin/script and CRL lookup for every
+ * reconnect adds latency and external-command load exactly when a
+ * reconnect storm hits.  Entries are created only after the certificate
+ * has passed the complete verification chain, and expire after the
+ * configured lifetime, so a revocation takes effect at most that many
+ * seconds late.  The TLS library's signature/chain validation still runs
+ * on every handshake; only the OpenVPN-level re-checks are skipped.
+ * Handshakes are processed by the main thread only, so no locking is
+ * needed.
+ */
+#define CERT_VERIFY_CACHE_SIZE 256
+#define CERT_VERIFY_CACHE_DIGEST_LEN 32 /* SHA-256 */
+#define CERT_VERIFY_CACHE_CN_LEN 256
+
+struct cert_verify_cache_entry
+{
+    bool in_use;
+    uint8_t digest[CERT_VERIFY_CACHE_DIGEST_LEN];
+    char common_name[CERT_VERIFY_CACHE_CN_LEN];
+    time_t expire;
+    uint64_t last_used;         /* cert_verify_cache_clock at last hit */
+};
+
+static struct cert_verify_cache_entry *cert_verify_cache;
+static uint64_t cert_verify_cache_clock;
+
+/* exposed through the management interface's load-stats command */
+counter_type cert_verify_cache_hits;
+counter_type cert_verify_cache_misses;
+
+static struct cert_verify_cache_entry *
+cert_verify_cache_lookup(const uint8_t *digest)
+{
+    if (!cert_verify_cache)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < CERT_VERIFY_CACHE_SIZE; ++i)
+    {
+        struct cert_verify_cache_entry *e = &cert_verify_cache[i];
+        if (e->in_use && memcmp(e->digest, digest, sizeof(e->digest)) == 0)
+        {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void
+cert_verify_cache_insert(const uint8_t *digest, const char *common_name,
+                         int lifetime)
+{
+    if (!cert_verify_cache)
+    {
+        ALLOC_ARRAY_CLEAR(cert_verify_cache, struct cert_verify_cache_entry,
+                          CERT_VERIFY_CACHE_SIZE);
+    }
+
+    struct cert_verify_cache_entry *e = cert_verify_cache_lookup(digest);
+    if (!e)
+    {
+        /* reuse a free slot, or evict the least recently used entry */
+        e = &cert_verify_cache[0];
+        for (int i = 0; i < CERT_VERIFY_CACHE_SIZE; ++i)
+        {
+            struct cert_verify_cache_entry *c = &cert_verify_cache[i];
+            if (!c->in_use)
+            {
+                e = c;
+                break;
+            }
+            if (c->last_used < e->last_used)
+            {
+                e = c;
+            }
+        }
+        CLEAR(*e);
+        memcpy(e->digest, digest, sizeof(e->digest));
+    }
+
+    strncpynt(e->common_name, common_name, sizeof(e->common_name));
+    e->expire = now + lifetime;
+    e->in_use = true;
+    e->last_used = ++cert_verify_cache_clock;
+}
+
+void
+cert_verify_cache_flush(void)
+{
+    free(cert_verify_cache);
+    cert_verify_cache = NULL;
+}
+
+/*
+ * Return true if the leaf cert with the given fingerprint passed the full
+ * verification chain recently enough that it may skip the external checks.
+ */
+static bool
+cert_verify_cache_check(const uint8_t *digest, const char *common_name)
+{
+    struct cert_verify_cache_entry *e = cert_verify_cache_lookup(digest);
+    if (e && now < e->expire
+        && strcmp(e->common_name, common_name) == 0)
+    {
+        e->last_used = ++cert_verify_cache_clock;
+        ++cert_verify_cache_hits;
+        return true;
+    }
+    if (e && now >= e->expire)
+    {
+        e->in_use = false;
+    }
+    ++cert_verify_cache_misses;
+    return false;
+}
+
 result_t
 verify_cert(struct tls_session *session, openvpn_x509_cert_t *cert, int cert_depth)
 {
@@ -769,6 +890,26 @@ verify_cert(struct tls_session *session, openvpn_x509_cert_t *cert, int cert_dep
     /* export current untrusted IP */
     setenv_untrusted(session);
 
+    /* for the peer's own certificate, check whether a recent full
+     * verification of the same certificate is still cached */
+    const uint8_t *cert_fp = NULL;
+    if (cert_depth == 0 && opt->verify_cache_lifetime > 0)
+    {
+        struct buffer fp = x509_get_sha256_fingerprint(cert, &gc);
+        if (BLEN(&fp) == CERT_VERIFY_CACHE_DIGEST_LEN)
+        {
+            cert_fp = BPTR(&fp);
+        }
+        if (cert_fp && cert_verify_cache_check(cert_fp, common_name))
+        {
+            msg(D_HANDSHAKE, "VERIFY OK (cached): depth=%d, %s", cert_depth,
+                subject);
+            session->verified = true;
+            ret = SUCCESS;
+            goto cleanup;
+        }
+    }
+
     /* If this is the peer's own certificate, verify it */
     if (cert_depth == 0 && SUCCESS != verify_peer_cert(opt, cert, subject, common_name))
     {
@@ -798,6 +939,16 @@ verify_cert(struct tls_session *session, openvpn_x509_cert_t *cert, int cert_dep
                 goto cleanup;
             }
         }
+#if defined(ENABLE_CRYPTO_OPENSSL) && !defined(_WIN32)
+        else if (opt->ssl_flags & SSLF_CRL_INDEX)
+        {
+            if (SUCCESS != verify_check_crl_index(opt->crl_file, cert, subject,
+                                                  cert_depth))
+            {
+                goto cleanup;
+            }
+        }
+#endif
         else
         {
             if (tls_verify_crl_missing(opt))
@@ -808,6 +959,12 @@ verify_cert(struct tls_session *session, openvpn_x509_cert_t *cert, int cert_dep
         }
     }
 
+    if (cert_fp)
+    {
+        cert_verify_cache_insert(cert_fp, common_name,
+                                 opt->verify_cache_lifetime);
+    }
+
     msg(D_HANDSHAKE, "VERIFY OK: depth=%d, %s", cert_depth, subject);
     session->verified = true;
     ret = SUCCESS;
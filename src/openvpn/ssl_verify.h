@@ -268,4 +268,7 @@ tls_client_reason(struct tls_multi *multi)
 /** Remove any X509_ env variables from env_set es */
 void tls_x509_clear_env(struct env_set *es);
 
+/** Flush the --tls-verify-cache certificate verification cache */
+void cert_verify_cache_flush(void);
+
 #endif /* SSL_VERIFY_H_ */
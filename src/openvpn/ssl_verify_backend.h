@@ -268,4 +268,26 @@ result_t x509_write_pem(FILE *peercert_file, openvpn_x509_cert_t *peercert);
  */
 bool tls_verify_crl_missing(const struct tls_options *opt);
 
+#if defined(ENABLE_CRYPTO_OPENSSL) && !defined(_WIN32)
+/*
+ * Check whether the certificate's serial number appears in the sorted,
+ * memory-mapped serial index maintained beside the CRL file
+ * (--crl-verify crl index).  The index is (re)built on first use and
+ * whenever the CRL file changes; when the CRL only grew, just the
+ * appended entries are parsed and merged.
+ *
+ * @param crl_file      The CRL file the index is derived from.
+ * @param cert          Certificate to verify.
+ * @param subject       Subject of the given certificate.
+ * @param cert_depth    Depth of the current certificate.
+ *
+ * @return              \c SUCCESS if the certificate is not listed in the
+ *                      index, \c FAILURE if it is revoked or the index
+ *                      cannot be built.
+ */
+result_t verify_check_crl_index(const char *crl_file,
+                                openvpn_x509_cert_t *cert,
+                                const char *subject, int cert_depth);
+#endif
+
 #endif /* SSL_VERIFY_BACKEND_H_ */
@@ -802,4 +802,379 @@ tls_verify_crl_missing(const struct tls_options *opt)
     return true;
 }
 
+#ifndef _WIN32
+
+#include <sys/mman.h>
+#include <fcntl.h>
+
+/*
+ * Sorted serial-number index for --crl-verify 'index' mode.
+ *
+ * Parsing a multi-hundred-thousand entry PEM CRL costs seconds of
+ * main-thread time, and the in-store lookup is repeated for every
+ * handshake.  Instead of keeping the CRL in the TLS library's store, we
+ * maintain a flat index file next to the CRL ("<crl>.idx") holding the
+ * revoked serial numbers as fixed-width big-endian values, sorted for
+ * binary search, and map it read-only.  A restart only re-maps the
+ * index; the CRL is re-parsed solely when it actually changed, and when
+ * it merely grew (PEM CRL blocks appended) only the appended bytes are
+ * parsed and merged.
+ *
+ * Like --crl-verify 'dir' mode, this checks revocation by serial number
+ * of every certificate in the chain; the CRL's signature is not
+ * (re)validated against the CA, so the CRL file must come from a
+ * trusted local source.
+ */
+
+#define CRL_INDEX_MAGIC   0x4f56504e43524c58ULL  /* "OVPNCRLX" */
+#define CRL_INDEX_VERSION 1
+#define CRL_INDEX_SERIAL_LEN 20   /* maximum serial length per RFC 5280 */
+
+struct crl_index_header
+{
+    uint64_t magic;
+    uint32_t version;
+    uint32_t serial_len;
+    uint64_t n_entries;
+    uint64_t crl_size;          /* size of the CRL the index was built from */
+    uint64_t crl_mtime;
+    uint64_t parsed_off;        /* CRL bytes consumed by the parser */
+};
+
+static struct
+{
+    uint8_t *map;               /* read-only mapping of the index file */
+    size_t map_len;
+    struct crl_index_header hdr;
+} crl_index;
+
+static int
+crl_index_serial_cmp(const void *a, const void *b)
+{
+    return memcmp(a, b, CRL_INDEX_SERIAL_LEN);
+}
+
+/* normalize an ASN.1 serial to a fixed-width big-endian value */
+static bool
+crl_index_serial_pad(const ASN1_INTEGER *ai, uint8_t *out)
+{
+    const int len = ASN1_STRING_length(ai);
+    if (len < 0 || len > CRL_INDEX_SERIAL_LEN)
+    {
+        return false;
+    }
+    memset(out, 0, CRL_INDEX_SERIAL_LEN);
+    memcpy(out + CRL_INDEX_SERIAL_LEN - len, ASN1_STRING_get0_data(ai), len);
+    return true;
+}
+
+/*
+ * Parse the CRL file starting at the given offset and append the revoked
+ * serials to *entries (realloc'd).  Returns the number of CRL blocks
+ * parsed, or -1 if nothing could be parsed at that offset.  *parsed_off
+ * is advanced to the end of the last complete CRL block.
+ */
+static int
+crl_index_parse(const char *crl_file, long offset, uint8_t **entries,
+                uint64_t *n_entries, uint64_t *parsed_off)
+{
+    BIO *in = BIO_new_file(crl_file, "r");
+    if (!in)
+    {
+        msg(M_WARN, "CRL index: cannot read: %s", crl_file);
+        return -1;
+    }
+    if (offset > 0 && BIO_seek(in, offset) < 0)
+    {
+        BIO_free(in);
+        return -1;
+    }
+
+    int num_crls = 0;
+    while (true)
+    {
+        X509_CRL *crl = PEM_read_bio_X509_CRL(in, NULL, NULL, NULL);
+        if (!crl)
+        {
+            bool eof = ERR_GET_REASON(ERR_peek_error()) == PEM_R_NO_START_LINE;
+            if (num_crls > 0 && eof)
+            {
+                (void)ERR_get_error();
+                break;
+            }
+            crypto_msg(M_WARN, "CRL index: cannot read CRL from file %s",
+                       crl_file);
+            break;
+        }
+
+        STACK_OF(X509_REVOKED) *revoked = X509_CRL_get_REVOKED(crl);
+        const int n_revoked = sk_X509_REVOKED_num(revoked);
+        if (n_revoked > 0)
+        {
+            *entries = realloc(*entries, (*n_entries + n_revoked)
+                               *CRL_INDEX_SERIAL_LEN);
+            check_malloc_return(*entries);
+            for (int i = 0; i < n_revoked; i++)
+            {
+                const X509_REVOKED *r = sk_X509_REVOKED_value(revoked, i);
+                uint8_t *slot = *entries + *n_entries * CRL_INDEX_SERIAL_LEN;
+                if (!crl_index_serial_pad(X509_REVOKED_get0_serialNumber(r),
+                                          slot))
+                {
+                    msg(M_WARN, "CRL index: serial number longer than %d "
+                        "bytes in %s, cannot index this CRL",
+                        CRL_INDEX_SERIAL_LEN, crl_file);
+                    X509_CRL_free(crl);
+                    BIO_free(in);
+                    return -1;
+                }
+                ++*n_entries;
+            }
+        }
+        X509_CRL_free(crl);
+        num_crls++;
+        *parsed_off = (uint64_t)BIO_tell(in);
+    }
+    BIO_free(in);
+    return num_crls > 0 ? num_crls : -1;
+}
+
+static void
+crl_index_unmap(void)
+{
+    if (crl_index.map)
+    {
+        munmap(crl_index.map, crl_index.map_len);
+        crl_index.map = NULL;
+        crl_index.map_len = 0;
+    }
+}
+
+/* atomically replace the index file and re-map it */
+static bool
+crl_index_write(const char *idx_file, const struct crl_index_header *hdr,
+                const uint8_t *entries)
+{
+    struct gc_arena gc = gc_new();
+    bool ret = false;
+
+    struct buffer tmp = alloc_buf_gc(strlen(idx_file) + 5, &gc);
+    buf_printf(&tmp, "%s.tmp", idx_file);
+    const char *tmp_file = BSTR(&tmp);
+
+    int fd = open(tmp_file, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        msg(M_WARN | M_ERRNO, "CRL index: cannot write %s", tmp_file);
+        goto done;
+    }
+
+    const size_t data_len = hdr->n_entries * CRL_INDEX_SERIAL_LEN;
+    if (write(fd, hdr, sizeof(*hdr)) != (ssize_t)sizeof(*hdr)
+        || (data_len > 0 && write(fd, entries, data_len) != (ssize_t)data_len))
+    {
+        msg(M_WARN | M_ERRNO, "CRL index: short write to %s", tmp_file);
+        close(fd);
+        platform_unlink(tmp_file);
+        goto done;
+    }
+    close(fd);
+
+    if (rename(tmp_file, idx_file) != 0)
+    {
+        msg(M_WARN | M_ERRNO, "CRL index: cannot rename %s", tmp_file);
+        platform_unlink(tmp_file);
+        goto done;
+    }
+    ret = true;
+
+done:
+    gc_free(&gc);
+    return ret;
+}
+
+/* map idx_file read-only and validate its header; false if unusable */
+static bool
+crl_index_map(const char *idx_file)
+{
+    crl_index_unmap();
+
+    int fd = open(idx_file, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    platform_stat_t st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(struct crl_index_header))
+    {
+        close(fd);
+        return false;
+    }
+
+    uint8_t *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const struct crl_index_header *hdr = (struct crl_index_header *)map;
+    if (hdr->magic != CRL_INDEX_MAGIC || hdr->version != CRL_INDEX_VERSION
+        || hdr->serial_len != CRL_INDEX_SERIAL_LEN
+        || sizeof(*hdr) + hdr->n_entries * CRL_INDEX_SERIAL_LEN
+        != (uint64_t)st.st_size)
+    {
+        munmap(map, st.st_size);
+        return false;
+    }
+
+    crl_index.map = map;
+    crl_index.map_len = st.st_size;
+    crl_index.hdr = *hdr;
+    return true;
+}
+
+/*
+ * Make sure the mapped index matches the current CRL file, rebuilding or
+ * incrementally extending it as needed.  Returns false if no usable
+ * index could be produced.
+ */
+static bool
+crl_index_refresh(const char *crl_file)
+{
+    platform_stat_t crl_stat;
+    if (platform_stat(crl_file, &crl_stat) < 0)
+    {
+        msg(M_WARN, "CRL index: failed to stat CRL file %s", crl_file);
+        return false;
+    }
+
+    if (crl_index.map
+        && crl_index.hdr.crl_size == (uint64_t)crl_stat.st_size
+        && crl_index.hdr.crl_mtime == (uint64_t)crl_stat.st_mtime)
+    {
+        return true;
+    }
+
+    struct gc_arena gc = gc_new();
+    struct buffer idx = alloc_buf_gc(strlen(crl_file) + 5, &gc);
+    buf_printf(&idx, "%s.idx", crl_file);
+    const char *idx_file = BSTR(&idx);
+    bool ret = false;
+
+    /* a previous run may have left a current index behind */
+    if (!crl_index.map && crl_index_map(idx_file)
+        && crl_index.hdr.crl_size == (uint64_t)crl_stat.st_size
+        && crl_index.hdr.crl_mtime == (uint64_t)crl_stat.st_mtime)
+    {
+        ret = true;
+        goto done;
+    }
+
+    uint8_t *entries = NULL;
+    uint64_t n_entries = 0;
+    uint64_t parsed_off = 0;
+
+    /* if the CRL only grew, try to parse just the appended blocks and
+     * merge them with the mapped entries */
+    if (crl_index.map && crl_index.hdr.parsed_off > 0
+        && (uint64_t)crl_stat.st_size > crl_index.hdr.crl_size)
+    {
+        parsed_off = crl_index.hdr.parsed_off;
+        if (crl_index_parse(crl_file, (long)parsed_off, &entries, &n_entries,
+                            &parsed_off) > 0)
+        {
+            const uint64_t n_old = crl_index.hdr.n_entries;
+            entries = realloc(entries, (n_entries + n_old)
+                              *CRL_INDEX_SERIAL_LEN);
+            check_malloc_return(entries);
+            memcpy(entries + n_entries * CRL_INDEX_SERIAL_LEN,
+                   crl_index.map + sizeof(struct crl_index_header),
+                   n_old * CRL_INDEX_SERIAL_LEN);
+            n_entries += n_old;
+            msg(M_INFO, "CRL index: merged %" PRIu64 " appended serials "
+                "from %s", n_entries - n_old, crl_file);
+        }
+        else
+        {
+            /* not an append after all -- rebuild from scratch */
+            free(entries);
+            entries = NULL;
+            n_entries = 0;
+            parsed_off = 0;
+        }
+    }
+
+    if (!parsed_off)
+    {
+        if (crl_index_parse(crl_file, 0, &entries, &n_entries,
+                            &parsed_off) < 0)
+        {
+            free(entries);
+            goto done;
+        }
+        msg(M_INFO, "CRL index: indexed %" PRIu64 " serials from %s",
+            n_entries, crl_file);
+    }
+
+    if (n_entries > 0)
+    {
+        qsort(entries, n_entries, CRL_INDEX_SERIAL_LEN, crl_index_serial_cmp);
+    }
+
+    struct crl_index_header hdr = {
+        .magic = CRL_INDEX_MAGIC,
+        .version = CRL_INDEX_VERSION,
+        .serial_len = CRL_INDEX_SERIAL_LEN,
+        .n_entries = n_entries,
+        .crl_size = (uint64_t)crl_stat.st_size,
+        .crl_mtime = (uint64_t)crl_stat.st_mtime,
+        .parsed_off = parsed_off,
+    };
+    if (crl_index_write(idx_file, &hdr, entries) && crl_index_map(idx_file))
+    {
+        ret = true;
+    }
+    free(entries);
+
+done:
+    gc_free(&gc);
+    return ret;
+}
+
+result_t
+verify_check_crl_index(const char *crl_file, openvpn_x509_cert_t *cert,
+                       const char *subject, int cert_depth)
+{
+    if (!crl_index_refresh(crl_file))
+    {
+        /* fail closed, like file mode does for a missing CRL */
+        msg(D_TLS_ERRORS, "VERIFY ERROR: CRL index could not be built "
+            "from %s", crl_file);
+        return FAILURE;
+    }
+
+    uint8_t serial[CRL_INDEX_SERIAL_LEN];
+    if (!crl_index_serial_pad(X509_get_serialNumber(cert), serial))
+    {
+        /* wider than any serial the index can hold, hence not revoked */
+        return SUCCESS;
+    }
+
+    if (crl_index.hdr.n_entries > 0
+        && bsearch(serial, crl_index.map + sizeof(struct crl_index_header),
+                   crl_index.hdr.n_entries, CRL_INDEX_SERIAL_LEN,
+                   crl_index_serial_cmp))
+    {
+        msg(D_HANDSHAKE, "VERIFY CRL: depth=%d, %s, serial is revoked",
+            cert_depth, subject);
+        return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+#endif /* !_WIN32 */
+
 #endif /* defined(ENABLE_CRYPTO_OPENSSL) */
@@ -111,6 +111,19 @@ status_open(const char *filename,
                 {
                     so->read_buf = alloc_buf(512);
                 }
+
+                /*
+                 * Write-only status files are rewritten periodically from
+                 * scratch, so buffer the rendering and write incremental
+                 * diffs on flush.  Read/write files (e.g. the ifconfig-pool
+                 * journal) are seeked and appended to and must hit the fd
+                 * directly.
+                 */
+                if (so->flags == STATUS_OUTPUT_WRITE)
+                {
+                    so->write_buf = alloc_buf(4096);
+                    so->prev_buf = alloc_buf(4096);
+                }
             }
             else
             {
@@ -146,20 +159,131 @@ status_trigger(struct status_output *so)
     }
 }
 
+/*
+ * Append a rendered line to the in-memory image of a buffered
+ * status file, growing the buffer as needed.
+ */
+static void
+status_write_buf_append(struct status_output *so, const char *str, const int len)
+{
+    struct buffer *wb = &so->write_buf;
+    if (buf_forward_capacity(wb) < len)
+    {
+        int cap = wb->capacity * 2;
+        struct buffer nb;
+        if (cap < BLEN(wb) + len)
+        {
+            cap = BLEN(wb) + len;
+        }
+        nb = alloc_buf(cap);
+        buf_copy(&nb, wb);
+        free_buf(wb);
+        *wb = nb;
+    }
+    ASSERT(buf_write(wb, str, len));
+}
+
 void
 status_reset(struct status_output *so)
 {
     if (so && so->fd >= 0)
     {
-        lseek(so->fd, (off_t)0, SEEK_SET);
+        if (buf_defined(&so->write_buf))
+        {
+            buf_reset_len(&so->write_buf);
+        }
+        else
+        {
+            lseek(so->fd, (off_t)0, SEEK_SET);
+        }
     }
 }
 
+void
+status_seek_end(struct status_output *so)
+{
+    if (so && so->fd >= 0)
+    {
+        lseek(so->fd, (off_t)0, SEEK_END);
+    }
+}
+
+/*
+ * Write out a buffered status file.  Only the region that changed
+ * since the previous flush is written: the common prefix and common
+ * suffix of the old and new images are skipped, so an interval where
+ * few counters changed costs a single small write instead of a full
+ * rewrite of the file.
+ */
+static void
+status_flush_buffered(struct status_output *so)
+{
+    struct buffer *wb = &so->write_buf;
+    struct buffer *pb = &so->prev_buf;
+    const uint8_t *n = BPTR(wb);
+    const uint8_t *o = BPTR(pb);
+    const int new_len = BLEN(wb);
+    const int old_len = BLEN(pb);
+    const int min_len = (new_len < old_len) ? new_len : old_len;
+    int prefix = 0;
+    int suffix = 0;
+    struct buffer tmp;
+
+    while (prefix < min_len && n[prefix] == o[prefix])
+    {
+        ++prefix;
+    }
+
+    /* an unchanged tail keeps its file offset only when the image
+     * length is unchanged, otherwise it must be rewritten as well */
+    if (new_len == old_len)
+    {
+        while (suffix < new_len - prefix
+               && n[new_len - 1 - suffix] == o[new_len - 1 - suffix])
+        {
+            ++suffix;
+        }
+    }
+
+    if (new_len != old_len || prefix < new_len)
+    {
+        const int write_len = new_len - suffix - prefix;
+        if (lseek(so->fd, (off_t)prefix, SEEK_SET) != (off_t)prefix
+            || (write_len > 0
+                && write(so->fd, n + prefix, write_len) != write_len))
+        {
+            so->errors = true;
+        }
+        if (new_len < old_len)
+        {
+#if defined(HAVE_FTRUNCATE)
+            if (ftruncate(so->fd, (off_t)new_len) != 0)
+            {
+                msg(M_WARN | M_ERRNO, "Failed to truncate status file");
+            }
+#elif defined(HAVE_CHSIZE)
+            chsize(so->fd, (long)new_len);
+#endif
+        }
+    }
+
+    /* remember the current image, reuse the old buffer for the next round */
+    tmp = *pb;
+    *pb = *wb;
+    *wb = tmp;
+    buf_reset_len(wb);
+}
+
 void
 status_flush(struct status_output *so)
 {
     if (so && so->fd >= 0 && (so->flags & STATUS_OUTPUT_WRITE))
     {
+        if (buf_defined(&so->write_buf))
+        {
+            status_flush_buffered(so);
+            return;
+        }
 #if defined(HAVE_FTRUNCATE)
         {
             const off_t off = lseek(so->fd, (off_t)0, SEEK_CUR);
@@ -192,6 +316,11 @@ status_close(struct status_output *so)
     bool ret = true;
     if (so)
     {
+        /* one-shot writers print and close without an explicit flush */
+        if (BLEN(&so->write_buf) > 0)
+        {
+            status_flush(so);
+        }
         if (so->errors)
         {
             ret = false;
@@ -209,6 +338,8 @@ status_close(struct status_output *so)
         {
             free_buf(&so->read_buf);
         }
+        free_buf(&so->write_buf);
+        free_buf(&so->prev_buf);
         free(so);
     }
     else
@@ -251,7 +382,11 @@ status_printf(struct status_output *so, const char *format, ...)
             len = strlen(buf);
             if (len > 0)
             {
-                if (write(so->fd, buf, len) != len)
+                if (buf_defined(&so->write_buf))
+                {
+                    status_write_buf_append(so, buf, len);
+                }
+                else if (write(so->fd, buf, len) != len)
                 {
                     so->errors = true;
                 }
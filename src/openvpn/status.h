@@ -58,6 +58,15 @@ struct status_output
 
     struct buffer read_buf;
 
+    /*
+     * Incremental write mode, used for plain write-only status files:
+     * the current rendering is accumulated in write_buf and on flush
+     * only the region that differs from the previous flush (prev_buf)
+     * is written to disk.
+     */
+    struct buffer write_buf;
+    struct buffer prev_buf;
+
     struct event_timeout et;
 
     bool errors;
@@ -73,6 +82,8 @@ bool status_trigger(struct status_output *so);
 
 void status_reset(struct status_output *so);
 
+void status_seek_end(struct status_output *so);
+
 void status_flush(struct status_output *so);
 
 bool status_close(struct status_output *so);
@@ -597,6 +597,16 @@ socket_defined(const socket_descriptor_t sd)
 #define EPOLL 0
 #endif
 
+/*
+ * Is io_uring available on this platform?  Only used when explicitly
+ * enabled at configure time (--enable-iouring).
+ */
+#if defined(ENABLE_IO_URING) && defined(HAVE_LINUX_IO_URING_H) && defined(TARGET_LINUX)
+#define IO_URING 1
+#else
+#define IO_URING 0
+#endif
+
 /*
  * Reduce sensitivity to system clock instability
  * and backtracks.
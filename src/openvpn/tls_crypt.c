@@ -566,6 +566,115 @@ cleanup:
     return ret;
 }
 
+/*
+ * Cache of recently unwrapped tls-crypt-v2 client keys, keyed on a
+ * SHA-256 digest of the WKc blob.  During a reconnect storm the same
+ * clients present the same WKc over and over, and re-running the HMAC
+ * verify and decrypt for each HARD_RESET burns main-thread CPU exactly
+ * when the server is busiest.  Entries are only created after a
+ * successful unwrap, so a cache hit can never accept a WKc that the
+ * server key would have rejected.  Handshakes are processed by the
+ * main thread only, so no locking is needed.
+ */
+#define TLS_CRYPT_V2_CACHE_SIZE 256
+#define TLS_CRYPT_V2_CACHE_DIGEST_LEN 32 /* SHA-256 */
+
+struct tls_crypt_v2_cache_entry
+{
+    bool in_use;
+    uint8_t digest[TLS_CRYPT_V2_CACHE_DIGEST_LEN];
+    struct key2 client_key;
+    uint8_t metadata[TLS_CRYPT_V2_MAX_METADATA_LEN];
+    int metadata_len;
+    uint64_t last_used;         /* tls_crypt_v2_cache_clock at last hit */
+};
+
+static struct tls_crypt_v2_cache_entry *tls_crypt_v2_cache;
+static uint64_t tls_crypt_v2_cache_clock;
+
+/* exposed through the management interface's load-stats command */
+counter_type tls_crypt_v2_cache_hits;
+counter_type tls_crypt_v2_cache_misses;
+
+static bool
+tls_crypt_v2_cache_digest(const struct buffer *wkc, uint8_t *digest)
+{
+    const md_kt_t *sha256 = md_kt_get("SHA256");
+    return sha256 && md_full(sha256, BPTR(wkc), BLEN(wkc), digest);
+}
+
+static struct tls_crypt_v2_cache_entry *
+tls_crypt_v2_cache_lookup(const uint8_t *digest)
+{
+    if (!tls_crypt_v2_cache)
+    {
+        return NULL;
+    }
+    for (int i = 0; i < TLS_CRYPT_V2_CACHE_SIZE; ++i)
+    {
+        struct tls_crypt_v2_cache_entry *e = &tls_crypt_v2_cache[i];
+        if (e->in_use
+            && memcmp(e->digest, digest, TLS_CRYPT_V2_CACHE_DIGEST_LEN) == 0)
+        {
+            e->last_used = ++tls_crypt_v2_cache_clock;
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void
+tls_crypt_v2_cache_add(const uint8_t *digest, const struct key2 *client_key,
+                       const struct buffer *metadata)
+{
+    if (BLEN(metadata) > (int)TLS_CRYPT_V2_MAX_METADATA_LEN)
+    {
+        return;
+    }
+    if (!tls_crypt_v2_cache)
+    {
+        ALLOC_ARRAY_CLEAR(tls_crypt_v2_cache, struct tls_crypt_v2_cache_entry,
+                          TLS_CRYPT_V2_CACHE_SIZE);
+    }
+
+    /* reuse a free slot, or evict the least recently used entry */
+    struct tls_crypt_v2_cache_entry *lru = &tls_crypt_v2_cache[0];
+    for (int i = 0; i < TLS_CRYPT_V2_CACHE_SIZE; ++i)
+    {
+        struct tls_crypt_v2_cache_entry *e = &tls_crypt_v2_cache[i];
+        if (!e->in_use)
+        {
+            lru = e;
+            break;
+        }
+        if (e->last_used < lru->last_used)
+        {
+            lru = e;
+        }
+    }
+
+    secure_memzero(lru, sizeof(*lru));
+    memcpy(lru->digest, digest, TLS_CRYPT_V2_CACHE_DIGEST_LEN);
+    lru->client_key = *client_key;
+    memcpy(lru->metadata, BPTR(metadata), BLEN(metadata));
+    lru->metadata_len = BLEN(metadata);
+    lru->last_used = ++tls_crypt_v2_cache_clock;
+    lru->in_use = true;
+}
+
+void
+tls_crypt_v2_cache_flush(void)
+{
+    if (tls_crypt_v2_cache)
+    {
+        secure_memzero(tls_crypt_v2_cache,
+                       sizeof(struct tls_crypt_v2_cache_entry)
+                       * TLS_CRYPT_V2_CACHE_SIZE);
+        free(tls_crypt_v2_cache);
+        tls_crypt_v2_cache = NULL;
+    }
+}
+
 bool
 tls_crypt_v2_extract_client_key(struct buffer *buf,
                                 struct tls_wrap_ctx *ctx,
@@ -586,6 +695,7 @@ tls_crypt_v2_extract_client_key(struct buffer *buf,
     if (BLEN(&wrapped_client_key) < sizeof(net_len))
     {
         msg(D_TLS_ERRORS, "failed to read length");
+        return false;
     }
     memcpy(&net_len, BEND(&wrapped_client_key) - sizeof(net_len),
            sizeof(net_len));
@@ -599,14 +709,38 @@ tls_crypt_v2_extract_client_key(struct buffer *buf,
 
     struct key2 client_key = { 0 };
     ctx->tls_crypt_v2_metadata = alloc_buf(TLS_CRYPT_V2_MAX_METADATA_LEN);
-    if (!tls_crypt_v2_unwrap_client_key(&client_key,
-                                        &ctx->tls_crypt_v2_metadata,
-                                        wrapped_client_key,
-                                        &ctx->tls_crypt_v2_server_key))
+
+    uint8_t digest[TLS_CRYPT_V2_CACHE_DIGEST_LEN];
+    const bool have_digest = tls_crypt_v2_cache_digest(&wrapped_client_key,
+                                                       digest);
+    struct tls_crypt_v2_cache_entry *cached =
+        have_digest ? tls_crypt_v2_cache_lookup(digest) : NULL;
+
+    if (cached)
     {
-        msg(D_TLS_ERRORS, "Can not unwrap tls-crypt-v2 client key");
-        secure_memzero(&client_key, sizeof(client_key));
-        return false;
+        ++tls_crypt_v2_cache_hits;
+        dmsg(D_TLS_DEBUG_MED, "tls-crypt-v2: client key served from cache");
+        client_key = cached->client_key;
+        ASSERT(buf_write(&ctx->tls_crypt_v2_metadata, cached->metadata,
+                         cached->metadata_len));
+    }
+    else
+    {
+        ++tls_crypt_v2_cache_misses;
+        if (!tls_crypt_v2_unwrap_client_key(&client_key,
+                                            &ctx->tls_crypt_v2_metadata,
+                                            wrapped_client_key,
+                                            &ctx->tls_crypt_v2_server_key))
+        {
+            msg(D_TLS_ERRORS, "Can not unwrap tls-crypt-v2 client key");
+            secure_memzero(&client_key, sizeof(client_key));
+            return false;
+        }
+        if (have_digest)
+        {
+            tls_crypt_v2_cache_add(digest, &client_key,
+                                   &ctx->tls_crypt_v2_metadata);
+        }
     }
 
     /* Load the decrypted key */
@@ -198,6 +198,13 @@ void tls_crypt_v2_init_client_key(struct key_ctx_bi *key,
  *
  * @returns true if a key was successfully extracted.
  */
+/**
+ * Wipe and free the cache of unwrapped tls-crypt-v2 client keys that
+ * tls_crypt_v2_extract_client_key() maintains to survive reconnect
+ * storms.  Called on server shutdown.
+ */
+void tls_crypt_v2_cache_flush(void);
+
 bool tls_crypt_v2_extract_client_key(struct buffer *buf,
                                      struct tls_wrap_ctx *ctx,
                                      const struct tls_options *opt);
@@ -0,0 +1,59 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Static tracepoints (USDT) at the packet processing stage boundaries.
+ * When built on a system with <sys/sdt.h> these compile to a single
+ * nop each, so they can stay enabled in production builds; external
+ * tools (bpftrace, perf probe, systemtap) attach to them by name under
+ * the "openvpn" provider to measure per-stage latency distributions
+ * without rebuilding.  Without <sys/sdt.h> they compile to nothing.
+ *
+ * Example:
+ *   bpftrace -e 'usdt::openvpn:link_process_start { @t[tid] = nsecs; }
+ *                usdt::openvpn:link_process_done
+ *                  { @lat = hist(nsecs - @t[tid]); delete(@t[tid]); }'
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define OPENVPN_PROBE(probe)              DTRACE_PROBE(openvpn, probe)
+#define OPENVPN_PROBE1(probe, a)          DTRACE_PROBE1(openvpn, probe, a)
+#define OPENVPN_PROBE2(probe, a, b)       DTRACE_PROBE2(openvpn, probe, a, b)
+#define OPENVPN_PROBE3(probe, a, b, c)    DTRACE_PROBE3(openvpn, probe, a, b, c)
+
+#else  /* ifdef HAVE_SYS_SDT_H */
+
+#define OPENVPN_PROBE(probe)
+#define OPENVPN_PROBE1(probe, a)
+#define OPENVPN_PROBE2(probe, a, b)
+#define OPENVPN_PROBE3(probe, a, b, c)
+
+#endif /* ifdef HAVE_SYS_SDT_H */
+
+#endif /* ifndef TRACE_H */
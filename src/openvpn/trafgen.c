@@ -0,0 +1,282 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Measure data channel throughput by generating synthetic tun-side
+ * traffic when the --bench-traffic option is used.  Sibling of the
+ * gremlin fault injector: gremlin perturbs the data path to test
+ * robustness, this module drives it at a target rate to test
+ * performance.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#include "syshead.h"
+
+#ifdef ENABLE_DEBUG
+
+#include "error.h"
+#include "common.h"
+#include "integer.h"
+#include "buffer.h"
+#include "otime.h"
+#include "proto.h"
+#include "forward.h"
+#include "ssl.h"
+#include "trafgen.h"
+
+#include "memdbg.h"
+
+/*
+ * Upper bound on packets injected per event loop pass, so that timers
+ * and link input are still serviced while the generator runs.
+ */
+#define TRAFGEN_MAX_BURST 64
+
+/* smallest generatable packet: IPv4 + UDP header */
+#define TRAFGEN_MIN_SIZE \
+    ((int)(sizeof(struct openvpn_iphdr) + sizeof(struct openvpn_udphdr)))
+
+/*
+ * Size mix used when --bench-traffic is given a packet size of 0,
+ * approximating the classic IMIX distribution.
+ */
+static const int imix_size[] = { 64, 576, 1400 };
+static const int imix_weight[] = { 7, 4, 1 };
+
+struct trafgen_state
+{
+    bool running;   /* clock started, packets being injected */
+    bool done;      /* target count reached or generator disabled */
+    uint64_t n_sent;
+    uint64_t n_bytes;
+    struct timeval start;
+    /* accumulated per-stage wall time, in microseconds */
+    uint64_t encrypt_usec;
+    uint64_t encrypt_usec_max;
+    uint64_t write_usec;
+    uint64_t write_usec_max;
+};
+
+static struct trafgen_state trafgen;
+
+static inline uint64_t
+trafgen_tv_usec(const struct timeval *from, const struct timeval *to)
+{
+    return (uint64_t)(to->tv_sec - from->tv_sec) * 1000000
+           + (to->tv_usec - from->tv_usec);
+}
+
+static int
+trafgen_packet_size(const struct context *c)
+{
+    int size = c->options.bench_traffic_size;
+
+    if (size == 0)
+    {
+        /* deterministic walk through the IMIX mix */
+        int slot = trafgen.n_sent % (imix_weight[0] + imix_weight[1] + imix_weight[2]);
+        int i = 0;
+        while (slot >= imix_weight[i])
+        {
+            slot -= imix_weight[i];
+            ++i;
+        }
+        size = imix_size[i];
+    }
+    return constrain_int(size, TRAFGEN_MIN_SIZE, MAX_RW_SIZE_TUN(&c->c2.frame));
+}
+
+/*
+ * Build a synthetic IPv4/UDP packet in c->c2.buf, the same way
+ * read_incoming_tun() would have left a real one there.
+ */
+static void
+trafgen_synth_packet(struct context *c, const int size)
+{
+    struct openvpn_iphdr ip;
+    struct openvpn_udphdr udp;
+
+    c->c2.buf = c->c2.buffers->read_tun_buf;
+    ASSERT(buf_init(&c->c2.buf, FRAME_HEADROOM(&c->c2.frame)));
+    ASSERT(buf_safe(&c->c2.buf, size));
+    memset(BPTR(&c->c2.buf), 0x5a, size);
+    c->c2.buf.len = size;
+
+    CLEAR(ip);
+    ip.version_len = 0x45;
+    ip.tot_len = htons(size);
+    ip.ttl = 64;
+    ip.protocol = OPENVPN_IPPROTO_UDP;
+    ip.saddr = htonl(0x0a080001);           /* 10.8.0.1 */
+    ip.daddr = htonl(0x0a080002);           /* 10.8.0.2 */
+
+    CLEAR(udp);
+    udp.source = htons(9);                  /* discard */
+    udp.dest = htons(9);
+    udp.len = htons(size - sizeof(ip));
+
+    memcpy(BPTR(&c->c2.buf), &ip, sizeof(ip));
+    memcpy(BPTR(&c->c2.buf) + sizeof(ip), &udp, sizeof(udp));
+}
+
+static void
+trafgen_report(struct context *c)
+{
+    struct timeval end;
+    openvpn_gettimeofday(&end, NULL);
+
+    const double secs = (double)trafgen_tv_usec(&trafgen.start, &end) / 1e6;
+    const double pps = secs > 0.0 ? (double)trafgen.n_sent / secs : 0.0;
+    const double mbit = secs > 0.0 ? (double)trafgen.n_bytes * 8.0 / secs / 1e6 : 0.0;
+
+    msg(M_INFO, "TRAFGEN: %" PRIu64 " packets (%" PRIu64 " bytes) in %.3f seconds",
+        trafgen.n_sent, trafgen.n_bytes, secs);
+    msg(M_INFO, "TRAFGEN: %.0f pkt/s, %.3f Mbit/s tun payload", pps, mbit);
+    if (trafgen.n_sent)
+    {
+        msg(M_INFO, "TRAFGEN: encrypt+encapsulate: mean %.1f us/pkt, max %" PRIu64 " us",
+            (double)trafgen.encrypt_usec / (double)trafgen.n_sent,
+            trafgen.encrypt_usec_max);
+        msg(M_INFO, "TRAFGEN: link write: mean %.1f us/pkt, max %" PRIu64 " us",
+            (double)trafgen.write_usec / (double)trafgen.n_sent,
+            trafgen.write_usec_max);
+    }
+    msg(M_INFO, "TRAFGEN: per-stage latency histograms available via management 'perf' command");
+}
+
+/*
+ * Called once per event loop pass from pre_select().  Injects up to
+ * a burst of synthetic packets through the regular data path and keeps
+ * the event loop spinning (zero timeout) while more are pending.
+ */
+void
+trafgen_pre_select(struct context *c)
+{
+    if (trafgen.done)
+    {
+        return;
+    }
+
+    /* wait for the data channel keys before starting the clock */
+    if (c->c2.tls_multi
+        && c->c2.tls_multi->session[TM_ACTIVE].key[KS_PRIMARY].state < S_ACTIVE)
+    {
+        return;
+    }
+
+    if (TUNNEL_TYPE(c->c1.tuntap) != DEV_TYPE_TUN)
+    {
+        msg(M_WARN, "TRAFGEN: --bench-traffic requires a tun device, disabling");
+        trafgen.done = true;
+        return;
+    }
+
+    if (!trafgen.running)
+    {
+        trafgen.running = true;
+        openvpn_gettimeofday(&trafgen.start, NULL);
+        msg(M_INFO, "TRAFGEN: starting, %d packets of size %d at %d pps (0 = unlimited)",
+            c->options.bench_traffic_n, c->options.bench_traffic_size,
+            c->options.bench_traffic_pps);
+    }
+
+    int burst = TRAFGEN_MAX_BURST;
+    const int pps = c->options.bench_traffic_pps;
+    if (pps > 0)
+    {
+        /* packets the schedule allows by now, minus what was sent */
+        struct timeval local_now;
+        openvpn_gettimeofday(&local_now, NULL);
+        const uint64_t due = trafgen_tv_usec(&trafgen.start, &local_now)
+                             * (uint64_t)pps / 1000000;
+        if (due <= trafgen.n_sent)
+        {
+            /* ahead of schedule -- wake up when the next packet is due */
+            c->c2.timeval.tv_sec = 0;
+            c->c2.timeval.tv_usec = 1000000 / pps + 1;
+            return;
+        }
+        const uint64_t backlog = due - trafgen.n_sent;
+        burst = backlog < TRAFGEN_MAX_BURST ? (int)backlog : TRAFGEN_MAX_BURST;
+    }
+
+    while (burst-- > 0 && trafgen.n_sent < (uint64_t)c->options.bench_traffic_n)
+    {
+        struct timeval t0, t1, t2;
+        const int size = trafgen_packet_size(c);
+
+        trafgen_synth_packet(c, size);
+
+        openvpn_gettimeofday(&t0, NULL);
+        process_incoming_tun(c);
+        openvpn_gettimeofday(&t1, NULL);
+        if (c->c2.to_link.len > 0)
+        {
+            process_outgoing_link(c);
+        }
+        openvpn_gettimeofday(&t2, NULL);
+
+        const uint64_t encrypt_usec = trafgen_tv_usec(&t0, &t1);
+        const uint64_t write_usec = trafgen_tv_usec(&t1, &t2);
+        trafgen.encrypt_usec += encrypt_usec;
+        if (encrypt_usec > trafgen.encrypt_usec_max)
+        {
+            trafgen.encrypt_usec_max = encrypt_usec;
+        }
+        trafgen.write_usec += write_usec;
+        if (write_usec > trafgen.write_usec_max)
+        {
+            trafgen.write_usec_max = write_usec;
+        }
+        ++trafgen.n_sent;
+        trafgen.n_bytes += size;
+
+        if (IS_SIG(c))
+        {
+            break;
+        }
+    }
+
+    if (trafgen.n_sent >= (uint64_t)c->options.bench_traffic_n)
+    {
+        trafgen_report(c);
+        trafgen.done = true;
+        return;
+    }
+
+    /* more to send -- keep the event loop spinning */
+    c->c2.timeval.tv_sec = 0;  /* ZERO-TIMEOUT */
+    c->c2.timeval.tv_usec = 0;
+}
+
+#else  /* ifdef ENABLE_DEBUG */
+static void
+dummy(void)
+{
+}
+#endif /* ifdef ENABLE_DEBUG */
@@ -0,0 +1,46 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TRAFGEN_H
+#define TRAFGEN_H
+
+#ifdef ENABLE_DEBUG
+
+#include "basic.h"
+
+struct context;
+
+/*
+ * Built-in traffic generator for data channel benchmarking, enabled
+ * with --bench-traffic.  Synthetic tun-side packets are injected into
+ * process_incoming_tun() and flushed out the link, so the whole
+ * encrypt -> encapsulate -> send path is measured in-process without
+ * an external traffic source.  Results are logged when the requested
+ * packet count has been sent; per-stage latency percentiles are
+ * available through the management 'perf' command.
+ */
+
+void trafgen_pre_select(struct context *c);
+
+#endif /* ifdef ENABLE_DEBUG */
+#endif /* ifndef TRAFGEN_H */
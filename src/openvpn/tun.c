@@ -648,7 +648,7 @@ tun_stat(const struct tuntap *tt, unsigned int rwflags, struct gc_arena *gc)
                        (tt->rwflags_debug & EVENT_WRITE) ? "W" : "w");
 #ifdef _WIN32
             buf_printf(&out, "%s",
-                       overlapped_io_state_ascii(&tt->writes));
+                       overlapped_io_state_ascii(&tt->writes[tt->writes_head]));
 #endif
         }
     }
@@ -895,7 +895,19 @@ init_tun_post(struct tuntap *tt,
     tt->options = *options;
 #ifdef _WIN32
     overlapped_io_init(&tt->reads, frame, FALSE, true);
-    overlapped_io_init(&tt->writes, frame, TRUE, true);
+    for (int i = 0; i < TUN_OVERLAPPED_WRITES; ++i)
+    {
+        overlapped_io_init(&tt->writes[i], frame, TRUE, true);
+    }
+    tt->writes_head = 0;
+    tt->writes_count = 0;
+
+    /* manual-reset event, permanently signaled: the ring has free slots */
+    tt->writes_space = CreateEvent(NULL, TRUE, TRUE, NULL);
+    if (tt->writes_space == NULL)
+    {
+        msg(M_ERR, "Error: init_tun_post: CreateEvent failed");
+    }
     tt->adapter_index = TUN_ADAPTER_INDEX_INVALID;
 
     if (tt->windows_driver == WINDOWS_DRIVER_WINTUN)
@@ -927,7 +939,7 @@ init_tun_post(struct tuntap *tt,
     else
     {
         tt->rw_handle.read = tt->reads.overlapped.hEvent;
-        tt->rw_handle.write = tt->writes.overlapped.hEvent;
+        tt->rw_handle.write = tt->writes_space;
     }
 #endif /* ifdef _WIN32 */
 }
@@ -1933,12 +1945,119 @@ read_tun(struct tuntap *tt, uint8_t *buf, int len)
 
 #elif defined(TARGET_LINUX)
 
+#include <sys/uio.h>
+
 #ifndef HAVE_LINUX_SOCKIOS_H
 #error header file linux/sockios.h required
 #endif
 
+/* IFF_NAPI appeared in Linux 4.14; the value is part of the kernel ABI */
+#ifndef IFF_NAPI
+#define IFF_NAPI 0x0010
+#endif
+
+/* IFF_MULTI_QUEUE appeared in Linux 3.8 */
+#ifndef IFF_MULTI_QUEUE
+#define IFF_MULTI_QUEUE 0x0100
+#endif
+
+/* IFF_VNET_HDR and the TUNSETOFFLOAD flags are ancient (2.6.27) but
+ * may be missing from older toolchain headers */
+#ifndef IFF_VNET_HDR
+#define IFF_VNET_HDR 0x4000
+#endif
+#ifndef TUN_F_CSUM
+#define TUN_F_CSUM 0x01
+#endif
+#ifndef TUN_F_TSO4
+#define TUN_F_TSO4 0x02
+#endif
+#ifndef TUN_F_TSO6
+#define TUN_F_TSO6 0x04
+#endif
+
 #if !PEDANTIC
 
+/*
+ * --tun-fd-socket: receive an already-created and configured device fd
+ * from a privileged helper instead of opening /dev/net/tun ourselves,
+ * which requires CAP_NET_ADMIN for the TUNSETIFF ioctl.  The helper
+ * sends a single message whose body is the interface name, with the
+ * device fd attached as SCM_RIGHTS ancillary data.
+ */
+static void
+open_tun_fd_socket(struct tuntap *tt)
+{
+    struct sockaddr_un remote;
+    char ifname[IFNAMSIZ];
+    struct msghdr mesg;
+    struct iovec iov;
+    uint8_t cbuf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr *cm;
+    ssize_t len;
+    int sd;
+
+    sd = socket(PF_UNIX, SOCK_STREAM, 0);
+    if (sd < 0)
+    {
+        msg(M_ERR, "--tun-fd-socket: cannot create unix socket");
+    }
+    CLEAR(remote);
+    remote.sun_family = AF_UNIX;
+    strncpynt(remote.sun_path, tt->options.fd_socket,
+              sizeof(remote.sun_path));
+    if (connect(sd, (struct sockaddr *) &remote, sizeof(remote)) < 0)
+    {
+        msg(M_ERR, "--tun-fd-socket: cannot connect to helper at %s",
+            tt->options.fd_socket);
+    }
+
+    CLEAR(mesg);
+    CLEAR(ifname);
+    iov.iov_base = ifname;
+    iov.iov_len = sizeof(ifname) - 1;
+    mesg.msg_iov = &iov;
+    mesg.msg_iovlen = 1;
+    mesg.msg_control = cbuf;
+    mesg.msg_controllen = sizeof(cbuf);
+
+    len = recvmsg(sd, &mesg, 0);
+    if (len <= 0)
+    {
+        msg(M_ERR, "--tun-fd-socket: no message received from helper");
+    }
+    ifname[len] = '\0';
+
+    tt->fd = -1;
+    for (cm = CMSG_FIRSTHDR(&mesg); cm; cm = CMSG_NXTHDR(&mesg, cm))
+    {
+        if (cm->cmsg_level == SOL_SOCKET
+            && cm->cmsg_type == SCM_RIGHTS
+            && cm->cmsg_len >= CMSG_LEN(sizeof(int)))
+        {
+            memcpy(&tt->fd, CMSG_DATA(cm), sizeof(int));
+            break;
+        }
+    }
+    close(sd);
+    if (tt->fd < 0)
+    {
+        msg(M_FATAL, "--tun-fd-socket: helper message carried no device fd");
+    }
+    if (!ifname[0])
+    {
+        msg(M_FATAL, "--tun-fd-socket: helper message carried no interface name");
+    }
+
+    set_nonblock(tt->fd);
+    set_cloexec(tt->fd);
+    tt->n_queues = 1;
+    tt->queue_fds[0] = tt->fd;
+    tt->actual_name = string_alloc(ifname, NULL);
+    msg(M_INFO, "TUN/TAP device %s: fd received from helper at %s",
+        ifname, tt->options.fd_socket);
+}
+
 void
 open_tun(const char *dev, const char *dev_type, const char *dev_node, struct tuntap *tt)
 {
@@ -1951,6 +2070,10 @@ open_tun(const char *dev, const char *dev_type, const char *dev_node, struct tun
     {
         open_null(tt);
     }
+    else if (tt->options.fd_socket)
+    {
+        open_tun_fd_socket(tt);
+    }
     else
     {
         /*
@@ -1980,6 +2103,32 @@ open_tun(const char *dev, const char *dev_type, const char *dev_node, struct tun
         ifr.ifr_flags |= IFF_ONE_QUEUE;
 #endif
 
+        /*
+         * Process --tun-napi
+         */
+        if (tt->options.napi)
+        {
+            ifr.ifr_flags |= IFF_NAPI;
+        }
+
+        /*
+         * Process --tun-queues
+         */
+        tt->n_queues = 1;
+        if (tt->options.n_queues > 1)
+        {
+            ifr.ifr_flags |= IFF_MULTI_QUEUE;
+        }
+
+        /*
+         * Process --tun-offload: ask for virtio-net-hdr framing so the
+         * kernel can hand us coalesced (GSO) TCP super-packets
+         */
+        if (tt->options.offload && tt->type == DEV_TYPE_TUN)
+        {
+            ifr.ifr_flags |= IFF_VNET_HDR;
+        }
+
         /*
          * Figure out if tun or tap device
          */
@@ -2011,7 +2160,66 @@ open_tun(const char *dev, const char *dev_type, const char *dev_node, struct tun
          */
         if (ioctl(tt->fd, TUNSETIFF, (void *) &ifr) < 0)
         {
-            msg(M_ERR, "ERROR: Cannot ioctl TUNSETIFF %s", dev);
+            /* an old kernel rejects unknown TUNSETIFF flags with EINVAL;
+             * retry without the optional ones before giving up */
+            if (errno == EINVAL
+                && (ifr.ifr_flags & (IFF_NAPI|IFF_MULTI_QUEUE|IFF_VNET_HDR)))
+            {
+                msg(M_WARN, "Note: Kernel does not support IFF_NAPI/IFF_MULTI_QUEUE/IFF_VNET_HDR on %s", dev);
+                ifr.ifr_flags &= ~(IFF_NAPI|IFF_MULTI_QUEUE|IFF_VNET_HDR);
+            }
+            if (ioctl(tt->fd, TUNSETIFF, (void *) &ifr) < 0)
+            {
+                msg(M_ERR, "ERROR: Cannot ioctl TUNSETIFF %s", dev);
+            }
+        }
+
+        /*
+         * Attach the remaining queues to the device just created
+         */
+        tt->queue_fds[0] = tt->fd;
+        if (ifr.ifr_flags & IFF_MULTI_QUEUE)
+        {
+            int i;
+
+            for (i = 1; i < tt->options.n_queues; ++i)
+            {
+                int qfd = open(node, O_RDWR);
+
+                if (qfd < 0
+                    || ioctl(qfd, TUNSETIFF, (void *) &ifr) < 0)
+                {
+                    msg(M_ERR, "ERROR: Cannot attach queue %d to %s",
+                        i, ifr.ifr_name);
+                }
+                set_nonblock(qfd);
+                set_cloexec(qfd);
+                tt->queue_fds[i] = qfd;
+            }
+            tt->n_queues = tt->options.n_queues;
+            msg(M_INFO, "TUN/TAP device %s using %d queues",
+                ifr.ifr_name, tt->n_queues);
+        }
+
+        /*
+         * Enable the checksum/TSO offloads behind --tun-offload.  The
+         * vnet header framing is active as soon as IFF_VNET_HDR was
+         * accepted, independently of whether TUNSETOFFLOAD succeeds.
+         */
+        if (ifr.ifr_flags & IFF_VNET_HDR)
+        {
+            tt->vnet_hdr = true;
+            if (ioctl(tt->fd, TUNSETOFFLOAD,
+                      TUN_F_CSUM|TUN_F_TSO4|TUN_F_TSO6) < 0)
+            {
+                msg(M_WARN | M_ERRNO, "Note: Cannot set TSO offloads on %s",
+                    ifr.ifr_name);
+            }
+            else
+            {
+                msg(M_INFO, "TUN/TAP device %s: GSO/checksum offload enabled",
+                    ifr.ifr_name);
+            }
         }
 
         msg(M_INFO, "TUN/TAP device %s opened", ifr.ifr_name);
@@ -2047,6 +2255,25 @@ open_tun(const char *dev, const char *dev_type, const char *dev_node, struct tun
         }
 #endif /* if defined(IFF_ONE_QUEUE) && defined(SIOCSIFTXQLEN) */
 
+        /*
+         * Process --tun-sndbuf
+         */
+#ifdef TUNSETSNDBUF
+        if (tt->options.sndbuf)
+        {
+            if (ioctl(tt->fd, TUNSETSNDBUF, &tt->options.sndbuf) < 0)
+            {
+                msg(M_WARN | M_ERRNO, "Note: Cannot set sndbuf size on %s",
+                    ifr.ifr_name);
+            }
+            else
+            {
+                msg(D_OSBUF, "TUN/TAP sndbuf size set to %d",
+                    tt->options.sndbuf);
+            }
+        }
+#endif
+
         set_nonblock(tt->fd);
         set_cloexec(tt->fd);
         tt->actual_name = string_alloc(ifr.ifr_name, NULL);
@@ -2182,6 +2409,8 @@ undo_ifconfig_ipv6(struct tuntap *tt, openvpn_net_ctx_t *ctx)
 void
 close_tun(struct tuntap *tt, openvpn_net_ctx_t *ctx)
 {
+    int i;
+
     ASSERT(tt);
 
     if (tt->type != DEV_TYPE_NULL)
@@ -2200,6 +2429,12 @@ close_tun(struct tuntap *tt, openvpn_net_ctx_t *ctx)
         net_ctx_reset(ctx);
     }
 
+    /* queue 0 is tt->fd, owned by close_tun_generic() */
+    for (i = 1; i < tt->n_queues; ++i)
+    {
+        close(tt->queue_fds[i]);
+    }
+
     close_tun_generic(tt);
     free(tt);
 }
@@ -2207,13 +2442,73 @@ close_tun(struct tuntap *tt, openvpn_net_ctx_t *ctx)
 int
 write_tun(struct tuntap *tt, uint8_t *buf, int len)
 {
+    if (tt->vnet_hdr)
+    {
+        /* packets we hand to the kernel are plain MTU-sized frames
+         * with finished checksums, so the header is all zeros */
+        struct tun_vnet_hdr hdr;
+        struct iovec iov[2];
+        int ret;
+
+        CLEAR(hdr);
+        iov[0].iov_base = &hdr;
+        iov[0].iov_len = sizeof(hdr);
+        iov[1].iov_base = buf;
+        iov[1].iov_len = len;
+        ret = writev(tt->fd, iov, 2);
+        return ret >= (int) sizeof(hdr) ? ret - (int) sizeof(hdr) : ret;
+    }
     return write(tt->fd, buf, len);
 }
 
+/* read one packet from a queue fd, stripping and saving the virtio-net
+ * header when the device was opened with IFF_VNET_HDR */
+static inline int
+read_tun_queue(struct tuntap *tt, int fd, uint8_t *buf, int len)
+{
+    if (tt->vnet_hdr)
+    {
+        struct iovec iov[2];
+        int ret;
+
+        iov[0].iov_base = &tt->rx_vnet_hdr;
+        iov[0].iov_len = sizeof(tt->rx_vnet_hdr);
+        iov[1].iov_base = buf;
+        iov[1].iov_len = len;
+        ret = readv(fd, iov, 2);
+        if (ret >= (int) sizeof(tt->rx_vnet_hdr))
+        {
+            return ret - (int) sizeof(tt->rx_vnet_hdr);
+        }
+        return ret < 0 ? ret : 0;
+    }
+    return read(fd, buf, len);
+}
+
 int
 read_tun(struct tuntap *tt, uint8_t *buf, int len)
 {
-    return read(tt->fd, buf, len);
+    if (tt->n_queues > 1)
+    {
+        int i;
+
+        /* round robin over the queues so a busy one cannot starve
+         * the others; remember where to pick up on the next call */
+        for (i = 0; i < tt->n_queues; ++i)
+        {
+            const int q = (tt->rr_queue + i) % tt->n_queues;
+            const int ret = read_tun_queue(tt, tt->queue_fds[q], buf, len);
+
+            if (ret >= 0 || errno != EAGAIN)
+            {
+                tt->rr_queue = (q + 1) % tt->n_queues;
+                return ret;
+            }
+        }
+        errno = EAGAIN;
+        return -1;
+    }
+    return read_tun_queue(tt, tt->fd, buf, len);
 }
 
 #elif defined(TARGET_SOLARIS)
@@ -3491,67 +3786,134 @@ tun_read_queue(struct tuntap *tt, int maxsize)
     return tt->reads.iostate;
 }
 
+/*
+ * Point the event loop at the right write event: the always-signaled
+ * "space" event while the ring has a free slot, or the oldest in-flight
+ * operation's completion event when it is full.
+ */
+static void
+tun_write_update_event(struct tuntap *tt)
+{
+    if (tt->writes_count == TUN_OVERLAPPED_WRITES)
+    {
+        tt->rw_handle.write = tt->writes[tt->writes_head].overlapped.hEvent;
+    }
+    else
+    {
+        tt->rw_handle.write = tt->writes_space;
+    }
+}
+
 int
 tun_write_queue(struct tuntap *tt, struct buffer *buf)
 {
-    if (tt->writes.iostate == IOSTATE_INITIAL)
+    if (tt->writes_count < TUN_OVERLAPPED_WRITES)
     {
+        struct overlapped_io *io =
+            &tt->writes[(tt->writes_head + tt->writes_count) % TUN_OVERLAPPED_WRITES];
         BOOL status;
         int err;
 
+        ASSERT(io->iostate == IOSTATE_INITIAL);
+
         /* make a private copy of buf */
-        tt->writes.buf = tt->writes.buf_init;
-        tt->writes.buf.len = 0;
-        ASSERT(buf_copy(&tt->writes.buf, buf));
+        io->buf = io->buf_init;
+        io->buf.len = 0;
+        ASSERT(buf_copy(&io->buf, buf));
 
         /* the overlapped write will signal this event on I/O completion */
-        ASSERT(ResetEvent(tt->writes.overlapped.hEvent));
+        ASSERT(ResetEvent(io->overlapped.hEvent));
 
         status = WriteFile(
             tt->hand,
-            BPTR(&tt->writes.buf),
-            BLEN(&tt->writes.buf),
-            &tt->writes.size,
-            &tt->writes.overlapped
+            BPTR(&io->buf),
+            BLEN(&io->buf),
+            &io->size,
+            &io->overlapped
             );
 
         if (status) /* operation completed immediately? */
         {
-            tt->writes.iostate = IOSTATE_IMMEDIATE_RETURN;
+            io->iostate = IOSTATE_IMMEDIATE_RETURN;
 
             /* since we got an immediate return, we must signal the event object ourselves */
-            ASSERT(SetEvent(tt->writes.overlapped.hEvent));
+            ASSERT(SetEvent(io->overlapped.hEvent));
 
-            tt->writes.status = 0;
+            io->status = 0;
 
             dmsg(D_WIN32_IO, "WIN32 I/O: TAP Write immediate return [%d,%d]",
-                 BLEN(&tt->writes.buf),
-                 (int) tt->writes.size);
+                 BLEN(&io->buf),
+                 (int) io->size);
         }
         else
         {
             err = GetLastError();
             if (err == ERROR_IO_PENDING) /* operation queued? */
             {
-                tt->writes.iostate = IOSTATE_QUEUED;
-                tt->writes.status = err;
+                io->iostate = IOSTATE_QUEUED;
+                io->status = err;
                 dmsg(D_WIN32_IO, "WIN32 I/O: TAP Write queued [%d]",
-                     BLEN(&tt->writes.buf));
+                     BLEN(&io->buf));
             }
             else /* error occurred */
             {
                 struct gc_arena gc = gc_new();
-                ASSERT(SetEvent(tt->writes.overlapped.hEvent));
-                tt->writes.iostate = IOSTATE_IMMEDIATE_RETURN;
-                tt->writes.status = err;
+                ASSERT(SetEvent(io->overlapped.hEvent));
+                io->iostate = IOSTATE_IMMEDIATE_RETURN;
+                io->status = err;
                 dmsg(D_WIN32_IO, "WIN32 I/O: TAP Write error [%d] : %s",
-                     BLEN(&tt->writes.buf),
+                     BLEN(&io->buf),
                      strerror_win32(err, &gc));
                 gc_free(&gc);
             }
         }
+
+        ++tt->writes_count;
+        tun_write_update_event(tt);
+        return io->iostate;
+    }
+    return IOSTATE_QUEUED;
+}
+
+/*
+ * Retire completed writes from the head of the ring, in FIFO order,
+ * stopping at the first operation still in flight.  Returns 0, or -1
+ * with GetLastError() set if a completed write reported an error.
+ */
+int
+tun_write_reap(struct tuntap *tt)
+{
+    int ret = 0;
+    int err = 0;
+
+    while (tt->writes_count > 0)
+    {
+        struct overlapped_io *io = &tt->writes[tt->writes_head];
+
+        if (io->iostate == IOSTATE_QUEUED
+            && !HasOverlappedIoCompleted(&io->overlapped))
+        {
+            break;
+        }
+        if (tun_finalize(tt->hand, io, NULL) < 0)
+        {
+            if (GetLastError() == ERROR_IO_INCOMPLETE)
+            {
+                break;
+            }
+            ret = -1;
+            err = GetLastError();
+        }
+        tt->writes_head = (tt->writes_head + 1) % TUN_OVERLAPPED_WRITES;
+        --tt->writes_count;
+    }
+
+    tun_write_update_event(tt);
+    if (ret < 0)
+    {
+        SetLastError(err);
     }
-    return tt->writes.iostate;
+    return ret;
 }
 
 int
@@ -5207,7 +5569,15 @@ netsh_command(const struct argv *a, int n, int msglevel)
     for (i = 0; i < n; ++i)
     {
         bool status;
-        management_sleep(1);
+        if (i > 0)
+        {
+            /* the attempt failed; give the adapter time to settle
+             * before retrying.  The first attempt runs immediately --
+             * an unconditional pre-sleep here used to serialize one
+             * second of dead time into every netsh invocation, which
+             * dominated tunnel-up latency on Windows */
+            management_sleep(4);
+        }
         netcmd_semaphore_lock();
         argv_msg_prefix(M_INFO, a, "NETSH");
         status = openvpn_execve_check(a, NULL, 0, "ERROR: netsh command failed");
@@ -5216,7 +5586,6 @@ netsh_command(const struct argv *a, int n, int msglevel)
         {
             return;
         }
-        management_sleep(4);
     }
     msg(msglevel, "NETSH: command failed");
 }
@@ -6884,8 +7253,19 @@ close_tun(struct tuntap *tt, openvpn_net_ctx_t *ctx)
     dmsg(D_WIN32_IO_LOW, "Attempting close of overlapped read event on TAP-Windows adapter");
     overlapped_io_close(&tt->reads);
 
-    dmsg(D_WIN32_IO_LOW, "Attempting close of overlapped write event on TAP-Windows adapter");
-    overlapped_io_close(&tt->writes);
+    dmsg(D_WIN32_IO_LOW, "Attempting close of overlapped write events on TAP-Windows adapter");
+    for (int i = 0; i < TUN_OVERLAPPED_WRITES; ++i)
+    {
+        overlapped_io_close(&tt->writes[i]);
+    }
+
+    if (tt->writes_space != NULL)
+    {
+        if (!CloseHandle(tt->writes_space))
+        {
+            msg(M_WARN | M_ERRNO, "Warning: CloseHandle failed on write space event");
+        }
+    }
 
     if (tt->hand != NULL)
     {
@@ -83,6 +83,9 @@ struct tuntap_options {
     /* --tap-sleep option */
     int tap_sleep;
 
+    /* --wintun-spin option */
+    int wintun_spin;
+
     /* --dhcp-option options */
 
     bool dhcp_options;
@@ -134,8 +137,41 @@ struct tuntap_options {
 
 struct tuntap_options {
     int txqueuelen;
+    int sndbuf;     /* TUNSETSNDBUF value, 0 leaves the kernel default */
+    bool napi;      /* request IFF_NAPI at TUNSETIFF time */
+    int n_queues;   /* IFF_MULTI_QUEUE queue count, 0/1 for a single queue */
+    bool offload;   /* --tun-offload: IFF_VNET_HDR + TUNSETOFFLOAD (TSO) */
+    const char *fd_socket; /* --tun-fd-socket: receive a pre-configured
+                            * device fd from a privileged helper instead
+                            * of opening /dev/net/tun ourselves */
+};
+
+/* upper bound for --tun-queues, far below the kernel's MAX_TAP_QUEUES */
+#define TUN_MAX_QUEUES 16
+
+/*
+ * Mirror of the kernel's struct virtio_net_hdr and the constants we
+ * use from it.  The layout and values are fixed kernel ABI; defining
+ * them here avoids dragging linux/virtio_net.h into every includer.
+ * When the device is opened with IFF_VNET_HDR, every packet on the fd
+ * is prefixed with one of these.
+ */
+struct tun_vnet_hdr {
+    uint8_t flags;
+    uint8_t gso_type;
+    uint16_t hdr_len;       /* ethernet + ip + tcp/udp header length */
+    uint16_t gso_size;      /* payload bytes per segment (the MSS) */
+    uint16_t csum_start;    /* checksum coverage starts here... */
+    uint16_t csum_offset;   /* ...and the field lives this far beyond it */
 };
 
+#define TUN_VNET_HDR_F_NEEDS_CSUM 0x01  /* csum_start/csum_offset valid */
+
+#define TUN_VNET_GSO_NONE  0
+#define TUN_VNET_GSO_TCPV4 1
+#define TUN_VNET_GSO_TCPV6 4
+#define TUN_VNET_GSO_ECN   0x80        /* modifier bit on the TCP types */
+
 #else  /* if defined(_WIN32) || defined(TARGET_ANDROID) */
 
 struct tuntap_options {
@@ -179,7 +215,20 @@ struct tuntap
 #ifdef _WIN32
     HANDLE hand;
     struct overlapped_io reads;
-    struct overlapped_io writes;
+
+/* number of overlapped tun writes kept in flight against the driver */
+#define TUN_OVERLAPPED_WRITES 4
+
+    /*
+     * Ring of overlapped tun writes; writes_head is the oldest
+     * in-flight operation.  The event loop waits on writes_space
+     * (always signaled) while a slot is free, and on the head
+     * operation's completion event when the ring is full.
+     */
+    struct overlapped_io writes[TUN_OVERLAPPED_WRITES];
+    int writes_head;
+    int writes_count;
+    HANDLE writes_space;
     struct rw_handle rw_handle;
 
     /* used for setting interface address via IP Helper API
@@ -200,10 +249,29 @@ struct tuntap
     HANDLE wintun_receive_ring_handle;
     struct tun_ring *wintun_send_ring;
     struct tun_ring *wintun_receive_ring;
+
+    /* number of times the send ring ran dry and we armed the driver
+     * wakeup event, and times the receive ring was found full */
+    counter_type wintun_ring_empty;
+    counter_type wintun_ring_full;
 #else  /* ifdef _WIN32 */
     int fd; /* file descriptor for TUN/TAP dev */
 #endif /* ifdef _WIN32 */
 
+#ifdef TARGET_LINUX
+    /* IFF_MULTI_QUEUE: all queue fds including fd (== queue_fds[0]);
+     * n_queues is 1 for a conventional single-queue device */
+    int queue_fds[TUN_MAX_QUEUES];
+    int n_queues;
+    int rr_queue;               /* next queue read_tun() will try first */
+
+    /* --tun-offload: device accepted IFF_VNET_HDR, so reads and writes
+     * carry a virtio-net header; rx_vnet_hdr holds the header of the
+     * packet most recently returned by read_tun() */
+    bool vnet_hdr;
+    struct tun_vnet_hdr rx_vnet_hdr;
+#endif
+
 #ifdef TARGET_SOLARIS
     int ip_fd;
 #endif
@@ -450,6 +518,8 @@ int tun_read_queue(struct tuntap *tt, int maxsize);
 
 int tun_write_queue(struct tuntap *tt, struct buffer *buf);
 
+int tun_write_reap(struct tuntap *tt);
+
 int tun_finalize(HANDLE h, struct overlapped_io *io, struct buffer *buf);
 
 static inline bool
@@ -483,14 +553,16 @@ static inline int
 tun_write_win32(struct tuntap *tt, struct buffer *buf)
 {
     int err = 0;
-    int status = 0;
-    if (overlapped_io_active(&tt->writes))
+    int status = tun_write_reap(tt);
+    if (status < 0)
     {
-        status = tun_finalize(tt->hand, &tt->writes, NULL);
-        if (status < 0)
-        {
-            err = GetLastError();
-        }
+        err = GetLastError();
+    }
+    if (tt->writes_count == TUN_OVERLAPPED_WRITES)
+    {
+        /* ring full and the oldest write still in flight */
+        SetLastError(ERROR_IO_INCOMPLETE);
+        return -1;
     }
     tun_write_queue(tt, buf);
     if (status < 0)
@@ -522,6 +594,46 @@ wintun_ring_wrap(ULONG value)
     return value & (WINTUN_RING_CAPACITY - 1);
 }
 
+/*
+ * Busy-poll the send ring for up to the --wintun-spin budget before
+ * falling back to the driver's tail_moved event.  While we spin the
+ * ring is marked non-alertable, so the driver skips the kernel event
+ * signal on every packet it queues; the flag is re-armed, and the ring
+ * re-checked to close the race, before the caller goes to sleep.
+ *
+ * Returns true if the ring has data to read.
+ */
+static inline bool
+wintun_ring_spin(struct tuntap *tt)
+{
+    struct tun_ring *ring = tt->wintun_send_ring;
+    int budget = tt->options.wintun_spin;
+
+    if (budget <= 0)
+    {
+        return false;
+    }
+    ring->alertable = 0;
+    while (budget-- > 0)
+    {
+        if (ring->head != ring->tail)
+        {
+            return true;
+        }
+        YieldProcessor();
+    }
+
+    /* spin budget exhausted -- re-arm the wakeup event */
+    ring->alertable = 1;
+    ++tt->wintun_ring_empty;
+    if (ring->head != ring->tail)
+    {
+        ring->alertable = 0;
+        return true;
+    }
+    return false;
+}
+
 static inline void
 read_wintun(struct tuntap *tt, struct buffer *buf)
 {
@@ -632,6 +744,7 @@ write_wintun(struct tuntap *tt, struct buffer *buf)
     buf_space = wintun_ring_wrap(head - tail - WINTUN_PACKET_ALIGN);
     if (aligned_packet_size > buf_space)
     {
+        ++tt->wintun_ring_full;
         msg(M_INFO, "write_wintun(): ring is full");
         return 0;
     }
@@ -718,6 +831,13 @@ tun_set(struct tuntap *tt,
         if (!persistent || *persistent != rwflags)
         {
             event_ctl(es, tun_event_handle(tt), rwflags, arg);
+#ifdef TARGET_LINUX
+            /* the extra IFF_MULTI_QUEUE fds share the same status shift */
+            for (int i = 1; i < tt->n_queues; ++i)
+            {
+                event_ctl(es, tt->queue_fds[i], rwflags, arg);
+            }
+#endif
             if (persistent)
             {
                 *persistent = rwflags;
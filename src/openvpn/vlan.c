@@ -161,10 +161,10 @@ vlan_decapsulate(const struct context *c, struct buffer *buf)
              * non-tagged frame
              */
             buf_advance(buf, SIZE_ETH_TO_8021Q_HDR);
-            /* move the content of the 802.1q header to the new head, so that
-             * src/dst addresses are copied over
+            /* move only the dst/src addresses to the new head; the
+             * constant 12-byte move is inlined by the compiler
              */
-            ethhdr = memmove(BPTR(buf), vlanhdr, sizeof(*ethhdr));
+            ethhdr = memmove(BPTR(buf), vlanhdr, OPENVPN_ETH_ALEN * 2);
             /* restore the inner protocol value */
             ethhdr->proto = proto;
 
@@ -221,7 +221,9 @@ vlan_encapsulate(const struct context *c, struct buffer *buf)
     {
         /* Untagged frame. */
 
-        /* Not enough head room for VLAN tag? */
+        /* Not enough head room for VLAN tag?  Cannot happen when
+         * --vlan-tagging reserved the tag slot in extra frame space,
+         * but keep the check for buffers sized without it. */
         if (buf_reverse_capacity(buf) < SIZE_ETH_TO_8021Q_HDR)
         {
             goto drop;
@@ -231,14 +233,15 @@ vlan_encapsulate(const struct context *c, struct buffer *buf)
                                                          SIZE_ETH_TO_8021Q_HDR);
 
         /* Initialise VLAN/802.1q header.
-         * Move the Eth header so to keep dst/src addresses the same and then
+         * Move only the dst/src addresses into the reserved headroom
+         * (a constant 12-byte move the compiler inlines) and then
          * assign the other fields.
          *
          * Also, save the inner protocol first, so that it can be restored later
          * after the memmove()
          */
         uint16_t proto = ethhdr->proto;
-        memmove(vlanhdr, ethhdr, sizeof(*ethhdr));
+        memmove(vlanhdr, ethhdr, OPENVPN_ETH_ALEN * 2);
         vlanhdr->tpid = htons(OPENVPN_ETH_P_8021Q);
         vlanhdr->pcp_cfi_vid = 0;
         vlanhdr->proto = proto;
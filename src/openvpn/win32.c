@@ -55,9 +55,14 @@
 #include "block_dns.h"
 
 /*
- * WFP handle
+ * WFP handle, and the adapter the block-dns filters are currently
+ * installed for.  The filters persist across soft restarts so a
+ * reconnect neither pays the full WFP session setup again nor opens a
+ * DNS-leak window between teardown and re-add.
  */
 static HANDLE m_hEngineHandle = NULL; /* GLOBAL */
+static NET_IFINDEX block_dns_index = 0; /* GLOBAL */
+static bool block_dns_active = false; /* GLOBAL */
 
 /*
  * TAP adapter original metric value
@@ -1325,6 +1330,20 @@ win_wfp_block_dns(const NET_IFINDEX index, const HANDLE msg_channel)
     bool ret = false;
     DWORD status;
 
+    if (block_dns_active)
+    {
+        if (block_dns_index == index)
+        {
+            /* filters survived the restart -- nothing to do */
+            dmsg(D_LOW, "Reusing block dns filters installed for adapter %lu",
+                 (unsigned long) index);
+            return true;
+        }
+        /* reconnect landed on a different adapter: replace the old
+         * filters before installing the new ones */
+        win_wfp_uninit(block_dns_index, msg_channel, false);
+    }
+
     if (msg_channel)
     {
         dmsg(D_LOW, "Using service to add block dns filters");
@@ -1364,13 +1383,26 @@ win_wfp_block_dns(const NET_IFINDEX index, const HANDLE msg_channel)
     ret = (status == 0);
 
 out:
+    if (ret)
+    {
+        block_dns_active = true;
+        block_dns_index = index;
+    }
 
     return ret;
 }
 
 bool
-win_wfp_uninit(const NET_IFINDEX index, const HANDLE msg_channel)
+win_wfp_uninit(const NET_IFINDEX index, const HANDLE msg_channel, bool persist)
 {
+    if (persist && block_dns_active)
+    {
+        /* soft restart: leave the filters in place so outside DNS
+         * stays blocked while we reconnect */
+        dmsg(D_LOW, "Keeping block dns filters across restart");
+        return true;
+    }
+
     dmsg(D_LOW, "Uninitializing WFP");
 
     if (msg_channel)
@@ -1391,6 +1423,7 @@ win_wfp_uninit(const NET_IFINDEX index, const HANDLE msg_channel)
             set_interface_metric(index, AF_INET6, tap_metric_v6);
         }
     }
+    block_dns_active = false;
 
     return true;
 }
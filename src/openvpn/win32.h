@@ -296,7 +296,9 @@ WCHAR *wide_string(const char *utf8, struct gc_arena *gc);
 
 bool win_wfp_block_dns(const NET_IFINDEX index, const HANDLE msg_channel);
 
-bool win_wfp_uninit(const NET_IFINDEX index, const HANDLE msg_channel);
+/* persist keeps the installed filters alive across a soft restart */
+bool win_wfp_uninit(const NET_IFINDEX index, const HANDLE msg_channel,
+                    bool persist);
 
 #define WIN_XP    0
 #define WIN_VISTA 1
@@ -0,0 +1,92 @@
+#! /bin/sh
+#
+# t_bench.sh - data channel throughput benchmark over a local
+# loopback tunnel, using the built-in --bench-traffic generator.
+#
+# Unlike t_lpback.sh this measures performance rather than
+# correctness, so it is not part of 'make check'; run it manually
+# (requires root for tun device setup).
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+
+set -eu
+top_builddir="${top_builddir:-..}"
+openvpn="${top_builddir}/src/openvpn/openvpn"
+
+# benchmark parameters, overridable from the environment
+BENCH_N="${BENCH_N:-100000}"
+BENCH_SIZE="${BENCH_SIZE:-1400}"
+BENCH_PPS="${BENCH_PPS:-0}"
+
+if [ "$(id -u)" != 0 ] || [ ! -c /dev/net/tun ]
+then
+    echo "$0: requires root and /dev/net/tun, skipping" >&2
+    exit 77
+fi
+
+key="key.$$"
+log_peer="log-peer.$$"
+log_gen="log-gen.$$"
+peer_pid=""
+
+cleanup()
+{
+    test -n "${peer_pid}" && kill "${peer_pid}" 2>/dev/null
+    rm -f "${key}" "${log_peer}" "${log_gen}"
+}
+trap "cleanup ; trap 0 ; exit 77" 1 2 15
+trap "cleanup ; exit 1" 0 3
+
+"${openvpn}" --genkey secret "${key}"
+
+# passive peer: decrypts and writes the generated traffic to its tun
+"${openvpn}" \
+    --dev tun --ifconfig 10.8.0.2 10.8.0.1 \
+    --local 127.0.0.1 --lport 16100 --remote 127.0.0.1 --rport 16101 \
+    --secret "${key}" --verb 3 --log "${log_peer}" &
+peer_pid=$!
+sleep 1
+
+# generator: injects synthetic tun traffic and reports throughput
+"${openvpn}" \
+    --dev tun --ifconfig 10.8.0.1 10.8.0.2 \
+    --local 127.0.0.1 --lport 16101 --remote 127.0.0.1 --rport 16100 \
+    --secret "${key}" --verb 3 --log "${log_gen}" \
+    --bench-traffic "${BENCH_N}" "${BENCH_SIZE}" "${BENCH_PPS}" \
+    --inactive 10 --ping 1 &
+gen_pid=$!
+
+# wait for the generator to finish or give up after two minutes
+i=0
+while [ $i -lt 120 ] && ! grep -q "TRAFGEN:.*pkt/s" "${log_gen}" 2>/dev/null
+do
+    sleep 1
+    i=$(expr $i + 1)
+done
+kill "${gen_pid}" 2>/dev/null || true
+
+if ! grep -q "TRAFGEN:.*pkt/s" "${log_gen}"
+then
+    echo "FAILED: no benchmark results found, generator log follows" >&2
+    cat "${log_gen}" >&2
+    exit 1
+fi
+
+grep "TRAFGEN:" "${log_gen}"
+
+cleanup
+trap 0
+exit 0
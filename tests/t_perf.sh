@@ -0,0 +1,109 @@
+#! /bin/sh
+#
+# t_perf.sh - performance regression gate over the crypto loopback
+# path also exercised by t_lpback.sh.  Runs fixed workloads (64 byte
+# VoIP-sized and 1400 byte bulk packets) through --test-crypto-perf,
+# records a per-machine baseline on the first run, and fails when the
+# packet rate drops or the p99 latency rises by more than
+# PERF_TOLERANCE percent against that baseline.
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+# 02110-1301, USA.
+
+set -eu
+top_builddir="${top_builddir:-..}"
+openvpn="${top_builddir}/src/openvpn/openvpn"
+
+# gate parameters, overridable from the environment
+PERF_ITERATIONS="${PERF_ITERATIONS:-100000}"
+PERF_TOLERANCE="${PERF_TOLERANCE:-5}"
+PERF_REPEAT="${PERF_REPEAT:-5}"
+PERF_BASELINE="${PERF_BASELINE:-.t_perf-baseline}"
+
+trap "rm -f key.$$ log.$$ raw.$$ results.$$ ; trap 0 ; exit 77" 1 2 15
+trap "rm -f key.$$ log.$$ raw.$$ results.$$ ; exit 1" 0 3
+
+"${openvpn}" --genkey secret key.$$
+
+# best of PERF_REPEAT runs: scheduling noise only ever makes a run
+# slower, so the best run is the stable measure of the code itself
+: >raw.$$
+i=0
+while [ $i -lt "${PERF_REPEAT}" ]
+do
+    if ! "${openvpn}" --test-crypto --secret key.$$ --cipher AES-256-GCM \
+         --test-crypto-perf "${PERF_ITERATIONS}" >log.$$ 2>&1
+    then
+        echo "FAILED: crypto self-test did not complete, log follows" >&2
+        cat log.$$ >&2
+        exit 1
+    fi
+    # "CRYPTO-PERF: size=64 iterations=100000 pps=... p99_ns=..."
+    # -> "64 <pps> <p99_ns>" per workload
+    sed -n 's/.*CRYPTO-PERF: size=\([0-9]*\) iterations=[0-9]* pps=\([0-9]*\) p99_ns=\([0-9]*\).*/\1 \2 \3/p' \
+        log.$$ >>raw.$$
+    i=$(expr $i + 1)
+done
+
+awk '{
+         if (!($1 in pps) || $2 > pps[$1]) { pps[$1] = $2 }
+         if (!($1 in p99) || $3 < p99[$1]) { p99[$1] = $3 }
+     }
+     END { for (s in pps) { print s, pps[s], p99[s] } }' raw.$$ \
+    | sort -n >results.$$
+
+if ! [ -s results.$$ ]
+then
+    echo "FAILED: no CRYPTO-PERF results found, log follows" >&2
+    cat log.$$ >&2
+    exit 1
+fi
+
+if ! [ -f "${PERF_BASELINE}" ]
+then
+    # first run on this machine: record the baseline and skip
+    cp results.$$ "${PERF_BASELINE}"
+    echo "$0: recorded new baseline in ${PERF_BASELINE}, skipping comparison" >&2
+    rm -f key.$$ log.$$ raw.$$ results.$$
+    trap 0
+    exit 77
+fi
+
+cat results.$$
+
+if ! awk -v tol="${PERF_TOLERANCE}" '
+    NR == FNR { base_pps[$1] = $2; base_p99[$1] = $3; next }
+    $1 in base_pps {
+        if ($2 < base_pps[$1] * (100 - tol) / 100) {
+            printf "FAIL size=%s: pps %s more than %s%% below baseline %s\n",
+                   $1, $2, tol, base_pps[$1]
+            status = 1
+        }
+        if ($3 > base_p99[$1] * (100 + tol) / 100) {
+            printf "FAIL size=%s: p99_ns %s more than %s%% above baseline %s\n",
+                   $1, $3, tol, base_p99[$1]
+            status = 1
+        }
+    }
+    END { exit status }' "${PERF_BASELINE}" results.$$
+then
+    echo "FAILED: performance regressed against ${PERF_BASELINE}" >&2
+    echo "(delete the baseline file to re-record after an intended change)" >&2
+    exit 1
+fi
+
+rm -f key.$$ log.$$ raw.$$ results.$$
+trap 0
+exit 0
@@ -162,6 +162,43 @@ argv_parse_cmd__command_and_extra_options__argc_correct(void **state)
     argv_free(&a);
 }
 
+static void
+argv_template_expand__same_string__prefix_copied(void **state)
+{
+    struct argv_template t;
+
+    argv_template_init(&t, SCRIPT_CMD);
+    assert_int_equal(t.parsed.argc, 3);
+
+    struct argv a = argv_template_expand(&t, SCRIPT_CMD);
+    argv_printf_cat(&a, "%s", PARAM1);
+    assert_int_equal(a.argc, 4);
+    for (size_t i = 0; i < t.parsed.argc; i++)
+    {
+        assert_string_equal(a.argv[i], t.parsed.argv[i]);
+    }
+
+    argv_free(&a);
+    argv_template_free(&t);
+}
+
+static void
+argv_template_expand__other_string__parsed_from_scratch(void **state)
+{
+    struct argv_template t;
+
+    argv_template_init(&t, SCRIPT_CMD);
+
+    /* per-client override: same content, different string */
+    char override[sizeof(SCRIPT_CMD)];
+    strcpy(override, SCRIPT_CMD);
+    struct argv a = argv_template_expand(&t, override);
+    assert_int_equal(a.argc, 3);
+
+    argv_free(&a);
+    argv_template_free(&t);
+}
+
 static void
 argv_printf_cat__used_twice__argc_correct(void **state)
 {
@@ -263,6 +300,8 @@ main(void)
         cmocka_unit_test(argv_printf__long_args__data_correct),
         cmocka_unit_test(argv_parse_cmd__command_string__argc_correct),
         cmocka_unit_test(argv_parse_cmd__command_and_extra_options__argc_correct),
+        cmocka_unit_test(argv_template_expand__same_string__prefix_copied),
+        cmocka_unit_test(argv_template_expand__other_string__parsed_from_scratch),
         cmocka_unit_test(argv_printf_cat__used_twice__argc_correct),
         cmocka_unit_test(argv_str__empty_argv__empty_output),
         cmocka_unit_test(argv_str__multiple_argv__correct_output),
@@ -0,0 +1,354 @@
+/*
+ *  OpenVPN -- An application to securely tunnel IP networks
+ *             over a single TCP/UDP port, with support for SSL/TLS-based
+ *             session authentication and key exchange,
+ *             packet encryption, packet authentication, and
+ *             packet compression.
+ *
+ *  Copyright (C) 2002-2018 OpenVPN Inc <sales@openvpn.net>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License version 2
+ *  as published by the Free Software Foundation.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with this program; if not, write to the Free Software Foundation, Inc.,
+ *  51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Hermetic multi-client scalability simulation.  multi.c itself cannot
+ * be linked without the full tun/socket/TLS initialization stack, so
+ * this driver instantiates N synthetic clients against the exact
+ * structures multi.c delegates its scalability-critical work to: the
+ * mroute_addr-keyed real and virtual address hash tables and the timer
+ * wheel scheduler.  Connect, steady-state lookup, coarse-timer churn
+ * and bulk teardown are timed per phase and printed as JSON so CI can
+ * archive and diff the numbers across commits.  Run via
+ * 'make multi-sim'.
+ *
+ * Like bench.c this is a standalone program without cmocka, so it
+ * builds without the unit test dependencies installed.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#elif defined(_MSC_VER)
+#include "config-msvc.h"
+#endif
+
+#include "syshead.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "buffer.h"
+#include "crypto.h"
+#include "list.h"
+#include "mroute.h"
+#include "otime.h"
+#include "proto.h"
+#include "schedule.h"
+#include "socket.h"
+
+/*
+ * Minimal msg() glue, local to the driver so that we do not pull in
+ * mock_msg.c (which requires cmocka).
+ */
+unsigned int x_debug_level = 0;
+
+void
+x_msg_va(const unsigned int flags, const char *format, va_list arglist)
+{
+    if (flags & (M_FATAL|M_NONFATAL|M_WARN))
+    {
+        vfprintf(stderr, format, arglist);
+        fprintf(stderr, "\n");
+    }
+    if (flags & M_FATAL)
+    {
+        exit(1);
+    }
+}
+
+void
+x_msg(const unsigned int flags, const char *format, ...)
+{
+    va_list arglist;
+    va_start(arglist, format);
+    x_msg_va(flags, format, arglist);
+    va_end(arglist);
+}
+
+void
+assert_failed(const char *filename, int line, const char *condition)
+{
+    fprintf(stderr, "Assertion failed at %s:%d (%s)\n",
+            filename, line, condition ? condition : "");
+    abort();
+}
+
+void
+out_of_memory(void)
+{
+    fprintf(stderr, "Out of Memory\n");
+    exit(1);
+}
+
+bool
+dont_mute(unsigned int flags)
+{
+    return true;
+}
+
+const char *
+print_in_addr_t(in_addr_t addr, unsigned int flags, struct gc_arena *gc)
+{
+    return "[sim]";
+}
+
+const char *
+print_in6_addr(struct in6_addr addr6, unsigned int flags, struct gc_arena *gc)
+{
+    return "[sim]";
+}
+
+/* deterministic stand-in; only hash table seeding would consume it */
+long int
+get_random(void)
+{
+    return 0x5d10c849;
+}
+
+static uint64_t
+sim_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* defeats dead code elimination of the measured calls */
+static volatile uint64_t sim_sink;
+
+/*
+ * One synthetic client: the link-level source address the server
+ * learns from incoming datagrams, the virtual address learned from
+ * tun-sourced packets, and the coarse timer wakeup entry -- the same
+ * per-instance state multi.c keys its lookups and wakeups on.
+ */
+struct sim_instance
+{
+    struct mroute_addr real;
+    struct mroute_addr virt;
+    struct schedule_entry se;
+};
+
+struct sim_server
+{
+    struct hash *hash;      /* real address -> instance */
+    struct hash *vhash;     /* virtual address -> instance */
+    struct schedule *schedule;
+    struct sim_instance *instances;
+    int n_clients;
+};
+
+static void
+sim_instance_make_addrs(struct sim_instance *inst, int i)
+{
+    /* real address: UDP source, as mroute_extract_openvpn_sockaddr()
+     * would record it for an incoming datagram */
+    struct openvpn_sockaddr osaddr;
+    CLEAR(osaddr);
+    osaddr.addr.in4.sin_family = AF_INET;
+    osaddr.addr.in4.sin_addr.s_addr = htonl(0xc0a80000 + (uint32_t)i);
+    osaddr.addr.in4.sin_port = htons((uint16_t)(1024 + (i & 0x7fff)));
+    ASSERT(mroute_extract_openvpn_sockaddr(&inst->real, &osaddr, true));
+
+    /* virtual address: extracted from a synthetic tun packet so it
+     * carries the canonical representation used by the vhash */
+    struct buffer pkt = alloc_buf(sizeof(struct openvpn_iphdr));
+    struct openvpn_iphdr ip;
+    struct mroute_addr dest;
+    CLEAR(ip);
+    ip.version_len = 0x45;
+    ip.protocol = OPENVPN_IPPROTO_UDP;
+    ip.saddr = htonl(0x0a080000 + (uint32_t)i);
+    ip.daddr = htonl(0x0afffffe);
+    ASSERT(buf_write(&pkt, &ip, sizeof(ip)));
+    ASSERT(mroute_extract_addr_from_packet(&inst->virt, &dest, NULL, NULL,
+                                           0, &pkt, DEV_TYPE_TUN)
+           & MROUTE_EXTRACT_SUCCEEDED);
+    free_buf(&pkt);
+}
+
+struct sim_result
+{
+    const char *name;
+    uint64_t iterations;
+    uint64_t ns;
+};
+
+static void
+sim_result_set(struct sim_result *r, const char *name,
+               uint64_t iterations, uint64_t ns_start)
+{
+    r->name = name;
+    r->iterations = iterations;
+    r->ns = sim_now_ns() - ns_start;
+}
+
+/*
+ * Connect phase: register every client in both hash tables and hang
+ * its wakeup on the scheduler, as multi_create_instance() and
+ * multi_schedule_context_wakeup() do.
+ */
+static void
+sim_connect(struct sim_server *s, struct sim_result *r)
+{
+    const uint64_t ns = sim_now_ns();
+    for (int i = 0; i < s->n_clients; ++i)
+    {
+        struct sim_instance *inst = &s->instances[i];
+        struct timeval wakeup;
+
+        ASSERT(hash_add(s->hash, &inst->real, inst, false));
+        ASSERT(hash_add(s->vhash, &inst->virt, inst, false));
+
+        wakeup.tv_sec = now + 1 + (i & 0x3f);
+        wakeup.tv_usec = 0;
+        schedule_add_entry(s->schedule, &inst->se, &wakeup, 100000);
+    }
+    sim_result_set(r, "sim_connect", s->n_clients, ns);
+}
+
+/*
+ * Steady state: the per-packet lookups -- real address for link
+ * datagrams, virtual address for routed tun packets.
+ */
+static void
+sim_lookup(struct sim_server *s, struct sim_result *r)
+{
+    const uint64_t iterations = 2000000;
+    const uint64_t ns = sim_now_ns();
+    for (uint64_t i = 0; i < iterations; ++i)
+    {
+        const struct sim_instance *inst =
+            &s->instances[(int)(i * 2654435761u % (uint32_t)s->n_clients)];
+        sim_sink += (hash_lookup(s->hash, &inst->real) != NULL);
+        sim_sink += (hash_lookup(s->vhash, &inst->virt) != NULL);
+    }
+    sim_result_set(r, "sim_lookup_real_and_virtual", iterations, ns);
+}
+
+/*
+ * Coarse timer churn: pop the earliest wakeup and re-arm it in the
+ * future, the cadence multi_process_timeout() imposes on the wheel.
+ */
+static void
+sim_timer_churn(struct sim_server *s, struct sim_result *r)
+{
+    const uint64_t iterations = 1000000;
+    const uint64_t ns = sim_now_ns();
+    for (uint64_t i = 0; i < iterations; ++i)
+    {
+        struct timeval wakeup;
+        struct schedule_entry *e =
+            schedule_get_earliest_wakeup(s->schedule, &wakeup);
+        ASSERT(e);
+        wakeup.tv_sec += 1 + (int)(i & 0x1f);
+        schedule_add_entry(s->schedule, e, &wakeup, 100000);
+        sim_sink += (uint64_t)wakeup.tv_sec;
+    }
+    sim_result_set(r, "sim_timer_churn", iterations, ns);
+}
+
+/*
+ * Teardown: unlink every client from both hash tables and the
+ * scheduler, as the multi_close_instance() loop in multi_uninit()
+ * does on shutdown.
+ */
+static void
+sim_teardown(struct sim_server *s, struct sim_result *r)
+{
+    const uint64_t ns = sim_now_ns();
+    for (int i = 0; i < s->n_clients; ++i)
+    {
+        struct sim_instance *inst = &s->instances[i];
+        schedule_remove_entry(s->schedule, &inst->se);
+        ASSERT(hash_remove(s->hash, &inst->real));
+        ASSERT(hash_remove(s->vhash, &inst->virt));
+    }
+    sim_result_set(r, "sim_teardown", s->n_clients, ns);
+}
+
+static void
+print_result_json(const struct sim_result *r, bool last)
+{
+    const double ns_per_op = (double)r->ns / (double)r->iterations;
+    const double ops_per_sec = r->ns ? (double)r->iterations * 1e9 / (double)r->ns : 0.0;
+
+    printf("    { \"name\": \"%s\", \"iterations\": %" PRIu64
+           ", \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f }%s\n",
+           r->name, r->iterations, ns_per_op, ops_per_sec,
+           last ? "" : ",");
+}
+
+#define SIM_N_CLIENTS 10000
+
+/* sized as multi_init() would for --max-clients 10000 */
+#define SIM_REAL_HASH_SIZE 256
+#define SIM_VIRTUAL_HASH_SIZE 256
+
+int
+main(void)
+{
+    struct sim_server s;
+    struct sim_result results[4];
+    int n = 0;
+
+    update_time();
+
+    CLEAR(s);
+    s.n_clients = SIM_N_CLIENTS;
+    s.hash = hash_init(SIM_REAL_HASH_SIZE, 0x9e3779b9,
+                       mroute_addr_hash_function,
+                       mroute_addr_compare_function);
+    s.vhash = hash_init(SIM_VIRTUAL_HASH_SIZE, 0x9e3779b9,
+                        mroute_addr_hash_function,
+                        mroute_addr_compare_function);
+    s.schedule = schedule_init();
+    s.instances = (struct sim_instance *)
+        calloc(s.n_clients, sizeof(struct sim_instance));
+    ASSERT(s.instances);
+
+    for (int i = 0; i < s.n_clients; ++i)
+    {
+        sim_instance_make_addrs(&s.instances[i], i);
+    }
+
+    sim_connect(&s, &results[n++]);
+    sim_lookup(&s, &results[n++]);
+    sim_timer_churn(&s, &results[n++]);
+    sim_teardown(&s, &results[n++]);
+
+    printf("{\n  \"clients\": %d,\n  \"phases\": [\n", s.n_clients);
+    for (int i = 0; i < n; ++i)
+    {
+        print_result_json(&results[i], i == n - 1);
+    }
+    printf("  ]\n}\n");
+
+    hash_free(s.hash);
+    hash_free(s.vhash);
+    schedule_free(s.schedule);
+    free(s.instances);
+    return 0;
+}
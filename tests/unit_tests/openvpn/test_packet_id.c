@@ -156,6 +156,120 @@ test_packet_id_write_long_wrap(void **state)
     assert_true(data->test_buf_data.buf_time == htonl(now));
 }
 
+static void
+test_packet_id_replay_sequential(void **state)
+{
+    struct packet_id pid;
+    struct packet_id_net pin = { 0 };
+    packet_id_type i;
+
+    packet_id_init(&pid, 64, 15, "TEST", 0);
+    now = 5010;
+
+    /* monotonically increasing ids are accepted... */
+    for (i = 1; i <= 100; ++i)
+    {
+        pin.id = i;
+        assert_true(packet_id_test(&pid.rec, &pin));
+        packet_id_add(&pid.rec, &pin);
+    }
+
+    /* ...but no id is accepted twice, in or out of the window */
+    for (i = 1; i <= 100; ++i)
+    {
+        pin.id = i;
+        assert_false(packet_id_test(&pid.rec, &pin));
+    }
+
+    packet_id_free(&pid);
+}
+
+static void
+test_packet_id_replay_out_of_order(void **state)
+{
+    struct packet_id pid;
+    struct packet_id_net pin = { 0 };
+    packet_id_type i;
+
+    packet_id_init(&pid, 64, 15, "TEST", 0);
+    now = 5010;
+
+    /* receive 1..10, but hold back 5 */
+    for (i = 1; i <= 10; ++i)
+    {
+        if (i == 5)
+        {
+            continue;
+        }
+        pin.id = i;
+        assert_true(packet_id_test(&pid.rec, &pin));
+        packet_id_add(&pid.rec, &pin);
+    }
+
+    /* the late packet is accepted exactly once */
+    pin.id = 5;
+    assert_true(packet_id_test(&pid.rec, &pin));
+    packet_id_add(&pid.rec, &pin);
+    assert_false(packet_id_test(&pid.rec, &pin));
+
+    packet_id_free(&pid);
+}
+
+static void
+test_packet_id_replay_window_slide(void **state)
+{
+    struct packet_id pid;
+    struct packet_id_net pin = { 0 };
+
+    packet_id_init(&pid, 64, 15, "TEST", 0);
+    now = 5010;
+
+    pin.id = 1;
+    assert_true(packet_id_test(&pid.rec, &pin));
+    packet_id_add(&pid.rec, &pin);
+
+    /* jump far ahead of the window */
+    pin.id = 1000;
+    assert_true(packet_id_test(&pid.rec, &pin));
+    packet_id_add(&pid.rec, &pin);
+
+    /* inside the window: accepted once */
+    pin.id = 999;
+    assert_true(packet_id_test(&pid.rec, &pin));
+    packet_id_add(&pid.rec, &pin);
+    assert_false(packet_id_test(&pid.rec, &pin));
+
+    /* outside the window: always rejected */
+    pin.id = 1000 - 64;
+    assert_false(packet_id_test(&pid.rec, &pin));
+
+    packet_id_free(&pid);
+}
+
+static void
+test_packet_id_replay_time_backtrack(void **state)
+{
+    struct packet_id pid;
+    struct packet_id_net pin = { 0 };
+
+    packet_id_init(&pid, 64, 15, "TEST", 0);
+    now = 5010;
+
+    pin.id = 10;
+    assert_true(packet_id_test(&pid.rec, &pin));
+    packet_id_add(&pid.rec, &pin);
+
+    /* an unseen id inside the window is fine right away... */
+    pin.id = 5;
+    assert_true(packet_id_test(&pid.rec, &pin));
+
+    /* ...but not once the window has been stale for > time_backtrack */
+    now = 5030;
+    assert_false(packet_id_test(&pid.rec, &pin));
+
+    packet_id_free(&pid);
+}
+
 int
 main(void)
 {
@@ -178,6 +292,10 @@ main(void)
         cmocka_unit_test_setup_teardown(test_packet_id_write_long_wrap,
                                         test_packet_id_write_setup,
                                         test_packet_id_write_teardown),
+        cmocka_unit_test(test_packet_id_replay_sequential),
+        cmocka_unit_test(test_packet_id_replay_out_of_order),
+        cmocka_unit_test(test_packet_id_replay_window_slide),
+        cmocka_unit_test(test_packet_id_replay_time_backtrack),
     };
 
     return cmocka_run_group_tests_name("packet_id tests", tests, NULL, NULL);